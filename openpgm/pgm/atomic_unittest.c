@@ -115,6 +115,25 @@ START_TEST (test_int32_set_pass_001)
 }
 END_TEST
 
+/* target:
+ *	bool
+ *	pgm_atomic_compare_and_swap32 (
+ *		volatile uint32_t*	atomic,
+ *		const uint32_t		oldval,
+ *		const uint32_t		newval
+ *	)
+ */
+
+START_TEST (test_int32_compare_and_swap_pass_001)
+{
+	volatile uint32_t atomic = (uint32_t)-20;
+	fail_unless (TRUE == pgm_atomic_compare_and_swap32 (&atomic, (uint32_t)-20, 5), "cas failed");
+	fail_unless (5 == atomic, "cas failed");
+	fail_unless (FALSE == pgm_atomic_compare_and_swap32 (&atomic, (uint32_t)-20, 7), "cas failed");
+	fail_unless (5 == atomic, "cas failed");
+}
+END_TEST
+
 
 static
 Suite*
@@ -141,6 +160,10 @@ make_test_suite (void)
 	suite_add_tcase (s, tc_set);
 	tcase_add_test (tc_set, test_int32_set_pass_001);
 
+	TCase* tc_compare_and_swap = tcase_create ("compare-and-swap");
+	suite_add_tcase (s, tc_compare_and_swap);
+	tcase_add_test (tc_compare_and_swap, test_int32_compare_and_swap_pass_001);
+
 	return s;
 }
 
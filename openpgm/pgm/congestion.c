@@ -0,0 +1,273 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * PGMCC congestion window algorithms.
+ *
+ * Copyright (c) 2006-2010 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+#include <impl/framework.h>
+#include <impl/socket.h>
+#include <impl/congestion.h>
+
+
+/* CUBIC constants, RFC 8312: C = 0.4, β = 0.7.  the window curve is evaluated
+ * in milliseconds and fp8 packets, 10⁹ / (C × 256) folds both scales.  fp8
+ * windows reach 2²⁸ so products are taken in 64 bits.
+ */
+#define CUBIC_BETA		179		/* fp8 0.7 */
+#define CUBIC_BETA_FAST		218		/* fp8 (1 + β) / 2, fast convergence */
+#define CUBIC_SCALE		UINT64_C(9765625)
+#define CUBIC_FRIENDLY		136		/* fp8 3(1 - β) / (1 + β) per RTT */
+#define CUBIC_MAX_OFFSET	(1 << 20)	/* msecs, bounds the cube in 64 bits */
+#define CUBIC_MAX_WND		pgm_fp8 (1 << 20)
+
+/* TCP Reno as specified for PGMCC: slow start to a fixed threshold, then
+ * one packet per window per round trip, halving on loss.
+ */
+
+static
+void
+reno_on_start (
+	pgm_sock_t*const	sock
+	)
+{
+	sock->ssthresh = pgm_fp8 (4);
+}
+
+/* slow start growth shared by all algorithms, consumes the ACKs spent below
+ * the threshold from *n and returns the tokens granted.
+ */
+
+static
+uint32_t
+slow_start (
+	pgm_sock_t*const		sock,
+	uint_fast32_t*const restrict	n
+	)
+{
+	if (sock->cwnd_size >= sock->ssthresh)
+		return 0;
+	const uint_fast32_t d = MIN( *n, sock->ssthresh - sock->cwnd_size );
+	*n -= d;
+	sock->cwnd_size += d;
+	return d + d;
+}
+
+static
+uint32_t
+reno_on_ack (
+	pgm_sock_t*const	sock,
+	const unsigned		new_acks,
+	const pgm_time_t	now
+	)
+{
+	(void)now;
+	uint_fast32_t n = pgm_fp8 (new_acks);
+	uint_fast32_t token_inc = slow_start (sock, &n);
+
+	const uint_fast32_t iw = pgm_fp8div (pgm_fp8 (1), sock->cwnd_size);
+
+/* linear window increase */
+	token_inc	+= pgm_fp8mul (n, pgm_fp8 (1) + iw);
+	sock->cwnd_size += pgm_fp8mul (n, iw);
+	return (uint32_t)token_inc;
+}
+
+static
+void
+reno_on_loss (
+	pgm_sock_t*const	sock
+	)
+{
+	sock->cwnd_size = pgm_fp8div (sock->cwnd_size, pgm_fp8 (2));
+}
+
+static
+void
+reno_on_timeout (
+	pgm_sock_t*const	sock
+	)
+{
+	sock->cwnd_size = pgm_fp8 (1);
+}
+
+const pgm_cc_ops_t pgm_cc_reno = {
+	.name		= "reno",
+	.on_start	= reno_on_start,
+	.on_ack		= reno_on_ack,
+	.on_loss	= reno_on_loss,
+	.on_timeout	= reno_on_timeout
+};
+
+/* CUBIC, RFC 8312: after a reduction the window follows a cubic curve of the
+ * time since the reduction, centred on the window where loss last occurred.
+ * growth is independent of the ACKer round trip time, which lets the window
+ * refill long fat paths within seconds.  the TCP friendly estimate keeps short
+ * paths no slower than Reno.
+ */
+
+static
+uint32_t
+cubic_root (
+	const uint64_t		a
+	)
+{
+	uint32_t x = 0;
+	for (int b = 21; b >= 0; b--) {
+		const uint64_t y = x | (UINT32_C(1) << b);
+		if (y * y * y <= a)
+			x = (uint32_t)y;
+	}
+	return x;
+}
+
+static
+void
+cubic_on_start (
+	pgm_sock_t*const	sock
+	)
+{
+/* slow start until the first loss */
+	sock->ssthresh = CUBIC_MAX_WND;
+	sock->cc_w_max = 0;
+	sock->cc_epoch = 0;
+}
+
+static
+uint32_t
+cubic_target (
+	pgm_sock_t*const	sock,
+	const pgm_time_t	now
+	)
+{
+	const uint32_t rtt = MAX(1, (uint32_t)pgm_to_msecs (sock->acker_rtt));
+	const uint32_t elapsed = (uint32_t)MIN(pgm_to_msecs (now - sock->cc_epoch), CUBIC_MAX_OFFSET);
+
+/* W_cubic(t + RTT) */
+	const int64_t offset = MIN((int64_t)elapsed + rtt, CUBIC_MAX_OFFSET) - sock->cc_k;
+	const uint64_t d = offset < 0 ? (uint64_t)-offset : (uint64_t)offset;
+	const uint64_t delta = (d * d * d) / CUBIC_SCALE;
+	uint64_t target;
+	if (offset < 0)
+		target = delta < sock->cc_w_max ? sock->cc_w_max - delta : 0;
+	else
+		target = sock->cc_w_max + delta;
+
+/* W_est, the window Reno would have reached since the reduction */
+	const uint64_t w_est = (((uint64_t)sock->cc_w_max * CUBIC_BETA) >> 8) + ((uint64_t)elapsed * CUBIC_FRIENDLY) / rtt;
+	target = MAX(target, w_est);
+	return (uint32_t)MIN(target, CUBIC_MAX_WND);
+}
+
+static
+uint32_t
+cubic_on_ack (
+	pgm_sock_t*const	sock,
+	const unsigned		new_acks,
+	const pgm_time_t	now
+	)
+{
+	(void)now;
+	uint_fast32_t n = pgm_fp8 (new_acks);
+	uint_fast32_t token_inc = slow_start (sock, &n);
+	if (0 == n)
+		return (uint32_t)token_inc;
+	token_inc += n;
+
+/* first congestion avoidance ACK of the epoch places the curve */
+	if (0 == sock->cc_epoch) {
+		sock->cc_epoch = now;
+		if (sock->cc_w_max > sock->cwnd_size) {
+			sock->cc_k = cubic_root ((uint64_t)(sock->cc_w_max - sock->cwnd_size) * CUBIC_SCALE);
+		} else {
+			sock->cc_k = 0;
+			sock->cc_w_max = sock->cwnd_size;
+		}
+	}
+
+	const uint32_t target = cubic_target (sock, now);
+	uint64_t growth;
+	if (target > sock->cwnd_size) {
+/* (target - W) / W per ACK, no faster than half a packet per ACK */
+		growth = ((uint64_t)n * (target - sock->cwnd_size)) / sock->cwnd_size;
+		growth = MIN(growth, n / 2);
+	} else {
+/* plateau around W_max, probe slowly */
+		growth = ((uint64_t)n << 8) / (100 * (uint64_t)sock->cwnd_size);
+	}
+	sock->cwnd_size = (uint32_t)MIN(sock->cwnd_size + growth, CUBIC_MAX_WND);
+	return (uint32_t)(token_inc + growth);
+}
+
+static
+void
+cubic_on_loss (
+	pgm_sock_t*const	sock
+	)
+{
+/* fast convergence, release bandwidth to newer flows when W_max shrinks */
+	if (sock->cwnd_size < sock->cc_w_max)
+		sock->cc_w_max = (uint32_t)(((uint64_t)sock->cwnd_size * CUBIC_BETA_FAST) >> 8);
+	else
+		sock->cc_w_max = sock->cwnd_size;
+	sock->cwnd_size = MAX((uint32_t)(((uint64_t)sock->cwnd_size * CUBIC_BETA) >> 8), pgm_fp8 (1));
+	sock->ssthresh	= MAX(sock->cwnd_size, pgm_fp8 (2));
+	sock->cc_epoch	= 0;
+}
+
+static
+void
+cubic_on_timeout (
+	pgm_sock_t*const	sock
+	)
+{
+	sock->cc_w_max	= sock->cwnd_size;
+	sock->ssthresh	= MAX((uint32_t)(((uint64_t)sock->cwnd_size * CUBIC_BETA) >> 8), pgm_fp8 (2));
+	sock->cwnd_size = pgm_fp8 (1);
+	sock->cc_epoch	= 0;
+}
+
+const pgm_cc_ops_t pgm_cc_cubic = {
+	.name		= "cubic",
+	.on_start	= cubic_on_start,
+	.on_ack		= cubic_on_ack,
+	.on_loss	= cubic_on_loss,
+	.on_timeout	= cubic_on_timeout
+};
+
+/* map a PGM_CC_ALGORITHM value to its callbacks.
+ *
+ * returns NULL for an unknown algorithm.
+ */
+
+PGM_GNUC_INTERNAL
+const pgm_cc_ops_t*
+pgm_cc_lookup (
+	const int		algorithm
+	)
+{
+	switch (algorithm) {
+	case PGM_CC_RENO:	return &pgm_cc_reno;
+	case PGM_CC_CUBIC:	return &pgm_cc_cubic;
+	default:		return NULL;
+	}
+}
+
+/* eof */
@@ -0,0 +1,246 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * unit tests for PGMCC congestion window algorithms.
+ *
+ * Copyright (c) 2009 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <check.h>
+
+#ifdef _WIN32
+#	define PGM_CHECK_NOFORK		1
+#endif
+
+
+/* mock state */
+
+#include "congestion.c"
+
+
+static
+pgm_sock_t*
+generate_sock (
+	const pgm_cc_ops_t*	cc_ops
+	)
+{
+	pgm_sock_t* sock = g_new0 (pgm_sock_t, 1);
+	sock->cc_ops = cc_ops;
+	sock->tokens = sock->cwnd_size = pgm_fp8 (1);
+	sock->cc_ops->on_start (sock);
+	return sock;
+}
+
+/* ACK a full window each round trip, one ACK per packet batch of eight.
+ */
+
+static
+void
+run_rounds (
+	pgm_sock_t*		sock,
+	pgm_time_t*		now,
+	const pgm_time_t	rtt,
+	const unsigned		rounds
+	)
+{
+	for (unsigned i = 0; i < rounds; i++) {
+		const unsigned acks = MAX(1, pgm_fp8tou (sock->cwnd_size) / 8);
+		for (unsigned j = 0; j < acks; j++)
+			sock->cc_ops->on_ack (sock, 8, *now + (rtt * j) / acks);
+		*now += rtt;
+	}
+}
+
+/* target:
+ *	const pgm_cc_ops_t*
+ *	pgm_cc_lookup (
+ *		const int		algorithm
+ *	)
+ */
+
+START_TEST (test_lookup_pass_001)
+{
+	fail_unless (&pgm_cc_reno == pgm_cc_lookup (PGM_CC_RENO), "reno failed");
+	fail_unless (&pgm_cc_cubic == pgm_cc_lookup (PGM_CC_CUBIC), "cubic failed");
+}
+END_TEST
+
+START_TEST (test_lookup_fail_001)
+{
+	fail_unless (NULL == pgm_cc_lookup (-1), "lookup failed");
+	fail_unless (NULL == pgm_cc_lookup (PGM_CC_CUBIC + 1), "lookup failed");
+}
+END_TEST
+
+/* target:
+ *	uint32_t
+ *	on_ack (
+ *		pgm_sock_t*const	sock,
+ *		const unsigned		new_acks,
+ *		const pgm_time_t	now
+ *	)
+ */
+
+/* slow start doubles tokens up to the threshold of four packets */
+START_TEST (test_reno_on_ack_pass_001)
+{
+	pgm_sock_t* sock = generate_sock (&pgm_cc_reno);
+	fail_unless (pgm_fp8 (4) == sock->ssthresh, "ssthresh failed");
+	const uint32_t token_inc = sock->cc_ops->on_ack (sock, 1, 0);
+	fail_unless (pgm_fp8 (2) == sock->cwnd_size, "cwnd failed");
+	fail_unless (pgm_fp8 (2) == token_inc, "tokens failed");
+	sock->cc_ops->on_ack (sock, 4, 0);
+	fail_unless (pgm_fp8 (4) + pgm_fp8 (1) / 2 == sock->cwnd_size, "linear phase failed");
+}
+END_TEST
+
+/* unbounded slow start until the first loss */
+START_TEST (test_cubic_on_ack_pass_001)
+{
+	pgm_sock_t* sock = generate_sock (&pgm_cc_cubic);
+	const uint32_t token_inc = sock->cc_ops->on_ack (sock, 100, 0);
+	fail_unless (pgm_fp8 (101) == sock->cwnd_size, "cwnd failed");
+	fail_unless (pgm_fp8 (200) == token_inc, "tokens failed");
+	fail_unless (0 == sock->cc_epoch, "epoch failed");
+}
+END_TEST
+
+/* after a reduction the window returns to W_max near K and probes beyond it,
+ * where Reno has recovered under a twentieth of the reduction.
+ */
+START_TEST (test_cubic_on_ack_pass_002)
+{
+	const pgm_time_t rtt = pgm_msecs (200);
+	pgm_time_t now = pgm_secs (1);
+	pgm_sock_t* cubic = generate_sock (&pgm_cc_cubic);
+	pgm_sock_t* reno  = generate_sock (&pgm_cc_reno);
+	cubic->acker_rtt = reno->acker_rtt = rtt;
+	cubic->cwnd_size = reno->cwnd_size = pgm_fp8 (10000);
+	cubic->cc_ops->on_loss (cubic);
+	reno->cc_ops->on_loss (reno);
+	fail_unless (pgm_fp8tou (cubic->cwnd_size) == 6992, "cubic reduction failed");
+	fail_unless (pgm_fp8tou (reno->cwnd_size) == 5000, "reno reduction failed");
+/* K = ∛(3008 / 0.4) ≈ 19.6 seconds */
+	pgm_time_t t = now;
+	run_rounds (cubic, &t, rtt, 95);
+	fail_unless (cubic->cc_k > 19500 && cubic->cc_k < 19700, "K failed");
+	fail_unless (pgm_fp8tou (cubic->cwnd_size) > 9000, "concave growth failed");
+	fail_unless (pgm_fp8tou (cubic->cwnd_size) <= 10000, "overshoot failed");
+	run_rounds (cubic, &t, rtt, 40);
+	fail_unless (pgm_fp8tou (cubic->cwnd_size) > 10100, "convex growth failed");
+	t = now;
+	run_rounds (reno, &t, rtt, 135);
+	fail_unless (pgm_fp8tou (reno->cwnd_size) < 5200, "reno growth unexpected");
+}
+END_TEST
+
+/* target:
+ *	void
+ *	on_loss (
+ *		pgm_sock_t*const	sock
+ *	)
+ */
+
+/* fast convergence lowers W_max when loss repeats below it */
+START_TEST (test_cubic_on_loss_pass_001)
+{
+	pgm_sock_t* sock = generate_sock (&pgm_cc_cubic);
+	sock->cwnd_size = pgm_fp8 (1000);
+	sock->cc_ops->on_loss (sock);
+	fail_unless (pgm_fp8 (1000) == sock->cc_w_max, "w_max failed");
+	fail_unless (sock->cwnd_size == sock->ssthresh, "ssthresh failed");
+	sock->cc_ops->on_loss (sock);
+	fail_unless (pgm_fp8tou (sock->cc_w_max) < 699, "fast convergence failed");
+}
+END_TEST
+
+/* target:
+ *	void
+ *	on_timeout (
+ *		pgm_sock_t*const	sock
+ *	)
+ */
+
+START_TEST (test_on_timeout_pass_001)
+{
+	pgm_sock_t* sock = generate_sock (&pgm_cc_reno);
+	sock->cwnd_size = pgm_fp8 (1000);
+	sock->cc_ops->on_timeout (sock);
+	fail_unless (pgm_fp8 (1) == sock->cwnd_size, "reno failed");
+	sock = generate_sock (&pgm_cc_cubic);
+	sock->cwnd_size = pgm_fp8 (1000);
+	sock->cc_ops->on_timeout (sock);
+	fail_unless (pgm_fp8 (1) == sock->cwnd_size, "cubic failed");
+	fail_unless (pgm_fp8tou (sock->ssthresh) == 699, "ssthresh failed");
+}
+END_TEST
+
+
+static
+Suite*
+make_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create (__FILE__);
+
+	TCase* tc_lookup = tcase_create ("lookup");
+	suite_add_tcase (s, tc_lookup);
+	tcase_add_test (tc_lookup, test_lookup_pass_001);
+	tcase_add_test (tc_lookup, test_lookup_fail_001);
+
+	TCase* tc_on_ack = tcase_create ("on-ack");
+	suite_add_tcase (s, tc_on_ack);
+	tcase_add_test (tc_on_ack, test_reno_on_ack_pass_001);
+	tcase_add_test (tc_on_ack, test_cubic_on_ack_pass_001);
+	tcase_add_test (tc_on_ack, test_cubic_on_ack_pass_002);
+
+	TCase* tc_on_loss = tcase_create ("on-loss");
+	suite_add_tcase (s, tc_on_loss);
+	tcase_add_test (tc_on_loss, test_cubic_on_loss_pass_001);
+
+	TCase* tc_on_timeout = tcase_create ("on-timeout");
+	suite_add_tcase (s, tc_on_timeout);
+	tcase_add_test (tc_on_timeout, test_on_timeout_pass_001);
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_test_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
@@ -38,10 +38,17 @@
 static
 void
 __cpuidex (int cpu_info[4], int function_id, int subfunction_id) {
+// preserve all of rbx on x86_64, cpuid zeroes the upper half.
   __asm__ volatile (
+#if defined(__x86_64__)
+    "mov %%rbx, %%rdi\n"
+    "cpuid\n"
+    "xchg %%rdi, %%rbx\n"
+#else
     "mov %%ebx, %%edi\n"
     "cpuid\n"
     "xchg %%edi, %%ebx\n"
+#endif
     : "=a"(cpu_info[0]), "=D"(cpu_info[1]), "=c"(cpu_info[2]), "=d"(cpu_info[3])
     : "a"(function_id), "c"(subfunction_id)
   );
@@ -77,6 +84,7 @@ pgm_cpuid (pgm_cpu_t* cpu)
 	}
 	int cpu_info7[4] = {0};
 	__cpuidex (cpu_info, 0x1, 0x0);
+	cpu->signature = (uint32_t)cpu_info[0];
 	if (num_ids >= 7) {
 		__cpuidex (cpu_info7, 0x7, 0x0);
 	}
@@ -93,6 +101,36 @@ pgm_cpuid (pgm_cpu_t* cpu)
 			(cpu_info[2] & 0x08000000) != 0 /* OSXSAVE */ &&
 			(_xgetbv(0) & 6) == 6 /* XSAVE enabled by kernel */;
 	cpu->has_avx2 = cpu->has_avx && (cpu_info7[1] & 0x00000020) != 0;
+
+// Leaf 0x15 enumerates the TSC to core crystal clock ratio, the crystal
+// frequency itself is only reported by recent Intel processors.
+	if (num_ids >= 0x15) {
+		int cpu_info15[4] = {0};
+		__cpuidex (cpu_info15, 0x15, 0x0);
+		if (0 != cpu_info15[0] && 0 != cpu_info15[1] && 0 != cpu_info15[2]) {
+			cpu->tsc_frequency = ((uint64_t)(uint32_t)cpu_info15[2] * (uint32_t)cpu_info15[1]) /
+						(uint32_t)cpu_info15[0];
+		}
+	}
+// Extended leaf 0x80000007 EDX bit 8: invariant TSC, constant rate in all
+// ACPI P-, C- and T-states.
+	__cpuidex (cpu_info, (int)0x80000000, 0x0);
+	const uint32_t num_ext_ids = (uint32_t)cpu_info[0];
+	if (num_ext_ids >= 0x80000007) {
+		__cpuidex (cpu_info, (int)0x80000007, 0x0);
+		cpu->has_invariant_tsc = (cpu_info[3] & 0x00000100) != 0;
+	}
+// Extended leaves 0x80000002 to 0x80000004 hold the 48 byte brand string.
+	if (num_ext_ids >= 0x80000004) {
+		for (unsigned i = 0; i < 3; i++) {
+			__cpuidex (cpu_info, (int)(0x80000002 + i), 0x0);
+			memcpy (&cpu->brand[i * sizeof (cpu_info)], cpu_info, sizeof (cpu_info));
+		}
+		cpu->brand[48] = '\0';
+// Intel right-justifies the brand string.
+		const size_t pad = strspn (cpu->brand, " ");
+		memmove (cpu->brand, cpu->brand + pad, sizeof (cpu->brand) - pad);
+	}
 }
 #else
 PGM_GNUC_INTERNAL
@@ -0,0 +1,354 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Parity decoder worker pool, Reed-Solomon recovery of transmission
+ * groups is moved off the receive path onto dedicated threads.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+#include <errno.h>
+#ifdef _WIN32
+#	include <process.h>
+#endif
+#include <impl/i18n.h>
+#include <impl/framework.h>
+#include <impl/socket.h>
+#include <impl/decoder.h>
+
+
+//#define DECODER_DEBUG
+
+struct pgm_decoder_job_t {
+	pgm_list_t			link_;			/* must be first */
+	pgm_peer_t*			peer;
+	pgm_rxw_decode_t*		decode;
+};
+
+struct pgm_decoder_t {
+	pgm_sock_t*			sock;
+	unsigned			n_threads;
+#ifndef _WIN32
+	pthread_t*			threads;
+#else
+	HANDLE*				threads;
+#endif
+	pgm_mutex_t			mutex;
+	pgm_cond_t			cond;
+	pgm_queue_t			pending_queue;		/* worker input */
+	pgm_queue_t			complete_queue;		/* receiver input */
+	bool				is_terminated;
+};
+
+#ifndef _WIN32
+static void* pgm_decoder_routine (void*);
+#else
+static unsigned __stdcall pgm_decoder_routine (void*);
+#endif
+
+
+/* release a job from either queue, takes the decoder reference on the peer.
+ */
+
+static
+void
+_pgm_decoder_job_free (
+	struct pgm_decoder_job_t*	job
+	)
+{
+	pgm_rxw_decode_free (job->decode);
+	pgm_peer_unref (job->peer);
+	pgm_free (job);
+}
+
+/* spawn n_threads workers sharing one pending queue.
+ *
+ * returns NULL on failure with error set.
+ */
+
+PGM_GNUC_INTERNAL
+pgm_decoder_t*
+pgm_decoder_create (
+	pgm_sock_t*   const restrict sock,
+	const unsigned		     n_threads,
+	pgm_error_t**	    restrict error
+	)
+{
+	pgm_decoder_t* decoder;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (n_threads > 0);
+
+	pgm_debug ("pgm_decoder_create (sock:%p n-threads:%u error:%p)",
+		(const void*)sock, n_threads, (const void*)error);
+
+	decoder = pgm_new0 (pgm_decoder_t, 1);
+	decoder->sock = sock;
+#ifndef _WIN32
+	decoder->threads = pgm_new0 (pthread_t, n_threads);
+#else
+	decoder->threads = pgm_new0 (HANDLE, n_threads);
+#endif
+	pgm_mutex_init (&decoder->mutex);
+	pgm_cond_init (&decoder->cond);
+
+	for (unsigned i = 0; i < n_threads; i++)
+	{
+#ifndef _WIN32
+		const int status = pthread_create (&decoder->threads[i], NULL, &pgm_decoder_routine, decoder);
+		if (0 != status) {
+			const int save_errno = status;
+#else
+		decoder->threads[i] = (HANDLE)_beginthreadex (NULL, 0, &pgm_decoder_routine, decoder, 0, NULL);
+		if (0 == decoder->threads[i]) {
+			const int save_errno = errno;
+#endif /* _WIN32 */
+			char errbuf[1024];
+			pgm_set_error (error,
+				     PGM_ERROR_DOMAIN_SOCKET,
+				     pgm_error_from_errno (save_errno),
+				     _("Creating decoder thread: %s"),
+				     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			pgm_decoder_destroy (decoder);
+			return NULL;
+		}
+		decoder->n_threads++;
+	}
+
+	pgm_trace (PGM_LOG_ROLE_FEC,_("Started %u parity decoder thread%s."),
+		decoder->n_threads, decoder->n_threads > 1 ? "s" : "");
+	return decoder;
+}
+
+/* stop all workers and discard outstanding work, recovered packets not
+ * yet merged back into their receive window are dropped.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_decoder_destroy (
+	pgm_decoder_t*	const decoder
+	)
+{
+	pgm_list_t* link;
+
+/* pre-conditions */
+	pgm_assert (NULL != decoder);
+
+	pgm_debug ("pgm_decoder_destroy (decoder:%p)", (const void*)decoder);
+
+	pgm_mutex_lock (&decoder->mutex);
+	decoder->is_terminated = TRUE;
+	pgm_cond_broadcast (&decoder->cond);
+	pgm_mutex_unlock (&decoder->mutex);
+
+	for (unsigned i = 0; i < decoder->n_threads; i++) {
+#ifndef _WIN32
+		pthread_join (decoder->threads[i], NULL);
+#else
+		WaitForSingleObject (decoder->threads[i], INFINITE);
+		CloseHandle (decoder->threads[i]);
+#endif
+	}
+
+	while (NULL != (link = pgm_queue_pop_tail_link (&decoder->pending_queue)))
+		_pgm_decoder_job_free ((struct pgm_decoder_job_t*)link);
+	while (NULL != (link = pgm_queue_pop_tail_link (&decoder->complete_queue)))
+		_pgm_decoder_job_free ((struct pgm_decoder_job_t*)link);
+
+	pgm_cond_free (&decoder->cond);
+	pgm_mutex_free (&decoder->mutex);
+	pgm_free (decoder->threads);
+	pgm_free (decoder);
+}
+
+/* hand every transmission group the peer's window has set aside to the
+ * workers.  each job holds a reference on the peer so the window outlives
+ * peer expiration.
+ *
+ * called with receiver_mutex held.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_decoder_push (
+	pgm_decoder_t* const restrict decoder,
+	pgm_peer_t*    const restrict peer
+	)
+{
+	unsigned count = 0;
+
+/* pre-conditions */
+	pgm_assert (NULL != decoder);
+	pgm_assert (NULL != peer);
+
+	pgm_mutex_lock (&decoder->mutex);
+	while (peer->window->decode_list)
+	{
+		struct pgm_decoder_job_t* job = pgm_new0 (struct pgm_decoder_job_t, 1);
+		job->link_.data = job;
+		job->decode	= peer->window->decode_list->data;
+		job->peer	= peer;
+		pgm_atomic_inc32 (&peer->ref_count);
+		pgm_queue_push_head_link (&decoder->pending_queue, &job->link_);
+		peer->window->decode_list = pgm_slist_remove_first (peer->window->decode_list);
+		count++;
+	}
+	if (1 == count)
+		pgm_cond_signal (&decoder->cond);
+	else if (count > 1)
+		pgm_cond_broadcast (&decoder->cond);
+	pgm_mutex_unlock (&decoder->mutex);
+}
+
+/* merge recovered transmission groups back into their receive windows and
+ * mark the peers pending for delivery.
+ *
+ * called with receiver_mutex held, returns TRUE if any group was merged.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_decoder_flush (
+	pgm_decoder_t*	const decoder
+	)
+{
+	pgm_queue_t complete_queue;
+	pgm_list_t* link;
+	pgm_sock_t* sock;
+
+/* pre-conditions */
+	pgm_assert (NULL != decoder);
+
+	sock = decoder->sock;
+	pgm_mutex_lock (&decoder->mutex);
+	if (pgm_queue_is_empty (&decoder->complete_queue)) {
+		pgm_mutex_unlock (&decoder->mutex);
+		return FALSE;
+	}
+	complete_queue = decoder->complete_queue;
+	memset (&decoder->complete_queue, 0, sizeof (pgm_queue_t));
+/* workers may only raise the notify again after this point */
+	pgm_notify_clear (&sock->pending_notify);
+	if (sock->is_pending_read)
+		pgm_notify_send (&sock->pending_notify);
+	pgm_mutex_unlock (&decoder->mutex);
+
+	while (NULL != (link = pgm_queue_pop_tail_link (&complete_queue)))
+	{
+		struct pgm_decoder_job_t* job = (struct pgm_decoder_job_t*)link;
+		pgm_peer_t* peer;
+
+/* skip peers expired whilst the group was decoding */
+		pgm_rwlock_reader_lock (&sock->peers_lock);
+		peer = pgm_hashtable_lookup (sock->peers_hashtable, &job->peer->tsi);
+		pgm_rwlock_reader_unlock (&sock->peers_lock);
+		if (peer == job->peer) {
+			pgm_mutex_lock (&peer->mutex);
+			pgm_rxw_decode_complete (peer->window, job->decode);
+			pgm_mutex_unlock (&peer->mutex);
+			pgm_peer_set_pending (sock, peer);
+		}
+		_pgm_decoder_job_free (job);
+	}
+	return TRUE;
+}
+
+/* re-raise the pending notification after the receiver clears it, so that
+ * groups completed in the interval are not left stranded.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_decoder_notify (
+	pgm_decoder_t*	const decoder
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != decoder);
+
+	pgm_mutex_lock (&decoder->mutex);
+	if (!pgm_queue_is_empty (&decoder->complete_queue))
+		pgm_notify_send (&decoder->sock->pending_notify);
+	pgm_mutex_unlock (&decoder->mutex);
+}
+
+/* worker thread, each keeps a private Reed-Solomon context as decoding
+ * scribbles on the recovery matrix.
+ */
+
+#ifndef _WIN32
+static
+void*
+#else
+static
+unsigned
+__stdcall
+#endif
+pgm_decoder_routine (
+	void*		arg
+	)
+{
+	pgm_decoder_t* decoder = (pgm_decoder_t*)arg;
+	pgm_rs_t rs;
+	bool has_rs = FALSE;
+
+	pgm_mutex_lock (&decoder->mutex);
+	for (;;)
+	{
+		struct pgm_decoder_job_t* job;
+
+		while (!decoder->is_terminated && pgm_queue_is_empty (&decoder->pending_queue))
+#ifndef _WIN32
+			pgm_cond_wait (&decoder->cond, &decoder->mutex.pthread_mutex);
+#else
+			pgm_cond_wait (&decoder->cond, &decoder->mutex.win32_crit);
+#endif
+		if (decoder->is_terminated)
+			break;
+		job = (struct pgm_decoder_job_t*)pgm_queue_pop_tail_link (&decoder->pending_queue);
+		pgm_mutex_unlock (&decoder->mutex);
+
+		if (!has_rs || rs.n != job->decode->n || rs.k != job->decode->k) {
+			if (has_rs)
+				pgm_rs_destroy (&rs);
+			pgm_rs_create (&rs, job->decode->n, job->decode->k);
+			has_rs = TRUE;
+		}
+		pgm_rxw_decode (&rs, job->decode);
+
+		pgm_mutex_lock (&decoder->mutex);
+		if (pgm_queue_is_empty (&decoder->complete_queue))
+			pgm_notify_send (&decoder->sock->pending_notify);
+		pgm_queue_push_head_link (&decoder->complete_queue, &job->link_);
+	}
+	pgm_mutex_unlock (&decoder->mutex);
+
+	if (has_rs)
+		pgm_rs_destroy (&rs);
+#ifndef _WIN32
+	return NULL;
+#else
+	_endthread();
+	return 0;
+#endif
+}
+
+/* eof */
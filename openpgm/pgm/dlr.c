@@ -0,0 +1,516 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Designated local repairer, a receiver keeping a copy of recent data from
+ * each source so that NAKs from receivers on its subnet are answered with
+ * local RDATA instead of crossing the WAN to the source.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+#include <impl/i18n.h>
+#include <impl/framework.h>
+#include <impl/socket.h>
+#include <impl/receiver.h>
+#include <impl/dlr.h>
+#include <impl/packet_parse.h>
+#include <impl/net.h>
+
+
+//#define DLR_DEBUG
+
+/* one TPDU as received, indexed by sequence number modulo the cache size */
+struct pgm_dlr_slot_t {
+	uint32_t			sqn;
+	uint16_t			len;			/* 0 = empty */
+	bool				is_rdata;		/* rewritten for retransmission */
+	pgm_time_t			repair_tstamp;		/* last local repair */
+	char*				tpdu;
+};
+
+struct pgm_dlr_t {
+	uint32_t			mask;
+	uint16_t			max_tpdu;
+	struct pgm_dlr_slot_t		slots[];
+};
+
+
+/* create a repair cache of at least sqns entries, rounded up to a power of
+ * two.  slot buffers are allocated on first use.
+ */
+
+PGM_GNUC_INTERNAL
+pgm_dlr_t*
+pgm_dlr_create (
+	const unsigned		sqns,
+	const uint16_t		max_tpdu
+	)
+{
+	pgm_dlr_t* dlr;
+	unsigned size = 1;
+
+/* pre-conditions */
+	pgm_assert (sqns > 0);
+	pgm_assert (max_tpdu > 0);
+
+	pgm_debug ("pgm_dlr_create (sqns:%u max-tpdu:%" PRIu16 ")",
+		sqns, max_tpdu);
+
+	while (size < sqns && size < (1U << 24))
+		size <<= 1;
+	dlr = pgm_malloc0 (sizeof (pgm_dlr_t) + size * sizeof (struct pgm_dlr_slot_t));
+	dlr->mask	= size - 1;
+	dlr->max_tpdu	= max_tpdu;
+	return dlr;
+}
+
+PGM_GNUC_INTERNAL
+void
+pgm_dlr_destroy (
+	pgm_dlr_t* const	dlr
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != dlr);
+
+	for (uint32_t i = 0; i <= dlr->mask; i++)
+		if (dlr->slots[ i ].tpdu)
+			pgm_free (dlr->slots[ i ].tpdu);
+	pgm_free (dlr);
+}
+
+/* copy an ODATA or RDATA TPDU into the cache, replacing the sequence one
+ * cache size older.  parity packets are not kept as they are regenerated by
+ * the source on request.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_dlr_add (
+	pgm_dlr_t*		    const restrict dlr,
+	const struct pgm_sk_buff_t* const restrict skb
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != dlr);
+	pgm_assert (NULL != skb);
+	pgm_assert (NULL != skb->pgm_data);
+
+	if (skb->pgm_header->pgm_options & PGM_OPT_PARITY)
+		return;
+
+	const size_t tpdu_length = (const char*)skb->tail - (const char*)skb->pgm_header;
+	if (PGM_UNLIKELY(tpdu_length > dlr->max_tpdu))
+		return;
+
+	const uint32_t sqn = pgm_ntohl (skb->pgm_data->data_sqn);
+	struct pgm_dlr_slot_t* slot = &dlr->slots[ sqn & dlr->mask ];
+	if (PGM_UNLIKELY(NULL == slot->tpdu))
+		slot->tpdu = pgm_malloc (dlr->max_tpdu);
+	memcpy (slot->tpdu, skb->pgm_header, tpdu_length);
+	slot->sqn		= sqn;
+	slot->len		= (uint16_t)tpdu_length;
+	slot->is_rdata		= FALSE;
+	slot->repair_tstamp	= 0;
+}
+
+/* multicast a cached TPDU as RDATA scoped to the local subnet, regulated by
+ * PGM_RDATA_MAX_RTE.  the receive thread never waits on the rate limit, a
+ * receiver still missing the sequence asks again.
+ *
+ * on success, TRUE is returned, returns FALSE if operation would block.
+ */
+
+static
+bool
+send_rdata (
+	pgm_sock_t*	       const restrict sock,
+	pgm_peer_t*	       const restrict source,
+	struct pgm_dlr_slot_t* const restrict slot,
+	const struct sockaddr* const restrict group
+	)
+{
+	ssize_t sent;
+
+	if (sock->is_controlled_rdata &&
+	    !pgm_rate_check2 (&sock->rate_control,		/* total rate limit */
+			      &sock->rdata_rate_control,	/* repair data limit */
+			      slot->len,			/* excludes IP header len */
+			      TRUE))				/* never block */
+		return FALSE;
+
+	if (!slot->is_rdata) {
+		struct pgm_header* header = (struct pgm_header*)slot->tpdu;
+		header->pgm_type	= PGM_RDATA;
+		header->pgm_checksum	= 0;
+		header->pgm_checksum	= pgm_csum_fold (pgm_csum_partial (slot->tpdu, slot->len, 0));
+		slot->is_rdata = TRUE;
+	}
+
+	sent = pgm_sendto_hops (sock,
+				FALSE,			/* already rate limited */
+				NULL,
+				FALSE,			/* regular socket */
+				1,
+				slot->tpdu,
+				slot->len,
+				group,
+				pgm_sockaddr_len (group));
+	if (sent < 0 && PGM_LIKELY(PGM_SOCK_EAGAIN == pgm_get_last_sock_error()))
+		return FALSE;
+
+	PGM_PROBE (rdata_send, PGM_PROBE_RDATA_SEND, &source->tsi, slot->sqn, slot->len, pgm_time_sample());
+	source->cumulative_stats[PGM_PC_RECEIVER_DLR_REPAIRS_SENT]++;
+	return TRUE;
+}
+
+/* pass on to the source a NAK for the sequences not in the cache, the
+ * header and NLAs of the received NAK are kept.  OPT_PATH_NLA names the
+ * receiver that asked so that a unicast repair reaches it and not us.
+ *
+ * on success, TRUE is returned, returns FALSE if operation would block.
+ */
+
+static
+bool
+forward_nak (
+	pgm_sock_t*		    const restrict sock,
+	pgm_peer_t*		    const restrict source,
+	const struct pgm_sk_buff_t* const restrict skb,
+	const size_t			       nak_length,	/* NAK without options */
+	const uint32_t*		    const restrict sqn,
+	const unsigned			       sqn_len,
+	const struct sockaddr*	    const restrict requester
+	)
+{
+	size_t			 tpdu_length, options_length, path_nla_length;
+	char			*buf;
+	struct pgm_header	*header;
+	struct pgm_nak		*nak;
+	struct pgm_opt_length	*opt_len;
+	struct pgm_opt_header	*opt_header;
+	struct pgm_opt_nak_list *opt_nak_list;
+	ssize_t			 sent;
+
+	pgm_assert (sqn_len > 0);
+	pgm_assert (sqn_len <= 63);
+	pgm_assert (NULL != requester);
+
+	path_nla_length = (AF_INET6 == requester->sa_family) ?
+				sizeof(struct pgm_opt6_path_nla) :
+				sizeof(struct pgm_opt_path_nla);
+	options_length = sizeof(struct pgm_opt_length) +		/* includes header */
+			 sizeof(struct pgm_opt_header) +
+			 path_nla_length;
+	if (sqn_len > 1)
+		options_length += sizeof(struct pgm_opt_header) +
+				  sizeof(uint8_t) +
+				  ( (sqn_len-1) * sizeof(uint32_t) );
+	tpdu_length = sizeof(struct pgm_header) + nak_length + options_length;
+	buf = pgm_alloca (tpdu_length);
+	header = (struct pgm_header*)buf;
+	nak = (struct pgm_nak*)(header + 1);
+	memcpy (header, skb->pgm_header, sizeof(struct pgm_header) + nak_length);
+	header->pgm_options	= PGM_OPT_PRESENT | PGM_OPT_NETWORK;
+	nak->nak_sqn		= pgm_htonl (sqn[0]);
+
+	opt_len = (struct pgm_opt_length*)((char*)nak + nak_length);
+	opt_len->opt_type	= PGM_OPT_LENGTH;
+	opt_len->opt_length	= sizeof(struct pgm_opt_length);
+	opt_len->opt_total_length = pgm_htons ((uint16_t)options_length);
+	opt_header = (struct pgm_opt_header*)(opt_len + 1);
+
+	if (sqn_len > 1) {
+		opt_header->opt_type	= PGM_OPT_NAK_LIST;
+		opt_header->opt_length	= sizeof(struct pgm_opt_header) + sizeof(uint8_t)
+					+ ( (sqn_len-1) * sizeof(uint32_t) );
+		opt_nak_list = (struct pgm_opt_nak_list*)(opt_header + 1);
+		opt_nak_list->opt_reserved = 0;
+		for (unsigned i = 1; i < sqn_len; i++)
+			opt_nak_list->opt_sqn[i-1] = pgm_htonl (sqn[i]);
+		opt_header = (struct pgm_opt_header*)((char*)opt_header + opt_header->opt_length);
+	}
+
+/* OPT_PATH_NLA */
+	opt_header->opt_type	= PGM_OPT_PATH_NLA | PGM_OPT_END;
+	opt_header->opt_length	= (uint8_t)(sizeof(struct pgm_opt_header) + path_nla_length);
+	if (AF_INET6 == requester->sa_family) {
+		struct pgm_opt6_path_nla* opt6_path_nla = (struct pgm_opt6_path_nla*)(opt_header + 1);
+		opt6_path_nla->opt6_reserved = 0;
+		memcpy (&opt6_path_nla->opt6_path_nla, &((const struct sockaddr_in6*)requester)->sin6_addr, sizeof(struct in6_addr));
+	} else {
+		struct pgm_opt_path_nla* opt_path_nla = (struct pgm_opt_path_nla*)(opt_header + 1);
+		opt_path_nla->opt_reserved = 0;
+		memcpy (&opt_path_nla->opt_path_nla, &((const struct sockaddr_in*)requester)->sin_addr, sizeof(struct in_addr));
+	}
+
+	header->pgm_checksum	= 0;
+	header->pgm_checksum	= pgm_csum_fold (pgm_csum_partial (buf, (uint16_t)tpdu_length, 0));
+
+	sent = pgm_sendto (sock,
+			   FALSE,			/* not rate limited */
+			   NULL,
+			   TRUE,			/* with router alert */
+			   header,
+			   tpdu_length,
+			   (struct sockaddr*)&source->nla,
+			   pgm_sockaddr_len ((struct sockaddr*)&source->nla));
+	if (sent < 0 && PGM_LIKELY(PGM_SOCK_EAGAIN == pgm_get_last_sock_error()))
+		return FALSE;
+
+	source->cumulative_stats[PGM_PC_RECEIVER_DLR_NAKS_FORWARDED]++;
+	return TRUE;
+}
+
+/* NAK redirected to us by a receiver on the subnet.  cached sequences are
+ * repaired with subnet scoped RDATA, the remainder and all parity requests
+ * are forwarded to the source whose NCFs and RDATA reach every receiver.
+ * a sequence repaired within the NAK back-off interval is not sent again
+ * as the other NAKs of the same loss are already answered.
+ *
+ * returns TRUE on valid NAK, returns FALSE on discarded packet.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_dlr_on_nak (
+	pgm_sock_t*	      const restrict sock,
+	pgm_peer_t*	      const restrict source,
+	struct pgm_sk_buff_t* const restrict skb,
+	const struct sockaddr* const restrict from
+	)
+{
+	const struct pgm_nak  *nak;
+	const struct pgm_nak6 *nak6;
+	struct sockaddr_storage nak_src_nla, nak_grp_nla;
+	const struct sockaddr  *group = NULL;
+	uint32_t		sqn[63], missing[63];
+	unsigned		sqn_len = 1, missing_len = 0;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (NULL != source);
+	pgm_assert (NULL != source->dlr);
+	pgm_assert (NULL != skb);
+	pgm_assert (NULL != from);
+
+	pgm_debug ("pgm_dlr_on_nak (sock:%p source:%p skb:%p from:%p)",
+		(const void*)sock, (const void*)source, (const void*)skb, (const void*)from);
+
+	if (PGM_UNLIKELY(!pgm_verify_nak (skb)))
+	{
+		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded invalid redirected NAK."));
+		source->cumulative_stats[PGM_PC_RECEIVER_NAK_ERRORS]++;
+		return FALSE;
+	}
+
+	nak  = (const struct pgm_nak *)skb->data;
+	nak6 = (const struct pgm_nak6*)skb->data;
+	pgm_nla_to_sockaddr (&nak->nak_src_nla_afi, (struct sockaddr*)&nak_src_nla);
+
+/* repairs go to the group the NAK is for, which must be one we receive */
+	pgm_nla_to_sockaddr ((AF_INET6 == nak_src_nla.ss_family) ? &nak6->nak6_grp_nla_afi : &nak->nak_grp_nla_afi, (struct sockaddr*)&nak_grp_nla);
+	for (unsigned i = 0; i < sock->recv_gsr_len; i++)
+	{
+		if (pgm_sockaddr_cmp ((struct sockaddr*)&nak_grp_nla, (struct sockaddr*)&sock->recv_gsr[i].gsr_group) == 0)
+		{
+			group = (const struct sockaddr*)&sock->recv_gsr[i].gsr_group;
+			break;
+		}
+	}
+	if (PGM_UNLIKELY(NULL == group)) {
+		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded redirected NAK on multicast group mismatch."));
+		return FALSE;
+	}
+
+	if (skb->pgm_header->pgm_options & PGM_OPT_PARITY)
+	{
+		if (PGM_UNLIKELY(pgm_sockaddr_is_addr_unspecified ((struct sockaddr*)&source->nla))) {
+			pgm_trace (PGM_LOG_ROLE_NETWORK,_("Unable to forward NAK due to unknown source NLA."));
+			return TRUE;
+		}
+		const size_t tpdu_length = (const char*)skb->tail - (const char*)skb->pgm_header;
+		const ssize_t sent = pgm_sendto (sock,
+						 FALSE,		/* not rate limited */
+						 NULL,
+						 TRUE,		/* with router alert */
+						 skb->pgm_header,
+						 tpdu_length,
+						 (struct sockaddr*)&source->nla,
+						 pgm_sockaddr_len ((struct sockaddr*)&source->nla));
+		if (sent >= 0)
+			source->cumulative_stats[PGM_PC_RECEIVER_DLR_NAKS_FORWARDED]++;
+		return TRUE;
+	}
+
+	const size_t nak_length = (AF_INET6 == nak_src_nla.ss_family) ? sizeof(struct pgm_nak6) : sizeof(struct pgm_nak);
+	sqn[0] = pgm_ntohl (nak->nak_sqn);
+
+/* check NAK list */
+	if (skb->pgm_header->pgm_options & PGM_OPT_PRESENT)
+	{
+		const struct pgm_opt_length* opt_len = (const struct pgm_opt_length*)((const char*)nak + nak_length);
+		const struct pgm_opt_header* opt_header;
+		const char* end = (const char*)skb->tail;
+
+		if (PGM_UNLIKELY((const char*)(opt_len + 1) > end ||
+				 opt_len->opt_type != PGM_OPT_LENGTH ||
+				 opt_len->opt_length != sizeof(struct pgm_opt_length)))
+		{
+			pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded malformed redirected NAK."));
+			source->cumulative_stats[PGM_PC_RECEIVER_NAK_ERRORS]++;
+			return FALSE;
+		}
+		opt_header = (const struct pgm_opt_header*)opt_len;
+		do {
+			opt_header = (const struct pgm_opt_header*)((const char*)opt_header + opt_header->opt_length);
+			if ((const char*)(opt_header + 1) > end || 0 == opt_header->opt_length)
+				break;
+			if ((opt_header->opt_type & PGM_OPT_MASK) == PGM_OPT_NAK_LIST)
+			{
+				const uint32_t* nak_list = ((const struct pgm_opt_nak_list*)(opt_header + 1))->opt_sqn;
+				unsigned nak_list_len = ( opt_header->opt_length - sizeof(struct pgm_opt_header) - sizeof(uint8_t) ) / sizeof(uint32_t);
+				if ((const char*)(nak_list + nak_list_len) > end)
+					break;
+				while (nak_list_len-- && sqn_len < PGM_N_ELEMENTS(sqn))
+					sqn[sqn_len++] = pgm_ntohl (*nak_list++);
+				break;
+			}
+		} while (!(opt_header->opt_type & PGM_OPT_END));
+	}
+
+	for (unsigned i = 0; i < sqn_len; i++)
+	{
+		struct pgm_dlr_slot_t* slot = &source->dlr->slots[ sqn[i] & source->dlr->mask ];
+		if (0 == slot->len || slot->sqn != sqn[i]) {
+			missing[missing_len++] = sqn[i];
+			continue;
+		}
+		if (slot->repair_tstamp &&
+		    pgm_time_after (slot->repair_tstamp + sock->nak_bo_ivl, skb->tstamp))
+			continue;
+		if (!send_rdata (sock, source, slot, group))
+			break;
+		slot->repair_tstamp = skb->tstamp;
+	}
+
+	if (missing_len > 0)
+	{
+		if (PGM_UNLIKELY(pgm_sockaddr_is_addr_unspecified ((struct sockaddr*)&source->nla))) {
+			pgm_trace (PGM_LOG_ROLE_NETWORK,_("Unable to forward NAK due to unknown source NLA."));
+		} else {
+			forward_nak (sock, source, skb, nak_length, missing, missing_len, from);
+		}
+	}
+	return TRUE;
+}
+
+/* POLR carrying OPT_REDIRECT with our unicast NLA, sent periodically to the
+ * receivers of the subnet and in reply to a DLR POLL.
+ *
+ * on success, TRUE is returned, returns FALSE if operation would block.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_dlr_send_polr (
+	pgm_sock_t*	       const restrict sock,
+	pgm_peer_t*	       const restrict source,
+	const struct sockaddr* const restrict to,
+	const int			      hops
+	)
+{
+	size_t			 tpdu_length;
+	char			*buf;
+	struct pgm_header	*header;
+	struct pgm_polr		*polr;
+	struct pgm_opt_length	*opt_len;
+	struct pgm_opt_header	*opt_header;
+	struct pgm_opt_redirect	*opt_redirect;
+	ssize_t			 sent;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (NULL != source);
+	pgm_assert (NULL != to);
+
+	pgm_debug ("pgm_dlr_send_polr (sock:%p source:%p to:%p hops:%d)",
+		(const void*)sock, (const void*)source, (const void*)to, hops);
+
+	const size_t redirect_length = (AF_INET6 == sock->send_addr.ss_family) ?
+					sizeof(struct pgm_opt6_redirect) :
+					sizeof(struct pgm_opt_redirect);
+	tpdu_length = sizeof(struct pgm_header) +
+		      sizeof(struct pgm_polr) +
+		      sizeof(struct pgm_opt_length) +		/* includes header */
+		      sizeof(struct pgm_opt_header) +
+		      redirect_length;
+	buf = pgm_alloca (tpdu_length);
+	if (PGM_UNLIKELY(pgm_mem_gc_friendly))
+		memset (buf, 0, tpdu_length);
+	header = (struct pgm_header*)buf;
+	polr = (struct pgm_polr*)(header + 1);
+	memcpy (header->pgm_gsi, &source->tsi.gsi, sizeof(pgm_gsi_t));
+
+/* dport & sport swap over for a poll response */
+	header->pgm_sport	= sock->dport;
+	header->pgm_dport	= source->tsi.sport;
+	header->pgm_type	= PGM_POLR;
+	header->pgm_options	= PGM_OPT_PRESENT | PGM_OPT_NETWORK;
+	header->pgm_tsdu_length = 0;
+
+/* POLR */
+	polr->polr_sqn		= pgm_htonl (source->last_poll_sqn);
+	polr->polr_round	= pgm_htons (source->last_poll_round);
+	polr->polr_reserved	= 0;
+
+/* OPT_REDIRECT */
+	opt_len = (struct pgm_opt_length*)(polr + 1);
+	opt_len->opt_type	= PGM_OPT_LENGTH;
+	opt_len->opt_length	= sizeof(struct pgm_opt_length);
+	opt_len->opt_total_length = pgm_htons (	sizeof(struct pgm_opt_length) +
+						sizeof(struct pgm_opt_header) +
+						redirect_length );
+	opt_header = (struct pgm_opt_header*)(opt_len + 1);
+	opt_header->opt_type	= PGM_OPT_REDIRECT | PGM_OPT_END;
+	opt_header->opt_length	= (uint8_t)(sizeof(struct pgm_opt_header) + redirect_length);
+	opt_redirect = (struct pgm_opt_redirect*)(opt_header + 1);
+	opt_redirect->opt_reserved = 0;
+	pgm_sockaddr_to_nla ((struct sockaddr*)&sock->send_addr, (char*)&opt_redirect->opt_nla_afi);
+
+	header->pgm_checksum	= 0;
+	header->pgm_checksum	= pgm_csum_fold (pgm_csum_partial (buf, (uint16_t)tpdu_length, 0));
+
+	sent = pgm_sendto_hops (sock,
+				FALSE,			/* not rate limited */
+				NULL,
+				FALSE,			/* regular socket */
+				hops,
+				header,
+				tpdu_length,
+				to,
+				pgm_sockaddr_len (to));
+	if (sent < 0 && PGM_LIKELY(PGM_SOCK_EAGAIN == pgm_get_last_sock_error()))
+		return FALSE;
+
+	sock->cumulative_stats[PGM_PC_SOURCE_BYTES_SENT] += (uint32_t)tpdu_length;
+	return TRUE;
+}
+
+/* eof */
@@ -0,0 +1,491 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * unit tests for the designated local repairer.
+ *
+ * Copyright (c) 2009-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#ifndef _WIN32
+#	include <arpa/inet.h>
+#endif
+#include <glib.h>
+#include <check.h>
+
+#ifdef _WIN32
+#	define PGM_CHECK_NOFORK		1
+#endif
+
+
+/* mock state */
+
+#define TEST_MAX_TPDU		1500
+#define TEST_DLR_SQNS		100
+#define TEST_NAK_BO_IVL		( pgm_msecs(50) )
+
+static int			mock_sendto_count = 0;
+static int			mock_sendto_hops;
+static bool			mock_sendto_router_alert;
+static uint8_t			mock_sendto_type;
+static struct sockaddr_storage	mock_sendto_addr;
+static char			mock_sendto_buf[TEST_MAX_TPDU];
+static size_t			mock_sendto_len;
+static struct sockaddr_storage	mock_nak_src;
+static bool			mock_is_rate_limited;
+static bool			mock_rate_is_nonblocking;
+
+
+#define pgm_verify_nak		mock_pgm_verify_nak
+#define pgm_sendto_hops		mock_pgm_sendto_hops
+#define pgm_rate_check2		mock_pgm_rate_check2
+#define pgm_compat_csum_partial	mock_pgm_compat_csum_partial
+#define pgm_csum_fold		mock_pgm_csum_fold
+
+#define DLR_DEBUG
+#include "dlr.c"
+
+
+static
+void
+mock_setup (void)
+{
+	if (!g_thread_supported ()) g_thread_init (NULL);
+	mock_sendto_count = 0;
+	mock_sendto_type = 0;
+	memset (&mock_sendto_addr, 0, sizeof(mock_sendto_addr));
+	mock_sendto_len = 0;
+	mock_is_rate_limited = FALSE;
+	mock_rate_is_nonblocking = FALSE;
+	memset (&mock_nak_src, 0, sizeof(mock_nak_src));
+	((struct sockaddr_in*)&mock_nak_src)->sin_family = AF_INET;
+	((struct sockaddr_in*)&mock_nak_src)->sin_addr.s_addr = inet_addr ("127.0.0.3");
+}
+
+static
+struct pgm_sock_t*
+generate_sock (void)
+{
+	struct pgm_sock_t* sock = g_new0 (struct pgm_sock_t, 1);
+	((struct sockaddr*)&sock->send_addr)->sa_family = AF_INET;
+	((struct sockaddr_in*)&sock->send_addr)->sin_addr.s_addr = inet_addr ("127.0.0.2");
+	((struct sockaddr*)&sock->recv_gsr[0].gsr_group)->sa_family = AF_INET;
+	((struct sockaddr_in*)&sock->recv_gsr[0].gsr_group)->sin_addr.s_addr = inet_addr ("239.192.0.1");
+	sock->recv_gsr_len = 1;
+	sock->max_tpdu = TEST_MAX_TPDU;
+	sock->nak_bo_ivl = TEST_NAK_BO_IVL;
+	sock->dlr_sqns = TEST_DLR_SQNS;
+	return sock;
+}
+
+static
+pgm_peer_t*
+generate_peer (void)
+{
+	pgm_peer_t* peer = g_new0 (pgm_peer_t, 1);
+	((struct sockaddr*)&peer->nla)->sa_family = AF_INET;
+	((struct sockaddr_in*)&peer->nla)->sin_addr.s_addr = inet_addr ("127.0.0.1");
+	peer->dlr = pgm_dlr_create (TEST_DLR_SQNS, TEST_MAX_TPDU);
+	return peer;
+}
+
+/* ODATA as presented by the receiver, data pointing at the payload.
+ */
+
+static
+struct pgm_sk_buff_t*
+generate_odata (
+	const uint32_t		sqn,
+	const uint16_t		options
+	)
+{
+	const char source[] = "i am not a string";
+	struct pgm_sk_buff_t* skb = pgm_alloc_skb (TEST_MAX_TPDU);
+	skb->pgm_header = pgm_skb_put (skb, sizeof(struct pgm_header));
+	skb->pgm_data = pgm_skb_put (skb, sizeof(struct pgm_data));
+	memset (skb->pgm_header, 0, sizeof(struct pgm_header) + sizeof(struct pgm_data));
+	skb->pgm_header->pgm_type = PGM_ODATA;
+	skb->pgm_header->pgm_options = (uint8_t)options;
+	skb->pgm_header->pgm_tsdu_length = g_htons (sizeof(source));
+	skb->pgm_data->data_sqn = g_htonl (sqn);
+	memcpy (pgm_skb_put (skb, sizeof(source)), source, sizeof(source));
+	skb->data = skb->pgm_data + 1;
+	skb->len = sizeof(source);
+	return skb;
+}
+
+/* NAK for sqn with a list of further sequences, data pointing at the NAK.
+ */
+
+static
+struct pgm_sk_buff_t*
+generate_nak (
+	const char*		group,
+	const uint32_t		sqn,
+	const uint32_t*		list,
+	const unsigned		list_len
+	)
+{
+	struct pgm_sk_buff_t* skb = pgm_alloc_skb (TEST_MAX_TPDU);
+	skb->pgm_header = pgm_skb_put (skb, sizeof(struct pgm_header));
+	struct pgm_nak* nak = pgm_skb_put (skb, sizeof(struct pgm_nak));
+	memset (skb->pgm_header, 0, sizeof(struct pgm_header) + sizeof(struct pgm_nak));
+	skb->pgm_header->pgm_type = PGM_NAK;
+	nak->nak_sqn = g_htonl (sqn);
+	struct sockaddr_in nla = {
+		.sin_family		= AF_INET,
+		.sin_addr.s_addr	= inet_addr ("127.0.0.1")
+	};
+	pgm_sockaddr_to_nla ((struct sockaddr*)&nla, (char*)&nak->nak_src_nla_afi);
+	nla.sin_addr.s_addr = inet_addr (group);
+	pgm_sockaddr_to_nla ((struct sockaddr*)&nla, (char*)&nak->nak_grp_nla_afi);
+	if (list_len > 0) {
+		skb->pgm_header->pgm_options = PGM_OPT_PRESENT | PGM_OPT_NETWORK;
+		struct pgm_opt_length* opt_len = pgm_skb_put (skb, sizeof(struct pgm_opt_length));
+		opt_len->opt_type = PGM_OPT_LENGTH;
+		opt_len->opt_length = sizeof(struct pgm_opt_length);
+		struct pgm_opt_header* opt_header = pgm_skb_put (skb, sizeof(struct pgm_opt_header));
+		opt_header->opt_type = PGM_OPT_NAK_LIST | PGM_OPT_END;
+		opt_header->opt_length = sizeof(struct pgm_opt_header) + sizeof(uint8_t) + list_len * sizeof(uint32_t);
+		opt_len->opt_total_length = g_htons (sizeof(struct pgm_opt_length) + opt_header->opt_length);
+		*(uint8_t*)pgm_skb_put (skb, sizeof(uint8_t)) = 0;
+		uint32_t* opt_sqn = pgm_skb_put (skb, list_len * sizeof(uint32_t));
+		for (unsigned i = 0; i < list_len; i++)
+			opt_sqn[i] = g_htonl (list[i]);
+	}
+	skb->data = nak;
+	skb->len = (uint16_t)((char*)skb->tail - (char*)nak);
+	skb->tstamp = pgm_secs(1);
+	return skb;
+}
+
+/** packet module */
+bool
+mock_pgm_verify_nak (
+	const struct pgm_sk_buff_t* const	skb
+	)
+{
+	return TRUE;
+}
+
+/** checksum module */
+uint32_t
+mock_pgm_compat_csum_partial (
+	const void*			addr,
+	uint16_t			len,
+	uint32_t			csum
+	)
+{
+	return 0x0;
+}
+
+uint16_t
+mock_pgm_csum_fold (
+	uint32_t			csum
+	)
+{
+	return 0x0;
+}
+
+/** rate control module */
+bool
+mock_pgm_rate_check2 (
+	pgm_rate_t*			major_bucket,
+	pgm_rate_t*			minor_bucket,
+	const size_t			data_size,
+	const bool			is_nonblocking
+	)
+{
+	mock_rate_is_nonblocking = is_nonblocking;
+	return !mock_is_rate_limited;
+}
+
+/** net module */
+ssize_t
+mock_pgm_sendto_hops (
+	pgm_sock_t*			sock,
+	bool				use_rate_limit,
+	pgm_rate_t*			minor_rate_control,
+	bool				use_router_alert,
+	int				level,
+	const void*			buf,
+	size_t				len,
+	const struct sockaddr*		to,
+	socklen_t			tolen
+	)
+{
+	mock_sendto_count++;
+	mock_sendto_hops = level;
+	mock_sendto_router_alert = use_router_alert;
+	mock_sendto_type = ((const struct pgm_header*)buf)->pgm_type;
+	memcpy (&mock_sendto_addr, to, tolen);
+	memcpy (mock_sendto_buf, buf, len);
+	mock_sendto_len = len;
+	return len;
+}
+
+
+/* target:
+ *	pgm_dlr_t*
+ *	pgm_dlr_create (
+ *		const unsigned		sqns,
+ *		const uint16_t		max_tpdu
+ *		)
+ */
+
+START_TEST (test_create_pass_001)
+{
+	pgm_dlr_t* dlr = pgm_dlr_create (TEST_DLR_SQNS, TEST_MAX_TPDU);
+	fail_if (NULL == dlr, "create failed");
+	fail_unless (127 == dlr->mask, "size not rounded");
+	pgm_dlr_destroy (dlr);
+}
+END_TEST
+
+START_TEST (test_create_fail_001)
+{
+	pgm_dlr_create (0, TEST_MAX_TPDU);
+	fail ("reached");
+}
+END_TEST
+
+/* target:
+ *	void
+ *	pgm_dlr_add (
+ *		pgm_dlr_t*			dlr,
+ *		const struct pgm_sk_buff_t*	skb
+ *		)
+ */
+
+START_TEST (test_add_pass_001)
+{
+	pgm_dlr_t* dlr = pgm_dlr_create (TEST_DLR_SQNS, TEST_MAX_TPDU);
+	struct pgm_sk_buff_t* skb = generate_odata (130, 0);
+	pgm_dlr_add (dlr, skb);
+	const struct pgm_dlr_slot_t* slot = &dlr->slots[ 130 & dlr->mask ];
+	fail_unless (130 == slot->sqn, "sqn not cached");
+	fail_unless ((char*)skb->tail - (char*)skb->pgm_header == slot->len, "length mismatch");
+	fail_unless (0 == memcmp (slot->tpdu, skb->pgm_header, slot->len), "contents mismatch");
+	pgm_free_skb (skb);
+	pgm_dlr_destroy (dlr);
+}
+END_TEST
+
+/* parity is not cached */
+START_TEST (test_add_pass_002)
+{
+	pgm_dlr_t* dlr = pgm_dlr_create (TEST_DLR_SQNS, TEST_MAX_TPDU);
+	struct pgm_sk_buff_t* skb = generate_odata (130, PGM_OPT_PARITY);
+	pgm_dlr_add (dlr, skb);
+	fail_unless (0 == dlr->slots[ 130 & dlr->mask ].len, "parity cached");
+	pgm_free_skb (skb);
+	pgm_dlr_destroy (dlr);
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_dlr_on_nak (
+ *		pgm_sock_t*		sock,
+ *		pgm_peer_t*		source,
+ *		struct pgm_sk_buff_t*	skb,
+ *		const struct sockaddr*	from
+ *		)
+ */
+
+/* cached sequence repaired once to the group with TTL 1 */
+START_TEST (test_on_nak_pass_001)
+{
+	pgm_sock_t* sock = generate_sock();
+	pgm_peer_t* peer = generate_peer();
+	struct pgm_sk_buff_t* odata = generate_odata (10, 0);
+	pgm_dlr_add (peer->dlr, odata);
+	struct pgm_sk_buff_t* skb = generate_nak ("239.192.0.1", 10, NULL, 0);
+	fail_unless (TRUE == pgm_dlr_on_nak (sock, peer, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	fail_unless (1 == mock_sendto_count, "not repaired");
+	fail_unless (PGM_RDATA == mock_sendto_type, "not RDATA");
+	fail_unless (1 == mock_sendto_hops, "not subnet scoped");
+	fail_unless (0 == pgm_sockaddr_cmp ((struct sockaddr*)&mock_sendto_addr, (struct sockaddr*)&sock->recv_gsr[0].gsr_group), "not to group");
+	fail_unless (1 == peer->cumulative_stats[PGM_PC_RECEIVER_DLR_REPAIRS_SENT], "repairs not counted");
+/* second NAK of the same loss */
+	skb->tstamp += TEST_NAK_BO_IVL / 2;
+	fail_unless (TRUE == pgm_dlr_on_nak (sock, peer, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	fail_unless (1 == mock_sendto_count, "repaired twice");
+	skb->tstamp += TEST_NAK_BO_IVL;
+	fail_unless (TRUE == pgm_dlr_on_nak (sock, peer, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	fail_unless (2 == mock_sendto_count, "not repaired again");
+}
+END_TEST
+
+/* sequences not cached are forwarded to the source in one NAK */
+START_TEST (test_on_nak_pass_002)
+{
+	const uint32_t list[] = { 11, 12 };
+	pgm_sock_t* sock = generate_sock();
+	pgm_peer_t* peer = generate_peer();
+	struct pgm_sk_buff_t* odata = generate_odata (11, 0);
+	pgm_dlr_add (peer->dlr, odata);
+	struct pgm_sk_buff_t* skb = generate_nak ("239.192.0.1", 10, list, G_N_ELEMENTS(list));
+	fail_unless (TRUE == pgm_dlr_on_nak (sock, peer, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	fail_unless (2 == mock_sendto_count, "send count");
+	fail_unless (PGM_NAK == mock_sendto_type, "not NAK");
+	fail_unless (TRUE == mock_sendto_router_alert, "no router alert");
+	fail_unless (0 == pgm_sockaddr_cmp ((struct sockaddr*)&mock_sendto_addr, (struct sockaddr*)&peer->nla), "not to source");
+	fail_unless (1 == peer->cumulative_stats[PGM_PC_RECEIVER_DLR_REPAIRS_SENT], "repairs not counted");
+	fail_unless (1 == peer->cumulative_stats[PGM_PC_RECEIVER_DLR_NAKS_FORWARDED], "forward not counted");
+}
+END_TEST
+
+/* a forwarded NAK names the receiver that asked */
+START_TEST (test_on_nak_pass_003)
+{
+	pgm_sock_t* sock = generate_sock();
+	pgm_peer_t* peer = generate_peer();
+	struct pgm_sk_buff_t* skb = generate_nak ("239.192.0.1", 10, NULL, 0);
+	fail_unless (TRUE == pgm_dlr_on_nak (sock, peer, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	fail_unless (1 == mock_sendto_count, "not forwarded");
+	fail_unless (PGM_NAK == mock_sendto_type, "not NAK");
+	const struct pgm_header* header = (const struct pgm_header*)mock_sendto_buf;
+	fail_unless (header->pgm_options & PGM_OPT_PRESENT, "no options");
+	const struct pgm_nak* nak = (const struct pgm_nak*)(header + 1);
+	fail_unless (10 == g_ntohl (nak->nak_sqn), "sqn mismatch");
+	const struct pgm_opt_length* opt_len = (const struct pgm_opt_length*)(nak + 1);
+	fail_unless (PGM_OPT_LENGTH == opt_len->opt_type, "no OPT_LENGTH");
+	fail_unless (mock_sendto_len == sizeof(struct pgm_header) + sizeof(struct pgm_nak) + g_ntohs (opt_len->opt_total_length), "total length mismatch");
+	const struct pgm_opt_header* opt_header = (const struct pgm_opt_header*)(opt_len + 1);
+	fail_unless ((PGM_OPT_PATH_NLA | PGM_OPT_END) == opt_header->opt_type, "no OPT_PATH_NLA");
+	fail_unless (sizeof(struct pgm_opt_header) + sizeof(struct pgm_opt_path_nla) == opt_header->opt_length, "option length");
+	const struct pgm_opt_path_nla* opt_path_nla = (const struct pgm_opt_path_nla*)(opt_header + 1);
+	fail_unless (inet_addr ("127.0.0.3") == opt_path_nla->opt_path_nla.s_addr, "requester mismatch");
+}
+END_TEST
+
+/* repairs beyond the RDATA rate are dropped without blocking */
+START_TEST (test_on_nak_pass_004)
+{
+	pgm_sock_t* sock = generate_sock();
+	sock->is_controlled_rdata = TRUE;
+	pgm_peer_t* peer = generate_peer();
+	struct pgm_sk_buff_t* odata = generate_odata (10, 0);
+	pgm_dlr_add (peer->dlr, odata);
+	struct pgm_sk_buff_t* skb = generate_nak ("239.192.0.1", 10, NULL, 0);
+	mock_is_rate_limited = TRUE;
+	fail_unless (TRUE == pgm_dlr_on_nak (sock, peer, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	fail_unless (0 == mock_sendto_count, "sent over rate");
+	fail_unless (TRUE == mock_rate_is_nonblocking, "rate check blocks");
+	fail_unless (0 == peer->cumulative_stats[PGM_PC_RECEIVER_DLR_REPAIRS_SENT], "repair counted");
+/* not marked as repaired, the next NAK is answered */
+	mock_is_rate_limited = FALSE;
+	fail_unless (TRUE == pgm_dlr_on_nak (sock, peer, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	fail_unless (1 == mock_sendto_count, "not repaired");
+}
+END_TEST
+
+START_TEST (test_on_nak_fail_001)
+{
+	pgm_sock_t* sock = generate_sock();
+	pgm_peer_t* peer = generate_peer();
+	struct pgm_sk_buff_t* skb = generate_nak ("239.192.0.2", 10, NULL, 0);
+	fail_unless (FALSE == pgm_dlr_on_nak (sock, peer, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	fail_unless (0 == mock_sendto_count, "sent on group mismatch");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_dlr_send_polr (
+ *		pgm_sock_t*		sock,
+ *		pgm_peer_t*		source,
+ *		const struct sockaddr*	to,
+ *		const int		hops
+ *		)
+ */
+
+START_TEST (test_send_polr_pass_001)
+{
+	pgm_sock_t* sock = generate_sock();
+	pgm_peer_t* peer = generate_peer();
+	fail_unless (TRUE == pgm_dlr_send_polr (sock, peer, (struct sockaddr*)&sock->recv_gsr[0].gsr_group, 1), "send_polr failed");
+	fail_unless (1 == mock_sendto_count, "not sent");
+	fail_unless (PGM_POLR == mock_sendto_type, "not POLR");
+	fail_unless (1 == mock_sendto_hops, "not subnet scoped");
+}
+END_TEST
+
+
+static
+Suite*
+make_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create (__FILE__);
+
+	TCase* tc_create = tcase_create ("create");
+	suite_add_tcase (s, tc_create);
+	tcase_add_checked_fixture (tc_create, mock_setup, NULL);
+	tcase_add_test (tc_create, test_create_pass_001);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_create, test_create_fail_001, SIGABRT);
+#endif
+
+	TCase* tc_add = tcase_create ("add");
+	suite_add_tcase (s, tc_add);
+	tcase_add_checked_fixture (tc_add, mock_setup, NULL);
+	tcase_add_test (tc_add, test_add_pass_001);
+	tcase_add_test (tc_add, test_add_pass_002);
+
+	TCase* tc_on_nak = tcase_create ("on-nak");
+	suite_add_tcase (s, tc_on_nak);
+	tcase_add_checked_fixture (tc_on_nak, mock_setup, NULL);
+	tcase_add_test (tc_on_nak, test_on_nak_pass_001);
+	tcase_add_test (tc_on_nak, test_on_nak_pass_002);
+	tcase_add_test (tc_on_nak, test_on_nak_pass_003);
+	tcase_add_test (tc_on_nak, test_on_nak_pass_004);
+	tcase_add_test (tc_on_nak, test_on_nak_fail_001);
+
+	TCase* tc_send_polr = tcase_create ("send-polr");
+	suite_add_tcase (s, tc_send_polr);
+	tcase_add_checked_fixture (tc_send_polr, mock_setup, NULL);
+	tcase_add_test (tc_send_polr, test_send_polr_pass_001);
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	pgm_messages_init();
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_test_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	pgm_messages_shutdown();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
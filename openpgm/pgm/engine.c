@@ -47,6 +47,7 @@
 #include <impl/framework.h>
 #include <impl/engine.h>
 #include <impl/mem.h>
+#include <impl/shmstats.h>
 #include <impl/socket.h>
 #include <pgm/engine.h>
 #include <pgm/version.h>
@@ -62,7 +63,7 @@ int			pgm_ipproto_pgm PGM_GNUC_READ_MOSTLY = IPPROTO_PGM;
 LPFN_WSARECVMSG		pgm_WSARecvMsg PGM_GNUC_READ_MOSTLY = NULL;
 #endif
 
-#ifdef PGM_DEBUG
+#if defined(PGM_DEBUG) || defined(USE_LOSS_SIMULATION)
 unsigned		pgm_loss_rate PGM_GNUC_READ_MOSTLY = 0;
 #endif
 
@@ -190,11 +191,12 @@ pgm_init (
 		goto err_shutdown;
 	}
 
-/* receiver simulated loss rate */
-#ifdef PGM_DEBUG
+/* receiver simulated loss rate, release builds require USE_LOSS_SIMULATION */
+#if defined(PGM_DEBUG) || defined(USE_LOSS_SIMULATION)
 	char* env;
 	size_t envlen;
 
+	pgm_loss_rate = 0;
 	const errno_t err = pgm_dupenv_s (&env, &envlen, "PGM_LOSS_RATE");
 	if (0 == err && envlen > 0) {
 		const int loss_rate = atoi (env);
@@ -206,6 +208,18 @@ pgm_init (
 	}
 #endif
 
+/* per-thread latency histograms */
+	pgm_latency_init();
+
+/* protocol event trace ring */
+	pgm_probe_init();
+
+/* shared SPM thread, started by the first socket using it */
+	pgm_spm_scheduler_init();
+
+/* statistics segment, started on request */
+	pgm_shmstats_lock_init();
+
 /* create global sock list lock */
 	pgm_rwlock_init (&pgm_sock_list_lock);
 
@@ -255,6 +269,10 @@ pgm_shutdown (void)
 
 	pgm_rwlock_free (&pgm_sock_list_lock);
 
+	pgm_shmstats_lock_free();
+	pgm_spm_scheduler_shutdown();
+	pgm_probe_shutdown();
+	pgm_latency_shutdown();
 	pgm_time_shutdown();
 
 #ifdef _WIN32
@@ -0,0 +1,724 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Protocol engine thread, an optional per-socket thread that drives packet
+ * processing, timers, NAK repairs and SPM heartbeats independently of the
+ * application and hands completed APDUs over through a lock-free queue.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#ifndef _GNU_SOURCE
+#	define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#ifndef _WIN32
+#	include <sched.h>
+#	ifdef HAVE_POLL
+#		include <poll.h>
+#	endif
+#else
+#	include <process.h>
+#endif
+#include <impl/i18n.h>
+#include <impl/framework.h>
+#include <impl/socket.h>
+#include <impl/timer.h>
+#include <impl/engine_thread.h>
+
+
+//#define ENGINE_THREAD_DEBUG
+
+/* queue capacity in APDUs, must be a power of two */
+#define PGM_ENGINE_QUEUE_LEN	1024
+
+/* maximum APDUs taken from the receive windows per pass */
+#define PGM_ENGINE_MSGV_LEN	64
+
+/* back off after a receive error, a persistent socket error would otherwise
+ * either spin or park the thread with protocol timers outstanding.
+ */
+#define PGM_ENGINE_ERROR_RETRY	( pgm_msecs(10) )
+
+struct pgm_engine_slot_t {
+	struct pgm_msgv_t		msgv;
+	int				status;			/* RESET or LOSS, msgv holds a notice skb */
+};
+
+struct pgm_engine_thread_t {
+	pgm_sock_t*			sock;
+	int				cpu;			/* -1 = unbound */
+#ifndef _WIN32
+	pthread_t			thread;
+#else
+	HANDLE				thread;
+	unsigned			thread_id;
+#endif
+	pgm_notify_t			wake_notify;		/* application to engine */
+	pgm_notify_t			deliver_notify;		/* engine to application */
+	volatile uint32_t		is_terminated;
+
+/* producer, engine thread only */
+	volatile uint32_t		tail;
+	bool				is_aborted;		/* reset with abort-on-reset */
+	struct pgm_msgv_t		held_reset;		/* reset awaiting a free slot */
+	bool				has_held_reset;
+
+	struct pgm_engine_slot_t	slots[PGM_ENGINE_QUEUE_LEN];
+
+/* consumer, serialised by consumer_mutex */
+	volatile uint32_t		head;
+	pgm_mutex_t			consumer_mutex;
+	bool				is_reset;		/* sticky abort-on-reset */
+	pgm_tsi_t			reset_tsi;
+	struct pgm_sk_buff_t**		committed;		/* delivered on last call */
+	unsigned			committed_len;
+	unsigned			committed_alloc;
+};
+
+#ifndef _WIN32
+static void* pgm_engine_thread_routine (void*);
+#else
+static unsigned __stdcall pgm_engine_thread_routine (void*);
+#endif
+
+
+/* spawn the engine thread for sock, optionally bound to cpu.
+ *
+ * called from pgm_connect() with the socket write lock held, the thread
+ * starts processing once the lock is released.
+ *
+ * returns NULL on failure with error set.
+ */
+
+PGM_GNUC_INTERNAL
+pgm_engine_thread_t*
+pgm_engine_thread_create (
+	pgm_sock_t*   const restrict sock,
+	const int		     cpu,
+	pgm_error_t**	    restrict error
+	)
+{
+	pgm_engine_thread_t* engine;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+
+	pgm_debug ("pgm_engine_thread_create (sock:%p cpu:%d error:%p)",
+		(const void*)sock, cpu, (const void*)error);
+
+	engine = pgm_new0 (pgm_engine_thread_t, 1);
+	engine->sock = sock;
+	engine->cpu  = cpu;
+	pgm_mutex_init (&engine->consumer_mutex);
+
+	if (0 != pgm_notify_init (&engine->wake_notify)) {
+		const int save_errno = pgm_get_last_sock_error();
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_sock_errno (save_errno),
+			     _("Creating engine notification channel: %s"),
+			     pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		goto err_free;
+	}
+	if (0 != pgm_notify_init (&engine->deliver_notify)) {
+		const int save_errno = pgm_get_last_sock_error();
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_sock_errno (save_errno),
+			     _("Creating engine notification channel: %s"),
+			     pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		goto err_destroy_wake;
+	}
+
+#ifndef _WIN32
+	const int status = pthread_create (&engine->thread, NULL, &pgm_engine_thread_routine, engine);
+	if (0 != status) {
+		const int save_errno = status;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_errno (save_errno),
+			     _("Creating engine thread: %s"),
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		goto err_cleanup;
+	}
+#else
+	engine->thread = (HANDLE)_beginthreadex (NULL, 0, &pgm_engine_thread_routine, engine, 0, &engine->thread_id);
+	if (0 == engine->thread) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_errno (save_errno),
+			     _("Creating engine thread: %s"),
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		goto err_cleanup;
+	}
+#endif /* _WIN32 */
+	return engine;
+
+err_cleanup:
+	pgm_notify_destroy (&engine->deliver_notify);
+err_destroy_wake:
+	pgm_notify_destroy (&engine->wake_notify);
+err_free:
+	pgm_mutex_free (&engine->consumer_mutex);
+	pgm_free (engine);
+	return NULL;
+}
+
+/* terminate and join the engine thread, then wake any application thread
+ * blocked waiting for data.  the socket must already be flagged destroyed.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_engine_thread_stop (
+	pgm_engine_thread_t* const engine
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != engine);
+
+	pgm_debug ("pgm_engine_thread_stop (engine:%p)", (const void*)engine);
+
+	pgm_atomic_write32 (&engine->is_terminated, 1);
+	pgm_notify_send (&engine->wake_notify);
+#ifndef _WIN32
+	pthread_join (engine->thread, NULL);
+#else
+	WaitForSingleObject (engine->thread, INFINITE);
+	CloseHandle (engine->thread);
+#endif
+	pgm_notify_send (&engine->deliver_notify);
+}
+
+/* release queued and delivered buffers, called once no application thread
+ * can reference the socket.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_engine_thread_destroy (
+	pgm_engine_thread_t* const engine
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != engine);
+
+	pgm_debug ("pgm_engine_thread_destroy (engine:%p)", (const void*)engine);
+
+	while (engine->head != engine->tail) {
+		struct pgm_engine_slot_t* slot = &engine->slots[ engine->head++ & (PGM_ENGINE_QUEUE_LEN - 1) ];
+		for (unsigned i = 0; i < slot->msgv.msgv_len; i++)
+			pgm_free_skb (slot->msgv.msgv_skb[i]);
+	}
+	if (engine->has_held_reset)
+		pgm_free_skb (engine->held_reset.msgv_skb[0]);
+	for (unsigned i = 0; i < engine->committed_len; i++)
+		pgm_free_skb (engine->committed[i]);
+	pgm_free (engine->committed);
+	pgm_notify_destroy (&engine->deliver_notify);
+	pgm_notify_destroy (&engine->wake_notify);
+	pgm_mutex_free (&engine->consumer_mutex);
+	pgm_free (engine);
+}
+
+/* returns TRUE if called from the engine thread itself.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_engine_thread_is_current (
+	const pgm_engine_thread_t* const engine
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != engine);
+
+#ifndef _WIN32
+	return pthread_equal (engine->thread, pthread_self());
+#else
+	return engine->thread_id == GetCurrentThreadId();
+#endif
+}
+
+/* returns the application facing notification, readable whilst data is queued.
+ */
+
+PGM_GNUC_INTERNAL
+SOCKET
+pgm_engine_thread_get_socket (
+	pgm_engine_thread_t* const engine
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != engine);
+
+	return pgm_notify_get_socket (&engine->deliver_notify);
+}
+
+/* bind calling thread to the configured processor.
+ */
+
+static
+void
+_pgm_engine_thread_bind (
+	pgm_engine_thread_t* const engine
+	)
+{
+	if (engine->cpu < 0)
+		return;
+#if defined( CPU_SETSIZE )
+	cpu_set_t cpu_set;
+	CPU_ZERO (&cpu_set);
+	if (engine->cpu < CPU_SETSIZE) {
+		CPU_SET (engine->cpu, &cpu_set);
+		if (0 == pthread_setaffinity_np (pthread_self(), sizeof (cpu_set), &cpu_set)) {
+			pgm_minor (_("Engine thread bound to CPU %d."), engine->cpu);
+			return;
+		}
+	}
+#elif defined( _WIN32 )
+	if (engine->cpu < (int)(sizeof (DWORD_PTR) * 8) &&
+	    0 != SetThreadAffinityMask (GetCurrentThread(), (DWORD_PTR)1 << engine->cpu))
+	{
+		pgm_minor (_("Engine thread bound to CPU %d."), engine->cpu);
+		return;
+	}
+#endif
+	pgm_warn (_("Unable to bind engine thread to CPU %d."), engine->cpu);
+}
+
+/* append one APDU to the queue taking a reference on each buffer, the error
+ * skb of a reset or the notice skb of a loss is handed over as-is.
+ */
+
+static
+void
+_pgm_engine_thread_push (
+	pgm_engine_thread_t*	 const restrict engine,
+	const struct pgm_msgv_t* const restrict msgv,
+	const int				status
+	)
+{
+	const bool is_notice = PGM_IO_STATUS_NORMAL != status;
+	struct pgm_engine_slot_t* slot = &engine->slots[ engine->tail & (PGM_ENGINE_QUEUE_LEN - 1) ];
+
+	pgm_assert (PGM_ENGINE_QUEUE_LEN != engine->tail - pgm_atomic_read32 (&engine->head));
+
+	slot->msgv.msgv_len = msgv->msgv_len;
+	for (unsigned i = 0; i < msgv->msgv_len; i++)
+		slot->msgv.msgv_skb[i] = is_notice ? msgv->msgv_skb[i] : pgm_skb_get (msgv->msgv_skb[i]);
+	slot->status = status;
+
+/* locked increment publishes the slot contents before the new tail */
+	if (pgm_atomic_exchange_and_add32 (&engine->tail, 1) == pgm_atomic_read32 (&engine->head))
+		pgm_notify_send (&engine->deliver_notify);
+}
+
+/* block until network, timer, repair or application activity.  pending
+ * window data is ignored whilst the queue is full.
+ */
+
+static
+void
+_pgm_engine_thread_wait (
+	pgm_engine_thread_t* const engine,
+	const bool		   has_space,
+	const long		   timeout		/* μs, -1 = infinite */
+	)
+{
+	pgm_sock_t* sock = engine->sock;
+
+#ifdef HAVE_POLL
+	struct pollfd fds[4];
+	int n_fds = 0;
+
+	memset (fds, 0, sizeof (fds));
+	fds[n_fds].fd = sock->recv_sock;
+	fds[n_fds++].events = POLLIN;
+	if (sock->can_send_data) {
+		fds[n_fds].fd = pgm_notify_get_socket (&sock->rdata_notify);
+		fds[n_fds++].events = POLLIN;
+	}
+	if (has_space && sock->can_recv_data) {
+		fds[n_fds].fd = pgm_notify_get_socket (&sock->pending_notify);
+		fds[n_fds++].events = POLLIN;
+	}
+	fds[n_fds].fd = pgm_notify_get_socket (&engine->wake_notify);
+	fds[n_fds++].events = POLLIN;
+/* round up so that a sub-millisecond timer does not spin */
+	poll (fds, n_fds, timeout < 0 ? -1 : (int)((timeout + 999) / 1000));
+#else
+	fd_set readfds;
+	int n_fds = 0;
+	SOCKET fd;
+
+	FD_ZERO(&readfds);
+	FD_SET(sock->recv_sock, &readfds);
+	n_fds = (int)sock->recv_sock + 1;
+	if (sock->can_send_data) {
+		fd = pgm_notify_get_socket (&sock->rdata_notify);
+		FD_SET(fd, &readfds);
+		n_fds = MAX(n_fds, (int)fd + 1);
+	}
+	if (has_space && sock->can_recv_data) {
+		fd = pgm_notify_get_socket (&sock->pending_notify);
+		FD_SET(fd, &readfds);
+		n_fds = MAX(n_fds, (int)fd + 1);
+	}
+	fd = pgm_notify_get_socket (&engine->wake_notify);
+	FD_SET(fd, &readfds);
+	n_fds = MAX(n_fds, (int)fd + 1);
+	struct timeval tv_timeout = {
+		.tv_sec		= timeout / 1000000L,
+		.tv_usec	= timeout % 1000000L
+	};
+	select (n_fds, &readfds, NULL, NULL, timeout < 0 ? NULL : &tv_timeout);
+#endif /* HAVE_POLL */
+	pgm_notify_clear (&engine->wake_notify);
+}
+
+/* engine thread: run the receive path non-blocking into the queue and sleep
+ * on the socket's events in between.  when the queue is full the receive
+ * path still runs without delivering so that NAKs, repairs and SPMs continue.
+ */
+
+#ifndef _WIN32
+static
+void*
+#else
+static
+unsigned
+__stdcall
+#endif
+pgm_engine_thread_routine (
+	void*		arg
+	)
+{
+	pgm_engine_thread_t* engine = (pgm_engine_thread_t*)arg;
+	pgm_sock_t* sock = engine->sock;
+	struct pgm_msgv_t msgv[ PGM_ENGINE_MSGV_LEN ];
+
+/* wait for pgm_connect() to complete */
+	pgm_rwlock_reader_lock (&sock->lock);
+	pgm_rwlock_reader_unlock (&sock->lock);
+
+	_pgm_engine_thread_bind (engine);
+
+	while (!pgm_atomic_read32 (&engine->is_terminated))
+	{
+		uint32_t free_slots = PGM_ENGINE_QUEUE_LEN - (engine->tail - pgm_atomic_read32 (&engine->head));
+		pgm_error_t* err = NULL;
+		size_t bytes_read = 0;
+		long timeout = -1;
+		int status;
+
+		if (engine->has_held_reset && free_slots > 0) {
+			_pgm_engine_thread_push (engine, &engine->held_reset, PGM_IO_STATUS_RESET);
+			engine->has_held_reset = FALSE;
+			free_slots--;
+		}
+
+		if (PGM_UNLIKELY(engine->is_aborted)) {
+/* receive side is permanently reset, nothing further to deliver */
+			_pgm_engine_thread_wait (engine, FALSE, -1);
+			continue;
+		}
+
+		const size_t msg_len = MIN(free_slots, PGM_ENGINE_MSGV_LEN);
+		for (size_t i = 0; i < msg_len; i++)
+			msgv[i].msgv_len = 0;
+		status = pgm_recvmsgv (sock, msgv, msg_len, MSG_DONTWAIT | MSG_ERRQUEUE, &bytes_read, &err);
+		switch (status) {
+		case PGM_IO_STATUS_NORMAL:
+			for (size_t i = 0; i < msg_len && msgv[i].msgv_len > 0; i++)
+				_pgm_engine_thread_push (engine, &msgv[i], PGM_IO_STATUS_NORMAL);
+			continue;
+
+		case PGM_IO_STATUS_RESET:
+			if (free_slots > 0)
+				_pgm_engine_thread_push (engine, &msgv[0], PGM_IO_STATUS_RESET);
+			else if (!engine->has_held_reset) {
+				engine->held_reset = msgv[0];
+				engine->has_held_reset = TRUE;
+			} else {
+				pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Engine queue full, coalescing session reset."));
+				pgm_free_skb (msgv[0].msgv_skb[0]);
+			}
+			if (sock->is_abort_on_reset)
+				engine->is_aborted = TRUE;
+			continue;
+
+		case PGM_IO_STATUS_LOSS:
+/* msg_len is bounded by the free slots */
+			for (size_t i = 0; i < msg_len && msgv[i].msgv_len > 0; i++)
+				_pgm_engine_thread_push (engine, &msgv[i], PGM_IO_STATUS_LOSS);
+			continue;
+
+		case PGM_IO_STATUS_TIMER_PENDING:
+			timeout = (long)pgm_timer_expiration (sock, pgm_time_sample());
+			break;
+
+		case PGM_IO_STATUS_RATE_LIMITED:
+			timeout = (long)pgm_rate_remaining2 (&sock->rate_control, &sock->odata_rate_control, sock->blocklen);
+			break;
+
+		case PGM_IO_STATUS_WOULD_BLOCK:
+			break;
+
+		case PGM_IO_STATUS_EOF:
+			goto out;
+
+		case PGM_IO_STATUS_ERROR:
+		default:
+			if (NULL != err) {
+				pgm_trace (PGM_LOG_ROLE_NETWORK,_("Engine receive: %s"), err->message);
+				pgm_error_free (err);
+			}
+			if (sock->is_destroyed)
+				goto out;
+			timeout = (long)PGM_ENGINE_ERROR_RETRY;
+			break;
+		}
+
+		_pgm_engine_thread_wait (engine, free_slots > 0, timeout);
+	}
+
+out:
+	pgm_notify_send (&engine->deliver_notify);
+#ifndef _WIN32
+	return NULL;
+#else
+	_endthread();
+	return 0;
+#endif
+}
+
+/* application side: block on the delivery notification.
+ */
+
+static
+void
+_pgm_engine_thread_wait_deliver (
+	pgm_engine_thread_t* const engine
+	)
+{
+	const SOCKET fd = pgm_notify_get_socket (&engine->deliver_notify);
+#ifdef HAVE_POLL
+	struct pollfd fds[1];
+	memset (fds, 0, sizeof (fds));
+	fds[0].fd = fd;
+	fds[0].events = POLLIN;
+	poll (fds, 1, -1);
+#else
+	fd_set readfds;
+	FD_ZERO(&readfds);
+	FD_SET(fd, &readfds);
+	select ((int)fd + 1, &readfds, NULL, NULL, NULL);
+#endif
+}
+
+/* remember a buffer handed to the application, released on the next call.
+ */
+
+static inline
+void
+_pgm_engine_thread_commit (
+	pgm_engine_thread_t*  const restrict engine,
+	struct pgm_sk_buff_t* const restrict skb
+	)
+{
+	if (PGM_UNLIKELY(engine->committed_len == engine->committed_alloc)) {
+		engine->committed_alloc = engine->committed_alloc ? engine->committed_alloc * 2 : PGM_ENGINE_MSGV_LEN;
+		engine->committed = pgm_realloc (engine->committed, engine->committed_alloc * sizeof (struct pgm_sk_buff_t*));
+	}
+	engine->committed[ engine->committed_len++ ] = skb;
+}
+
+static inline
+void
+_pgm_engine_thread_pop (
+	pgm_engine_thread_t* const engine
+	)
+{
+	const bool was_full = (PGM_ENGINE_QUEUE_LEN == pgm_atomic_read32 (&engine->tail) - engine->head);
+/* locked increment retires slot reads before the producer may reuse it */
+	pgm_atomic_inc32 (&engine->head);
+	if (was_full)
+		pgm_notify_send (&engine->wake_notify);
+}
+
+static
+void
+_pgm_engine_thread_set_reset_error (
+	const pgm_tsi_t*     const restrict tsi,
+	pgm_error_t**	 	   restrict error
+	)
+{
+	char tsi_string[PGM_TSISTRLEN];
+
+	if (NULL == error)
+		return;
+	pgm_tsi_print_r (tsi, tsi_string, sizeof (tsi_string));
+	pgm_set_error (error,
+		     PGM_ERROR_DOMAIN_RECV,
+		     PGM_ERROR_CONNRESET,
+		     _("Transport has been reset on unrecoverable loss from %s."),
+		     tsi_string);
+}
+
+/* pgm_recvmsgv() for application threads when the engine thread is running,
+ * APDUs are taken from the queue and remain valid until the next call.
+ */
+
+PGM_GNUC_INTERNAL
+int
+pgm_engine_thread_recvmsgv (
+	pgm_engine_thread_t* const restrict engine,
+	struct pgm_msgv_t*   const restrict msg_start,
+	const size_t			    msg_len,
+	const int			    flags,		/* MSG_DONTWAIT for non-blocking */
+	size_t*			   restrict _bytes_read,	/* may be NULL */
+	pgm_error_t**		   restrict error
+	)
+{
+	pgm_sock_t* sock;
+	size_t bytes_read = 0;
+	size_t data_read = 0;
+	int status = PGM_IO_STATUS_NORMAL;
+
+/* pre-conditions */
+	pgm_assert (NULL != engine);
+	pgm_assert (msg_len > 0);
+	pgm_assert (NULL != msg_start);
+
+	sock = engine->sock;
+	pgm_mutex_lock (&engine->consumer_mutex);
+
+/* release buffers delivered by the previous call */
+	for (unsigned i = 0; i < engine->committed_len; i++)
+		pgm_free_skb (engine->committed[i]);
+	engine->committed_len = 0;
+
+	if (PGM_UNLIKELY(engine->is_reset)) {
+		_pgm_engine_thread_set_reset_error (&engine->reset_tsi, error);
+		status = PGM_IO_STATUS_RESET;
+		goto out;
+	}
+
+	for (;;)
+	{
+		struct pgm_engine_slot_t* slot;
+
+		if (engine->head == pgm_atomic_read32 (&engine->tail)) {
+			if (data_read > 0)
+				break;
+			if (sock->is_destroyed || pgm_atomic_read32 (&engine->is_terminated)) {
+				status = PGM_IO_STATUS_EOF;
+				goto out;
+			}
+			if (sock->is_nonblocking || flags & MSG_DONTWAIT) {
+				status = PGM_IO_STATUS_WOULD_BLOCK;
+				goto out;
+			}
+			_pgm_engine_thread_wait_deliver (engine);
+			pgm_notify_clear (&engine->deliver_notify);
+			continue;
+		}
+
+		slot = &engine->slots[ engine->head & (PGM_ENGINE_QUEUE_LEN - 1) ];
+		if (PGM_UNLIKELY(PGM_IO_STATUS_RESET == slot->status)) {
+/* report loss on the next call */
+			if (data_read > 0)
+				break;
+			struct pgm_sk_buff_t* error_skb = slot->msgv.msgv_skb[0];
+			if (sock->is_abort_on_reset) {
+				engine->is_reset = TRUE;
+				memcpy (&engine->reset_tsi, &error_skb->tsi, sizeof (pgm_tsi_t));
+			}
+			if (flags & MSG_ERRQUEUE) {
+/* ownership of the error skb passes to the application */
+				msg_start[0].msgv_len	 = 1;
+				msg_start[0].msgv_skb[0] = error_skb;
+			} else {
+				_pgm_engine_thread_set_reset_error (&error_skb->tsi, error);
+				pgm_free_skb (error_skb);
+			}
+			_pgm_engine_thread_pop (engine);
+			status = PGM_IO_STATUS_RESET;
+			goto out;
+		}
+
+		if (PGM_UNLIKELY(PGM_IO_STATUS_LOSS == slot->status)) {
+/* report loss on the next call */
+			if (data_read > 0)
+				break;
+			size_t msgs = 0;
+			do {
+				struct pgm_sk_buff_t* notice_skb = slot->msgv.msgv_skb[0];
+				if (flags & MSG_ERRQUEUE) {
+/* ownership of the notice skb passes to the application */
+					msg_start[msgs].msgv_len    = 1;
+					msg_start[msgs].msgv_skb[0] = notice_skb;
+				} else
+					pgm_free_skb (notice_skb);
+				msgs++;
+				_pgm_engine_thread_pop (engine);
+				slot = &engine->slots[ engine->head & (PGM_ENGINE_QUEUE_LEN - 1) ];
+			} while (msgs < msg_len &&
+				 engine->head != pgm_atomic_read32 (&engine->tail) &&
+				 PGM_IO_STATUS_LOSS == slot->status);
+			status = PGM_IO_STATUS_LOSS;
+			goto out;
+		}
+
+		struct pgm_msgv_t* msgv = &msg_start[ data_read++ ];
+		msgv->msgv_len = slot->msgv.msgv_len;
+		for (unsigned i = 0; i < slot->msgv.msgv_len; i++) {
+			struct pgm_sk_buff_t* skb = slot->msgv.msgv_skb[i];
+			msgv->msgv_skb[i] = skb;
+			bytes_read += skb->len;
+			_pgm_engine_thread_commit (engine, skb);
+		}
+		_pgm_engine_thread_pop (engine);
+		if (data_read == msg_len)
+			break;
+	}
+
+out:
+/* readable whilst the queue is non-empty */
+	if (engine->head == pgm_atomic_read32 (&engine->tail)) {
+		pgm_notify_clear (&engine->deliver_notify);
+		if (engine->head != pgm_atomic_read32 (&engine->tail))
+			pgm_notify_send (&engine->deliver_notify);
+	}
+	pgm_mutex_unlock (&engine->consumer_mutex);
+	if (PGM_IO_STATUS_NORMAL == status && NULL != _bytes_read)
+		*_bytes_read = bytes_read;
+	return status;
+}
+
+/* eof */
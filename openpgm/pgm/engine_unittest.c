@@ -47,6 +47,10 @@ static struct pgm_slist_t* mock_pgm_sock_list = NULL;
 #define pgm_close		mock_pgm_close
 #define pgm_sock_list_lock	mock_pgm_sock_list_lock
 #define pgm_sock_list		mock_pgm_sock_list
+#define pgm_spm_scheduler_init		mock_pgm_spm_scheduler_init
+#define pgm_spm_scheduler_shutdown	mock_pgm_spm_scheduler_shutdown
+#define pgm_shmstats_lock_init		mock_pgm_shmstats_lock_init
+#define pgm_shmstats_lock_free		mock_pgm_shmstats_lock_free
 
 #define ENGINE_DEBUG
 #include "engine.c"
@@ -105,6 +109,30 @@ mock_pgm_time_shutdown (void)
 	return TRUE;
 }
 
+PGM_GNUC_INTERNAL
+void
+mock_pgm_spm_scheduler_init (void)
+{
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_spm_scheduler_shutdown (void)
+{
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_shmstats_lock_init (void)
+{
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_shmstats_lock_free (void)
+{
+}
+
 bool
 mock_pgm_close (
 	pgm_sock_t*		sock,
@@ -0,0 +1,727 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Loopback benchmark.  Runs one source and N receivers in a single process
+ * over UDP encapsulation, sweeping message size, rate, window size, FEC and
+ * simulated receive loss, and prints one machine readable result per run.
+ * Loss requires libpgm built with WITH_LOSS_SIMULATION=true or PGM_DEBUG.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <errno.h>
+#include <locale.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#ifdef __linux__
+#	include <linux/filter.h>
+#endif
+#include <pgm/pgm.h>
+
+
+/* sweep dimensions are comma separated lists */
+#define MAX_VALUES		16
+#define MAX_RECEIVERS		64
+#define MAX_MESSAGE		65000
+
+/* receivers stop waiting for repairs after the source finishes */
+#define DRAIN_TIMEOUT_MS	3000
+
+struct fec_t {
+	int		group_size;		/* 0 = disabled */
+	int		proactive_packets;
+};
+
+struct receiver_t {
+	pgm_sock_t*	sock;
+	pthread_t	thread;
+	uint64_t	msgs;
+	uint64_t	bytes;
+	uint64_t	resets;
+	uint32_t*	latencies;		/* microseconds */
+	size_t		len;
+	size_t		capacity;
+};
+
+struct result_t {
+	uint64_t	sent;
+	uint64_t	delivered;		/* by the slowest receiver */
+	double		elapsed;		/* seconds sending */
+	uint32_t	p50, p99, p999, max;
+	uint64_t	naks_sent;
+	uint64_t	naks_received;
+	uint64_t	repairs;
+	uint64_t	parity_repairs;
+	uint64_t	unrecovered;
+	uint64_t	cpu_ns;
+};
+
+/* prepended to every message */
+struct bench_header_t {
+	uint64_t	timestamp;		/* CLOCK_MONOTONIC nanoseconds */
+	uint32_t	run;
+	uint32_t	sequence;
+};
+
+
+/* globals */
+
+static const char*	network = "127.0.0.1;239.192.0.1";
+static int		port = 7500;
+static int		n_receivers = 1;
+static int		duration = 2;
+static bool		use_engine_thread = FALSE;
+static bool		use_json = FALSE;
+
+static int		sizes[MAX_VALUES] = { 64, 1400 };
+static int		n_sizes = 2;
+static int		rates[MAX_VALUES] = { 10*1000*1000 };
+static int		n_rates = 1;
+static int		windows[MAX_VALUES] = { 10000 };
+static int		n_windows = 1;
+static struct fec_t	fecs[MAX_VALUES] = { { 0, 0 } };
+static int		n_fecs = 1;
+static int		losses[MAX_VALUES] = { 0, 1 };
+static int		n_losses = 2;
+
+static volatile bool	is_terminated = FALSE;
+static uint32_t		run_id = 0;
+static struct receiver_t receivers[MAX_RECEIVERS];
+static struct receiver_t source;		/* services NAKs */
+static pgm_shmstats_t	stats;
+
+static void usage (const char*) __attribute__((__noreturn__));
+
+
+static void
+usage (
+	const char*	bin
+	)
+{
+	fprintf (stderr, "Usage: %s [options]\n", bin);
+	fprintf (stderr, "  -n, --network NETWORK    : Multicast group or unicast IP address (%s)\n", network);
+	fprintf (stderr, "  -p, --port PORT          : Encapsulate PGM in UDP on IP port (%d)\n", port);
+	fprintf (stderr, "  -R, --receivers N        : Receivers in this process (%d)\n", n_receivers);
+	fprintf (stderr, "  -d, --duration SECONDS   : Send period per run (%d)\n", duration);
+	fprintf (stderr, "  -s, --size LIST          : Message sizes in bytes (64,1400)\n");
+	fprintf (stderr, "  -r, --speed-limit LIST   : Rates in bytes per second (10000000)\n");
+	fprintf (stderr, "  -w, --window LIST        : Window sizes in sequence numbers (10000)\n");
+	fprintf (stderr, "  -f, --fec LIST           : FEC as K:P group size and proactive parity, 0 off (0)\n");
+	fprintf (stderr, "  -l, --loss LIST          : Simulated receive loss in percent, needs WITH_LOSS_SIMULATION (0,1)\n");
+	fprintf (stderr, "  -e, --engine-thread      : Receivers use an engine thread\n");
+	fprintf (stderr, "  -j, --json               : JSON lines instead of CSV\n");
+	exit (EXIT_SUCCESS);
+}
+
+static int
+parse_list (
+	const char*	list,
+	int*		values
+	)
+{
+	int n = 0;
+	char* end;
+	while (n < MAX_VALUES) {
+		values[n++] = (int)strtol (list, &end, 10);
+		if (',' != *end)
+			break;
+		list = end + 1;
+	}
+	return n;
+}
+
+static int
+parse_fec_list (
+	const char*	list,
+	struct fec_t*	values
+	)
+{
+	int n = 0;
+	char* end;
+	while (n < MAX_VALUES) {
+		values[n].group_size = (int)strtol (list, &end, 10);
+		values[n].proactive_packets = (':' == *end) ? (int)strtol (end + 1, &end, 10) : 0;
+		n++;
+		if (',' != *end)
+			break;
+		list = end + 1;
+	}
+	return n;
+}
+
+static uint64_t
+now_ns (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t
+cpu_ns (void)
+{
+	struct rusage usage;
+	getrusage (RUSAGE_SELF, &usage);
+	return ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) * 1000000000ULL +
+	       ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) * 1000ULL;
+}
+
+/* library messages to stderr so they never mix with results */
+static void
+on_log (
+	const int		log_level,
+	const char*		message,
+	void*			closure
+	)
+{
+	fprintf (stderr, "%s\n", message);
+}
+
+static pgm_sock_t*
+create_sock (
+	const bool		is_receiver,
+	const unsigned		index,
+	const int		size,
+	const int		rate,
+	const int		window,
+	const struct fec_t*	fec
+	)
+{
+	struct pgm_addrinfo_t* res = NULL;
+	pgm_error_t* pgm_err = NULL;
+	pgm_sock_t* sock = NULL;
+
+	if (!pgm_getaddrinfo (network, NULL, &res, &pgm_err)) {
+		fprintf (stderr, "Parsing network parameter: %s\n", pgm_err->message);
+		goto err_abort;
+	}
+	const sa_family_t sa_family = res->ai_send_addrs[0].gsr_group.ss_family;
+	if (!pgm_socket (&sock, sa_family, SOCK_SEQPACKET, IPPROTO_UDP, &pgm_err)) {
+		fprintf (stderr, "Creating PGM/UDP socket: %s\n", pgm_err->message);
+		goto err_abort;
+	}
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_UDP_ENCAP_UCAST_PORT, &port, sizeof(port));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_UDP_ENCAP_MCAST_PORT, &port, sizeof(port));
+
+	const int max_tpdu = 1500;
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_MTU, &max_tpdu, sizeof(max_tpdu));
+	if (is_receiver) {
+		const int recv_only = 1,
+			  passive = 0,
+			  peer_expiry = pgm_secs (300),
+			  spmr_expiry = pgm_msecs (10),
+			  nak_bo_ivl = pgm_msecs (10),
+			  nak_rpt_ivl = pgm_msecs (200),
+			  nak_rdata_ivl = pgm_msecs (200),
+			  nak_data_retries = 50,
+			  nak_ncf_retries = 50;
+
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_RECV_ONLY, &recv_only, sizeof(recv_only));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_PASSIVE, &passive, sizeof(passive));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_RXW_SQNS, &window, sizeof(window));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_PEER_EXPIRY, &peer_expiry, sizeof(peer_expiry));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_SPMR_EXPIRY, &spmr_expiry, sizeof(spmr_expiry));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_NAK_BO_IVL, &nak_bo_ivl, sizeof(nak_bo_ivl));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_NAK_RPT_IVL, &nak_rpt_ivl, sizeof(nak_rpt_ivl));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_NAK_RDATA_IVL, &nak_rdata_ivl, sizeof(nak_rdata_ivl));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_NAK_DATA_RETRIES, &nak_data_retries, sizeof(nak_data_retries));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_NAK_NCF_RETRIES, &nak_ncf_retries, sizeof(nak_ncf_retries));
+		if (use_engine_thread) {
+			const int engine_thread = 1;
+			pgm_setsockopt (sock, IPPROTO_PGM, PGM_ENGINE_THREAD, &engine_thread, sizeof(engine_thread));
+		}
+	} else {
+		const int send_only = 1,
+			  ambient_spm = pgm_secs (30),
+			  heartbeat_spm[] = { pgm_msecs (100),
+					      pgm_msecs (100),
+					      pgm_msecs (100),
+					      pgm_msecs (100),
+					      pgm_msecs (1300),
+					      pgm_secs  (7),
+					      pgm_secs  (16),
+					      pgm_secs  (25),
+					      pgm_secs  (30) };
+
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_SEND_ONLY, &send_only, sizeof(send_only));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_TXW_SQNS, &window, sizeof(window));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_TXW_MAX_RTE, &rate, sizeof(rate));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_AMBIENT_SPM, &ambient_spm, sizeof(ambient_spm));
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_HEARTBEAT_SPM, &heartbeat_spm, sizeof(heartbeat_spm));
+	}
+	if (fec->group_size) {
+		struct pgm_fecinfo_t fecinfo;
+		fecinfo.block_size		= 255;
+		fecinfo.proactive_packets	= fec->proactive_packets;
+		fecinfo.group_size		= fec->group_size;
+		fecinfo.ondemand_parity_enabled	= TRUE;
+		fecinfo.var_pktlen_enabled	= TRUE;
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_USE_FEC, &fecinfo, sizeof(fecinfo));
+	}
+
+/* a new source port per run, receivers differ by GSI */
+	struct pgm_sockaddr_t addr;
+	memset (&addr, 0, sizeof(addr));
+	addr.sa_port = (uint16_t)port;
+	addr.sa_addr.sport = is_receiver ? 0 : (uint16_t)(1000 + run_id);
+	pgm_gsi_create_from_string (&addr.sa_addr.gsi, "pgmbench", -1);
+	addr.sa_addr.gsi.identifier[5] += (uint8_t)(is_receiver ? 1 + index : 0);
+
+	struct pgm_interface_req_t if_req;
+	memset (&if_req, 0, sizeof(if_req));
+	if_req.ir_interface = res->ai_recv_addrs[0].gsr_interface;
+	memcpy (&if_req.ir_address, &res->ai_send_addrs[0].gsr_addr, sizeof(struct sockaddr_storage));
+	if (!pgm_bind3 (sock,
+			&addr, sizeof(addr),
+			&if_req, sizeof(if_req),	/* tx interface */
+			&if_req, sizeof(if_req),	/* rx interface */
+			&pgm_err))
+	{
+		fprintf (stderr, "Binding PGM socket: %s\n", pgm_err->message);
+		goto err_abort;
+	}
+
+	for (unsigned i = 0; i < res->ai_recv_addrs_len; i++)
+		pgm_setsockopt (sock, IPPROTO_PGM, PGM_JOIN_GROUP, &res->ai_recv_addrs[i], sizeof(struct pgm_group_source_req));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_SEND_GROUP, &res->ai_send_addrs[0], sizeof(struct pgm_group_source_req));
+	pgm_freeaddrinfo (res);
+	res = NULL;
+
+	const int blocking = is_receiver ? 1 : 0,
+		  multicast_loop = 1;
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_MULTICAST_LOOP, &multicast_loop, sizeof(multicast_loop));
+	pgm_setsockopt (sock, IPPROTO_PGM, PGM_NOBLOCK, &blocking, sizeof(blocking));
+
+	if (!pgm_connect (sock, &pgm_err)) {
+		fprintf (stderr, "Connecting PGM socket: %s\n", pgm_err->message);
+		goto err_abort;
+	}
+	return sock;
+
+err_abort:
+	if (NULL != sock)
+		pgm_close (sock, FALSE);
+	if (NULL != res)
+		pgm_freeaddrinfo (res);
+	if (NULL != pgm_err)
+		pgm_error_free (pgm_err);
+	return NULL;
+}
+
+/* every socket shares the UDP port, unicast NAKs would otherwise be hashed
+ * across the port group and mostly miss the source.  multicast is still
+ * delivered to all of them.
+ */
+
+static void
+steer_unicast (
+	pgm_sock_t*	sock
+	)
+{
+#if defined(SO_ATTACH_REUSEPORT_CBPF)
+	int fd;
+	socklen_t optlen = sizeof(fd);
+/* the source is bound first and is member zero of the group */
+	struct sock_filter code[] = { { BPF_RET | BPF_K, 0, 0, 0 } };
+	struct sock_fprog prog = { .len = PGM_N_ELEMENTS(code), .filter = code };
+	if (pgm_getsockopt (sock, IPPROTO_PGM, PGM_RECV_SOCK, &fd, &optlen) &&
+	    0 != setsockopt (fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)))
+		perror ("Steering unicast to the source");
+#endif
+}
+
+static void*
+receiver_thread (
+	void*		arg
+	)
+{
+	struct receiver_t* receiver = arg;
+	pgm_error_t* pgm_err = NULL;
+	char buffer[MAX_MESSAGE];
+	struct pollfd fds[8];
+
+	while (!is_terminated) {
+		size_t len;
+		const int status = pgm_recv (receiver->sock, buffer, sizeof(buffer), MSG_DONTWAIT, &len, &pgm_err);
+		switch (status) {
+		case PGM_IO_STATUS_NORMAL: {
+			struct bench_header_t header;
+			if (len < sizeof(header))
+				break;
+			memcpy (&header, buffer, sizeof(header));
+			if (header.run != run_id)
+				break;
+			const uint64_t latency = (now_ns() - header.timestamp) / 1000;
+			if (receiver->len == receiver->capacity) {
+				receiver->capacity = receiver->capacity ? receiver->capacity * 2 : 65536;
+				receiver->latencies = realloc (receiver->latencies, receiver->capacity * sizeof(uint32_t));
+			}
+			receiver->latencies[ receiver->len++ ] = latency > UINT32_MAX ? UINT32_MAX : (uint32_t)latency;
+			receiver->msgs++;
+			receiver->bytes += len;
+			continue;
+		}
+		case PGM_IO_STATUS_RESET:
+			receiver->resets++;
+			if (NULL != pgm_err) {
+				pgm_error_free (pgm_err);
+				pgm_err = NULL;
+			}
+			continue;
+		case PGM_IO_STATUS_TIMER_PENDING:
+		case PGM_IO_STATUS_RATE_LIMITED:
+		case PGM_IO_STATUS_WOULD_BLOCK:
+			break;
+		default:
+			if (NULL != pgm_err) {
+				fprintf (stderr, "%s\n", pgm_err->message);
+				pgm_error_free (pgm_err);
+				pgm_err = NULL;
+			}
+			break;
+		}
+
+/* wake at least every 10ms to observe termination */
+		int n_fds = PGM_N_ELEMENTS(fds), timeout = 10;
+		memset (fds, 0, sizeof(fds));
+		pgm_poll_info (receiver->sock, fds, &n_fds, POLLIN);
+		if (PGM_IO_STATUS_TIMER_PENDING == status || PGM_IO_STATUS_RATE_LIMITED == status) {
+			struct timeval tv;
+			socklen_t optlen = sizeof(tv);
+			pgm_getsockopt (receiver->sock, IPPROTO_PGM,
+					PGM_IO_STATUS_TIMER_PENDING == status ? PGM_TIME_REMAIN : PGM_RATE_REMAIN,
+					&tv, &optlen);
+			const int remain = (int)(tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000);
+			if (remain < timeout)
+				timeout = remain;
+		}
+		poll (fds, n_fds, timeout);
+	}
+	return NULL;
+}
+
+static int
+on_compare (
+	const void*	a,
+	const void*	b
+	)
+{
+	const uint32_t va = *(const uint32_t*)a, vb = *(const uint32_t*)b;
+	return (va > vb) - (va < vb);
+}
+
+static uint32_t
+percentile (
+	const uint32_t*	values,
+	const size_t	len,
+	const double	percent
+	)
+{
+	if (0 == len)
+		return 0;
+	size_t rank = (size_t)(percent / 100.0 * (double)len + 0.5);
+	if (rank > 0) rank--;
+	return values[ rank < len ? rank : len - 1 ];
+}
+
+/* sum a named counter over sockets or peers of the published snapshot.
+ */
+
+static uint64_t
+sum_counter (
+	const bool	is_source,
+	const char*	name
+	)
+{
+	uint64_t sum = 0;
+	if (is_source) {
+		for (unsigned j = 0; j < stats.source_counters; j++)
+			if (0 == strcmp (name, stats.source_counter_names[j]))
+				for (unsigned i = 0; i < stats.n_socks; i++)
+					sum += stats.socks[i].counters[j];
+	} else {
+		for (unsigned j = 0; j < stats.receiver_counters; j++)
+			if (0 == strcmp (name, stats.receiver_counter_names[j]))
+				for (unsigned i = 0; i < stats.n_peers; i++)
+					sum += stats.peers[i].counters[j];
+	}
+	return sum;
+}
+
+static bool
+run_one (
+	const int		size,
+	const int		rate,
+	const int		window,
+	const struct fec_t*	fec,
+	const int		loss,
+	struct result_t*	result
+	)
+{
+	pgm_error_t* pgm_err = NULL;
+	char segment[64];
+	char loss_rate[16];
+	bool is_ok = FALSE;
+
+/* loss is applied by every socket receive path, read at initialisation */
+	snprintf (loss_rate, sizeof(loss_rate), "%d", loss);
+	setenv ("PGM_LOSS_RATE", loss_rate, 1);
+	if (!pgm_init (&pgm_err)) {
+		fprintf (stderr, "Unable to start PGM engine: %s\n", pgm_err->message);
+		pgm_error_free (pgm_err);
+		return FALSE;
+	}
+	snprintf (segment, sizeof(segment), "/pgmbench.%d", (int)getpid());
+	if (!pgm_shmstats_init (segment, 100, &pgm_err)) {
+		fprintf (stderr, "Statistics unavailable: %s\n", pgm_err->message);
+		pgm_error_free (pgm_err);
+		pgm_err = NULL;
+	}
+
+	run_id++;
+	memset (result, 0, sizeof(*result));
+	memset (receivers, 0, sizeof(receivers));
+	memset (&source, 0, sizeof(source));
+	is_terminated = FALSE;
+	source.sock = create_sock (FALSE, 0, size, rate, window, fec);
+	if (NULL == source.sock)
+		goto cleanup;
+	steer_unicast (source.sock);
+	for (int i = 0; i < n_receivers; i++) {
+		receivers[i].sock = create_sock (TRUE, i, size, rate, window, fec);
+		if (NULL == receivers[i].sock)
+			goto cleanup;
+	}
+	for (int i = 0; i < n_receivers; i++)
+		pthread_create (&receivers[i].thread, NULL, receiver_thread, &receivers[i]);
+/* the source only processes NAKs whilst it is being read */
+	pthread_create (&source.thread, NULL, receiver_thread, &source);
+
+	char* message = calloc (1, size < (int)sizeof(struct bench_header_t) ? sizeof(struct bench_header_t) : (size_t)size);
+	const size_t message_len = size < (int)sizeof(struct bench_header_t) ? sizeof(struct bench_header_t) : (size_t)size;
+	const uint64_t cpu_start = cpu_ns();
+	const uint64_t start = now_ns();
+	const uint64_t stop = start + (uint64_t)duration * 1000000000ULL;
+	uint64_t now = start;
+	struct bench_header_t header = { .run = run_id, .sequence = 0 };
+	while (now < stop) {
+		header.timestamp = now;
+		memcpy (message, &header, sizeof(header));
+		const int status = pgm_send (source.sock, message, message_len, NULL);
+		if (PGM_IO_STATUS_NORMAL != status) {
+			fprintf (stderr, "pgm_send() failed.\n");
+			break;
+		}
+		header.sequence++;
+		now = now_ns();
+	}
+	result->sent = header.sequence;
+	result->elapsed = (double)(now - start) / 1e9;
+	free (message);
+
+/* allow repairs to complete */
+	const uint64_t drain = now_ns() + (uint64_t)DRAIN_TIMEOUT_MS * 1000000ULL;
+	for (;;) {
+		uint64_t delivered = result->sent;
+		for (int i = 0; i < n_receivers; i++)
+			if (receivers[i].msgs < delivered)
+				delivered = receivers[i].msgs;
+		result->delivered = delivered;
+		if (delivered == result->sent || now_ns() > drain)
+			break;
+		usleep (10000);
+	}
+	is_terminated = TRUE;
+	for (int i = 0; i < n_receivers; i++)
+		pthread_join (receivers[i].thread, NULL);
+	pthread_join (source.thread, NULL);
+	result->cpu_ns = cpu_ns() - cpu_start;
+
+/* one publish period for the final counters */
+	usleep (250000);
+	if (pgm_shmstats_read (&stats)) {
+		result->naks_received	= sum_counter (TRUE, "selective_naks_received") + sum_counter (TRUE, "parity_naks_received");
+		result->repairs		= sum_counter (TRUE, "selective_msgs_retransmitted");
+		result->parity_repairs	= sum_counter (TRUE, "parity_msgs_retransmitted");
+		result->naks_sent	= sum_counter (FALSE, "selective_naks_sent") + sum_counter (FALSE, "parity_naks_sent");
+		for (unsigned i = 0; i < stats.n_peers; i++)
+			result->unrecovered += stats.peers[i].cumulative_losses;
+	}
+
+/* latency over all receivers */
+	size_t total = 0;
+	for (int i = 0; i < n_receivers; i++)
+		total += receivers[i].len;
+	uint32_t* latencies = malloc ((total ? total : 1) * sizeof(uint32_t));
+	size_t offset = 0;
+	for (int i = 0; i < n_receivers; i++) {
+		memcpy (latencies + offset, receivers[i].latencies, receivers[i].len * sizeof(uint32_t));
+		offset += receivers[i].len;
+	}
+	qsort (latencies, total, sizeof(uint32_t), on_compare);
+	result->p50  = percentile (latencies, total, 50.0);
+	result->p99  = percentile (latencies, total, 99.0);
+	result->p999 = percentile (latencies, total, 99.9);
+	result->max  = total ? latencies[ total - 1 ] : 0;
+	free (latencies);
+	is_ok = TRUE;
+
+cleanup:
+	for (int i = 0; i < n_receivers; i++) {
+		if (NULL != receivers[i].sock)
+			pgm_close (receivers[i].sock, FALSE);
+		free (receivers[i].latencies);
+	}
+	if (NULL != source.sock)
+		pgm_close (source.sock, TRUE);
+	pgm_shmstats_shutdown ();
+	pgm_shutdown ();
+	return is_ok;
+}
+
+static void
+print_result (
+	const int		size,
+	const int		rate,
+	const int		window,
+	const struct fec_t*	fec,
+	const int		loss,
+	const struct result_t*	result
+	)
+{
+	const double msgs_per_sec = result->elapsed > 0 ? (double)result->sent / result->elapsed : 0;
+	const double mbit_per_sec = msgs_per_sec * size * 8 / 1e6;
+	const double cpu_per_msg = result->sent ? (double)result->cpu_ns / (double)result->sent : 0;
+
+	if (use_json) {
+		printf ("{\"size\":%d,\"rate\":%d,\"window\":%d,\"fec_k\":%d,\"fec_proactive\":%d,\"loss\":%d,\"receivers\":%d,"
+			"\"sent\":%llu,\"delivered\":%llu,\"msgs_per_sec\":%.0f,\"mbit_per_sec\":%.2f,"
+			"\"p50_us\":%u,\"p99_us\":%u,\"p999_us\":%u,\"max_us\":%u,"
+			"\"naks_sent\":%llu,\"naks_received\":%llu,\"repairs\":%llu,\"parity_repairs\":%llu,\"unrecovered\":%llu,"
+			"\"cpu_ns_per_msg\":%.0f}\n",
+			size, rate, window, fec->group_size, fec->proactive_packets, loss, n_receivers,
+			(unsigned long long)result->sent, (unsigned long long)result->delivered, msgs_per_sec, mbit_per_sec,
+			result->p50, result->p99, result->p999, result->max,
+			(unsigned long long)result->naks_sent, (unsigned long long)result->naks_received,
+			(unsigned long long)result->repairs, (unsigned long long)result->parity_repairs,
+			(unsigned long long)result->unrecovered, cpu_per_msg);
+	} else {
+		printf ("%d,%d,%d,%d,%d,%d,%d,%llu,%llu,%.0f,%.2f,%u,%u,%u,%u,%llu,%llu,%llu,%llu,%llu,%.0f\n",
+			size, rate, window, fec->group_size, fec->proactive_packets, loss, n_receivers,
+			(unsigned long long)result->sent, (unsigned long long)result->delivered, msgs_per_sec, mbit_per_sec,
+			result->p50, result->p99, result->p999, result->max,
+			(unsigned long long)result->naks_sent, (unsigned long long)result->naks_received,
+			(unsigned long long)result->repairs, (unsigned long long)result->parity_repairs,
+			(unsigned long long)result->unrecovered, cpu_per_msg);
+	}
+	fflush (stdout);
+}
+
+int
+main (
+	int		argc,
+	char*		argv[]
+	)
+{
+	setlocale (LC_ALL, "");
+
+	const char* binary_name = strrchr (argv[0], '/');
+	if (NULL == binary_name)	binary_name = argv[0];
+	else				binary_name++;
+
+	static struct option long_options[] = {
+		{ "network",        required_argument, NULL, 'n' },
+		{ "port",           required_argument, NULL, 'p' },
+		{ "receivers",      required_argument, NULL, 'R' },
+		{ "duration",       required_argument, NULL, 'd' },
+		{ "size",           required_argument, NULL, 's' },
+		{ "speed-limit",    required_argument, NULL, 'r' },
+		{ "window",         required_argument, NULL, 'w' },
+		{ "fec",            required_argument, NULL, 'f' },
+		{ "loss",           required_argument, NULL, 'l' },
+		{ "engine-thread",  no_argument,       NULL, 'e' },
+		{ "json",           no_argument,       NULL, 'j' },
+		{ "help",           no_argument,       NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+
+	int c;
+	while ((c = getopt_long (argc, argv, "n:p:R:d:s:r:w:f:l:ejh", long_options, NULL)) != -1)
+	{
+		switch (c) {
+		case 'n':	network = optarg; break;
+		case 'p':	port = atoi (optarg); break;
+		case 'R':	n_receivers = atoi (optarg); break;
+		case 'd':	duration = atoi (optarg); break;
+		case 's':	n_sizes = parse_list (optarg, sizes); break;
+		case 'r':	n_rates = parse_list (optarg, rates); break;
+		case 'w':	n_windows = parse_list (optarg, windows); break;
+		case 'f':	n_fecs = parse_fec_list (optarg, fecs); break;
+		case 'l':	n_losses = parse_list (optarg, losses); break;
+		case 'e':	use_engine_thread = TRUE; break;
+		case 'j':	use_json = TRUE; break;
+
+		case 'h':
+		case '?':
+			usage (binary_name);
+		}
+	}
+
+	if (n_receivers < 1 || n_receivers > MAX_RECEIVERS || duration < 1) {
+		fprintf (stderr, "Invalid receiver count or duration.\n");
+		usage (binary_name);
+	}
+	for (int i = 0; i < n_sizes; i++)
+		if (sizes[i] < 1 || sizes[i] > MAX_MESSAGE) {
+			fprintf (stderr, "Invalid message size %d.\n", sizes[i]);
+			usage (binary_name);
+		}
+	for (int i = 0; i < n_losses; i++)
+		if (losses[i] < 0 || losses[i] > 100) {
+			fprintf (stderr, "Invalid loss rate %d.\n", losses[i]);
+			usage (binary_name);
+		}
+
+/* results only on stdout */
+	pgm_log_set_handler (on_log, NULL);
+	if (NULL == getenv ("PGM_MIN_LOG_LEVEL"))
+		pgm_min_log_level = PGM_LOG_LEVEL_ERROR;
+
+	if (!use_json)
+		puts ("size,rate,window,fec_k,fec_proactive,loss,receivers,sent,delivered,msgs_per_sec,mbit_per_sec,"
+		      "p50_us,p99_us,p999_us,max_us,naks_sent,naks_received,repairs,parity_repairs,unrecovered,cpu_ns_per_msg");
+	for (int s = 0; s < n_sizes; s++)
+	for (int r = 0; r < n_rates; r++)
+	for (int w = 0; w < n_windows; w++)
+	for (int f = 0; f < n_fecs; f++)
+	for (int l = 0; l < n_losses; l++) {
+		struct result_t result;
+		if (!run_one (sizes[s], rates[r], windows[w], &fecs[f], losses[l], &result))
+			return EXIT_FAILURE;
+		print_result (sizes[s], rates[r], windows[w], &fecs[f], losses[l], &result);
+	}
+	return EXIT_SUCCESS;
+}
+
+/* eof */
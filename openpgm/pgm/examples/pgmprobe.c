@@ -0,0 +1,188 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * PGM trace ring decoder.  Prints a dump written by pgm_probe_ring_dump()
+ * as one line per event, merged across threads in time order.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* MSVC secure CRT */
+#define _CRT_SECURE_NO_WARNINGS		1
+
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#	include <unistd.h>
+#	include <getopt.h>
+#else
+#	include "getopt.h"
+#endif
+#include <pgm/pgm.h>
+
+
+/* globals */
+
+static int		event_filter = 0;
+static bool		is_relative = FALSE;
+
+#ifndef _MSC_VER
+static void usage (const char*) __attribute__((__noreturn__));
+#else
+static void usage (const char*);
+#endif
+
+
+static void
+usage (
+	const char*	bin
+	)
+{
+	fprintf (stderr, "Usage: %s [options] FILE\n", bin);
+	fprintf (stderr, "  -e, --event NAME         : Only print events of this type\n");
+	fprintf (stderr, "  -r, --relative           : Timestamps relative to the first event\n");
+	exit (EXIT_SUCCESS);
+}
+
+static int
+on_compare (
+	const void*	a,
+	const void*	b
+	)
+{
+	const pgm_probe_record_t* ra = a;
+	const pgm_probe_record_t* rb = b;
+	if (ra->timestamp != rb->timestamp)
+		return ra->timestamp < rb->timestamp ? -1 : 1;
+	return (int)ra->thread - (int)rb->thread;
+}
+
+static void
+print_record (
+	const pgm_probe_record_t*	record,
+	const uint64_t			epoch
+	)
+{
+	char tsi[PGM_TSISTRLEN];
+	const uint64_t usecs = record->timestamp - epoch;
+
+	pgm_tsi_print_r (&record->tsi, tsi, sizeof (tsi));
+	printf ("%llu.%06u %3u %-12s %s #%u",
+		(unsigned long long)(usecs / 1000000), (unsigned)(usecs % 1000000),
+		(unsigned)record->thread,
+		pgm_probe_event_string (record->event),
+		tsi,
+		(unsigned)record->sqn);
+	switch (record->event) {
+	case PGM_PROBE_ODATA_SEND:
+	case PGM_PROBE_RDATA_SEND:
+		printf (" %u bytes", (unsigned)record->arg);
+		break;
+	case PGM_PROBE_NAK_SEND:
+	case PGM_PROBE_NAK_RECV:
+	case PGM_PROBE_NCF_SEND:
+	case PGM_PROBE_NCF_RECV:
+		printf (" count %u%s", (unsigned)(record->arg & ~PGM_PROBE_PARITY),
+			(record->arg & PGM_PROBE_PARITY) ? " parity" : "");
+		break;
+	case PGM_PROBE_RXW_STATE:
+		printf (" state %u -> %u", (unsigned)(record->arg >> 16), (unsigned)(record->arg & 0xffff));
+		break;
+	case PGM_PROBE_PEER_EXPIRE:
+		printf (" %u lost", (unsigned)record->arg);
+		break;
+	default: break;
+	}
+	putchar ('\n');
+}
+
+int
+main (
+	int		argc,
+	char*		argv[]
+	)
+{
+	pgm_probe_dump_t dump;
+
+	setlocale (LC_ALL, "");
+
+	int c;
+	while ((c = getopt (argc, argv, "e:rh")) != -1)
+	{
+		switch (c) {
+		case 'e':
+			for (event_filter = 1; event_filter < PGM_PROBE_MAX; event_filter++)
+				if (0 == strcmp (optarg, pgm_probe_event_string (event_filter)))
+					break;
+			if (PGM_PROBE_MAX == event_filter) {
+				fprintf (stderr, "Unknown event %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'r':	is_relative = TRUE; break;
+
+		case 'h':
+		case '?': usage (argv[0]);
+		}
+	}
+	if (optind >= argc)
+		usage (argv[0]);
+
+	FILE* fp = fopen (argv[optind], "rb");
+	if (NULL == fp) {
+		perror ("Opening dump file");
+		return EXIT_FAILURE;
+	}
+	if (1 != fread (&dump, sizeof (dump), 1, fp) ||
+	    PGM_PROBE_DUMP_MAGIC != dump.magic)
+	{
+		fprintf (stderr, "%s is not a PGM trace ring dump.\n", argv[optind]);
+		fclose (fp);
+		return EXIT_FAILURE;
+	}
+	if (PGM_PROBE_DUMP_VERSION != dump.version ||
+	    sizeof (pgm_probe_record_t) != dump.record_size)
+	{
+		fprintf (stderr, "Unsupported dump version %u record size %u.\n",
+			 (unsigned)dump.version, (unsigned)dump.record_size);
+		fclose (fp);
+		return EXIT_FAILURE;
+	}
+
+	pgm_probe_record_t* records = calloc (dump.count ? dump.count : 1, sizeof (pgm_probe_record_t));
+	if (NULL == records) {
+		fclose (fp);
+		return EXIT_FAILURE;
+	}
+	const size_t count = fread (records, sizeof (pgm_probe_record_t), dump.count, fp);
+	fclose (fp);
+	if (count != dump.count)
+		fprintf (stderr, "Truncated dump, %u of %u records.\n", (unsigned)count, (unsigned)dump.count);
+
+/* each thread's records are in order, the file is grouped by thread */
+	qsort (records, count, sizeof (pgm_probe_record_t), on_compare);
+	const uint64_t epoch = (is_relative && count > 0) ? records[0].timestamp : 0;
+	for (size_t i = 0; i < count; i++)
+		if (0 == event_filter || event_filter == records[i].event)
+			print_record (&records[i], epoch);
+
+	free (records);
+	return EXIT_SUCCESS;
+}
+
+/* eof */
@@ -0,0 +1,163 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * PGM statistics monitor.  Reads the shared memory statistics segment of
+ * another process, enabled there with pgm_shmstats_init(), without any
+ * network traffic or locking inside the monitored process.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* MSVC secure CRT */
+#define _CRT_SECURE_NO_WARNINGS		1
+
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#	include <unistd.h>
+#	include <getopt.h>
+#else
+#	include "getopt.h"
+#endif
+#include <pgm/pgm.h>
+
+
+/* globals */
+
+static char		name[256];
+static int		interval = 1;
+static bool		is_once = FALSE;
+
+static pgm_shmstats_t	copy;
+
+#ifndef _MSC_VER
+static void usage (const char*) __attribute__((__noreturn__));
+#else
+static void usage (const char*);
+#endif
+
+
+static void
+usage (
+	const char*	bin
+	)
+{
+	fprintf (stderr, "Usage: %s [options] PID\n", bin);
+	fprintf (stderr, "  -n, --name NAME          : Segment name instead of process id\n");
+	fprintf (stderr, "  -i, --interval SECONDS   : Refresh interval (1)\n");
+	fprintf (stderr, "  -o, --once               : Print one snapshot and exit\n");
+	exit (EXIT_SUCCESS);
+}
+
+static void
+print_snapshot (void)
+{
+	char tsi[PGM_TSISTRLEN];
+
+	printf ("pid %u: %u socket(s), %u peer(s)", (unsigned)copy.pid, (unsigned)copy.n_socks, (unsigned)copy.n_peers);
+	if (copy.dropped_socks || copy.dropped_peers)
+		printf (", %u socket(s) and %u peer(s) not shown", (unsigned)copy.dropped_socks, (unsigned)copy.dropped_peers);
+	putchar ('\n');
+
+	for (unsigned i = 0; i < copy.n_socks; i++) {
+		const pgm_shmstats_sock_t* sock = &copy.socks[i];
+		pgm_tsi_print_r (&sock->tsi, tsi, sizeof (tsi));
+		printf ("\nsocket %s dport %u\n", tsi, (unsigned)ntohs (sock->dport));
+		if (sock->flags & PGM_SHMSTATS_CAN_SEND) {
+			printf ("  txw %u-%u %u bytes\n", (unsigned)sock->txw_trail, (unsigned)sock->txw_lead, (unsigned)sock->txw_bytes);
+			if (sock->rate_per_sec)
+				printf ("  rate %lld bytes/s, %lld bytes available\n", (long long)sock->rate_per_sec, (long long)sock->rate_limit);
+			for (unsigned j = 0; j < copy.source_counters; j++)
+				if (sock->counters[j])
+					printf ("  %-40s %10u\n", copy.source_counter_names[j], (unsigned)sock->counters[j]);
+		}
+	}
+	for (unsigned i = 0; i < copy.n_peers; i++) {
+		const pgm_shmstats_peer_t* peer = &copy.peers[i];
+		pgm_tsi_print_r (&peer->tsi, tsi, sizeof (tsi));
+		printf ("\npeer %s on socket %u\n", tsi, (unsigned)peer->sock_index);
+		printf ("  rxw %u-%u commit %u %u bytes\n", (unsigned)peer->rxw_trail, (unsigned)peer->rxw_lead, (unsigned)peer->commit_lead, (unsigned)peer->rxw_bytes);
+		printf ("  delivered %u msgs %u bytes, %u lost\n", (unsigned)peer->msgs_delivered, (unsigned)peer->bytes_delivered, (unsigned)peer->cumulative_losses);
+		if (peer->repair_count)
+			printf ("  %llu repairs, p50 %uus p99 %uus max %uus\n", (unsigned long long)peer->repair_count, (unsigned)peer->repair_p50, (unsigned)peer->repair_p99, (unsigned)peer->repair_max);
+		for (unsigned j = 0; j < copy.receiver_counters; j++)
+			if (peer->counters[j])
+				printf ("  %-40s %10u\n", copy.receiver_counter_names[j], (unsigned)peer->counters[j]);
+	}
+	fflush (stdout);
+}
+
+int
+main (
+	int		argc,
+	char*		argv[]
+	)
+{
+	pgm_error_t* pgm_err = NULL;
+
+	setlocale (LC_ALL, "");
+
+	name[0] = '\0';
+	int c;
+	while ((c = getopt (argc, argv, "n:i:oh")) != -1)
+	{
+		switch (c) {
+		case 'n':	strncpy (name, optarg, sizeof (name) - 1); break;
+		case 'i':	interval = atoi (optarg); break;
+		case 'o':	is_once = TRUE; break;
+
+		case 'h':
+		case '?': usage (argv[0]);
+		}
+	}
+	if ('\0' == name[0]) {
+		if (optind >= argc)
+			usage (argv[0]);
+		snprintf (name, sizeof (name), PGM_SHMSTATS_DEFAULT_NAME, atoi (argv[optind]));
+	}
+
+	const pgm_shmstats_t* stats = pgm_shmstats_attach (name, &pgm_err);
+	if (NULL == stats) {
+		fprintf (stderr, "Attaching statistics segment: %s\n", pgm_err->message);
+		pgm_error_free (pgm_err);
+		return EXIT_FAILURE;
+	}
+
+	for (;;) {
+/* never blocks the publisher, retry on a concurrent update */
+		uint32_t seq;
+		do {
+			seq = pgm_shmstats_read_begin (stats);
+			memcpy (&copy, stats, sizeof (copy));
+		} while (pgm_shmstats_read_retry (stats, seq));
+		print_snapshot ();
+		if (is_once)
+			break;
+#ifndef _WIN32
+		sleep (interval);
+#else
+		Sleep (interval * 1000);
+#endif
+		puts ("");
+	}
+
+	pgm_shmstats_detach (stats);
+	return EXIT_SUCCESS;
+}
+
+/* eof */
@@ -22,6 +22,7 @@
 #ifdef HAVE_CONFIG_H
 #	include <config.h>
 #endif
+#include <inttypes.h>
 #include <limits.h>
 #include <math.h>
 #include <stdlib.h>
@@ -85,6 +86,64 @@ pgm_histogram_write_html_graph_all (
 	}
 }
 
+/* one OpenMetrics series per histogram, cumulative buckets keyed by the
+ * inclusive upper bound of each range.
+ */
+
+void
+pgm_histogram_write_openmetrics_all (
+	pgm_string_t*		string
+	)
+{
+	if (!pgm_histograms)
+		return;
+	pgm_string_append (string, "# TYPE pgm_histogram histogram\n");
+	for (pgm_slist_t* snapshot = pgm_histograms; snapshot; snapshot = snapshot->next) {
+		const pgm_histogram_t* histogram = snapshot->data;
+		int64_t cumulative = 0;
+		for (unsigned i = 0; i < histogram->bucket_count - 1; i++) {
+			cumulative += histogram->sample.counts[ i ];
+			pgm_string_append_printf (string, "pgm_histogram_bucket{name=\"%s\",le=\"%d\"} %" PRIi64 "\n",
+						  histogram->histogram_name,
+						  histogram->ranges[ i + 1 ] - 1,
+						  cumulative);
+		}
+		cumulative += histogram->sample.counts[ histogram->bucket_count - 1 ];
+		pgm_string_append_printf (string, "pgm_histogram_bucket{name=\"%s\",le=\"+Inf\"} %" PRIi64 "\n"
+						  "pgm_histogram_count{name=\"%s\"} %" PRIi64 "\n"
+						  "pgm_histogram_sum{name=\"%s\"} %" PRIi64 "\n",
+					  histogram->histogram_name, cumulative,
+					  histogram->histogram_name, cumulative,
+					  histogram->histogram_name, histogram->sample.sum);
+	}
+}
+
+/* JSON object of histograms by name, each with per-bucket lower bounds and
+ * counts.
+ */
+
+void
+pgm_histogram_write_json_all (
+	pgm_string_t*		string
+	)
+{
+	pgm_string_append (string, "{");
+	for (pgm_slist_t* snapshot = pgm_histograms; snapshot; snapshot = snapshot->next) {
+		const pgm_histogram_t* histogram = snapshot->data;
+		pgm_string_append_printf (string, "%s\"%s\":{\"sum\":%" PRIi64 ",\"buckets\":[",
+					  snapshot == pgm_histograms ? "" : ",",
+					  histogram->histogram_name,
+					  histogram->sample.sum);
+		for (unsigned i = 0; i < histogram->bucket_count; i++)
+			pgm_string_append_printf (string, "%s[%d,%d]",
+						  i ? "," : "",
+						  histogram->ranges[ i ],
+						  histogram->sample.counts[ i ]);
+		pgm_string_append (string, "]}");
+	}
+	pgm_string_append (string, "}");
+}
+
 static
 void
 pgm_histogram_write_html_graph (
@@ -0,0 +1,237 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Host-local NAK suppression.  Receivers of the same source on one host
+ * claim each round of selective NAK for a sequence in a shared memory
+ * table, only the first claimant transmits and the others wait on the
+ * multicast NCF it provokes.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+#include <errno.h>
+#ifndef _WIN32
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+#include <impl/i18n.h>
+#include <impl/framework.h>
+#include <impl/hostnak.h>
+
+
+//#define HOSTNAK_DEBUG
+
+/* MurmurHash3 finaliser */
+static inline
+uint32_t
+hostnak_mix (
+	uint32_t		h
+	)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
+/* map the named segment, creating it on first use by any process of the
+ * user.  a segment another user owns or may open is refused as any process
+ * with access could suppress our NAKs.
+ *
+ * returns the mapping on success, returns NULL on failure with error set.
+ */
+
+PGM_GNUC_INTERNAL
+pgm_hostnak_t*
+pgm_hostnak_attach (
+	const char*	     restrict name,
+	pgm_error_t**	     restrict error
+	)
+{
+	pgm_hostnak_t* hostnak;
+
+	pgm_assert (NULL != name);
+
+	pgm_debug ("pgm_hostnak_attach (name:\"%s\" error:%p)",
+		name, (const void*)error);
+
+#ifndef _WIN32
+	const int fd = shm_open (name, O_CREAT | O_RDWR, 0600);
+	if (-1 == fd) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_errno (save_errno),
+			     _("Opening shared memory segment %s: %s"),
+			     name,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		return NULL;
+	}
+/* every process sizes the segment, the first one zero fills it */
+	struct stat buf;
+	if (0 != fstat (fd, &buf)) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_errno (save_errno),
+			     _("Sizing shared memory segment %s: %s"),
+			     name,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		close (fd);
+		return NULL;
+	}
+	if (buf.st_uid != geteuid() || 0 != (buf.st_mode & (S_IRWXG | S_IRWXO))) {
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     PGM_ERROR_PERM,
+			     _("Shared memory segment %s is not private to this user."),
+			     name);
+		close (fd);
+		return NULL;
+	}
+	if (buf.st_size < (off_t)sizeof (pgm_hostnak_t) && 0 != ftruncate (fd, sizeof (pgm_hostnak_t)))
+	{
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_errno (save_errno),
+			     _("Sizing shared memory segment %s: %s"),
+			     name,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		close (fd);
+		return NULL;
+	}
+	hostnak = mmap (NULL, sizeof (pgm_hostnak_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (MAP_FAILED == hostnak) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_errno (save_errno),
+			     _("Mapping shared memory segment %s: %s"),
+			     name,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		close (fd);
+		return NULL;
+	}
+	close (fd);
+#else
+	HANDLE mapping = CreateFileMappingA (INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof (pgm_hostnak_t), name);
+	if (NULL == mapping) {
+		const DWORD save_errno = GetLastError();
+		char winstr[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_win_errno (save_errno),
+			     _("Opening shared memory segment %s: %s"),
+			     name,
+			     pgm_win_strerror (winstr, sizeof (winstr), save_errno));
+		return NULL;
+	}
+	hostnak = MapViewOfFile (mapping, FILE_MAP_WRITE, 0, 0, sizeof (pgm_hostnak_t));
+	if (NULL == hostnak) {
+		const DWORD save_errno = GetLastError();
+		char winstr[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_win_errno (save_errno),
+			     _("Mapping shared memory segment %s: %s"),
+			     name,
+			     pgm_win_strerror (winstr, sizeof (winstr), save_errno));
+		CloseHandle (mapping);
+		return NULL;
+	}
+/* the view keeps the section and its name alive */
+	CloseHandle (mapping);
+#endif /* _WIN32 */
+
+	if (!pgm_atomic_compare_and_swap32 (&hostnak->magic, 0, PGM_HOSTNAK_MAGIC) &&
+	    PGM_HOSTNAK_MAGIC != pgm_atomic_read32 (&hostnak->magic))
+	{
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     PGM_ERROR_BADE,
+			     _("Shared memory segment %s is not a NAK suppression segment."),
+			     name);
+		pgm_hostnak_detach (hostnak);
+		return NULL;
+	}
+	return hostnak;
+}
+
+PGM_GNUC_INTERNAL
+void
+pgm_hostnak_detach (
+	pgm_hostnak_t*const	hostnak
+	)
+{
+	pgm_assert (NULL != hostnak);
+
+#ifndef _WIN32
+	munmap ((void*)hostnak, sizeof (pgm_hostnak_t));
+#else
+	UnmapViewOfFile (hostnak);
+#endif
+}
+
+/* claim NAK round for a sequence of a source.  the segment is never unlinked
+ * and slots are never cleared, a later round or sequence simply overwrites.
+ *
+ * returns TRUE if the caller should send the NAK, returns FALSE if another
+ * receiver on the host already has.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_hostnak_claim (
+	pgm_hostnak_t* const restrict hostnak,
+	const pgm_tsi_t* const restrict tsi,
+	const uint32_t		      sequence,
+	const unsigned		      round		/* NAKs already sent for sequence */
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != hostnak);
+	pgm_assert (NULL != tsi);
+
+	const uint32_t key = pgm_tsi_hash (tsi) ^ hostnak_mix (sequence);
+	volatile uint32_t* slot = &hostnak->slots[ key & (PGM_HOSTNAK_SLOTS - 1) ];
+	const uint32_t claim = hostnak_mix (key + round * 0x9e3779b9) | 1;
+	const uint32_t prev = pgm_atomic_read32 (slot);
+
+#ifdef HOSTNAK_DEBUG
+	pgm_debug ("pgm_hostnak_claim (hostnak:%p tsi:%s sequence:%" PRIu32 " round:%u) prev:%08x claim:%08x",
+		(const void*)hostnak, pgm_tsi_print (tsi), sequence, round, prev, claim);
+#endif
+
+	if (claim == prev)
+		return FALSE;
+/* losing the race to an equal claim suppresses, to any other only shares the slot */
+	return pgm_atomic_compare_and_swap32 (slot, prev, claim) ||
+	       claim != pgm_atomic_read32 (slot);
+}
+
+/* eof */
@@ -0,0 +1,201 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * unit tests for host-local NAK suppression.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <check.h>
+
+#ifdef _WIN32
+#	define PGM_CHECK_NOFORK		1
+#endif
+
+
+/* mock state */
+
+#define TEST_NAME		"/pgm-naks-unittest"
+
+#define HOSTNAK_DEBUG
+#include "hostnak.c"
+
+static const pgm_tsi_t test_tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+
+static
+void
+mock_teardown (void)
+{
+#ifndef _WIN32
+	shm_unlink (TEST_NAME);
+#endif
+}
+
+
+/* target:
+ *	pgm_hostnak_t*
+ *	pgm_hostnak_attach (
+ *		const char*		name,
+ *		pgm_error_t**		error
+ *	)
+ */
+
+START_TEST (test_attach_pass_001)
+{
+	pgm_error_t* err = NULL;
+	pgm_hostnak_t* hostnak = pgm_hostnak_attach (TEST_NAME, &err);
+	fail_unless (NULL != hostnak, "attach failed");
+	fail_unless (NULL == err, "error raised");
+	fail_unless (PGM_HOSTNAK_MAGIC == hostnak->magic, "magic failed");
+#ifndef _WIN32
+	const int fd = shm_open (TEST_NAME, O_RDONLY, 0);
+	struct stat buf;
+	fail_unless (-1 != fd && 0 == fstat (fd, &buf), "stat failed");
+	fail_unless (0600 == (buf.st_mode & 0777), "segment not private");
+	close (fd);
+#endif
+	pgm_hostnak_detach (hostnak);
+}
+END_TEST
+
+START_TEST (test_attach_fail_001)
+{
+	pgm_hostnak_attach (NULL, NULL);
+	fail ("reached");
+}
+END_TEST
+
+#ifndef _WIN32
+/* a segment others may open is refused */
+START_TEST (test_attach_fail_002)
+{
+	const int fd = shm_open (TEST_NAME, O_CREAT | O_RDWR, 0600);
+	fail_if (-1 == fd, "shm_open failed");
+	fail_unless (0 == fchmod (fd, 0666), "fchmod failed");
+	close (fd);
+	pgm_error_t* err = NULL;
+	fail_unless (NULL == pgm_hostnak_attach (TEST_NAME, &err), "attach succeeded");
+	fail_unless (NULL != err, "no error raised");
+	fail_unless (PGM_ERROR_PERM == err->code, "error code");
+	pgm_error_free (err);
+}
+END_TEST
+#endif
+
+/* target:
+ *	bool
+ *	pgm_hostnak_claim (
+ *		pgm_hostnak_t*		hostnak,
+ *		const pgm_tsi_t*	tsi,
+ *		const uint32_t		sequence,
+ *		const unsigned		round
+ *	)
+ */
+
+/* two mappings stand in for two receiving processes */
+START_TEST (test_claim_pass_001)
+{
+	pgm_hostnak_t* a = pgm_hostnak_attach (TEST_NAME, NULL);
+	pgm_hostnak_t* b = pgm_hostnak_attach (TEST_NAME, NULL);
+	fail_if (NULL == a || NULL == b, "attach failed");
+	fail_unless (TRUE == pgm_hostnak_claim (a, &test_tsi, 100, 0), "claim failed");
+	fail_unless (FALSE == pgm_hostnak_claim (b, &test_tsi, 100, 0), "claim not suppressed");
+/* next round and other sequences are independent */
+	fail_unless (TRUE == pgm_hostnak_claim (b, &test_tsi, 100, 1), "claim failed");
+	fail_unless (FALSE == pgm_hostnak_claim (a, &test_tsi, 100, 1), "claim not suppressed");
+	fail_unless (TRUE == pgm_hostnak_claim (b, &test_tsi, 101, 0), "claim failed");
+	pgm_hostnak_detach (a);
+	pgm_hostnak_detach (b);
+}
+END_TEST
+
+/* other sources never suppress */
+START_TEST (test_claim_pass_002)
+{
+	const pgm_tsi_t other_tsi = { { 1, 2, 3, 4, 5, 6 }, 1001 };
+	pgm_hostnak_t* hostnak = pgm_hostnak_attach (TEST_NAME, NULL);
+	fail_if (NULL == hostnak, "attach failed");
+	fail_unless (TRUE == pgm_hostnak_claim (hostnak, &test_tsi, 100, 0), "claim failed");
+	fail_unless (TRUE == pgm_hostnak_claim (hostnak, &other_tsi, 100, 0), "claim failed");
+	pgm_hostnak_detach (hostnak);
+}
+END_TEST
+
+START_TEST (test_claim_fail_001)
+{
+	const bool is_claimed = pgm_hostnak_claim (NULL, &test_tsi, 100, 0);
+	fail ("reached");
+}
+END_TEST
+
+
+static
+Suite*
+make_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create (__FILE__);
+
+	TCase* tc_attach = tcase_create ("attach");
+	suite_add_tcase (s, tc_attach);
+	tcase_add_checked_fixture (tc_attach, NULL, mock_teardown);
+	tcase_add_test (tc_attach, test_attach_pass_001);
+#ifndef _WIN32
+	tcase_add_test (tc_attach, test_attach_fail_002);
+#endif
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_attach, test_attach_fail_001, SIGABRT);
+#endif
+
+	TCase* tc_claim = tcase_create ("claim");
+	suite_add_tcase (s, tc_claim);
+	tcase_add_checked_fixture (tc_claim, NULL, mock_teardown);
+	tcase_add_test (tc_claim, test_claim_pass_001);
+	tcase_add_test (tc_claim, test_claim_pass_002);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_claim, test_claim_fail_001, SIGABRT);
+#endif
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	pgm_messages_init();
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_test_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	pgm_messages_shutdown();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
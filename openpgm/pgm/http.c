@@ -22,10 +22,15 @@
 #ifdef HAVE_CONFIG_H
 #	include <config.h>
 #endif
+#include <ctype.h>
 #include <errno.h>
 #include <inttypes.h>
+#ifdef HAVE_EPOLL_CTL
+#	include <sys/epoll.h>
+#endif
 #ifndef _WIN32
 #	include <netdb.h>
+#	include <sched.h>
 #else
 #	include <io.h>
 #	include <lmcons.h>
@@ -38,6 +43,7 @@
 #include <impl/receiver.h>
 #include <impl/socket.h>
 #include <pgm/if.h>
+#include <pgm/shmstats.h>
 #include <pgm/version.h>
 
 #include "pgm/http.h"
@@ -70,7 +76,16 @@
 #endif
 
 #define HTTP_BACKLOG			10 /* connections */
-#define HTTP_TIMEOUT			60 /* seconds */
+#define HTTP_TIMEOUT			60 /* seconds idle before closing a connection */
+#define HTTP_MAX_CONNECTIONS		64
+#define HTTP_MAX_REQUEST		8192 /* bytes of request line and headers */
+#define HTTP_MAX_KEEPALIVE		100 /* requests per connection */
+#define HTTP_POLL_INTERVAL		1000 /* milliseconds between idle checks */
+#define HTTP_MAX_EVENTS			16
+#define HTTP_STATS_INTERVAL		1000 /* milliseconds when PGM_HTTP_METRICS has no value */
+
+#define HTTP_OPENMETRICS_TYPE		"application/openmetrics-text; version=1.0.0; charset=utf-8"
+#define HTTP_NO_STATS			"Statistics snapshot unavailable, enable with PGM_HTTP_METRICS or pgm_shmstats_init().\n"
 
 
 /* locals */
@@ -83,6 +98,15 @@ struct http_connection_t {
 		HTTP_STATE_WRITE,
 		HTTP_STATE_FINWAIT
 	}		state;
+	time_t		last_active;
+	unsigned	requests;		/* served on this connection */
+	bool		is_http11;
+	bool		is_keepalive;
+
+/* fixed request buffer, pipelined requests are kept after the current one */
+	char		request[HTTP_MAX_REQUEST + 1];
+	size_t		request_len;
+	size_t		request_consumed;
 
 	char*		buf;
 	size_t		buflen;
@@ -110,13 +134,37 @@ static void*			http_routine (void*);
 static HANDLE			http_thread;
 static unsigned __stdcall	http_routine (void*);
 #endif
+#ifdef HAVE_EPOLL_CTL
+static int			http_epfd = -1;
+#else
 static SOCKET			http_max_sock = INVALID_SOCKET;
 static fd_set			http_readfds, http_writefds, http_exceptfds;
+#endif
 static pgm_list_t*		http_socks = NULL;
+static unsigned			http_connection_count = 0;
+#if defined( CPU_SETSIZE )
+static cpu_set_t		http_cpu_set;		/* of the process at init */
+#elif defined( _WIN32 )
+static DWORD_PTR		http_cpu_set;
+#endif
 static pgm_notify_t		http_notify = PGM_NOTIFY_INIT;
 static volatile uint32_t	http_ref_count = 0;
+static bool			http_has_stats = FALSE;
+
+static const char* http_latency_names[] = {
+	"send",
+	"rate_limited",
+	"delivery",
+	"fec_decode"
+};
+
+PGM_STATIC_ASSERT(PGM_N_ELEMENTS(http_latency_names) == PGM_LATENCY_MAX);
 
 
+static void http_set_status (struct http_connection_t*restrict, int, const char*restrict);
+static void http_set_content_type (struct http_connection_t*restrict, const char*restrict);
+static void http_set_static_response (struct http_connection_t*restrict, const char*restrict, size_t);
+static void http_stats_init (void);
 static int http_tsi_response (struct http_connection_t*restrict, const pgm_tsi_t*restrict);
 static void http_each_receiver (const pgm_sock_t*restrict, const pgm_peer_t*restrict, pgm_string_t*restrict);
 static int http_receiver_response (struct http_connection_t*restrict, const pgm_sock_t*restrict, const pgm_peer_t*restrict);
@@ -128,6 +176,8 @@ static void index_callback (struct http_connection_t*restrict, const char*restri
 static void interfaces_callback (struct http_connection_t*restrict, const char*restrict);
 static void transports_callback (struct http_connection_t*restrict, const char*restrict);
 static void histograms_callback (struct http_connection_t*restrict, const char*restrict);
+static void metrics_callback (struct http_connection_t*restrict, const char*restrict);
+static void metrics_json_callback (struct http_connection_t*restrict, const char*restrict);
 
 static struct {
 	const char*	path;
@@ -137,49 +187,15 @@ static struct {
 	{ "/base.css",		css_callback },
 	{ "/",			index_callback },
 	{ "/interfaces",	interfaces_callback },
-	{ "/transports",	transports_callback }
+	{ "/transports",	transports_callback },
+	{ "/metrics",		metrics_callback },
+	{ "/metrics.json",	metrics_json_callback }
 #ifdef USE_HISTOGRAMS
        ,{ "/histograms",	histograms_callback }
 #endif
 };
 
 
-static
-int
-http_sock_rcvtimeo (
-	SOCKET			sock,
-	int			seconds
-	)
-{
-#if defined( __sun )
-	return 0;
-#elif !defined( _WIN32 )
-	const struct timeval timeout = { .tv_sec = seconds, .tv_usec = 0 };
-	return setsockopt (sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
-#else
-	const int optval = seconds * 1000;
-	return setsockopt (sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&optval, sizeof(optval));
-#endif
-}
-
-static
-int
-http_sock_sndtimeo (
-	SOCKET			sock,
-	int			seconds
-	)
-{
-#if defined( __sun )
-	return 0;
-#elif !defined( _WIN32 )
-	const struct timeval timeout = { .tv_sec = seconds, .tv_usec = 0 };
-	return setsockopt (sock, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
-#else
-	const int optval = seconds * 1000;
-	return setsockopt (sock, SOL_SOCKET, SO_SNDTIMEO, (const char*)&optval, sizeof(optval));
-#endif
-}
-
 bool
 pgm_http_init (
 	in_port_t		http_port,
@@ -286,17 +302,6 @@ pgm_http_init (
 				pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
 		goto err_cleanup;
 	}
-	if (0 != http_sock_rcvtimeo (http_sock, HTTP_TIMEOUT) ||
-	    0 != http_sock_sndtimeo (http_sock, HTTP_TIMEOUT)) {
-		const int save_errno = pgm_get_last_sock_error();
-		char errbuf[1024];
-		pgm_set_error (error,
-				PGM_ERROR_DOMAIN_HTTP,
-				pgm_error_from_sock_errno (save_errno),
-				_("Setting socket timeout: %s"),
-				pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
-		goto err_cleanup;
-	}
 	struct sockaddr_in http_addr;
 	memset (&http_addr, 0, sizeof(http_addr));
 	http_addr.sin_family = AF_INET;
@@ -341,6 +346,30 @@ pgm_http_init (
 		goto err_cleanup;
 	}
 
+#ifdef HAVE_EPOLL_CTL
+	http_epfd = epoll_create (HTTP_MAX_CONNECTIONS);
+	if (-1 == http_epfd) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_HTTP,
+			     pgm_error_from_errno (save_errno),
+			     _("Creating HTTP event set: %s"),
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		goto err_cleanup;
+	}
+#endif
+
+/* processors available before any engine thread is pinned */
+#if defined( CPU_SETSIZE )
+	if (0 != sched_getaffinity (0, sizeof (http_cpu_set), &http_cpu_set))
+		CPU_ZERO (&http_cpu_set);
+#elif defined( _WIN32 )
+	DWORD_PTR system_mask;
+	if (!GetProcessAffinityMask (GetCurrentProcess(), &http_cpu_set, &system_mask))
+		http_cpu_set = 0;
+#endif
+
 /* spawn thread to handle HTTP requests */
 #ifndef _WIN32
 	const int status = pthread_create (&http_thread, NULL, &http_routine, NULL);
@@ -367,6 +396,8 @@ pgm_http_init (
 		goto err_cleanup;
 	}
 #endif /* _WIN32 */
+
+	http_stats_init ();
 	pgm_minor (_("Web interface: http://%s:%i"),
 			http_hostname,
 			http_port);
@@ -377,6 +408,12 @@ err_cleanup:
 		closesocket (http_sock);
 		http_sock = INVALID_SOCKET;
 	}
+#ifdef HAVE_EPOLL_CTL
+	if (-1 != http_epfd) {
+		close (http_epfd);
+		http_epfd = -1;
+	}
+#endif
 	if (pgm_notify_is_valid (&http_notify)) {
 		pgm_notify_destroy (&http_notify);
 	}
@@ -384,6 +421,33 @@ err_cleanup:
 	return FALSE;
 }
 
+/* metrics are rendered from the published snapshot so that scraping never
+ * takes the socket or peer locks.  the server starts a publisher only when
+ * PGM_HTTP_METRICS is set, its value the interval in milliseconds, otherwise
+ * the metrics pages follow a segment the application publishes itself.
+ */
+
+static
+void
+http_stats_init (void)
+{
+	pgm_error_t* stats_error = NULL;
+	char* env;
+	size_t envlen;
+
+	const errno_t err = pgm_dupenv_s (&env, &envlen, "PGM_HTTP_METRICS");
+	if (0 != err || 0 == envlen)
+		return;
+	const int interval = atoi (env);
+	pgm_free (env);
+	http_has_stats = pgm_shmstats_init (NULL, interval > 0 ? (unsigned)interval : HTTP_STATS_INTERVAL, &stats_error);
+	if (!http_has_stats) {
+		pgm_warn (_("Metrics unavailable: %s"),
+			(stats_error && stats_error->message) ? stats_error->message : "(null)");
+		pgm_error_free (stats_error);
+	}
+}
+
 /* notify HTTP thread to shutdown, wait for shutdown and cleanup.
  */
 
@@ -402,14 +466,149 @@ pgm_http_shutdown (void)
 	WaitForSingleObject (http_thread, INFINITE);
 	CloseHandle (http_thread);
 #endif
+	if (http_has_stats) {
+		pgm_shmstats_shutdown ();
+		http_has_stats = FALSE;
+	}
 	if (INVALID_SOCKET != http_sock) {
 		closesocket (http_sock);
 		http_sock = INVALID_SOCKET;
 	}
+#ifdef HAVE_EPOLL_CTL
+	close (http_epfd);
+	http_epfd = -1;
+#endif
 	pgm_notify_destroy (&http_notify);
 	return TRUE;
 }
 
+/* register interest in readability or writability of a socket matching the
+ * connection state, the listen socket and notification channel have no
+ * connection.
+ */
+
+#ifdef HAVE_EPOLL_CTL
+static
+int
+http_poll_ctl (
+	int				op,
+	SOCKET				sock,
+	uint32_t			events,
+	void*				data
+	)
+{
+	struct epoll_event event;
+	memset (&event, 0, sizeof (event));
+	event.events = events;
+	event.data.ptr = data;
+	return epoll_ctl (http_epfd, op, sock, &event);
+}
+#endif
+
+static
+bool
+http_poll_add (
+	struct http_connection_t*	connection
+	)
+{
+#ifdef HAVE_EPOLL_CTL
+	return 0 == http_poll_ctl (EPOLL_CTL_ADD, connection->sock, EPOLLIN, connection);
+#else
+	FD_SET( connection->sock, &http_readfds );
+	FD_SET( connection->sock, &http_exceptfds );
+	if (connection->sock > http_max_sock)
+		http_max_sock = connection->sock;
+	return TRUE;
+#endif
+}
+
+static
+void
+http_poll_update (
+	struct http_connection_t*	connection
+	)
+{
+	const bool is_write = (HTTP_STATE_WRITE == connection->state);
+#ifdef HAVE_EPOLL_CTL
+	http_poll_ctl (EPOLL_CTL_MOD, connection->sock, is_write ? EPOLLOUT : EPOLLIN, connection);
+#else
+	if (is_write) {
+		FD_CLR( connection->sock, &http_readfds );
+		FD_SET( connection->sock, &http_writefds );
+	} else {
+		FD_CLR( connection->sock, &http_writefds );
+		FD_SET( connection->sock, &http_readfds );
+	}
+#endif
+}
+
+static
+void
+http_poll_remove (
+	struct http_connection_t*	connection
+	)
+{
+#ifdef HAVE_EPOLL_CTL
+/* closing the descriptor removes it from the set */
+	(void)connection;
+#else
+	FD_CLR( connection->sock, &http_readfds );
+	FD_CLR( connection->sock, &http_writefds );
+	FD_CLR( connection->sock, &http_exceptfds );
+/* find new highest fd */
+	if (connection->sock == http_max_sock)
+	{
+		http_max_sock = INVALID_SOCKET;
+		for (pgm_list_t* list = http_socks; list; list = list->next)
+		{
+			struct http_connection_t* c = (void*)list;
+			if (c != connection && c->sock > http_max_sock)
+				http_max_sock = c->sock;
+		}
+	}
+#endif
+}
+
+/* keep the server thread off processors dedicated to engine threads, the
+ * set is evaluated once as the thread starts so engines pinned by sockets
+ * created later are not excluded.
+ */
+
+static
+void
+http_bind_cpus (void)
+{
+#if defined( CPU_SETSIZE )
+	cpu_set_t cpu_set;
+	memcpy (&cpu_set, &http_cpu_set, sizeof (cpu_set));
+	if (0 == CPU_COUNT (&cpu_set))
+		return;
+	pgm_rwlock_reader_lock (&pgm_sock_list_lock);
+	for (pgm_slist_t* list = pgm_sock_list; list; list = list->next) {
+		const pgm_sock_t* sock = list->data;
+		if (sock->engine_affinity >= 0 && sock->engine_affinity < CPU_SETSIZE)
+			CPU_CLR (sock->engine_affinity, &cpu_set);
+	}
+	pgm_rwlock_reader_unlock (&pgm_sock_list_lock);
+/* every processor is taken, share with the lowest priority */
+	if (0 == CPU_COUNT (&cpu_set))
+		return;
+	pthread_setaffinity_np (pthread_self(), sizeof (cpu_set), &cpu_set);
+#elif defined( _WIN32 )
+	DWORD_PTR cpu_set = http_cpu_set;
+	pgm_rwlock_reader_lock (&pgm_sock_list_lock);
+	for (pgm_slist_t* list = pgm_sock_list; list; list = list->next) {
+		const pgm_sock_t* sock = list->data;
+		if (sock->engine_affinity >= 0 && sock->engine_affinity < (int)(sizeof (DWORD_PTR) * 8))
+			cpu_set &= ~((DWORD_PTR)1 << sock->engine_affinity);
+	}
+	pgm_rwlock_reader_unlock (&pgm_sock_list_lock);
+	if (0 == cpu_set)
+		return;
+	SetThreadAffinityMask (GetCurrentThread(), cpu_set);
+#endif
+}
+
 /* accept a new incoming HTTP connection.
  */
 
@@ -433,7 +632,12 @@ http_accept (
 		return;
 	}
 
-#ifndef _WIN32
+	if (http_connection_count >= HTTP_MAX_CONNECTIONS) {
+		closesocket (new_sock);
+		pgm_warn (_("Rejected new HTTP client socket as %u connections are open."), http_connection_count);
+		return;
+	}
+#if !defined( HAVE_EPOLL_CTL ) && !defined( _WIN32 )
 /* out of bounds file descriptor for select() */
 	if (new_sock >= FD_SETSIZE) {
 		closesocket (new_sock);
@@ -447,11 +651,18 @@ http_accept (
 	struct http_connection_t* connection = pgm_new0 (struct http_connection_t, 1);
 	connection->sock = new_sock;
 	connection->state = HTTP_STATE_READ;
+	connection->last_active = time (NULL);
+	if (!http_poll_add (connection)) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_warn (_("Adding HTTP client socket to event set: %s"),
+			pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		closesocket (new_sock);
+		pgm_free (connection);
+		return;
+	}
 	http_socks = pgm_list_prepend_link (http_socks, &connection->link_);
-	FD_SET( new_sock, &http_readfds );
-	FD_SET( new_sock, &http_exceptfds );
-	if (new_sock > http_max_sock)
-		http_max_sock = new_sock;
+	http_connection_count++;
 }
 
 static
@@ -460,97 +671,115 @@ http_close (
 	struct http_connection_t*	connection
 	)
 {
+	http_poll_remove (connection);
 	if (SOCKET_ERROR == closesocket (connection->sock)) {
 		const int save_errno = pgm_get_last_sock_error();
 		char errbuf[1024];
 		pgm_warn (_("Close HTTP client socket: %s"),
 			pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
 	}
-	switch (connection->state) {
-	case HTTP_STATE_READ:
-	case HTTP_STATE_FINWAIT:
-		FD_CLR( connection->sock, &http_readfds );
-		break;
-	case HTTP_STATE_WRITE:
-		FD_CLR( connection->sock, &http_writefds );
-		break;
-	}
-	FD_CLR( connection->sock, &http_exceptfds );
 	http_socks = pgm_list_remove_link (http_socks, &connection->link_);
+	http_connection_count--;
 	if (connection->buflen > 0) {
 		pgm_free (connection->buf);
 		connection->buf = NULL;
 		connection->buflen = 0;
 	}
-/* find new highest fd */
-	if (connection->sock == http_max_sock)
-	{
-		http_max_sock = INVALID_SOCKET;
-		for (pgm_list_t* list = http_socks; list; list = list->next)
-		{
-			struct http_connection_t* c = (void*)list;
-			if (c->sock > http_max_sock)
-				http_max_sock = c->sock;
-		}
-	}
 	pgm_free (connection);
 }
 
-/* non-blocking read an incoming HTTP request
+/* case insensitive search of a comma separated header value, e.g.
+ * Connection: keep-alive
  */
 
 static
-void
-http_read (
-	struct http_connection_t*	connection
+bool
+http_has_header_token (
+	const char*	restrict headers,
+	const char*	restrict name,
+	const char*	restrict token
 	)
 {
-	for (;;)
+	const size_t name_len  = strlen (name);
+	const size_t token_len = strlen (token);
+	for (const char* line = strstr (headers, "\r\n"); line && line[2] != '\r'; line = strstr (line + 2, "\r\n"))
 	{
-/* grow buffer as needed */
-		if (connection->bufoff + 1024  > connection->buflen) {
-			connection->buf = pgm_realloc (connection->buf, connection->buflen + 1024);
-			connection->buflen += 1024;
-		}
-		const ssize_t bytes_read = recv (connection->sock, &connection->buf[ connection->bufoff ], connection->buflen - connection->bufoff, 0);
-		if (bytes_read < 0) {
-			const int save_errno = pgm_get_last_sock_error();
-			char errbuf[1024];
-			if (PGM_SOCK_EINTR == save_errno || PGM_SOCK_EAGAIN == save_errno)
-				return;
-			pgm_warn (_("HTTP client read: %s"),
-				pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
-			http_close (connection);
-			return;
+		const char* p = line + 2;
+		unsigned i;
+		for (i = 0; i < name_len && tolower ((unsigned char)p[i]) == name[i]; i++);
+		if (i < name_len || ':' != p[i])
+			continue;
+		for (p += name_len + 1; *p && *p != '\r'; p++) {
+			for (i = 0; i < token_len && tolower ((unsigned char)p[i]) == token[i]; i++);
+			if (i == token_len)
+				return TRUE;
 		}
-
-/* complete */
-		if (strstr (connection->buf, "\r\n\r\n"))
-			break;
 	}
+	return FALSE;
+}
 
-/* process request, e.g. GET /index.html HTTP/1.1\r\n
+/* protocol version of the request line, an incomplete line is HTTP/1.0.
  */
-	connection->buf[ connection->buflen - 1 ] = '\0';
-	if (0 != memcmp (connection->buf, "GET ", strlen("GET "))) {
-/* 501 (not implemented) */
-		http_close (connection);
-		return;
-	}
 
-	char* request_uri = connection->buf + strlen("GET ");
-	char* p = request_uri;
-	do {
-		if (*p == '?' || *p == ' ') {
-			*p = '\0';
-			break;
-		}
-	} while (*(++p));
+static
+bool
+http_is_http11 (
+	const char*	request
+	)
+{
+	const char* eol = strstr (request, "\r\n");
+	const char* request_uri = strchr (request, ' ');
+	const char* version = request_uri ? strchr (request_uri + 1, ' ') : NULL;
+	return (NULL != eol && NULL != version && version < eol &&
+		0 == strncmp (version + 1, "HTTP/1.1", strlen("HTTP/1.1")));
+}
+
+/* process one complete request, e.g. GET /index.html HTTP/1.1\r\n
+ */
+
+static
+void
+http_dispatch (
+	struct http_connection_t*	connection
+	)
+{
+	char* request = connection->request;
+	char* end = strstr (request, "\r\n\r\n");
+	pgm_assert (NULL != end);
+	connection->request_consumed = (end + 4) - request;
+	end[2] = '\0';
 
 	connection->status_code	 = 200;	/* OK */
 	connection->status_text  = "OK";
 	connection->content_type = "text/html";
 	connection->bufoff       = 0;
+	connection->requests++;
+
+	char* request_uri = strchr (request, ' ');
+	char* version = request_uri ? strchr (request_uri + 1, ' ') : NULL;
+	connection->is_http11 = http_is_http11 (request);
+	if (connection->requests >= HTTP_MAX_KEEPALIVE)
+		connection->is_keepalive = FALSE;
+	else if (connection->is_http11)
+		connection->is_keepalive = !http_has_header_token (request, "connection", "close");
+	else
+		connection->is_keepalive = http_has_header_token (request, "connection", "keep-alive");
+
+	if (0 != memcmp (request, "GET ", strlen("GET ")) || NULL == version) {
+		static const char not_implemented[] = "Not Implemented\n";
+		connection->is_keepalive = FALSE;
+		http_set_status (connection, 501, "Not Implemented");
+		http_set_content_type (connection, "text/plain");
+		http_set_static_response (connection, not_implemented, strlen (not_implemented));
+		goto complete;
+	}
+
+	request_uri++;
+	*version = '\0';
+	char* p = strchr (request_uri, '?');
+	if (NULL != p)
+		*p = '\0';
+
 	for (unsigned i = 0; i < PGM_N_ELEMENTS(http_directory); i++)
 	{
 		if (0 == strcmp (request_uri, http_directory[i].path))
@@ -563,11 +792,67 @@ http_read (
 
 complete:
 	connection->state = HTTP_STATE_WRITE;
-	FD_CLR( connection->sock, &http_readfds );
-	FD_SET( connection->sock, &http_writefds );
+	http_poll_update (connection);
 }
 
-/* non-blocking write a HTTP response
+/* non-blocking read an incoming HTTP request into the fixed connection
+ * buffer, oversized requests are refused.
+ */
+
+static
+void
+http_read (
+	struct http_connection_t*	connection
+	)
+{
+	for (;;)
+	{
+		if (connection->request_len == HTTP_MAX_REQUEST) {
+			static const char too_large[] = "Request Header Fields Too Large\n";
+/* never answer with the version of a previous request */
+			connection->is_http11 = http_is_http11 (connection->request);
+			connection->is_keepalive = FALSE;
+			http_set_status (connection, 431, "Request Header Fields Too Large");
+			http_set_content_type (connection, "text/plain");
+			http_set_static_response (connection, too_large, strlen (too_large));
+			connection->request_consumed = connection->request_len;
+			connection->bufoff = 0;
+			connection->state = HTTP_STATE_WRITE;
+			http_poll_update (connection);
+			return;
+		}
+		const ssize_t bytes_read = recv (connection->sock,
+						 &connection->request[ connection->request_len ],
+						 HTTP_MAX_REQUEST - connection->request_len,
+						 0);
+		if (bytes_read < 0) {
+			const int save_errno = pgm_get_last_sock_error();
+			char errbuf[1024];
+			if (PGM_SOCK_EINTR == save_errno || PGM_SOCK_EAGAIN == save_errno)
+				return;
+			pgm_warn (_("HTTP client read: %s"),
+				pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			http_close (connection);
+			return;
+		}
+/* orderly shutdown by client */
+		if (0 == bytes_read) {
+			http_close (connection);
+			return;
+		}
+		connection->last_active = time (NULL);
+		connection->request_len += bytes_read;
+		connection->request[ connection->request_len ] = '\0';
+
+/* complete */
+		if (strstr (connection->request, "\r\n\r\n"))
+			break;
+	}
+	http_dispatch (connection);
+}
+
+/* non-blocking write a HTTP response, on completion either wait for the next
+ * request or close the connection.
  */
 
 static
@@ -589,15 +874,34 @@ http_write (
 			return;
 		}
 		connection->bufoff += bytes_written;
+		connection->last_active = time (NULL);
 	} while (connection->bufoff < connection->buflen);
 
+	pgm_free (connection->buf);
+	connection->buf = NULL;
+	connection->buflen = connection->bufoff = 0;
+
+	if (connection->is_keepalive) {
+/* retain any pipelined request */
+		connection->request_len -= connection->request_consumed;
+		memmove (connection->request, &connection->request[ connection->request_consumed ], connection->request_len);
+		connection->request[ connection->request_len ] = '\0';
+		connection->request_consumed = 0;
+		if (strstr (connection->request, "\r\n\r\n")) {
+			http_dispatch (connection);
+			return;
+		}
+		connection->state = HTTP_STATE_READ;
+		http_poll_update (connection);
+		return;
+	}
+
 	if (0 == shutdown (connection->sock, SHUT_WR)) {
 		http_close (connection);
 	} else {
 		pgm_debug ("HTTP socket entering finwait state.");
 		connection->state = HTTP_STATE_FINWAIT;
-		FD_CLR( connection->sock, &http_writefds );
-		FD_SET( connection->sock, &http_readfds );
+		http_poll_update (connection);
 	}
 }
 
@@ -633,6 +937,26 @@ http_process (
 	}
 }
 
+/* close connections without activity, a slow client only holds its own
+ * buffers.
+ */
+
+static
+void
+http_expire (void)
+{
+	const time_t now = time (NULL);
+	for (pgm_list_t* list = http_socks; list;)
+	{
+		struct http_connection_t* c = (void*)list;
+		list = list->next;
+		if (now - c->last_active >= HTTP_TIMEOUT) {
+			pgm_debug ("Closing idle HTTP connection.");
+			http_close (c);
+		}
+	}
+}
+
 static
 void
 http_set_status (
@@ -666,18 +990,20 @@ http_set_static_response (
 	)
 {
 	pgm_string_t* response = pgm_string_new (NULL);
-	pgm_string_printf (response, "HTTP/1.0 %d %s\r\n"
+	pgm_string_printf (response, "HTTP/1.%d %d %s\r\n"
 				     "Server: OpenPGM HTTP Server %u.%u.%u\r\n"
 			   	     "Last-Modified: Fri, 1 Jan 2010, 00:00:01 GMT\r\n"
 				     "Content-Length: %" PRIzd "\r\n"
 				     "Content-Type: %s\r\n"
-				     "Connection: close\r\n"
+				     "Connection: %s\r\n"
 				     "\r\n",
+			   connection->is_http11 ? 1 : 0,
 			   connection->status_code,
 			   connection->status_text,
 			   pgm_major_version, pgm_minor_version, pgm_micro_version,
 			   content_length,
-			   connection->content_type
+			   connection->content_type,
+			   connection->is_keepalive ? "keep-alive" : "close"
 			);
 	pgm_string_append (response, content);
 	if (connection->buflen)
@@ -695,17 +1021,19 @@ http_set_response (
 	)
 {
 	pgm_string_t* response = pgm_string_new (NULL);
-	pgm_string_printf (response, "HTTP/1.0 %d %s\r\n"
+	pgm_string_printf (response, "HTTP/1.%d %d %s\r\n"
 				     "Server: OpenPGM HTTP Server %u.%u.%u\r\n"
 				     "Content-Length: %" PRIzd "\r\n"
 				     "Content-Type: %s\r\n"
-				     "Connection: close\r\n"
+				     "Connection: %s\r\n"
 				     "\r\n",
+			   connection->is_http11 ? 1 : 0,
 			   connection->status_code,
 			   connection->status_text,
 			   pgm_major_version, pgm_minor_version, pgm_micro_version,
 			   content_length,
-			   connection->content_type
+			   connection->content_type,
+			   connection->is_keepalive ? "keep-alive" : "close"
 			);
 	pgm_string_append (response, content);
 	pgm_free (content);
@@ -730,6 +1058,47 @@ http_routine (
 	)
 {
 	const SOCKET notify_fd = pgm_notify_get_socket (&http_notify);
+
+/* monitoring must never compete with the protocol threads */
+#ifndef _WIN32
+	const struct sched_param param = { .sched_priority = 0 };
+#	ifdef SCHED_IDLE
+	pthread_setschedparam (pthread_self(), SCHED_IDLE, &param);
+#	else
+	pthread_setschedparam (pthread_self(), SCHED_OTHER, &param);
+#	endif
+#else
+	SetThreadPriority (GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#endif
+	http_bind_cpus ();
+
+#ifdef HAVE_EPOLL_CTL
+	struct epoll_event events[HTTP_MAX_EVENTS];
+	http_poll_ctl (EPOLL_CTL_ADD, notify_fd, EPOLLIN, &http_notify);
+	http_poll_ctl (EPOLL_CTL_ADD, http_sock, EPOLLIN, &http_sock);
+
+	for (;;)
+	{
+		const int ready = epoll_wait (http_epfd, events, HTTP_MAX_EVENTS, HTTP_POLL_INTERVAL);
+/* signal interrupt */
+		if (PGM_UNLIKELY(-1 == ready && EINTR == errno))
+			continue;
+		for (int i = 0; i < ready; i++)
+		{
+/* terminate */
+			if (PGM_UNLIKELY(&http_notify == events[i].data.ptr))
+				goto cleanup;
+/* new connection */
+			if (&http_sock == events[i].data.ptr) {
+				http_accept (http_sock);
+				continue;
+			}
+/* existing connection, each appears once per wait so no stale pointers */
+			http_process (events[i].data.ptr);
+		}
+		http_expire ();
+	}
+#else
 	const int max_fd = MAX( notify_fd, http_sock );
 
 	FD_ZERO( &http_readfds );
@@ -742,34 +1111,37 @@ http_routine (
 	{
 		int fds = MAX( http_max_sock, max_fd ) + 1;
 		fd_set readfds = http_readfds, writefds = http_writefds, exceptfds = http_exceptfds;
+		struct timeval timeout = { .tv_sec = HTTP_POLL_INTERVAL / 1000, .tv_usec = 0 };
 
-		fds = select (fds, &readfds, &writefds, &exceptfds, NULL);
+		fds = select (fds, &readfds, &writefds, &exceptfds, &timeout);
 /* signal interrupt */
 		if (PGM_UNLIKELY(SOCKET_ERROR == fds && PGM_SOCK_EINTR == pgm_get_last_sock_error()))
 			continue;
 /* terminate */
 		if (PGM_UNLIKELY(FD_ISSET( notify_fd, &readfds )))
-			break;
+			goto cleanup;
 /* new connection */
-		if (FD_ISSET( http_sock, &readfds )) {
+		if (FD_ISSET( http_sock, &readfds ))
 			http_accept (http_sock);
-			continue;
-		}
 /* existing connection */
 		for (pgm_list_t* list = http_socks; list;)
 		{
 			struct http_connection_t* c = (void*)list;
 			list = list->next;
-			if ((FD_ISSET( c->sock, &readfds )  && HTTP_STATE_READ  == c->state) ||
+			if ((FD_ISSET( c->sock, &readfds )  && HTTP_STATE_WRITE != c->state) ||
 			    (FD_ISSET( c->sock, &writefds ) && HTTP_STATE_WRITE == c->state) ||
 			    (FD_ISSET( c->sock, &exceptfds )))
 			{
 				http_process (c);
 			}
 		}
+		http_expire ();
 	}
+#endif /* HAVE_EPOLL_CTL */
 
-/* cleanup */
+cleanup:
+	while (http_socks)
+		http_close ((struct http_connection_t*)http_socks);
 #ifndef _WIN32
 	return NULL;
 #else
@@ -1073,6 +1445,320 @@ histograms_callback (
 	http_finalize_response (connection, response);
 }
 
+/* counters that may decrease are exported as gauges */
+
+static
+bool
+http_is_gauge (
+	const char*		name
+	)
+{
+	const size_t len = strlen (name);
+	return (len > 5 && 0 == strcmp (name + len - 5, "_mean")) ||
+	       (len > 5 && 0 == strcmp (name + len - 5, "_rate"));
+}
+
+/* append value as a quoted JSON string.
+ */
+
+static
+void
+http_append_json_string (
+	pgm_string_t*restrict	response,
+	const char*restrict	value
+	)
+{
+	pgm_string_append_c (response, '"');
+	for (const unsigned char* p = (const unsigned char*)value; *p; p++) {
+		switch (*p) {
+		case '"':	pgm_string_append (response, "\\\""); break;
+		case '\\':	pgm_string_append (response, "\\\\"); break;
+		default:
+			if (*p < 0x20)
+				pgm_string_append_printf (response, "\\u%04x", (unsigned)*p);
+			else
+				pgm_string_append_c (response, (char)*p);
+			break;
+		}
+	}
+	pgm_string_append_c (response, '"');
+}
+
+/* take a consistent copy of the published statistics, on failure the
+ * response is set to 503 (service unavailable).
+ */
+
+static
+pgm_shmstats_t*
+http_read_stats (
+	struct http_connection_t*	connection
+	)
+{
+	pgm_shmstats_t* stats = pgm_new (pgm_shmstats_t, 1);
+	if (!pgm_shmstats_read (stats)) {
+		pgm_free (stats);
+		http_set_status (connection, 503, "Service Unavailable");
+		http_set_content_type (connection, "text/plain");
+		http_set_static_response (connection, HTTP_NO_STATS, strlen(HTTP_NO_STATS));
+		return NULL;
+	}
+	return stats;
+}
+
+/* process-wide latency as an OpenMetrics histogram with power of two bounds,
+ * each bound coincides with the upper value of a latency bucket.
+ */
+
+static
+void
+http_write_latency_openmetrics (
+	pgm_string_t*		response
+	)
+{
+	pgm_latency_t* latency = pgm_new (pgm_latency_t, 1);
+	pgm_string_append (response, "# TYPE pgm_latency_microseconds histogram\n");
+	for (int metric = 0; metric < PGM_LATENCY_MAX; metric++) {
+		const char* name = http_latency_names[ metric ];
+		uint64_t cumulative = 0;
+		pgm_latency_snapshot (metric, latency);
+		for (unsigned i = 0; i < PGM_LATENCY_BUCKETS && latency->count > 0; i++) {
+			const uint64_t value = pgm_latency_bucket_value (i);
+			cumulative += latency->counts[ i ];
+			if (0 != ((value + 1) & value))
+				continue;
+			pgm_string_append_printf (response, "pgm_latency_microseconds_bucket{metric=\"%s\",le=\"%" PRIu64 "\"} %" PRIu64 "\n",
+						  name, value, cumulative);
+			if (cumulative == latency->count)
+				break;
+		}
+		pgm_string_append_printf (response, "pgm_latency_microseconds_bucket{metric=\"%s\",le=\"+Inf\"} %" PRIu64 "\n"
+						    "pgm_latency_microseconds_count{metric=\"%s\"} %" PRIu64 "\n"
+						    "pgm_latency_microseconds_sum{metric=\"%s\"} %" PRIu64 "\n",
+					  name, latency->count,
+					  name, latency->count,
+					  name, latency->sum);
+	}
+	pgm_free (latency);
+}
+
+static
+void
+metrics_callback (
+	struct http_connection_t*restrict connection,
+	PGM_GNUC_UNUSED const char*restrict path
+        )
+{
+	char sock_tsi[ PGM_SHMSTATS_MAX_SOCKS ][ PGM_TSISTRLEN ];
+	char tsi[ PGM_TSISTRLEN ];
+
+	pgm_shmstats_t* stats = http_read_stats (connection);
+	if (NULL == stats)
+		return;
+	pgm_string_t* response = pgm_string_new (NULL);
+	for (unsigned i = 0; i < stats->n_socks; i++)
+		pgm_tsi_print_r (&stats->socks[ i ].tsi, sock_tsi[ i ], sizeof (sock_tsi[ i ]));
+
+/* source */
+	for (unsigned j = 0; j < stats->source_counters; j++) {
+		const char* name = stats->source_counter_names[ j ];
+		const bool is_gauge = http_is_gauge (name);
+		pgm_string_append_printf (response, "# TYPE pgm_source_%s %s\n", name, is_gauge ? "gauge" : "counter");
+		for (unsigned i = 0; i < stats->n_socks; i++) {
+			const pgm_shmstats_sock_t* sock = &stats->socks[ i ];
+			if (!(sock->flags & PGM_SHMSTATS_CAN_SEND))
+				continue;
+			pgm_string_append_printf (response, "pgm_source_%s%s{tsi=\"%s\",dport=\"%u\"} %u\n",
+						  name, is_gauge ? "" : "_total",
+						  sock_tsi[ i ], pgm_ntohs (sock->dport),
+						  (unsigned)sock->counters[ j ]);
+		}
+	}
+	pgm_string_append (response, "# TYPE pgm_txw_trail gauge\n"
+				     "# TYPE pgm_txw_lead gauge\n"
+				     "# TYPE pgm_txw_bytes gauge\n"
+				     "# TYPE pgm_rate_limit_bytes_per_second gauge\n"
+				     "# TYPE pgm_rate_available_bytes gauge\n");
+	for (unsigned i = 0; i < stats->n_socks; i++) {
+		const pgm_shmstats_sock_t* sock = &stats->socks[ i ];
+		if (!(sock->flags & PGM_SHMSTATS_CAN_SEND))
+			continue;
+		const char* label = sock_tsi[ i ];
+		pgm_string_append_printf (response, "pgm_txw_trail{tsi=\"%s\"} %u\n"
+						    "pgm_txw_lead{tsi=\"%s\"} %u\n"
+						    "pgm_txw_bytes{tsi=\"%s\"} %u\n"
+						    "pgm_rate_limit_bytes_per_second{tsi=\"%s\",class=\"total\"} %" PRIi64 "\n"
+						    "pgm_rate_limit_bytes_per_second{tsi=\"%s\",class=\"odata\"} %" PRIi64 "\n"
+						    "pgm_rate_limit_bytes_per_second{tsi=\"%s\",class=\"rdata\"} %" PRIi64 "\n"
+						    "pgm_rate_available_bytes{tsi=\"%s\"} %" PRIi64 "\n",
+					  label, (unsigned)sock->txw_trail,
+					  label, (unsigned)sock->txw_lead,
+					  label, (unsigned)sock->txw_bytes,
+					  label, sock->rate_per_sec,
+					  label, sock->odata_rate_per_sec,
+					  label, sock->rdata_rate_per_sec,
+					  label, sock->rate_limit);
+	}
+
+/* receiver */
+	for (unsigned j = 0; j < stats->receiver_counters; j++) {
+		const char* name = stats->receiver_counter_names[ j ];
+		const bool is_gauge = http_is_gauge (name);
+		pgm_string_append_printf (response, "# TYPE pgm_receiver_%s %s\n", name, is_gauge ? "gauge" : "counter");
+		for (unsigned i = 0; i < stats->n_peers; i++) {
+			const pgm_shmstats_peer_t* peer = &stats->peers[ i ];
+			pgm_tsi_print_r (&peer->tsi, tsi, sizeof (tsi));
+			pgm_string_append_printf (response, "pgm_receiver_%s%s{sock=\"%s\",tsi=\"%s\"} %u\n",
+						  name, is_gauge ? "" : "_total",
+						  sock_tsi[ peer->sock_index ], tsi,
+						  (unsigned)peer->counters[ j ]);
+		}
+	}
+	pgm_string_append (response, "# TYPE pgm_rxw_trail gauge\n"
+				     "# TYPE pgm_rxw_lead gauge\n"
+				     "# TYPE pgm_rxw_commit_lead gauge\n"
+				     "# TYPE pgm_rxw_bytes gauge\n"
+				     "# TYPE pgm_peer_losses counter\n"
+				     "# TYPE pgm_peer_delivered_bytes counter\n"
+				     "# TYPE pgm_peer_delivered_msgs counter\n"
+				     "# TYPE pgm_repair_latency_microseconds summary\n"
+				     "# TYPE pgm_repair_latency_max_microseconds gauge\n");
+	for (unsigned i = 0; i < stats->n_peers; i++) {
+		const pgm_shmstats_peer_t* peer = &stats->peers[ i ];
+		const char* sock_label = sock_tsi[ peer->sock_index ];
+		pgm_tsi_print_r (&peer->tsi, tsi, sizeof (tsi));
+		pgm_string_append_printf (response, "pgm_rxw_trail{sock=\"%s\",tsi=\"%s\"} %u\n"
+						    "pgm_rxw_lead{sock=\"%s\",tsi=\"%s\"} %u\n"
+						    "pgm_rxw_commit_lead{sock=\"%s\",tsi=\"%s\"} %u\n"
+						    "pgm_rxw_bytes{sock=\"%s\",tsi=\"%s\"} %u\n"
+						    "pgm_peer_losses_total{sock=\"%s\",tsi=\"%s\"} %u\n"
+						    "pgm_peer_delivered_bytes_total{sock=\"%s\",tsi=\"%s\"} %u\n"
+						    "pgm_peer_delivered_msgs_total{sock=\"%s\",tsi=\"%s\"} %u\n"
+						    "pgm_repair_latency_microseconds{sock=\"%s\",tsi=\"%s\",quantile=\"0.5\"} %u\n"
+						    "pgm_repair_latency_microseconds{sock=\"%s\",tsi=\"%s\",quantile=\"0.99\"} %u\n"
+						    "pgm_repair_latency_microseconds_count{sock=\"%s\",tsi=\"%s\"} %" PRIu64 "\n"
+						    "pgm_repair_latency_microseconds_sum{sock=\"%s\",tsi=\"%s\"} %" PRIu64 "\n"
+						    "pgm_repair_latency_max_microseconds{sock=\"%s\",tsi=\"%s\"} %u\n",
+					  sock_label, tsi, (unsigned)peer->rxw_trail,
+					  sock_label, tsi, (unsigned)peer->rxw_lead,
+					  sock_label, tsi, (unsigned)peer->commit_lead,
+					  sock_label, tsi, (unsigned)peer->rxw_bytes,
+					  sock_label, tsi, (unsigned)peer->cumulative_losses,
+					  sock_label, tsi, (unsigned)peer->bytes_delivered,
+					  sock_label, tsi, (unsigned)peer->msgs_delivered,
+					  sock_label, tsi, (unsigned)peer->repair_p50,
+					  sock_label, tsi, (unsigned)peer->repair_p99,
+					  sock_label, tsi, peer->repair_count,
+					  sock_label, tsi, peer->repair_sum,
+					  sock_label, tsi, (unsigned)peer->repair_max);
+	}
+
+	http_write_latency_openmetrics (response);
+#ifdef USE_HISTOGRAMS
+	pgm_histogram_write_openmetrics_all (response);
+#endif
+	pgm_string_append (response, "# EOF\n");
+	pgm_free (stats);
+
+	http_set_content_type (connection, HTTP_OPENMETRICS_TYPE);
+	char* buf = pgm_string_free (response, FALSE);
+	http_set_response (connection, buf, strlen (buf));
+}
+
+static
+void
+metrics_json_callback (
+	struct http_connection_t*restrict connection,
+	PGM_GNUC_UNUSED const char*restrict path
+        )
+{
+	char tsi[ PGM_TSISTRLEN ];
+
+	pgm_shmstats_t* stats = http_read_stats (connection);
+	if (NULL == stats)
+		return;
+	pgm_string_t* response = pgm_string_new (NULL);
+	pgm_string_append (response, "{\"hostname\":");
+	http_append_json_string (response, http_hostname);
+	pgm_string_append_printf (response, ",\"pid\":%u,\"timestamp\":%" PRIu64 ","
+					    "\"dropped_sockets\":%u,\"dropped_peers\":%u,\"sockets\":[",
+				  (unsigned)stats->pid,
+				  stats->timestamp,
+				  (unsigned)stats->dropped_socks,
+				  (unsigned)stats->dropped_peers);
+	for (unsigned i = 0; i < stats->n_socks; i++) {
+		const pgm_shmstats_sock_t* sock = &stats->socks[ i ];
+		pgm_tsi_print_r (&sock->tsi, tsi, sizeof (tsi));
+		pgm_string_append_printf (response, "%s{\"tsi\":\"%s\",\"dport\":%u,\"peers\":%u",
+					  i ? "," : "",
+					  tsi, pgm_ntohs (sock->dport),
+					  (unsigned)sock->n_peers);
+		if (sock->flags & PGM_SHMSTATS_CAN_SEND) {
+			pgm_string_append_printf (response, ",\"txw\":{\"trail\":%u,\"lead\":%u,\"bytes\":%u}"
+							    ",\"rate\":{\"limit\":%" PRIi64 ",\"odata_limit\":%" PRIi64 ",\"rdata_limit\":%" PRIi64 ",\"available\":%" PRIi64 "}"
+							    ",\"counters\":{",
+						  (unsigned)sock->txw_trail, (unsigned)sock->txw_lead, (unsigned)sock->txw_bytes,
+						  sock->rate_per_sec, sock->odata_rate_per_sec, sock->rdata_rate_per_sec, sock->rate_limit);
+			for (unsigned j = 0; j < stats->source_counters; j++)
+				pgm_string_append_printf (response, "%s\"%s\":%u",
+							  j ? "," : "",
+							  stats->source_counter_names[ j ],
+							  (unsigned)sock->counters[ j ]);
+			pgm_string_append (response, "}");
+		}
+		pgm_string_append (response, "}");
+	}
+	pgm_string_append (response, "],\"peers\":[");
+	for (unsigned i = 0; i < stats->n_peers; i++) {
+		const pgm_shmstats_peer_t* peer = &stats->peers[ i ];
+		pgm_tsi_print_r (&peer->tsi, tsi, sizeof (tsi));
+		pgm_string_append_printf (response, "%s{\"tsi\":\"%s\",\"socket\":%u"
+						    ",\"rxw\":{\"trail\":%u,\"lead\":%u,\"commit_lead\":%u,\"bytes\":%u}"
+						    ",\"losses\":%u,\"delivered_bytes\":%u,\"delivered_msgs\":%u"
+						    ",\"repair_latency\":{\"count\":%" PRIu64 ",\"sum\":%" PRIu64 ",\"p50\":%u,\"p99\":%u,\"max\":%u}"
+						    ",\"counters\":{",
+					  i ? "," : "",
+					  tsi, (unsigned)peer->sock_index,
+					  (unsigned)peer->rxw_trail, (unsigned)peer->rxw_lead, (unsigned)peer->commit_lead, (unsigned)peer->rxw_bytes,
+					  (unsigned)peer->cumulative_losses, (unsigned)peer->bytes_delivered, (unsigned)peer->msgs_delivered,
+					  peer->repair_count, peer->repair_sum,
+					  (unsigned)peer->repair_p50, (unsigned)peer->repair_p99, (unsigned)peer->repair_max);
+		for (unsigned j = 0; j < stats->receiver_counters; j++)
+			pgm_string_append_printf (response, "%s\"%s\":%u",
+						  j ? "," : "",
+						  stats->receiver_counter_names[ j ],
+						  (unsigned)peer->counters[ j ]);
+		pgm_string_append (response, "}}");
+	}
+	pgm_free (stats);
+
+/* process-wide latency, microseconds */
+	pgm_latency_t* latency = pgm_new (pgm_latency_t, 1);
+	pgm_string_append (response, "],\"latency\":{");
+	for (int metric = 0; metric < PGM_LATENCY_MAX; metric++) {
+		pgm_latency_snapshot (metric, latency);
+		pgm_string_append_printf (response, "%s\"%s\":{\"count\":%" PRIu64 ",\"sum\":%" PRIu64 ",\"max\":%" PRIu64
+						    ",\"p50\":%" PRIu64 ",\"p90\":%" PRIu64 ",\"p99\":%" PRIu64 ",\"p999\":%" PRIu64 "}",
+					  metric ? "," : "",
+					  http_latency_names[ metric ],
+					  latency->count, latency->sum, latency->max,
+					  (uint64_t)pgm_latency_percentile (latency, 50.0),
+					  (uint64_t)pgm_latency_percentile (latency, 90.0),
+					  (uint64_t)pgm_latency_percentile (latency, 99.0),
+					  (uint64_t)pgm_latency_percentile (latency, 99.9));
+	}
+	pgm_free (latency);
+	pgm_string_append (response, "}");
+#ifdef USE_HISTOGRAMS
+	pgm_string_append (response, ",\"histograms\":");
+	pgm_histogram_write_json_all (response);
+#endif
+	pgm_string_append (response, "}\n");
+
+	http_set_content_type (connection, "application/json");
+	char* buf = pgm_string_free (response, FALSE);
+	http_set_response (connection, buf, strlen (buf));
+}
+
 static
 void
 default_callback (
@@ -1607,6 +2293,8 @@ http_receiver_response (
 							"<th>NAKs failed due to NCF retries</th><td>%" GROUP_FORMAT PRIu32 "</td>"
 						"</tr><tr>"
 							"<th>NAKs failed due to DATA retries</th><td>%" GROUP_FORMAT PRIu32 "</td>"
+						"</tr><tr>"
+							"<th>NAKs failed due to repair deadline</th><td>%" GROUP_FORMAT PRIu32 "</td>"
 						"</tr><tr>"
 							"<th>NAK failures delivered to app</th><td>%" GROUP_FORMAT PRIu32 "</td>"
 						"</tr><tr>"
@@ -1659,6 +2347,7 @@ http_receiver_response (
 						peer->cumulative_stats[PGM_PC_RECEIVER_NAKS_FAILED_RXW_ADVANCED],
 						peer->cumulative_stats[PGM_PC_RECEIVER_NAKS_FAILED_NCF_RETRIES_EXCEEDED],
 						peer->cumulative_stats[PGM_PC_RECEIVER_NAKS_FAILED_DATA_RETRIES_EXCEEDED],
+						peer->cumulative_stats[PGM_PC_RECEIVER_NAKS_FAILED_GEN_EXPIRED],
 						peer->cumulative_stats[PGM_PC_RECEIVER_NAK_FAILURES_DELIVERED],
 						peer->cumulative_stats[PGM_PC_RECEIVER_SELECTIVE_NAKS_SUPPRESSED],
 						peer->cumulative_stats[PGM_PC_RECEIVER_NAK_ERRORS],
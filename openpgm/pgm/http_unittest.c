@@ -27,6 +27,7 @@
 #include <check.h>
 
 #include "impl/framework.h"
+#include "pgm/shmstats.h"
 
 #ifdef _WIN32
 #	define PGM_CHECK_NOFORK		1
@@ -36,11 +37,67 @@
 /* mock state */
 static pgm_rwlock_t	mock_pgm_sock_list_lock;
 static pgm_slist_t*	mock_pgm_sock_list;
+static unsigned		mock_shmstats_init_count = 0;
+static unsigned		mock_shmstats_interval = 0;
+static pgm_shmstats_t*	mock_shmstats = NULL;		/* NULL = unavailable */
 
 /* mock functions for external references */
 
+bool
+mock_pgm_shmstats_init (
+	const char*		name,
+	const unsigned		interval,
+	pgm_error_t**		error
+	)
+{
+	mock_shmstats_init_count++;
+	mock_shmstats_interval = interval;
+	return TRUE;
+}
+
+bool
+mock_pgm_shmstats_shutdown (void)
+{
+	return TRUE;
+}
+
+bool
+mock_pgm_shmstats_read (
+	pgm_shmstats_t* const	stats
+	)
+{
+	if (NULL == mock_shmstats)
+		return FALSE;
+	memcpy (stats, mock_shmstats, sizeof (pgm_shmstats_t));
+	return TRUE;
+}
+
+bool
+mock_pgm_latency_snapshot (
+	const int		metric,
+	pgm_latency_t* const	latency
+	)
+{
+	memset (latency, 0, sizeof (pgm_latency_t));
+	return TRUE;
+}
+
+pgm_time_t
+mock_pgm_latency_percentile (
+	const pgm_latency_t* const	latency,
+	const double			percentile
+	)
+{
+	return 0;
+}
+
 #define pgm_sock_list_lock	mock_pgm_sock_list_lock
 #define pgm_sock_list		mock_pgm_sock_list
+#define pgm_shmstats_init	mock_pgm_shmstats_init
+#define pgm_shmstats_shutdown	mock_pgm_shmstats_shutdown
+#define pgm_shmstats_read	mock_pgm_shmstats_read
+#define pgm_latency_snapshot	mock_pgm_latency_snapshot
+#define pgm_latency_percentile	mock_pgm_latency_percentile
 
 #define HTTP_DEBUG
 #include "http.c"
@@ -52,6 +109,230 @@ pgm_get_nprocs (void)
 	return 1;
 }
 
+/* one sending socket with one peer */
+static
+pgm_shmstats_t*
+generate_stats (void)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 0 };
+	pgm_tsi_t peer_tsi = { { 9, 8, 7, 6, 5, 4 }, 0 };
+	tsi.sport = htons (1000);
+	peer_tsi.sport = htons (2000);
+	pgm_shmstats_t* stats = g_malloc0 (sizeof (pgm_shmstats_t));
+	stats->source_counters = 1;
+	strcpy (stats->source_counter_names[ 0 ], "data_bytes_sent");
+	stats->receiver_counters = 1;
+	strcpy (stats->receiver_counter_names[ 0 ], "losses");
+	stats->n_socks = 1;
+	memcpy (&stats->socks[ 0 ].tsi, &tsi, sizeof (pgm_tsi_t));
+	stats->socks[ 0 ].dport = htons (7500);
+	stats->socks[ 0 ].flags = PGM_SHMSTATS_CAN_SEND | PGM_SHMSTATS_CAN_RECV;
+	stats->socks[ 0 ].txw_lead = 42;
+	stats->socks[ 0 ].n_peers = 1;
+	stats->socks[ 0 ].counters[ 0 ] = 100;
+	stats->n_peers = 1;
+	memcpy (&stats->peers[ 0 ].tsi, &peer_tsi, sizeof (pgm_tsi_t));
+	stats->peers[ 0 ].rxw_lead = 7;
+	stats->peers[ 0 ].counters[ 0 ] = 3;
+	return stats;
+}
+
+static
+void
+generate_connection (
+	struct http_connection_t*	connection
+	)
+{
+	memset (connection, 0, sizeof (struct http_connection_t));
+	connection->status_code	 = 200;
+	connection->status_text	 = "OK";
+	connection->content_type = "text/html";
+}
+
+/* target:
+ *	void
+ *	http_stats_init (void)
+ */
+
+START_TEST (test_stats_init_pass_001)
+{
+	mock_shmstats_init_count = 0;
+	unsetenv ("PGM_HTTP_METRICS");
+	http_stats_init ();
+	fail_unless (0 == mock_shmstats_init_count, "publisher started without request");
+	fail_unless (FALSE == http_has_stats, "has_stats failed");
+	setenv ("PGM_HTTP_METRICS", "250", 1);
+	http_stats_init ();
+	fail_unless (1 == mock_shmstats_init_count, "publisher not started");
+	fail_unless (250 == mock_shmstats_interval, "interval failed");
+	fail_unless (TRUE == http_has_stats, "has_stats failed");
+	setenv ("PGM_HTTP_METRICS", "on", 1);
+	http_stats_init ();
+	fail_unless (HTTP_STATS_INTERVAL == mock_shmstats_interval, "default interval failed");
+	unsetenv ("PGM_HTTP_METRICS");
+	http_has_stats = FALSE;
+}
+END_TEST
+
+/* target:
+ *	void
+ *	metrics_callback (
+ *		struct http_connection_t*	connection,
+ *		const char*			path
+ *	)
+ */
+
+START_TEST (test_metrics_pass_001)
+{
+	struct http_connection_t connection;
+	generate_connection (&connection);
+	mock_shmstats = generate_stats ();
+	metrics_callback (&connection, "/metrics");
+	fail_unless (NULL != connection.buf, "no response");
+	fail_unless (NULL != strstr (connection.buf, "HTTP/1.0 200 OK\r\n"), "status failed");
+	fail_unless (NULL != strstr (connection.buf, "Content-Type: " HTTP_OPENMETRICS_TYPE "\r\n"), "content type failed");
+	fail_unless (NULL != strstr (connection.buf, "# TYPE pgm_source_data_bytes_sent counter\n"
+						     "pgm_source_data_bytes_sent_total{tsi=\"1.2.3.4.5.6.1000\",dport=\"7500\"} 100\n"), "source counter failed");
+	fail_unless (NULL != strstr (connection.buf, "pgm_txw_lead{tsi=\"1.2.3.4.5.6.1000\"} 42\n"), "txw failed");
+	fail_unless (NULL != strstr (connection.buf, "pgm_receiver_losses_total{sock=\"1.2.3.4.5.6.1000\",tsi=\"9.8.7.6.5.4.2000\"} 3\n"), "receiver counter failed");
+	fail_unless (NULL != strstr (connection.buf, "pgm_rxw_lead{sock=\"1.2.3.4.5.6.1000\",tsi=\"9.8.7.6.5.4.2000\"} 7\n"), "rxw failed");
+	const size_t len = strlen (connection.buf);
+	fail_unless (0 == strcmp (connection.buf + len - strlen ("# EOF\n"), "# EOF\n"), "EOF failed");
+	g_free (mock_shmstats);
+	mock_shmstats = NULL;
+	pgm_free (connection.buf);
+}
+END_TEST
+
+/* no snapshot published */
+START_TEST (test_metrics_pass_002)
+{
+	struct http_connection_t connection;
+	generate_connection (&connection);
+	metrics_callback (&connection, "/metrics");
+	fail_unless (NULL != connection.buf, "no response");
+	fail_unless (NULL != strstr (connection.buf, "HTTP/1.0 503 Service Unavailable\r\n"), "status failed");
+	fail_unless (NULL != strstr (connection.buf, HTTP_NO_STATS), "content failed");
+	pgm_free (connection.buf);
+}
+END_TEST
+
+/* target:
+ *	void
+ *	metrics_json_callback (
+ *		struct http_connection_t*	connection,
+ *		const char*			path
+ *	)
+ */
+
+START_TEST (test_metrics_json_pass_001)
+{
+	struct http_connection_t connection;
+	generate_connection (&connection);
+	mock_shmstats = generate_stats ();
+	strcpy (http_hostname, "host\"name\\\n");
+	metrics_json_callback (&connection, "/metrics.json");
+	fail_unless (NULL != connection.buf, "no response");
+	fail_unless (NULL != strstr (connection.buf, "Content-Type: application/json\r\n"), "content type failed");
+	fail_unless (NULL != strstr (connection.buf, "\r\n{\"hostname\":\"host\\\"name\\\\\\u000a\",\"pid\":"), "hostname not escaped");
+	fail_unless (NULL != strstr (connection.buf, "{\"tsi\":\"1.2.3.4.5.6.1000\",\"dport\":7500,\"peers\":1"
+						     ",\"txw\":{\"trail\":0,\"lead\":42,\"bytes\":0}"), "socket failed");
+	fail_unless (NULL != strstr (connection.buf, "\"counters\":{\"data_bytes_sent\":100}"), "source counter failed");
+	fail_unless (NULL != strstr (connection.buf, "{\"tsi\":\"9.8.7.6.5.4.2000\",\"socket\":0"
+						     ",\"rxw\":{\"trail\":0,\"lead\":7,"), "peer failed");
+	fail_unless (NULL != strstr (connection.buf, "\"counters\":{\"losses\":3}}"), "receiver counter failed");
+	g_free (mock_shmstats);
+	mock_shmstats = NULL;
+	http_hostname[ 0 ] = '\0';
+	pgm_free (connection.buf);
+}
+END_TEST
+
+/* target:
+ *	void
+ *	http_read (
+ *		struct http_connection_t*	connection
+ *	)
+ */
+
+#ifndef _WIN32
+static
+struct http_connection_t*
+generate_client (
+	int*				peer_sock
+	)
+{
+	int sv[2];
+	fail_unless (0 == socketpair (AF_UNIX, SOCK_STREAM, 0, sv), "socketpair failed");
+	pgm_sockaddr_nonblocking (sv[0], TRUE);
+	struct http_connection_t* connection = pgm_new0 (struct http_connection_t, 1);
+	connection->sock = sv[0];
+	connection->state = HTTP_STATE_READ;
+	http_socks = pgm_list_prepend_link (http_socks, &connection->link_);
+	http_connection_count++;
+	*peer_sock = sv[1];
+	return connection;
+}
+
+/* request split across reads */
+START_TEST (test_read_pass_001)
+{
+	static const char part1[] = "GET /robots.txt HT";
+	static const char part2[] = "TP/1.1\r\nHost: localhost\r\n\r\n";
+	int peer_sock;
+	struct http_connection_t* connection = generate_client (&peer_sock);
+	fail_unless ((ssize_t)strlen (part1) == send (peer_sock, part1, strlen (part1), 0), "send failed");
+	http_read (connection);
+	fail_unless (HTTP_STATE_READ == connection->state, "state failed");
+	fail_unless (strlen (part1) == connection->request_len, "offset failed");
+	fail_unless ((ssize_t)strlen (part2) == send (peer_sock, part2, strlen (part2), 0), "send failed");
+	http_read (connection);
+	fail_unless (strlen (part1) + strlen (part2) == connection->request_len, "offset failed");
+	fail_unless (HTTP_STATE_WRITE == connection->state, "state failed");
+	fail_unless (NULL != connection->buf, "no response");
+	fail_unless (0 == strncmp (connection->buf, "HTTP/1.1 200 OK\r\n", strlen ("HTTP/1.1 200 OK\r\n")), "status failed");
+	http_close (connection);
+	close (peer_sock);
+	fail_unless (NULL == http_socks, "connection not removed");
+}
+END_TEST
+
+/* orderly shutdown by the client closes the connection */
+START_TEST (test_read_pass_002)
+{
+	int peer_sock;
+	struct http_connection_t* connection = generate_client (&peer_sock);
+	fail_unless (0 == shutdown (peer_sock, SHUT_WR), "shutdown failed");
+	http_read (connection);
+	fail_unless (0 == http_connection_count, "connection count failed");
+	fail_unless (NULL == http_socks, "connection not closed");
+	close (peer_sock);
+}
+END_TEST
+/* oversized request answered with its own protocol version */
+START_TEST (test_read_pass_003)
+{
+	static const char request_line[] = "GET / HTTP/1.0\r\nX-Padding: ";
+	int peer_sock;
+	struct http_connection_t* connection = generate_client (&peer_sock);
+	connection->is_http11 = TRUE;		/* previous request */
+	connection->is_keepalive = TRUE;
+	memset (connection->request, 'x', HTTP_MAX_REQUEST);
+	memcpy (connection->request, request_line, strlen (request_line));
+	connection->request[ HTTP_MAX_REQUEST ] = '\0';
+	connection->request_len = HTTP_MAX_REQUEST;
+	http_read (connection);
+	fail_unless (HTTP_STATE_WRITE == connection->state, "state failed");
+	fail_unless (NULL != connection->buf, "no response");
+	fail_unless (0 == strncmp (connection->buf, "HTTP/1.0 431 ", strlen ("HTTP/1.0 431 ")), "status failed");
+	fail_unless (NULL != strstr (connection->buf, "Connection: close\r\n"), "connection failed");
+	fail_unless (!connection->is_keepalive, "keep-alive failed");
+	http_close (connection);
+	close (peer_sock);
+}
+END_TEST
+#endif /* !_WIN32 */
+
 /* target:
  *	bool
  *	pgm_http_init (
@@ -144,6 +425,27 @@ make_test_suite (void)
 	tcase_add_test (tc_shutdown, test_shutdown_pass_002);
 	tcase_add_test (tc_shutdown, test_shutdown_fail_001);
 
+	TCase* tc_stats_init = tcase_create ("stats-init");
+	suite_add_tcase (s, tc_stats_init);
+	tcase_add_test (tc_stats_init, test_stats_init_pass_001);
+
+	TCase* tc_metrics = tcase_create ("metrics");
+	suite_add_tcase (s, tc_metrics);
+	tcase_add_test (tc_metrics, test_metrics_pass_001);
+	tcase_add_test (tc_metrics, test_metrics_pass_002);
+
+	TCase* tc_metrics_json = tcase_create ("metrics-json");
+	suite_add_tcase (s, tc_metrics_json);
+	tcase_add_test (tc_metrics_json, test_metrics_json_pass_001);
+
+#ifndef _WIN32
+	TCase* tc_read = tcase_create ("read");
+	suite_add_tcase (s, tc_read);
+	tcase_add_test (tc_read, test_read_pass_001);
+	tcase_add_test (tc_read, test_read_pass_002);
+	tcase_add_test (tc_read, test_read_pass_003);
+#endif
+
 	return s;
 }
 
@@ -0,0 +1,595 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Shared memory fan-out.  A hub process runs the PGM receiver and copies
+ * every delivered message into a named broadcast ring, local subscribers
+ * read the ring without sockets, receive windows or NAK state of their own.
+ *
+ * The ring has a single writer and never waits for readers.  Each reader
+ * keeps a private position and validates a copy against the writer's
+ * reservation after the fact, a reader lapped by the writer discards the
+ * copy and resumes from the newest message.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+#include <errno.h>
+#ifndef _WIN32
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#else
+#	include <process.h>
+#endif
+#include <impl/i18n.h>
+#include <impl/framework.h>
+#include <pgm/hub.h>
+
+
+//#define HUB_DEBUG
+
+#ifdef _WIN32
+#	define getpid		_getpid
+#endif
+
+#define PGM_HUB_MIN_SIZE	4096
+#define PGM_HUB_MAX_SIZE	( 1 << 30 )
+
+/* record length marking the unused end of the ring, the next record starts at
+ * offset zero.
+ */
+#define PGM_HUB_PAD		0xffffffff
+
+/* positions are byte counts since creation, 64-bit so that a reader cannot be
+ * lapped into an aliasing position.  they are accessed a 32-bit word at a time
+ * so that 32-bit and 64-bit processes share the ring, the high word is kept
+ * either side of the low word for a reader to detect a carry in progress.
+ */
+struct pgm_hub_pos_t {
+	volatile uint32_t	hi;
+	volatile uint32_t	lo;
+	volatile uint32_t	hi2;
+};
+
+struct pgm_hub_segment_t {
+/* constant after creation */
+	uint32_t		magic;
+	uint32_t		version;
+	uint32_t		size;			/* of ring[], power of two */
+	uint32_t		pid;
+	volatile uint32_t	is_closed;		/* hub destroyed */
+	uint32_t		reserved;
+/* writer state */
+	struct pgm_hub_pos_t	reserve;		/* end of the record being written */
+	struct pgm_hub_pos_t	head;			/* end of the last complete record */
+	char			pad[ 64 - 48 ];
+	char			ring[];
+};
+
+struct pgm_hub_record_t {
+	uint32_t		length;			/* of payload or PGM_HUB_PAD */
+	uint32_t		reserved;
+	pgm_tsi_t		tsi;
+};
+
+struct pgm_hub_t {
+	struct pgm_hub_segment_t*	segment;
+	size_t				mapped_len;
+	uint32_t			mask;
+	char				name[64];
+#ifdef _WIN32
+	HANDLE				mapping;	/* keeps the name valid */
+#endif
+};
+
+struct pgm_hub_reader_t {
+	const struct pgm_hub_segment_t*	segment;
+	size_t				mapped_len;
+	uint32_t			size;
+	uint32_t			mask;
+	uint64_t			tail;
+};
+
+static inline
+void
+hub_barrier (void)
+{
+#if defined( __GNUC__ )
+	__sync_synchronize();
+#elif defined( _MSC_VER )
+	_ReadWriteBarrier();
+#endif
+}
+
+/* positions only increase and have a single writer, a reader retries when
+ * the high word moved across its read of the low word.
+ */
+
+static inline
+uint64_t
+hub_pos_read (
+	const struct pgm_hub_pos_t*	pos
+	)
+{
+	uint32_t hi, lo;
+	do {
+		hi = pos->hi2;
+		hub_barrier();
+		lo = pos->lo;
+		hub_barrier();
+	} while (hi != pos->hi);
+	return ((uint64_t)hi << 32) | lo;
+}
+
+static inline
+void
+hub_pos_write (
+	struct pgm_hub_pos_t*	pos,
+	const uint64_t		value
+	)
+{
+	pos->hi = (uint32_t)(value >> 32);
+	hub_barrier();
+	pos->lo = (uint32_t)value;
+	hub_barrier();
+	pos->hi2 = (uint32_t)(value >> 32);
+}
+
+static inline
+uint32_t
+hub_record_len (
+	const uint32_t		length
+	)
+{
+	return (uint32_t)((sizeof (struct pgm_hub_record_t) + length + 7) & ~7);
+}
+
+static
+void
+hub_unmap (
+	const void*		segment,
+	const size_t		mapped_len
+	)
+{
+#ifndef _WIN32
+	munmap ((void*)segment, mapped_len);
+#else
+	UnmapViewOfFile (segment);
+#endif
+}
+
+/* create the named ring of size bytes, 0 selects PGM_HUB_DEFAULT_SIZE.  an
+ * existing ring of the same name is replaced, readers of it see end of file.
+ *
+ * returns the hub on success, returns NULL on failure with error set.
+ */
+
+pgm_hub_t*
+pgm_hub_create (
+	const char*	     restrict name,
+	const size_t		      size,
+	pgm_error_t**	     restrict error
+	)
+{
+	pgm_hub_t* hub;
+	uint32_t ring_size = PGM_HUB_MIN_SIZE;
+
+	pgm_return_val_if_fail (NULL != name, NULL);
+	pgm_return_val_if_fail (0 == size || (size >= PGM_HUB_MIN_SIZE && size <= PGM_HUB_MAX_SIZE), NULL);
+
+	while (ring_size < (size ? size : PGM_HUB_DEFAULT_SIZE))
+		ring_size <<= 1;
+
+	pgm_debug ("pgm_hub_create (name:\"%s\" size:%" PRIzu " error:%p)",
+		name, size, (const void*)error);
+
+	hub = pgm_new0 (pgm_hub_t, 1);
+	hub->mapped_len = sizeof (struct pgm_hub_segment_t) + ring_size;
+	hub->mask = ring_size - 1;
+	pgm_strncpy_s (hub->name, sizeof (hub->name), name, _TRUNCATE);
+
+#ifndef _WIN32
+/* a fresh object, readers of a previous hub keep their own mapping */
+	shm_unlink (name);
+	const int fd = shm_open (name, O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (-1 == fd) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_errno (save_errno),
+			     _("Opening shared memory segment %s: %s"),
+			     name,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		pgm_free (hub);
+		return NULL;
+	}
+	if (0 != ftruncate (fd, hub->mapped_len)) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_errno (save_errno),
+			     _("Sizing shared memory segment %s: %s"),
+			     name,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		close (fd);
+		shm_unlink (name);
+		pgm_free (hub);
+		return NULL;
+	}
+	hub->segment = mmap (NULL, hub->mapped_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (MAP_FAILED == hub->segment) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_errno (save_errno),
+			     _("Mapping shared memory segment %s: %s"),
+			     name,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		close (fd);
+		shm_unlink (name);
+		pgm_free (hub);
+		return NULL;
+	}
+	close (fd);
+#else
+	hub->mapping = CreateFileMappingA (INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)hub->mapped_len, name);
+	if (NULL == hub->mapping) {
+		const DWORD save_errno = GetLastError();
+		char winstr[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_win_errno (save_errno),
+			     _("Opening shared memory segment %s: %s"),
+			     name,
+			     pgm_win_strerror (winstr, sizeof (winstr), save_errno));
+		pgm_free (hub);
+		return NULL;
+	}
+	hub->segment = MapViewOfFile (hub->mapping, FILE_MAP_WRITE, 0, 0, hub->mapped_len);
+	if (NULL == hub->segment) {
+		const DWORD save_errno = GetLastError();
+		char winstr[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_win_errno (save_errno),
+			     _("Mapping shared memory segment %s: %s"),
+			     name,
+			     pgm_win_strerror (winstr, sizeof (winstr), save_errno));
+		CloseHandle (hub->mapping);
+		pgm_free (hub);
+		return NULL;
+	}
+#endif /* _WIN32 */
+
+/* readers validate the constant header once the magic is set */
+	struct pgm_hub_segment_t* segment = hub->segment;
+	pgm_atomic_write32 (&segment->magic, 0);
+	segment->version	= PGM_HUB_VERSION;
+	segment->size		= ring_size;
+	segment->pid		= (uint32_t)getpid();
+	segment->is_closed	= 0;
+	hub_pos_write (&segment->reserve, 0);
+	hub_pos_write (&segment->head, 0);
+	hub_barrier();
+	pgm_atomic_write32 (&segment->magic, PGM_HUB_MAGIC);
+	pgm_minor (_("Hub ring: %s %u bytes"), name, (unsigned)ring_size);
+	return hub;
+}
+
+/* mark the ring closed and remove its name, attached readers drain what
+ * remains and then see end of file.
+ */
+
+bool
+pgm_hub_destroy (
+	pgm_hub_t*		hub
+	)
+{
+	pgm_return_val_if_fail (NULL != hub, FALSE);
+
+	pgm_atomic_write32 (&hub->segment->is_closed, 1);
+	hub_unmap (hub->segment, hub->mapped_len);
+#ifndef _WIN32
+	shm_unlink (hub->name);
+#else
+	CloseHandle (hub->mapping);
+#endif
+	pgm_free (hub);
+	return TRUE;
+}
+
+/* copy one message into the ring, fragments are joined.
+ */
+
+static
+bool
+hub_publish_one (
+	pgm_hub_t* const restrict		hub,
+	const struct pgm_msgv_t* const restrict	msgv,
+	const size_t				length
+	)
+{
+	struct pgm_hub_segment_t* segment = hub->segment;
+	const uint32_t size = hub->mask + 1;
+	const uint32_t rec_len = hub_record_len ((uint32_t)length);
+
+/* larger than a quarter ring would starve every reader */
+	if (PGM_UNLIKELY(rec_len > size / 4)) {
+		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Hub discarded %" PRIzu " byte message exceeding a quarter of the ring."), length);
+		return FALSE;
+	}
+
+	const uint64_t head = hub_pos_read (&segment->head);
+	const uint32_t offset = (uint32_t)head & hub->mask;
+	const uint32_t room = size - offset;
+	const uint32_t skip = (room < rec_len) ? room : 0;
+	const uint64_t reserve = head + skip + rec_len;
+
+	hub_pos_write (&segment->reserve, reserve);
+	hub_barrier();
+
+/* a record header never straddles the end, a shorter tail is skipped implicitly */
+	if (skip >= sizeof (struct pgm_hub_record_t))
+		((struct pgm_hub_record_t*)&segment->ring[ offset ])->length = PGM_HUB_PAD;
+
+	struct pgm_hub_record_t* record = (struct pgm_hub_record_t*)&segment->ring[ ((uint32_t)head + skip) & hub->mask ];
+	record->length = (uint32_t)length;
+	record->reserved = 0;
+	memcpy (&record->tsi, &msgv->msgv_skb[0]->tsi, sizeof (pgm_tsi_t));
+	char* dst = (char*)(record + 1);
+	for (unsigned i = 0; i < msgv->msgv_len; i++) {
+		const struct pgm_sk_buff_t* skb = msgv->msgv_skb[ i ];
+		memcpy (dst, skb->data, skb->len);
+		dst += skb->len;
+	}
+
+	hub_barrier();
+	hub_pos_write (&segment->head, reserve);
+	return TRUE;
+}
+
+/* publish the messages of one pgm_recvmsgv() call, bytes_read as returned
+ * by that call.
+ *
+ * returns the count of messages published.
+ */
+
+size_t
+pgm_hub_publish (
+	pgm_hub_t* const restrict		hub,
+	const struct pgm_msgv_t* const restrict	msgv,
+	const size_t				bytes_read
+	)
+{
+	size_t published = 0;
+
+	pgm_return_val_if_fail (NULL != hub, 0);
+	pgm_return_val_if_fail (0 == bytes_read || NULL != msgv, 0);
+
+	size_t remaining = bytes_read;
+	for (const struct pgm_msgv_t* pmsgv = msgv; remaining > 0; pmsgv++)
+	{
+		size_t apdu_length = 0;
+		for (unsigned i = 0; i < pmsgv->msgv_len; i++)
+			apdu_length += pmsgv->msgv_skb[ i ]->len;
+		pgm_assert (apdu_length <= remaining);
+		if (hub_publish_one (hub, pmsgv, apdu_length))
+			published++;
+		remaining -= apdu_length;
+	}
+	return published;
+}
+
+/* map the named ring read-only, reading starts with the next message
+ * published.
+ *
+ * returns the reader on success, returns NULL on failure with error set.
+ */
+
+pgm_hub_reader_t*
+pgm_hub_attach (
+	const char*	     restrict name,
+	pgm_error_t**	     restrict error
+	)
+{
+	const struct pgm_hub_segment_t* segment;
+	size_t mapped_len;
+
+	pgm_return_val_if_fail (NULL != name, NULL);
+
+#ifndef _WIN32
+	const int fd = shm_open (name, O_RDONLY, 0);
+	if (-1 == fd) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_errno (save_errno),
+			     _("Opening shared memory segment %s: %s"),
+			     name,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		return NULL;
+	}
+	struct stat buf;
+	if (0 != fstat (fd, &buf) || buf.st_size < (off_t)(sizeof (struct pgm_hub_segment_t) + PGM_HUB_MIN_SIZE)) {
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     PGM_ERROR_BADE,
+			     _("Shared memory segment %s is not a hub ring."),
+			     name);
+		close (fd);
+		return NULL;
+	}
+	mapped_len = (size_t)buf.st_size;
+	segment = mmap (NULL, mapped_len, PROT_READ, MAP_SHARED, fd, 0);
+	if (MAP_FAILED == segment) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_errno (save_errno),
+			     _("Mapping shared memory segment %s: %s"),
+			     name,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		close (fd);
+		return NULL;
+	}
+	close (fd);
+#else
+	HANDLE mapping = OpenFileMappingA (FILE_MAP_READ, FALSE, name);
+	if (NULL == mapping) {
+		const DWORD save_errno = GetLastError();
+		char winstr[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_win_errno (save_errno),
+			     _("Opening shared memory segment %s: %s"),
+			     name,
+			     pgm_win_strerror (winstr, sizeof (winstr), save_errno));
+		return NULL;
+	}
+	segment = MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+	if (NULL == segment) {
+		const DWORD save_errno = GetLastError();
+		char winstr[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_win_errno (save_errno),
+			     _("Mapping shared memory segment %s: %s"),
+			     name,
+			     pgm_win_strerror (winstr, sizeof (winstr), save_errno));
+		CloseHandle (mapping);
+		return NULL;
+	}
+	CloseHandle (mapping);
+	mapped_len = 0;
+#endif /* _WIN32 */
+
+	if (PGM_HUB_MAGIC != pgm_atomic_read32 (&segment->magic) ||
+	    PGM_HUB_VERSION != segment->version ||
+	    (segment->size & (segment->size - 1)) ||
+	    (mapped_len && mapped_len < sizeof (struct pgm_hub_segment_t) + segment->size))
+	{
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     PGM_ERROR_VERNOTSUPPORTED,
+			     _("Shared memory segment %s has unsupported version %u."),
+			     name,
+			     (unsigned)segment->version);
+		hub_unmap (segment, mapped_len);
+		return NULL;
+	}
+
+	pgm_hub_reader_t* reader = pgm_new0 (pgm_hub_reader_t, 1);
+	reader->segment	   = segment;
+	reader->mapped_len = mapped_len;
+	reader->size	   = segment->size;
+	reader->mask	   = segment->size - 1;
+	reader->tail	   = hub_pos_read (&segment->head);
+	return reader;
+}
+
+void
+pgm_hub_detach (
+	pgm_hub_reader_t*	reader
+	)
+{
+	pgm_return_if_fail (NULL != reader);
+	hub_unmap (reader->segment, reader->mapped_len);
+	pgm_free (reader);
+}
+
+/* copy the next message into buf, longer messages are truncated to buflen.
+ *
+ * returns PGM_IO_STATUS_NORMAL with a message, PGM_IO_STATUS_WOULD_BLOCK if
+ * none is pending, PGM_IO_STATUS_RESET if messages were lost to the writer,
+ * or PGM_IO_STATUS_EOF once the hub is destroyed and the ring drained.
+ */
+
+int
+pgm_hub_read (
+	pgm_hub_reader_t* const restrict reader,
+	void*		        restrict buf,
+	const size_t			 buflen,
+	size_t*		        restrict bytes_read,
+	pgm_tsi_t*	        restrict from		/* maybe NULL */
+	)
+{
+	pgm_return_val_if_fail (NULL != reader, PGM_IO_STATUS_ERROR);
+	pgm_return_val_if_fail (NULL != buf || 0 == buflen, PGM_IO_STATUS_ERROR);
+	pgm_return_val_if_fail (NULL != bytes_read, PGM_IO_STATUS_ERROR);
+
+	const struct pgm_hub_segment_t* segment = reader->segment;
+	for (;;)
+	{
+		const uint64_t head = hub_pos_read (&segment->head);
+		hub_barrier();
+		if (head == reader->tail)
+			return pgm_atomic_read32 (&segment->is_closed) ? PGM_IO_STATUS_EOF : PGM_IO_STATUS_WOULD_BLOCK;
+		if (head - reader->tail > reader->size)
+			goto lapped;
+
+		const uint32_t offset = (uint32_t)reader->tail & reader->mask;
+		const uint32_t room = reader->size - offset;
+		if (room < sizeof (struct pgm_hub_record_t)) {
+			reader->tail += room;
+			continue;
+		}
+
+		struct pgm_hub_record_t record;
+		memcpy (&record, &segment->ring[ offset ], sizeof (record));
+/* a record never runs past the end of the ring, a longer one is torn */
+		const bool is_torn = (PGM_HUB_PAD != record.length &&
+				      record.length > room - sizeof (record));
+		size_t copy_len = 0;
+		if (PGM_HUB_PAD != record.length && !is_torn) {
+			copy_len = MIN(buflen, (size_t)record.length);
+			memcpy (buf, &segment->ring[ offset + sizeof (record) ], copy_len);
+		}
+
+/* the copy is only valid if the writer has not reserved over it meanwhile */
+		hub_barrier();
+		if (hub_pos_read (&segment->reserve) - reader->tail > reader->size || is_torn)
+			goto lapped;
+		if (PGM_HUB_PAD == record.length) {
+			reader->tail += room;
+			continue;
+		}
+
+		reader->tail += hub_record_len (record.length);
+		*bytes_read = copy_len;
+		if (NULL != from)
+			memcpy (from, &record.tsi, sizeof (pgm_tsi_t));
+		return PGM_IO_STATUS_NORMAL;
+	}
+
+lapped:
+#ifdef HUB_DEBUG
+	pgm_debug ("pgm_hub_read (reader:%p) lapped at %" PRIu64 " head %" PRIu64,
+		(const void*)reader, reader->tail, hub_pos_read (&segment->head));
+#endif
+	reader->tail = hub_pos_read (&segment->head);
+	return PGM_IO_STATUS_RESET;
+}
+
+/* eof */
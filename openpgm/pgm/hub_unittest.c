@@ -0,0 +1,425 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * unit tests for shared memory fan-out.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <check.h>
+
+#ifdef _WIN32
+#	define PGM_CHECK_NOFORK		1
+#endif
+
+
+/* mock state */
+
+#define TEST_NAME		"/pgm-hub-unittest"
+#define TEST_SIZE		4096
+
+#define HUB_DEBUG
+#include "hub.c"
+
+static const pgm_tsi_t test_tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+
+static
+void
+mock_teardown (void)
+{
+#ifndef _WIN32
+	shm_unlink (TEST_NAME);
+#endif
+}
+
+/* one message of length bytes filled with the value c, split over count fragments
+ */
+
+static
+void
+generate_msgv (
+	struct pgm_msgv_t*	msgv,
+	const size_t		length,
+	const int		c,
+	const unsigned		count
+	)
+{
+	msgv->msgv_len = count;
+	for (unsigned i = 0; i < count; i++) {
+		const size_t len = (i == count - 1) ? length - (length / count) * i : length / count;
+		struct pgm_sk_buff_t* skb = pgm_alloc_skb ((uint16_t)len);
+		memcpy (&skb->tsi, &test_tsi, sizeof (pgm_tsi_t));
+		memset (pgm_skb_put (skb, (uint16_t)len), c, len);
+		msgv->msgv_skb[ i ] = skb;
+	}
+}
+
+static
+void
+free_msgv (
+	struct pgm_msgv_t*	msgv
+	)
+{
+	for (unsigned i = 0; i < msgv->msgv_len; i++)
+		pgm_free_skb (msgv->msgv_skb[ i ]);
+}
+
+/* target:
+ *	pgm_hub_t*
+ *	pgm_hub_create (
+ *		const char*		name,
+ *		const size_t		size,
+ *		pgm_error_t**		error
+ *	)
+ */
+
+START_TEST (test_create_pass_001)
+{
+	pgm_error_t* err = NULL;
+	pgm_hub_t* hub = pgm_hub_create (TEST_NAME, 5000, &err);
+	fail_unless (NULL != hub, "create failed");
+	fail_unless (NULL == err, "error raised");
+	fail_unless (PGM_HUB_MAGIC == hub->segment->magic, "magic failed");
+	fail_unless (8192 == hub->segment->size, "size not rounded to power of two");
+	fail_unless (TRUE == pgm_hub_destroy (hub), "destroy failed");
+}
+END_TEST
+
+START_TEST (test_create_fail_001)
+{
+	fail_unless (NULL == pgm_hub_create (NULL, 0, NULL), "create succeeded");
+	fail_unless (NULL == pgm_hub_create (TEST_NAME, 100, NULL), "create succeeded");
+}
+END_TEST
+
+/* target:
+ *	pgm_hub_reader_t*
+ *	pgm_hub_attach (
+ *		const char*		name,
+ *		pgm_error_t**		error
+ *	)
+ */
+
+START_TEST (test_attach_pass_001)
+{
+	pgm_hub_t* hub = pgm_hub_create (TEST_NAME, TEST_SIZE, NULL);
+	fail_if (NULL == hub, "create failed");
+	pgm_error_t* err = NULL;
+	pgm_hub_reader_t* reader = pgm_hub_attach (TEST_NAME, &err);
+	fail_unless (NULL != reader, "attach failed");
+	fail_unless (NULL == err, "error raised");
+	fail_unless (TEST_SIZE == reader->size, "size failed");
+	pgm_hub_detach (reader);
+	pgm_hub_destroy (hub);
+}
+END_TEST
+
+/* no such ring */
+START_TEST (test_attach_pass_002)
+{
+	pgm_error_t* err = NULL;
+	pgm_hub_reader_t* reader = pgm_hub_attach (TEST_NAME, &err);
+	fail_unless (NULL == reader, "attach succeeded");
+	fail_unless (NULL != err, "no error raised");
+	pgm_error_free (err);
+}
+END_TEST
+
+START_TEST (test_attach_fail_001)
+{
+	fail_unless (NULL == pgm_hub_attach (NULL, NULL), "attach succeeded");
+}
+END_TEST
+
+/* target:
+ *	size_t
+ *	pgm_hub_publish (
+ *		pgm_hub_t*		hub,
+ *		const struct pgm_msgv_t* msgv,
+ *		const size_t		bytes_read
+ *	)
+ *
+ *	int
+ *	pgm_hub_read (
+ *		pgm_hub_reader_t*	reader,
+ *		void*			buf,
+ *		const size_t		buflen,
+ *		size_t*			bytes_read,
+ *		pgm_tsi_t*		from
+ *	)
+ */
+
+/* messages arrive in order, fragments joined */
+START_TEST (test_read_pass_001)
+{
+	pgm_hub_t* hub = pgm_hub_create (TEST_NAME, TEST_SIZE, NULL);
+	pgm_hub_reader_t* reader = pgm_hub_attach (TEST_NAME, NULL);
+	fail_if (NULL == hub || NULL == reader, "setup failed");
+	struct pgm_msgv_t msgv[2];
+	generate_msgv (&msgv[0], 100, 'a', 1);
+	generate_msgv (&msgv[1], 300, 'b', 3);
+	fail_unless (2 == pgm_hub_publish (hub, msgv, 400), "publish failed");
+	char buf[1024];
+	size_t bytes_read;
+	pgm_tsi_t from;
+	fail_unless (PGM_IO_STATUS_NORMAL == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, &from), "read failed");
+	fail_unless (100 == bytes_read, "length mismatch");
+	fail_unless ('a' == buf[0] && 'a' == buf[99], "content mismatch");
+	fail_unless (pgm_tsi_equal (&test_tsi, &from), "tsi mismatch");
+	fail_unless (PGM_IO_STATUS_NORMAL == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read failed");
+	fail_unless (300 == bytes_read, "length mismatch");
+	fail_unless ('b' == buf[0] && 'b' == buf[299], "content mismatch");
+	fail_unless (PGM_IO_STATUS_WOULD_BLOCK == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read not empty");
+	free_msgv (&msgv[0]);
+	free_msgv (&msgv[1]);
+	pgm_hub_detach (reader);
+	pgm_hub_destroy (hub);
+}
+END_TEST
+
+/* short buffer truncates, reading continues with the next message */
+START_TEST (test_read_pass_002)
+{
+	pgm_hub_t* hub = pgm_hub_create (TEST_NAME, TEST_SIZE, NULL);
+	pgm_hub_reader_t* reader = pgm_hub_attach (TEST_NAME, NULL);
+	fail_if (NULL == hub || NULL == reader, "setup failed");
+	struct pgm_msgv_t msgv[2];
+	generate_msgv (&msgv[0], 200, 'a', 1);
+	generate_msgv (&msgv[1], 50, 'b', 1);
+	fail_unless (2 == pgm_hub_publish (hub, msgv, 250), "publish failed");
+	char buf[64];
+	size_t bytes_read;
+	fail_unless (PGM_IO_STATUS_NORMAL == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read failed");
+	fail_unless (sizeof (buf) == bytes_read, "not truncated");
+	fail_unless (PGM_IO_STATUS_NORMAL == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read failed");
+	fail_unless (50 == bytes_read, "length mismatch");
+	fail_unless ('b' == buf[0], "content mismatch");
+	free_msgv (&msgv[0]);
+	free_msgv (&msgv[1]);
+	pgm_hub_detach (reader);
+	pgm_hub_destroy (hub);
+}
+END_TEST
+
+/* wrapping the ring keeps up with a reader that keeps up */
+START_TEST (test_read_pass_003)
+{
+	pgm_hub_t* hub = pgm_hub_create (TEST_NAME, TEST_SIZE, NULL);
+	pgm_hub_reader_t* reader = pgm_hub_attach (TEST_NAME, NULL);
+	fail_if (NULL == hub || NULL == reader, "setup failed");
+	char buf[1024];
+	size_t bytes_read;
+	for (unsigned i = 0; i < 100; i++) {
+		struct pgm_msgv_t msgv;
+		generate_msgv (&msgv, 300 + i, 'a' + (i % 26), 1);
+		fail_unless (1 == pgm_hub_publish (hub, &msgv, 300 + i), "publish failed");
+		free_msgv (&msgv);
+		fail_unless (PGM_IO_STATUS_NORMAL == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read failed");
+		fail_unless (300 + i == bytes_read, "length mismatch");
+		fail_unless ('a' + (i % 26) == buf[0] && 'a' + (i % 26) == buf[bytes_read - 1], "content mismatch");
+	}
+	pgm_hub_detach (reader);
+	pgm_hub_destroy (hub);
+}
+END_TEST
+
+/* a reader lapped by the writer resets to the newest message */
+START_TEST (test_read_pass_004)
+{
+	pgm_hub_t* hub = pgm_hub_create (TEST_NAME, TEST_SIZE, NULL);
+	pgm_hub_reader_t* reader = pgm_hub_attach (TEST_NAME, NULL);
+	fail_if (NULL == hub || NULL == reader, "setup failed");
+	struct pgm_msgv_t msgv;
+	generate_msgv (&msgv, 500, 'a', 1);
+	for (unsigned i = 0; i < 20; i++)
+		pgm_hub_publish (hub, &msgv, 500);
+	free_msgv (&msgv);
+	char buf[1024];
+	size_t bytes_read;
+	fail_unless (PGM_IO_STATUS_RESET == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read not reset");
+	fail_unless (PGM_IO_STATUS_WOULD_BLOCK == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read not empty");
+	generate_msgv (&msgv, 10, 'b', 1);
+	pgm_hub_publish (hub, &msgv, 10);
+	free_msgv (&msgv);
+	fail_unless (PGM_IO_STATUS_NORMAL == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read failed");
+	fail_unless (10 == bytes_read && 'b' == buf[0], "message mismatch");
+	pgm_hub_detach (reader);
+	pgm_hub_destroy (hub);
+}
+END_TEST
+
+/* messages over a quarter ring are dropped */
+START_TEST (test_read_pass_005)
+{
+	pgm_hub_t* hub = pgm_hub_create (TEST_NAME, TEST_SIZE, NULL);
+	fail_if (NULL == hub, "create failed");
+	struct pgm_msgv_t msgv;
+	generate_msgv (&msgv, TEST_SIZE / 2, 'a', 2);
+	fail_unless (0 == pgm_hub_publish (hub, &msgv, TEST_SIZE / 2), "oversize published");
+	fail_unless (0 == hub_pos_read (&hub->segment->head), "ring advanced");
+	free_msgv (&msgv);
+	pgm_hub_destroy (hub);
+}
+END_TEST
+
+/* destroying the hub ends the stream after the remaining messages */
+START_TEST (test_read_pass_006)
+{
+	pgm_hub_t* hub = pgm_hub_create (TEST_NAME, TEST_SIZE, NULL);
+	pgm_hub_reader_t* reader = pgm_hub_attach (TEST_NAME, NULL);
+	fail_if (NULL == hub || NULL == reader, "setup failed");
+	struct pgm_msgv_t msgv;
+	generate_msgv (&msgv, 10, 'a', 1);
+	pgm_hub_publish (hub, &msgv, 10);
+	free_msgv (&msgv);
+	pgm_hub_destroy (hub);
+	char buf[1024];
+	size_t bytes_read;
+	fail_unless (PGM_IO_STATUS_NORMAL == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read failed");
+	fail_unless (PGM_IO_STATUS_EOF == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read not eof");
+	pgm_hub_detach (reader);
+}
+END_TEST
+
+/* a record length running past the end of the ring is treated as lapped */
+START_TEST (test_read_pass_007)
+{
+	pgm_hub_t* hub = pgm_hub_create (TEST_NAME, TEST_SIZE, NULL);
+	pgm_hub_reader_t* reader = pgm_hub_attach (TEST_NAME, NULL);
+	fail_if (NULL == hub || NULL == reader, "setup failed");
+	struct pgm_msgv_t msgv;
+	generate_msgv (&msgv, 10, 'a', 1);
+	fail_unless (1 == pgm_hub_publish (hub, &msgv, 10), "publish failed");
+	free_msgv (&msgv);
+	((struct pgm_hub_record_t*)hub->segment->ring)->length = TEST_SIZE - sizeof (struct pgm_hub_record_t) + 1;
+	char buf[TEST_SIZE];
+	size_t bytes_read = 0;
+	fail_unless (PGM_IO_STATUS_RESET == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read not reset");
+	fail_unless (0 == bytes_read, "torn record read");
+	fail_unless (PGM_IO_STATUS_WOULD_BLOCK == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read not empty");
+	pgm_hub_detach (reader);
+	pgm_hub_destroy (hub);
+}
+END_TEST
+
+/* positions carry into the high word */
+START_TEST (test_read_pass_008)
+{
+	pgm_hub_t* hub = pgm_hub_create (TEST_NAME, TEST_SIZE, NULL);
+	fail_if (NULL == hub, "create failed");
+	const uint64_t start = ((uint64_t)1 << 32) - 64;
+	hub_pos_write (&hub->segment->reserve, start);
+	hub_pos_write (&hub->segment->head, start);
+	pgm_hub_reader_t* reader = pgm_hub_attach (TEST_NAME, NULL);
+	fail_if (NULL == reader, "attach failed");
+	fail_unless (start == reader->tail, "tail mismatch");
+	char buf[1024];
+	size_t bytes_read;
+	for (unsigned i = 0; i < 4; i++) {
+		struct pgm_msgv_t msgv;
+		generate_msgv (&msgv, 40, 'a' + i, 1);
+		fail_unless (1 == pgm_hub_publish (hub, &msgv, 40), "publish failed");
+		free_msgv (&msgv);
+		fail_unless (PGM_IO_STATUS_NORMAL == pgm_hub_read (reader, buf, sizeof (buf), &bytes_read, NULL), "read failed");
+		fail_unless (40 == bytes_read && 'a' + i == buf[0], "message mismatch");
+	}
+	fail_unless (reader->tail == hub_pos_read (&hub->segment->head), "head mismatch");
+	fail_unless (reader->tail > ((uint64_t)1 << 32), "no carry");
+	fail_unless (1 == hub->segment->head.hi && 1 == hub->segment->head.hi2, "no carry");
+	pgm_hub_detach (reader);
+	pgm_hub_destroy (hub);
+}
+END_TEST
+
+START_TEST (test_read_fail_001)
+{
+	char buf[1024];
+	size_t bytes_read;
+	fail_unless (PGM_IO_STATUS_ERROR == pgm_hub_read (NULL, buf, sizeof (buf), &bytes_read, NULL), "read succeeded");
+}
+END_TEST
+
+START_TEST (test_publish_fail_001)
+{
+	fail_unless (0 == pgm_hub_publish (NULL, NULL, 0), "publish succeeded");
+}
+END_TEST
+
+
+static
+Suite*
+make_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create (__FILE__);
+
+	TCase* tc_create = tcase_create ("create");
+	suite_add_tcase (s, tc_create);
+	tcase_add_checked_fixture (tc_create, NULL, mock_teardown);
+	tcase_add_test (tc_create, test_create_pass_001);
+	tcase_add_test (tc_create, test_create_fail_001);
+
+	TCase* tc_attach = tcase_create ("attach");
+	suite_add_tcase (s, tc_attach);
+	tcase_add_checked_fixture (tc_attach, NULL, mock_teardown);
+	tcase_add_test (tc_attach, test_attach_pass_001);
+	tcase_add_test (tc_attach, test_attach_pass_002);
+	tcase_add_test (tc_attach, test_attach_fail_001);
+
+	TCase* tc_read = tcase_create ("read");
+	suite_add_tcase (s, tc_read);
+	tcase_add_checked_fixture (tc_read, NULL, mock_teardown);
+	tcase_add_test (tc_read, test_read_pass_001);
+	tcase_add_test (tc_read, test_read_pass_002);
+	tcase_add_test (tc_read, test_read_pass_003);
+	tcase_add_test (tc_read, test_read_pass_004);
+	tcase_add_test (tc_read, test_read_pass_005);
+	tcase_add_test (tc_read, test_read_pass_006);
+	tcase_add_test (tc_read, test_read_pass_007);
+	tcase_add_test (tc_read, test_read_pass_008);
+	tcase_add_test (tc_read, test_read_fail_001);
+	tcase_add_test (tc_read, test_publish_fail_001);
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	pgm_messages_init();
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_test_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	pgm_messages_shutdown();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
@@ -0,0 +1,53 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * PGMCC congestion window algorithms.
+ *
+ * Copyright (c) 2006-2010 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_CONGESTION_H__
+#define __PGM_IMPL_CONGESTION_H__
+
+typedef struct pgm_cc_ops_t pgm_cc_ops_t;
+
+#include <impl/framework.h>
+
+PGM_BEGIN_DECLS
+
+/* window callbacks of a congestion control algorithm, windows and tokens are
+ * fp8 packet counts.  loss detection, ACKer election and token accounting
+ * remain with pgm_on_ack().
+ */
+struct pgm_cc_ops_t {
+	const char*	name;
+	void		(*on_start)	(pgm_sock_t*const);
+	uint32_t	(*on_ack)	(pgm_sock_t*const, const unsigned, const pgm_time_t);	/* returns tokens granted */
+	void		(*on_loss)	(pgm_sock_t*const);
+	void		(*on_timeout)	(pgm_sock_t*const);
+};
+
+extern const pgm_cc_ops_t pgm_cc_reno;
+extern const pgm_cc_ops_t pgm_cc_cubic;
+
+PGM_GNUC_INTERNAL const pgm_cc_ops_t* pgm_cc_lookup (const int) PGM_GNUC_CONST;
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_CONGESTION_H__ */
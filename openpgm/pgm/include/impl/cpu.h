@@ -45,6 +45,10 @@ struct pgm_cpu_t {
 	bool		has_sse42;
 	bool		has_avx;
 	bool		has_avx2;
+	bool		has_invariant_tsc;
+	uint64_t	tsc_frequency;		/* Hz, 0 when not enumerated */
+	uint32_t	signature;		/* family, model and stepping */
+	char		brand[49];
 };
 
 PGM_GNUC_INTERNAL void pgm_cpuid (pgm_cpu_t*);
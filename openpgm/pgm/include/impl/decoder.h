@@ -0,0 +1,43 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ * 
+ * Parity decoder worker pool.
+ *
+ * Copyright (c) 2006-2010 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_DECODER_H__
+#define __PGM_IMPL_DECODER_H__
+
+typedef struct pgm_decoder_t pgm_decoder_t;
+
+#include <impl/framework.h>
+#include <impl/receiver.h>
+
+PGM_BEGIN_DECLS
+
+PGM_GNUC_INTERNAL pgm_decoder_t* pgm_decoder_create (pgm_sock_t*const restrict, const unsigned, pgm_error_t**restrict) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL void pgm_decoder_destroy (pgm_decoder_t*const);
+PGM_GNUC_INTERNAL void pgm_decoder_push (pgm_decoder_t*const restrict, pgm_peer_t*const restrict);
+PGM_GNUC_INTERNAL bool pgm_decoder_flush (pgm_decoder_t*const);
+PGM_GNUC_INTERNAL void pgm_decoder_notify (pgm_decoder_t*const);
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_DECODER_H__ */
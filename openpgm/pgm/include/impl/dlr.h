@@ -0,0 +1,49 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Designated local repairer.
+ *
+ * Copyright (c) 2006-2010 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_DLR_H__
+#define __PGM_IMPL_DLR_H__
+
+typedef struct pgm_dlr_t pgm_dlr_t;
+
+#include <impl/framework.h>
+#include <impl/receiver.h>
+
+PGM_BEGIN_DECLS
+
+/* interval between redirecting POLRs per source, receivers forget a repairer
+ * after several are missed.
+ */
+#define PGM_DLR_ANNOUNCE_IVL		( pgm_secs(1) )
+#define PGM_DLR_REDIRECT_EXPIRY		( 3 * PGM_DLR_ANNOUNCE_IVL )
+
+PGM_GNUC_INTERNAL pgm_dlr_t* pgm_dlr_create (const unsigned, const uint16_t) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL void pgm_dlr_destroy (pgm_dlr_t*const);
+PGM_GNUC_INTERNAL void pgm_dlr_add (pgm_dlr_t*const restrict, const struct pgm_sk_buff_t*const restrict);
+PGM_GNUC_INTERNAL bool pgm_dlr_on_nak (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict, const struct sockaddr*const restrict) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL bool pgm_dlr_send_polr (pgm_sock_t*const restrict, pgm_peer_t*const restrict, const struct sockaddr*const restrict, const int);
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_DLR_H__ */
@@ -37,7 +37,8 @@ PGM_BEGIN_DECLS
 extern LPFN_WSARECVMSG pgm_WSARecvMsg;
 #endif
 
-#ifdef PGM_DEBUG
+#if defined(PGM_DEBUG) || defined(USE_LOSS_SIMULATION)
+/* receive side simulated loss in percent */
 extern unsigned pgm_loss_rate;
 #endif
 
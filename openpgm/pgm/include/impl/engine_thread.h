@@ -0,0 +1,44 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ * 
+ * Protocol engine thread.
+ *
+ * Copyright (c) 2006-2010 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_ENGINE_THREAD_H__
+#define __PGM_IMPL_ENGINE_THREAD_H__
+
+typedef struct pgm_engine_thread_t pgm_engine_thread_t;
+
+#include <impl/framework.h>
+#include <impl/receiver.h>
+
+PGM_BEGIN_DECLS
+
+PGM_GNUC_INTERNAL pgm_engine_thread_t* pgm_engine_thread_create (pgm_sock_t*const restrict, const int, pgm_error_t**restrict) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL void pgm_engine_thread_stop (pgm_engine_thread_t*const);
+PGM_GNUC_INTERNAL void pgm_engine_thread_destroy (pgm_engine_thread_t*const);
+PGM_GNUC_INTERNAL bool pgm_engine_thread_is_current (const pgm_engine_thread_t*const) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL SOCKET pgm_engine_thread_get_socket (pgm_engine_thread_t*const) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL int pgm_engine_thread_recvmsgv (pgm_engine_thread_t*const restrict, struct pgm_msgv_t*const restrict, const size_t, const int, size_t*restrict, pgm_error_t**restrict);
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_ENGINE_THREAD_H__ */
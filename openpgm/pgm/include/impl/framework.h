@@ -60,12 +60,14 @@
 #include <impl/indextoname.h>
 #include <impl/inet_network.h>
 #include <impl/ip.h>
+#include <impl/latency.h>
 #include <impl/list.h>
 #include <impl/math.h>
 #include <impl/md5.h>
 #include <impl/messages.h>
 #include <impl/nametoindex.h>
 #include <impl/notify.h>
+#include <impl/probe.h>
 #include <impl/processor.h>
 #include <impl/queue.h>
 #include <impl/rand.h>
@@ -114,6 +114,8 @@ extern pgm_slist_t*	pgm_histograms;
 void pgm_histogram_init (pgm_histogram_t*);
 void pgm_histogram_add (pgm_histogram_t*, int);
 void pgm_histogram_write_html_graph_all (pgm_string_t*);
+void pgm_histogram_write_openmetrics_all (pgm_string_t*);
+void pgm_histogram_write_json_all (pgm_string_t*);
 
 static inline
 void
@@ -0,0 +1,60 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Host-local NAK suppression.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_HOSTNAK_H__
+#define __PGM_IMPL_HOSTNAK_H__
+
+typedef struct pgm_hostnak_t pgm_hostnak_t;
+
+#include <impl/framework.h>
+
+PGM_BEGIN_DECLS
+
+#define PGM_HOSTNAK_MAGIC		0x4b4e4750	/* "PGNK" */
+
+/* segment shared by the receivers of one user on the host, on POSIX the
+ * effective user id is appended, e.g. "/pgm-naks.1000".
+ */
+#ifndef _WIN32
+#	define PGM_HOSTNAK_NAME		"/pgm-naks"
+#else
+#	define PGM_HOSTNAK_NAME		"Local\\pgm-naks"
+#endif
+
+/* direct mapped, a collision only costs a duplicate NAK */
+#define PGM_HOSTNAK_SLOTS		65536
+
+struct pgm_hostnak_t {
+	volatile uint32_t	magic;
+	uint32_t		reserved;
+	volatile uint32_t	slots[PGM_HOSTNAK_SLOTS];	/* claim fingerprint, 0 = empty */
+};
+
+PGM_GNUC_INTERNAL pgm_hostnak_t* pgm_hostnak_attach (const char*restrict, pgm_error_t**restrict) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL void pgm_hostnak_detach (pgm_hostnak_t*const);
+PGM_GNUC_INTERNAL bool pgm_hostnak_claim (pgm_hostnak_t*const restrict, const pgm_tsi_t*const restrict, const uint32_t, const unsigned) PGM_GNUC_WARN_UNUSED_RESULT;
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_HOSTNAK_H__ */
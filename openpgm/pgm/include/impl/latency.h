@@ -0,0 +1,123 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * high dynamic range latency histograms.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if !defined (__PGM_IMPL_FRAMEWORK_H_INSIDE__) && !defined (PGM_COMPILATION)
+#	error "Only <framework.h> can be included directly."
+#endif
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_LATENCY_H__
+#define __PGM_IMPL_LATENCY_H__
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+#include <pgm/types.h>
+#include <pgm/latency.h>
+
+PGM_BEGIN_DECLS
+
+#define PGM_LATENCY_SUB_BUCKET_HALF	(1U << (PGM_LATENCY_SUB_BUCKET_BITS - 1))
+
+/* position of the most significant set bit, value must be non-zero */
+
+static inline
+unsigned
+pgm_latency_msb (
+	const uint64_t	value
+	)
+{
+#if defined(__GNUC__)
+	return 63 - __builtin_clzll (value);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanReverse64 (&index, value);
+	return (unsigned)index;
+#else
+	unsigned msb = 0;
+	uint64_t v = value;
+	while (v >>= 1)
+		msb++;
+	return msb;
+#endif
+}
+
+/* bucket of a value: identity below 2^SUB_BUCKET_BITS, above that the top
+ * SUB_BUCKET_BITS - 1 bits after the leading one select one of the
+ * sub-buckets of the value's power of two.
+ */
+
+static inline
+unsigned
+pgm_latency_bucket (
+	const uint64_t	value
+	)
+{
+	if (value < (1U << PGM_LATENCY_SUB_BUCKET_BITS))
+		return (unsigned)value;
+	const unsigned shift = pgm_latency_msb (value) - (PGM_LATENCY_SUB_BUCKET_BITS - 1);
+	return (shift * PGM_LATENCY_SUB_BUCKET_HALF) + (unsigned)(value >> shift);
+}
+
+/* highest value counted by a bucket */
+
+static inline
+uint64_t
+pgm_latency_bucket_value (
+	const unsigned	bucket
+	)
+{
+	if (bucket < (1U << PGM_LATENCY_SUB_BUCKET_BITS))
+		return bucket;
+	const unsigned shift = (bucket / PGM_LATENCY_SUB_BUCKET_HALF) - 1;
+	const uint64_t mantissa = (bucket % PGM_LATENCY_SUB_BUCKET_HALF) + PGM_LATENCY_SUB_BUCKET_HALF;
+	return ((mantissa + 1) << shift) - 1;
+}
+
+/* single writer, readers may observe a sample partially applied.
+ */
+
+static inline
+void
+pgm_latency_record (
+	pgm_latency_t*const	latency,
+	const pgm_time_t	usecs
+	)
+{
+	const uint64_t value = usecs > PGM_LATENCY_VALUE_MAX ? PGM_LATENCY_VALUE_MAX : usecs;
+	latency->counts[ pgm_latency_bucket (value) ]++;
+	latency->count++;
+	latency->sum += value;
+	if (value > latency->max)
+		latency->max = value;
+}
+
+PGM_GNUC_INTERNAL void pgm_latency_init (void);
+PGM_GNUC_INTERNAL void pgm_latency_shutdown (void);
+PGM_GNUC_INTERNAL void pgm_latency_add (const int, const pgm_time_t);
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_LATENCY_H__ */
+
+/* eof */
@@ -45,13 +45,22 @@ PGM_BEGIN_DECLS
 PGM_GNUC_INTERNAL void pgm__log  (const int, const char*, ...) PGM_GNUC_PRINTF (2, 3);
 PGM_GNUC_INTERNAL void pgm__logv (const int, const char*, va_list) PGM_GNUC_PRINTF (2, 0);
 
+/* levels below PGM_COMPILED_LOG_LEVEL are removed at compile time regardless
+ * of PGM_MIN_LOG_LEVEL, e.g. -DPGM_COMPILED_LOG_LEVEL=PGM_LOG_LEVEL_WARNING.
+ */
+#ifndef PGM_COMPILED_LOG_LEVEL
+#	define PGM_COMPILED_LOG_LEVEL	PGM_LOG_LEVEL_DEBUG
+#endif
+
+#define PGM_LOG_LEVEL_ENABLED(l)	(PGM_COMPILED_LOG_LEVEL <= (l) && pgm_min_log_level <= (l))
+
 #if defined( HAVE_ISO_VARARGS )
 
 /* debug trace level only valid in debug mode */
 #	ifdef PGM_DEBUG
 #		define pgm_debug(...) \
 			do { \
-				if (pgm_min_log_level == PGM_LOG_LEVEL_DEBUG) \
+				if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_DEBUG)) \
 					pgm__log (PGM_LOG_LEVEL_DEBUG, __VA_ARGS__); \
 			} while (0)
 #	else
@@ -60,27 +69,27 @@ PGM_GNUC_INTERNAL void pgm__logv (const int, const char*, va_list) PGM_GNUC_PRIN
 
 #	define pgm_trace(r,...) \
 			do { \
-				if (pgm_min_log_level <= PGM_LOG_LEVEL_TRACE && pgm_log_mask & (r)) \
+				if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_TRACE) && pgm_log_mask & (r)) \
 					pgm__log (PGM_LOG_LEVEL_TRACE, __VA_ARGS__); \
 			} while (0)
 #	define pgm_minor(...) \
 			do { \
-				if (pgm_min_log_level <= PGM_LOG_LEVEL_MINOR) \
+				if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_MINOR)) \
 					pgm__log (PGM_LOG_LEVEL_MINOR, __VA_ARGS__); \
 			} while (0)
 #	define pgm_info(...) \
 			do { \
-				if (pgm_min_log_level <= PGM_LOG_LEVEL_NORMAL) \
+				if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_NORMAL)) \
 					pgm__log (PGM_LOG_LEVEL_NORMAL, __VA_ARGS__); \
 			} while (0)
 #	define pgm_warn(...) \
 			do { \
-				if (pgm_min_log_level <= PGM_LOG_LEVEL_WARNING) \
+				if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_WARNING)) \
 					pgm__log (PGM_LOG_LEVEL_WARNING, __VA_ARGS__); \
 			} while (0)
 #	define pgm_error(...) \
 			do { \
-				if (pgm_min_log_level <= PGM_LOG_LEVEL_ERROR) \
+				if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_ERROR)) \
 					pgm__log (PGM_LOG_LEVEL_ERROR, __VA_ARGS__); \
 			} while (0)
 #	define pgm_fatal(...) \
@@ -93,19 +102,19 @@ PGM_GNUC_INTERNAL void pgm__logv (const int, const char*, va_list) PGM_GNUC_PRIN
 #	ifdef PGM_DEBUG
 #		define pgm_debug(f...) \
 			do { \
-				if (pgm_min_log_level == PGM_LOG_LEVEL_DEBUG) \
+				if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_DEBUG)) \
 					pgm__log (PGM_LOG_LEVEL_DEBUG, f); \
 			} while (0)
 #	else
 #		define pgm_debug(f...)	while (0)
 #	endif /* !PGM_DEBUG */
 
-#	define pgm_trace(r,f...)	if (pgm_min_log_level <= PGM_LOG_LEVEL_TRACE && pgm_log_mask & (r)) \
+#	define pgm_trace(r,f...)	if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_TRACE) && pgm_log_mask & (r)) \
 					pgm__log (PGM_LOG_LEVEL_TRACE, f)
-#	define pgm_minor(f...)		if (pgm_min_log_level <= PGM_LOG_LEVEL_MINOR) pgm__log (PGM_LOG_LEVEL_MINOR, f)
-#	define pgm_info(f...)		if (pgm_min_log_level <= PGM_LOG_LEVEL_NORMAL) pgm__log (PGM_LOG_LEVEL_NORMAL, f)
-#	define pgm_warn(f...)		if (pgm_min_log_level <= PGM_LOG_LEVEL_WARNING) pgm__log (PGM_LOG_LEVEL_WARNING, f)
-#	define pgm_error(f...)		if (pgm_min_log_level <= PGM_LOG_LEVEL_ERROR) pgm__log (PGM_LOG_LEVEL_ERROR, f)
+#	define pgm_minor(f...)		if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_MINOR)) pgm__log (PGM_LOG_LEVEL_MINOR, f)
+#	define pgm_info(f...)		if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_NORMAL)) pgm__log (PGM_LOG_LEVEL_NORMAL, f)
+#	define pgm_warn(f...)		if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_WARNING)) pgm__log (PGM_LOG_LEVEL_WARNING, f)
+#	define pgm_error(f...)		if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_ERROR)) pgm__log (PGM_LOG_LEVEL_ERROR, f)
 #	define pgm_fatal(f...)		pgm__log (PGM_LOG_LEVEL_FATAL, f)
 
 #else   /* no varargs macros */
@@ -120,7 +129,7 @@ static inline void pgm_error (const char*, ...) PGM_GNUC_PRINTF (1, 2);
 static inline void pgm_fatal (const char*, ...) PGM_GNUC_PRINTF (1, 2);
 
 static inline void pgm_debug (const char* format, ...) {
-	if (PGM_LOG_LEVEL_DEBUG == pgm_min_log_level) {
+	if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_DEBUG)) {
 		va_list args;
 		va_start (args, format);
 		pgm__logv (PGM_LOG_LEVEL_DEBUG, format, args);
@@ -129,7 +138,7 @@ static inline void pgm_debug (const char* format, ...) {
 }
 
 static inline void pgm_trace (const int role, const char* format, ...) {
-	if (PGM_LOG_LEVEL_TRACE >= pgm_min_log_level && pgm_log_mask & role) {
+	if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_TRACE) && pgm_log_mask & role) {
 		va_list args;
 		va_start (args, format);
 		pgm__logv (PGM_LOG_LEVEL_TRACE, format, args);
@@ -138,7 +147,7 @@ static inline void pgm_trace (const int role, const char* format, ...) {
 }
 
 static inline void pgm_minor (const char* format, ...) {
-	if (PGM_LOG_LEVEL_MINOR >= pgm_min_log_level) {
+	if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_MINOR)) {
 		va_list args;
 		va_start (args, format);
 		pgm__logv (PGM_LOG_LEVEL_MINOR, format, args);
@@ -147,7 +156,7 @@ static inline void pgm_minor (const char* format, ...) {
 }
 
 static inline void pgm_info (const char* format, ...) {
-	if (PGM_LOG_LEVEL_NORMAL >= pgm_min_log_level) {
+	if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_NORMAL)) {
 		va_list args;
 		va_start (args, format);
 		pgm__logv (PGM_LOG_LEVEL_NORMAL, format, args);
@@ -156,7 +165,7 @@ static inline void pgm_info (const char* format, ...) {
 }
 
 static inline void pgm_warn (const char* format, ...) {
-	if (PGM_LOG_LEVEL_WARNING >= pgm_min_log_level) {
+	if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_WARNING)) {
 		va_list args;
 		va_start (args, format);
 		pgm__logv (PGM_LOG_LEVEL_WARNING, format, args);
@@ -165,7 +174,7 @@ static inline void pgm_warn (const char* format, ...) {
 }
 
 static inline void pgm_error (const char* format, ...) {
-	if (PGM_LOG_LEVEL_ERROR >= pgm_min_log_level) {
+	if (PGM_LOG_LEVEL_ENABLED(PGM_LOG_LEVEL_ERROR)) {
 		va_list args;
 		va_start (args, format);
 		pgm__logv (PGM_LOG_LEVEL_WARNING, format, args);
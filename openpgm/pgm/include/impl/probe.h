@@ -0,0 +1,68 @@
+/* vim:ts=8:sts=4:sw=4:noai:noexpandtab
+ *
+ * protocol event tracepoints.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if !defined (__PGM_IMPL_FRAMEWORK_H_INSIDE__) && !defined (PGM_COMPILATION)
+#	error "Only <framework.h> can be included directly."
+#endif
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_PROBE_H__
+#define __PGM_IMPL_PROBE_H__
+
+#ifdef HAVE_SYS_SDT_H
+#	include <sys/sdt.h>
+#endif
+#include <pgm/types.h>
+#include <pgm/probe.h>
+#include <pgm/time.h>
+
+PGM_BEGIN_DECLS
+
+/* USDT probes compile to a nop with a note section entry, the ring costs a
+ * predicted branch until enabled.
+ */
+#ifdef HAVE_SYS_SDT_H
+#	define PGM_USDT(name, tsi, sqn, arg)	DTRACE_PROBE3 (libpgm, name, (tsi), (sqn), (arg))
+#else
+#	define PGM_USDT(name, tsi, sqn, arg)	do {} while (0)
+#endif
+
+/* the timestamp is the caller's, evaluated only when the ring is enabled */
+#define PGM_PROBE(name, event, tsi, sqn, arg, now) \
+	do { \
+		PGM_USDT (name, tsi, sqn, arg); \
+		if (PGM_UNLIKELY(pgm_probe_is_enabled)) \
+			pgm_probe_record ((event), (tsi), (sqn), (arg), (now)); \
+	} while (0)
+
+extern volatile bool pgm_probe_is_enabled;
+
+PGM_GNUC_INTERNAL void pgm_probe_init (void);
+PGM_GNUC_INTERNAL void pgm_probe_shutdown (void);
+PGM_GNUC_INTERNAL void pgm_probe_record (const int, const pgm_tsi_t*const, const uint32_t, const uint32_t, const pgm_time_t);
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_PROBE_H__ */
+
+/* eof */
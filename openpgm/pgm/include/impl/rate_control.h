@@ -44,6 +44,7 @@ struct pgm_rate_t {
 
 	ssize_t		rate_limit;		/* signed for math */
 	pgm_time_t	last_rate_check;
+	pgm_time_t	limited_since;		/* first non-blocking refusal */
 	pgm_spinlock_t	spinlock;
 };
 
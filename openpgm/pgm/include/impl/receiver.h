@@ -64,7 +64,7 @@ enum {
 	PGM_PC_RECEIVER_NAKS_FAILED_RXW_ADVANCED,
 	PGM_PC_RECEIVER_NAKS_FAILED_NCF_RETRIES_EXCEEDED,
 	PGM_PC_RECEIVER_NAKS_FAILED_DATA_RETRIES_EXCEEDED,
-/*	PGM_PC_RECEIVER_NAKS_FAILED_GEN_EXPIRED */
+	PGM_PC_RECEIVER_NAKS_FAILED_GEN_EXPIRED,		/* repair deadline */
 	PGM_PC_RECEIVER_NAK_FAILURES_DELIVERED,
 	PGM_PC_RECEIVER_SELECTIVE_NAKS_SUPPRESSED,
 	PGM_PC_RECEIVER_NAK_ERRORS,
@@ -79,6 +79,10 @@ enum {
 	PGM_PC_RECEIVER_TRANSMIT_MEAN,
 /*	PGM_PC_RECEIVER_TRANSMIT_MAX, */
 	PGM_PC_RECEIVER_ACKS_SENT, 
+	PGM_PC_RECEIVER_DLR_REPAIRS_SENT,
+	PGM_PC_RECEIVER_DLR_NAKS_FORWARDED,
+	PGM_PC_RECEIVER_REDUNDANT_DATAS,		/* B line copy arrived first */
+	PGM_PC_RECEIVER_REDUNDANT_NAKS_DEFERRED,
 
 /* marker */
 	PGM_PC_RECEIVER_MAX
@@ -92,17 +96,22 @@ struct pgm_peer_t {
 	struct sockaddr_storage		nla, local_nla;		/* nla = advertised, local_nla = from packet */
 	struct sockaddr_storage		poll_nla;		/* from parent to direct poll-response */
 	struct sockaddr_storage		redirect_nla;		/* from dlr */
+	pgm_time_t			redirect_expiry;	/* 0 = NAK the source */
 	pgm_time_t			polr_expiry;
 	pgm_time_t			spmr_expiry;
 	pgm_time_t			spmr_tstamp;
 
+	pgm_mutex_t			mutex;			/* window and delivery state */
 	pgm_rxw_t*      restrict      	window;
+	struct pgm_dlr_t*		dlr;			/* repair cache when a DLR */
+	pgm_time_t			dlr_expiry;		/* next redirecting POLR */
 	pgm_list_t			peers_link;
 	pgm_slist_t			pending_link;
 
 	unsigned			is_fec_enabled:1;
 	unsigned			has_proactive_parity:1;	    /* indicating availability from this source */
 	unsigned			has_ondemand_parity:1;
+	unsigned			is_reset:1;		    /* loss awaiting per-TSI report */
 
 	uint32_t			spm_sqn;
 	pgm_time_t			expiry;
@@ -132,12 +141,28 @@ PGM_GNUC_INTERNAL bool pgm_peer_has_pending (pgm_peer_t*const) PGM_GNUC_WARN_UNU
 PGM_GNUC_INTERNAL void pgm_peer_set_pending (pgm_sock_t*const restrict, pgm_peer_t*const restrict);
 PGM_GNUC_INTERNAL bool pgm_check_peer_state (pgm_sock_t*const, const pgm_time_t);
 PGM_GNUC_INTERNAL void pgm_set_reset_error (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_msgv_t*const restrict);
+PGM_GNUC_INTERNAL size_t pgm_set_loss_notices (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_msgv_t*const restrict, const size_t);
 PGM_GNUC_INTERNAL pgm_time_t pgm_min_receiver_expiry (pgm_sock_t*, pgm_time_t) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL bool pgm_on_peer_nak (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict) PGM_GNUC_WARN_UNUSED_RESULT;
-PGM_GNUC_INTERNAL bool pgm_on_data (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL bool pgm_on_data (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict, const bool) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL bool pgm_on_ncf (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL bool pgm_on_spm (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL bool pgm_on_poll (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL bool pgm_on_polr (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict, const struct sockaddr*const restrict) PGM_GNUC_WARN_UNUSED_RESULT;
+
+/* loss not yet reported by a session reset.  unordered delivery reports the
+ * lost ranges in place of a reset.
+ */
+
+static inline
+bool
+pgm_peer_has_new_loss (
+	const pgm_peer_t* const	peer
+	)
+{
+	return !peer->window->is_unordered &&
+		peer->window->cumulative_losses != peer->last_cumulative_losses;
+}
 
 PGM_END_DECLS
 
@@ -27,6 +27,7 @@
 
 typedef struct pgm_rxw_state_t pgm_rxw_state_t;
 typedef struct pgm_rxw_t pgm_rxw_t;
+typedef struct pgm_rxw_decode_t pgm_rxw_decode_t;
 
 #include <impl/framework.h>
 
@@ -58,17 +59,42 @@ enum
 	PGM_RXW_UNKNOWN
 };
 
+/* A and B lines of a hot/hot feed */
+#define PGM_RXW_LINES		2
+
+/* unordered delivery, lost ranges held for report */
+#define PGM_RXW_LOSS_RANGES	8
+
 /* must be smaller than PGM skbuff control buffer */
 struct pgm_rxw_state_t {
 	pgm_time_t	timer_expiry;
+	pgm_time_t	nak_tstamp;		/* first NAK transmit */
         int		pkt_state;
 
 	uint8_t		nak_transmit_count;	/* 8-bit for size constraints */
         uint8_t		ncf_retry_count;
         uint8_t		data_retry_count;
 
+	unsigned	is_delivered:1;		/* unordered, passed ahead of commit lead */
 /* only valid on tg_sqn::pkt_sqn = 0 */
 	unsigned	is_contiguous:1;	/* transmission group */
+	unsigned	is_decoding:1;		/* parity recovery deferred to decoder */
+};
+
+/* transmission group taken from the window for parity recovery, the decode
+ * itself touches no window state.
+ */
+struct pgm_rxw_decode_t {
+	uint32_t		tg_sqn;
+	pgm_time_t		tstamp;			/* most recent parity packet */
+	uint16_t		parity_length;
+	uint8_t			n, k;
+	unsigned		is_var_pktlen:1;
+	unsigned		is_op_encoded:1;
+	uint8_t*		offsets;		/* [k] */
+	pgm_gf8_t**		data;			/* [n] */
+	pgm_gf8_t**		opts;			/* [n] */
+	struct pgm_sk_buff_t*	skbs[1];		/* [n], referenced */
 };
 
 struct pgm_rxw_t {
@@ -88,14 +114,29 @@ struct pgm_rxw_t {
         uint32_t		lead, trail;
         uint32_t		rxw_trail, rxw_trail_init;
 	uint32_t		commit_lead;
+	uint32_t		unordered_lead;		/* next sequence to scan for unordered delivery */
         unsigned		is_constrained:1;
         unsigned		is_defined:1;
 	unsigned		has_event:1;		/* edge triggered */
 	unsigned		is_fec_available:1;
+	unsigned		is_unordered:1;		/* deliver complete APDUs ahead of gaps */
+	unsigned		is_deferred_decode:1;	/* parity recovery off the receive path */
+	pgm_slist_t*		decode_list;		/* pgm_rxw_decode_t awaiting dispatch */
 	pgm_rs_t		rs;
 	uint32_t		tg_size;		/* transmission group size for parity recovery */
 	uint8_t			tg_sqn_shift;
 
+/* unordered delivery, sequences passing the trail undelivered */
+	struct {
+		uint32_t	first;
+		uint32_t	count;
+	}			loss[PGM_RXW_LOSS_RANGES];
+	unsigned		loss_len;
+
+/* hot/hot redundant feeds, per line most recent data */
+	uint32_t		line_lead[PGM_RXW_LINES];
+	pgm_time_t		line_tstamp[PGM_RXW_LINES];	/* 0 = never seen */
+
 	uint32_t		bitmap;			/* receive status of last 32 packets */
 	uint32_t		data_loss;		/* p */
 	uint32_t		ack_c_p;		/* constant Cᵨ */
@@ -108,6 +149,7 @@ struct pgm_rxw_t {
 	uint32_t		cumulative_losses;
 	uint32_t		bytes_delivered;
 	uint32_t		msgs_delivered;
+	pgm_latency_t		repair_latency;		/* first NAK to repair */
 
 	size_t			size;			/* in bytes */
 	unsigned		alloc;			/* in pkts */
@@ -126,10 +168,16 @@ PGM_GNUC_INTERNAL ssize_t pgm_rxw_readv (pgm_rxw_t*const restrict, struct pgm_ms
 PGM_GNUC_INTERNAL unsigned pgm_rxw_remove_trail (pgm_rxw_t*const) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL unsigned pgm_rxw_update (pgm_rxw_t*const, const uint32_t, const uint32_t, const pgm_time_t, const pgm_time_t) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL void pgm_rxw_update_fec (pgm_rxw_t*const, const uint8_t);
+PGM_GNUC_INTERNAL void pgm_rxw_update_line (pgm_rxw_t*const, const unsigned, const uint32_t, const pgm_time_t);
+PGM_GNUC_INTERNAL bool pgm_rxw_is_line_pending (const pgm_rxw_t*const, const uint32_t, const pgm_time_t) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL int pgm_rxw_confirm (pgm_rxw_t*const, const uint32_t, const pgm_time_t, const pgm_time_t, const pgm_time_t) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL void pgm_rxw_lost (pgm_rxw_t*const, const uint32_t);
+PGM_GNUC_INTERNAL bool pgm_rxw_read_loss (pgm_rxw_t*const restrict, uint32_t*restrict, uint32_t*restrict);
 PGM_GNUC_INTERNAL void pgm_rxw_state (pgm_rxw_t*const restrict, struct pgm_sk_buff_t*const restrict, const int);
 PGM_GNUC_INTERNAL struct pgm_sk_buff_t* pgm_rxw_peek (pgm_rxw_t*const, const uint32_t) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL void pgm_rxw_decode (pgm_rs_t*const restrict, pgm_rxw_decode_t*const restrict);
+PGM_GNUC_INTERNAL void pgm_rxw_decode_complete (pgm_rxw_t*const restrict, pgm_rxw_decode_t*const restrict);
+PGM_GNUC_INTERNAL void pgm_rxw_decode_free (pgm_rxw_decode_t*const);
 PGM_GNUC_INTERNAL const char* pgm_pkt_state_string (const int) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL const char* pgm_rxw_returns_string (const int) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL void pgm_rxw_dump (const pgm_rxw_t*const);
@@ -0,0 +1,46 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * shared memory statistics segment.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_SHMSTATS_H__
+#define __PGM_IMPL_SHMSTATS_H__
+
+#include <impl/framework.h>
+#include <pgm/shmstats.h>
+
+PGM_BEGIN_DECLS
+
+/* snapshot attempts of pgm_shmstats_read() before giving up on a publisher
+ * that stays inside the seqlock.
+ */
+#define PGM_SHMSTATS_READ_ATTEMPTS	100
+
+/* lock serialising segment setup, teardown and readers, created with the
+ * engine so that it exists before the first pgm_shmstats_init().
+ */
+PGM_GNUC_INTERNAL void pgm_shmstats_lock_init (void);
+PGM_GNUC_INTERNAL void pgm_shmstats_lock_free (void);
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_SHMSTATS_H__ */
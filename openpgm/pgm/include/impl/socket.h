@@ -30,6 +30,11 @@ struct pgm_sock_t;
 #include <impl/framework.h>
 #include <impl/txw.h>
 #include <impl/source.h>
+#include <impl/decoder.h>
+#include <impl/congestion.h>
+#include <impl/hostnak.h>
+#include <impl/engine_thread.h>
+#include <impl/spm_scheduler.h>
 
 PGM_BEGIN_DECLS
 
@@ -49,6 +54,7 @@ struct pgm_sock_t {
 
 	pgm_rwlock_t			lock;				/* running / destroyed */
 	pgm_mutex_t			receiver_mutex;			/* receiver API */
+	pgm_cond_t			rx_cond;			/* per-TSI readers await leader */
 	pgm_mutex_t			source_mutex;			/* source API */
 	pgm_spinlock_t			txw_spinlock;			/* transmit window */
 	pgm_mutex_t			send_mutex;			/* non-router alert socket */
@@ -59,17 +65,23 @@ struct pgm_sock_t {
 	bool				is_destroyed;
 	bool	            		is_reset;
 	bool				is_abort_on_reset;
+	bool				has_pending_loss;		/* unordered, lost ranges to report */
 
 	bool				can_send_data;			/* and SPMs */
 	bool				can_send_nak;			/* muted receiver */
 	bool				can_recv_data;			/* send-only */
 	bool				is_edge_triggered_recv;
 	bool				is_nonblocking;
+	bool				is_unordered;			/* deliver APDUs ahead of gaps */
 
 	struct group_source_req		send_gsr;			/* multicast */
 	struct sockaddr_storage		send_addr;			/* unicast nla */
 	SOCKET				send_sock;
 	SOCKET				send_with_router_alert_sock;
+	uint32_t			redundant_send_interface;	/* hot/hot B line */
+	struct sockaddr_storage		redundant_send_group;
+	struct sockaddr_storage		redundant_send_addr;
+	SOCKET				redundant_send_sock;		/* INVALID_SOCKET = single line */
 	struct group_source_req 	recv_gsr[IP_MAX_MEMBERSHIPS];	/* sa_family = 0 terminated */
 	unsigned			recv_gsr_len;
 	SOCKET				recv_sock;
@@ -103,9 +115,13 @@ struct pgm_sock_t {
 	bool				is_pending_crqst;
 	unsigned			ack_c;			/* constant C */
 	unsigned			ack_c_p;		/* constant Cᵨ */
+	const pgm_cc_ops_t*		cc_ops;			/* window algorithm */
 	uint32_t			ssthresh;		/* slow-start threshold */
 	uint32_t			tokens;
 	uint32_t			cwnd_size;		/* congestion window size */
+	uint32_t			cc_w_max;		/* window at last reduction */
+	uint32_t			cc_k;			/* msecs from epoch to w_max */
+	pgm_time_t			cc_epoch;		/* 0 = no reduction since */
 	uint32_t			ack_rx_max;
 	uint32_t			ack_bitmap;
 	uint32_t			acks_after_loss;
@@ -118,10 +134,25 @@ struct pgm_sock_t {
 	pgm_time_t			ack_bo_ivl;
 	struct sockaddr_storage		acker_nla;
 	uint64_t			acker_loss;
+	uint32_t			acker_loss_rate;	    /* fp16 loss reported by the ACKer */
+	pgm_time_t			acker_rtt;		    /* smoothed */
 
 	pgm_notify_t			ack_notify;
 	pgm_notify_t			rdata_notify;
 
+	struct {
+		uint32_t			first_sqn;	/* bitmap origin */
+		unsigned			len;		/* sequences marked */
+		uint32_t			bitmap[PGM_NAK_BATCH_SQNS / 32];
+		uint32_t			nla[PGM_NAK_BATCH_SQNS];	/* sole requester, 0 = many */
+	} nak_batch;						/* selective NAKs of one receive batch */
+
+	bool				use_unicast_repair;
+	struct {
+		uint32_t			hash;
+		struct sockaddr_storage		addr;
+	} repair_nla[PGM_REPAIR_NLA_SLOTS];			/* recent NAK sources by hash */
+
 	pgm_hash_t			last_hash_key;
 	void* restrict			last_hash_value;
 	unsigned			last_commit;
@@ -153,6 +184,15 @@ struct pgm_sock_t {
 	pgm_rand_t			rand_;			    /* for calculating nak_rb_ivl from nak_bo_ivl */
 	unsigned			nak_data_retries, nak_ncf_retries;
 	pgm_time_t			nak_bo_ivl, nak_rpt_ivl, nak_rdata_ivl;
+	pgm_time_t			repair_deadline;	    /* 0 = unlimited */
+	unsigned			dlr_sqns;		    /* repair cache per source, 0 = not a DLR */
+	struct sockaddr_storage		dlr_redirect_addr;	    /* trusted repairer, unspecified = ignore POLR redirects */
+	bool				use_host_nak_suppression;
+	pgm_hostnak_t*			hostnak;		    /* NAK claims shared on the host */
+	bool				use_redundant_tsi;
+	pgm_tsi_t			redundant_tsi[2];	    /* A line, B line delivered as A */
+	bool				use_redundant_group;
+	struct group_req		redundant_recv_gr;	    /* B line sharing the A line TSI */
 	pgm_time_t			next_heartbeat_spm, next_ambient_spm;
 
 	bool				use_proactive_parity;
@@ -162,6 +202,23 @@ struct pgm_sock_t {
 	uint8_t				rs_k;
 	uint8_t				rs_proactive_h;		    /* 0 <= proactive-h <= ( n - k ) */
 	uint8_t				tg_sqn_shift;
+	bool				use_adaptive_parity;
+	uint8_t				rs_proactive_h_min;
+	uint8_t				rs_proactive_h_max;
+	uint32_t			parity_target_ppm;	    /* residual NAKs per million ODATA */
+	volatile uint32_t		parity_epoch_naks;	    /* counted by the NAK path */
+	unsigned			parity_epoch_tgs;
+	uint32_t			parity_nak_ppm;		    /* smoothed residual NAK rate */
+	unsigned			parity_hold;		    /* epochs before h may fall */
+	unsigned			decode_threads;		    /* 0 = decode inline */
+	pgm_decoder_t*			decoder;
+	bool				use_engine_thread;
+	int				engine_affinity;	    /* -1 = unbound */
+	pgm_engine_thread_t*		engine_thread;
+	bool				use_spm_scheduler;
+	volatile uint32_t		is_pending_spm;		    /* SPMR awaiting the scheduler */
+	pgm_time_t			last_spm;		    /* scheduler only, 0 = none */
+	bool				is_ambient_deferred;
 	struct pgm_sk_buff_t* restrict	rx_buffer;
 
 	pgm_rwlock_t			peers_lock;
@@ -170,7 +227,14 @@ struct pgm_sock_t {
 	pgm_slist_t*     restrict	peers_pending;		    /* rxw: have or lost data */
 	pgm_notify_t			pending_notify;		    /* timer to rx */
 	bool				is_pending_read;
+	bool				has_rx_leader;		    /* a per-TSI reader runs the protocol */
+	volatile uint32_t		rx_generation;		    /* advanced on protocol events */
 	pgm_time_t			next_poll;
+	bool				use_timerfd;
+#ifdef HAVE_TIMERFD
+	int				timer_fd;		    /* armed to next_poll */
+	pgm_time_t			timer_fd_expiry;	    /* next_poll last armed */
+#endif
 
 	uint32_t			cumulative_stats[PGM_PC_SOURCE_MAX];
 	uint32_t			snap_stats[PGM_PC_SOURCE_MAX];
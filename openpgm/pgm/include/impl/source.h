@@ -60,15 +60,31 @@ enum {
 	PGM_PC_SOURCE_PARITY_NNAKS_RECEIVED,
 	PGM_PC_SOURCE_SELECTIVE_NNAKS_RECEIVED,
 	PGM_PC_SOURCE_NNAK_ERRORS,
+	PGM_PC_SOURCE_UNICAST_MSGS_RETRANSMITTED,
+	PGM_PC_SOURCE_AMBIENT_SPMS_SUPPRESSED,		/* covered by a recent SPM */
+	PGM_PC_SOURCE_REDUNDANT_SEND_ERRORS,		/* hot/hot B line */
 
 /* marker */
 	PGM_PC_SOURCE_MAX
 };
 
+/* span of sequences one selective NAK batch can coalesce */
+#define PGM_NAK_BATCH_SQNS		256
+
+/* receivers remembered as unicast repair destinations, power of two */
+#define PGM_REPAIR_NLA_SLOTS		16
+
+/* adaptive proactive parity re-evaluates h every epoch of transmission groups,
+ * and lowers it at most once per hold period.
+ */
+#define PGM_PARITY_EPOCH_TGS		16
+#define PGM_PARITY_HOLD_EPOCHS		8
+
 PGM_GNUC_INTERNAL bool pgm_send_spm (pgm_sock_t*const, const int) PGM_GNUC_WARN_UNUSED_RESULT;
-PGM_GNUC_INTERNAL bool pgm_on_deferred_nak (pgm_sock_t*const);
+PGM_GNUC_INTERNAL bool pgm_on_deferred_nak (pgm_sock_t*const, const bool);
+PGM_GNUC_INTERNAL void pgm_on_nak_flush (pgm_sock_t*const);
 PGM_GNUC_INTERNAL bool pgm_on_spmr (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict) PGM_GNUC_WARN_UNUSED_RESULT;
-PGM_GNUC_INTERNAL bool pgm_on_nak (pgm_sock_t*const restrict, struct pgm_sk_buff_t*const restrict) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL bool pgm_on_nak (pgm_sock_t*const restrict, struct pgm_sk_buff_t*const restrict, const struct sockaddr*const restrict) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL bool pgm_on_nnak (pgm_sock_t*const restrict, struct pgm_sk_buff_t*const restrict) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL bool pgm_on_ack (pgm_sock_t*const restrict, struct pgm_sk_buff_t*const restrict) PGM_GNUC_WARN_UNUSED_RESULT;
 
@@ -0,0 +1,50 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Process-wide SPM scheduler.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_IMPL_SPM_SCHEDULER_H__
+#define __PGM_IMPL_SPM_SCHEDULER_H__
+
+#include <impl/framework.h>
+
+PGM_BEGIN_DECLS
+
+/* heartbeat SPMs due within one tick leave in the same pass */
+#define PGM_SPM_SCHEDULER_TICK		pgm_msecs(1)
+
+/* ambient SPMs due within the slack are pulled forward into a pass */
+#define PGM_SPM_SCHEDULER_SLACK		pgm_msecs(50)
+
+/* ambient intervals are shortened by up to 1/n to spread sockets apart */
+#define PGM_SPM_SCHEDULER_JITTER	8
+
+PGM_GNUC_INTERNAL void pgm_spm_scheduler_init (void);
+PGM_GNUC_INTERNAL void pgm_spm_scheduler_shutdown (void);
+PGM_GNUC_INTERNAL bool pgm_spm_scheduler_add (pgm_sock_t*const restrict, pgm_error_t**restrict) PGM_GNUC_WARN_UNUSED_RESULT;
+PGM_GNUC_INTERNAL void pgm_spm_scheduler_remove (pgm_sock_t*const);
+PGM_GNUC_INTERNAL void pgm_spm_scheduler_request (pgm_sock_t*const);
+PGM_GNUC_INTERNAL void pgm_spm_scheduler_kick (const pgm_time_t);
+
+PGM_END_DECLS
+
+#endif /* __PGM_IMPL_SPM_SCHEDULER_H__ */
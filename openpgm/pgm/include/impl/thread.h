@@ -33,6 +33,8 @@ typedef struct pgm_mutex_t pgm_mutex_t;
 typedef struct pgm_spinlock_t pgm_spinlock_t;
 typedef struct pgm_cond_t pgm_cond_t;
 typedef struct pgm_rwlock_t pgm_rwlock_t;
+typedef struct pgm_tls_slot_t pgm_tls_slot_t;
+typedef struct pgm_tls_pool_t pgm_tls_pool_t;
 
 /* spins before yielding, 200 (Linux) - 4,000 (Windows)
  */
@@ -57,6 +59,8 @@ extern bool pgm_smp_system;
 #	include <libkern/OSAtomic.h>
 #endif
 #include <pgm/types.h>
+#include <pgm/atomic.h>
+#include <impl/slist.h>
 #if defined( USE_TICKET_SPINLOCK )
 #	include <impl/ticket.h>
 #endif
@@ -132,6 +136,36 @@ struct pgm_rwlock_t {
 #endif /* USE_DUMB_RWSPINLOCK */
 };
 
+/* thread-local storage class for per-thread state of a pool */
+#ifdef _MSC_VER
+#	define PGM_THREAD_LOCAL	__declspec(thread)
+#else
+#	define PGM_THREAD_LOCAL	__thread
+#endif
+
+/* header of a per-thread allocation, released for reuse by another thread
+ * when the owning thread exits.
+ */
+struct pgm_tls_slot_t {
+	pgm_slist_t		link;
+	pgm_tls_pool_t*		pool;
+	size_t			size;
+	uint32_t		id;
+	bool			is_active;
+};
+
+struct pgm_tls_pool_t {
+	pgm_mutex_t		mutex;
+	pgm_slist_t*		slots;
+	uint32_t		count;
+	volatile uint32_t	generation;
+#ifndef _WIN32
+	pthread_key_t		key;
+#elif ( _WIN32_WINNT >= 0x0600 )
+	DWORD			key;
+#endif
+};
+
 PGM_GNUC_INTERNAL void pgm_mutex_init (pgm_mutex_t*);
 PGM_GNUC_INTERNAL void pgm_mutex_free (pgm_mutex_t*);
 
@@ -325,6 +359,19 @@ PGM_GNUC_INTERNAL void pgm_rwlock_free (pgm_rwlock_t*);
 PGM_GNUC_INTERNAL void pgm_thread_init (void);
 PGM_GNUC_INTERNAL void pgm_thread_shutdown (void);
 
+PGM_GNUC_INTERNAL void pgm_tls_pool_init (pgm_tls_pool_t*);
+PGM_GNUC_INTERNAL void pgm_tls_pool_free (pgm_tls_pool_t*);
+PGM_GNUC_INTERNAL void* pgm_tls_pool_acquire (pgm_tls_pool_t*, const size_t);
+
+/* threads holding a slot of an older generation must acquire again.
+ */
+static inline uint32_t pgm_tls_pool_generation (pgm_tls_pool_t* pool) {
+	return pgm_atomic_read32 (&pool->generation);
+}
+static inline void pgm_tls_pool_invalidate (pgm_tls_pool_t* pool) {
+	pgm_atomic_inc32 (&pool->generation);
+}
+
 static inline
 void
 pgm_thread_yield (void)
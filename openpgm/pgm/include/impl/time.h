@@ -32,6 +32,9 @@
 #include <pgm/types.h>
 #include <pgm/error.h>
 #include <pgm/time.h>
+#if defined(HAVE_RDTSC) && defined(_MSC_VER)
+#	include <intrin.h>
+#endif
 
 PGM_BEGIN_DECLS
 
@@ -45,6 +48,54 @@ typedef pgm_time_t (*pgm_time_update_func)(void);
 
 extern pgm_time_update_func		pgm_time_update_now;
 
+#ifdef HAVE_RDTSC
+/* 32.32 fixed point TSC ticks to microseconds, zero unless the active time
+ * source is an invariant TSC.
+ */
+extern uint64_t				pgm_tsc_us_mul;
+
+/* read time stamp counter (TSC), count of ticks from processor reset.
+ */
+
+static inline
+pgm_time_t
+pgm_rdtsc (void)
+{
+#	ifndef _MSC_VER
+
+	uint32_t lo, hi;
+
+/* We cannot use "=A", since this would use %rax on x86_64 */
+	__asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+	return (pgm_time_t)hi << 32 | lo;
+
+#	else
+
+	return (pgm_time_t)__rdtsc ();
+
+#	endif
+}
+
+/* multiply split at 32 bits so the product cannot overflow.
+ */
+
+static inline
+pgm_time_t
+pgm_tsc_to_usecs (
+	const uint64_t		tsc
+	)
+{
+	return (tsc >> 32) * pgm_tsc_us_mul + (((tsc & UINT32_MAX) * pgm_tsc_us_mul) >> 32);
+}
+
+/* sample the clock once per batch on the fast paths, an invariant TSC is
+ * read in place, anything else through the selected update function.
+ */
+#	define pgm_time_sample()	( pgm_tsc_us_mul ? pgm_tsc_to_usecs (pgm_rdtsc()) : pgm_time_update_now() )
+#else
+#	define pgm_time_sample()	pgm_time_update_now()
+#endif /* HAVE_RDTSC */
+
 PGM_GNUC_INTERNAL bool pgm_time_init (pgm_error_t**) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL bool pgm_time_shutdown (void);
 
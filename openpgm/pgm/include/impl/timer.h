@@ -31,9 +31,10 @@
 PGM_BEGIN_DECLS
 
 PGM_GNUC_INTERNAL bool pgm_timer_prepare (pgm_sock_t*const);
-PGM_GNUC_INTERNAL bool pgm_timer_check (pgm_sock_t*const);
-PGM_GNUC_INTERNAL pgm_time_t pgm_timer_expiration (pgm_sock_t*const);
-PGM_GNUC_INTERNAL bool pgm_timer_dispatch (pgm_sock_t*const);
+PGM_GNUC_INTERNAL bool pgm_timer_check (pgm_sock_t*const, const pgm_time_t);
+PGM_GNUC_INTERNAL pgm_time_t pgm_timer_expiration (pgm_sock_t*const, const pgm_time_t);
+PGM_GNUC_INTERNAL bool pgm_timer_dispatch (pgm_sock_t*const, const pgm_time_t);
+PGM_GNUC_INTERNAL void pgm_timer_arm (pgm_sock_t*const);
 
 static inline
 void
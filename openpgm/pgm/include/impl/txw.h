@@ -42,8 +42,13 @@ struct pgm_txw_state_t {
 
 	uint8_t		pkt_cnt_requested;	/* # parity packets to send */
 	uint8_t		pkt_cnt_sent;		/* # parity packets already sent */
+
+	uint32_t	repair_nla;		/* hash of the sole requester, 0 = multicast */
 };
 
+/* repair requested but no requester recorded */
+#define PGM_TXW_NLA_NONE	0xffffffff
+
 struct pgm_txw_t {
 	const pgm_tsi_t* restrict	tsi;
 
@@ -79,6 +84,8 @@ PGM_GNUC_INTERNAL struct pgm_sk_buff_t* pgm_txw_peek (const pgm_txw_t*const, con
 PGM_GNUC_INTERNAL bool pgm_txw_retransmit_push (pgm_txw_t*const, const uint32_t, const bool, const uint8_t) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL struct pgm_sk_buff_t* pgm_txw_retransmit_try_peek (pgm_txw_t*const) PGM_GNUC_WARN_UNUSED_RESULT;
 PGM_GNUC_INTERNAL void pgm_txw_retransmit_remove_head (pgm_txw_t*const);
+PGM_GNUC_INTERNAL void pgm_txw_retransmit_add_nla (pgm_txw_t*const, const uint32_t, const uint32_t);
+PGM_GNUC_INTERNAL uint32_t pgm_txw_get_repair_nla (const struct pgm_sk_buff_t*const) PGM_GNUC_PURE;
 PGM_GNUC_INTERNAL uint32_t pgm_txw_get_unfolded_checksum (const struct pgm_sk_buff_t*const) PGM_GNUC_PURE;
 PGM_GNUC_INTERNAL void pgm_txw_set_unfolded_checksum (struct pgm_sk_buff_t*const, const uint32_t);
 PGM_GNUC_INTERNAL void pgm_txw_inc_retransmit_count (struct pgm_sk_buff_t*const);
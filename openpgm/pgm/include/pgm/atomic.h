@@ -199,6 +199,42 @@ pgm_atomic_dec32 (
 #endif
 }
 
+/* 32-bit word compare-and-swap returning TRUE when the new value is stored.
+ *
+ * 	if (*atomic != oldval) return FALSE;
+ * 	*atomic = newval;
+ * 	return TRUE;
+ */
+
+static inline
+bool
+pgm_atomic_compare_and_swap32 (
+	volatile uint32_t*	atomic,
+	const uint32_t		oldval,
+	const uint32_t		newval
+	)
+{
+#if defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+	uint32_t result;
+	__asm__ volatile ("lock; cmpxchgl %2, %1"
+		        : "=a" (result), "+m" (*atomic)
+		        : "r" (newval), "0" (oldval)
+		        : "memory", "cc"  );
+	return result == oldval;
+#elif defined( __sun ) || defined( __NetBSD__ )
+	return atomic_cas_32 (atomic, oldval, newval) == oldval;
+#elif defined( __APPLE__ )
+	return OSAtomicCompareAndSwap32Barrier ((int32_t)oldval, (int32_t)newval, (volatile int32_t*)atomic);
+#elif defined( __GNUC__ ) && ( __GNUC__ * 100 + __GNUC_MINOR__ >= 401 )
+	return __sync_bool_compare_and_swap (atomic, oldval, newval);
+#elif defined( _AIX )
+	int expected = (int)oldval;
+	return compare_and_swap ((atomic_p)atomic, &expected, (int)newval);
+#elif defined( _WIN32 )
+	return (uint32_t)_InterlockedCompareExchange ((volatile LONG*)atomic, newval, oldval) == oldval;
+#endif
+}
+
 /* 32-bit word load 
  */
 
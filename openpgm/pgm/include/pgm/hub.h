@@ -0,0 +1,64 @@
+/* vim:ts=8:sts=4:sw=4:noai:noexpandtab
+ *
+ * shared memory fan-out of received messages to local subscribers.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_HUB_H__
+#define __PGM_HUB_H__
+
+typedef struct pgm_hub_t pgm_hub_t;
+typedef struct pgm_hub_reader_t pgm_hub_reader_t;
+
+#include <pgm/types.h>
+#include <pgm/error.h>
+#include <pgm/msgv.h>
+#include <pgm/tsi.h>
+
+PGM_BEGIN_DECLS
+
+#define PGM_HUB_MAGIC			0x42484750	/* "PGHB" */
+#define PGM_HUB_VERSION			2
+
+/* ring capacity in bytes when none is specified, rounded up to a power of two */
+#define PGM_HUB_DEFAULT_SIZE		( 16 * 1024 * 1024 )
+
+/* one hub process runs the PGM receiver and publishes each message it reads,
+ * any number of readers attach to the named ring:
+ *
+ *	hub = pgm_hub_create ("/pgm-hub.market", 0, &err);
+ *	while (PGM_IO_STATUS_NORMAL == pgm_recvmsgv (sock, msgv, n, 0, &len, &err))
+ *		pgm_hub_publish (hub, msgv, len);
+ *
+ * readers that fall a full ring behind the hub lose messages, the next read
+ * returns PGM_IO_STATUS_RESET and continues from the newest message.
+ */
+
+pgm_hub_t* pgm_hub_create (const char*, const size_t, pgm_error_t**);
+bool pgm_hub_destroy (pgm_hub_t*);
+size_t pgm_hub_publish (pgm_hub_t*const, const struct pgm_msgv_t*const, const size_t);
+pgm_hub_reader_t* pgm_hub_attach (const char*, pgm_error_t**);
+void pgm_hub_detach (pgm_hub_reader_t*);
+int pgm_hub_read (pgm_hub_reader_t*const, void*, const size_t, size_t*, pgm_tsi_t*);
+
+PGM_END_DECLS
+
+#endif /* __PGM_HUB_H__ */
@@ -0,0 +1,68 @@
+/* vim:ts=8:sts=4:sw=4:noai:noexpandtab
+ *
+ * high dynamic range latency histograms.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_LATENCY_H__
+#define __PGM_LATENCY_H__
+
+typedef struct pgm_latency_t pgm_latency_t;
+
+#include <pgm/types.h>
+#include <pgm/socket.h>
+#include <pgm/time.h>
+#include <pgm/tsi.h>
+
+PGM_BEGIN_DECLS
+
+/* log-linear buckets: exact below 32μs, then 16 buckets per power of two
+ * for a relative error under 6.25% up to 2⁴⁰μs (12.7 days).
+ */
+#define PGM_LATENCY_SUB_BUCKET_BITS	5
+#define PGM_LATENCY_BUCKETS		592
+#define PGM_LATENCY_VALUE_MAX		(((uint64_t)1 << 40) - 1)
+
+/* process-wide metrics */
+enum {
+	PGM_LATENCY_SEND = 0,		/* pgm_send(), pgm_sendv() and pgm_send_skbv() call duration */
+	PGM_LATENCY_RATE_LIMITED,	/* time a send was held by rate control */
+	PGM_LATENCY_DELIVERY,		/* packet receipt to application delivery */
+	PGM_LATENCY_FEC_DECODE,		/* parity reconstruction of a transmission group */
+	PGM_LATENCY_MAX
+};
+
+/* all values in microseconds */
+struct pgm_latency_t {
+	uint64_t	count;
+	uint64_t	sum;
+	uint64_t	max;
+	uint64_t	counts[PGM_LATENCY_BUCKETS];
+};
+
+bool pgm_latency_snapshot (const int, pgm_latency_t*const);
+bool pgm_latency_peer_snapshot (pgm_sock_t*const restrict, const pgm_tsi_t*const restrict, pgm_latency_t*const restrict);
+void pgm_latency_merge (pgm_latency_t*const restrict, const pgm_latency_t*const restrict);
+pgm_time_t pgm_latency_percentile (const pgm_latency_t*const, const double);
+
+PGM_END_DECLS
+
+#endif /* __PGM_LATENCY_H__ */
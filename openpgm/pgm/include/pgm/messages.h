@@ -58,9 +58,13 @@ enum {
 extern int	pgm_log_mask;
 extern int	pgm_min_log_level;
 
+/* with asynchronous logging the handler is called from the log thread, and
+ * messages beyond the per-thread record count are dropped.
+ */
 typedef void (*pgm_log_func_t) (const int, const char*restrict, void*restrict);
 
 pgm_log_func_t pgm_log_set_handler (pgm_log_func_t, void*);
+bool pgm_log_set_async (const unsigned);
 void pgm_messages_init (void);
 void pgm_messages_shutdown (void);
 
@@ -37,12 +37,16 @@
 #include <pgm/engine.h>
 #include <pgm/error.h>
 #include <pgm/gsi.h>
+#include <pgm/hub.h>
 #include <pgm/if.h>
+#include <pgm/latency.h>
 #include <pgm/macros.h>
 #include <pgm/mem.h>
 #include <pgm/messages.h>
 #include <pgm/msgv.h>
 #include <pgm/packet.h>
+#include <pgm/probe.h>
+#include <pgm/shmstats.h>
 #include <pgm/skbuff.h>
 #include <pgm/socket.h>
 #include <pgm/time.h>
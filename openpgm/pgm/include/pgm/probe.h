@@ -0,0 +1,83 @@
+/* vim:ts=8:sts=4:sw=4:noai:noexpandtab
+ *
+ * protocol event tracepoints and binary trace ring.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_PROBE_H__
+#define __PGM_PROBE_H__
+
+typedef struct pgm_probe_record_t pgm_probe_record_t;
+typedef struct pgm_probe_dump_t pgm_probe_dump_t;
+
+#include <pgm/types.h>
+#include <pgm/error.h>
+#include <pgm/tsi.h>
+
+PGM_BEGIN_DECLS
+
+#define PGM_PROBE_DUMP_MAGIC		0x50524750	/* "PGRP" */
+#define PGM_PROBE_DUMP_VERSION		1
+
+/* events, each is also a USDT probe of provider "libpgm" with arguments
+ * (tsi pointer, sequence number, argument).
+ */
+enum {
+	PGM_PROBE_ODATA_SEND = 1,	/* arg: TSDU length */
+	PGM_PROBE_RDATA_SEND,		/* arg: TSDU length */
+	PGM_PROBE_NAK_SEND,		/* arg: sequence count, high bit set for parity */
+	PGM_PROBE_NAK_RECV,		/* arg: sequence count, high bit set for parity */
+	PGM_PROBE_NCF_SEND,		/* arg: sequence count */
+	PGM_PROBE_NCF_RECV,		/* arg: sequence count */
+	PGM_PROBE_RXW_STATE,		/* arg: old state << 16 | new state */
+	PGM_PROBE_PEER_NEW,
+	PGM_PROBE_PEER_EXPIRE,
+	PGM_PROBE_MAX
+};
+
+#define PGM_PROBE_PARITY		0x80000000
+
+/* 32 bytes, native byte order */
+struct pgm_probe_record_t {
+	uint64_t	timestamp;		/* microseconds, pgm_time_t */
+	pgm_tsi_t	tsi;
+	uint32_t	thread;			/* ring index */
+	uint16_t	event;
+	uint16_t	reserved;
+	uint32_t	sqn;
+	uint32_t	arg;
+};
+
+/* dump file header, followed by count records grouped by thread */
+struct pgm_probe_dump_t {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	record_size;
+	uint32_t	count;
+};
+
+bool pgm_probe_ring_enable (const unsigned);
+bool pgm_probe_ring_dump (const char*, pgm_error_t**);
+const char* pgm_probe_event_string (const int) PGM_GNUC_CONST;
+
+PGM_END_DECLS
+
+#endif /* __PGM_PROBE_H__ */
@@ -0,0 +1,166 @@
+/* vim:ts=8:sts=4:sw=4:noai:noexpandtab
+ *
+ * shared memory statistics segment.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+#ifndef __PGM_SHMSTATS_H__
+#define __PGM_SHMSTATS_H__
+
+typedef struct pgm_shmstats_t pgm_shmstats_t;
+typedef struct pgm_shmstats_sock_t pgm_shmstats_sock_t;
+typedef struct pgm_shmstats_peer_t pgm_shmstats_peer_t;
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+#include <pgm/types.h>
+#include <pgm/error.h>
+#include <pgm/tsi.h>
+
+PGM_BEGIN_DECLS
+
+#define PGM_SHMSTATS_MAGIC		0x534d4750	/* "PGMS" */
+#define PGM_SHMSTATS_VERSION		1
+
+/* segment capacity, sockets and peers beyond are counted as dropped */
+#define PGM_SHMSTATS_MAX_SOCKS		64
+#define PGM_SHMSTATS_MAX_PEERS		1024
+#define PGM_SHMSTATS_SOURCE_COUNTERS	32
+#define PGM_SHMSTATS_RECEIVER_COUNTERS	40
+#define PGM_SHMSTATS_NAME_LEN		48
+
+/* segment name when none is specified, formatted with the process id */
+#define PGM_SHMSTATS_DEFAULT_NAME	"/pgm-stats.%d"
+
+enum {
+	PGM_SHMSTATS_CAN_SEND = 0x1,
+	PGM_SHMSTATS_CAN_RECV = 0x2
+};
+
+struct pgm_shmstats_sock_t {
+	pgm_tsi_t	tsi;
+	uint16_t	dport;				/* network order */
+	uint16_t	flags;
+	uint32_t	txw_trail;
+	uint32_t	txw_lead;
+	uint32_t	txw_bytes;
+	uint32_t	n_peers;
+	int64_t		rate_per_sec;			/* 0 = not rate limited */
+	int64_t		rate_limit;			/* bytes available, negative whilst in debt */
+	int64_t		odata_rate_per_sec;
+	int64_t		rdata_rate_per_sec;
+	uint32_t	counters[PGM_SHMSTATS_SOURCE_COUNTERS];
+};
+
+struct pgm_shmstats_peer_t {
+	uint32_t	sock_index;			/* owning entry of socks[] */
+	pgm_tsi_t	tsi;
+	uint32_t	rxw_trail;
+	uint32_t	rxw_lead;
+	uint32_t	commit_lead;
+	uint32_t	rxw_bytes;
+	uint32_t	cumulative_losses;
+	uint32_t	bytes_delivered;
+	uint32_t	msgs_delivered;
+	uint32_t	repair_p50;			/* first NAK to repair, microseconds */
+	uint32_t	repair_p99;
+	uint32_t	repair_max;
+	uint64_t	repair_count;
+	uint64_t	repair_sum;
+	uint32_t	counters[PGM_SHMSTATS_RECEIVER_COUNTERS];
+};
+
+struct pgm_shmstats_t {
+/* constant after creation */
+	uint32_t		magic;
+	uint32_t		version;
+	uint32_t		size;			/* of this structure */
+	uint32_t		pid;
+	uint32_t		interval;		/* publish period in milliseconds */
+	uint32_t		source_counters;	/* used entries of counters[] */
+	uint32_t		receiver_counters;
+	char			source_counter_names[PGM_SHMSTATS_SOURCE_COUNTERS][PGM_SHMSTATS_NAME_LEN];
+	char			receiver_counter_names[PGM_SHMSTATS_RECEIVER_COUNTERS][PGM_SHMSTATS_NAME_LEN];
+
+/* seqlock, odd whilst the publisher is writing the fields below */
+	volatile uint32_t	seq;
+	uint32_t		n_socks;
+	uint32_t		n_peers;
+	uint32_t		dropped_socks;
+	uint32_t		dropped_peers;
+	uint64_t		timestamp;		/* publish time in microseconds */
+	pgm_shmstats_sock_t	socks[PGM_SHMSTATS_MAX_SOCKS];
+	pgm_shmstats_peer_t	peers[PGM_SHMSTATS_MAX_PEERS];
+};
+
+/* reader side of the seqlock:
+ *
+ *	do {
+ *		seq = pgm_shmstats_read_begin (stats);
+ *		memcpy (&copy, stats, sizeof (copy));
+ *	} while (pgm_shmstats_read_retry (stats, seq));
+ */
+
+static inline
+void
+pgm_shmstats_barrier (void)
+{
+#if defined( __GNUC__ )
+	__sync_synchronize();
+#elif defined( _MSC_VER )
+	_ReadWriteBarrier();
+#endif
+}
+
+static inline
+uint32_t
+pgm_shmstats_read_begin (
+	const pgm_shmstats_t*	stats
+	)
+{
+	uint32_t seq;
+	while ((seq = stats->seq) & 1)
+		;
+	pgm_shmstats_barrier();
+	return seq;
+}
+
+static inline
+bool
+pgm_shmstats_read_retry (
+	const pgm_shmstats_t*	stats,
+	const uint32_t		seq
+	)
+{
+	pgm_shmstats_barrier();
+	return (stats->seq != seq);
+}
+
+bool pgm_shmstats_init (const char*, const unsigned, pgm_error_t**);
+bool pgm_shmstats_shutdown (void);
+bool pgm_shmstats_read (pgm_shmstats_t*const);
+const pgm_shmstats_t* pgm_shmstats_attach (const char*, pgm_error_t**);
+void pgm_shmstats_detach (const pgm_shmstats_t*);
+
+PGM_END_DECLS
+
+#endif /* __PGM_SHMSTATS_H__ */
@@ -88,6 +88,12 @@ struct pgm_fecinfo_t {
 	bool					var_pktlen_enabled;
 };
 
+struct pgm_adaptfecinfo_t {
+	uint8_t					min_proactive_packets;
+	uint8_t					max_proactive_packets;
+	uint32_t				target_nak_ppm;
+};
+
 struct pgm_pgmccinfo_t {
 	uint32_t				ack_bo_ivl;
 	uint32_t				ack_c;
@@ -149,7 +155,30 @@ enum {
 	PGM_UNCONTROLLED_ODATA,
 	PGM_UNCONTROLLED_RDATA,
 	PGM_ODATA_MAX_RTE,
-	PGM_RDATA_MAX_RTE
+	PGM_RDATA_MAX_RTE,
+	PGM_UNORDERED,
+	PGM_REPAIR_DEADLINE,
+	PGM_DECODE_THREADS,
+	PGM_ENGINE_THREAD,
+	PGM_ENGINE_AFFINITY,
+	PGM_USE_TIMERFD,
+	PGM_TIMER_SOCK,
+	PGM_UNICAST_REPAIR,
+	PGM_DLR,
+	PGM_ADAPT_FEC,
+	PGM_CC_ALGORITHM,
+	PGM_HOST_NAK_SUPPRESSION,
+	PGM_REDUNDANT_SEND_GROUP,
+	PGM_REDUNDANT_TSI,
+	PGM_SPM_SCHEDULER,
+	PGM_DLR_REDIRECT,
+	PGM_REDUNDANT_RECV_GROUP
+};
+
+/* PGMCC congestion window algorithms */
+enum {
+	PGM_CC_RENO,			/* RFC 3208 PGMCC, default */
+	PGM_CC_CUBIC			/* RFC 8312, high bandwidth-delay paths */
 };
 
 /* IO status */
@@ -162,7 +191,8 @@ enum {
 	PGM_IO_STATUS_WOULD_BLOCK,	/* resource temporarily unavailable */
 	PGM_IO_STATUS_RATE_LIMITED,	/* would-block on rate limit, check timer */
 	PGM_IO_STATUS_TIMER_PENDING,	/* would-block with pending timer */
-	PGM_IO_STATUS_CONGESTION	/* would-block waiting on ACK or timeout */
+	PGM_IO_STATUS_CONGESTION,	/* would-block waiting on ACK or timeout */
+	PGM_IO_STATUS_LOSS		/* unordered delivery lost sequences, non-fatal */
 };
 
 /* Socket count for event handlers */
@@ -187,6 +217,7 @@ int pgm_sendv (pgm_sock_t*const restrict, const struct pgm_iovec*const restrict,
 int pgm_send_skbv (pgm_sock_t*const restrict, struct pgm_sk_buff_t**const restrict, const unsigned, const bool, size_t*restrict);
 int pgm_recvmsg (pgm_sock_t*const restrict, struct pgm_msgv_t*const restrict, const int, size_t*restrict, pgm_error_t**restrict) PGM_GNUC_WARN_UNUSED_RESULT;
 int pgm_recvmsgv (pgm_sock_t*const restrict, struct pgm_msgv_t*const restrict, const size_t, const int, size_t*restrict, pgm_error_t**restrict) PGM_GNUC_WARN_UNUSED_RESULT;
+int pgm_recvmsgv_tsi (pgm_sock_t*const restrict, const pgm_tsi_t*const restrict, struct pgm_msgv_t*const restrict, const size_t, const int, size_t*restrict, pgm_error_t**restrict) PGM_GNUC_WARN_UNUSED_RESULT;
 int pgm_recv (pgm_sock_t*const restrict, void*restrict, const size_t, const int, size_t*const restrict, pgm_error_t**restrict) PGM_GNUC_WARN_UNUSED_RESULT;
 int pgm_recvfrom (pgm_sock_t*const restrict, void*restrict, const size_t, const int, size_t*restrict, struct pgm_sockaddr_t*restrict, socklen_t*restrict, pgm_error_t**restrict) PGM_GNUC_WARN_UNUSED_RESULT;
 
@@ -31,6 +31,16 @@ PGM_BEGIN_DECLS
 
 typedef uint64_t pgm_time_t;
 typedef void (*pgm_time_since_epoch_func)(const pgm_time_t*const restrict, time_t*restrict);
+typedef struct pgm_time_info_t pgm_time_info_t;
+
+/* active clock source as selected by PGM_TIMER */
+struct pgm_time_info_t {
+	const char*	source;
+	uint64_t	frequency;		/* counter rate in Hz, 0 for system clocks */
+	uint32_t	precision;		/* nanoseconds per tick of the source */
+	bool		is_invariant;		/* invariant TSC read inline */
+	bool		is_cached;		/* TSC frequency from the calibration cache */
+};
 
 #define pgm_to_secs(t)	((uint64_t)( (t) / 1000000UL ))
 #define pgm_to_msecs(t)	((uint64_t)( (t) / 1000UL ))
@@ -51,6 +61,8 @@ typedef void (*pgm_time_since_epoch_func)(const pgm_time_t*const restrict, time_
 
 extern pgm_time_since_epoch_func	pgm_time_since_epoch;
 
+bool pgm_time_get_info (pgm_time_info_t*const);
+
 PGM_END_DECLS
 
 #endif /* __PGM_TIME_H__ */
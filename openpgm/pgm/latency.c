@@ -0,0 +1,246 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * High dynamic range latency histograms.  Each thread records into its own
+ * block so the hot path takes no locks and shares no cache lines, readers
+ * merge every block into a snapshot.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+#include <impl/framework.h>
+#include <impl/socket.h>
+#include <impl/receiver.h>
+
+
+//#define LATENCY_DEBUG
+
+/* per-thread metrics, released for reuse by another thread on exit */
+struct pgm_latency_block_t {
+	pgm_tls_slot_t		slot;
+	pgm_latency_t		metrics[PGM_LATENCY_MAX];
+};
+
+typedef struct pgm_latency_block_t pgm_latency_block_t;
+
+static volatile uint32_t		latency_ref_count = 0;
+static pgm_tls_pool_t			latency_pool;
+
+static PGM_THREAD_LOCAL pgm_latency_block_t*	latency_block = NULL;
+static PGM_THREAD_LOCAL uint32_t		latency_block_generation = 0;
+
+
+PGM_GNUC_INTERNAL
+void
+pgm_latency_init (void)
+{
+	if (pgm_atomic_exchange_and_add32 (&latency_ref_count, 1) > 0)
+		return;
+
+	pgm_tls_pool_init (&latency_pool);
+}
+
+PGM_GNUC_INTERNAL
+void
+pgm_latency_shutdown (void)
+{
+	pgm_return_if_fail (pgm_atomic_read32 (&latency_ref_count) > 0);
+
+	if (pgm_atomic_exchange_and_add32 (&latency_ref_count, (uint32_t)-1) != 1)
+		return;
+
+	pgm_tls_pool_free (&latency_pool);
+}
+
+/* bind the calling thread to a free block or a new one.
+ */
+
+static
+pgm_latency_block_t*
+_pgm_latency_acquire (void)
+{
+	if (PGM_UNLIKELY(0 == pgm_atomic_read32 (&latency_ref_count)))
+		return NULL;
+
+	latency_block_generation = pgm_tls_pool_generation (&latency_pool);
+	latency_block = pgm_tls_pool_acquire (&latency_pool, sizeof (pgm_latency_block_t));
+	return latency_block;
+}
+
+/* record one sample of a process-wide metric in microseconds.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_latency_add (
+	const int		metric,
+	const pgm_time_t	usecs
+	)
+{
+	pgm_assert (metric >= 0 && metric < PGM_LATENCY_MAX);
+
+	pgm_latency_block_t* block = latency_block;
+	if (PGM_UNLIKELY(NULL == block ||
+			 latency_block_generation != pgm_tls_pool_generation (&latency_pool)))
+	{
+		block = _pgm_latency_acquire ();
+		if (PGM_UNLIKELY(NULL == block))
+			return;
+	}
+	pgm_latency_record (&block->metrics[ metric ], usecs);
+}
+
+/* add source counts to destination, snapshots of any origin can be combined.
+ */
+
+void
+pgm_latency_merge (
+	pgm_latency_t*	     const restrict dst,
+	const pgm_latency_t* const restrict src
+	)
+{
+	pgm_return_if_fail (NULL != dst);
+	pgm_return_if_fail (NULL != src);
+
+	for (unsigned i = 0; i < PGM_LATENCY_BUCKETS; i++)
+		dst->counts[ i ] += src->counts[ i ];
+	dst->count += src->count;
+	dst->sum   += src->sum;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+/* merge all thread blocks of one metric into a caller owned snapshot.
+ *
+ * returns TRUE on success, returns FALSE on invalid metric.
+ */
+
+bool
+pgm_latency_snapshot (
+	const int		metric,
+	pgm_latency_t* const	latency
+	)
+{
+	pgm_return_val_if_fail (metric >= 0 && metric < PGM_LATENCY_MAX, FALSE);
+	pgm_return_val_if_fail (NULL != latency, FALSE);
+
+	memset (latency, 0, sizeof (pgm_latency_t));
+	if (0 == pgm_atomic_read32 (&latency_ref_count))
+		return TRUE;
+
+	pgm_mutex_lock (&latency_pool.mutex);
+	for (pgm_slist_t* list = latency_pool.slots; list; list = list->next) {
+		const pgm_latency_block_t* block = list->data;
+		pgm_latency_merge (latency, &block->metrics[ metric ]);
+	}
+	pgm_mutex_unlock (&latency_pool.mutex);
+	return TRUE;
+}
+
+/* NAK to RDATA repair latency of one source, or of every source of the socket
+ * when tsi is NULL.
+ *
+ * returns TRUE on success, returns FALSE if the source is unknown.
+ */
+
+bool
+pgm_latency_peer_snapshot (
+	pgm_sock_t*	 const restrict	sock,
+	const pgm_tsi_t* const restrict	tsi,
+	pgm_latency_t*	 const restrict	latency
+	)
+{
+	bool status = FALSE;
+
+	pgm_return_val_if_fail (NULL != sock, FALSE);
+	pgm_return_val_if_fail (NULL != latency, FALSE);
+
+	memset (latency, 0, sizeof (pgm_latency_t));
+	if (PGM_UNLIKELY(!pgm_rwlock_reader_trylock (&sock->lock)))
+		pgm_return_val_if_reached (FALSE);
+	if (PGM_UNLIKELY(!sock->is_bound || sock->is_destroyed || !sock->can_recv_data)) {
+		pgm_rwlock_reader_unlock (&sock->lock);
+		return FALSE;
+	}
+
+/* peers are only destroyed under the writer lock */
+	pgm_rwlock_reader_lock (&sock->peers_lock);
+/* window histograms are updated under the peer mutex */
+	if (NULL != tsi) {
+		pgm_peer_t* peer = pgm_hashtable_lookup (sock->peers_hashtable, tsi);
+		if (NULL != peer) {
+			pgm_mutex_lock (&peer->mutex);
+			pgm_latency_merge (latency, &((const pgm_rxw_t*)peer->window)->repair_latency);
+			pgm_mutex_unlock (&peer->mutex);
+			status = TRUE;
+		}
+	} else {
+		for (pgm_list_t* list = sock->peers_list; list; list = list->next) {
+			pgm_peer_t* peer = list->data;
+			pgm_mutex_lock (&peer->mutex);
+			pgm_latency_merge (latency, &((const pgm_rxw_t*)peer->window)->repair_latency);
+			pgm_mutex_unlock (&peer->mutex);
+		}
+		status = TRUE;
+	}
+	pgm_rwlock_reader_unlock (&sock->peers_lock);
+	pgm_rwlock_reader_unlock (&sock->lock);
+	return status;
+}
+
+/* value at or below which the percentile of samples fall, reported as the
+ * upper bound of the containing bucket and capped by the largest sample.
+ *
+ * returns 0 for an empty histogram.
+ */
+
+pgm_time_t
+pgm_latency_percentile (
+	const pgm_latency_t* const	latency,
+	const double			percentile
+	)
+{
+	uint64_t total = 0;
+
+	pgm_return_val_if_fail (NULL != latency, 0);
+	pgm_return_val_if_fail (percentile >= 0.0 && percentile <= 100.0, 0);
+
+	for (unsigned i = 0; i < PGM_LATENCY_BUCKETS; i++)
+		total += latency->counts[ i ];
+	if (0 == total)
+		return 0;
+
+	uint64_t target = (uint64_t)((percentile / 100.0) * (double)total + 0.5);
+	if (target < 1)
+		target = 1;
+	if (target > total)
+		target = total;
+
+	uint64_t seen = 0;
+	for (unsigned i = 0; i < PGM_LATENCY_BUCKETS; i++) {
+		seen += latency->counts[ i ];
+		if (seen >= target) {
+			const uint64_t value = pgm_latency_bucket_value (i);
+			return (latency->max && value > latency->max) ? latency->max : value;
+		}
+	}
+	return latency->max;
+}
+
+/* eof */
@@ -0,0 +1,271 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * unit tests for latency histograms.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <check.h>
+
+#ifdef _WIN32
+#	define PGM_CHECK_NOFORK		1
+#endif
+
+
+/* mock state */
+
+
+/* mock functions for external references */
+
+size_t
+pgm_transport_pkt_offset2 (
+        const bool                      can_fragment,
+        const bool                      use_pgmcc
+        )
+{
+        return 0;
+}
+
+#define pgm_hashtable_lookup	mock_pgm_hashtable_lookup
+
+#define LATENCY_DEBUG
+#include "latency.c"
+
+PGM_GNUC_INTERNAL
+int
+pgm_get_nprocs (void)
+{
+	return 1;
+}
+
+PGM_GNUC_INTERNAL
+void*
+mock_pgm_hashtable_lookup (
+	const pgm_hashtable_t*	hash_table,
+	const void*		key
+	)
+{
+	return NULL;
+}
+
+
+/* target:
+ *	unsigned
+ *	pgm_latency_bucket (
+ *		const uint64_t		value
+ *	)
+ */
+
+START_TEST (test_bucket_pass_001)
+{
+/* exact below 2^SUB_BUCKET_BITS */
+	for (uint64_t i = 0; i < 32; i++) {
+		fail_unless (i == pgm_latency_bucket (i), "bucket failed");
+		fail_unless (i == pgm_latency_bucket_value ((unsigned)i), "bucket value failed");
+	}
+/* upper bound holds value within 1/16 */
+	for (uint64_t i = 32; i < 1000000; i += 7) {
+		const unsigned bucket = pgm_latency_bucket (i);
+		const uint64_t value = pgm_latency_bucket_value (bucket);
+		fail_unless (bucket < PGM_LATENCY_BUCKETS, "bucket overflow");
+		fail_unless (value >= i, "upper bound below value");
+		fail_unless ((value - i) * 16 < i, "relative error exceeded");
+	}
+	fail_unless (PGM_LATENCY_BUCKETS - 1 == pgm_latency_bucket (PGM_LATENCY_VALUE_MAX), "last bucket failed");
+	fail_unless (PGM_LATENCY_VALUE_MAX == pgm_latency_bucket_value (PGM_LATENCY_BUCKETS - 1), "last bucket value failed");
+}
+END_TEST
+
+/* target:
+ *	pgm_time_t
+ *	pgm_latency_percentile (
+ *		const pgm_latency_t*	latency,
+ *		const double		percentile
+ *	)
+ */
+
+START_TEST (test_percentile_pass_001)
+{
+	pgm_latency_t latency;
+	memset (&latency, 0, sizeof(latency));
+	fail_unless (0 == pgm_latency_percentile (&latency, 50.0), "empty percentile failed");
+	for (unsigned i = 1; i <= 1000; i++)
+		pgm_latency_record (&latency, i);
+	fail_unless (1000 == latency.count, "count failed");
+	fail_unless (500500 == latency.sum, "sum failed");
+	fail_unless (1000 == latency.max, "max failed");
+	const pgm_time_t p50 = pgm_latency_percentile (&latency, 50.0);
+	fail_unless (p50 >= 500 && p50 < 532, "p50 failed");
+	const pgm_time_t p99 = pgm_latency_percentile (&latency, 99.0);
+	fail_unless (p99 >= 990 && p99 <= 1000, "p99 failed");
+	fail_unless (1000 == pgm_latency_percentile (&latency, 100.0), "p100 failed");
+	fail_unless (1 == pgm_latency_percentile (&latency, 0.0), "p0 failed");
+}
+END_TEST
+
+START_TEST (test_percentile_fail_001)
+{
+	pgm_latency_t latency;
+	memset (&latency, 0, sizeof(latency));
+	fail_unless (0 == pgm_latency_percentile (NULL, 50.0), "percentile failed");
+	fail_unless (0 == pgm_latency_percentile (&latency, 101.0), "percentile failed");
+}
+END_TEST
+
+/* target:
+ *	void
+ *	pgm_latency_merge (
+ *		pgm_latency_t*		dst,
+ *		const pgm_latency_t*	src
+ *	)
+ */
+
+START_TEST (test_merge_pass_001)
+{
+	pgm_latency_t a, b;
+	memset (&a, 0, sizeof(a));
+	memset (&b, 0, sizeof(b));
+	pgm_latency_record (&a, 10);
+	pgm_latency_record (&b, 20);
+	pgm_latency_record (&b, 3000);
+	pgm_latency_merge (&a, &b);
+	fail_unless (3 == a.count, "count failed");
+	fail_unless (3030 == a.sum, "sum failed");
+	fail_unless (3000 == a.max, "max failed");
+	fail_unless (1 == a.counts[ pgm_latency_bucket (3000) ], "counts failed");
+}
+END_TEST
+
+START_TEST (test_merge_fail_001)
+{
+	pgm_latency_merge (NULL, NULL);
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_latency_snapshot (
+ *		const int		metric,
+ *		pgm_latency_t*		latency
+ *	)
+ */
+
+START_TEST (test_snapshot_pass_001)
+{
+	pgm_latency_t latency;
+	pgm_latency_init ();
+	pgm_latency_add (PGM_LATENCY_SEND, 10);
+	pgm_latency_add (PGM_LATENCY_SEND, 20);
+	pgm_latency_add (PGM_LATENCY_DELIVERY, 30);
+	fail_unless (TRUE == pgm_latency_snapshot (PGM_LATENCY_SEND, &latency), "snapshot failed");
+	fail_unless (2 == latency.count, "send count failed");
+	fail_unless (20 == latency.max, "send max failed");
+	fail_unless (TRUE == pgm_latency_snapshot (PGM_LATENCY_DELIVERY, &latency), "snapshot failed");
+	fail_unless (1 == latency.count, "delivery count failed");
+	pgm_latency_shutdown ();
+/* samples after shutdown are discarded */
+	pgm_latency_add (PGM_LATENCY_SEND, 10);
+	fail_unless (TRUE == pgm_latency_snapshot (PGM_LATENCY_SEND, &latency), "snapshot failed");
+	fail_unless (0 == latency.count, "shutdown count failed");
+}
+END_TEST
+
+START_TEST (test_snapshot_fail_001)
+{
+	pgm_latency_t latency;
+	fail_unless (FALSE == pgm_latency_snapshot (PGM_LATENCY_MAX, &latency), "snapshot failed");
+	fail_unless (FALSE == pgm_latency_snapshot (PGM_LATENCY_SEND, NULL), "snapshot failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_latency_peer_snapshot (
+ *		pgm_sock_t*		sock,
+ *		const pgm_tsi_t*	tsi,
+ *		pgm_latency_t*		latency
+ *	)
+ */
+
+START_TEST (test_peer_snapshot_fail_001)
+{
+	pgm_latency_t latency;
+	fail_unless (FALSE == pgm_latency_peer_snapshot (NULL, NULL, &latency), "peer snapshot failed");
+}
+END_TEST
+
+
+static
+Suite*
+make_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create (__FILE__);
+
+	TCase* tc_bucket = tcase_create ("bucket");
+	suite_add_tcase (s, tc_bucket);
+	tcase_add_test (tc_bucket, test_bucket_pass_001);
+
+	TCase* tc_percentile = tcase_create ("percentile");
+	suite_add_tcase (s, tc_percentile);
+	tcase_add_test (tc_percentile, test_percentile_pass_001);
+	tcase_add_test (tc_percentile, test_percentile_fail_001);
+
+	TCase* tc_merge = tcase_create ("merge");
+	suite_add_tcase (s, tc_merge);
+	tcase_add_test (tc_merge, test_merge_pass_001);
+	tcase_add_test (tc_merge, test_merge_fail_001);
+
+	TCase* tc_snapshot = tcase_create ("snapshot");
+	suite_add_tcase (s, tc_snapshot);
+	tcase_add_test (tc_snapshot, test_snapshot_pass_001);
+	tcase_add_test (tc_snapshot, test_snapshot_fail_001);
+
+	TCase* tc_peer_snapshot = tcase_create ("peer-snapshot");
+	suite_add_tcase (s, tc_peer_snapshot);
+	tcase_add_test (tc_peer_snapshot, test_peer_snapshot_fail_001);
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	pgm_messages_init();
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_test_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	pgm_messages_shutdown();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
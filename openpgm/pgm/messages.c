@@ -26,12 +26,51 @@
 #include <stdio.h>
 #ifndef _WIN32
 #	include <unistd.h>
+#	ifdef HAVE_POLL
+#		include <poll.h>
+#	endif
 #else
 #	include <io.h>
+#	include <process.h>
 #endif
 #include <impl/framework.h>
 
 
+//#define MESSAGES_DEBUG
+
+/* records per thread when enabled through the environment without a size */
+#define PGM_LOG_ASYNC_DEFAULT_RECORDS	64
+
+/* fixed record size including the level */
+#define PGM_LOG_RECORD_SIZE		512
+
+/* log thread drain period in milliseconds */
+#define PGM_LOG_ASYNC_INTERVAL		100
+
+/* rendered message awaiting the log thread */
+struct pgm_log_record_t {
+	int			log_level;
+	char			message[PGM_LOG_RECORD_SIZE - sizeof (int)];
+};
+
+typedef struct pgm_log_record_t pgm_log_record_t;
+
+/* single producer, single consumer ring per thread, released for reuse by
+ * another thread on exit.
+ */
+struct pgm_log_ring_t {
+	pgm_tls_slot_t		slot;
+	uint32_t		mask;
+	volatile uint32_t	head;		/* owning thread */
+	volatile uint32_t	tail;		/* log thread */
+	volatile uint32_t	dropped;	/* owning thread */
+	uint32_t		reported;	/* log thread */
+	pgm_log_record_t	records[];
+};
+
+typedef struct pgm_log_ring_t pgm_log_ring_t;
+
+
 /* globals */
 
 /* bit mask for trace role modules */
@@ -57,7 +96,24 @@ static pgm_mutex_t		messages_mutex;
 static pgm_log_func_t 		log_handler PGM_GNUC_READ_MOSTLY = NULL;
 static void* 			log_handler_closure PGM_GNUC_READ_MOSTLY = NULL;
 
+static pgm_mutex_t		log_async_mutex;	/* serialises pgm_log_set_async() */
+static volatile bool		log_is_async PGM_GNUC_READ_MOSTLY = FALSE;
+static volatile uint32_t	log_is_terminated = 0;
+static unsigned			log_ring_size = 0;
+static pgm_tls_pool_t		log_pool;
+static bool			log_has_notify = FALSE;
+static pgm_notify_t		log_notify;
+#ifndef _WIN32
+static pthread_t		log_thread;
+#else
+static HANDLE			log_thread;
+#endif
+
+static PGM_THREAD_LOCAL pgm_log_ring_t*	log_ring = NULL;
+static PGM_THREAD_LOCAL uint32_t	log_ring_generation = 0;
+
 static inline const char* log_level_text (const int) PGM_GNUC_PURE;
+static void _pgm_log_stop (void);
 
 
 static inline
@@ -78,6 +134,17 @@ log_level_text (
 	}
 }
 
+static inline
+void
+log_barrier (void)
+{
+#if defined( __GNUC__ )
+	__sync_synchronize();
+#elif defined( _MSC_VER )
+	_ReadWriteBarrier();
+#endif
+}
+
 /* reference counted init and shutdown
  */
 
@@ -92,6 +159,8 @@ pgm_messages_init (void)
 		return;
 
 	pgm_mutex_init (&messages_mutex);
+	pgm_mutex_init (&log_async_mutex);
+	pgm_tls_pool_init (&log_pool);
 
 	err = pgm_dupenv_s (&log_mask, &len, "PGM_LOG_MASK");
 	if (!err && len > 0) {
@@ -115,6 +184,14 @@ pgm_messages_init (void)
 		}
 		pgm_free (min_log_level);
 	}
+
+	char* log_async;
+	err = pgm_dupenv_s (&log_async, &len, "PGM_LOG_ASYNC");
+	if (!err && len > 0) {
+		const int records = atoi (log_async);
+		pgm_log_set_async (records > 0 ? (unsigned)records : PGM_LOG_ASYNC_DEFAULT_RECORDS);
+		pgm_free (log_async);
+	}
 }
 
 void
@@ -125,6 +202,14 @@ pgm_messages_shutdown (void)
 	if (pgm_atomic_exchange_and_add32 (&messages_ref_count, (uint32_t)-1) != 1)
 		return;
 
+	if (log_is_async)
+		_pgm_log_stop ();
+	if (log_has_notify) {
+		pgm_notify_destroy (&log_notify);
+		log_has_notify = FALSE;
+	}
+	pgm_tls_pool_free (&log_pool);
+	pgm_mutex_free (&log_async_mutex);
 	pgm_mutex_free (&messages_mutex);
 }
 
@@ -153,6 +238,265 @@ pgm_log_set_handler (
 	return previous_handler;
 }
 
+/* deliver one rendered message, caller holds messages_mutex.
+ */
+
+static
+void
+_pgm_log_write (
+	const int		log_level,
+	const char*		message
+	)
+{
+	if (log_handler) {
+		log_handler (log_level, message, log_handler_closure);
+	} else {
+#ifdef _MSC_VER
+		const int stdoutfd = _fileno (stdout);
+		_write (stdoutfd, message, (unsigned)strlen (message));
+		_write (stdoutfd, "\n", 1);
+#else
+/* ignore return value */
+		(void) write (STDOUT_FILENO, message, strlen (message));
+		(void) write (STDOUT_FILENO, "\n", 1);
+#endif
+	}
+}
+
+/* deliver every pending record of every ring, caller holds messages_mutex.
+ * rings of a previous size are freed once drained and released by their
+ * thread.
+ */
+
+static
+void
+_pgm_log_drain (void)
+{
+	const size_t size = sizeof (pgm_log_ring_t) + log_ring_size * sizeof (pgm_log_record_t);
+	pgm_mutex_lock (&log_pool.mutex);
+	for (pgm_slist_t* restrict* link = &log_pool.slots; *link; ) {
+		pgm_log_ring_t* ring = (*link)->data;
+		uint32_t tail = ring->tail;
+		const uint32_t head = pgm_atomic_read32 (&ring->head);
+		log_barrier();
+		while (tail != head) {
+			const pgm_log_record_t* record = &ring->records[ tail & ring->mask ];
+			_pgm_log_write (record->log_level, record->message);
+			tail++;
+		}
+		log_barrier();
+		pgm_atomic_write32 (&ring->tail, tail);
+
+		const uint32_t dropped = pgm_atomic_read32 (&ring->dropped);
+		if (PGM_UNLIKELY(dropped != ring->reported)) {
+			char tbuf[128];
+			pgm_snprintf_s (tbuf, sizeof (tbuf), _TRUNCATE, "%s: %u log messages dropped.",
+					log_level_text (PGM_LOG_LEVEL_WARNING), (unsigned)(dropped - ring->reported));
+			_pgm_log_write (PGM_LOG_LEVEL_WARNING, tbuf);
+			ring->reported = dropped;
+		}
+
+		if (!ring->slot.is_active && ring->slot.size != size) {
+			*link = (*link)->next;
+			pgm_free (ring);
+			continue;
+		}
+		link = &(*link)->next;
+	}
+	pgm_mutex_unlock (&log_pool.mutex);
+}
+
+static
+void
+_pgm_log_wait (void)
+{
+	const SOCKET notify_fd = pgm_notify_get_socket (&log_notify);
+#ifdef HAVE_POLL
+	struct pollfd fds[1];
+	memset (fds, 0, sizeof (fds));
+	fds[0].fd = notify_fd;
+	fds[0].events = POLLIN;
+	poll (fds, 1, PGM_LOG_ASYNC_INTERVAL);
+#else
+	fd_set readfds;
+	FD_ZERO(&readfds);
+	FD_SET(notify_fd, &readfds);
+	struct timeval tv_timeout = {
+		.tv_sec		= 0,
+		.tv_usec	= PGM_LOG_ASYNC_INTERVAL * 1000
+	};
+	select ((int)notify_fd + 1, &readfds, NULL, NULL, &tv_timeout);
+#endif /* HAVE_POLL */
+	pgm_notify_clear (&log_notify);
+}
+
+#ifndef _WIN32
+static
+void*
+#else
+static
+unsigned
+__stdcall
+#endif
+log_routine (
+	PGM_GNUC_UNUSED void*	arg
+	)
+{
+	while (!pgm_atomic_read32 (&log_is_terminated)) {
+		_pgm_log_wait ();
+		pgm_mutex_lock (&messages_mutex);
+		_pgm_log_drain ();
+		pgm_mutex_unlock (&messages_mutex);
+	}
+#ifndef _WIN32
+	return NULL;
+#else
+	_endthread();
+	return 0;
+#endif
+}
+
+/* stop the log thread and deliver what remains synchronously, the wakeup
+ * channel stays open for threads still finishing a push.  a push racing the
+ * flag is delivered by the next synchronous message.
+ */
+
+static
+void
+_pgm_log_stop (void)
+{
+	pgm_atomic_write32 (&log_is_terminated, 1);
+	pgm_notify_send (&log_notify);
+#ifndef _WIN32
+	pthread_join (log_thread, NULL);
+#else
+	WaitForSingleObject (log_thread, INFINITE);
+	CloseHandle (log_thread);
+#endif
+	pgm_mutex_lock (&messages_mutex);
+	log_is_async = FALSE;
+	_pgm_log_drain ();
+	pgm_mutex_unlock (&messages_mutex);
+}
+
+/* move logging off the calling threads: messages are rendered into a per-
+ * thread ring of the given number of records without locking and delivered
+ * by a log thread.  fatal messages remain synchronous.  zero records
+ * returns to synchronous logging.
+ *
+ * returns TRUE on success, returns FALSE if the library is not initialised
+ * or the log thread cannot be created.
+ */
+
+bool
+pgm_log_set_async (
+	const unsigned		records
+	)
+{
+	bool status = TRUE;
+
+	if (0 == pgm_atomic_read32 (&messages_ref_count))
+		return FALSE;
+
+	pgm_mutex_lock (&log_async_mutex);
+	if (0 == records) {
+		if (log_is_async)
+			_pgm_log_stop ();
+		goto out;
+	}
+
+	unsigned size = 1;
+	while (size < records && size < (1U << 16))
+		size <<= 1;
+	if (size != log_ring_size) {
+		pgm_mutex_lock (&messages_mutex);
+/* messages queued at the old size go first */
+		if (log_has_notify)
+			_pgm_log_drain ();
+		log_ring_size = size;
+		pgm_mutex_unlock (&messages_mutex);
+/* rebind threads to rings of the new size, releasing the old */
+		pgm_tls_pool_invalidate (&log_pool);
+	}
+	if (log_is_async)
+		goto out;
+
+	status = FALSE;
+	if (!log_has_notify) {
+		if (0 != pgm_notify_init (&log_notify))
+			goto out;
+		log_has_notify = TRUE;
+	}
+	pgm_atomic_write32 (&log_is_terminated, 0);
+#ifndef _WIN32
+	if (0 != pthread_create (&log_thread, NULL, &log_routine, NULL))
+		goto out;
+#else
+	log_thread = (HANDLE)_beginthreadex (NULL, 0, &log_routine, NULL, 0, NULL);
+	if (0 == log_thread)
+		goto out;
+#endif /* _WIN32 */
+	log_is_async = TRUE;
+	status = TRUE;
+out:
+	pgm_mutex_unlock (&log_async_mutex);
+	return status;
+}
+
+/* bind the calling thread to a free ring of the current size or a new one.
+ */
+
+static
+pgm_log_ring_t*
+_pgm_log_acquire (void)
+{
+	pgm_mutex_lock (&messages_mutex);
+	const unsigned size = log_ring_size;
+	pgm_mutex_unlock (&messages_mutex);
+	log_ring_generation = pgm_tls_pool_generation (&log_pool);
+	pgm_log_ring_t* ring = pgm_tls_pool_acquire (&log_pool, sizeof (pgm_log_ring_t) + size * sizeof (pgm_log_record_t));
+	ring->mask = size - 1;
+	log_ring = ring;
+	return ring;
+}
+
+/* render into the calling thread's ring, a full ring drops the message
+ * rather than wait for the log thread.
+ */
+
+static
+void
+_pgm_log_push (
+	const int		log_level,
+	const char*		format,
+	va_list			args
+	)
+{
+	pgm_log_ring_t* ring = log_ring;
+	if (PGM_UNLIKELY(NULL == ring ||
+			 log_ring_generation != pgm_tls_pool_generation (&log_pool)))
+	{
+		ring = _pgm_log_acquire ();
+	}
+
+	const uint32_t head = ring->head;
+	const uint32_t pending = head - pgm_atomic_read32 (&ring->tail);
+	if (PGM_UNLIKELY(pending > ring->mask)) {
+		pgm_atomic_write32 (&ring->dropped, ring->dropped + 1);
+		return;
+	}
+	pgm_log_record_t* record = &ring->records[ head & ring->mask ];
+	record->log_level = log_level;
+	const int offset = pgm_snprintf_s (record->message, sizeof (record->message), _TRUNCATE, "%s: ", log_level_text (log_level));
+	pgm_vsnprintf_s (record->message + offset, sizeof (record->message) - offset, _TRUNCATE, format, args);
+	log_barrier();
+	pgm_atomic_write32 (&ring->head, head + 1);
+
+/* errors and a half full ring wake the log thread before its period */
+	if (log_level >= PGM_LOG_LEVEL_ERROR || pending == (ring->mask >> 1))
+		pgm_notify_send (&log_notify);
+}
+
 PGM_GNUC_INTERNAL
 void
 pgm__log (
@@ -178,23 +522,20 @@ pgm__logv (
 {
 	char tbuf[1024];
 
+	if (log_is_async && PGM_LOG_LEVEL_FATAL != log_level) {
+		_pgm_log_push (log_level, format, args);
+		return;
+	}
+
 	pgm_mutex_lock (&messages_mutex);
+/* keep ordering with messages still queued, including pushes that raced
+ * the return to synchronous logging.
+ */
+	if (log_has_notify)
+		_pgm_log_drain ();
 	const int offset = pgm_snprintf_s (tbuf, sizeof (tbuf), _TRUNCATE, "%s: ", log_level_text (log_level));
 	pgm_vsnprintf_s (tbuf + offset, sizeof(tbuf) - offset, _TRUNCATE, format, args);
-	if (log_handler) {
-		log_handler (log_level, tbuf, log_handler_closure);
-	} else {
-#ifdef _MSC_VER
-		const int stdoutfd = _fileno (stdout);
-		_write (stdoutfd, tbuf, (unsigned)strlen (tbuf));
-		_write (stdoutfd, "\n", 1);
-#else
-/* ignore return value */
-		(void) write (STDOUT_FILENO, tbuf, strlen (tbuf));
-		(void) write (STDOUT_FILENO, "\n", 1);
-#endif
-	}
-		
+	_pgm_log_write (log_level, tbuf);
 	pgm_mutex_unlock (&messages_mutex);
 }
 
@@ -0,0 +1,272 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * unit tests for message reporting.
+ *
+ * Copyright (c) 2010-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <check.h>
+
+#ifdef _WIN32
+#	define PGM_CHECK_NOFORK		1
+#endif
+
+
+/* mock state */
+
+#define MAX_MESSAGES		32
+
+static int	mock_count = 0;
+static int	mock_levels[MAX_MESSAGES];
+static char	mock_messages[MAX_MESSAGES][128];
+
+
+/* mock functions for external references */
+
+size_t
+pgm_transport_pkt_offset2 (
+        const bool                      can_fragment,
+        const bool                      use_pgmcc
+        )
+{
+        return 0;
+}
+
+#define MESSAGES_DEBUG
+#include "messages.c"
+
+static
+void
+mock_log_handler (
+	const int		log_level,
+	const char*		message,
+	void*			closure
+	)
+{
+	if (mock_count < MAX_MESSAGES) {
+		mock_levels[mock_count] = log_level;
+		pgm_strncpy_s (mock_messages[mock_count], sizeof (mock_messages[0]), message, _TRUNCATE);
+	}
+	mock_count++;
+}
+
+/* render into the calling thread's ring regardless of mode */
+static
+void
+push (
+	const int		log_level,
+	const char*		format,
+	...
+	)
+{
+	va_list args;
+	va_start (args, format);
+	_pgm_log_push (log_level, format, args);
+	va_end (args);
+}
+
+static
+void
+mock_setup (void)
+{
+	mock_count = 0;
+	pgm_messages_init ();
+	pgm_log_set_handler (mock_log_handler, NULL);
+}
+
+static
+void
+mock_teardown (void)
+{
+	pgm_log_set_handler (NULL, NULL);
+	pgm_messages_shutdown ();
+}
+
+
+/* target:
+ *	void
+ *	pgm__log (
+ *		const int		log_level,
+ *		const char*		format,
+ *		...
+ *	)
+ */
+
+START_TEST (test_log_pass_001)
+{
+	pgm__log (PGM_LOG_LEVEL_WARNING, "sync %d", 1);
+	fail_unless (1 == mock_count, "count failed");
+	fail_unless (PGM_LOG_LEVEL_WARNING == mock_levels[0], "level failed");
+	fail_unless (0 == strcmp ("Warn: sync 1", mock_messages[0]), "message failed");
+}
+END_TEST
+
+/* fatal bypasses the ring after delivering queued messages */
+START_TEST (test_log_pass_002)
+{
+	fail_unless (TRUE == pgm_log_set_async (8), "async failed");
+	pgm__log (PGM_LOG_LEVEL_WARNING, "queued");
+	pgm__log (PGM_LOG_LEVEL_FATAL, "fatal");
+	fail_unless (2 == mock_count, "count failed");
+	fail_unless (0 == strcmp ("Warn: queued", mock_messages[0]), "order failed");
+	fail_unless (0 == strcmp ("Fatal: fatal", mock_messages[1]), "fatal failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_log_set_async (
+ *		const unsigned		records
+ *	)
+ */
+
+START_TEST (test_set_async_pass_001)
+{
+	fail_unless (TRUE == pgm_log_set_async (100), "async failed");
+	fail_unless (TRUE == log_is_async, "not async");
+	fail_unless (128 == log_ring_size, "size not rounded");
+	for (int i = 0; i < 10; i++)
+		pgm__log (PGM_LOG_LEVEL_NORMAL, "async %d", i);
+/* disabling delivers everything queued in order */
+	fail_unless (TRUE == pgm_log_set_async (0), "sync failed");
+	fail_unless (FALSE == log_is_async, "still async");
+	fail_unless (10 == mock_count, "count failed");
+	for (int i = 0; i < 10; i++) {
+		char expected[32];
+		sprintf (expected, "Info: async %d", i);
+		fail_unless (0 == strcmp (expected, mock_messages[i]), "order failed");
+	}
+}
+END_TEST
+
+/* a full ring drops without blocking and reports the loss */
+START_TEST (test_set_async_pass_002)
+{
+	fail_unless (TRUE == pgm_log_set_async (4), "async failed");
+	_pgm_log_acquire ();
+/* hold off the log thread */
+	pgm_mutex_lock (&messages_mutex);
+	for (int i = 0; i < 10; i++)
+		pgm__log (PGM_LOG_LEVEL_WARNING, "burst %d", i);
+	pgm_mutex_unlock (&messages_mutex);
+	fail_unless (TRUE == pgm_log_set_async (0), "sync failed");
+	fail_unless (5 == mock_count, "count failed");
+	fail_unless (0 == strcmp ("Warn: burst 3", mock_messages[3]), "message failed");
+	fail_unless (0 == strcmp ("Warn: 6 log messages dropped.", mock_messages[4]), "drop report failed");
+}
+END_TEST
+
+/* no change keeps the rings bound */
+START_TEST (test_set_async_pass_003)
+{
+	fail_unless (TRUE == pgm_log_set_async (100), "async failed");
+	const uint32_t generation = pgm_tls_pool_generation (&log_pool);
+	fail_unless (TRUE == pgm_log_set_async (128), "async failed");
+	fail_unless (generation == pgm_tls_pool_generation (&log_pool), "rings invalidated");
+	fail_unless (TRUE == pgm_log_set_async (0), "sync failed");
+}
+END_TEST
+
+/* a resize releases the old ring once drained */
+START_TEST (test_set_async_pass_004)
+{
+	fail_unless (TRUE == pgm_log_set_async (4), "async failed");
+	pgm__log (PGM_LOG_LEVEL_NORMAL, "small");
+	fail_unless (TRUE == pgm_log_set_async (16), "resize failed");
+	pgm__log (PGM_LOG_LEVEL_NORMAL, "large");
+	fail_unless (TRUE == pgm_log_set_async (0), "sync failed");
+	fail_unless (2 == mock_count, "count failed");
+	fail_unless (0 == strcmp ("Info: small", mock_messages[0]), "order failed");
+	fail_unless (0 == strcmp ("Info: large", mock_messages[1]), "order failed");
+	fail_unless (NULL != log_pool.slots && NULL == log_pool.slots->next, "old ring retained");
+	fail_unless (16 == ((pgm_log_ring_t*)log_pool.slots->data)->mask + 1, "ring size failed");
+}
+END_TEST
+
+/* a push racing the return to synchronous logging keeps its order */
+START_TEST (test_set_async_pass_005)
+{
+	fail_unless (TRUE == pgm_log_set_async (8), "async failed");
+	fail_unless (TRUE == pgm_log_set_async (0), "sync failed");
+	push (PGM_LOG_LEVEL_NORMAL, "late");
+	pgm__log (PGM_LOG_LEVEL_NORMAL, "sync");
+	fail_unless (2 == mock_count, "count failed");
+	fail_unless (0 == strcmp ("Info: late", mock_messages[0]), "late message lost");
+	fail_unless (0 == strcmp ("Info: sync", mock_messages[1]), "order failed");
+}
+END_TEST
+
+START_TEST (test_set_async_fail_001)
+{
+	pgm_messages_shutdown ();
+	fail_unless (FALSE == pgm_log_set_async (4), "async failed");
+	pgm_messages_init ();
+}
+END_TEST
+
+
+static
+Suite*
+make_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create (__FILE__);
+
+	TCase* tc_log = tcase_create ("log");
+	suite_add_tcase (s, tc_log);
+	tcase_add_checked_fixture (tc_log, mock_setup, mock_teardown);
+	tcase_add_test (tc_log, test_log_pass_001);
+	tcase_add_test (tc_log, test_log_pass_002);
+
+	TCase* tc_set_async = tcase_create ("set-async");
+	suite_add_tcase (s, tc_set_async);
+	tcase_add_checked_fixture (tc_set_async, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_async, test_set_async_pass_001);
+	tcase_add_test (tc_set_async, test_set_async_pass_002);
+	tcase_add_test (tc_set_async, test_set_async_pass_003);
+	tcase_add_test (tc_set_async, test_set_async_pass_004);
+	tcase_add_test (tc_set_async, test_set_async_pass_005);
+	tcase_add_test (tc_set_async, test_set_async_fail_001);
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_test_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
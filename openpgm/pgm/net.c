@@ -169,6 +169,29 @@ pgm_sendto_hops (
 		}
 	}
 
+/* hot/hot B line, multicast packets are always addressed through send_gsr and
+ * go out a second time unregulated once the A line has accepted them.  the A
+ * line result is returned.
+ */
+	if (sent >= 0 &&
+	    INVALID_SOCKET != sock->redundant_send_sock &&
+	    to == (const struct sockaddr*)&sock->send_gsr.gsr_group)
+	{
+		const struct sockaddr* redundant_to = (const struct sockaddr*)&sock->redundant_send_group;
+		if (-1 != hops)
+			pgm_sockaddr_multicast_hops (sock->redundant_send_sock, sock->redundant_send_group.ss_family, hops);
+		if (sendto (sock->redundant_send_sock, buf, (int) len, 0, redundant_to, pgm_sockaddr_len (redundant_to)) < 0)
+		{
+			char errbuf[1024];
+			const int save_errno = pgm_get_last_sock_error();
+			sock->cumulative_stats[PGM_PC_SOURCE_REDUNDANT_SEND_ERRORS]++;
+			pgm_trace (PGM_LOG_ROLE_NETWORK,_("Redundant sendto() failed: %s"),
+				pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		}
+		if (-1 != hops)
+			pgm_sockaddr_multicast_hops (sock->redundant_send_sock, sock->redundant_send_group.ss_family, sock->hops);
+	}
+
 /* revert to default value hop limit */
 	if (-1 != hops)
 		pgm_sockaddr_multicast_hops (send_sock, sock->send_gsr.gsr_group.ss_family, sock->hops);
@@ -58,6 +58,10 @@ int mock_select (int, fd_set*, fd_set*, fd_set*, struct timeval*);
 #define NET_DEBUG
 #include "net.c"
 
+static SOCKET mock_sendto_fail_sock = INVALID_SOCKET;
+static SOCKET mock_sendto_socks[4];
+static unsigned mock_sendto_calls = 0;
+
 
 static
 pgm_sock_t*
@@ -199,6 +203,13 @@ mock_sendto (
 	pgm_sockaddr_ntop (to, saddr, sizeof(saddr));
 	g_debug ("mock_sendto (s:%i buf:%p len:%u flags:%s to:%s tolen:%d)",
 		s, buf, (unsigned)len, flags_string (flags), saddr, tolen);
+	if (mock_sendto_calls < G_N_ELEMENTS(mock_sendto_socks))
+		mock_sendto_socks[mock_sendto_calls] = s;
+	mock_sendto_calls++;
+	if (s == mock_sendto_fail_sock) {
+		errno = EAGAIN;
+		return -1;
+	}
 	return len;
 }
 
@@ -286,6 +297,72 @@ START_TEST (test_sendto_pass_001)
 }
 END_TEST
 
+static
+pgm_sock_t*
+generate_redundant_sock (void)
+{
+	pgm_sock_t* sock = generate_sock ();
+	struct sockaddr_in a_group = {
+		.sin_family		= AF_INET,
+		.sin_addr.s_addr	= inet_addr ("239.192.0.1")
+	};
+	struct sockaddr_in b_group = {
+		.sin_family		= AF_INET,
+		.sin_addr.s_addr	= inet_addr ("239.192.0.2")
+	};
+	sock->send_sock = 10;
+	sock->redundant_send_sock = 11;
+	sock->hops = 16;
+	memcpy (&sock->send_gsr.gsr_group, &a_group, sizeof(a_group));
+	memcpy (&sock->redundant_send_group, &b_group, sizeof(b_group));
+	mock_sendto_fail_sock = INVALID_SOCKET;
+	mock_sendto_calls = 0;
+	return sock;
+}
+
+/* both lines carry a multicast packet */
+START_TEST (test_sendto_pass_002)
+{
+	pgm_sock_t* sock = generate_redundant_sock ();
+	const char* buf = "i am not a string";
+	const struct sockaddr* to = (struct sockaddr*)&sock->send_gsr.gsr_group;
+	gssize len = pgm_sendto (sock, FALSE, NULL, FALSE, buf, sizeof(buf), to, pgm_sockaddr_len (to));
+	fail_unless (sizeof(buf) == len, "sendto underrun");
+	fail_unless (2 == mock_sendto_calls, "sendto calls");
+	fail_unless (10 == mock_sendto_socks[0], "A line");
+	fail_unless (11 == mock_sendto_socks[1], "B line");
+	fail_unless (0 == sock->cumulative_stats[PGM_PC_SOURCE_REDUNDANT_SEND_ERRORS], "redundant send errors");
+}
+END_TEST
+
+/* B line is not sent when the A line fails */
+START_TEST (test_sendto_pass_003)
+{
+	pgm_sock_t* sock = generate_redundant_sock ();
+	const char* buf = "i am not a string";
+	const struct sockaddr* to = (struct sockaddr*)&sock->send_gsr.gsr_group;
+	mock_sendto_fail_sock = 10;
+	gssize len = pgm_sendto (sock, FALSE, NULL, FALSE, buf, sizeof(buf), to, pgm_sockaddr_len (to));
+	fail_unless (len < 0, "sendto succeeded");
+	fail_unless (1 == mock_sendto_calls, "sendto calls");
+	fail_unless (10 == mock_sendto_socks[0], "A line");
+}
+END_TEST
+
+/* B line failure is counted, A line result returned */
+START_TEST (test_sendto_pass_004)
+{
+	pgm_sock_t* sock = generate_redundant_sock ();
+	const char* buf = "i am not a string";
+	const struct sockaddr* to = (struct sockaddr*)&sock->send_gsr.gsr_group;
+	mock_sendto_fail_sock = 11;
+	gssize len = pgm_sendto (sock, FALSE, NULL, FALSE, buf, sizeof(buf), to, pgm_sockaddr_len (to));
+	fail_unless (sizeof(buf) == len, "sendto underrun");
+	fail_unless (2 == mock_sendto_calls, "sendto calls");
+	fail_unless (1 == sock->cumulative_stats[PGM_PC_SOURCE_REDUNDANT_SEND_ERRORS], "redundant send errors");
+}
+END_TEST
+
 START_TEST (test_sendto_fail_001)
 {
 	const char* buf = "i am not a string";
@@ -384,6 +461,9 @@ make_test_suite (void)
 	TCase* tc_sendto = tcase_create ("sendto");
 	suite_add_tcase (s, tc_sendto);
 	tcase_add_test (tc_sendto, test_sendto_pass_001);
+	tcase_add_test (tc_sendto, test_sendto_pass_002);
+	tcase_add_test (tc_sendto, test_sendto_pass_003);
+	tcase_add_test (tc_sendto, test_sendto_pass_004);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_sendto, test_sendto_fail_001, SIGABRT);
 	tcase_add_test_raise_signal (tc_sendto, test_sendto_fail_002, SIGABRT);
@@ -2619,12 +2619,11 @@ pgmReceiverPerformanceTable_handler (
 				}
 				break;
 	
-/* FIXED: 0 - absolutely no idea what this means */	
 			case COLUMN_PGMRECEIVERNAKSFAILEDGENEXPIRED:
 				{
-					const unsigned happy_pandas = 0;
+					const unsigned gen_expired = peer->cumulative_stats[PGM_PC_RECEIVER_NAKS_FAILED_GEN_EXPIRED];
 					snmp_set_var_typed_value (var, ASN_COUNTER, /* ASN_COUNTER32 */
-								  (const u_char*)&happy_pandas, sizeof(happy_pandas) );
+								  (const u_char*)&gen_expired, sizeof(gen_expired) );
 				}
 				break;
 		
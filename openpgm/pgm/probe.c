@@ -0,0 +1,306 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Binary trace ring of protocol events.  Each thread writes fixed size
+ * records into its own ring without locks or formatting, the rings are
+ * dumped to a file for offline analysis after an incident.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+#include <errno.h>
+#include <stdio.h>
+#include <impl/i18n.h>
+#include <impl/framework.h>
+
+
+//#define PROBE_DEBUG
+
+/* records per thread when enabled through the environment without a size */
+#define PGM_PROBE_DEFAULT_RECORDS	4096
+
+/* per-thread ring, released for reuse by another thread on exit */
+struct pgm_probe_ring_t {
+	pgm_tls_slot_t		slot;
+	uint32_t		mask;
+	volatile uint32_t	head;
+	pgm_probe_record_t	records[];
+};
+
+typedef struct pgm_probe_ring_t pgm_probe_ring_t;
+
+volatile bool				pgm_probe_is_enabled PGM_GNUC_READ_MOSTLY = FALSE;
+
+static volatile uint32_t		probe_ref_count = 0;
+static volatile uint32_t		probe_active = 0;	/* threads recording or dumping */
+static unsigned				probe_ring_size = 0;
+static pgm_tls_pool_t			probe_pool;
+
+static PGM_THREAD_LOCAL pgm_probe_ring_t*	probe_ring = NULL;
+static PGM_THREAD_LOCAL uint32_t		probe_ring_generation = 0;
+
+static const char* probe_event_names[] = {
+	"INVALID",
+	"ODATA_SEND",
+	"RDATA_SEND",
+	"NAK_SEND",
+	"NAK_RECV",
+	"NCF_SEND",
+	"NCF_RECV",
+	"RXW_STATE",
+	"PEER_NEW",
+	"PEER_EXPIRE"
+};
+
+PGM_STATIC_ASSERT(PGM_N_ELEMENTS(probe_event_names) == PGM_PROBE_MAX);
+PGM_STATIC_ASSERT(sizeof(pgm_probe_record_t) == 32);
+
+
+/* the ring may be enabled before pgm_init() through PGM_PROBE_RING, the
+ * value is the number of records per thread.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_probe_init (void)
+{
+	char* env;
+	size_t envlen;
+
+	if (pgm_atomic_exchange_and_add32 (&probe_ref_count, 1) > 0)
+		return;
+
+	pgm_tls_pool_init (&probe_pool);
+
+	const errno_t err = pgm_dupenv_s (&env, &envlen, "PGM_PROBE_RING");
+	if (0 == err && envlen > 0) {
+		const int records = atoi (env);
+		pgm_probe_ring_enable (records > 0 ? (unsigned)records : PGM_PROBE_DEFAULT_RECORDS);
+		pgm_free (env);
+	}
+}
+
+PGM_GNUC_INTERNAL
+void
+pgm_probe_shutdown (void)
+{
+	pgm_return_if_fail (pgm_atomic_read32 (&probe_ref_count) > 0);
+
+	if (pgm_atomic_exchange_and_add32 (&probe_ref_count, (uint32_t)-1) != 1)
+		return;
+
+/* wait out threads part way through a record or dump before the rings go,
+ * the locked read orders the store to pgm_probe_is_enabled before it.
+ */
+	pgm_probe_is_enabled = FALSE;
+	while (pgm_atomic_exchange_and_add32 (&probe_active, 0) > 0)
+		pgm_thread_yield ();
+	pgm_tls_pool_free (&probe_pool);
+}
+
+/* start or stop recording, the size applies to rings of threads that first
+ * record afterwards and is rounded up to a power of two.  rings are retained
+ * when stopped so they can still be dumped.
+ *
+ * returns TRUE on success, returns FALSE if the library is not initialised.
+ */
+
+bool
+pgm_probe_ring_enable (
+	const unsigned		records
+	)
+{
+	if (0 == pgm_atomic_read32 (&probe_ref_count))
+		return FALSE;
+
+	if (0 == records) {
+		pgm_probe_is_enabled = FALSE;
+		return TRUE;
+	}
+
+	unsigned size = 1;
+	while (size < records && size < (1U << 24))
+		size <<= 1;
+	pgm_mutex_lock (&probe_pool.mutex);
+	probe_ring_size = size;
+	pgm_mutex_unlock (&probe_pool.mutex);
+	pgm_probe_is_enabled = TRUE;
+	pgm_minor (_("Probe ring enabled with %u records per thread."), size);
+	return TRUE;
+}
+
+/* bind the calling thread to a free ring of the current size or a new one.
+ */
+
+static
+pgm_probe_ring_t*
+_pgm_probe_acquire (void)
+{
+	if (PGM_UNLIKELY(0 == pgm_atomic_read32 (&probe_ref_count)))
+		return NULL;
+
+	pgm_mutex_lock (&probe_pool.mutex);
+	const unsigned size = probe_ring_size;
+	pgm_mutex_unlock (&probe_pool.mutex);
+	probe_ring_generation = pgm_tls_pool_generation (&probe_pool);
+	pgm_probe_ring_t* ring = pgm_tls_pool_acquire (&probe_pool, sizeof (pgm_probe_ring_t) + size * sizeof (pgm_probe_record_t));
+	ring->mask = size - 1;
+	probe_ring = ring;
+	return ring;
+}
+
+/* append one event to the calling thread's ring, overwriting the oldest.  the
+ * timestamp is taken from the caller rather than reading the clock again.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_probe_record (
+	const int		 event,
+	const pgm_tsi_t* const	 tsi,
+	const uint32_t		 sqn,
+	const uint32_t		 arg,
+	const pgm_time_t	 now
+	)
+{
+	pgm_assert (event > 0 && event < PGM_PROBE_MAX);
+
+/* pins the rings against shutdown, which clears the flag before waiting */
+	pgm_atomic_inc32 (&probe_active);
+	if (PGM_UNLIKELY(!pgm_probe_is_enabled)) {
+		pgm_atomic_dec32 (&probe_active);
+		return;
+	}
+
+	pgm_probe_ring_t* ring = probe_ring;
+	if (PGM_UNLIKELY(NULL == ring ||
+			 probe_ring_generation != pgm_tls_pool_generation (&probe_pool)))
+	{
+		ring = _pgm_probe_acquire ();
+		if (PGM_UNLIKELY(NULL == ring)) {
+			pgm_atomic_dec32 (&probe_active);
+			return;
+		}
+	}
+
+	const uint32_t head = ring->head;
+	pgm_probe_record_t* record = &ring->records[ head & ring->mask ];
+	record->timestamp = now;
+	if (NULL != tsi)
+		memcpy (&record->tsi, tsi, sizeof (pgm_tsi_t));
+	else
+		memset (&record->tsi, 0, sizeof (pgm_tsi_t));
+	record->thread	= ring->slot.id;
+	record->event	= (uint16_t)event;
+	record->sqn	= sqn;
+	record->arg	= arg;
+	ring->head = head + 1;
+	pgm_atomic_dec32 (&probe_active);
+}
+
+/* write every ring oldest record first to a file, records written during the
+ * dump may be torn.
+ *
+ * returns TRUE on success, returns FALSE on error and sets error appropriately.
+ */
+
+bool
+pgm_probe_ring_dump (
+	const char*	 restrict path,
+	pgm_error_t**	 restrict error
+	)
+{
+	FILE* fp = NULL;
+
+	pgm_return_val_if_fail (NULL != path, FALSE);
+
+	pgm_atomic_inc32 (&probe_active);
+	if (0 == pgm_atomic_read32 (&probe_ref_count)) {
+		pgm_atomic_dec32 (&probe_active);
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     PGM_ERROR_FAILED,
+			     _("Probe ring dump requires an initialised library."));
+		return FALSE;
+	}
+	if (0 != pgm_fopen_s (&fp, path, "wb")) {
+		const int save_errno = errno;
+		pgm_atomic_dec32 (&probe_active);
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_errno (save_errno),
+			     _("Opening probe dump file %s: %s"),
+			     path,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		return FALSE;
+	}
+
+	pgm_probe_dump_t dump = {
+		.magic		= PGM_PROBE_DUMP_MAGIC,
+		.version	= PGM_PROBE_DUMP_VERSION,
+		.record_size	= sizeof (pgm_probe_record_t),
+		.count		= 0
+	};
+/* header is rewritten with the final count as rings keep advancing */
+	bool is_written = (1 == fwrite (&dump, sizeof (dump), 1, fp));
+	pgm_mutex_lock (&probe_pool.mutex);
+	for (pgm_slist_t* list = probe_pool.slots; list && is_written; list = list->next) {
+		const pgm_probe_ring_t* ring = list->data;
+		const uint32_t head = ring->head;
+		const uint32_t first = (head > ring->mask) ? head - ring->mask - 1 : 0;
+		for (uint32_t i = first; i != head && is_written; i++) {
+			is_written = (1 == fwrite (&ring->records[ i & ring->mask ], sizeof (pgm_probe_record_t), 1, fp));
+			dump.count++;
+		}
+	}
+	pgm_mutex_unlock (&probe_pool.mutex);
+	pgm_atomic_dec32 (&probe_active);
+	if (is_written)
+		is_written = (0 == fseek (fp, 0, SEEK_SET) &&
+			      1 == fwrite (&dump, sizeof (dump), 1, fp));
+
+	if (0 != fclose (fp))
+		is_written = FALSE;
+	if (!is_written) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_errno (save_errno),
+			     _("Writing probe dump file %s: %s"),
+			     path,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		return FALSE;
+	}
+	pgm_minor (_("Probe ring dumped %u records to %s."), (unsigned)dump.count, path);
+	return TRUE;
+}
+
+const char*
+pgm_probe_event_string (
+	const int		event
+	)
+{
+	if (event <= 0 || event >= PGM_PROBE_MAX)
+		return "(unknown)";
+	return probe_event_names[ event ];
+}
+
+/* eof */
@@ -0,0 +1,328 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * unit tests for the protocol event trace ring.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifndef _WIN32
+#	include <pthread.h>
+#endif
+#include <glib.h>
+#include <check.h>
+
+#ifdef _WIN32
+#	define PGM_CHECK_NOFORK		1
+#endif
+
+
+/* mock state */
+
+static char	dump_path[] = "/tmp/pgm-probe-XXXXXX";
+
+
+/* mock functions for external references */
+
+size_t
+pgm_transport_pkt_offset2 (
+        const bool                      can_fragment,
+        const bool                      use_pgmcc
+        )
+{
+        return 0;
+}
+
+#define PROBE_DEBUG
+#include "probe.c"
+
+PGM_GNUC_INTERNAL
+int
+pgm_get_nprocs (void)
+{
+	return 1;
+}
+
+static
+void
+mock_setup (void)
+{
+	fail_unless (TRUE == pgm_time_init (NULL), "time init failed");
+	pgm_probe_init ();
+}
+
+static
+void
+mock_teardown (void)
+{
+	pgm_probe_shutdown ();
+	pgm_time_shutdown ();
+}
+
+/* read back a dump file, returns number of records or -1 on error.
+ */
+
+static
+int
+read_dump (
+	const char*		path,
+	pgm_probe_record_t*	records,
+	const unsigned		max
+	)
+{
+	pgm_probe_dump_t dump;
+	FILE* fp = fopen (path, "rb");
+	if (NULL == fp)
+		return -1;
+	if (1 != fread (&dump, sizeof (dump), 1, fp) ||
+	    PGM_PROBE_DUMP_MAGIC != dump.magic ||
+	    PGM_PROBE_DUMP_VERSION != dump.version ||
+	    sizeof (pgm_probe_record_t) != dump.record_size ||
+	    dump.count > max ||
+	    dump.count != fread (records, sizeof (pgm_probe_record_t), dump.count, fp))
+	{
+		fclose (fp);
+		return -1;
+	}
+	fclose (fp);
+	return (int)dump.count;
+}
+
+
+/* target:
+ *	bool
+ *	pgm_probe_ring_enable (
+ *		const unsigned		records
+ *	)
+ */
+
+START_TEST (test_enable_pass_001)
+{
+	fail_unless (TRUE == pgm_probe_ring_enable (100), "enable failed");
+	fail_unless (TRUE == pgm_probe_is_enabled, "not enabled");
+	fail_unless (128 == probe_ring_size, "size not rounded");
+	fail_unless (TRUE == pgm_probe_ring_enable (0), "disable failed");
+	fail_unless (FALSE == pgm_probe_is_enabled, "not disabled");
+}
+END_TEST
+
+START_TEST (test_enable_fail_001)
+{
+	pgm_probe_shutdown ();
+	fail_unless (FALSE == pgm_probe_ring_enable (100), "enable failed");
+	pgm_probe_init ();
+}
+END_TEST
+
+/* target:
+ *	void
+ *	pgm_probe_record (
+ *		const int		event,
+ *		const pgm_tsi_t*	tsi,
+ *		const uint32_t		sqn,
+ *		const uint32_t		arg,
+ *		const pgm_time_t	now
+ *	)
+ */
+
+START_TEST (test_record_pass_001)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	pgm_probe_record_t records[8];
+	fail_unless (TRUE == pgm_probe_ring_enable (4), "enable failed");
+/* wraps, the oldest two records are overwritten */
+	for (uint32_t i = 0; i < 6; i++)
+		PGM_PROBE (odata_send, PGM_PROBE_ODATA_SEND, &tsi, i, 100 + i, 1000 + i);
+	fail_unless (-1 != mkstemp (dump_path), "mkstemp failed");
+	fail_unless (TRUE == pgm_probe_ring_dump (dump_path, NULL), "dump failed");
+	const int count = read_dump (dump_path, records, PGM_N_ELEMENTS(records));
+	unlink (dump_path);
+	fail_unless (4 == count, "count failed");
+	for (int i = 0; i < count; i++) {
+		fail_unless (PGM_PROBE_ODATA_SEND == records[i].event, "event failed");
+		fail_unless ((uint32_t)(i + 2) == records[i].sqn, "sequence failed");
+		fail_unless ((uint32_t)(i + 102) == records[i].arg, "arg failed");
+		fail_unless (pgm_tsi_equal (&tsi, &records[i].tsi), "tsi failed");
+		fail_unless ((uint64_t)(i + 1002) == records[i].timestamp, "timestamp failed");
+	}
+}
+END_TEST
+
+START_TEST (test_record_pass_002)
+{
+	pgm_probe_record_t records[8];
+/* nothing recorded whilst disabled */
+	PGM_PROBE (peer_new, PGM_PROBE_PEER_NEW, NULL, 0, 0, 0);
+	fail_unless (NULL == probe_pool.slots, "ring created whilst disabled");
+	fail_unless (TRUE == pgm_probe_ring_enable (8), "enable failed");
+	PGM_PROBE (peer_new, PGM_PROBE_PEER_NEW, NULL, 1, 0, 0);
+	fail_unless (TRUE == pgm_probe_ring_enable (0), "disable failed");
+	PGM_PROBE (peer_new, PGM_PROBE_PEER_NEW, NULL, 2, 0, 0);
+/* rings retained after disable */
+	fail_unless (-1 != mkstemp (dump_path), "mkstemp failed");
+	fail_unless (TRUE == pgm_probe_ring_dump (dump_path, NULL), "dump failed");
+	const int count = read_dump (dump_path, records, PGM_N_ELEMENTS(records));
+	unlink (dump_path);
+	fail_unless (1 == count, "count failed");
+	fail_unless (1 == records[0].sqn, "sequence failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_probe_ring_dump (
+ *		const char*		path,
+ *		pgm_error_t**		error
+ *	)
+ */
+
+START_TEST (test_dump_fail_001)
+{
+	pgm_error_t* err = NULL;
+	fail_unless (FALSE == pgm_probe_ring_dump ("/nonexistent/pgm-probe", &err), "dump failed");
+	fail_unless (NULL != err, "error not set");
+	pgm_error_free (err);
+}
+END_TEST
+
+START_TEST (test_dump_fail_002)
+{
+	fail_unless (FALSE == pgm_probe_ring_dump (NULL, NULL), "dump failed");
+}
+END_TEST
+
+/* target:
+ *	void
+ *	pgm_probe_shutdown (void)
+ */
+
+#ifndef _WIN32
+static
+void*
+shutdown_routine (
+	void*		arg
+	)
+{
+	volatile bool* is_complete = arg;
+	pgm_probe_shutdown ();
+	*is_complete = TRUE;
+	return NULL;
+}
+
+/* rings outlive a thread part way through a record */
+START_TEST (test_shutdown_pass_001)
+{
+	volatile bool is_complete = FALSE;
+	pthread_t thread;
+	fail_unless (TRUE == pgm_probe_ring_enable (8), "enable failed");
+	PGM_PROBE (peer_new, PGM_PROBE_PEER_NEW, NULL, 1, 0, 0);
+	pgm_atomic_inc32 (&probe_active);
+	fail_unless (0 == pthread_create (&thread, NULL, shutdown_routine, (void*)&is_complete), "pthread_create failed");
+	usleep (50 * 1000);
+	fail_unless (!is_complete, "shutdown did not wait");
+	fail_unless (NULL != probe_pool.slots, "ring freed in use");
+	pgm_atomic_dec32 (&probe_active);
+	pthread_join (thread, NULL);
+	fail_unless (is_complete, "shutdown incomplete");
+	pgm_probe_init ();
+}
+END_TEST
+#endif /* !_WIN32 */
+
+/* target:
+ *	const char*
+ *	pgm_probe_event_string (
+ *		const int		event
+ *	)
+ */
+
+START_TEST (test_event_string_pass_001)
+{
+	fail_unless (0 == strcmp ("NAK_SEND", pgm_probe_event_string (PGM_PROBE_NAK_SEND)), "string failed");
+	fail_unless (0 == strcmp ("PEER_EXPIRE", pgm_probe_event_string (PGM_PROBE_PEER_EXPIRE)), "string failed");
+	fail_unless (0 == strcmp ("(unknown)", pgm_probe_event_string (PGM_PROBE_MAX)), "string failed");
+	fail_unless (0 == strcmp ("(unknown)", pgm_probe_event_string (0)), "string failed");
+}
+END_TEST
+
+
+static
+Suite*
+make_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create (__FILE__);
+
+	TCase* tc_enable = tcase_create ("enable");
+	suite_add_tcase (s, tc_enable);
+	tcase_add_checked_fixture (tc_enable, mock_setup, mock_teardown);
+	tcase_add_test (tc_enable, test_enable_pass_001);
+	tcase_add_test (tc_enable, test_enable_fail_001);
+
+	TCase* tc_record = tcase_create ("record");
+	suite_add_tcase (s, tc_record);
+	tcase_add_checked_fixture (tc_record, mock_setup, mock_teardown);
+	tcase_add_test (tc_record, test_record_pass_001);
+	tcase_add_test (tc_record, test_record_pass_002);
+
+	TCase* tc_dump = tcase_create ("dump");
+	suite_add_tcase (s, tc_dump);
+	tcase_add_checked_fixture (tc_dump, mock_setup, mock_teardown);
+	tcase_add_test (tc_dump, test_dump_fail_001);
+	tcase_add_test (tc_dump, test_dump_fail_002);
+
+#ifndef _WIN32
+	TCase* tc_shutdown = tcase_create ("shutdown");
+	suite_add_tcase (s, tc_shutdown);
+	tcase_add_checked_fixture (tc_shutdown, mock_setup, mock_teardown);
+	tcase_add_test (tc_shutdown, test_shutdown_pass_001);
+#endif
+
+	TCase* tc_event_string = tcase_create ("event-string");
+	suite_add_tcase (s, tc_event_string);
+	tcase_add_test (tc_event_string, test_event_string_pass_001);
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	pgm_messages_init();
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_test_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	pgm_messages_shutdown();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
@@ -46,7 +46,7 @@ pgm_rate_create (
 
 	bucket->rate_per_sec	= rate_per_sec;
 	bucket->iphdr_len	= iphdr_len;
-	bucket->last_rate_check	= pgm_time_update_now ();
+	bucket->last_rate_check	= pgm_time_sample();
 /* pre-fill bucket */
 	if ((rate_per_sec / 1000) >= max_tpdu) {
 		bucket->rate_per_msec	= bucket->rate_per_sec / 1000;
@@ -98,7 +98,7 @@ pgm_rate_check2 (
 	if (0 != major_bucket->rate_per_sec)
 	{
 		pgm_spinlock_lock (&major_bucket->spinlock);
-		now = pgm_time_update_now();
+		now = pgm_time_sample();
 
 		if (major_bucket->rate_per_msec)
 		{
@@ -125,6 +125,8 @@ pgm_rate_check2 (
 
 		new_major_limit -= ( major_bucket->iphdr_len + data_size );
 		if (is_nonblocking && new_major_limit < 0) {
+			if (!minor_bucket->limited_since)
+				minor_bucket->limited_since = now;
 			pgm_spinlock_unlock (&major_bucket->spinlock);
 			return FALSE;
 		}
@@ -134,16 +136,17 @@ pgm_rate_check2 (
 			ssize_t sleep_amount;
 			do {
 				pgm_thread_yield();
-				now = pgm_time_update_now();
+				now = pgm_time_sample();
 				sleep_amount = (ssize_t)pgm_to_secs (major_bucket->rate_per_sec * (now - wait_start));
 			} while (sleep_amount + new_major_limit < 0);
 			new_major_limit += sleep_amount;
+			pgm_latency_add (PGM_LATENCY_RATE_LIMITED, now - wait_start);
 		} 
 	}
 	else
 	{
 /* ensure we have a timestamp */
-		now = pgm_time_update_now();
+		now = pgm_time_sample();
 	}
 
 	if (0 != minor_bucket->rate_per_sec)
@@ -173,6 +176,8 @@ pgm_rate_check2 (
 
 		new_minor_limit -= ( minor_bucket->iphdr_len + data_size );
 		if (is_nonblocking && new_minor_limit < 0) {
+			if (!minor_bucket->limited_since)
+				minor_bucket->limited_since = now;
 			if (0 != major_bucket->rate_per_sec)
 				pgm_spinlock_unlock (&major_bucket->spinlock);
 			return FALSE;
@@ -191,16 +196,23 @@ pgm_rate_check2 (
 
 /* sleep on minor bucket outside of lock */
 	if (minor_bucket->rate_limit < 0) {
+		const pgm_time_t wait_start = minor_bucket->last_rate_check;
 		ssize_t sleep_amount;
 		do {
 			pgm_thread_yield();
-			now = pgm_time_update_now();
+			now = pgm_time_sample();
 			sleep_amount = (ssize_t)pgm_to_secs (minor_bucket->rate_per_sec * (now - minor_bucket->last_rate_check));
 		} while (sleep_amount + minor_bucket->rate_limit < 0);
 		minor_bucket->rate_limit += sleep_amount;
 		minor_bucket->last_rate_check = now;
+		pgm_latency_add (PGM_LATENCY_RATE_LIMITED, now - wait_start);
 	} 
 
+/* a non-blocking sender was held from the first refusal until now */
+	if (minor_bucket->limited_since) {
+		pgm_latency_add (PGM_LATENCY_RATE_LIMITED, now - minor_bucket->limited_since);
+		minor_bucket->limited_since = 0;
+	}
 	return TRUE;
 }
 
@@ -222,7 +234,7 @@ pgm_rate_check (
 		return TRUE;
 
 	pgm_spinlock_lock (&bucket->spinlock);
-	pgm_time_t now = pgm_time_update_now();
+	pgm_time_t now = pgm_time_sample();
 
 	if (bucket->rate_per_msec)
 	{
@@ -249,6 +261,8 @@ pgm_rate_check (
 
 	new_rate_limit -= ( bucket->iphdr_len + data_size );
 	if (is_nonblocking && new_rate_limit < 0) {
+		if (!bucket->limited_since)
+			bucket->limited_since = now;
 		pgm_spinlock_unlock (&bucket->spinlock);
 		return FALSE;
 	}
@@ -256,15 +270,21 @@ pgm_rate_check (
 	bucket->rate_limit = new_rate_limit;
 	bucket->last_rate_check = now;
 	if (bucket->rate_limit < 0) {
+		const pgm_time_t wait_start = now;
 		ssize_t sleep_amount;
 		do {
 			pgm_thread_yield();
-			now = pgm_time_update_now();
+			now = pgm_time_sample();
 			sleep_amount = (ssize_t)pgm_to_secs (bucket->rate_per_sec * (now - bucket->last_rate_check));
 		} while (sleep_amount + bucket->rate_limit < 0);
 		bucket->rate_limit += sleep_amount;
 		bucket->last_rate_check = now;
+		pgm_latency_add (PGM_LATENCY_RATE_LIMITED, now - wait_start);
 	} 
+	if (bucket->limited_since) {
+		pgm_latency_add (PGM_LATENCY_RATE_LIMITED, now - bucket->limited_since);
+		bucket->limited_since = 0;
+	}
 	pgm_spinlock_unlock (&bucket->spinlock);
 	return TRUE;
 }
@@ -290,7 +310,7 @@ pgm_rate_remaining2 (
 	if (0 != major_bucket->rate_per_sec)
 	{
 		pgm_spinlock_lock (&major_bucket->spinlock);
-		now = pgm_time_update_now();
+		now = pgm_time_sample();
 		const int64_t bucket_bytes = major_bucket->rate_limit + pgm_to_secs (major_bucket->rate_per_sec * (now - major_bucket->last_rate_check)) - n;
 
 		if (bucket_bytes < 0) {
@@ -302,7 +322,7 @@ pgm_rate_remaining2 (
 	else
 	{
 /* ensure we have a timestamp */
-		now = pgm_time_update_now();
+		now = pgm_time_sample();
 	}
 
 	if (0 != minor_bucket->rate_per_sec)
@@ -338,7 +358,7 @@ pgm_rate_remaining (
 		return 0;
 
 	pgm_spinlock_lock (&bucket->spinlock);
-	const pgm_time_t now = pgm_time_update_now();
+	const pgm_time_t now = pgm_time_sample();
 	const pgm_time_t time_since_last_rate_check = now - bucket->last_rate_check;
 	const int64_t bucket_bytes = bucket->rate_limit + pgm_to_secs (bucket->rate_per_sec * time_since_last_rate_check) - n;
 	pgm_spinlock_unlock (&bucket->spinlock);
@@ -37,6 +37,7 @@
 
 #define pgm_time_now		mock_pgm_time_now
 #define pgm_time_update_now	mock_pgm_time_update_now
+#define pgm_tsc_us_mul		mock_pgm_tsc_us_mul
 
 #define RATE_CONTROL_DEBUG
 #include "rate_control.c"
@@ -44,6 +45,7 @@
 static pgm_time_t mock_pgm_time_now = 0x1;
 static pgm_time_t _mock_pgm_time_update_now (void);
 pgm_time_update_func mock_pgm_time_update_now = _mock_pgm_time_update_now;
+uint64_t mock_pgm_tsc_us_mul = 0;
 
 
 /* mock functions for external references */
@@ -64,6 +66,15 @@ pgm_get_nprocs (void)
 	return 1;
 }
 
+PGM_GNUC_INTERNAL
+void
+pgm_latency_add (
+	const int		metric,
+	const pgm_time_t	usecs
+	)
+{
+}
+
 static
 pgm_time_t
 _mock_pgm_time_update_now (void)
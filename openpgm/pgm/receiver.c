@@ -26,6 +26,8 @@
 #include <impl/i18n.h>
 #include <impl/framework.h>
 #include <impl/receiver.h>
+#include <impl/dlr.h>
+#include <impl/hostnak.h>
 #include <impl/sqn_list.h>
 #include <impl/timer.h>
 #include <impl/packet_parse.h>
@@ -43,10 +45,11 @@
 static bool send_spmr (pgm_sock_t*const restrict, pgm_peer_t*const restrict);
 static bool send_nak (pgm_sock_t*const restrict, pgm_peer_t*const restrict, const uint32_t);
 static bool send_parity_nak (pgm_sock_t*const restrict, pgm_peer_t*const restrict, const unsigned, const unsigned);
-static bool send_nak_list (pgm_sock_t*const restrict, pgm_peer_t*const restrict, const struct pgm_sqn_list_t*const restrict);
+static bool send_nak_list (pgm_sock_t*const restrict, pgm_peer_t*const restrict, const struct pgm_sqn_list_t*const restrict, const bool);
 static bool nak_rb_state (pgm_sock_t*restrict, pgm_peer_t*restrict, const pgm_time_t);
 static void nak_rpt_state (pgm_sock_t*restrict, pgm_peer_t*restrict, const pgm_time_t);
 static void nak_rdata_state (pgm_sock_t*restrict, pgm_peer_t*restrict, const pgm_time_t);
+static void nak_deadline_state (pgm_sock_t*restrict, pgm_peer_t*restrict, const pgm_time_t);
 static inline pgm_peer_t* _pgm_peer_ref (pgm_peer_t*);
 static bool on_general_poll (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict);
 static bool on_dlr_poll (pgm_sock_t*const restrict, pgm_peer_t*const restrict, struct pgm_sk_buff_t*const restrict);
@@ -119,6 +122,48 @@ next_nak_rdata_expiry (
 	return state->timer_expiry;
 }
 
+/* oldest placeholder at the tail of any of the repair queues.  each queue is
+ * ordered by entry to its state, a placeholder returned to back-off after a
+ * NCF timeout is only seen here once it reaches the tail, the NAK states check
+ * each placeholder with is_repair_expired() before requesting it again.
+ */
+static inline
+struct pgm_sk_buff_t*
+oldest_placeholder (
+	pgm_rxw_t*		window
+	)
+{
+	struct pgm_sk_buff_t* oldest = NULL;
+	pgm_queue_t* queues[] = {
+		&window->nak_backoff_queue,
+		&window->wait_ncf_queue,
+		&window->wait_data_queue
+	};
+
+	pgm_assert (NULL != window);
+
+	for (unsigned i = 0; i < PGM_N_ELEMENTS(queues); i++) {
+		struct pgm_sk_buff_t* skb = (struct pgm_sk_buff_t*)queues[i]->tail;
+		if (NULL != skb &&
+		    (NULL == oldest || pgm_time_after (oldest->tstamp, skb->tstamp)))
+			oldest = skb;
+	}
+	return oldest;
+}
+
+/* placeholder detected longer ago than the repair deadline.
+ */
+static inline
+bool
+is_repair_expired (
+	const pgm_sock_t*	    restrict sock,
+	const struct pgm_sk_buff_t* restrict skb,
+	const pgm_time_t		     now
+	)
+{
+	return sock->repair_deadline && !pgm_time_after (skb->tstamp + sock->repair_deadline, now);
+}
+
 /* calculate ACK_RB_IVL.
  */
 static inline
@@ -150,6 +195,20 @@ nak_rb_ivl (
 	return pgm_rand_int_range (&sock->rand_, 1 /* us */, (int32_t)sock->nak_bo_ivl);
 }
 
+/* selective NAKs go to a designated local repairer whilst one is advertised,
+ * otherwise to the source.
+ */
+static inline
+const struct sockaddr*
+nak_nla (
+	const pgm_peer_t*const	source
+	)
+{
+	return source->redirect_expiry ?
+		(const struct sockaddr*)&source->redirect_nla :
+		(const struct sockaddr*)&source->nla;
+}
+
 /* mark sequence as recovery failed.
  */
 
@@ -304,6 +363,11 @@ pgm_peer_unref (
 /* receive window */
 	pgm_rxw_destroy (peer->window);
 	peer->window = NULL;
+	if (peer->dlr) {
+		pgm_dlr_destroy (peer->dlr);
+		peer->dlr = NULL;
+	}
+	pgm_mutex_free (&peer->mutex);
 
 /* object */
 	pgm_free (peer);
@@ -401,6 +465,7 @@ pgm_new_peer (
 #endif
 
 	peer = pgm_new0 (pgm_peer_t, 1);
+	pgm_mutex_init (&peer->mutex);
 	peer->expiry = now + sock->peer_expiry;
 	memcpy (&peer->tsi, tsi, sizeof(pgm_tsi_t));
 	memcpy (&peer->group_nla, dst_addr, dst_addrlen);
@@ -416,7 +481,14 @@ pgm_new_peer (
 					sock->rxw_secs,
 					sock->rxw_max_rte,
 					sock->ack_c_p);
+	peer->window->is_unordered = sock->is_unordered;
+	peer->window->is_deferred_decode = (NULL != sock->decoder);
 	peer->spmr_expiry = now + sock->spmr_expiry;
+/* announce ourselves to the subnet with the first timer pass */
+	if (sock->dlr_sqns) {
+		peer->dlr = pgm_dlr_create (sock->dlr_sqns, sock->max_tpdu);
+		peer->dlr_expiry = now;
+	}
 
 /* add peer to hash table and linked list */
 	pgm_rwlock_writer_lock (&sock->peers_lock);
@@ -428,7 +500,10 @@ pgm_new_peer (
 	pgm_timer_lock (sock);
 	if (pgm_time_after( sock->next_poll, peer->spmr_expiry ))
 		sock->next_poll = peer->spmr_expiry;
+	if (peer->dlr_expiry && pgm_time_after( sock->next_poll, peer->dlr_expiry ))
+		sock->next_poll = peer->dlr_expiry;
 	pgm_timer_unlock (sock);
+	PGM_PROBE (peer_new, PGM_PROBE_PEER_NEW, &peer->tsi, 0, 0, now);
 	return peer;
 }
 
@@ -461,19 +536,32 @@ pgm_flush_peers_pending (
 	pgm_debug ("pgm_flush_peers_pending (sock:%p pmsg:%p msg-end:%p bytes-read:%p data-read:%p)",
 		(const void*)sock, (const void*)pmsg, (const void*)msg_end, (const void*)bytes_read, (const void*)data_read);
 
+	const pgm_time_t now = pgm_time_sample();
+
 	while (sock->peers_pending)
 	{
 		pgm_peer_t* peer = sock->peers_pending->data;
+		const struct pgm_msgv_t* msgv = *pmsg;
+		pgm_mutex_lock (&peer->mutex);
 		if (peer->last_commit && peer->last_commit < sock->last_commit)
 			pgm_rxw_remove_commit (peer->window);
 		const ssize_t peer_bytes = pgm_rxw_readv (peer->window, pmsg, (unsigned)(msg_end - *pmsg + 1));
+		for (; msgv < *pmsg; msgv++)
+			pgm_latency_add (PGM_LATENCY_DELIVERY, now - msgv->msgv_skb[0]->tstamp);
 
-		if (peer->last_cumulative_losses != ((pgm_rxw_t*)peer->window)->cumulative_losses)
+/* transmission groups awaiting parity recovery */
+		if (peer->window->decode_list)
+			pgm_decoder_push (sock->decoder, peer);
+
+		if (PGM_UNLIKELY(peer->window->loss_len))
+			sock->has_pending_loss = TRUE;
+		if (pgm_peer_has_new_loss (peer))
 		{
 			sock->is_reset = TRUE;
 			peer->lost_count = ((pgm_rxw_t*)peer->window)->cumulative_losses - peer->last_cumulative_losses;
 			peer->last_cumulative_losses = ((pgm_rxw_t*)peer->window)->cumulative_losses;
 		}
+		pgm_mutex_unlock (&peer->mutex);
 
 		if (peer_bytes >= 0)
 		{
@@ -484,7 +572,10 @@ pgm_flush_peers_pending (
 				retval = -PGM_SOCK_ENOBUFS;
 				break;
 			}
-		} else
+		} else if (peer->window->committed_count)
+/* release buffers committed earlier in this call or by unordered delivery on next call */
+			peer->last_commit = sock->last_commit;
+		else
 			peer->last_commit = 0;
 		if (PGM_UNLIKELY(sock->is_reset)) {
 			retval = -PGM_SOCK_ECONNRESET;
@@ -562,6 +653,47 @@ pgm_set_reset_error (
 	msgv->msgv_len		= 1;
 }
 
+/* Create a notice skb for each range of sequences lost by unordered delivery,
+ * the first lost sequence in skb::sequence and the count as a uint32_t payload
+ * in host order.
+ *
+ * returns count of msgv entries filled.
+ */
+
+PGM_GNUC_INTERNAL
+size_t
+pgm_set_loss_notices (
+	pgm_sock_t*	   const restrict sock,
+	pgm_peer_t*	   const restrict source,
+	struct pgm_msgv_t* const restrict msgv,
+	const size_t			  msg_len
+	)
+{
+	uint32_t first, count;
+	size_t msgs = 0;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (NULL != source);
+	pgm_assert (NULL != msgv);
+
+	while (msgs < msg_len &&
+	       pgm_rxw_read_loss (source->window, &first, &count))
+	{
+		struct pgm_sk_buff_t* notice_skb = pgm_alloc_skb (sizeof (uint32_t));
+		notice_skb->sock	= sock;
+		notice_skb->tstamp	= pgm_time_update_now ();
+		memcpy (&notice_skb->tsi, &source->tsi, sizeof(pgm_tsi_t));
+		notice_skb->sequence	= first;
+		memcpy (pgm_skb_put (notice_skb, sizeof (uint32_t)), &count, sizeof (uint32_t));
+		msgv[ msgs ].msgv_skb[0] = notice_skb;
+		msgv[ msgs ].msgv_len	 = 1;
+		msgs++;
+		pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Lost %" PRIu32 " sequences from #%" PRIu32 " by unordered delivery."), count, first);
+	}
+	return msgs;
+}
+
 /* SPM indicate start of a session, continued presence of a session, or flushing final packets
  * of a session.
  *
@@ -621,7 +753,7 @@ pgm_on_spm (
 		}
 
 /* mark receiver window for flushing on next recv() */
-		if (source->window->cumulative_losses != source->last_cumulative_losses &&
+		if (pgm_peer_has_new_loss (source) &&
 		    !source->pending_link.data)
 		{
 			sock->is_reset = TRUE;
@@ -821,7 +953,7 @@ pgm_on_peer_nak (
 	}
 
 /* mark receiver window for flushing on next recv() */
-	if (peer->window->cumulative_losses != peer->last_cumulative_losses &&
+	if (pgm_peer_has_new_loss (peer) &&
 	    !peer->pending_link.data)
 	{
 		sock->is_reset = TRUE;
@@ -915,6 +1047,7 @@ pgm_on_ncf (
 	}
 
 /* check NCF list */
+	unsigned ncf_count = 1;
 	if (skb->pgm_header->pgm_options & PGM_OPT_PRESENT)
 	{
 		const struct pgm_opt_header* opt_header;
@@ -950,6 +1083,7 @@ pgm_on_ncf (
 		} while (!(opt_header->opt_type & PGM_OPT_END));
 
 		pgm_debug ("NCF contains 1+%d sequence numbers.", ncf_list_len);
+		ncf_count += ncf_list_len;
 		while (ncf_list_len)
 		{
 			ncf_status = pgm_rxw_confirm (source->window,
@@ -963,9 +1097,11 @@ pgm_on_ncf (
 			ncf_list_len--;
 		}
 	}
+	PGM_PROBE (ncf_recv, PGM_PROBE_NCF_RECV, &source->tsi, pgm_ntohl (ncf->nak_sqn),
+		   ncf_count | ((skb->pgm_header->pgm_options & PGM_OPT_PARITY) ? PGM_PROBE_PARITY : 0), skb->tstamp);
 
 /* mark receiver window for flushing on next recv() */
-	if (source->window->cumulative_losses != source->last_cumulative_losses &&
+	if (pgm_peer_has_new_loss (source) &&
 	    !source->pending_link.data)
 	{
 		sock->is_reset = TRUE;
@@ -1106,11 +1242,12 @@ send_nak (
 			   TRUE,			/* with router alert */
 			   header,
 			   tpdu_length,
-			   (struct sockaddr*)&source->nla,
-			   pgm_sockaddr_len((struct sockaddr*)&source->nla));
+			   nak_nla (source),
+			   pgm_sockaddr_len (nak_nla (source)));
 	if (sent < 0 && PGM_LIKELY(PGM_SOCK_EAGAIN == pgm_get_last_sock_error()))
 		return FALSE;
 
+	PGM_PROBE (nak_send, PGM_PROBE_NAK_SEND, &source->tsi, sequence, 1, pgm_time_sample());
 	source->cumulative_stats[PGM_PC_RECEIVER_SELECTIVE_NAK_PACKETS_SENT]++;
 	source->cumulative_stats[PGM_PC_RECEIVER_SELECTIVE_NAKS_SENT]++;
 	return TRUE;
@@ -1186,12 +1323,14 @@ send_parity_nak (
 	if (sent < 0 && PGM_LIKELY(PGM_SOCK_EAGAIN == pgm_get_last_sock_error()))
 		return FALSE;
 
+	PGM_PROBE (nak_send, PGM_PROBE_NAK_SEND, &source->tsi, nak_tg_sqn, nak_pkt_cnt | PGM_PROBE_PARITY, pgm_time_sample());
 	source->cumulative_stats[PGM_PC_RECEIVER_PARITY_NAK_PACKETS_SENT]++;
 	source->cumulative_stats[PGM_PC_RECEIVER_PARITY_NAKS_SENT]++;
 	return TRUE;
 }
 
-/* A NAK packet with a OPT_NAK_LIST option extension
+/* A NAK packet with a OPT_NAK_LIST option extension, a parity NAK list carries
+ * one transmission group and packet count per entry.
  *
  * on success, TRUE is returned.  on error, FALSE is returned.
  */
@@ -1201,7 +1340,8 @@ bool
 send_nak_list (
 	pgm_sock_t*	     	     const restrict sock,
 	pgm_peer_t*		     const restrict source,
-	const struct pgm_sqn_list_t* const restrict sqn_list
+	const struct pgm_sqn_list_t* const restrict sqn_list,
+	const bool				    is_parity	/* send parity NAK */
 	)
 {
 	size_t			 tpdu_length;
@@ -1229,8 +1369,9 @@ send_nak_list (
 		sprintf (sequence, " %" PRIu32, sqn_list->sqn[i]);
 		strcat (list, sequence);
 	}
-	pgm_debug("send_nak_list (sock:%p source:%p sqn-list:[%s])",
-		(const void*)sock, (const void*)source, list);
+	pgm_debug("send_nak_list (sock:%p source:%p sqn-list:[%s] is-parity:%s)",
+		(const void*)sock, (const void*)source, list,
+		is_parity ? "TRUE" : "FALSE");
 #endif
 
 	tpdu_length = sizeof(struct pgm_header) +
@@ -1253,7 +1394,7 @@ send_nak_list (
 	header->pgm_sport	= sock->dport;
 	header->pgm_dport	= source->tsi.sport;
 	header->pgm_type        = PGM_NAK;
-        header->pgm_options     = PGM_OPT_PRESENT | PGM_OPT_NETWORK;
+        header->pgm_options     = is_parity ? (PGM_OPT_PRESENT | PGM_OPT_NETWORK | PGM_OPT_PARITY) : (PGM_OPT_PRESENT | PGM_OPT_NETWORK);
         header->pgm_tsdu_length = 0;
 
 /* NAK */
@@ -1290,17 +1431,26 @@ send_nak_list (
         header->pgm_checksum    = 0;
         header->pgm_checksum	= pgm_csum_fold (pgm_csum_partial (buf, (uint16_t)tpdu_length, 0));
 
+/* parity is only generated by the source itself */
+	const struct sockaddr* nak_dst = is_parity ? (const struct sockaddr*)&source->nla : nak_nla (source);
 	sent = pgm_sendto (sock,
 			   FALSE,			/* not rate limited */
 			   NULL,
 			   FALSE,			/* regular socket */
 			   header,
 			   tpdu_length,
-			   (struct sockaddr*)&source->nla,
-			   pgm_sockaddr_len((struct sockaddr*)&source->nla));
+			   nak_dst,
+			   pgm_sockaddr_len (nak_dst));
 	if (sent < 0 && PGM_LIKELY(PGM_SOCK_EAGAIN == pgm_get_last_sock_error()))
 		return FALSE;
 
+	if (is_parity) {
+		PGM_PROBE (nak_send, PGM_PROBE_NAK_SEND, &source->tsi, sqn_list->sqn[0], sqn_list->len | PGM_PROBE_PARITY, pgm_time_sample());
+		source->cumulative_stats[PGM_PC_RECEIVER_PARITY_NAK_PACKETS_SENT]++;
+		source->cumulative_stats[PGM_PC_RECEIVER_PARITY_NAKS_SENT] += sqn_list->len;
+		return TRUE;
+	}
+	PGM_PROBE (nak_send, PGM_PROBE_NAK_SEND, &source->tsi, sqn_list->sqn[0], sqn_list->len, pgm_time_sample());
 	source->cumulative_stats[PGM_PC_RECEIVER_SELECTIVE_NAK_PACKETS_SENT]++;
 	source->cumulative_stats[PGM_PC_RECEIVER_SELECTIVE_NAKS_SENT] += 1 + sqn_list->len;
 	return TRUE;
@@ -1507,6 +1657,7 @@ nak_rb_state (
 {
 	pgm_queue_t*		nak_backoff_queue;
 	unsigned		dropped_invalid = 0;
+	unsigned		dropped_expired = 0;
 
 /* pre-conditions */
 	pgm_assert (NULL != sock);
@@ -1545,8 +1696,11 @@ nak_rb_state (
 /* NAKs only generated previous to current transmission group */
 		const uint32_t current_tg_sqn = peer->window->lead & tg_sqn_mask;
 
-		uint32_t nak_tg_sqn = 0;
-		uint32_t nak_pkt_cnt = 0;
+/* each entry is a transmission group with the count of its losses, less one, in
+ * the packet sequence bits.  a burst loss across many groups is packed 63 groups
+ * to a NAK list.
+ */
+		struct pgm_sqn_list_t parity_list = { .len = 0 };
 
 /* parity NAK generation */
 
@@ -1570,35 +1724,50 @@ nak_rb_state (
 					continue;
 				}
 
-/* TODO: parity nak lists */
+/* returned to back-off out of order, the queue tail says nothing of its age */
+				if (PGM_UNLIKELY(is_repair_expired (sock, skb, now))) {
+					dropped_expired++;
+					cancel_skb (sock, peer, skb, now);
+					peer->cumulative_stats[PGM_PC_RECEIVER_NAKS_FAILED_GEN_EXPIRED]++;
+					continue;
+				}
+
 				const uint32_t tg_sqn = skb->sequence & tg_sqn_mask;
-				if (	(  nak_pkt_cnt && tg_sqn == nak_tg_sqn ) ||
-					( !nak_pkt_cnt && tg_sqn != current_tg_sqn )	)
-				{
-					pgm_rxw_state (peer->window, skb, PGM_PKT_STATE_WAIT_NCF);
+				if (tg_sqn == current_tg_sqn)
+					break;
 
-					if (!nak_pkt_cnt++)
-						nak_tg_sqn = tg_sqn;
-					state->nak_transmit_count++;
+				pgm_rxw_state (peer->window, skb, PGM_PKT_STATE_WAIT_NCF);
+
+/* retries re-enter the queue out of order, merge with an earlier entry of the group */
+				unsigned i = parity_list.len;
+				while (i && (parity_list.sqn[i - 1] & tg_sqn_mask) != tg_sqn)
+					i--;
+				if (i)
+					parity_list.sqn[i - 1]++;
+				else {
+					if (parity_list.len == PGM_N_ELEMENTS(parity_list.sqn)) {
+						if (!send_nak_list (sock, peer, &parity_list, TRUE))
+							return FALSE;
+						parity_list.len = 0;
+					}
+					parity_list.sqn[parity_list.len++] = tg_sqn;
+				}
+				if (!state->nak_transmit_count++)
+					state->nak_tstamp = now;
 
 #ifdef PGM_ABSOLUTE_EXPIRY
+				state->timer_expiry += sock->nak_rpt_ivl;
+				while (pgm_time_after_eq (now, state->timer_expiry)) {
 					state->timer_expiry += sock->nak_rpt_ivl;
-					while (pgm_time_after_eq (now, state->timer_expiry)) {
-						state->timer_expiry += sock->nak_rpt_ivl;
-						state->ncf_retry_count++;
-					}
+					state->ncf_retry_count++;
+				}
 #else
-					state->timer_expiry = now + sock->nak_rpt_ivl;
+				state->timer_expiry = now + sock->nak_rpt_ivl;
 #endif
-					pgm_timer_lock (sock);
-					if (pgm_time_after (sock->next_poll, state->timer_expiry))
-						sock->next_poll = state->timer_expiry;
-					pgm_timer_unlock (sock);
-				}
-				else
-				{	/* different transmission group */
-					break;
-				}
+				pgm_timer_lock (sock);
+				if (pgm_time_after (sock->next_poll, state->timer_expiry))
+					sock->next_poll = state->timer_expiry;
+				pgm_timer_unlock (sock);
 			}
 			else
 			{	/* packet expires some time later */
@@ -1606,13 +1775,25 @@ nak_rb_state (
 			}
 		}
 
-		if (nak_pkt_cnt && !send_parity_nak (sock, peer, nak_tg_sqn, nak_pkt_cnt))
+		if (parity_list.len > 1) {
+			if (!send_nak_list (sock, peer, &parity_list, TRUE))
+				return FALSE;
+		} else if (parity_list.len &&
+			   !send_parity_nak (sock, peer, parity_list.sqn[0] & tg_sqn_mask, 1 + (parity_list.sqn[0] & ~tg_sqn_mask)))
 			return FALSE;
 	}
 	else
 	{
 		struct pgm_sqn_list_t nak_list = { .len = 0 };
 
+/* proactive parity follows the final packet of each transmission group and will
+ * usually repair losses in the current group without any NAK, hold those back for
+ * one further back-off interval.
+ */
+		const bool has_pending_parity = peer->has_proactive_parity && peer->window->tg_size > 1;
+		const uint32_t tg_sqn_mask = 0xffffffff << peer->window->tg_sqn_shift;
+		const uint32_t current_tg_sqn = peer->window->lead & tg_sqn_mask;
+
 /* select NAK generation */
 
 		for (pgm_list_t *it = nak_backoff_queue->tail, *prev = it->prev;
@@ -1635,9 +1816,50 @@ nak_rb_state (
 					continue;
 				}
 
+/* returned to back-off out of order, the queue tail says nothing of its age */
+				if (PGM_UNLIKELY(is_repair_expired (sock, skb, now))) {
+					dropped_expired++;
+					cancel_skb (sock, peer, skb, now);
+					peer->cumulative_stats[PGM_PC_RECEIVER_NAKS_FAILED_GEN_EXPIRED]++;
+					continue;
+				}
+
+				if (has_pending_parity &&
+				    (skb->sequence & tg_sqn_mask) == current_tg_sqn &&
+				    pgm_time_after (skb->tstamp + 2 * sock->nak_bo_ivl, now))
+				{
+					state->timer_expiry = skb->tstamp + 2 * sock->nak_bo_ivl;
+					pgm_timer_lock (sock);
+					if (pgm_time_after (sock->next_poll, state->timer_expiry))
+						sock->next_poll = state->timer_expiry;
+					pgm_timer_unlock (sock);
+					continue;
+				}
+
+/* hot/hot feed, the other line may still deliver a copy */
+				if ((sock->use_redundant_tsi || sock->use_redundant_group) &&
+				    0 == state->nak_transmit_count &&
+				    pgm_time_after (skb->tstamp + sock->nak_rpt_ivl, now) &&
+				    pgm_rxw_is_line_pending (peer->window, skb->sequence, now - sock->nak_bo_ivl))
+				{
+					state->timer_expiry = now + sock->nak_bo_ivl;
+					peer->cumulative_stats[PGM_PC_RECEIVER_REDUNDANT_NAKS_DEFERRED]++;
+					pgm_timer_lock (sock);
+					if (pgm_time_after (sock->next_poll, state->timer_expiry))
+						sock->next_poll = state->timer_expiry;
+					pgm_timer_unlock (sock);
+					continue;
+				}
+
 				pgm_rxw_state (peer->window, skb, PGM_PKT_STATE_WAIT_NCF);
-				nak_list.sqn[nak_list.len++] = skb->sequence;
-				state->nak_transmit_count++;
+/* a receiver elsewhere on the host sent this round, wait on the NCF it provokes */
+				if (sock->can_send_nak && NULL != sock->hostnak &&
+				    !pgm_hostnak_claim (sock->hostnak, &peer->tsi, skb->sequence, state->nak_transmit_count))
+					peer->cumulative_stats[PGM_PC_RECEIVER_SELECTIVE_NAKS_SUPPRESSED]++;
+				else
+					nak_list.sqn[nak_list.len++] = skb->sequence;
+				if (!state->nak_transmit_count++)
+					state->nak_tstamp = now;
 
 /* we have two options here, calculate the expiry time in the new state relative to the current
  * state execution time, skipping missed expirations due to delay in state processing, or base
@@ -1660,7 +1882,7 @@ pgm_trace(PGM_LOG_ROLE_NETWORK,_("nak_rpt_expiry in %f seconds."),
 				pgm_timer_unlock (sock);
 
 				if (nak_list.len == PGM_N_ELEMENTS(nak_list.sqn)) {
-					if (sock->can_send_nak && !send_nak_list (sock, peer, &nak_list))
+					if (sock->can_send_nak && !send_nak_list (sock, peer, &nak_list, FALSE))
 						return FALSE;
 					nak_list.len = 0;
 				}
@@ -1673,20 +1895,26 @@ pgm_trace(PGM_LOG_ROLE_NETWORK,_("nak_rpt_expiry in %f seconds."),
 
 		if (sock->can_send_nak && nak_list.len)
 		{
-			if (nak_list.len > 1 && !send_nak_list (sock, peer, &nak_list))
-				return FALSE;
-			else if (!send_nak (sock, peer, nak_list.sqn[0]))
+			if (nak_list.len > 1) {
+				if (!send_nak_list (sock, peer, &nak_list, FALSE))
+					return FALSE;
+			} else if (!send_nak (sock, peer, nak_list.sqn[0]))
 				return FALSE;
 		}
 
 	}
 
-	if (PGM_UNLIKELY(dropped_invalid))
+	if (PGM_UNLIKELY(dropped_expired)) {
+		pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Dropped %u messages due to repair deadline."), dropped_expired);
+	}
+
+	if (PGM_UNLIKELY(dropped_invalid || dropped_expired))
 	{
-		pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Dropped %u messages due to invalid NLA."), dropped_invalid);
+		if (dropped_invalid)
+			pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Dropped %u messages due to invalid NLA."), dropped_invalid);
 
 /* mark receiver window for flushing on next recv() */
-		if (peer->window->cumulative_losses != peer->last_cumulative_losses &&
+		if (pgm_peer_has_new_loss (peer) &&
 		    !peer->pending_link.data)
 		{
 			sock->is_reset = TRUE;
@@ -1749,12 +1977,14 @@ pgm_check_peer_state (
 
 		next = it->next;
 
+		pgm_mutex_lock (&peer->mutex);
 		if (peer->spmr_expiry)
 		{
 			if (pgm_time_after_eq (now, peer->spmr_expiry))
 			{
 				if (sock->can_send_nak) {
 					if (!send_spmr (sock, peer)) {
+						pgm_mutex_unlock (&peer->mutex);
 						return FALSE;
 					}
 					peer->spmr_tstamp = now;
@@ -1763,20 +1993,45 @@ pgm_check_peer_state (
 			}
 		}
 
+/* advertise as repairer to receivers of the subnet with a TTL 1 redirecting POLR */
+		if (peer->dlr_expiry &&
+		    pgm_time_after_eq (now, peer->dlr_expiry))
+		{
+			for (unsigned i = 0; i < sock->recv_gsr_len; i++)
+				if (!pgm_dlr_send_polr (sock, peer, (struct sockaddr*)&sock->recv_gsr[i].gsr_group, 1)) {
+					pgm_mutex_unlock (&peer->mutex);
+					return FALSE;
+				}
+			peer->dlr_expiry = now + PGM_DLR_ANNOUNCE_IVL;
+		}
+
+		if (peer->redirect_expiry &&
+		    pgm_time_after_eq (now, peer->redirect_expiry))
+		{
+			pgm_trace (PGM_LOG_ROLE_SESSION,_("Designated local repairer lost, NAKs return to source, tsi %s"), pgm_tsi_print (&peer->tsi));
+			peer->redirect_expiry = 0;
+		}
+
 		if (peer->window->ack_backoff_queue.tail)
 		{
 			pgm_assert (sock->use_pgmcc);
 
 			if (pgm_time_after_eq (now, next_ack_rb_expiry (peer->window)))
 				if (!ack_rb_state (sock, peer, now)) {
+					pgm_mutex_unlock (&peer->mutex);
 					return FALSE;
 				}
 		}
 
+/* cancel stale repairs before any are NAKed */
+		if (sock->repair_deadline && NULL != oldest_placeholder (peer->window))
+			nak_deadline_state (sock, peer, now);
+
 		if (peer->window->nak_backoff_queue.tail)
 		{
 			if (pgm_time_after_eq (now, next_nak_rb_expiry (peer->window)))
 				if (!nak_rb_state (sock, peer, now)) {
+					pgm_mutex_unlock (&peer->mutex);
 					return FALSE;
 				}
 		}
@@ -1809,13 +2064,19 @@ pgm_check_peer_state (
 			else
 			{
 				pgm_trace (PGM_LOG_ROLE_SESSION,_("Peer expired, tsi %s"), pgm_tsi_print (&peer->tsi));
+				PGM_PROBE (peer_expire, PGM_PROBE_PEER_EXPIRE, &peer->tsi, peer->window->lead, peer->window->cumulative_losses, now);
+				pgm_mutex_unlock (&peer->mutex);
+				pgm_rwlock_writer_lock (&sock->peers_lock);
 				pgm_hashtable_remove (sock->peers_hashtable, &peer->tsi);
 				sock->peers_list = pgm_list_remove_link (sock->peers_list, &peer->peers_link);
+				pgm_rwlock_writer_unlock (&sock->peers_lock);
 				if (sock->last_hash_value == peer)
 					sock->last_hash_value = NULL;
 				pgm_peer_unref (peer);
+				continue;
 			}
 		}
+		pgm_mutex_unlock (&peer->mutex);
 
 	}
 
@@ -1859,12 +2120,19 @@ pgm_min_receiver_expiry (
 
 		next = it->next;
 
+		pgm_mutex_lock (&peer->mutex);
 		if (peer->spmr_expiry)
 		{
 			if (pgm_time_after_eq (expiration, peer->spmr_expiry))
 				expiration = peer->spmr_expiry;
 		}
 
+		if (peer->dlr_expiry)
+		{
+			if (pgm_time_after_eq (expiration, peer->dlr_expiry))
+				expiration = peer->dlr_expiry;
+		}
+
 		if (peer->window->ack_backoff_queue.tail)
 		{
 			pgm_assert (sock->use_pgmcc);
@@ -1890,6 +2158,14 @@ pgm_min_receiver_expiry (
 				expiration = next_nak_rdata_expiry (peer->window);
 		}
 
+		if (sock->repair_deadline)
+		{
+			const struct pgm_sk_buff_t* skb = oldest_placeholder (peer->window);
+			if (NULL != skb &&
+			    pgm_time_after_eq (expiration, skb->tstamp + sock->repair_deadline))
+				expiration = skb->tstamp + sock->repair_deadline;
+		}
+		pgm_mutex_unlock (&peer->mutex);
 	}
 
 	return expiration;
@@ -1909,6 +2185,7 @@ nak_rpt_state (
 {
 	pgm_queue_t*	wait_ncf_queue;
 	unsigned	dropped_invalid = 0;
+	unsigned	dropped_expired = 0;
 	unsigned	dropped = 0;
 
 /* pre-conditions */
@@ -1945,6 +2222,14 @@ nak_rpt_state (
 				continue;
 			}
 
+/* past the repair deadline, cancel in place of another back-off round */
+			if (PGM_UNLIKELY(is_repair_expired (sock, skb, now))) {
+				dropped_expired++;
+				cancel_skb (sock, peer, skb, now);
+				peer->cumulative_stats[PGM_PC_RECEIVER_NAKS_FAILED_GEN_EXPIRED]++;
+				continue;
+			}
+
 			if (++state->ncf_retry_count >= sock->nak_ncf_retries)
 			{
 				dropped++;
@@ -1984,6 +2269,10 @@ nak_rpt_state (
 		pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Dropped %u messages due to invalid NLA."), dropped_invalid);
 	}
 
+	if (PGM_UNLIKELY(dropped_expired)) {
+		pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Dropped %u messages due to repair deadline."), dropped_expired);
+	}
+
 	if (PGM_UNLIKELY(dropped)) {
 		pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Dropped %u messages due to ncf cancellation, "
 				"rxw_sqns %" PRIu32
@@ -2002,7 +2291,7 @@ nak_rpt_state (
 	}
 
 /* mark receiver window for flushing on next recv() */
-	if (PGM_UNLIKELY(peer->window->cumulative_losses != peer->last_cumulative_losses &&
+	if (PGM_UNLIKELY(pgm_peer_has_new_loss (peer) &&
 	    !peer->pending_link.data))
 	{
 		sock->is_reset = TRUE;
@@ -2120,7 +2409,7 @@ nak_rdata_state (
 	}
 
 /* mark receiver window for flushing on next recv() */
-	if (PGM_UNLIKELY(peer->window->cumulative_losses != peer->last_cumulative_losses &&
+	if (PGM_UNLIKELY(pgm_peer_has_new_loss (peer) &&
 	    !peer->pending_link.data))
 	{
 		sock->is_reset = TRUE;
@@ -2137,10 +2426,62 @@ nak_rdata_state (
 	}
 }
 
+/* cancel outstanding repairs detected longer ago than the repair deadline,
+ * the sequence is marked lost in place of any further NAK or retry.
+ */
+
+static
+void
+nak_deadline_state (
+	pgm_sock_t*restrict	sock,
+	pgm_peer_t*restrict	peer,
+	const pgm_time_t	now
+	)
+{
+	struct pgm_sk_buff_t*	skb;
+	unsigned		dropped = 0;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (NULL != peer);
+	pgm_assert (NULL != peer->window);
+	pgm_assert (sock->repair_deadline > 0);
+
+	pgm_debug ("nak_deadline_state (sock:%p peer:%p now:%" PGM_TIME_FORMAT ")",
+		(void*)sock, (void*)peer, now);
+
+	while (NULL != (skb = oldest_placeholder (peer->window)))
+	{
+/* remaining queue tails are younger */
+		if (pgm_time_after (skb->tstamp + sock->repair_deadline, now))
+			break;
+
+		dropped++;
+		cancel_skb (sock, peer, skb, now);
+		peer->cumulative_stats[PGM_PC_RECEIVER_NAKS_FAILED_GEN_EXPIRED]++;
+	}
+
+	if (PGM_UNLIKELY(dropped)) {
+		pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Dropped %u messages due to repair deadline."), dropped);
+	}
+
+/* mark receiver window for flushing on next recv() */
+	if (PGM_UNLIKELY(pgm_peer_has_new_loss (peer) &&
+	    !peer->pending_link.data))
+	{
+		sock->is_reset = TRUE;
+		peer->lost_count = peer->window->cumulative_losses - peer->last_cumulative_losses;
+		peer->last_cumulative_losses = peer->window->cumulative_losses;
+		pgm_peer_set_pending (sock, peer);
+	}
+}
+
 /* ODATA or RDATA packet with any of the following options:
  *
  * OPT_FRAGMENT - this TPDU part of a larger APDU.
  *
+ * is_redundant_line marks a copy that arrived on the B line of a hot/hot feed.
+ *
  * Ownership of skb is taken and must be passed to the receive window or destroyed.
  *
  * returns TRUE is skb has been replaced, FALSE is remains unchanged and can be recycled.
@@ -2151,7 +2492,8 @@ bool
 pgm_on_data (
 	pgm_sock_t*	      const restrict sock,
 	pgm_peer_t*	      const restrict source,
-	struct pgm_sk_buff_t* const restrict skb
+	struct pgm_sk_buff_t* const restrict skb,
+	const bool			     is_redundant_line
 	)
 {
 	unsigned	msg_count = 0;
@@ -2163,8 +2505,8 @@ pgm_on_data (
 	pgm_assert (NULL != source);
 	pgm_assert (NULL != skb);
 
-	pgm_debug ("pgm_on_data (sock:%p source:%p skb:%p)",
-		(void*)sock, (void*)source, (void*)skb);
+	pgm_debug ("pgm_on_data (sock:%p source:%p skb:%p is-redundant-line:%s)",
+		(void*)sock, (void*)source, (void*)skb, is_redundant_line ? "TRUE" : "FALSE");
 
 	const pgm_time_t nak_rb_expiry = skb->tstamp + nak_rb_ivl (sock);
 	const uint_fast16_t tsdu_length = pgm_ntohs (skb->pgm_header->pgm_tsdu_length);
@@ -2187,6 +2529,18 @@ pgm_on_data (
 		ack_rb_expiry = skb->tstamp + ack_rb_ivl (sock);
 	}
 
+/* copy for local repair whilst the skb is still ours */
+	if (NULL != source->dlr)
+		pgm_dlr_add (source->dlr, skb);
+
+/* hot/hot feed, note which line this copy arrived on */
+	if (PGM_ODATA == skb->pgm_header->pgm_type &&
+	    (sock->use_redundant_group ||
+	     (sock->use_redundant_tsi && pgm_tsi_equal (&source->tsi, &sock->redundant_tsi[0]))))
+	{
+		pgm_rxw_update_line (source->window, is_redundant_line ? 1 : 0, pgm_ntohl (skb->pgm_data->data_sqn), skb->tstamp);
+	}
+
 	const int add_status = pgm_rxw_add (source->window, skb, skb->tstamp, nak_rb_expiry);
 
 /* skb reference is now invalid */
@@ -2197,6 +2551,8 @@ pgm_on_data (
 	case PGM_RXW_INSERTED:
 	case PGM_RXW_APPENDED:
 		msg_count++;
+		if (is_redundant_line)
+			source->cumulative_stats[PGM_PC_RECEIVER_REDUNDANT_DATAS]++;
 		break;
 
 	case PGM_RXW_DUPLICATE:
@@ -2374,17 +2730,125 @@ on_general_poll (
 	return TRUE;
 }
 
-/* Used to count off-tree DLRs */
+/* Used to count off-tree DLRs, a repairer answers with its redirecting POLR.
+ */
 
 static
 bool
 on_dlr_poll (
-	PGM_GNUC_UNUSED pgm_sock_t*	      const restrict sock,
-	PGM_GNUC_UNUSED pgm_peer_t*	      const restrict source,
-	PGM_GNUC_UNUSED struct pgm_sk_buff_t* const restrict skb
+	pgm_sock_t*	      const restrict sock,
+	pgm_peer_t*	      const restrict source,
+	struct pgm_sk_buff_t* const restrict skb
 	)
 {
+	struct pgm_poll* poll4 = (struct pgm_poll*)skb->data;
+
 /* we are not a DLR */
+	if (NULL == source->dlr)
+		return FALSE;
+
+	pgm_nla_to_sockaddr (&poll4->poll_nla_afi, (struct sockaddr*)&source->poll_nla);
+	((struct sockaddr_in*)&source->poll_nla)->sin_port = pgm_htons (sock->udp_encap_ucast_port);
+	pgm_dlr_send_polr (sock, source, (struct sockaddr*)&source->poll_nla, -1);
+	return TRUE;
+}
+
+/* POLR from a designated local repairer of our subnet, OPT_REDIRECT carries
+ * the unicast NLA to receive our selective NAKs for this source.  only the
+ * repairer configured with PGM_DLR_REDIRECT may redirect, and only to itself.
+ *
+ * returns TRUE on valid packet, FALSE on invalid packet.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_on_polr (
+	pgm_sock_t*	      const restrict sock,
+	pgm_peer_t*	      const restrict source,
+	struct pgm_sk_buff_t* const restrict skb,
+	const struct sockaddr* const restrict from
+	)
+{
+	const struct pgm_polr*	     polr;
+	const struct pgm_opt_length* opt_len;
+	const struct pgm_opt_header* opt_header;
+	struct sockaddr_storage	     redirect_nla;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (NULL != source);
+	pgm_assert (NULL != skb);
+	pgm_assert (NULL != from);
+
+	pgm_debug ("pgm_on_polr (sock:%p source:%p skb:%p from:%p)",
+		(void*)sock, (void*)source, (void*)skb, (const void*)from);
+
+	if (PGM_UNLIKELY(!pgm_verify_polr (skb))) {
+		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded invalid POLR."));
+		return FALSE;
+	}
+
+/* repairers do not redirect to each other */
+	if (NULL != source->dlr)
+		return FALSE;
+
+	if (AF_UNSPEC == sock->dlr_redirect_addr.ss_family ||
+	    0 != pgm_sockaddr_cmp (from, (const struct sockaddr*)&sock->dlr_redirect_addr))
+	{
+		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded POLR from unknown repairer."));
+		return FALSE;
+	}
+
+	if (!(skb->pgm_header->pgm_options & PGM_OPT_PRESENT)) {
+		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded POLR without redirect."));
+		return FALSE;
+	}
+
+	polr = (const struct pgm_polr*)skb->data;
+	opt_len = (const struct pgm_opt_length*)(polr + 1);
+	if (PGM_UNLIKELY(skb->len < sizeof(struct pgm_polr) + sizeof(struct pgm_opt_length) ||
+			 opt_len->opt_type != PGM_OPT_LENGTH ||
+			 opt_len->opt_length != sizeof(struct pgm_opt_length)))
+	{
+		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded malformed POLR."));
+		return FALSE;
+	}
+
+	const char* end = (const char*)skb->data + skb->len;
+	opt_header = (const struct pgm_opt_header*)opt_len;
+	do {
+		opt_header = (const struct pgm_opt_header*)((const char*)opt_header + opt_header->opt_length);
+		if ((const char*)(opt_header + 1) > end || 0 == opt_header->opt_length)
+			break;
+		if ((opt_header->opt_type & PGM_OPT_MASK) == PGM_OPT_REDIRECT)
+		{
+			const struct pgm_opt_redirect* opt_redirect = (const struct pgm_opt_redirect*)(opt_header + 1);
+			const size_t redirect_length = (AFI_IP6 == pgm_ntohs (opt_redirect->opt_nla_afi)) ?
+							sizeof(struct pgm_opt6_redirect) :
+							sizeof(struct pgm_opt_redirect);
+			if ((const char*)opt_redirect + redirect_length > end)
+				break;
+			pgm_nla_to_sockaddr (&opt_redirect->opt_nla_afi, (struct sockaddr*)&redirect_nla);
+			if (PGM_UNLIKELY(0 != pgm_sockaddr_cmp ((struct sockaddr*)&redirect_nla, from))) {
+				pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded POLR redirecting to another address."));
+				return FALSE;
+			}
+			((struct sockaddr_in*)&redirect_nla)->sin_port = pgm_htons (sock->udp_encap_ucast_port);
+			if (0 == source->redirect_expiry ||
+			    0 != pgm_sockaddr_cmp ((struct sockaddr*)&redirect_nla, (struct sockaddr*)&source->redirect_nla))
+			{
+				char addr[INET6_ADDRSTRLEN];
+				pgm_sockaddr_ntop ((struct sockaddr*)&redirect_nla, addr, sizeof(addr));
+				pgm_trace (PGM_LOG_ROLE_SESSION,_("NAKs redirected to designated local repairer %s, tsi %s"),
+					   addr, pgm_tsi_print (&source->tsi));
+				memcpy (&source->redirect_nla, &redirect_nla, pgm_sockaddr_len ((struct sockaddr*)&redirect_nla));
+			}
+			source->redirect_expiry = skb->tstamp + PGM_DLR_REDIRECT_EXPIRY;
+			return TRUE;
+		}
+	} while (!(opt_header->opt_type & PGM_OPT_END));
+
+	pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded POLR without redirect."));
 	return FALSE;
 }
 
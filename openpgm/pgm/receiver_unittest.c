@@ -56,6 +56,7 @@
 #define pgm_verify_nak		mock_pgm_verify_nak
 #define pgm_verify_ncf		mock_pgm_verify_ncf
 #define pgm_verify_poll		mock_pgm_verify_poll
+#define pgm_verify_polr		mock_pgm_verify_polr
 #define pgm_sendto_hops		mock_pgm_sendto_hops
 #define pgm_time_now		mock_pgm_time_now
 #define pgm_time_update_now	mock_pgm_time_update_now
@@ -65,25 +66,37 @@
 #define pgm_rxw_update_fec	mock_pgm_rxw_update_fec
 #define pgm_rxw_confirm		mock_pgm_rxw_confirm
 #define pgm_rxw_lost		mock_pgm_rxw_lost
+#define pgm_rxw_read_loss	mock_pgm_rxw_read_loss
 #define pgm_rxw_state		mock_pgm_rxw_state
 #define pgm_rxw_add		mock_pgm_rxw_add
 #define pgm_rxw_remove_commit	mock_pgm_rxw_remove_commit
 #define pgm_rxw_readv		mock_pgm_rxw_readv
+#define pgm_rxw_update_line	mock_pgm_rxw_update_line
+#define pgm_rxw_is_line_pending	mock_pgm_rxw_is_line_pending
 #define pgm_csum_fold		mock_pgm_csum_fold
 #define pgm_compat_csum_partial	mock_pgm_compat_csum_partial
 #define pgm_histogram_init	mock_pgm_histogram_init
 #define pgm_setsockopt		mock_pgm_setsockopt
+#define pgm_decoder_push	mock_pgm_decoder_push
+#define pgm_dlr_create		mock_pgm_dlr_create
+#define pgm_dlr_destroy		mock_pgm_dlr_destroy
+#define pgm_dlr_add		mock_pgm_dlr_add
+#define pgm_dlr_send_polr	mock_pgm_dlr_send_polr
+#define pgm_hostnak_claim	mock_pgm_hostnak_claim
 
 
 #define RECEIVER_DEBUG
 #include "receiver.c"
 
+static ssize_t mock_readv_retval = 0;
+
 
 static
 void
 mock_setup (void)
 {
 	if (!g_thread_supported ()) g_thread_init (NULL);
+	mock_readv_retval = 0;
 }
 
 static
@@ -121,7 +134,8 @@ static
 gboolean
 mock_pgm_on_nak (
 	pgm_sock_t* const		sock,
-	struct pgm_sk_buff_t* const	skb
+	struct pgm_sk_buff_t* const	skb,
+	const struct sockaddr* const	from
 	)
 {
 	return TRUE;
@@ -149,6 +163,9 @@ mock_pgm_on_spmr (
 }
 
 /** net module */
+static unsigned mock_nak_packets = 0;
+static unsigned mock_parity_nak_packets = 0;
+
 PGM_GNUC_INTERNAL
 ssize_t
 mock_pgm_sendto_hops (
@@ -163,6 +180,12 @@ mock_pgm_sendto_hops (
 	socklen_t			tolen
 	)
 {
+	const struct pgm_header* header = buf;
+	if (PGM_NAK == header->pgm_type) {
+		mock_nak_packets++;
+		if (header->pgm_options & PGM_OPT_PARITY)
+			mock_parity_nak_packets++;
+	}
 	return len;
 }
 
@@ -210,6 +233,14 @@ mock_pgm_verify_poll (
 	return TRUE;
 }
 
+bool
+mock_pgm_verify_polr (
+	const struct pgm_sk_buff_t* const       skb
+	)
+{
+	return TRUE;
+}
+
 /* receive window module */
 pgm_rxw_t*
 mock_pgm_rxw_create (
@@ -253,6 +284,16 @@ mock_pgm_rxw_lost (
 {
 }
 
+bool
+mock_pgm_rxw_read_loss (
+	pgm_rxw_t* const	window,
+	uint32_t*		first,
+	uint32_t*		count
+	)
+{
+	return FALSE;
+}
+
 void
 mock_pgm_rxw_state (
 	pgm_rxw_t* const		window,
@@ -307,7 +348,89 @@ mock_pgm_rxw_readv (
 	const unsigned			pmsglen
 	)
 {
-	return 0;
+	return mock_readv_retval;
+}
+
+static bool mock_is_line_pending = FALSE;
+
+void
+mock_pgm_rxw_update_line (
+	pgm_rxw_t* const		window,
+	const unsigned			line,
+	const uint32_t			sequence,
+	const pgm_time_t		now
+	)
+{
+}
+
+bool
+mock_pgm_rxw_is_line_pending (
+	const pgm_rxw_t* const		window,
+	const uint32_t			sequence,
+	const pgm_time_t		live_after
+	)
+{
+	return mock_is_line_pending;
+}
+
+/* decoder module */
+void
+mock_pgm_decoder_push (
+	pgm_decoder_t* const		decoder,
+	pgm_peer_t* const		peer
+	)
+{
+}
+
+/* designated local repairer module */
+pgm_dlr_t*
+mock_pgm_dlr_create (
+	const unsigned			sqns,
+	const uint16_t			max_tpdu
+	)
+{
+	return NULL;
+}
+
+void
+mock_pgm_dlr_destroy (
+	pgm_dlr_t* const		dlr
+	)
+{
+}
+
+void
+mock_pgm_dlr_add (
+	pgm_dlr_t* const		dlr,
+	const struct pgm_sk_buff_t* const skb
+	)
+{
+}
+
+bool
+mock_pgm_dlr_send_polr (
+	pgm_sock_t* const		sock,
+	pgm_peer_t* const		source,
+	const struct sockaddr* const	to,
+	const int			hops
+	)
+{
+	return TRUE;
+}
+
+/* host NAK suppression module */
+static bool mock_hostnak_is_claimed = FALSE;
+
+PGM_GNUC_INTERNAL
+bool
+mock_pgm_hostnak_claim (
+	pgm_hostnak_t* const		hostnak,
+	const pgm_tsi_t* const		tsi,
+	const uint32_t			sequence,
+	const unsigned			round
+	)
+{
+	return !mock_hostnak_is_claimed;
 }
 
 /* checksum module */
@@ -376,6 +499,42 @@ mock_pgm_setsockopt (
         return TRUE;
 }
 
+/* POLR with OPT_REDIRECT to 127.0.0.2
+ */
+
+static
+struct pgm_sk_buff_t*
+generate_polr (
+	const bool		with_redirect
+	)
+{
+	const struct in_addr dlr = { .s_addr = htonl (0x7f000002) };
+	struct pgm_sk_buff_t* skb = pgm_alloc_skb (TEST_MAX_TPDU);
+	skb->pgm_header = pgm_skb_put (skb, sizeof(struct pgm_header));
+	struct pgm_polr* polr = pgm_skb_put (skb, sizeof(struct pgm_polr));
+	memset (skb->pgm_header, 0, sizeof(struct pgm_header) + sizeof(struct pgm_polr));
+	skb->pgm_header->pgm_type = PGM_POLR;
+	if (with_redirect) {
+		skb->pgm_header->pgm_options = PGM_OPT_PRESENT | PGM_OPT_NETWORK;
+		struct pgm_opt_length* opt_len = pgm_skb_put (skb, sizeof(struct pgm_opt_length));
+		opt_len->opt_type = PGM_OPT_LENGTH;
+		opt_len->opt_length = sizeof(struct pgm_opt_length);
+		opt_len->opt_total_length = htons (sizeof(struct pgm_opt_length) + sizeof(struct pgm_opt_header) + sizeof(struct pgm_opt_redirect));
+		struct pgm_opt_header* opt_header = pgm_skb_put (skb, sizeof(struct pgm_opt_header));
+		opt_header->opt_type = PGM_OPT_REDIRECT | PGM_OPT_END;
+		opt_header->opt_length = sizeof(struct pgm_opt_header) + sizeof(struct pgm_opt_redirect);
+		struct pgm_opt_redirect* opt_redirect = pgm_skb_put (skb, sizeof(struct pgm_opt_redirect));
+		opt_redirect->opt_reserved = 0;
+		opt_redirect->opt_nla_afi = htons (AFI_IP);
+		opt_redirect->opt_reserved2 = 0;
+		opt_redirect->opt_nla = dlr;
+	}
+	skb->data = polr;
+	skb->len = (uint16_t)((char*)skb->tail - (char*)polr);
+	skb->tstamp = pgm_secs(1);
+	return skb;
+}
+
 /* target:
  *	void
  *	pgm_peer_unref (
@@ -407,6 +566,122 @@ START_TEST (test_peer_unref_fail_001)
 }
 END_TEST
 
+/* target:
+ *	bool
+ *	pgm_on_polr (
+ *		pgm_sock_t*		sock,
+ *		pgm_peer_t*		source,
+ *		struct pgm_sk_buff_t*	skb,
+ *		const struct sockaddr*	from
+ *		)
+ */
+
+/* POLR sent from, and repairer configured as, the given address */
+
+static
+void
+set_sockaddr (
+	struct sockaddr_storage*	addr,
+	const uint32_t			s_addr
+	)
+{
+	struct sockaddr_in* sin = (struct sockaddr_in*)addr;
+	memset (addr, 0, sizeof (struct sockaddr_storage));
+	sin->sin_family = AF_INET;
+	sin->sin_addr.s_addr = htonl (s_addr);
+}
+
+START_TEST (test_on_polr_pass_001)
+{
+	pgm_sock_t* sock = generate_sock();
+	sock->udp_encap_ucast_port = TEST_PORT;
+	set_sockaddr (&sock->dlr_redirect_addr, 0x7f000002);
+	pgm_peer_t* peer = generate_peer();
+	struct pgm_sk_buff_t* skb = generate_polr (TRUE);
+	struct sockaddr_storage from;
+	set_sockaddr (&from, 0x7f000002);
+	fail_unless (TRUE == pgm_on_polr (sock, peer, skb, (struct sockaddr*)&from), "on_polr failed");
+	fail_unless (pgm_secs(1) + PGM_DLR_REDIRECT_EXPIRY == peer->redirect_expiry, "expiry not set");
+	const struct sockaddr_in* sin = (const struct sockaddr_in*)&peer->redirect_nla;
+	fail_unless (AF_INET == sin->sin_family, "redirect family");
+	fail_unless (htonl (0x7f000002) == sin->sin_addr.s_addr, "redirect address");
+	fail_unless (htons (TEST_PORT) == sin->sin_port, "redirect port");
+	fail_unless ((const struct sockaddr*)&peer->redirect_nla == nak_nla (peer), "NAKs not redirected");
+}
+END_TEST
+
+/* no OPT_REDIRECT */
+START_TEST (test_on_polr_fail_001)
+{
+	pgm_sock_t* sock = generate_sock();
+	set_sockaddr (&sock->dlr_redirect_addr, 0x7f000002);
+	pgm_peer_t* peer = generate_peer();
+	struct pgm_sk_buff_t* skb = generate_polr (FALSE);
+	struct sockaddr_storage from;
+	set_sockaddr (&from, 0x7f000002);
+	fail_unless (FALSE == pgm_on_polr (sock, peer, skb, (struct sockaddr*)&from), "on_polr failed");
+	fail_unless (0 == peer->redirect_expiry, "expiry set");
+	fail_unless ((const struct sockaddr*)&peer->nla == nak_nla (peer), "NAKs redirected");
+}
+END_TEST
+
+/* a repairer ignores other repairers */
+START_TEST (test_on_polr_fail_002)
+{
+	pgm_sock_t* sock = generate_sock();
+	set_sockaddr (&sock->dlr_redirect_addr, 0x7f000002);
+	pgm_peer_t* peer = generate_peer();
+	peer->dlr = (pgm_dlr_t*)0x1;
+	struct pgm_sk_buff_t* skb = generate_polr (TRUE);
+	struct sockaddr_storage from;
+	set_sockaddr (&from, 0x7f000002);
+	fail_unless (FALSE == pgm_on_polr (sock, peer, skb, (struct sockaddr*)&from), "on_polr failed");
+	fail_unless (0 == peer->redirect_expiry, "expiry set");
+}
+END_TEST
+
+/* redirects are ignored without a configured repairer */
+START_TEST (test_on_polr_fail_003)
+{
+	pgm_sock_t* sock = generate_sock();
+	pgm_peer_t* peer = generate_peer();
+	struct pgm_sk_buff_t* skb = generate_polr (TRUE);
+	struct sockaddr_storage from;
+	set_sockaddr (&from, 0x7f000002);
+	fail_unless (FALSE == pgm_on_polr (sock, peer, skb, (struct sockaddr*)&from), "on_polr failed");
+	fail_unless (0 == peer->redirect_expiry, "expiry set");
+	fail_unless ((const struct sockaddr*)&peer->nla == nak_nla (peer), "NAKs redirected");
+}
+END_TEST
+
+/* POLR from another host than the configured repairer */
+START_TEST (test_on_polr_fail_004)
+{
+	pgm_sock_t* sock = generate_sock();
+	set_sockaddr (&sock->dlr_redirect_addr, 0x7f000002);
+	pgm_peer_t* peer = generate_peer();
+	struct pgm_sk_buff_t* skb = generate_polr (TRUE);
+	struct sockaddr_storage from;
+	set_sockaddr (&from, 0x7f000003);
+	fail_unless (FALSE == pgm_on_polr (sock, peer, skb, (struct sockaddr*)&from), "on_polr failed");
+	fail_unless (0 == peer->redirect_expiry, "expiry set");
+}
+END_TEST
+
+/* the configured repairer redirecting to a third host */
+START_TEST (test_on_polr_fail_005)
+{
+	pgm_sock_t* sock = generate_sock();
+	set_sockaddr (&sock->dlr_redirect_addr, 0x7f000003);
+	pgm_peer_t* peer = generate_peer();
+	struct pgm_sk_buff_t* skb = generate_polr (TRUE);
+	struct sockaddr_storage from;
+	set_sockaddr (&from, 0x7f000003);
+	fail_unless (FALSE == pgm_on_polr (sock, peer, skb, (struct sockaddr*)&from), "on_polr failed");
+	fail_unless (0 == peer->redirect_expiry, "expiry set");
+}
+END_TEST
+
 /* target:
  *	bool
  *	pgm_check_peer_state (
@@ -430,6 +705,202 @@ START_TEST (test_check_peer_state_fail_001)
 }
 END_TEST
 
+/* target:
+ *	bool
+ *	nak_rb_state (
+ *		pgm_sock_t*		sock,
+ *		pgm_peer_t*		peer,
+ *		const pgm_time_t	now
+ *		)
+ */
+
+/* peer with an expired back-off queue entry for each sequence in [first, first + count) */
+static
+pgm_peer_t*
+generate_nak_peer (
+	const uint32_t		first,
+	const unsigned		count
+	)
+{
+	pgm_peer_t* peer = generate_peer();
+	struct sockaddr_in* nla = (struct sockaddr_in*)&peer->nla;
+	nla->sin_family = AF_INET;
+	nla->sin_addr.s_addr = inet_addr ("172.12.90.1");
+	((struct sockaddr_in*)&peer->group_nla)->sin_family = AF_INET;
+	peer->window->tg_size = 1;
+	for (unsigned i = 0; i < count; i++) {
+		struct pgm_sk_buff_t* skb = pgm_alloc_skb (0);
+		pgm_rxw_state_t* state = (pgm_rxw_state_t*)&skb->cb;
+		skb->sequence = first + i;
+		skb->tstamp = mock_pgm_time_now;
+		state->timer_expiry = mock_pgm_time_now;
+		pgm_queue_push_head_link (&peer->window->nak_backoff_queue, (pgm_list_t*)skb);
+	}
+	peer->window->lead = first + count;
+	return peer;
+}
+
+/* selective NAKs for a burst loss pack 63 sequences per packet */
+START_TEST (test_nak_rb_state_pass_001)
+{
+	pgm_sock_t* sock = generate_sock();
+	sock->can_send_nak = TRUE;
+	sock->nak_bo_ivl = TEST_NAK_BO_IVL;
+	sock->nak_rpt_ivl = TEST_NAK_RPT_IVL;
+	pgm_peer_t* peer = generate_nak_peer (1000, 2000);
+	mock_nak_packets = 0;
+	fail_unless (TRUE == nak_rb_state (sock, peer, mock_pgm_time_now), "nak_rb_state failed");
+	fail_unless (32 == mock_nak_packets, "nak packets %u", mock_nak_packets);
+	fail_unless (32 == peer->cumulative_stats[PGM_PC_RECEIVER_SELECTIVE_NAK_PACKETS_SENT], "nak packet stats");
+}
+END_TEST
+
+/* parity NAKs for losses across many transmission groups pack one group per entry */
+START_TEST (test_nak_rb_state_pass_002)
+{
+	pgm_sock_t* sock = generate_sock();
+	sock->nak_bo_ivl = TEST_NAK_BO_IVL;
+	sock->nak_rpt_ivl = TEST_NAK_RPT_IVL;
+/* 2000 losses of 4-packet groups leaves 500 groups, the last is current and waits */
+	pgm_peer_t* peer = generate_nak_peer (1000, 2000);
+	peer->has_ondemand_parity = TRUE;
+	peer->window->tg_size = 4;
+	peer->window->tg_sqn_shift = 2;
+	peer->window->lead = 2999;
+	mock_nak_packets = mock_parity_nak_packets = 0;
+	fail_unless (TRUE == nak_rb_state (sock, peer, mock_pgm_time_now), "nak_rb_state failed");
+	fail_unless (8 == mock_nak_packets, "nak packets %u", mock_nak_packets);
+	fail_unless (8 == mock_parity_nak_packets, "parity nak packets %u", mock_parity_nak_packets);
+	fail_unless (499 == peer->cumulative_stats[PGM_PC_RECEIVER_PARITY_NAKS_SENT], "parity naks %u",
+		     (unsigned)peer->cumulative_stats[PGM_PC_RECEIVER_PARITY_NAKS_SENT]);
+}
+END_TEST
+
+/* losses in the current group of a proactive parity source are held back */
+START_TEST (test_nak_rb_state_pass_003)
+{
+	pgm_sock_t* sock = generate_sock();
+	sock->can_send_nak = TRUE;
+	sock->nak_bo_ivl = TEST_NAK_BO_IVL;
+	sock->nak_rpt_ivl = TEST_NAK_RPT_IVL;
+	pgm_peer_t* peer = generate_nak_peer (1000, 2);
+	peer->has_proactive_parity = TRUE;
+	peer->window->tg_size = 4;
+	peer->window->tg_sqn_shift = 2;
+	peer->window->lead = 1003;
+	mock_nak_packets = 0;
+	fail_unless (TRUE == nak_rb_state (sock, peer, mock_pgm_time_now), "nak_rb_state failed");
+	fail_unless (0 == mock_nak_packets, "nak packets %u", mock_nak_packets);
+/* still missing after the deferral */
+	fail_unless (TRUE == nak_rb_state (sock, peer, mock_pgm_time_now + 2 * TEST_NAK_BO_IVL), "nak_rb_state failed");
+	fail_unless (1 == mock_nak_packets, "nak packets %u", mock_nak_packets);
+}
+END_TEST
+
+/* sequences another receiver on the host already NAKed are not sent again */
+START_TEST (test_nak_rb_state_pass_004)
+{
+	pgm_sock_t* sock = generate_sock();
+	sock->can_send_nak = TRUE;
+	sock->nak_bo_ivl = TEST_NAK_BO_IVL;
+	sock->nak_rpt_ivl = TEST_NAK_RPT_IVL;
+	sock->hostnak = g_malloc0 (sizeof (pgm_hostnak_t));
+	pgm_peer_t* peer = generate_nak_peer (1000, 100);
+	mock_nak_packets = 0;
+	mock_hostnak_is_claimed = TRUE;
+	fail_unless (TRUE == nak_rb_state (sock, peer, mock_pgm_time_now), "nak_rb_state failed");
+	mock_hostnak_is_claimed = FALSE;
+	fail_unless (0 == mock_nak_packets, "nak packets %u", mock_nak_packets);
+	fail_unless (100 == peer->cumulative_stats[PGM_PC_RECEIVER_SELECTIVE_NAKS_SUPPRESSED], "suppressed stats");
+}
+END_TEST
+
+/* hot/hot feed holds NAKs while the other line may deliver */
+START_TEST (test_nak_rb_state_pass_005)
+{
+	pgm_sock_t* sock = generate_sock();
+	sock->can_send_nak = TRUE;
+	sock->nak_bo_ivl = TEST_NAK_BO_IVL;
+	sock->nak_rpt_ivl = TEST_NAK_RPT_IVL;
+	sock->use_redundant_tsi = TRUE;
+	pgm_peer_t* peer = generate_nak_peer (1000, 10);
+	mock_nak_packets = 0;
+	mock_is_line_pending = TRUE;
+	fail_unless (TRUE == nak_rb_state (sock, peer, mock_pgm_time_now), "nak_rb_state failed");
+	mock_is_line_pending = FALSE;
+	fail_unless (0 == mock_nak_packets, "nak packets %u", mock_nak_packets);
+	fail_unless (10 == peer->cumulative_stats[PGM_PC_RECEIVER_REDUNDANT_NAKS_DEFERRED], "deferred stats");
+/* both lines passed */
+	fail_unless (TRUE == nak_rb_state (sock, peer, mock_pgm_time_now + TEST_NAK_BO_IVL), "nak_rb_state failed");
+	fail_unless (1 == mock_nak_packets, "nak packets %u", mock_nak_packets);
+}
+END_TEST
+
+/* a placeholder past the repair deadline away from the queue tail is cancelled, not NAKed */
+START_TEST (test_nak_rb_state_pass_006)
+{
+	pgm_sock_t* sock = generate_sock();
+	sock->can_send_nak = TRUE;
+	sock->nak_bo_ivl = TEST_NAK_BO_IVL;
+	sock->nak_rpt_ivl = TEST_NAK_RPT_IVL;
+	sock->repair_deadline = pgm_msecs(100);
+	mock_pgm_time_now = pgm_secs(10);
+	pgm_peer_t* peer = generate_nak_peer (1000, 3);
+	struct pgm_sk_buff_t* skb = (struct pgm_sk_buff_t*)peer->window->nak_backoff_queue.head;
+	skb->tstamp = mock_pgm_time_now - pgm_msecs(200);
+	mock_nak_packets = 0;
+	fail_unless (TRUE == nak_rb_state (sock, peer, mock_pgm_time_now), "nak_rb_state failed");
+	fail_unless (1 == mock_nak_packets, "nak packets %u", mock_nak_packets);
+	fail_unless (1 == peer->cumulative_stats[PGM_PC_RECEIVER_NAKS_FAILED_GEN_EXPIRED], "expired stats");
+}
+END_TEST
+
+START_TEST (test_nak_rb_state_fail_001)
+{
+	nak_rb_state (NULL, NULL, mock_pgm_time_now);
+	fail ("reached");
+}
+END_TEST
+
+/* target:
+ *	void
+ *	nak_rpt_state (
+ *		pgm_sock_t*		sock,
+ *		pgm_peer_t*		peer,
+ *		const pgm_time_t	now
+ *		)
+ */
+
+/* NCF timeout past the repair deadline cancels in place of another back-off */
+START_TEST (test_nak_rpt_state_pass_001)
+{
+	pgm_sock_t* sock = generate_sock();
+	sock->nak_bo_ivl = TEST_NAK_BO_IVL;
+	sock->nak_ncf_retries = TEST_NAK_NCF_RETRIES;
+	sock->repair_deadline = pgm_msecs(100);
+	mock_pgm_time_now = pgm_secs(10);
+	pgm_peer_t* peer = generate_nak_peer (1000, 0);
+	for (unsigned i = 0; i < 2; i++) {
+		struct pgm_sk_buff_t* skb = pgm_alloc_skb (0);
+		pgm_rxw_state_t* state = (pgm_rxw_state_t*)&skb->cb;
+		skb->sequence = 1000 + i;
+		skb->tstamp = mock_pgm_time_now - (i ? pgm_msecs(200) : pgm_msecs(10));
+		state->timer_expiry = mock_pgm_time_now;
+		pgm_queue_push_head_link (&peer->window->wait_ncf_queue, (pgm_list_t*)skb);
+	}
+	nak_rpt_state (sock, peer, mock_pgm_time_now);
+	fail_unless (1 == peer->cumulative_stats[PGM_PC_RECEIVER_NAKS_FAILED_GEN_EXPIRED], "expired stats");
+	fail_unless (0 == peer->cumulative_stats[PGM_PC_RECEIVER_NAKS_FAILED_NCF_RETRIES_EXCEEDED], "retry stats");
+}
+END_TEST
+
+START_TEST (test_nak_rpt_state_fail_001)
+{
+	nak_rpt_state (NULL, NULL, mock_pgm_time_now);
+	fail ("reached");
+}
+END_TEST
+
 /* target:
  *	pgm_time_t
  *	pgm_min_receiver_expiry (
@@ -447,6 +918,29 @@ START_TEST (test_min_receiver_expiry_pass_001)
 }
 END_TEST
 
+/* repair deadline follows the oldest placeholder at any repair queue tail */
+START_TEST (test_min_receiver_expiry_pass_002)
+{
+	pgm_sock_t* sock = generate_sock();
+	sock->is_bound = TRUE;
+	sock->repair_deadline = pgm_msecs(100);
+	mock_pgm_time_now = pgm_secs(10);
+	const pgm_time_t expiration = mock_pgm_time_now + pgm_secs(1);
+	pgm_peer_t* peer = generate_peer();
+	struct pgm_sk_buff_t* skb = pgm_alloc_skb (0);
+	skb->tstamp = mock_pgm_time_now - pgm_msecs(5);
+	((pgm_rxw_state_t*)&skb->cb)->timer_expiry = expiration;
+	pgm_queue_push_head_link (&peer->window->nak_backoff_queue, (pgm_list_t*)skb);
+	skb = pgm_alloc_skb (0);
+	skb->tstamp = mock_pgm_time_now - pgm_msecs(20);
+	((pgm_rxw_state_t*)&skb->cb)->timer_expiry = expiration;
+	pgm_queue_push_head_link (&peer->window->wait_ncf_queue, (pgm_list_t*)skb);
+	sock->peers_list = pgm_list_append (sock->peers_list, peer);
+	const pgm_time_t next_expiration = pgm_min_receiver_expiry (sock, expiration);
+	fail_unless (mock_pgm_time_now + pgm_msecs(80) == next_expiration, "expiration");
+}
+END_TEST
+
 START_TEST (test_min_receiver_expiry_fail_001)
 {
 	const pgm_time_t expiration = pgm_secs(1);
@@ -455,6 +949,62 @@ START_TEST (test_min_receiver_expiry_fail_001)
 }
 END_TEST
 
+/* target:
+ *	int
+ *	pgm_flush_peers_pending (
+ *		pgm_sock_t* const		sock,
+ *		struct pgm_msgv_t**		pmsg,
+ *		const struct pgm_msgv_t* const	msg_end,
+ *		size_t* const			bytes_read,
+ *		unsigned* const			data_read
+ *	)
+ */
+
+static
+int
+flush_one_peer (
+	pgm_sock_t*		sock,
+	pgm_peer_t*		peer
+	)
+{
+	struct pgm_msgv_t msgv[4], *pmsg = msgv;
+	size_t bytes_read = 0;
+	unsigned data_read = 0;
+	sock->peers_pending = pgm_slist_append (sock->peers_pending, peer);
+	return pgm_flush_peers_pending (sock, &pmsg, msgv + G_N_ELEMENTS(msgv) - 1, &bytes_read, &data_read);
+}
+
+/* committed skbs of an ordered window are released on the next call */
+START_TEST (test_flush_peers_pending_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	pgm_peer_t* peer = generate_peer ();
+	pgm_mutex_init (&peer->mutex);
+	sock->last_commit = 10;
+	peer->window->committed_count = 2;
+	mock_readv_retval = -1;
+	fail_unless (0 == flush_one_peer (sock, peer), "flush_peers_pending failed");
+	fail_unless (10 == peer->last_commit, "last_commit failed");
+	fail_unless (NULL == sock->peers_pending, "peers_pending failed");
+/* nothing committed */
+	peer->window->committed_count = 0;
+	fail_unless (0 == flush_one_peer (sock, peer), "flush_peers_pending failed");
+	fail_unless (0 == peer->last_commit, "last_commit failed");
+/* delivered */
+	mock_readv_retval = 100;
+	sock->last_commit = 11;
+	fail_unless (0 == flush_one_peer (sock, peer), "flush_peers_pending failed");
+	fail_unless (11 == peer->last_commit, "last_commit failed");
+}
+END_TEST
+
+START_TEST (test_flush_peers_pending_fail_001)
+{
+	pgm_flush_peers_pending (NULL, NULL, NULL, NULL, NULL);
+	fail ("reached");
+}
+END_TEST
+
 /* target:
  *	bool
  *	pgm_setsockopt (
@@ -818,6 +1368,16 @@ make_test_suite (void)
 	tcase_add_test_raise_signal (tc_peer_unref, test_peer_unref_fail_001, SIGABRT);
 #endif
 
+	TCase* tc_on_polr = tcase_create ("on-polr");
+	suite_add_tcase (s, tc_on_polr);
+	tcase_add_checked_fixture (tc_on_polr, mock_setup, NULL);
+	tcase_add_test (tc_on_polr, test_on_polr_pass_001);
+	tcase_add_test (tc_on_polr, test_on_polr_fail_001);
+	tcase_add_test (tc_on_polr, test_on_polr_fail_002);
+	tcase_add_test (tc_on_polr, test_on_polr_fail_003);
+	tcase_add_test (tc_on_polr, test_on_polr_fail_004);
+	tcase_add_test (tc_on_polr, test_on_polr_fail_005);
+
 /* formally check-peer-nak-state */
 	TCase* tc_check_peer_state = tcase_create ("check-peer-state");
 	suite_add_tcase (s, tc_check_peer_state);
@@ -827,15 +1387,45 @@ make_test_suite (void)
 	tcase_add_test_raise_signal (tc_check_peer_state, test_check_peer_state_fail_001, SIGABRT);
 #endif
 
+	TCase* tc_nak_rb_state = tcase_create ("nak-rb-state");
+	suite_add_tcase (s, tc_nak_rb_state);
+	tcase_add_checked_fixture (tc_nak_rb_state, mock_setup, NULL);
+	tcase_add_test (tc_nak_rb_state, test_nak_rb_state_pass_001);
+	tcase_add_test (tc_nak_rb_state, test_nak_rb_state_pass_002);
+	tcase_add_test (tc_nak_rb_state, test_nak_rb_state_pass_003);
+	tcase_add_test (tc_nak_rb_state, test_nak_rb_state_pass_004);
+	tcase_add_test (tc_nak_rb_state, test_nak_rb_state_pass_005);
+	tcase_add_test (tc_nak_rb_state, test_nak_rb_state_pass_006);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_nak_rb_state, test_nak_rb_state_fail_001, SIGABRT);
+#endif
+
+	TCase* tc_nak_rpt_state = tcase_create ("nak-rpt-state");
+	suite_add_tcase (s, tc_nak_rpt_state);
+	tcase_add_checked_fixture (tc_nak_rpt_state, mock_setup, NULL);
+	tcase_add_test (tc_nak_rpt_state, test_nak_rpt_state_pass_001);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_nak_rpt_state, test_nak_rpt_state_fail_001, SIGABRT);
+#endif
+
 /* formally min-nak-expiry */
 	TCase* tc_min_receiver_expiry = tcase_create ("min-receiver-expiry");
 	suite_add_tcase (s, tc_min_receiver_expiry);
 	tcase_add_checked_fixture (tc_min_receiver_expiry, mock_setup, NULL);
 	tcase_add_test (tc_min_receiver_expiry, test_min_receiver_expiry_pass_001);
+	tcase_add_test (tc_min_receiver_expiry, test_min_receiver_expiry_pass_002);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_min_receiver_expiry, test_min_receiver_expiry_fail_001, SIGABRT);
 #endif
 
+	TCase* tc_flush_peers_pending = tcase_create ("flush-peers-pending");
+	suite_add_tcase (s, tc_flush_peers_pending);
+	tcase_add_checked_fixture (tc_flush_peers_pending, mock_setup, NULL);
+	tcase_add_test (tc_flush_peers_pending, test_flush_peers_pending_pass_001);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_flush_peers_pending, test_flush_peers_pending_fail_001, SIGABRT);
+#endif
+
 	TCase* tc_set_rxw_sqns = tcase_create ("set-rxw_sqns");
 	suite_add_tcase (s, tc_set_rxw_sqns);
 	tcase_add_checked_fixture (tc_set_rxw_sqns, mock_setup, NULL);
@@ -42,6 +42,7 @@
 #include <impl/packet_parse.h>
 #include <impl/timer.h>
 #include <impl/engine.h>
+#include <impl/dlr.h>
 
 
 //#define RECV_DEBUG
@@ -64,6 +65,9 @@
 #	define PGM_CMSG_LEN(len)		WSA_CMSG_LEN(len)
 #endif
 
+/* packets read back to back by a non-blocking call between timer checks */
+#define PGM_RECV_TIMER_BATCH		64
+
 #ifdef HAVE_WSACMSGHDR
 #	ifdef __GNU__
 /* as listed in MSDN */
@@ -76,7 +80,9 @@
 #endif
 
 
-/* read a packet into a PGM skbuff
+/* read a packet into a PGM skbuff, stamped with the time sampled for the
+ * current batch.
+ *
  * on success returns packet length, on closed socket returns 0,
  * on error returns -1.
  */
@@ -87,6 +93,7 @@ recvskb (
 	pgm_sock_t*           const restrict sock,
 	struct pgm_sk_buff_t* const restrict skb,
 	const int			     flags,
+	const pgm_time_t		     now,
 	struct sockaddr*      const restrict src_addr,
 	const socklen_t			     src_addrlen,
 	struct sockaddr*      const restrict dst_addr,
@@ -101,8 +108,8 @@ recvskb (
 	pgm_assert (NULL != dst_addr);
 	pgm_assert (dst_addrlen > 0);
 
-	pgm_debug ("recvskb (sock:%p skb:%p flags:%d src-addr:%p src-addrlen:%d dst-addr:%p dst-addrlen:%d)",
-		(void*)sock, (void*)skb, flags, (void*)src_addr, (int)src_addrlen, (void*)dst_addr, (int)dst_addrlen);
+	pgm_debug ("recvskb (sock:%p skb:%p flags:%d now:%" PGM_TIME_FORMAT " src-addr:%p src-addrlen:%d dst-addr:%p dst-addrlen:%d)",
+		(void*)sock, (void*)skb, flags, now, (void*)src_addr, (int)src_addrlen, (void*)dst_addr, (int)dst_addrlen);
 
 	if (PGM_UNLIKELY(sock->is_destroyed))
 		return 0;
@@ -141,10 +148,11 @@ recvskb (
 	}
 #endif /* !_WIN32 */
 
-#ifdef PGM_DEBUG
+#if defined(PGM_DEBUG) || defined(USE_LOSS_SIMULATION)
 	if (PGM_UNLIKELY(pgm_loss_rate > 0)) {
-		const unsigned percent = pgm_rand_int_range (&sock->rand_, 0, 100);
-		if (percent <= pgm_loss_rate) {
+/* high bits, the generator low bits repeat with short periods */
+		const unsigned percent = (pgm_rand_int (&sock->rand_) >> 16) % 100;
+		if (percent < pgm_loss_rate) {
 			pgm_debug ("Simulated packet loss");
 			pgm_set_last_sock_error (PGM_SOCK_EAGAIN);
 			return SOCKET_ERROR;
@@ -153,7 +161,7 @@ recvskb (
 #endif
 
 	skb->sock		= sock;
-	skb->tstamp		= pgm_time_update_now();
+	skb->tstamp		= now;
 	skb->data		= skb->head;
 	skb->len		= (uint16_t)len;
 	skb->zero_padded	= 0;
@@ -254,16 +262,18 @@ static
 bool
 on_upstream (
 	pgm_sock_t*           const restrict sock,
-	struct pgm_sk_buff_t* const restrict skb
+	struct pgm_sk_buff_t* const restrict skb,
+	struct sockaddr*      const restrict src_addr
 	)
 {
 /* pre-conditions */
 	pgm_assert (NULL != sock);
 	pgm_assert (NULL != skb);
+	pgm_assert (NULL != src_addr);
 	pgm_assert_cmpuint (skb->pgm_header->pgm_dport, ==, sock->tsi.sport);
 
-	pgm_debug ("on_upstream (sock:%p skb:%p)",
-		(const void*)sock, (const void*)skb);
+	pgm_debug ("on_upstream (sock:%p skb:%p src-addr:%p)",
+		(const void*)sock, (const void*)skb, (const void*)src_addr);
 
 	if (PGM_UNLIKELY(!sock->can_send_data)) {
 		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded packet for muted source."));
@@ -289,7 +299,7 @@ on_upstream (
 
 	switch (skb->pgm_header->pgm_type) {
 	case PGM_NAK:
-		if (PGM_UNLIKELY(!pgm_on_nak (sock, skb)))
+		if (PGM_UNLIKELY(!pgm_on_nak (sock, skb, src_addr)))
 			goto out_discarded;
 		break;
 
@@ -320,7 +330,8 @@ out_discarded:
 	return FALSE;
 }
 
-/* peer to peer message, either multicast NAK or multicast SPMR.
+/* peer to peer message, either multicast NAK or multicast SPMR, or a NAK
+ * redirected to us as designated local repairer and the repairer's POLR.
  *
  * returns TRUE on valid processed packet, returns FALSE on discarded packet.
  */
@@ -330,6 +341,7 @@ bool
 on_peer (
 	pgm_sock_t*           const restrict sock,
 	struct pgm_sk_buff_t* const restrict skb,
+	const struct sockaddr* const restrict src_addr,
 	pgm_peer_t**		    restrict source
 	)
 {
@@ -337,10 +349,11 @@ on_peer (
 	pgm_assert (NULL != sock);
 	pgm_assert (NULL != skb);
 	pgm_assert_cmpuint (skb->pgm_header->pgm_dport, !=, sock->tsi.sport);
+	pgm_assert (NULL != src_addr);
 	pgm_assert (NULL != source);
 
-	pgm_debug ("on_peer (sock:%p skb:%p source:%p)",
-		(const void*)sock, (const void*)skb, (const void*)source);
+	pgm_debug ("on_peer (sock:%p skb:%p src-addr:%p source:%p)",
+		(const void*)sock, (const void*)skb, (const void*)src_addr, (const void*)source);
 
 /* we are not the source */
 	if (PGM_UNLIKELY(!sock->can_recv_data)) {
@@ -373,25 +386,36 @@ on_peer (
 	skb->data	= (char*)skb->data + sizeof(struct pgm_header);
 	skb->len       -= sizeof(struct pgm_header);
 
+	pgm_mutex_lock (&(*source)->mutex);
 	switch (skb->pgm_header->pgm_type) {
 	case PGM_NAK:
-		if (PGM_UNLIKELY(!pgm_on_peer_nak (sock, *source, skb)))
-			goto out_discarded;
+		if (NULL != (*source)->dlr) {
+			if (PGM_UNLIKELY(!pgm_dlr_on_nak (sock, *source, skb, src_addr)))
+				goto out_unlock;
+		} else if (PGM_UNLIKELY(!pgm_on_peer_nak (sock, *source, skb)))
+			goto out_unlock;
 		break;
 
 	case PGM_SPMR:
 		if (PGM_UNLIKELY(!pgm_on_spmr (sock, *source, skb)))
-			goto out_discarded;
+			goto out_unlock;
 		break;
 
-	case PGM_NNAK:
 	case PGM_POLR:
+		if (PGM_UNLIKELY(!pgm_on_polr (sock, *source, skb, src_addr)))
+			goto out_unlock;
+		break;
+
+	case PGM_NNAK:
 	default:
 		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded unsupported PGM type packet."));
-		goto out_discarded;
+		goto out_unlock;
 	}
 
+	pgm_mutex_unlock (&(*source)->mutex);
 	return TRUE;
+out_unlock:
+	pgm_mutex_unlock (&(*source)->mutex);
 out_discarded:
 	if (*source)
 		(*source)->cumulative_stats[PGM_PC_RECEIVER_PACKETS_DISCARDED]++;
@@ -400,6 +424,26 @@ out_discarded:
 	return FALSE;
 }
 
+/* destination is the B line group of a hot/hot feed sharing one TSI, the
+ * receiving interface of an IPv6 destination is ignored.
+ */
+
+static inline
+bool
+is_redundant_group (
+	const pgm_sock_t*      const restrict sock,
+	const struct sockaddr* const restrict dst_addr
+	)
+{
+	const struct sockaddr* group = (const struct sockaddr*)&sock->redundant_recv_gr.gr_group;
+
+	if (AF_INET6 == dst_addr->sa_family && AF_INET6 == group->sa_family)
+		return 0 == memcmp (&((const struct sockaddr_in6*)dst_addr)->sin6_addr,
+				    &((const struct sockaddr_in6*)group)->sin6_addr,
+				    sizeof (struct in6_addr));
+	return 0 == pgm_sockaddr_cmp (dst_addr, group);
+}
+
 /* source to receiver message
  *
  * returns TRUE on valid processed packet, returns FALSE on discarded packet.
@@ -441,6 +485,28 @@ on_downstream (
 		goto out_discarded;
 	}
 
+/* B line of a hot/hot feed joins the A line peer, told apart by its own TSI
+ * or when both lines share one TSI by its group.
+ */
+	bool is_redundant_line = FALSE;
+	if (sock->use_redundant_tsi &&
+	    pgm_tsi_equal (&skb->tsi, &sock->redundant_tsi[1]))
+	{
+		memcpy (&skb->tsi, &sock->redundant_tsi[0], sizeof (pgm_tsi_t));
+		is_redundant_line = TRUE;
+	}
+	else if (sock->use_redundant_group &&
+		 is_redundant_group (sock, dst_addr))
+	{
+		is_redundant_line = TRUE;
+	}
+	if (is_redundant_line &&
+	    PGM_SPM == skb->pgm_header->pgm_type)
+	{
+		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded SPM of redundant line."));
+		goto out_discarded;
+	}
+
 /* search for TSI peer context or create a new one */
 	if (PGM_LIKELY(pgm_tsi_hash (&skb->tsi) == sock->last_hash_key &&
 			NULL != sock->last_hash_value))
@@ -469,22 +535,23 @@ on_downstream (
 	skb->len       -= sizeof(struct pgm_header);
 
 /* handle PGM packet type */
+	pgm_mutex_lock (&(*source)->mutex);
 	switch (skb->pgm_header->pgm_type) {
 	case PGM_ODATA:
 	case PGM_RDATA:
-		if (PGM_UNLIKELY(!pgm_on_data (sock, *source, skb)))
-			goto out_discarded;
+		if (PGM_UNLIKELY(!pgm_on_data (sock, *source, skb, is_redundant_line)))
+			goto out_unlock;
 		sock->rx_buffer = pgm_alloc_skb (sock->max_tpdu);
 		break;
 
 	case PGM_NCF:
 		if (PGM_UNLIKELY(!pgm_on_ncf (sock, *source, skb)))
-			goto out_discarded;
+			goto out_unlock;
 		break;
 
 	case PGM_SPM:
 		if (PGM_UNLIKELY(!pgm_on_spm (sock, *source, skb)))
-			goto out_discarded;
+			goto out_unlock;
 
 /* update group NLA if appropriate */
 		if (PGM_LIKELY(pgm_sockaddr_is_addr_multicast ((struct sockaddr*)dst_addr)))
@@ -494,16 +561,19 @@ on_downstream (
 #ifdef USE_PGM_PROTOCOL_POLL
 	case PGM_POLL:
 		if (PGM_UNLIKELY(!pgm_on_poll (sock, *source, skb)))
-			goto out_discarded;
+			goto out_unlock;
 		break;
 #endif
 
 	default:
 		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded unsupported PGM type packet."));
-		goto out_discarded;
+		goto out_unlock;
 	}
 
+	pgm_mutex_unlock (&(*source)->mutex);
 	return TRUE;
+out_unlock:
+	pgm_mutex_unlock (&(*source)->mutex);
 out_discarded:
 	if (*source)
 		(*source)->cumulative_stats[PGM_PC_RECEIVER_PACKETS_DISCARDED]++;
@@ -548,11 +618,13 @@ on_pgm (
 		if (PGM_IS_UPSTREAM (skb->pgm_header->pgm_type) ||
 		    PGM_IS_PEER (skb->pgm_header->pgm_type))
 		{
-			return on_upstream (sock, skb);
+			return on_upstream (sock, skb, src_addr);
 		}
 	}
-	else if (PGM_IS_PEER (skb->pgm_header->pgm_type))
-		return on_peer (sock, skb, source);
+	else if (PGM_IS_PEER (skb->pgm_header->pgm_type) ||
+		 PGM_POLR == skb->pgm_header->pgm_type ||
+		 (PGM_NAK == skb->pgm_header->pgm_type && sock->dlr_sqns))
+		return on_peer (sock, skb, src_addr, source);
 
 	pgm_trace (PGM_LOG_ROLE_NETWORK,_("Discarded unknown PGM packet."));
 	if (sock->can_send_data)
@@ -560,7 +632,27 @@ on_pgm (
 	return FALSE;
 }
 
-/* block on receiving socket whilst holding sock::waiting-mutex
+/* confirm the selective NAKs of the batch just received and start the repairs,
+ * a blocked RDATA send is resumed through rdata_notify.
+ */
+
+static
+void
+flush_nak_batch (
+	pgm_sock_t* const	sock
+	)
+{
+	if (!sock->can_send_data)
+		return;
+	pgm_on_nak_flush (sock);
+/* never sleep on the rate limit whilst holding the receiver lock */
+	if (!pgm_txw_retransmit_is_empty (sock->window))
+		pgm_on_deferred_nak (sock, TRUE);
+}
+
+/* block on receiving socket whilst holding sock::waiting-mutex, now is
+ * re-sampled on wake for the caller's next batch.
+ *
  * returns EAGAIN for waiting data, returns EINTR for waiting timer event,
  * returns ENOENT on closed sock, and returns EFAULT for libc error.
  */
@@ -568,15 +660,17 @@ on_pgm (
 static
 int
 wait_for_event (
-	pgm_sock_t* const	sock
+	pgm_sock_t* const restrict sock,
+	pgm_time_t*	  restrict now
 	)
 {
-	int n_fds = 3;
+	int n_fds = 4;
 
 /* pre-conditions */
 	pgm_assert (NULL != sock);
+	pgm_assert (NULL != now);
 
-	pgm_debug ("wait_for_event (sock:%p)", (const void*)sock);
+	pgm_debug ("wait_for_event (sock:%p now:%p)", (const void*)sock, (const void*)now);
 
 	do {
 		if (PGM_UNLIKELY(sock->is_destroyed))
@@ -584,31 +678,44 @@ wait_for_event (
 
 		if (sock->can_send_data && !pgm_txw_retransmit_is_empty (sock->window))
 /* tight loop on blocked send */
-			pgm_on_deferred_nak (sock);
+			pgm_on_deferred_nak (sock, sock->is_nonblocking);
 
 #ifdef HAVE_POLL
 		struct pollfd fds[ n_fds ];
 		memset (fds, 0, sizeof(fds));
 		const int status = pgm_poll_info (sock, fds, &n_fds, POLLIN);
 		pgm_assert (-1 != status);
+#	ifdef HAVE_TIMERFD
+/* the application timer is superseded by the poll timeout */
+		if (sock->use_timerfd)
+			for (int i = 0; i < n_fds; i++)
+				if (sock->timer_fd == fds[i].fd)
+					fds[i].fd = -1;
+#	endif
 #else
 		fd_set readfds;
 		FD_ZERO(&readfds);
 		const int status = pgm_select_info (sock, &readfds, NULL, &n_fds);
 		pgm_assert (-1 != status);
+#	ifdef HAVE_TIMERFD
+		if (sock->use_timerfd)
+			FD_CLR(sock->timer_fd, &readfds);
+#	endif
 #endif /* HAVE_POLL */
 
 /* flush any waiting notifications */
 		if (sock->is_pending_read) {
 			pgm_notify_clear (&sock->pending_notify);
 			sock->is_pending_read = FALSE;
+			if (sock->decoder)
+				pgm_decoder_notify (sock->decoder);
 		}
 
 		int timeout;
 		if (sock->can_send_data && !pgm_txw_retransmit_is_empty (sock->window))
 			timeout = 0;
 		else
-			timeout = (int)pgm_timer_expiration (sock);
+			timeout = (int)pgm_timer_expiration (sock, pgm_time_sample());
 		
 #ifdef HAVE_POLL
 		const int ready = poll (fds, n_fds, timeout /* μs */ / 1000 /* to ms */);
@@ -619,6 +726,7 @@ wait_for_event (
 		};
 		const int ready = select (n_fds, &readfds, NULL, NULL, &tv_timeout);
 #endif /* HAVE_POLL */
+		*now = pgm_time_sample();
 		if (PGM_UNLIKELY(SOCKET_ERROR == ready)) {
 			pgm_debug ("block returned errno=%i",errno);
 			return EFAULT;
@@ -626,11 +734,66 @@ wait_for_event (
 			pgm_debug ("recv again on empty");
 			return EAGAIN;
 		}
-	} while (pgm_timer_check (sock));
+	} while (pgm_timer_check (sock, *now));
 	pgm_debug ("state generated event");
 	return EINTR;
 }
 
+/* take the ranges lost by unordered delivery of one peer.  notice skbs pass to
+ * the application with MSG_ERRQUEUE and are otherwise discarded.
+ *
+ * called with the peer mutex held, returns count of msgv entries used.
+ */
+
+static
+size_t
+read_peer_loss (
+	pgm_sock_t*	   const restrict sock,
+	pgm_peer_t*	   const restrict peer,
+	struct pgm_msgv_t* const restrict msg_start,
+	const size_t			  msg_len,
+	const int			  flags
+	)
+{
+	const size_t msgs = pgm_set_loss_notices (sock, peer, msg_start, msg_len);
+	if (!(flags & MSG_ERRQUEUE))
+		for (size_t i = 0; i < msgs; i++) {
+			pgm_free_skb (msg_start[i].msgv_skb[0]);
+			msg_start[i].msgv_len = 0;
+		}
+	return msgs;
+}
+
+/* take the ranges lost by unordered delivery of every peer, a full vector
+ * leaves the remainder for the next call.
+ *
+ * called with the receiver mutex held, returns count of msgv entries used.
+ */
+
+static
+size_t
+read_loss (
+	pgm_sock_t*	   const restrict sock,
+	struct pgm_msgv_t* const restrict msg_start,
+	const size_t			  msg_len,
+	const int			  flags
+	)
+{
+	size_t msgs = 0;
+
+	pgm_rwlock_reader_lock (&sock->peers_lock);
+	for (pgm_list_t* it = sock->peers_list; NULL != it && msgs < msg_len; it = it->next)
+	{
+		pgm_peer_t* peer = it->data;
+		pgm_mutex_lock (&peer->mutex);
+		msgs += read_peer_loss (sock, peer, msg_start + msgs, msg_len - msgs, flags);
+		pgm_mutex_unlock (&peer->mutex);
+	}
+	pgm_rwlock_reader_unlock (&sock->peers_lock);
+	sock->has_pending_loss = (msgs == msg_len);
+	return msgs;
+}
+
 /* data incoming on receive sockets, can be from a sender or receiver, or simply bogus.
  * for IPv4 we receive the IP header to handle fragmentation, for IPv6 we cannot, but the
  * underlying stack handles this for us.
@@ -644,8 +807,11 @@ wait_for_event (
  * PGM_IO_STATUS_WOULD_BLOCK.  When rate limited sending repair data, returns
  * PGM_IO_STATUS_RATE_LIMITED and caller should wait.  During recovery state,
  * returns PGM_IO_STATUS_TIMER_PENDING and caller should also wait.  On
- * unrecoverable dataloss, returns PGM_IO_STATUS_CONN_RESET.  If connection is
- * closed, returns PGM_IO_STATUS_EOF.  On error, returns PGM_IO_STATUS_ERROR.
+ * unrecoverable dataloss, returns PGM_IO_STATUS_CONN_RESET.  With unordered
+ * delivery lost sequences are instead reported by PGM_IO_STATUS_LOSS, with
+ * MSG_ERRQUEUE each msgv holds a notice skb owned by the caller.  If
+ * connection is closed, returns PGM_IO_STATUS_EOF.  On error, returns
+ * PGM_IO_STATUS_ERROR.
  */
 
 int
@@ -687,6 +853,16 @@ pgm_recvmsgv (
 		pgm_assert (pgm_notify_is_valid (&sock->pending_notify));
 	}
 
+/* protocol engine thread owns the receive path, take from its queue */
+	if (sock->engine_thread &&
+	    msg_len > 0 &&
+	    !pgm_engine_thread_is_current (sock->engine_thread))
+	{
+		status = pgm_engine_thread_recvmsgv (sock->engine_thread, msg_start, msg_len, flags, _bytes_read, error);
+		pgm_rwlock_reader_unlock (&sock->lock);
+		return status;
+	}
+
 /* receiver */
 	pgm_mutex_lock (&sock->receiver_mutex);
 
@@ -712,9 +888,19 @@ pgm_recvmsgv (
 		return PGM_IO_STATUS_RESET;
 	}
 
-/* timer status */
-	if (pgm_timer_check (sock) &&
-	    !pgm_timer_dispatch (sock))
+/* loss found delivering the previous call */
+	if (PGM_UNLIKELY(sock->has_pending_loss) && msg_len > 0 &&
+	    read_loss (sock, msg_start, msg_len, flags) > 0)
+	{
+		pgm_mutex_unlock (&sock->receiver_mutex);
+		pgm_rwlock_reader_unlock (&sock->lock);
+		return PGM_IO_STATUS_LOSS;
+	}
+
+/* timer status, one time sample serves the whole batch */
+	pgm_time_t now = pgm_time_sample();
+	if (pgm_timer_check (sock, now) &&
+	    !pgm_timer_dispatch (sock, now))
 	{
 /* block on send-in-recv */
 		status = PGM_IO_STATUS_RATE_LIMITED;
@@ -724,7 +910,7 @@ pgm_recvmsgv (
 	{
 		if (!pgm_txw_retransmit_is_empty (sock->window))
 		{
-			if (!pgm_on_deferred_nak (sock))
+			if (!pgm_on_deferred_nak (sock, sock->is_nonblocking))
 				status = PGM_IO_STATUS_RATE_LIMITED;
 		}
 		else
@@ -739,8 +925,12 @@ pgm_recvmsgv (
 	if (PGM_UNLIKELY(0 == ++(sock->last_commit)))
 		++(sock->last_commit);
 
+/* merge transmission groups recovered by the parity decoder */
+	if (sock->decoder)
+		pgm_decoder_flush (sock->decoder);
+
 	/* second, flush any remaining contiguous messages from previous call(s) */
-	if (sock->peers_pending) {
+	if (sock->peers_pending && pmsg <= msg_end) {
 		if (0 != pgm_flush_peers_pending (sock, &pmsg, msg_end, &bytes_read, &data_read))
 			goto out;
 /* returns on: reset or full buffer */
@@ -753,12 +943,14 @@ pgm_recvmsgv (
 	struct sockaddr_storage src, dst;
 	ssize_t len;
 	size_t bytes_received = 0;
+	unsigned packets_received = 0;
 
 recv_again:
 
 	len = recvskb (sock,
 		       sock->rx_buffer,		/* PGM skbuff */
 		       0,
+		       now,
 		       (struct sockaddr*)&src,
 		       sizeof(src),
 		       (struct sockaddr*)&dst,
@@ -820,7 +1012,7 @@ recv_again:
 
 flush_pending:
 /* flush any congtiguous packets generated by the receipt of this packet */
-	if (sock->peers_pending)
+	if (sock->peers_pending && pmsg <= msg_end)
 	{
 		if (0 != pgm_flush_peers_pending (sock, &pmsg, msg_end, &bytes_read, &data_read))
 		{
@@ -830,12 +1022,20 @@ flush_pending:
 	}
 
 check_for_repeat:
-/* repeat if non-blocking and not full */
+/* repeat if non-blocking and not full, an empty vector services the protocol only */
 	if (sock->is_nonblocking ||
 	    flags & MSG_DONTWAIT)
 	{
-		if (len > 0 && pmsg <= msg_end) {
+		if (len > 0 && (pmsg <= msg_end || 0 == msg_len)) {
 			pgm_trace (PGM_LOG_ROLE_NETWORK,_("Recv again on not-full"));
+/* a stalled window under sustained load would otherwise never re-NAK */
+			if (0 == (++packets_received % PGM_RECV_TIMER_BATCH)) {
+				flush_nak_batch (sock);
+				now = pgm_time_sample();
+				if (pgm_timer_check (sock, now) &&
+				    !pgm_timer_dispatch (sock, now))
+					status = PGM_IO_STATUS_RATE_LIMITED;
+			}
 			goto recv_again;		/* \:D/ */
 		}
 	}
@@ -844,12 +1044,15 @@ check_for_repeat:
 /* repeat if blocking and empty, i.e. received non data packet.
  */
 		if (0 == data_read) {
-			const int wait_status = wait_for_event (sock);
+			flush_nak_batch (sock);
+			const int wait_status = wait_for_event (sock, &now);
 			switch (wait_status) {
 			case EAGAIN:
+				if (sock->decoder && pgm_decoder_flush (sock->decoder))
+					goto flush_pending;
 				goto recv_again;
 			case EINTR:
-				if (!pgm_timer_dispatch (sock))
+				if (!pgm_timer_dispatch (sock, now))
 					goto check_for_repeat;
 				goto flush_pending;
 			case ENOENT:
@@ -876,12 +1079,19 @@ check_for_repeat:
 	}
 
 out:
+	flush_nak_batch (sock);
+/* follow any timer changes from this batch */
+	if (sock->use_timerfd)
+		pgm_timer_arm (sock);
+
 	if (0 == data_read)
 	{
 /* clear event notification */
 		if (sock->is_pending_read) {
 			pgm_notify_clear (&sock->pending_notify);
 			sock->is_pending_read = FALSE;
+			if (sock->decoder)
+				pgm_decoder_notify (sock->decoder);
 		}
 /* report data loss */
 		if (PGM_UNLIKELY(sock->is_reset)) {
@@ -905,6 +1115,13 @@ out:
 			pgm_rwlock_reader_unlock (&sock->lock);
 			return PGM_IO_STATUS_RESET;
 		}
+		if (PGM_UNLIKELY(sock->has_pending_loss) && msg_len > 0 &&
+		    read_loss (sock, msg_start, msg_len, flags) > 0)
+		{
+			pgm_mutex_unlock (&sock->receiver_mutex);
+			pgm_rwlock_reader_unlock (&sock->lock);
+			return PGM_IO_STATUS_LOSS;
+		}
 		pgm_mutex_unlock (&sock->receiver_mutex);
 		pgm_rwlock_reader_unlock (&sock->lock);
 		if (PGM_IO_STATUS_WOULD_BLOCK == status &&
@@ -924,6 +1141,8 @@ out:
 /* empty pending-pipe */
 			pgm_notify_clear (&sock->pending_notify);
 			sock->is_pending_read = FALSE;
+			if (sock->decoder)
+				pgm_decoder_notify (sock->decoder);
 		}
 		else if (!sock->is_pending_read && !sock->is_edge_triggered_recv)
 		{
@@ -940,6 +1159,342 @@ out:
 	return PGM_IO_STATUS_NORMAL;
 }
 
+/* run the receive protocol on behalf of all per-TSI readers: timers, deferred
+ * repairs, recovered transmission groups and every packet waiting on the
+ * receive socket.  readers poll their own windows so the pending list is
+ * emptied rather than flushed.
+ *
+ * called by the leader with receiver_mutex held, returns PGM_IO_STATUS_NORMAL
+ * if any event was processed.
+ */
+
+static
+int
+service_peers (
+	pgm_sock_t*    const restrict sock,
+	pgm_error_t**	     restrict error
+	)
+{
+	int status = PGM_IO_STATUS_WOULD_BLOCK;
+	bool has_event = FALSE;
+	const pgm_time_t now = pgm_time_sample();
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+
+	pgm_debug ("service_peers (sock:%p error:%p)",
+		(const void*)sock, (const void*)error);
+
+	if (pgm_timer_check (sock, now))
+	{
+		has_event = TRUE;
+		if (!pgm_timer_dispatch (sock, now))
+			status = PGM_IO_STATUS_RATE_LIMITED;
+	}
+	else if (sock->can_send_data)
+	{
+		if (!pgm_txw_retransmit_is_empty (sock->window))
+		{
+			if (!pgm_on_deferred_nak (sock, sock->is_nonblocking))
+				status = PGM_IO_STATUS_RATE_LIMITED;
+		}
+		else
+			pgm_notify_clear (&sock->rdata_notify);
+	}
+
+	if (sock->decoder && pgm_decoder_flush (sock->decoder))
+		has_event = TRUE;
+
+	for (;;)
+	{
+		struct sockaddr_storage src, dst;
+		const ssize_t len = recvskb (sock,
+					     sock->rx_buffer,
+					     0,
+					     now,
+					     (struct sockaddr*)&src,
+					     sizeof(src),
+					     (struct sockaddr*)&dst,
+					     sizeof(dst));
+		if (len < 0)
+		{
+			const int save_errno = pgm_get_last_sock_error();
+			char errbuf[1024];
+			if (PGM_LIKELY(PGM_SOCK_EAGAIN == save_errno))
+				break;
+			pgm_set_error (error,
+				     PGM_ERROR_DOMAIN_RECV,
+				     pgm_error_from_sock_errno (save_errno),
+				     _("Transport socket error: %s"),
+				     pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			return PGM_IO_STATUS_ERROR;
+		}
+		else if (0 == len)
+			return PGM_IO_STATUS_EOF;
+
+		pgm_error_t* err = NULL;
+		const bool is_valid = (sock->udp_encap_ucast_port || AF_INET6 == src.ss_family) ?
+						pgm_parse_udp_encap (sock->rx_buffer, &err) :
+						pgm_parse_raw (sock->rx_buffer, (struct sockaddr*)&dst, &err);
+		if (PGM_UNLIKELY(!is_valid))
+		{
+			pgm_trace (PGM_LOG_ROLE_NETWORK,
+					_("Discarded invalid packet: %s"),
+					(err && err->message) ? err->message : "(null)");
+			if (sock->can_send_data) {
+				if (err && PGM_ERROR_CKSUM == err->code)
+					sock->cumulative_stats[PGM_PC_SOURCE_CKSUM_ERRORS]++;
+				sock->cumulative_stats[PGM_PC_SOURCE_PACKETS_DISCARDED]++;
+			}
+			pgm_error_free (err);
+			continue;
+		}
+
+		pgm_peer_t* source = NULL;
+		if (on_pgm (sock, sock->rx_buffer, (struct sockaddr*)&src, (struct sockaddr*)&dst, &source))
+			has_event = TRUE;
+	}
+	flush_nak_batch (sock);
+
+	while (sock->peers_pending)
+		sock->peers_pending = pgm_slist_remove_first (sock->peers_pending);
+	if (sock->is_pending_read) {
+		pgm_notify_clear (&sock->pending_notify);
+		sock->is_pending_read = FALSE;
+		if (sock->decoder)
+			pgm_decoder_notify (sock->decoder);
+	}
+	if (sock->use_timerfd)
+		pgm_timer_arm (sock);
+	return has_event ? PGM_IO_STATUS_NORMAL : status;
+}
+
+/* read contiguous APDUs from one peer's window.  buffers committed by the
+ * previous call for this peer are released first.
+ *
+ * called with the peer mutex held.
+ */
+
+static
+int
+read_peer (
+	pgm_sock_t*	   const restrict sock,
+	pgm_peer_t*	   const restrict peer,
+	struct pgm_msgv_t* const restrict msg_start,
+	const size_t			  msg_len,
+	const int			  flags,
+	size_t*		   const restrict bytes_read,
+	pgm_error_t**		 restrict error
+	)
+{
+	struct pgm_msgv_t* pmsg = msg_start;
+	pgm_rxw_t* window = peer->window;
+
+	pgm_rxw_remove_commit (window);
+	if (PGM_UNLIKELY(peer->is_reset))
+		goto reset;
+	if (PGM_UNLIKELY(window->loss_len) && msg_len > 0)
+		goto loss;
+
+	const ssize_t peer_bytes = pgm_rxw_readv (window, &pmsg, (unsigned)msg_len);
+	if (pmsg > msg_start) {
+		const pgm_time_t now = pgm_time_sample();
+		for (const struct pgm_msgv_t* msgv = msg_start; msgv < pmsg; msgv++)
+			pgm_latency_add (PGM_LATENCY_DELIVERY, now - msgv->msgv_skb[0]->tstamp);
+	}
+
+/* transmission groups awaiting parity recovery */
+	if (window->decode_list)
+		pgm_decoder_push (sock->decoder, peer);
+
+	if (pgm_peer_has_new_loss (peer))
+	{
+		peer->is_reset = 1;
+		peer->lost_count = window->cumulative_losses - peer->last_cumulative_losses;
+		peer->last_cumulative_losses = window->cumulative_losses;
+	}
+
+/* loss is reported on the next call */
+	if (peer_bytes >= 0) {
+		*bytes_read = peer_bytes;
+		return PGM_IO_STATUS_NORMAL;
+	}
+	if (PGM_UNLIKELY(window->loss_len) && !peer->is_reset && msg_len > 0)
+		goto loss;
+	if (!peer->is_reset)
+		return PGM_IO_STATUS_WOULD_BLOCK;
+
+reset:
+	if (flags & MSG_ERRQUEUE)
+		pgm_set_reset_error (sock, peer, msg_start);
+	else if (error) {
+		char tsi[PGM_TSISTRLEN];
+		pgm_tsi_print_r (&peer->tsi, tsi, sizeof(tsi));
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_RECV,
+			     PGM_ERROR_CONNRESET,
+			     _("Transport has been reset on unrecoverable loss from %s."),
+			     tsi);
+	}
+	if (!sock->is_abort_on_reset)
+		peer->is_reset = 0;
+	return PGM_IO_STATUS_RESET;
+
+loss:
+	read_peer_loss (sock, peer, msg_start, msg_len, flags);
+	return PGM_IO_STATUS_LOSS;
+}
+
+/* receive a vector of APDUs from one transport session only.  threads may
+ * each drain a different TSI of the same socket concurrently, the thread
+ * that finds no data leads the protocol for all until an event arrives.
+ *
+ * APDUs remain valid until the next call for the same TSI.  a socket read
+ * this way must not also be read with pgm_recvmsgv().
+ *
+ * return values as for pgm_recvmsgv(), a reset only concerns the named TSI.
+ */
+
+int
+pgm_recvmsgv_tsi (
+	pgm_sock_t*   	   const restrict sock,
+	const pgm_tsi_t*   const restrict tsi,
+	struct pgm_msgv_t* const restrict msg_start,
+	const size_t			  msg_len,
+	const int			  flags,	/* MSG_DONTWAIT for non-blocking */
+	size_t*			 restrict _bytes_read,	/* may be NULL */
+	pgm_error_t**		 restrict error
+	)
+{
+	size_t bytes_read = 0;
+	int status = PGM_IO_STATUS_WOULD_BLOCK;
+
+	pgm_debug ("pgm_recvmsgv_tsi (sock:%p tsi:%p msg-start:%p msg-len:%" PRIzu " flags:%d bytes-read:%p error:%p)",
+		(void*)sock, (const void*)tsi, (void*)msg_start, msg_len, flags, (void*)_bytes_read, (void*)error);
+
+/* parameters */
+	pgm_return_val_if_fail (NULL != sock, PGM_IO_STATUS_ERROR);
+	pgm_return_val_if_fail (NULL != tsi, PGM_IO_STATUS_ERROR);
+	pgm_return_val_if_fail (NULL != msg_start, PGM_IO_STATUS_ERROR);
+	pgm_return_val_if_fail (msg_len > 0, PGM_IO_STATUS_ERROR);
+
+/* shutdown */
+	if (PGM_UNLIKELY(!pgm_rwlock_reader_trylock (&sock->lock)))
+		pgm_return_val_if_reached (PGM_IO_STATUS_ERROR);
+
+/* state */
+	if (PGM_UNLIKELY(!sock->is_bound ||
+			 sock->is_destroyed ||
+			 !sock->can_recv_data ||
+			 NULL != sock->engine_thread))
+	{
+		pgm_rwlock_reader_unlock (&sock->lock);
+		pgm_return_val_if_reached (PGM_IO_STATUS_ERROR);
+	}
+
+	const bool is_nonblocking = sock->is_nonblocking || (flags & MSG_DONTWAIT);
+	for (;;)
+	{
+/* sample before reading so that a leader's insert cannot be missed */
+		const uint32_t generation = pgm_atomic_exchange_and_add32 (&sock->rx_generation, 0);
+		pgm_peer_t* peer;
+
+		pgm_rwlock_reader_lock (&sock->peers_lock);
+		peer = pgm_hashtable_lookup (sock->peers_hashtable, tsi);
+		if (NULL != peer)
+			pgm_atomic_inc32 (&peer->ref_count);
+		pgm_rwlock_reader_unlock (&sock->peers_lock);
+		if (NULL != peer) {
+			pgm_mutex_lock (&peer->mutex);
+			status = read_peer (sock, peer, msg_start, msg_len, flags, &bytes_read, error);
+			pgm_mutex_unlock (&peer->mutex);
+			pgm_peer_unref (peer);
+			if (PGM_IO_STATUS_WOULD_BLOCK != status)
+				break;
+		}
+		if (PGM_UNLIKELY(sock->is_destroyed)) {
+			status = PGM_IO_STATUS_EOF;
+			break;
+		}
+
+		pgm_mutex_lock (&sock->receiver_mutex);
+		if (sock->has_rx_leader)
+		{
+			if (is_nonblocking) {
+				pgm_mutex_unlock (&sock->receiver_mutex);
+				status = PGM_IO_STATUS_WOULD_BLOCK;
+				break;
+			}
+			while (sock->has_rx_leader &&
+			       generation == sock->rx_generation &&
+			       !sock->is_destroyed)
+			{
+#ifndef _WIN32
+				pgm_cond_wait (&sock->rx_cond, &sock->receiver_mutex.pthread_mutex);
+#else
+				pgm_cond_wait (&sock->rx_cond, &sock->receiver_mutex.win32_crit);
+#endif
+			}
+			pgm_mutex_unlock (&sock->receiver_mutex);
+			continue;
+		}
+
+/* lead */
+		sock->has_rx_leader = TRUE;
+		status = service_peers (sock, error);
+		if (PGM_IO_STATUS_NORMAL == status ||
+		    PGM_IO_STATUS_ERROR  == status ||
+		    PGM_IO_STATUS_EOF    == status ||
+		    is_nonblocking)
+		{
+			sock->has_rx_leader = FALSE;
+			pgm_atomic_inc32 (&sock->rx_generation);
+			pgm_cond_broadcast (&sock->rx_cond);
+			pgm_mutex_unlock (&sock->receiver_mutex);
+			if (PGM_IO_STATUS_NORMAL == status)
+				continue;
+			break;
+		}
+
+/* block on the network without the mutex, followers remain parked */
+		pgm_mutex_unlock (&sock->receiver_mutex);
+		pgm_time_t now;
+		const int wait_status = wait_for_event (sock, &now);
+		pgm_mutex_lock (&sock->receiver_mutex);
+		sock->has_rx_leader = FALSE;
+		pgm_atomic_inc32 (&sock->rx_generation);
+		pgm_cond_broadcast (&sock->rx_cond);
+		pgm_mutex_unlock (&sock->receiver_mutex);
+		if (ENOENT == wait_status) {
+			status = PGM_IO_STATUS_EOF;
+			break;
+		} else if (EFAULT == wait_status) {
+			const int save_errno = pgm_get_last_sock_error();
+			char errbuf[1024];
+			pgm_set_error (error,
+					PGM_ERROR_DOMAIN_RECV,
+					pgm_error_from_sock_errno (save_errno),
+					_("Waiting for event: %s"),
+					pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno)
+					);
+			status = PGM_IO_STATUS_ERROR;
+			break;
+		}
+	}
+
+/* as pgm_recvmsgv(), only a source or known peers have timers outstanding */
+	if (PGM_IO_STATUS_WOULD_BLOCK == status &&
+	    ( sock->can_send_data ||
+	      ( sock->can_recv_data && NULL != sock->peers_list )))
+	{
+		status = PGM_IO_STATUS_TIMER_PENDING;
+	}
+	else if (PGM_IO_STATUS_NORMAL == status && NULL != _bytes_read)
+		*_bytes_read = bytes_read;
+	pgm_rwlock_reader_unlock (&sock->lock);
+	return status;
+}
+
 /* read one contiguous apdu and return as a IO scatter/gather array.  msgv is owned by
  * the caller, tpdu contents are owned by the receive window.
  *
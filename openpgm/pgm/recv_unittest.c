@@ -78,11 +78,15 @@ struct pgm_peer_t;
 
 GList* mock_recvmsg_list = NULL;
 static int mock_pgm_type = -1;
+static bool mock_is_redundant_line = FALSE;
 static gboolean mock_reset_on_spmr = FALSE;
 static gboolean mock_data_on_spmr = FALSE;
 static struct pgm_peer_t* mock_peer = NULL;
 GList* mock_data_list = NULL;
 unsigned mock_pgm_loss_rate = 0;
+static unsigned mock_timer_check_count = 0;
+static gboolean mock_is_retransmit_pending = FALSE;
+static int mock_deferred_nak_is_nonblocking = -1;
 
 
 #ifndef _WIN32
@@ -99,33 +103,45 @@ static int mock_recvfrom (SOCKET, char*, int, int, struct sockaddr*, int*);
 #define pgm_select_info			mock_pgm_select_info
 #define pgm_poll_info			mock_pgm_poll_info
 #define pgm_set_reset_error		mock_pgm_set_reset_error
+#define pgm_set_loss_notices		mock_pgm_set_loss_notices
 #define pgm_flush_peers_pending		mock_pgm_flush_peers_pending
 #define pgm_peer_has_pending		mock_pgm_peer_has_pending
 #define pgm_peer_set_pending		mock_pgm_peer_set_pending
 #define pgm_txw_retransmit_is_empty	mock_pgm_txw_retransmit_is_empty
 #define pgm_rxw_create			mock_pgm_rxw_create
 #define pgm_rxw_readv			mock_pgm_rxw_readv
+#define pgm_rxw_remove_commit		mock_pgm_rxw_remove_commit
+#define pgm_peer_unref			mock_pgm_peer_unref
 #define pgm_new_peer			mock_pgm_new_peer
 #define pgm_on_data			mock_pgm_on_data
 #define pgm_on_spm			mock_pgm_on_spm
 #define pgm_on_ack			mock_pgm_on_ack
 #define pgm_on_nak			mock_pgm_on_nak
 #define pgm_on_deferred_nak		mock_pgm_on_deferred_nak
+#define pgm_on_nak_flush		mock_pgm_on_nak_flush
 #define pgm_on_peer_nak			mock_pgm_on_peer_nak
 #define pgm_on_nnak			mock_pgm_on_nnak
 #define pgm_on_ncf			mock_pgm_on_ncf
 #define pgm_on_spmr			mock_pgm_on_spmr
+#define pgm_on_polr			mock_pgm_on_polr
+#define pgm_dlr_on_nak			mock_pgm_dlr_on_nak
 #define pgm_sendto			mock_pgm_sendto
 #define pgm_timer_prepare		mock_pgm_timer_prepare
 #define pgm_timer_check			mock_pgm_timer_check
 #define pgm_timer_expiration		mock_pgm_timer_expiration
 #define pgm_timer_dispatch		mock_pgm_timer_dispatch
+#define pgm_timer_arm		mock_pgm_timer_arm
 #define pgm_time_now			mock_pgm_time_now
 #define pgm_time_update_now		mock_pgm_time_update_now
 #define recvmsg				mock_recvmsg
 #define recvfrom			mock_recvfrom
 #define pgm_WSARecvMsg			mock_pgm_WSARecvMsg
 #define pgm_loss_rate			mock_pgm_loss_rate
+#define pgm_decoder_flush		mock_pgm_decoder_flush
+#define pgm_decoder_notify		mock_pgm_decoder_notify
+#define pgm_decoder_push		mock_pgm_decoder_push
+#define pgm_engine_thread_is_current	mock_pgm_engine_thread_is_current
+#define pgm_engine_thread_recvmsgv	mock_pgm_engine_thread_recvmsgv
 
 #define RECV_DEBUG
 #include "recv.c"
@@ -150,11 +166,15 @@ mock_teardown (void)
 {
 	mock_recvmsg_list = NULL;
 	mock_pgm_type = -1;
+	mock_is_redundant_line = FALSE;
+	mock_is_retransmit_pending = FALSE;
+	mock_deferred_nak_is_nonblocking = -1;
 	mock_reset_on_spmr = FALSE;
 	mock_data_on_spmr = FALSE;
 	mock_peer = NULL;
 	mock_data_list = NULL;
 	mock_pgm_loss_rate = 0;
+	mock_timer_check_count = 0;
 }
 
 static
@@ -657,6 +677,7 @@ mock_pgm_new_peer (
 	)
 {
 	pgm_peer_t* peer = g_malloc0 (sizeof(pgm_peer_t));
+	pgm_mutex_init (&peer->mutex);
 	peer->expiry = now + sock->peer_expiry;
 	memcpy (&peer->tsi, tsi, sizeof(pgm_tsi_t));
 	memcpy (&peer->group_nla, dst_addr, dst_addr_len);
@@ -680,6 +701,15 @@ mock_pgm_new_peer (
 	return peer;
 }
 
+PGM_GNUC_INTERNAL
+void
+mock_pgm_peer_unref (
+	pgm_peer_t*			peer
+	)
+{
+	pgm_atomic_dec32 (&peer->ref_count);
+}
+
 PGM_GNUC_INTERNAL
 void
 mock_pgm_set_reset_error (
@@ -690,6 +720,18 @@ mock_pgm_set_reset_error (
 {
 }
 
+PGM_GNUC_INTERNAL
+size_t
+mock_pgm_set_loss_notices (
+	pgm_sock_t* const		sock,
+	pgm_peer_t* const		source,
+	struct pgm_msgv_t* const	msgv,
+	const size_t			msg_len
+	)
+{
+	return 0;
+}
+
 PGM_GNUC_INTERNAL
 int
 mock_pgm_flush_peers_pending (
@@ -746,17 +788,70 @@ mock_pgm_peer_set_pending (
 	sock->peers_pending = &peer->pending_link;
 }
 
+/** decoder module */
+PGM_GNUC_INTERNAL
+bool
+mock_pgm_decoder_flush (
+	pgm_decoder_t* const		decoder
+	)
+{
+	return FALSE;
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_decoder_notify (
+	pgm_decoder_t* const		decoder
+	)
+{
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_decoder_push (
+	pgm_decoder_t* const		decoder,
+	pgm_peer_t* const		peer
+	)
+{
+}
+
+/** engine thread module */
+PGM_GNUC_INTERNAL
+bool
+mock_pgm_engine_thread_is_current (
+	const pgm_engine_thread_t* const	engine
+	)
+{
+	return TRUE;
+}
+
+PGM_GNUC_INTERNAL
+int
+mock_pgm_engine_thread_recvmsgv (
+	pgm_engine_thread_t* const	engine,
+	struct pgm_msgv_t* const	msg_start,
+	const size_t			msg_len,
+	const int			flags,
+	size_t*				bytes_read,
+	pgm_error_t**			error
+	)
+{
+	return PGM_IO_STATUS_ERROR;
+}
+
 PGM_GNUC_INTERNAL
 bool
 mock_pgm_on_data (
 	pgm_sock_t* const		sock,
 	pgm_peer_t* const		sender,
-	struct pgm_sk_buff_t* const	skb
+	struct pgm_sk_buff_t* const	skb,
+	const bool			is_redundant_line
 	)
 {
-	g_debug ("mock_pgm_on_data (sock:%p sender:%p skb:%p)",
-		(gpointer)sock, (gpointer)sender, (gpointer)skb);
+	g_debug ("mock_pgm_on_data (sock:%p sender:%p skb:%p is-redundant-line:%s)",
+		(gpointer)sock, (gpointer)sender, (gpointer)skb, is_redundant_line ? "TRUE" : "FALSE");
 	mock_pgm_type = PGM_ODATA;
+	mock_is_redundant_line = is_redundant_line;
 	((pgm_rxw_t*)sender->window)->has_event = 1;
 	return TRUE;
 }
@@ -777,21 +872,32 @@ mock_pgm_on_ack (
 PGM_GNUC_INTERNAL
 bool
 mock_pgm_on_deferred_nak (
-	pgm_sock_t* const		sock
+	pgm_sock_t* const		sock,
+	const bool			is_nonblocking
 	)
 {
+	mock_deferred_nak_is_nonblocking = is_nonblocking;
 	return TRUE;
 }
 
+PGM_GNUC_INTERNAL
+void
+mock_pgm_on_nak_flush (
+	pgm_sock_t* const		sock
+	)
+{
+}
+
 PGM_GNUC_INTERNAL
 bool
 mock_pgm_on_nak (
 	pgm_sock_t* const		sock,
-	struct pgm_sk_buff_t* const	skb
+	struct pgm_sk_buff_t* const	skb,
+	const struct sockaddr* const	from
 	)
 {
-	g_debug ("mock_pgm_on_nak (sock:%p skb:%p)",
-		(gpointer)sock, (gpointer)skb);
+	g_debug ("mock_pgm_on_nak (sock:%p skb:%p from:%p)",
+		(gpointer)sock, (gpointer)skb, (gpointer)from);
 	mock_pgm_type = PGM_NAK;
 	return TRUE;
 }
@@ -872,6 +978,37 @@ mock_pgm_on_spmr (
 	return TRUE;
 }
 
+PGM_GNUC_INTERNAL
+bool
+mock_pgm_on_polr (
+	pgm_sock_t* const		sock,
+	pgm_peer_t* const		peer,
+	struct pgm_sk_buff_t* const	skb,
+	const struct sockaddr* const	from
+	)
+{
+	g_debug ("mock_pgm_on_polr (sock:%p peer:%p skb:%p from:%p)",
+		(gpointer)sock, (gpointer)peer, (gpointer)skb, (gconstpointer)from);
+	mock_pgm_type = PGM_POLR;
+	return TRUE;
+}
+
+/** designated local repairer module */
+PGM_GNUC_INTERNAL
+bool
+mock_pgm_dlr_on_nak (
+	pgm_sock_t* const		sock,
+	pgm_peer_t* const		peer,
+	struct pgm_sk_buff_t* const	skb,
+	const struct sockaddr* const	from
+	)
+{
+	g_debug ("mock_pgm_dlr_on_nak (sock:%p peer:%p skb:%p from:%p)",
+		(gpointer)sock, (gpointer)peer, (gpointer)skb, (gconstpointer)from);
+	mock_pgm_type = PGM_NAK;
+	return TRUE;
+}
+
 /** transmit window */
 PGM_GNUC_INTERNAL
 bool
@@ -879,7 +1016,7 @@ mock_pgm_txw_retransmit_is_empty (
 	const pgm_txw_t*const	window
 	)
 {
-	return TRUE;
+	return !mock_is_retransmit_pending;
 }
 
 /** receive window */
@@ -906,6 +1043,14 @@ mock_pgm_rxw_readv (
 	return -1;
 }
 
+PGM_GNUC_INTERNAL
+void
+mock_pgm_rxw_remove_commit (
+	pgm_rxw_t* const	window
+	)
+{
+}
+
 /** net module */
 PGM_GNUC_INTERNAL
 ssize_t
@@ -935,16 +1080,19 @@ mock_pgm_timer_prepare (
 PGM_GNUC_INTERNAL
 bool
 mock_pgm_timer_check (
-	pgm_sock_t* const		sock
+	pgm_sock_t* const		sock,
+	const pgm_time_t		now
 	)
 {
+	mock_timer_check_count++;
 	return FALSE;
 }
 
 PGM_GNUC_INTERNAL
 pgm_time_t
 mock_pgm_timer_expiration (
-	pgm_sock_t* const		sock
+	pgm_sock_t* const		sock,
+	const pgm_time_t		now
 	)
 {
 	return 100L;
@@ -953,12 +1101,21 @@ mock_pgm_timer_expiration (
 PGM_GNUC_INTERNAL
 bool
 mock_pgm_timer_dispatch (
-	pgm_sock_t* const		sock
+	pgm_sock_t* const		sock,
+	const pgm_time_t		now
 	)
 {
 	return TRUE;
 }
 
+PGM_GNUC_INTERNAL
+void
+mock_pgm_timer_arm (
+	pgm_sock_t* const		sock
+	)
+{
+}
+
 /** time module */
 static pgm_time_t mock_pgm_time_now = 0x1;
 
@@ -1171,6 +1328,57 @@ START_TEST (test_data_pass_001)
 }
 END_TEST
 
+/* hot/hot feed sharing one TSI, data on the B line group */
+START_TEST (test_data_pass_002)
+{
+	const char source[] = "i am not a string";
+	pgm_sock_t* sock = generate_sock();
+	fail_if (NULL == sock, "generate_sock failed");
+	struct sockaddr_in grp_addr = {
+		.sin_family		= AF_INET,
+		.sin_addr.s_addr	= inet_addr(TEST_GROUP_ADDR)
+	};
+	memcpy (&sock->redundant_recv_gr.gr_group, &grp_addr, sizeof(grp_addr));
+	sock->use_redundant_group = TRUE;
+	guint8 buffer[ TEST_TXW_SQNS * TEST_MAX_TPDU ];
+	gpointer packet; gsize packet_len;
+	generate_odata (source, sizeof(source), 0 /* sqn */, -1 /* trail */, &packet, &packet_len);
+	generate_msghdr (packet, packet_len);
+	push_block_event ();
+	gsize bytes_read;
+	pgm_error_t* err = NULL;
+	fail_unless (PGM_IO_STATUS_TIMER_PENDING == pgm_recv (sock, buffer, sizeof(buffer), MSG_DONTWAIT, &bytes_read, &err), "recv failed");
+	fail_unless (PGM_ODATA == mock_pgm_type, "unexpected PGM packet");
+	fail_unless (TRUE == mock_is_redundant_line, "not redundant line");
+}
+END_TEST
+
+/* hot/hot feed sharing one TSI, data on the A line group */
+START_TEST (test_data_pass_003)
+{
+	const char source[] = "i am not a string";
+	pgm_sock_t* sock = generate_sock();
+	fail_if (NULL == sock, "generate_sock failed");
+	struct sockaddr_in grp_addr = {
+		.sin_family		= AF_INET,
+		.sin_addr.s_addr	= inet_addr("239.192.0.2")
+	};
+	memcpy (&sock->redundant_recv_gr.gr_group, &grp_addr, sizeof(grp_addr));
+	sock->use_redundant_group = TRUE;
+	mock_is_redundant_line = TRUE;
+	guint8 buffer[ TEST_TXW_SQNS * TEST_MAX_TPDU ];
+	gpointer packet; gsize packet_len;
+	generate_odata (source, sizeof(source), 0 /* sqn */, -1 /* trail */, &packet, &packet_len);
+	generate_msghdr (packet, packet_len);
+	push_block_event ();
+	gsize bytes_read;
+	pgm_error_t* err = NULL;
+	fail_unless (PGM_IO_STATUS_TIMER_PENDING == pgm_recv (sock, buffer, sizeof(buffer), MSG_DONTWAIT, &bytes_read, &err), "recv failed");
+	fail_unless (PGM_ODATA == mock_pgm_type, "unexpected PGM packet");
+	fail_unless (FALSE == mock_is_redundant_line, "redundant line");
+}
+END_TEST
+
 /* recv -> on_spm */
 START_TEST (test_spm_pass_001)
 {
@@ -1188,6 +1396,37 @@ START_TEST (test_spm_pass_001)
 }
 END_TEST
 
+/* timers are checked once per batch of packets on a non-blocking receive */
+static
+unsigned
+recv_spm_burst (
+	const unsigned		count
+	)
+{
+	pgm_sock_t* sock = generate_sock();
+	fail_if (NULL == sock, "generate_sock failed");
+	guint8 buffer[ TEST_TXW_SQNS * TEST_MAX_TPDU ];
+	for (unsigned i = 0; i < count; i++) {
+		gpointer packet; gsize packet_len;
+		generate_spm (200 + i /* spm-sqn */, -1 /* trail */, 0 /* lead */, &packet, &packet_len);
+		generate_msghdr (packet, packet_len);
+	}
+	push_block_event ();
+	gsize bytes_read;
+	pgm_error_t* err = NULL;
+	mock_timer_check_count = 0;
+	fail_unless (PGM_IO_STATUS_TIMER_PENDING == pgm_recv (sock, buffer, sizeof(buffer), MSG_DONTWAIT, &bytes_read, &err), "recv failed");
+	return mock_timer_check_count;
+}
+
+START_TEST (test_spm_pass_002)
+{
+	const unsigned checks = recv_spm_burst (PGM_RECV_TIMER_BATCH - 1);
+	fail_unless (checks + 1 == recv_spm_burst (PGM_RECV_TIMER_BATCH), "timer check failed");
+	fail_unless (checks + 1 == recv_spm_burst (PGM_RECV_TIMER_BATCH * 2 - 1), "timer check failed");
+}
+END_TEST
+
 /* recv -> on_nak */
 START_TEST (test_nak_pass_001)
 {
@@ -1569,6 +1808,28 @@ START_TEST (test_on_many_data_pass_001)
 }
 END_TEST
 
+/* target:
+ *	void
+ *	flush_nak_batch (
+ *		pgm_sock_t* const	sock
+ *		)
+ */
+
+/* repairs started under the receiver lock never wait on the rate limit */
+START_TEST (test_flush_nak_batch_pass_001)
+{
+	pgm_sock_t* sock = generate_sock();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->can_send_data = TRUE;
+	sock->is_nonblocking = FALSE;
+	flush_nak_batch (sock);
+	fail_unless (-1 == mock_deferred_nak_is_nonblocking, "repairs without retransmit queue");
+	mock_is_retransmit_pending = TRUE;
+	flush_nak_batch (sock);
+	fail_unless (TRUE == mock_deferred_nak_is_nonblocking, "repairs blocking");
+}
+END_TEST
+
 START_TEST (test_recv_fail_001)
 {
 	guint8 buffer[ TEST_TXW_SQNS * TEST_MAX_TPDU ];
@@ -1636,6 +1897,59 @@ START_TEST (test_recvmsgv_fail_001)
 }
 END_TEST
 
+/* target:
+ *	int
+ *	pgm_recvmsgv_tsi (
+ *		pgm_sock_t*	sock,
+ *		const pgm_tsi_t*	tsi,
+ *		pgm_msgv_t*		msgv,
+ *		unsigned		msgv_length,
+ *		int			flags,
+ *		size_t*			bytes_read,
+ *		pgm_error_t**		error
+ *		)
+ */
+
+/* no timers without a source or peers */
+START_TEST (test_recvmsgv_tsi_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->can_send_data = FALSE;
+	struct pgm_msgv_t msgv[1];
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	push_block_event ();
+	fail_unless (PGM_IO_STATUS_WOULD_BLOCK == pgm_recvmsgv_tsi (sock, &tsi, msgv, G_N_ELEMENTS(msgv), MSG_DONTWAIT, NULL, NULL), "recvmsgv_tsi failed");
+}
+END_TEST
+
+START_TEST (test_recvmsgv_tsi_pass_002)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	struct pgm_msgv_t msgv[1];
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	push_block_event ();
+	fail_unless (PGM_IO_STATUS_TIMER_PENDING == pgm_recvmsgv_tsi (sock, &tsi, msgv, G_N_ELEMENTS(msgv), MSG_DONTWAIT, NULL, NULL), "recvmsgv_tsi failed");
+}
+END_TEST
+
+START_TEST (test_recvmsgv_tsi_fail_001)
+{
+	struct pgm_msgv_t msgv[1];
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	fail_unless (PGM_IO_STATUS_ERROR == pgm_recvmsgv_tsi (NULL, &tsi, msgv, G_N_ELEMENTS(msgv), 0, NULL, NULL), "recvmsgv_tsi failed");
+}
+END_TEST
+
+START_TEST (test_recvmsgv_tsi_fail_002)
+{
+	pgm_sock_t* sock = generate_sock ();
+	struct pgm_msgv_t msgv[1];
+	fail_unless (PGM_IO_STATUS_ERROR == pgm_recvmsgv_tsi (sock, NULL, msgv, G_N_ELEMENTS(msgv), 0, NULL, NULL), "recvmsgv_tsi failed");
+}
+END_TEST
+
 
 static
 Suite*
@@ -1654,11 +1968,14 @@ make_test_suite (void)
 	suite_add_tcase (s, tc_data);
 	tcase_add_checked_fixture (tc_data, mock_setup, mock_teardown);
 	tcase_add_test (tc_data, test_data_pass_001);
+	tcase_add_test (tc_data, test_data_pass_002);
+	tcase_add_test (tc_data, test_data_pass_003);
 
 	TCase* tc_spm = tcase_create ("spm");
 	suite_add_tcase (s, tc_spm);
 	tcase_add_checked_fixture (tc_spm, mock_setup, mock_teardown);
 	tcase_add_test (tc_spm, test_spm_pass_001);
+	tcase_add_test (tc_spm, test_spm_pass_002);
 
 	TCase* tc_nak = tcase_create ("nak");
 	suite_add_tcase (s, tc_nak);
@@ -1725,6 +2042,11 @@ make_test_suite (void)
 	tcase_add_checked_fixture (tc_on_many_data, mock_setup, mock_teardown);
 	tcase_add_test (tc_on_many_data, test_on_many_data_pass_001);
 
+	TCase* tc_flush_nak_batch = tcase_create ("flush-nak-batch");
+	suite_add_tcase (s, tc_flush_nak_batch);
+	tcase_add_checked_fixture (tc_flush_nak_batch, mock_setup, mock_teardown);
+	tcase_add_test (tc_flush_nak_batch, test_flush_nak_batch_pass_001);
+
 	TCase* tc_recv = tcase_create ("recv");
 	suite_add_tcase (s, tc_recv);
 	tcase_add_checked_fixture (tc_recv, mock_setup, mock_teardown);
@@ -1745,6 +2067,14 @@ make_test_suite (void)
 	tcase_add_checked_fixture (tc_recvmsgv, mock_setup, mock_teardown);
 	tcase_add_test (tc_recvmsgv, test_recvmsgv_fail_001);
 
+	TCase* tc_recvmsgv_tsi = tcase_create ("recvmsgv-tsi");
+	suite_add_tcase (s, tc_recvmsgv_tsi);
+	tcase_add_checked_fixture (tc_recvmsgv_tsi, mock_setup, mock_teardown);
+	tcase_add_test (tc_recvmsgv_tsi, test_recvmsgv_tsi_pass_001);
+	tcase_add_test (tc_recvmsgv_tsi, test_recvmsgv_tsi_pass_002);
+	tcase_add_test (tc_recvmsgv_tsi, test_recvmsgv_tsi_fail_001);
+	tcase_add_test (tc_recvmsgv_tsi, test_recvmsgv_tsi_fail_002);
+
 	return s;
 }
 
@@ -72,10 +72,15 @@ static int _pgm_rxw_add_placeholder_range (pgm_rxw_t*const, const uint32_t, cons
 static void _pgm_rxw_unlink (pgm_rxw_t*const restrict, struct pgm_sk_buff_t*const restrict);
 static uint32_t _pgm_rxw_remove_trail (pgm_rxw_t*const);
 static void _pgm_rxw_state (pgm_rxw_t*const restrict, struct pgm_sk_buff_t*const restrict, const int);
-static inline void _pgm_rxw_shuffle_parity (pgm_rxw_t*const restrict, struct pgm_sk_buff_t*const restrict);
+static inline struct pgm_sk_buff_t* _pgm_rxw_shuffle_parity (pgm_rxw_t*const restrict, struct pgm_sk_buff_t*const restrict);
 static inline ssize_t _pgm_rxw_incoming_read (pgm_rxw_t*const restrict, struct pgm_msgv_t**restrict, uint32_t);
 static bool _pgm_rxw_is_apdu_complete (pgm_rxw_t*const, const uint32_t);
+static bool _pgm_rxw_commit_lead_reconstruct (pgm_rxw_t*const);
+static bool _pgm_rxw_has_parity (pgm_rxw_t*const, const uint32_t);
 static inline ssize_t _pgm_rxw_incoming_read_apdu (pgm_rxw_t*const restrict, struct pgm_msgv_t**restrict);
+static ssize_t _pgm_rxw_incoming_read_unordered (pgm_rxw_t*const restrict, struct pgm_msgv_t**restrict, unsigned);
+static inline ssize_t _pgm_rxw_unordered_read_apdu (pgm_rxw_t*const restrict, const uint32_t, struct pgm_msgv_t**restrict);
+static void _pgm_rxw_add_loss (pgm_rxw_t*const, const uint32_t, const uint32_t);
 static inline int _pgm_rxw_recovery_update (pgm_rxw_t*const, const uint32_t, const pgm_time_t);
 static inline int _pgm_rxw_recovery_append (pgm_rxw_t*const, const pgm_time_t, const pgm_time_t);
 
@@ -165,6 +170,28 @@ _pgm_rxw_incoming_is_empty (
 	return (_pgm_rxw_incoming_length (window) == 0);
 }
 
+/* with unordered delivery buffers ahead of the commit-lead may also be held by
+ * the application, a delivered trail cannot be purged until committed.
+ */
+
+static inline
+bool
+_pgm_rxw_is_trail_held (
+	const pgm_rxw_t* const	window
+	)
+{
+	const struct pgm_sk_buff_t* skb;
+
+	pgm_assert (NULL != window);
+
+	if (!_pgm_rxw_commit_is_empty (window))
+		return TRUE;
+	if (!window->is_unordered || pgm_rxw_is_empty (window))
+		return FALSE;
+	skb = _pgm_rxw_peek (window, window->trail);
+	return (NULL != skb && ((const pgm_rxw_state_t*)&skb->cb)->is_delivered);
+}
+
 /* constructor for receive window.  zero-length windows are not permitted.
  *
  * returns pointer to window.
@@ -253,6 +280,12 @@ pgm_rxw_destroy (
 
 	pgm_debug ("destroy (window:%p)", (const void*)window);
 
+/* undispatched parity recovery */
+	while (window->decode_list) {
+		pgm_rxw_decode_free (window->decode_list->data);
+		window->decode_list = pgm_slist_remove_first (window->decode_list);
+	}
+
 /* contents of window */
 	while (!pgm_rxw_is_empty (window)) {
 		_pgm_rxw_remove_trail (window);
@@ -264,6 +297,10 @@ pgm_rxw_destroy (
 	pgm_assert (pgm_rxw_is_empty (window));
 	pgm_assert (!pgm_rxw_is_full (window));
 
+/* FEC matrices from the first parity announcement */
+	if (window->is_fec_available)
+		pgm_rs_destroy (&window->rs);
+
 /* window */
 	pgm_free (window);
 }
@@ -366,6 +403,14 @@ pgm_rxw_add (
 		if (pgm_uint32_lt (_pgm_rxw_tg_sqn (window, skb->sequence), _pgm_rxw_tg_sqn (window, window->commit_lead)))
 			return PGM_RXW_DUPLICATE;
 
+/* originals of a group straddling the trail are gone, nothing to decode against */
+		if (pgm_uint32_lt (_pgm_rxw_tg_sqn (window, skb->sequence), window->trail))
+			return PGM_RXW_BOUNDS;
+
+/* a repeated parity index adds nothing to the decode */
+		if (_pgm_rxw_has_parity (window, skb->sequence))
+			return PGM_RXW_DUPLICATE;
+
 		if (pgm_uint32_lt (_pgm_rxw_tg_sqn (window, skb->sequence), _pgm_rxw_tg_sqn (window, window->lead))) {
 			window->has_event = 1;
 			return _pgm_rxw_insert (window, skb);
@@ -376,6 +421,9 @@ pgm_rxw_add (
 
 		if (_pgm_rxw_tg_sqn (window, skb->sequence) == _pgm_rxw_tg_sqn (window, window->lead)) {
 			window->has_event = 1;
+/* no slot left to append into once the lead closes the group */
+			if (_pgm_rxw_is_last_of_tg_sqn (window, window->lead))
+				return _pgm_rxw_insert (window, skb);
 			if (NULL == first_state || first_state->is_contiguous) {
 				state->is_contiguous = 1;
 				return _pgm_rxw_append (window, skb, now);
@@ -541,6 +589,8 @@ _pgm_rxw_update_trail (
  */
 		window->data_loss = pgm_fp16mul (window->data_loss, pgm_fp16pow (pgm_fp16 (1) - window->ack_c_p, distance));
 
+		if (window->is_unordered)
+			_pgm_rxw_add_loss (window, window->trail - distance, distance);
 		window->cumulative_losses += distance;
 		pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Data loss due to trailing edge update, fragment count %" PRIu32 "."),window->fragment_count);
 		pgm_assert (pgm_rxw_is_empty (window));
@@ -607,6 +657,61 @@ pgm_rxw_update_fec (
 	window->tg_size = window->rs.k;
 }
 
+/* record data arriving on one line of a hot/hot feed, both lines deliver
+ * into the one window and duplicates are discarded by pgm_rxw_add().
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_rxw_update_line (
+	pgm_rxw_t* const	window,
+	const unsigned		line,
+	const uint32_t		sequence,
+	const pgm_time_t	now
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert_cmpuint (line, <, PGM_RXW_LINES);
+
+	if (0 == window->line_tstamp[ line ] ||
+	    pgm_uint32_gt (sequence, window->line_lead[ line ]))
+		window->line_lead[ line ] = sequence;
+	window->line_tstamp[ line ] = now;
+}
+
+/* a loss is only certain once every line has passed the sequence, a line that
+ * has delivered since live_after and not reached the sequence may yet fill it.
+ * a gap no line has passed, e.g. learnt from an SPM, is missing on all lines.
+ *
+ * returns TRUE if the NAK for sequence should wait on a lagging line.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_rxw_is_line_pending (
+	const pgm_rxw_t* const	window,
+	const uint32_t		sequence,
+	const pgm_time_t	live_after
+	)
+{
+	bool is_passed = FALSE, is_lagging = FALSE;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+
+	for (unsigned i = 0; i < PGM_RXW_LINES; i++)
+	{
+		if (0 == window->line_tstamp[ i ])
+			return FALSE;
+		if (pgm_uint32_gte (window->line_lead[ i ], sequence))
+			is_passed = TRUE;
+		else if (pgm_time_after (window->line_tstamp[ i ], live_after))
+			is_lagging = TRUE;
+	}
+	return is_passed && is_lagging;
+}
+
 /* add one placeholder to leading edge due to detected lost packet.
  */
 
@@ -683,7 +788,7 @@ _pgm_rxw_add_placeholder_range (
 
 /* check bounds of commit window */
 	const uint32_t new_commit_sqns = ( 1 + sequence ) - window->trail;
-        if ( !_pgm_rxw_commit_is_empty (window) &&
+        if ( _pgm_rxw_is_trail_held (window) &&
 	     (new_commit_sqns >= pgm_rxw_max_length (window)) )
         {
 		_pgm_rxw_update_lead (window, sequence, now, nak_rb_expiry);
@@ -704,6 +809,8 @@ _pgm_rxw_add_placeholder_range (
 		_pgm_rxw_add_placeholder (window, now, nak_rb_expiry);
 		if (pgm_rxw_is_full (window)) {
 			pgm_assert (_pgm_rxw_commit_is_empty (window));
+			if (PGM_UNLIKELY(_pgm_rxw_is_trail_held (window)))
+				return PGM_RXW_BOUNDS;		/* unordered delivery */
 			pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Receive window full on placeholder sequence."));
 			_pgm_rxw_remove_trail (window);
 		}
@@ -740,7 +847,7 @@ _pgm_rxw_update_lead (
 		return 0;
 
 /* committed packets limit constrain the lead until they are released */
-	if (!_pgm_rxw_commit_is_empty (window) &&
+	if (_pgm_rxw_is_trail_held (window) &&
 	    (txw_lead - window->trail) >= pgm_rxw_max_length (window))
 	{
 		lead = window->trail + pgm_rxw_max_length (window) - 1;
@@ -756,6 +863,8 @@ _pgm_rxw_update_lead (
 /* slow consumer or fast producer */
 		if (pgm_rxw_is_full (window)) {
 			pgm_assert (_pgm_rxw_commit_is_empty (window));
+			if (PGM_UNLIKELY(_pgm_rxw_is_trail_held (window)))
+				break;				/* unordered delivery */
 			pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Receive window full on window lead advancement."));
 			_pgm_rxw_remove_trail (window);
 		}
@@ -825,10 +934,12 @@ _pgm_rxw_find_missing (
 /* pre-conditions */
 	pgm_assert (NULL != window);
 
-	for (uint32_t i = tg_sqn, j = 0; j < window->tg_size; i++, j++)
+/* scan from the group lead, the group may extend beyond the window lead */
+	for (uint32_t i = _pgm_rxw_tg_sqn (window, tg_sqn), j = 0; j < window->tg_size; i++, j++)
 	{
 		skb = _pgm_rxw_peek (window, i);
-		pgm_assert (NULL != skb);
+		if (NULL == skb)
+			break;
 		state = (pgm_rxw_state_t*)&skb->cb;
 		switch (state->pkt_state) {
 		case PGM_PKT_STATE_BACK_OFF:
@@ -839,6 +950,7 @@ _pgm_rxw_find_missing (
 
 		case PGM_PKT_STATE_HAVE_DATA:
 		case PGM_PKT_STATE_HAVE_PARITY:
+		case PGM_PKT_STATE_COMMIT_DATA:
 			break;
 
 		default: pgm_assert_not_reached(); break;
@@ -848,9 +960,37 @@ _pgm_rxw_find_missing (
 	return NULL;
 }
 
+/* returns the first original data packet held for the transmission group of
+ * sequence, NULL if none has arrived.
+ */
+
+static
+const struct pgm_sk_buff_t*
+_pgm_rxw_tg_data (
+	pgm_rxw_t* const	window,
+	const uint32_t		sequence
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != window);
+
+	for (uint32_t i = _pgm_rxw_tg_sqn (window, sequence), j = 0; j < window->tg_size; i++, j++)
+	{
+		const struct pgm_sk_buff_t* skb = _pgm_rxw_peek (window, i);
+		if (NULL == skb)
+			break;
+		const pgm_rxw_state_t* state = (const pgm_rxw_state_t*)&skb->cb;
+		if (PGM_PKT_STATE_HAVE_DATA == state->pkt_state ||
+		    PGM_PKT_STATE_COMMIT_DATA == state->pkt_state)
+			return skb;
+	}
+	return NULL;
+}
+
 /* returns TRUE if skb is a parity packet with packet length not
  * matching the transmission group length without the variable-packet-length
- * flag set.
+ * flag set.  original data is free to vary in length, the source flags the
+ * parity instead.
  */
 
 static inline
@@ -860,7 +1000,7 @@ _pgm_rxw_is_invalid_var_pktlen (
 	const struct pgm_sk_buff_t* const restrict skb
 	)
 {
-	const struct pgm_sk_buff_t* first_skb;
+	const struct pgm_sk_buff_t* data_skb;
 
 /* pre-conditions */
 	pgm_assert (NULL != window);
@@ -868,18 +1008,17 @@ _pgm_rxw_is_invalid_var_pktlen (
 	if (!window->is_fec_available)
 		return FALSE;
 
-	if (skb->pgm_header->pgm_options & PGM_OPT_VAR_PKTLEN)
+	if (!(skb->pgm_header->pgm_options & PGM_OPT_PARITY) ||
+	    skb->pgm_header->pgm_options & PGM_OPT_VAR_PKTLEN)
 		return FALSE;
 
+/* group began before parity was announced and is partly released */
 	const uint32_t tg_sqn = _pgm_rxw_tg_sqn (window, skb->sequence);
-	if (tg_sqn == skb->sequence)
+	if (pgm_uint32_lt (tg_sqn, window->trail))
 		return FALSE;
 
-	first_skb = _pgm_rxw_peek (window, tg_sqn);
-	if (NULL == first_skb)
-		return TRUE;	/* transmission group unrecoverable */
-
-	if (first_skb->len == skb->len)
+	data_skb = _pgm_rxw_tg_data (window, tg_sqn);
+	if (NULL == data_skb || data_skb->len == skb->len)
 		return FALSE;
 
 	return TRUE;
@@ -898,7 +1037,34 @@ _pgm_rxw_has_payload_op (
 	return skb->pgm_opt_fragment || skb->pgm_header->pgm_options & PGM_OP_ENCODED;
 }
 
-/* returns TRUE is skb options are invalid when compared to the transmission group
+/* returns TRUE if the transmission group holds parity of the same index.
+ */
+
+static
+bool
+_pgm_rxw_has_parity (
+	pgm_rxw_t* const	window,
+	const uint32_t		parity_sqn	/* tg_sqn | rs_h */
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != window);
+
+	for (uint32_t i = _pgm_rxw_tg_sqn (window, parity_sqn), j = 0; j < window->tg_size; i++, j++)
+	{
+		const struct pgm_sk_buff_t* skb = _pgm_rxw_peek (window, i);
+		if (NULL == skb)
+			break;
+		const pgm_rxw_state_t* state = (const pgm_rxw_state_t*)&skb->cb;
+		if (PGM_PKT_STATE_HAVE_PARITY == state->pkt_state &&
+		    pgm_ntohl (skb->pgm_data->data_sqn) == parity_sqn)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* returns TRUE if skb is a parity packet without encoded options whilst the
+ * transmission group carries fragment options.
  */
 
 static inline
@@ -908,8 +1074,6 @@ _pgm_rxw_is_invalid_payload_op (
 	const struct pgm_sk_buff_t* const restrict skb
 	)
 {
-	const struct pgm_sk_buff_t* first_skb;
-
 /* pre-conditions */
 	pgm_assert (NULL != window);
 	pgm_assert (NULL != skb);
@@ -917,18 +1081,27 @@ _pgm_rxw_is_invalid_payload_op (
 	if (!window->is_fec_available)
 		return FALSE;
 
-	const uint32_t tg_sqn = _pgm_rxw_tg_sqn (window, skb->sequence);
-	if (tg_sqn == skb->sequence)
+	if (!(skb->pgm_header->pgm_options & PGM_OPT_PARITY) ||
+	    _pgm_rxw_has_payload_op (skb))
 		return FALSE;
 
-	first_skb = _pgm_rxw_peek (window, tg_sqn);
-	if (NULL == first_skb)
-		return TRUE;	/* transmission group unrecoverable */
-
-	if (_pgm_rxw_has_payload_op (first_skb) == _pgm_rxw_has_payload_op (skb))
+/* group began before parity was announced and is partly released */
+	const uint32_t tg_sqn = _pgm_rxw_tg_sqn (window, skb->sequence);
+	if (pgm_uint32_lt (tg_sqn, window->trail))
 		return FALSE;
 
-	return TRUE;
+	for (uint32_t i = tg_sqn, j = 0; j < window->tg_size; i++, j++)
+	{
+		const struct pgm_sk_buff_t* data_skb = _pgm_rxw_peek (window, i);
+		if (NULL == data_skb)
+			break;
+		const pgm_rxw_state_t* state = (const pgm_rxw_state_t*)&data_skb->cb;
+		if ((PGM_PKT_STATE_HAVE_DATA == state->pkt_state ||
+		     PGM_PKT_STATE_COMMIT_DATA == state->pkt_state) &&
+		    _pgm_rxw_has_payload_op (data_skb))
+			return TRUE;
+	}
+	return FALSE;
 }
 
 /* insert skb into window range, discard if duplicate.  window will have placeholder,
@@ -965,6 +1138,8 @@ _pgm_rxw_insert (
 		skb = _pgm_rxw_find_missing (window, new_skb->sequence);
 		if (NULL == skb)
 			return PGM_RXW_DUPLICATE;
+/* parity takes the sequence of the hole it fills */
+		new_skb->sequence = skb->sequence;
 		state = (pgm_rxw_state_t*)&skb->cb;
 	}
 	else
@@ -994,7 +1169,8 @@ _pgm_rxw_insert (
 		break;
 
 	case PGM_PKT_STATE_HAVE_PARITY:
-		_pgm_rxw_shuffle_parity (window, skb);
+		skb = _pgm_rxw_shuffle_parity (window, skb);
+		state = (pgm_rxw_state_t*)&skb->cb;
 		break;
 
 	default: pgm_assert_not_reached(); break;
@@ -1006,6 +1182,8 @@ _pgm_rxw_insert (
 	PGM_HISTOGRAM_COUNTS("Rx.NakTransmits", state->nak_transmit_count);
 	PGM_HISTOGRAM_COUNTS("Rx.NcfRetries", state->ncf_retry_count);
 	PGM_HISTOGRAM_COUNTS("Rx.DataRetries", state->data_retry_count);
+	if (state->nak_transmit_count && pgm_time_after_eq (new_skb->tstamp, state->nak_tstamp))
+		pgm_latency_record (&window->repair_latency, new_skb->tstamp - state->nak_tstamp);
 	if (!window->max_fill_time) {
 		window->max_fill_time = window->min_fill_time = fill_time;
 	}
@@ -1046,6 +1224,7 @@ _pgm_rxw_insert (
 	state = (void*)new_skb->cb;
 	state->pkt_state = PGM_PKT_STATE_ERROR;
 	_pgm_rxw_unlink (window, skb);
+	window->size -= skb->len;		/* parity payload */
 	pgm_free_skb (skb);
 	const uint_fast32_t index_ = new_skb->sequence % pgm_rxw_max_length (window);
 	window->pdata[index_] = new_skb;
@@ -1058,18 +1237,18 @@ _pgm_rxw_insert (
 	return PGM_RXW_INSERTED;
 }
 
-/* shuffle parity packet at skb->sequence to any other needed spot.
+/* shuffle parity packet at skb->sequence to any other needed spot, the
+ * placeholder of that spot is returned in its place.
  */
 
 static inline
-void
+struct pgm_sk_buff_t*
 _pgm_rxw_shuffle_parity (
 	pgm_rxw_t*	      const restrict window,
 	struct pgm_sk_buff_t* const restrict skb
 	)
 {
 	struct pgm_sk_buff_t* restrict missing;
-	char cb[48];
 
 /* pre-conditions */
 	pgm_assert (NULL != window);
@@ -1077,17 +1256,18 @@ _pgm_rxw_shuffle_parity (
 
 	missing = _pgm_rxw_find_missing (window, skb->sequence);
 	if (NULL == missing)
-		return;
+		return skb;
 
-/* replace place holder skb with parity skb */
+/* exchange sequences and slots, the parity skb keeps its own payload */
 	_pgm_rxw_unlink (window, missing);
-	memcpy (cb, skb->cb, sizeof(skb->cb));
-	memcpy (skb->cb, missing->cb, sizeof(skb->cb));
-	memcpy (missing->cb, cb, sizeof(skb->cb));
-	const uint32_t parity_index = skb->sequence % pgm_rxw_max_length (window);
-	window->pdata[parity_index] = skb;
-	const uint32_t missing_index = missing->sequence % pgm_rxw_max_length (window);
-	window->pdata[missing_index] = missing;
+	_pgm_rxw_unlink (window, skb);
+	const uint32_t parity_sequence = skb->sequence;
+	skb->sequence = missing->sequence;
+	missing->sequence = parity_sequence;
+	window->pdata[skb->sequence % pgm_rxw_max_length (window)] = skb;
+	window->pdata[missing->sequence % pgm_rxw_max_length (window)] = missing;
+	_pgm_rxw_state (window, skb, PGM_PKT_STATE_HAVE_PARITY);
+	return missing;
 }
 
 /* skb advances the window lead.
@@ -1110,7 +1290,9 @@ _pgm_rxw_append (
 	pgm_assert (NULL != window);
 	pgm_assert (NULL != skb);
 	if (skb->pgm_header->pgm_options & PGM_OPT_PARITY) {
-		pgm_assert (_pgm_rxw_tg_sqn (window, skb->sequence) == _pgm_rxw_tg_sqn (window, pgm_rxw_lead (window)));
+		pgm_assert (_pgm_rxw_tg_sqn (window, skb->sequence) == _pgm_rxw_tg_sqn (window, pgm_rxw_next_lead (window)));
+/* parity stands in for the next original packet of the group */
+		skb->sequence = pgm_rxw_next_lead (window);
 	} else {
 		pgm_assert (skb->sequence == pgm_rxw_next_lead (window));
 	}
@@ -1120,7 +1302,7 @@ _pgm_rxw_append (
 		return PGM_RXW_MALFORMED;
 
 	if (pgm_rxw_is_full (window)) {
-		if (_pgm_rxw_commit_is_empty (window)) {
+		if (!_pgm_rxw_is_trail_held (window)) {
 			pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Receive window full on new data."));
 			_pgm_rxw_remove_trail (window);
 		} else {
@@ -1178,7 +1360,7 @@ _pgm_rxw_append (
 }
 
 /* remove references to all commit packets not in the same transmission group
- * as the commit-lead
+ * as the commit-lead, or all of them once the commit-lead is declared lost.
  */
 
 PGM_GNUC_INTERNAL
@@ -1197,6 +1379,16 @@ pgm_rxw_remove_commit (
 	{
 		_pgm_rxw_remove_trail (window);
 	}
+
+/* the group cannot complete in order, stop holding the trail for parity */
+	if (!_pgm_rxw_commit_is_empty (window) &&
+	    !_pgm_rxw_incoming_is_empty (window))
+	{
+		const struct pgm_sk_buff_t* skb = _pgm_rxw_peek (window, window->commit_lead);
+		if (PGM_PKT_STATE_LOST_DATA == ((const pgm_rxw_state_t*)&skb->cb)->pkt_state)
+			while (!_pgm_rxw_commit_is_empty (window))
+				_pgm_rxw_remove_trail (window);
+	}
 }
 
 /* flush packets but instead of calling on_data append the contiguous data packets
@@ -1247,6 +1439,13 @@ pgm_rxw_readv (
 		bytes_read = _pgm_rxw_incoming_read (window, pmsg, (unsigned)(msg_end - *pmsg + 1));
 		break;
 
+	case PGM_PKT_STATE_HAVE_PARITY:
+		if (_pgm_rxw_commit_lead_reconstruct (window))
+			bytes_read = _pgm_rxw_incoming_read (window, pmsg, (unsigned)(msg_end - *pmsg + 1));
+		else
+			bytes_read = -1;
+		break;
+
 	case PGM_PKT_STATE_LOST_DATA:
 /* do not purge in situ sequence */
 		if (_pgm_rxw_commit_is_empty (window)) {
@@ -1260,7 +1459,6 @@ pgm_rxw_readv (
 	case PGM_PKT_STATE_BACK_OFF:
 	case PGM_PKT_STATE_WAIT_NCF:
 	case PGM_PKT_STATE_WAIT_DATA:
-	case PGM_PKT_STATE_HAVE_PARITY:
 		bytes_read = -1;
 		break;
 
@@ -1271,6 +1469,16 @@ pgm_rxw_readv (
 		break;
 	}
 
+/* continue with complete APDUs beyond any gap in the sequence */
+	if (window->is_unordered &&
+	    *pmsg <= msg_end &&
+	    !_pgm_rxw_incoming_is_empty (window))
+	{
+		const ssize_t unordered_read = _pgm_rxw_incoming_read_unordered (window, pmsg, (unsigned)(msg_end - *pmsg + 1));
+		if (unordered_read >= 0)
+			bytes_read = (bytes_read < 0) ? unordered_read : bytes_read + unordered_read;
+	}
+
 	return bytes_read;
 }
 
@@ -1295,6 +1503,7 @@ _pgm_rxw_remove_trail (
 
 	skb = _pgm_rxw_peek (window, window->trail);
 	pgm_assert (NULL != skb);
+	const bool is_delivered = ((const pgm_rxw_state_t*)&skb->cb)->is_delivered;
 	_pgm_rxw_unlink (window, skb);
 	window->size -= skb->len;
 /* remove reference to skb */
@@ -1304,8 +1513,16 @@ _pgm_rxw_remove_trail (
 	}
 	pgm_free_skb (skb);
 	if (window->trail++ == window->commit_lead) {
-/* data-loss */
 		window->commit_lead++;
+/* unordered delivery may now hold the trail, prompt a commit */
+		if (window->is_unordered)
+			window->has_event = 1;
+/* passed to application by unordered delivery */
+		if (is_delivered)
+			return 0;
+/* data-loss */
+		if (window->is_unordered)
+			_pgm_rxw_add_loss (window, window->trail - 1, 1);
 		window->cumulative_losses++;
 		pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Data loss due to pulled trailing edge, fragment count %" PRIu32 "."),window->fragment_count);
 		return 1;
@@ -1342,6 +1559,7 @@ _pgm_rxw_incoming_read (
 {
 	const struct pgm_msgv_t* msg_end;
 	struct pgm_sk_buff_t* skb;
+	pgm_rxw_state_t* state;
 	ssize_t bytes_read = 0;
 	size_t  data_read  = 0;
 
@@ -1358,8 +1576,19 @@ _pgm_rxw_incoming_read (
 	do {
 		skb = _pgm_rxw_peek (window, window->commit_lead);
 		pgm_assert (NULL != skb);
+		state = (pgm_rxw_state_t*)&skb->cb;
+/* already passed to the application by unordered delivery, commit silently */
+		if (state->is_delivered &&
+		    PGM_PKT_STATE_HAVE_DATA == state->pkt_state)
+		{
+			_pgm_rxw_state (window, skb, PGM_PKT_STATE_COMMIT_DATA);
+			window->commit_lead++;
+			continue;
+		}
+/* only original data carries a meaningful fragment header */
 		if (_pgm_rxw_is_apdu_complete (window,
-					      skb->pgm_opt_fragment ? pgm_ntohl (skb->of_apdu_first_sqn) : skb->sequence))
+					      PGM_PKT_STATE_HAVE_DATA == state->pkt_state && skb->pgm_opt_fragment ?
+						pgm_ntohl (skb->of_apdu_first_sqn) : window->commit_lead))
 		{
 			bytes_read += _pgm_rxw_incoming_read_apdu (window, pmsg);
 			data_read  ++;
@@ -1375,6 +1604,94 @@ _pgm_rxw_incoming_read (
 	return data_read > 0 ? bytes_read : -1;
 }
 
+/* read complete APDUs from the incoming window beyond the first incomplete
+ * APDU.  buffers remain in the window tagged as delivered and are committed
+ * once the commit-lead reaches them, missing sequences continue recovery
+ * and are read when repaired or declared lost.
+ *
+ * returns count of bytes read, -1 on nothing read.
+ */
+
+static
+ssize_t
+_pgm_rxw_incoming_read_unordered (
+	pgm_rxw_t*    const restrict window,
+	struct pgm_msgv_t** restrict pmsg,		/* message array, updated as messages appended */
+	unsigned		     pmsglen		/* number of items in pmsg */
+	)
+{
+	const struct pgm_msgv_t* msg_end;
+	struct pgm_sk_buff_t* skb;
+	pgm_rxw_state_t* state;
+	ssize_t bytes_read = 0;
+	size_t  data_read  = 0;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert (NULL != pmsg);
+	pgm_assert_cmpuint (pmsglen, >, 0);
+	pgm_assert (window->is_unordered);
+
+	pgm_debug ("_pgm_rxw_incoming_read_unordered (window:%p pmsg:%p pmsglen:%u)",
+		 (void*)window, (void*)pmsg, pmsglen);
+
+	msg_end = *pmsg + pmsglen - 1;
+	if (pgm_uint32_lt (window->unordered_lead, window->commit_lead))
+		window->unordered_lead = window->commit_lead;
+
+/* scan position may be rewound by reconstruction whilst reading */
+	while (*pmsg <= msg_end &&
+	       pgm_uint32_lte (window->unordered_lead, window->lead))
+	{
+		const uint32_t sequence = window->unordered_lead++;
+		skb = _pgm_rxw_peek (window, sequence);
+		pgm_assert (NULL != skb);
+		state = (pgm_rxw_state_t*)&skb->cb;
+		if (PGM_PKT_STATE_HAVE_DATA != state->pkt_state || state->is_delivered)
+			continue;
+/* APDUs are only read from the first fragment */
+		if (skb->pgm_opt_fragment && pgm_ntohl (skb->of_apdu_first_sqn) != sequence)
+			continue;
+		if (_pgm_rxw_is_apdu_complete (window, sequence))
+		{
+			bytes_read += _pgm_rxw_unordered_read_apdu (window, sequence, pmsg);
+			data_read  ++;
+		}
+	}
+
+	window->bytes_delivered += (uint32_t) bytes_read;
+	window->msgs_delivered  += (uint32_t) data_read;
+	return data_read > 0 ? bytes_read : -1;
+}
+
+/* rewind unordered scan position to re-test the APDU or transmission group
+ * containing a newly available sequence.
+ */
+
+static inline
+void
+_pgm_rxw_unordered_rewind (
+	pgm_rxw_t*	      const restrict window,
+	struct pgm_sk_buff_t* const restrict skb
+	)
+{
+	uint32_t sequence;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert (NULL != skb);
+
+	if (skb->pgm_header->pgm_options & PGM_OPT_PARITY)
+		sequence = _pgm_rxw_tg_sqn (window, skb->sequence);
+	else if (skb->pgm_opt_fragment)
+		sequence = pgm_ntohl (skb->of_apdu_first_sqn);
+	else
+		sequence = skb->sequence;
+
+	if (pgm_uint32_lt (sequence, window->unordered_lead))
+		window->unordered_lead = sequence;
+}
+
 /* returns TRUE if transmission group is lost.
  *
  * checking is lightly limited to bounds.
@@ -1400,21 +1717,58 @@ _pgm_rxw_is_tg_sqn_lost (
 	return FALSE;
 }
 
-/* reconstruct missing sequences in a transmission group using embedded parity data.
+/* returns TRUE if the transmission group holds at least k original data or
+ * parity packets, enough to reconstruct every missing sequence.
  */
 
 static
-void
-_pgm_rxw_reconstruct (
+bool
+_pgm_rxw_is_tg_sqn_recoverable (
 	pgm_rxw_t* const	window,
 	const uint32_t		tg_sqn		/* transmission group sequence */
 	)
 {
-	struct pgm_sk_buff_t	*skb;
+	unsigned available = 0;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert_cmpuint (_pgm_rxw_pkt_sqn (window, tg_sqn), ==, 0);
+
+	for (uint32_t i = tg_sqn, j = 0; j < window->tg_size; i++, j++)
+	{
+		const struct pgm_sk_buff_t* skb = _pgm_rxw_peek (window, i);
+		if (NULL == skb)
+			return FALSE;
+		const pgm_rxw_state_t* state = (const pgm_rxw_state_t*)&skb->cb;
+		switch (state->pkt_state) {
+		case PGM_PKT_STATE_COMMIT_DATA:
+		case PGM_PKT_STATE_HAVE_DATA:
+		case PGM_PKT_STATE_HAVE_PARITY:
+			++available;
+			break;
+		default: break;
+		}
+	}
+	return available >= window->tg_size;
+}
+
+/* take a transmission group from the window for parity recovery.  every packet
+ * in the group is referenced so that the decode survives the window advancing,
+ * each missing sequence is allocated a zeroed skb to receive the recovered data.
+ *
+ * returns NULL if original data is longer than the group parity.
+ */
+
+static
+pgm_rxw_decode_t*
+_pgm_rxw_decode_new (
+	pgm_rxw_t* const	window,
+	const uint32_t		tg_sqn		/* transmission group sequence */
+	)
+{
+	pgm_rxw_decode_t	*decode;
+	struct pgm_sk_buff_t	*skb, *tg_skb;
 	pgm_rxw_state_t		*state;
-	struct pgm_sk_buff_t   **tg_skbs;
-	pgm_gf8_t	       **tg_data, **tg_opts;
-	uint8_t			*offsets;
 	uint8_t			 rs_h = 0;
 
 /* pre-conditions */
@@ -1422,38 +1776,79 @@ _pgm_rxw_reconstruct (
 	pgm_assert (1 == window->is_fec_available);
 	pgm_assert_cmpuint (_pgm_rxw_pkt_sqn (window, tg_sqn), ==, 0);
 
-/* use stack memory */
-	tg_skbs = pgm_newa (struct pgm_sk_buff_t*, window->rs.n);
-	tg_data = pgm_newa (pgm_gf8_t*, window->rs.n);
-	tg_opts = pgm_newa (pgm_gf8_t*, window->rs.n);
-	offsets = pgm_newa (uint8_t, window->rs.k);
+	const uint8_t n = window->rs.n;
+	const uint8_t k = window->rs.k;
+
+/* single allocation: header, skbs[n], data[n], opts[n], offsets[k] */
+	decode = pgm_malloc0 (sizeof(pgm_rxw_decode_t) +
+			      (n - 1) * sizeof(struct pgm_sk_buff_t*) +
+			      2 * n * sizeof(pgm_gf8_t*) +
+			      k * sizeof(uint8_t));
+	decode->data	= (pgm_gf8_t**)&decode->skbs[n];
+	decode->opts	= decode->data + n;
+	decode->offsets	= (uint8_t*)(decode->opts + n);
+	decode->tg_sqn	= tg_sqn;
+	decode->n	= n;
+	decode->k	= k;
+
+/* encoding parameters come from parity, original data may be shorter */
+	tg_skb = NULL;
+	for (uint32_t i = tg_sqn; i != (tg_sqn + k); i++)
+	{
+		skb = _pgm_rxw_peek (window, i);
+		pgm_assert (NULL != skb);
+		if (PGM_PKT_STATE_HAVE_PARITY == ((const pgm_rxw_state_t*)&skb->cb)->pkt_state) {
+			tg_skb = skb;
+			break;
+		}
+	}
+	pgm_assert (NULL != tg_skb);
 
-	skb = _pgm_rxw_peek (window, tg_sqn);
-	pgm_assert (NULL != skb);
+	decode->is_var_pktlen = (tg_skb->pgm_header->pgm_options & PGM_OPT_VAR_PKTLEN) ? 1 : 0;
+	decode->is_op_encoded = (tg_skb->pgm_header->pgm_options & PGM_OPT_PRESENT) ? 1 : 0;
+	decode->parity_length = pgm_ntohs (tg_skb->pgm_header->pgm_tsdu_length);
+	decode->tstamp	      = tg_skb->tstamp;
 
-	const bool is_var_pktlen = skb->pgm_header->pgm_options & PGM_OPT_VAR_PKTLEN;
-	const bool is_op_encoded = skb->pgm_header->pgm_options & PGM_OPT_PRESENT;
-	const uint16_t parity_length = pgm_ntohs (skb->pgm_header->pgm_tsdu_length);
+/* variable length data is padded to the longest packet followed by its own length */
+	const uint16_t data_length = decode->is_var_pktlen ? decode->parity_length - sizeof(uint16_t) : decode->parity_length;
 
-	for (uint32_t i = tg_sqn, j = 0; i != (tg_sqn + window->rs.k); i++, j++)
+	for (uint32_t i = tg_sqn, j = 0; i != (tg_sqn + k); i++, j++)
 	{
 		skb = _pgm_rxw_peek (window, i);
 		pgm_assert (NULL != skb);
 		state = (pgm_rxw_state_t*)&skb->cb;
 		switch (state->pkt_state) {
+/* delivered ahead of the gap but not yet released */
+		case PGM_PKT_STATE_COMMIT_DATA:
 		case PGM_PKT_STATE_HAVE_DATA:
-			tg_skbs[ j ] = skb;
-			tg_data[ j ] = skb->data;
-			tg_opts[ j ] = (pgm_gf8_t*)skb->pgm_opt_fragment;
-			offsets[ j ] = j;
+			decode->skbs[ j ] = pgm_skb_get (skb);
+			decode->data[ j ] = skb->data;
+			decode->opts[ j ] = (pgm_gf8_t*)skb->pgm_opt_fragment;
+			decode->offsets[ j ] = j;
+			if (!skb->zero_padded) {
+				if (PGM_UNLIKELY(skb->len > data_length)) {
+/* parity announced a shorter group than the data received */
+					pgm_rxw_decode_free (decode);
+					return NULL;
+				}
+				memset (skb->tail, 0, data_length - skb->len);
+				if (decode->is_var_pktlen)
+					*(uint16_t*)((char*)skb->data + data_length) = skb->len;
+				skb->zero_padded = 1;
+			}
 			break;
 
 		case PGM_PKT_STATE_HAVE_PARITY:
-			tg_skbs[ window->rs.k + rs_h ] = skb;
-			tg_data[ window->rs.k + rs_h ] = skb->data;
-			tg_opts[ window->rs.k + rs_h ] = (pgm_gf8_t*)skb->pgm_opt_fragment;
-			offsets[ j ] = window->rs.k + rs_h;
+/* parity is stored in erasure order, the generator row comes from the
+ * transmitted sequence as any parity may fill any hole.
+ */
+			decode->skbs[ k + rs_h ] = pgm_skb_get (skb);
+			decode->data[ k + rs_h ] = skb->data;
+			decode->opts[ k + rs_h ] = (pgm_gf8_t*)skb->pgm_opt_fragment;
+			decode->offsets[ j ] = k + (uint8_t)_pgm_rxw_pkt_sqn (window, pgm_ntohl (skb->pgm_data->data_sqn));
 			++rs_h;
+			if (pgm_time_after (skb->tstamp, decode->tstamp))
+				decode->tstamp = skb->tstamp;
 			/* fallthrough */
 
 /* fall through and alloc new skb for reconstructed data */
@@ -1465,81 +1860,370 @@ _pgm_rxw_reconstruct (
 			pgm_skb_reserve (skb, sizeof(struct pgm_header) + sizeof(struct pgm_data));
 			skb->pgm_header = skb->head;
 			skb->pgm_data = (void*)( skb->pgm_header + 1 );
-			if (is_op_encoded) {
+			memcpy (skb->pgm_header, tg_skb->pgm_header, sizeof(struct pgm_header));
+			skb->pgm_header->pgm_options &= ~(PGM_OPT_PARITY | PGM_OPT_VAR_PKTLEN);
+			skb->pgm_data->data_sqn = pgm_htonl (i);
+			skb->tsi      = tg_skb->tsi;
+			skb->sequence = i;
+			if (decode->is_op_encoded) {
 				const uint16_t opt_total_length = sizeof(struct pgm_opt_length) +
 								 sizeof(struct pgm_opt_header) +
 								 sizeof(struct pgm_opt_fragment);
 				pgm_skb_reserve (skb, opt_total_length);
 				skb->pgm_opt_fragment = (void*)( skb->pgm_data + 1 );
-				pgm_skb_put (skb, parity_length);
-				memset (skb->pgm_opt_fragment, 0, opt_total_length + parity_length);
+				pgm_skb_put (skb, decode->parity_length);
+				memset (skb->pgm_opt_fragment, 0, opt_total_length + decode->parity_length);
 			} else {
-				pgm_skb_put (skb, parity_length);
-				memset (skb->data, 0, parity_length);
+				pgm_skb_put (skb, decode->parity_length);
+				memset (skb->data, 0, decode->parity_length);
 			}
-			tg_skbs[ j ] = skb;
-			tg_data[ j ] = skb->data;
-			tg_opts[ j ] = (void*)skb->pgm_opt_fragment;
+			decode->skbs[ j ] = skb;
+			decode->data[ j ] = skb->data;
+			decode->opts[ j ] = (pgm_gf8_t*)skb->pgm_opt_fragment;
 			break;
 
 		default: pgm_assert_not_reached(); break;
 		}
 
-		if (!skb->zero_padded) {
-			memset (skb->tail, 0, parity_length - skb->len);
-			skb->zero_padded = 1;
-		}
-
 	}
 
+	for (uint_fast8_t i = 0; i < k; i++)
+		if (decode->offsets[i] >= k)
+			decode->skbs[i]->tstamp = decode->tstamp;
+
+	return decode;
+}
+
+/* reconstruct missing packets of a transmission group, touches no window state
+ * and so may run outside the receiver lock with a private Reed-Solomon context.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_rxw_decode (
+	pgm_rs_t*	  const restrict rs,
+	pgm_rxw_decode_t* const restrict decode
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != rs);
+	pgm_assert (NULL != decode);
+	pgm_assert_cmpuint (rs->n, ==, decode->n);
+	pgm_assert_cmpuint (rs->k, ==, decode->k);
+
+	const pgm_time_t start = pgm_time_sample();
+
 /* reconstruct payload */
-	pgm_rs_decode_parity_appended (&window->rs,
-				       tg_data,
-				       offsets,
-				       parity_length);
+	pgm_rs_decode_parity_appended (rs,
+				       decode->data,
+				       decode->offsets,
+				       decode->parity_length);
 
 /* reconstruct opt_fragment option */
-	if (is_op_encoded)
-		pgm_rs_decode_parity_appended (&window->rs,
-					       tg_opts,
-					       offsets,
+	if (decode->is_op_encoded)
+		pgm_rs_decode_parity_appended (rs,
+					       decode->opts,
+					       decode->offsets,
 					       sizeof(struct pgm_opt_fragment));
 
-/* swap parity skbs with reconstructed skbs */
-	for (uint_fast8_t i = 0; i < window->rs.k; i++)
+	pgm_latency_add (PGM_LATENCY_FEC_DECODE, pgm_time_sample() - start);
+}
+
+/* returns TRUE if sequence in the incoming window has no data, including
+ * sequences already declared lost.
+ */
+
+static inline
+bool
+_pgm_rxw_is_recoverable (
+	pgm_rxw_t* const	window,
+	const uint32_t		sequence
+	)
+{
+	const struct pgm_sk_buff_t* skb;
+	const pgm_rxw_state_t* state;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+
+	if (_pgm_rxw_incoming_is_empty (window) ||
+	    pgm_uint32_lt (sequence, window->commit_lead) ||
+	    pgm_uint32_gt (sequence, window->lead))
+		return FALSE;
+
+	skb = _pgm_rxw_peek (window, sequence);
+	pgm_assert (NULL != skb);
+	state = (const pgm_rxw_state_t*)&skb->cb;
+	switch (state->pkt_state) {
+	case PGM_PKT_STATE_BACK_OFF:
+	case PGM_PKT_STATE_WAIT_NCF:
+	case PGM_PKT_STATE_WAIT_DATA:
+	case PGM_PKT_STATE_HAVE_PARITY:
+	case PGM_PKT_STATE_LOST_DATA:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/* swap placeholders and parity skbs with reconstructed skbs.  the window may
+ * have moved on or original data arrived since the decode was taken, only
+ * sequences still missing are filled.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_rxw_decode_complete (
+	pgm_rxw_t*	  const restrict window,
+	pgm_rxw_decode_t* const restrict decode
+	)
+{
+	struct pgm_sk_buff_t* tg_skb;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert (NULL != decode);
+
+	pgm_debug ("pgm_rxw_decode_complete (window:%p tg-sqn:%" PRIu32 ")",
+		(const void*)window, decode->tg_sqn);
+
+	if (!_pgm_rxw_is_tg_sqn_lost (window, decode->tg_sqn)) {
+		tg_skb = _pgm_rxw_peek (window, decode->tg_sqn);
+		if (NULL != tg_skb)
+			((pgm_rxw_state_t*)&tg_skb->cb)->is_decoding = 0;
+	}
+
+	for (uint_fast8_t i = 0; i < decode->k; i++)
 	{
 		struct pgm_sk_buff_t* repair_skb;
 
-		if (offsets[i] < window->rs.k)
+		if (decode->offsets[i] < decode->k)
 			continue;
 
-		repair_skb = tg_skbs[i];
+		repair_skb = decode->skbs[i];
 
-		if (is_var_pktlen)
+		if (decode->is_var_pktlen)
 		{
 			const uint16_t pktlen = *(uint16_t*)( (char*)repair_skb->tail - sizeof(uint16_t));
-			if (pktlen > parity_length) {
+			if (pktlen > decode->parity_length) {
 				pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Invalid encoded variable packet length in reconstructed packet, dropping entire transmission group."));
-				pgm_free_skb (repair_skb);
-				for (uint_fast8_t j = i; j < window->rs.k; j++)
+				for (uint_fast8_t j = i; j < decode->k; j++)
 				{
-					if (offsets[j] < window->rs.k)
+					if (decode->offsets[j] < decode->k)
 						continue;
-					pgm_rxw_lost (window, tg_skbs[offsets[j]]->sequence);
+					const uint32_t sequence = decode->tg_sqn + j;
+					if (_pgm_rxw_is_recoverable (window, sequence) &&
+					    PGM_PKT_STATE_LOST_DATA != ((const pgm_rxw_state_t*)&_pgm_rxw_peek (window, sequence)->cb)->pkt_state)
+						pgm_rxw_lost (window, sequence);
 				}
 				break;
 			}
-			const uint16_t padding = parity_length - pktlen;
+			const uint16_t padding = decode->parity_length - pktlen;
 			repair_skb->len -= padding;
 			repair_skb->tail = (char*)repair_skb->tail - padding;
 		}
 
-#ifdef PGM_DISABLE_ASSERT
-		_pgm_rxw_insert (window, repair_skb);
-#else
-		pgm_assert_cmpint (_pgm_rxw_insert (window, repair_skb), ==, PGM_RXW_INSERTED);
-#endif
+		if (!_pgm_rxw_is_recoverable (window, repair_skb->sequence))
+			continue;
+
+/* skb consumed by window */
+		if (PGM_RXW_INSERTED == _pgm_rxw_insert (window, repair_skb))
+			decode->skbs[i] = NULL;
+	}
+}
+
+/* release the references held by a decode and any unused reconstructed skbs.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_rxw_decode_free (
+	pgm_rxw_decode_t* const	decode
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != decode);
+
+	for (uint_fast8_t i = 0; i < decode->n; i++)
+		if (NULL != decode->skbs[i])
+			pgm_free_skb (decode->skbs[i]);
+	pgm_free (decode);
+}
+
+/* declare every sequence of a transmission group without original data lost,
+ * used when the group parity cannot describe the data received.
+ */
+
+static
+void
+_pgm_rxw_tg_sqn_gaps_lost (
+	pgm_rxw_t* const	window,
+	const uint32_t		tg_sqn
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != window);
+
+	pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Parity length shorter than original data, dropping entire transmission group."));
+	for (uint32_t sequence = tg_sqn; sequence != (tg_sqn + window->tg_size); sequence++)
+	{
+		if (_pgm_rxw_is_recoverable (window, sequence) &&
+		    PGM_PKT_STATE_LOST_DATA != ((const pgm_rxw_state_t*)&_pgm_rxw_peek (window, sequence)->cb)->pkt_state)
+			pgm_rxw_lost (window, sequence);
+	}
+}
+
+/* reconstruct missing sequences in a transmission group using embedded parity data.
+ */
+
+static
+void
+_pgm_rxw_reconstruct (
+	pgm_rxw_t* const	window,
+	const uint32_t		tg_sqn		/* transmission group sequence */
+	)
+{
+	pgm_rxw_decode_t* decode;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert (1 == window->is_fec_available);
+
+	decode = _pgm_rxw_decode_new (window, tg_sqn);
+	if (PGM_UNLIKELY(NULL == decode)) {
+		_pgm_rxw_tg_sqn_gaps_lost (window, tg_sqn);
+		return;
 	}
+	pgm_rxw_decode (&window->rs, decode);
+	pgm_rxw_decode_complete (window, decode);
+	pgm_rxw_decode_free (decode);
+}
+
+/* queue a transmission group for reconstruction off the receive path, the
+ * recovered packets re-enter the window through pgm_rxw_decode_complete().
+ */
+
+static
+void
+_pgm_rxw_defer_reconstruct (
+	pgm_rxw_t* const	window,
+	const uint32_t		tg_sqn		/* transmission group sequence */
+	)
+{
+	pgm_rxw_decode_t* decode;
+	struct pgm_sk_buff_t* tg_skb;
+	pgm_rxw_state_t* state;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert (1 == window->is_fec_available);
+	pgm_assert (1 == window->is_deferred_decode);
+
+	tg_skb = _pgm_rxw_peek (window, tg_sqn);
+	pgm_assert (NULL != tg_skb);
+	state = (pgm_rxw_state_t*)&tg_skb->cb;
+	if (state->is_decoding)
+		return;
+
+	decode = _pgm_rxw_decode_new (window, tg_sqn);
+	if (PGM_UNLIKELY(NULL == decode)) {
+		_pgm_rxw_tg_sqn_gaps_lost (window, tg_sqn);
+		return;
+	}
+	state->is_decoding = 1;
+	window->decode_list = pgm_slist_append (window->decode_list, decode);
+}
+
+/* parity holding the commit lead is never read as an APDU, decode the
+ * transmission group here once sufficient packets have arrived.  the commit
+ * lead is declared lost when nothing more is being recovered for the group.
+ *
+ * returns TRUE if the commit lead has been reconstructed.
+ */
+
+static
+bool
+_pgm_rxw_commit_lead_reconstruct (
+	pgm_rxw_t* const	window
+	)
+{
+	unsigned available = 0, pending = 0;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+
+	const uint32_t tg_sqn = _pgm_rxw_tg_sqn (window, window->commit_lead);
+	if (!window->is_fec_available ||
+	    _pgm_rxw_is_tg_sqn_lost (window, tg_sqn))
+		return FALSE;
+
+	for (uint32_t sequence = tg_sqn; sequence != (tg_sqn + window->tg_size); sequence++)
+	{
+		const struct pgm_sk_buff_t* skb = _pgm_rxw_peek (window, sequence);
+		if (NULL == skb)
+			return FALSE;
+		const pgm_rxw_state_t* state = (const pgm_rxw_state_t*)&skb->cb;
+		switch (state->pkt_state) {
+		case PGM_PKT_STATE_COMMIT_DATA:
+		case PGM_PKT_STATE_HAVE_DATA:
+		case PGM_PKT_STATE_HAVE_PARITY:
+			++available;
+			break;
+		case PGM_PKT_STATE_BACK_OFF:
+		case PGM_PKT_STATE_WAIT_NCF:
+		case PGM_PKT_STATE_WAIT_DATA:
+			++pending;
+			break;
+		default: break;
+		}
+	}
+	if (available < window->tg_size) {
+		if (0 == pending)
+			pgm_rxw_lost (window, window->commit_lead);
+		return FALSE;
+	}
+
+	if (window->is_deferred_decode) {
+		_pgm_rxw_defer_reconstruct (window, tg_sqn);
+		return FALSE;
+	}
+	_pgm_rxw_reconstruct (window, tg_sqn);
+	return TRUE;
+}
+
+/* fill a gap at sequence from its transmission group parity once enough
+ * packets of the group have arrived, the decode may be deferred to the
+ * decoder threads.
+ *
+ * returns TRUE if sequence now holds original data.
+ */
+
+static
+bool
+_pgm_rxw_reconstruct_gap (
+	pgm_rxw_t* const	window,
+	const uint32_t		sequence
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != window);
+
+/* the gap may sit in a later transmission group than the APDU start */
+	const uint32_t tg_sqn = _pgm_rxw_tg_sqn (window, sequence);
+	if (!window->is_fec_available ||
+	    _pgm_rxw_is_tg_sqn_lost (window, tg_sqn) ||
+	    !_pgm_rxw_is_tg_sqn_recoverable (window, tg_sqn))
+		return FALSE;
+
+	if (window->is_deferred_decode) {
+		_pgm_rxw_defer_reconstruct (window, tg_sqn);
+		return FALSE;
+	}
+	_pgm_rxw_reconstruct (window, tg_sqn);
+
+/* a failed decode leaves the gap in place */
+	const struct pgm_sk_buff_t* skb = _pgm_rxw_peek (window, sequence);
+	return PGM_PKT_STATE_HAVE_DATA == ((const pgm_rxw_state_t*)&skb->cb)->pkt_state;
 }
 
 /* check every TPDU in an APDU and verify that the data has arrived
@@ -1565,9 +2249,9 @@ _pgm_rxw_is_apdu_complete (
 	)
 {
 	struct pgm_sk_buff_t	*skb;
+	pgm_rxw_state_t		*state;
 	unsigned		 contiguous_tpdus = 0;
 	size_t			 contiguous_size = 0;
-	bool			 check_parity = FALSE;
 
 /* pre-conditions */
 	pgm_assert (NULL != window);
@@ -1580,8 +2264,15 @@ _pgm_rxw_is_apdu_complete (
 		return FALSE;
 	}
 
+/* the fragment header of parity or a placeholder describes no APDU */
+	state = (pgm_rxw_state_t*)&skb->cb;
+	if (PGM_PKT_STATE_HAVE_DATA != state->pkt_state) {
+		if (!_pgm_rxw_reconstruct_gap (window, first_sequence))
+			return FALSE;
+		skb = _pgm_rxw_peek (window, first_sequence);
+	}
+
 	const size_t apdu_size = skb->pgm_opt_fragment ? pgm_ntohl (skb->of_apdu_len) : skb->len;
-	const uint32_t  tg_sqn = _pgm_rxw_tg_sqn (window, first_sequence);
 
 	pgm_assert_cmpuint (apdu_size, >=, skb->len);
 
@@ -1595,69 +2286,42 @@ _pgm_rxw_is_apdu_complete (
 	     skb;
 	     skb = _pgm_rxw_peek (window, ++sequence))
 	{
-		pgm_rxw_state_t* state = (pgm_rxw_state_t*)&skb->cb;
+		state = (pgm_rxw_state_t*)&skb->cb;
 
-		if (!check_parity &&
-		    PGM_PKT_STATE_HAVE_DATA != state->pkt_state)
-		{
-			if (window->is_fec_available &&
-			    !_pgm_rxw_is_tg_sqn_lost (window, tg_sqn) )
-			{
-				check_parity = TRUE;
-/* pre-seed committed sequence count */
-				if (pgm_uint32_lte (tg_sqn, window->commit_lead))
-					contiguous_tpdus += window->commit_lead - tg_sqn;
-			}
-			else
-			{
+		if (PGM_PKT_STATE_HAVE_DATA != state->pkt_state) {
+			if (!_pgm_rxw_reconstruct_gap (window, sequence))
 				return FALSE;
-			}
+			skb = _pgm_rxw_peek (window, sequence);
 		}
 
-		if (check_parity)
-		{
-			if (PGM_PKT_STATE_HAVE_DATA == state->pkt_state ||
-			    PGM_PKT_STATE_HAVE_PARITY == state->pkt_state)
-				++contiguous_tpdus;
-
-/* have sufficient been received for reconstruction */
-			if (contiguous_tpdus >= window->tg_size) {
-				_pgm_rxw_reconstruct (window, tg_sqn);
-				return _pgm_rxw_is_apdu_complete (window, first_sequence);
-			}
-		}
-		else
-		{
 /* single packet APDU, already complete */
-			if (PGM_PKT_STATE_HAVE_DATA == state->pkt_state &&
-			    !skb->pgm_opt_fragment)
-				return TRUE;
+		if (!skb->pgm_opt_fragment)
+			return TRUE;
 
 /* protocol sanity check: matching first sequence reference */
-			if (PGM_UNLIKELY(pgm_ntohl (skb->of_apdu_first_sqn) != first_sequence)) {
-				pgm_rxw_lost (window, first_sequence);
-				return FALSE;
-			}
+		if (PGM_UNLIKELY(pgm_ntohl (skb->of_apdu_first_sqn) != first_sequence)) {
+			pgm_rxw_lost (window, first_sequence);
+			return FALSE;
+		}
 
 /* protocol sanity check: matching apdu length */
-			if (PGM_UNLIKELY(pgm_ntohl (skb->of_apdu_len) != apdu_size)) {
-				pgm_rxw_lost (window, first_sequence);
-				return FALSE;
-			}
+		if (PGM_UNLIKELY(pgm_ntohl (skb->of_apdu_len) != apdu_size)) {
+			pgm_rxw_lost (window, first_sequence);
+			return FALSE;
+		}
 
 /* protocol sanity check: maximum number of fragments per apdu */
-			if (PGM_UNLIKELY(++contiguous_tpdus > PGM_MAX_FRAGMENTS)) {
-				pgm_rxw_lost (window, first_sequence);
-				return FALSE;
-			}
+		if (PGM_UNLIKELY(++contiguous_tpdus > PGM_MAX_FRAGMENTS)) {
+			pgm_rxw_lost (window, first_sequence);
+			return FALSE;
+		}
 
-			contiguous_size += skb->len;
-			if (apdu_size == contiguous_size)
-				return TRUE;
-			else if (PGM_UNLIKELY(apdu_size < contiguous_size)) {
-				pgm_rxw_lost (window, first_sequence);
-				return FALSE;
-			}
+		contiguous_size += skb->len;
+		if (apdu_size == contiguous_size)
+			return TRUE;
+		else if (PGM_UNLIKELY(apdu_size < contiguous_size)) {
+			pgm_rxw_lost (window, first_sequence);
+			return FALSE;
 		}
 	}
 
@@ -1712,6 +2376,51 @@ _pgm_rxw_incoming_read_apdu (
 	return contiguous_len;
 }
 
+/* read one APDU ahead of the commit-lead, TPDUs are tagged delivered and
+ * remain in the incoming window.
+ */
+
+static inline
+ssize_t
+_pgm_rxw_unordered_read_apdu (
+	pgm_rxw_t*    const restrict window,
+	const uint32_t		     first_sequence,
+	struct pgm_msgv_t** restrict pmsg		/* message array, updated as messages appended */
+	)
+{
+	struct pgm_sk_buff_t *skb;
+	size_t		      contiguous_len = 0;
+	unsigned	      count = 0;
+	uint32_t	      sequence = first_sequence;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert (NULL != pmsg);
+
+	pgm_debug ("_pgm_rxw_unordered_read_apdu (window:%p first-sequence:%" PRIu32 " pmsg:%p)",
+		(const void*)window, first_sequence, (const void*)pmsg);
+
+	skb = _pgm_rxw_peek (window, sequence);
+	pgm_assert (NULL != skb);
+
+	const size_t apdu_len = skb->pgm_opt_fragment ? pgm_ntohl (skb->of_apdu_len) : skb->len;
+	pgm_assert_cmpuint (apdu_len, >=, skb->len);
+
+	do {
+		((pgm_rxw_state_t*)&skb->cb)->is_delivered = 1;
+		(*pmsg)->msgv_skb[ count++ ] = skb;
+		contiguous_len += skb->len;
+		if (apdu_len == contiguous_len)
+			break;
+		skb = _pgm_rxw_peek (window, ++sequence);
+		pgm_assert (NULL != skb);
+	} while (apdu_len > contiguous_len);
+
+	(*pmsg)->msgv_len = count;
+	(*pmsg)++;
+	return contiguous_len;
+}
+
 /* returns transmission group sequence (TG_SQN) from sequence (SQN).
  */
 
@@ -1796,6 +2505,7 @@ _pgm_rxw_state (
 	pgm_assert (NULL != skb);
 
 	state = (pgm_rxw_state_t*)&skb->cb;
+	const int old_pkt_state = state->pkt_state;
 
 /* remove current state */
 	if (PGM_PKT_STATE_ERROR != state->pkt_state)
@@ -1817,11 +2527,15 @@ _pgm_rxw_state (
 	case PGM_PKT_STATE_HAVE_DATA:
 		window->fragment_count++;
 		pgm_assert_cmpuint (window->fragment_count, <=, pgm_rxw_length (window));
+		if (window->is_unordered)
+			_pgm_rxw_unordered_rewind (window, skb);
 		break;
 
 	case PGM_PKT_STATE_HAVE_PARITY:
 		window->parity_count++;
 		pgm_assert_cmpuint (window->parity_count, <=, pgm_rxw_length (window));
+		if (window->is_unordered)
+			_pgm_rxw_unordered_rewind (window, skb);
 		break;
 
 	case PGM_PKT_STATE_COMMIT_DATA:
@@ -1842,6 +2556,7 @@ _pgm_rxw_state (
 	default: pgm_assert_not_reached(); break;
 	}
 
+	PGM_PROBE (rxw_state, PGM_PROBE_RXW_STATE, window->tsi, skb->sequence, ((uint32_t)old_pkt_state << 16) | (uint32_t)new_pkt_state, pgm_time_sample());
 	state->pkt_state = new_pkt_state;
 }
 
@@ -1978,6 +2693,66 @@ pgm_rxw_lost (
 	_pgm_rxw_state (window, skb, PGM_PKT_STATE_LOST_DATA);
 }
 
+/* record sequences leaving the trail without delivery.  adjacent sequences
+ * extend the latest range, once every range is held the latest also absorbs
+ * any delivered sequences in between.
+ */
+
+static
+void
+_pgm_rxw_add_loss (
+	pgm_rxw_t* const	window,
+	const uint32_t		first,
+	const uint32_t		count
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert (window->is_unordered);
+	pgm_assert_cmpuint (count, >, 0);
+
+	if (window->loss_len > 0) {
+		uint32_t* const last_first = &window->loss[ window->loss_len - 1 ].first;
+		uint32_t* const last_count = &window->loss[ window->loss_len - 1 ].count;
+		if (*last_first + *last_count == first ||
+		    PGM_RXW_LOSS_RANGES == window->loss_len)
+		{
+			*last_count = (first + count) - *last_first;
+			return;
+		}
+	}
+	window->loss[ window->loss_len ].first = first;
+	window->loss[ window->loss_len ].count = count;
+	window->loss_len++;
+}
+
+/* take the oldest range of sequences lost by unordered delivery.
+ *
+ * returns TRUE with the range in first and count, FALSE if none are held.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_rxw_read_loss (
+	pgm_rxw_t* const restrict window,
+	uint32_t*	 restrict first,
+	uint32_t*	 restrict count
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != window);
+	pgm_assert (NULL != first);
+	pgm_assert (NULL != count);
+
+	if (0 == window->loss_len)
+		return FALSE;
+	*first = window->loss[0].first;
+	*count = window->loss[0].count;
+	window->loss_len--;
+	memmove (&window->loss[0], &window->loss[1], window->loss_len * sizeof (window->loss[0]));
+	return TRUE;
+}
+
 /* received a uni/multicast ncf, search for a matching nak & tag or extend window if
  * beyond lead
  *
@@ -2096,7 +2871,7 @@ _pgm_rxw_recovery_append (
 	pgm_assert (NULL != window);
 
 	if (pgm_rxw_is_full (window)) {
-		if (_pgm_rxw_commit_is_empty (window)) {
+		if (!_pgm_rxw_is_trail_held (window)) {
 			pgm_trace (PGM_LOG_ROLE_RX_WINDOW,_("Receive window full on confirmed sequence."));
 			_pgm_rxw_remove_trail (window);
 		} else {
@@ -36,6 +36,8 @@
 
 #define pgm_histogram_add		mock_pgm_histogram_add
 #define pgm_time_now			mock_pgm_time_now
+#define pgm_time_update_now		mock_pgm_time_update_now
+#define pgm_tsc_us_mul			mock_pgm_tsc_us_mul
 #define pgm_rs_create			mock_pgm_rs_create
 #define pgm_rs_destroy			mock_pgm_rs_destroy
 #define pgm_rs_decode_parity_appended	mock_pgm_rs_decode_parity_appended
@@ -49,6 +51,9 @@
 #endif
 
 static pgm_time_t mock_pgm_time_now = 0x1;
+static pgm_time_t _mock_pgm_time_update_now (void);
+pgm_time_update_func mock_pgm_time_update_now = _mock_pgm_time_update_now;
+uint64_t mock_pgm_tsc_us_mul = 0;
 
 
 /* mock functions for external references */
@@ -69,6 +74,13 @@ pgm_get_nprocs (void)
 	return 1;
 }
 
+static
+pgm_time_t
+_mock_pgm_time_update_now (void)
+{
+	return mock_pgm_time_now;
+}
+
 /** reed-solomon module */
 void
 mock_pgm_rs_create (
@@ -77,6 +89,8 @@ mock_pgm_rs_create (
 	uint8_t			k
 	)
 {
+	rs->n = n;
+	rs->k = k;
 }
 
 void
@@ -94,7 +108,11 @@ mock_pgm_rs_decode_parity_appended (
 	uint16_t		len
 	)
 {
-// null
+/* parity carries a copy of the erasure, appended in erasure order */
+	uint_fast8_t p = rs->k;
+	for (uint_fast8_t i = 0; i < rs->k; i++)
+		if (offsets[i] >= rs->k)
+			memcpy (block[i], block[p++], len);
 }
 
 void
@@ -139,6 +157,43 @@ generate_valid_skb (void)
 	return skb;
 }
 
+/* generate original data of tsdu_length bytes filled with sequence
+ */
+static
+struct pgm_sk_buff_t*
+generate_sized_skb (
+	const uint32_t		sequence,
+	const guint16		tsdu_length
+	)
+{
+	struct pgm_sk_buff_t* skb = generate_valid_skb ();
+	skb->pgm_data->data_sqn = g_htonl (sequence);
+	skb->pgm_header->pgm_tsdu_length = g_htons (tsdu_length);
+	skb->len  = tsdu_length;
+	skb->tail = (char*)skb->data + tsdu_length;
+	memset (skb->data, sequence, tsdu_length);
+	return skb;
+}
+
+/* generate parity for transmission group index sequence, payload is the
+ * recovered data as reproduced by the mock decoder.
+ */
+static
+struct pgm_sk_buff_t*
+generate_parity_skb (
+	const uint32_t		sequence,
+	const guint16		tsdu_length,
+	const bool		is_var_pktlen
+	)
+{
+	struct pgm_sk_buff_t* skb = generate_sized_skb (sequence, tsdu_length);
+	skb->pgm_header->pgm_type = PGM_RDATA;
+	skb->pgm_header->pgm_options = PGM_OPT_PARITY;
+	if (is_var_pktlen)
+		skb->pgm_header->pgm_options |= PGM_OPT_VAR_PKTLEN;
+	return skb;
+}
+
 /* target:
  *	pgm_rxw_t*
  *	pgm_rxw_create (
@@ -1357,6 +1412,82 @@ START_TEST (test_lost_fail_001)
 }
 END_TEST
 
+/* target:
+ *	void
+ *	pgm_rxw_update_line (
+ *		pgm_rxw_t* const	window,
+ *		const unsigned		line,
+ *		const uint32_t		sequence,
+ *		const pgm_time_t	now
+ *		)
+ */
+
+START_TEST (test_update_line_pass_001)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	pgm_rxw_update_line (window, 0, 100, 10);
+	fail_unless (100 == window->line_lead[0], "lead failed");
+	fail_unless (10 == window->line_tstamp[0], "tstamp failed");
+/* older sequence refreshes the timestamp but not the lead */
+	pgm_rxw_update_line (window, 0, 99, 20);
+	fail_unless (100 == window->line_lead[0], "lead failed");
+	fail_unless (20 == window->line_tstamp[0], "tstamp failed");
+	pgm_rxw_update_line (window, 0, 101, 30);
+	fail_unless (101 == window->line_lead[0], "lead failed");
+	fail_unless (0 == window->line_tstamp[1], "line 1 touched");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+START_TEST (test_update_line_fail_001)
+{
+	pgm_rxw_update_line (NULL, 0, 0, 0);
+	fail ("reached");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_rxw_is_line_pending (
+ *		const pgm_rxw_t* const	window,
+ *		const uint32_t		sequence,
+ *		const pgm_time_t	live_after
+ *		)
+ */
+
+START_TEST (test_is_line_pending_pass_001)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+/* single line */
+	pgm_rxw_update_line (window, 0, 110, 100);
+	fail_unless (FALSE == pgm_rxw_is_line_pending (window, 105, 50), "pending with one line");
+/* line 1 behind and live */
+	pgm_rxw_update_line (window, 1, 100, 90);
+	fail_unless (TRUE == pgm_rxw_is_line_pending (window, 105, 50), "not pending");
+/* line 1 behind and stale */
+	fail_unless (FALSE == pgm_rxw_is_line_pending (window, 105, 95), "pending on stale line");
+/* neither line passed */
+	fail_unless (FALSE == pgm_rxw_is_line_pending (window, 120, 50), "pending on unpassed sequence");
+/* both lines passed */
+	pgm_rxw_update_line (window, 1, 110, 100);
+	fail_unless (FALSE == pgm_rxw_is_line_pending (window, 105, 50), "pending on passed sequence");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+START_TEST (test_is_line_pending_fail_001)
+{
+	const bool is_pending = pgm_rxw_is_line_pending (NULL, 0, 0);
+	fail ("reached");
+}
+END_TEST
+
 /* target:
  *	void
  *	pgm_rxw_state (
@@ -1613,6 +1744,20 @@ make_basic_test_suite (void)
 	tcase_add_test_raise_signal (tc_lost, test_lost_fail_001, SIGABRT);
 #endif
 
+        TCase* tc_update_line = tcase_create ("update-line");
+	suite_add_tcase (s, tc_update_line);
+	tcase_add_test (tc_update_line, test_update_line_pass_001);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_update_line, test_update_line_fail_001, SIGABRT);
+#endif
+
+        TCase* tc_is_line_pending = tcase_create ("is-line-pending");
+	suite_add_tcase (s, tc_is_line_pending);
+	tcase_add_test (tc_is_line_pending, test_is_line_pending_pass_001);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_is_line_pending, test_is_line_pending_fail_001, SIGABRT);
+#endif
+
         TCase* tc_state = tcase_create ("state");
 	suite_add_tcase (s, tc_state);
 	tcase_add_test (tc_state, test_state_pass_001);
@@ -1866,6 +2011,419 @@ make_best_effort_test_suite (void)
 	return s;
 }
 
+/* unordered, deliver ahead of gap then commit repair */
+START_TEST (test_readv_pass_010)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	window->is_unordered = 1;
+	struct pgm_msgv_t msgv[2], *pmsg;
+	struct pgm_sk_buff_t* skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (0);
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not appended");
+	pmsg = msgv;
+	fail_unless (1000 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+/* #2 read ahead of missing #1 */
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (2);
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not missing");
+	pmsg = msgv;
+	fail_unless (1000 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (1 == pmsg - msgv, "unordered read failed");
+	fail_unless (2 == msgv[0].msgv_skb[0]->sequence, "unordered sequence failed");
+	pmsg = msgv;
+	fail_unless (-1 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+/* repair #1, #2 is not read again */
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (1);
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not inserted");
+	pmsg = msgv;
+	fail_unless (1000 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (1 == pmsg - msgv, "repair read failed");
+	fail_unless (1 == msgv[0].msgv_skb[0]->sequence, "repair sequence failed");
+	fail_unless (3 == _pgm_rxw_commit_length (window), "commit_length failed");
+	pmsg = msgv;
+	fail_unless (-1 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (0 == window->cumulative_losses, "cumulative_losses failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* unordered, lost sequence behind delivered data */
+START_TEST (test_readv_pass_011)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	window->is_unordered = 1;
+	struct pgm_msgv_t msgv[2], *pmsg;
+	struct pgm_sk_buff_t* skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (0);
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not appended");
+	skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (2);
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not missing");
+	pmsg = msgv;
+	fail_unless (2000 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	pgm_rxw_lost (window, 1);
+	pgm_rxw_remove_commit (window);
+/* lost trail removed, delivered #2 committed without loss */
+	pmsg = msgv;
+	fail_unless (-1 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	const uint32_t cumulative_losses = window->cumulative_losses;
+	fail_unless (cumulative_losses > 0, "cumulative_losses failed");
+	pmsg = msgv;
+	fail_unless (-1 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (1 == _pgm_rxw_commit_length (window), "commit_length failed");
+	fail_unless (_pgm_rxw_incoming_is_empty (window), "incoming_is_empty failed");
+	fail_unless (cumulative_losses == window->cumulative_losses, "cumulative_losses failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* unordered, lost ranges reported once each with delivery continuing */
+START_TEST (test_readv_pass_016)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	window->is_unordered = 1;
+	struct pgm_msgv_t msgv[4], *pmsg;
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+	const uint32_t delivered[] = { 0, 3, 5 };
+	for (unsigned i = 0; i < G_N_ELEMENTS(delivered); i++) {
+		struct pgm_sk_buff_t* skb = generate_valid_skb ();
+		fail_if (NULL == skb, "generate_valid_skb failed");
+		skb->pgm_data->data_sqn = g_htonl (delivered[i]);
+		const int add_status = pgm_rxw_add (window, skb, now, nak_rb_expiry);
+		fail_unless (PGM_RXW_APPENDED == add_status || PGM_RXW_MISSING == add_status, "add failed");
+	}
+	pmsg = msgv;
+	fail_unless (3000 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	pgm_rxw_lost (window, 1);
+	pgm_rxw_lost (window, 2);
+	pgm_rxw_lost (window, 4);
+	for (unsigned i = 0; i < 8 && !_pgm_rxw_incoming_is_empty (window); i++) {
+		pgm_rxw_remove_commit (window);
+		pmsg = msgv;
+		fail_unless (-1 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	}
+	fail_unless (_pgm_rxw_incoming_is_empty (window), "incoming_is_empty failed");
+/* #1-#2 and #4, delivered #3 in between */
+	uint32_t first, count;
+	fail_unless (TRUE == pgm_rxw_read_loss (window, &first, &count), "read_loss failed");
+	fail_unless (1 == first && 2 == count, "first range %u+%u", first, count);
+	fail_unless (TRUE == pgm_rxw_read_loss (window, &first, &count), "read_loss failed");
+	fail_unless (4 == first && 1 == count, "second range %u+%u", first, count);
+	fail_unless (FALSE == pgm_rxw_read_loss (window, &first, &count), "read_loss not empty");
+/* later data still delivered */
+	struct pgm_sk_buff_t* skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	skb->pgm_data->data_sqn = g_htonl (6);
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not appended");
+	pmsg = msgv;
+	fail_unless (1000 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (6 == msgv[0].msgv_skb[0]->sequence, "sequence failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* a.k.a. PGM_UNORDERED
+ */
+
+static
+Suite*
+make_unordered_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create ("Unordered delivery");
+
+	TCase* tc_readv = tcase_create ("readv");
+	suite_add_tcase (s, tc_readv);
+	tcase_add_test (tc_readv, test_readv_pass_010);
+	tcase_add_test (tc_readv, test_readv_pass_011);
+	tcase_add_test (tc_readv, test_readv_pass_016);
+
+	return s;
+}
+
+/* parity recovery of a lost transmission group lead */
+START_TEST (test_readv_pass_012)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	pgm_rxw_update_fec (window, 4);
+	struct pgm_msgv_t msgv[4], *pmsg;
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+	for (unsigned i = 0; i < 4; i++)
+		fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (i, 100), now, nak_rb_expiry), "add not appended");
+	pmsg = msgv;
+	fail_unless (400 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	pgm_rxw_remove_commit (window);
+/* #4 missing, parity index 0 for transmission group #4 */
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, generate_sized_skb (5, 100), now, nak_rb_expiry), "add not missing");
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (6, 100), now, nak_rb_expiry), "add not appended");
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (7, 100), now, nak_rb_expiry), "add not appended");
+	pmsg = msgv;
+	fail_unless (-1 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	struct pgm_sk_buff_t* skb = generate_parity_skb (4 | 0, 100, FALSE);
+	memset (skb->data, 4, 100);
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not inserted");
+	pmsg = msgv;
+	fail_unless (400 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (4 == pmsg - msgv, "recovered read failed");
+	for (unsigned i = 0; i < 4; i++) {
+		fail_unless (4 + i == msgv[i].msgv_skb[0]->sequence, "sequence failed");
+		fail_unless (4 + i == *(uint8_t*)msgv[i].msgv_skb[0]->data, "payload failed");
+	}
+	fail_unless (0 == window->cumulative_losses, "cumulative_losses failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* variable length group, recovered length comes from the parity trailer */
+START_TEST (test_readv_pass_013)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	pgm_rxw_update_fec (window, 4);
+	struct pgm_msgv_t msgv[4], *pmsg;
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+/* shorter original data leads the group */
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (0, 500), now, nak_rb_expiry), "add not appended");
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, generate_sized_skb (2, 1000), now, nak_rb_expiry), "add not missing");
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (3, 1000), now, nak_rb_expiry), "add not appended");
+	struct pgm_sk_buff_t* skb = generate_parity_skb (0 | 1, 1000 + sizeof(uint16_t), TRUE);
+	memset (skb->data, 1, 1000);
+	*(uint16_t*)((char*)skb->data + 1000) = 700;
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not inserted");
+	pmsg = msgv;
+	fail_unless (500 + 700 + 1000 + 1000 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (4 == pmsg - msgv, "recovered read failed");
+	fail_unless (1 == msgv[1].msgv_skb[0]->sequence, "sequence failed");
+	fail_unless (700 == msgv[1].msgv_skb[0]->len, "recovered length failed");
+	fail_unless (1 == *(uint8_t*)msgv[1].msgv_skb[0]->data, "payload failed");
+/* originals keep their own length */
+	fail_unless (500 == msgv[0].msgv_skb[0]->len, "original length failed");
+	fail_unless (0 == window->cumulative_losses, "cumulative_losses failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* parity counts only towards its own transmission group */
+START_TEST (test_readv_pass_014)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	pgm_rxw_update_fec (window, 4);
+	struct pgm_msgv_t msgv[8], *pmsg;
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+/* #1 missing, parity index 0 and 1 for transmission group #4 with #5 and #6 missing */
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (0, 100), now, nak_rb_expiry), "add not appended");
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, generate_sized_skb (2, 100), now, nak_rb_expiry), "add not missing");
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (3, 100), now, nak_rb_expiry), "add not appended");
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (4, 100), now, nak_rb_expiry), "add not appended");
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, generate_sized_skb (7, 100), now, nak_rb_expiry), "add not missing");
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, generate_parity_skb (4 | 0, 100, FALSE), now, nak_rb_expiry), "add not inserted");
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, generate_parity_skb (4 | 1, 100, FALSE), now, nak_rb_expiry), "add not inserted");
+	pmsg = msgv;
+	fail_unless (100 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (1 == pmsg - msgv, "read failed");
+	pmsg = msgv;
+	fail_unless (-1 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+/* #1 repaired, group #4 decodes */
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, generate_sized_skb (1, 100), now, nak_rb_expiry), "add not inserted");
+	pmsg = msgv;
+	fail_unless (700 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (7 == pmsg - msgv, "recovered read failed");
+	fail_unless (0 == window->cumulative_losses, "cumulative_losses failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* original data longer than variable length parity loses the gaps */
+START_TEST (test_readv_pass_015)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	pgm_rxw_update_fec (window, 4);
+	struct pgm_msgv_t msgv[4], *pmsg;
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (0, 1000), now, nak_rb_expiry), "add not appended");
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, generate_sized_skb (2, 100), now, nak_rb_expiry), "add not missing");
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (3, 100), now, nak_rb_expiry), "add not appended");
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, generate_parity_skb (0 | 0, 100 + sizeof(uint16_t), TRUE), now, nak_rb_expiry), "add not inserted");
+	pmsg = msgv;
+	fail_unless (1000 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (1 == pmsg - msgv, "read failed");
+	pgm_rxw_remove_commit (window);
+/* lost trail removed, remainder of group delivered */
+	pmsg = msgv;
+	fail_unless (-1 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (window->cumulative_losses > 0, "cumulative_losses failed");
+	pmsg = msgv;
+	fail_unless (200 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (2 == pmsg - msgv, "read failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* parity for a later index fills the first hole of its transmission group */
+START_TEST (test_add_pass_006)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	pgm_rxw_update_fec (window, 4);
+	struct pgm_msgv_t msgv[4], *pmsg;
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (0, 100), now, nak_rb_expiry), "add not appended");
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, generate_sized_skb (2, 100), now, nak_rb_expiry), "add not missing");
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (3, 100), now, nak_rb_expiry), "add not appended");
+	struct pgm_sk_buff_t* skb = generate_parity_skb (0 | 3, 100, FALSE);
+	memset (skb->data, 1, 100);
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not inserted");
+	pmsg = msgv;
+	fail_unless (400 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (1 == msgv[1].msgv_skb[0]->sequence, "sequence failed");
+	fail_unless (1 == *(uint8_t*)msgv[1].msgv_skb[0]->data, "payload failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* a transmission group extending beyond the window lead has no hole to fill */
+START_TEST (test_add_pass_007)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	pgm_rxw_update_fec (window, 4);
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+	for (unsigned i = 0; i < 4; i++)
+		fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (i, 100), now, nak_rb_expiry), "add not appended");
+/* repaired group lead, #6 and #7 beyond the window lead */
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, generate_sized_skb (5, 100), now, nak_rb_expiry), "add not missing");
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, generate_sized_skb (4, 100), now, nak_rb_expiry), "add not inserted");
+	fail_unless (PGM_RXW_DUPLICATE == pgm_rxw_add (window, generate_parity_skb (4 | 2, 100, FALSE), now, nak_rb_expiry), "add not duplicate");
+	fail_unless (600 == pgm_rxw_size (window), "size failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* packets already read but not yet removed take part in recovery */
+START_TEST (test_add_pass_008)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	pgm_rxw_update_fec (window, 4);
+	struct pgm_msgv_t msgv[4], *pmsg;
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (0, 100), now, nak_rb_expiry), "add not appended");
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (1, 100), now, nak_rb_expiry), "add not appended");
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, generate_sized_skb (3, 100), now, nak_rb_expiry), "add not missing");
+	pmsg = msgv;
+	fail_unless (200 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	struct pgm_sk_buff_t* skb = generate_parity_skb (0 | 0, 100, FALSE);
+	memset (skb->data, 2, 100);
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, skb, now, nak_rb_expiry), "add not inserted");
+	pmsg = msgv;
+	fail_unless (200 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	fail_unless (2 == msgv[0].msgv_skb[0]->sequence, "sequence failed");
+	fail_unless (2 == *(uint8_t*)msgv[0].msgv_skb[0]->data, "payload failed");
+	fail_unless (0 == window->cumulative_losses, "cumulative_losses failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* original data replacing parity releases the parity payload */
+START_TEST (test_add_pass_009)
+{
+	pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const uint32_t ack_c_p = 500;
+	pgm_rxw_t* window = pgm_rxw_create (&tsi, 1500, 100, 0, 0, ack_c_p);
+	fail_if (NULL == window, "create failed");
+	pgm_rxw_update_fec (window, 4);
+	window->is_deferred_decode = TRUE;
+	struct pgm_msgv_t msgv[4], *pmsg;
+	const pgm_time_t now = 1;
+	const pgm_time_t nak_rb_expiry = 2;
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (0, 100), now, nak_rb_expiry), "add not appended");
+	fail_unless (PGM_RXW_MISSING == pgm_rxw_add (window, generate_sized_skb (2, 100), now, nak_rb_expiry), "add not missing");
+	fail_unless (PGM_RXW_APPENDED == pgm_rxw_add (window, generate_sized_skb (3, 100), now, nak_rb_expiry), "add not appended");
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, generate_parity_skb (0 | 0, 100, FALSE), now, nak_rb_expiry), "add not inserted");
+	fail_unless (400 == pgm_rxw_size (window), "size failed");
+	fail_unless (PGM_RXW_INSERTED == pgm_rxw_add (window, generate_sized_skb (1, 50), now, nak_rb_expiry), "add not inserted");
+	fail_unless (350 == pgm_rxw_size (window), "size failed");
+	pmsg = msgv;
+	fail_unless (350 == pgm_rxw_readv (window, &pmsg, G_N_ELEMENTS(msgv)), "readv failed");
+	pgm_rxw_remove_commit (window);
+	fail_unless (0 == pgm_rxw_size (window), "size failed");
+	pgm_rxw_destroy (window);
+}
+END_TEST
+
+/* a.k.a. FEC
+ */
+
+static
+Suite*
+make_parity_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create ("Parity recovery");
+
+	TCase* tc_readv = tcase_create ("readv");
+	suite_add_tcase (s, tc_readv);
+	tcase_add_test (tc_readv, test_readv_pass_012);
+	tcase_add_test (tc_readv, test_readv_pass_013);
+	tcase_add_test (tc_readv, test_readv_pass_014);
+	tcase_add_test (tc_readv, test_readv_pass_015);
+
+	TCase* tc_add = tcase_create ("add");
+	suite_add_tcase (s, tc_add);
+	tcase_add_test (tc_add, test_add_pass_006);
+	tcase_add_test (tc_add, test_add_pass_007);
+	tcase_add_test (tc_add, test_add_pass_008);
+	tcase_add_test (tc_add, test_add_pass_009);
+
+	return s;
+}
+
 static
 Suite*
 make_master_suite (void)
@@ -1880,6 +2438,8 @@ main (void)
 	SRunner* sr = srunner_create (make_master_suite ());
 	srunner_add_suite (sr, make_basic_test_suite ());
 	srunner_add_suite (sr, make_best_effort_test_suite ());
+	srunner_add_suite (sr, make_unordered_test_suite ());
+	srunner_add_suite (sr, make_parity_test_suite ());
 	srunner_run_all (sr, CK_ENV);
 	int number_failed = srunner_ntests_failed (sr);
 	srunner_free (sr);
@@ -0,0 +1,708 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Shared memory statistics segment.  A low priority publisher thread copies
+ * the socket, peer and window counters into a named segment at a fixed
+ * interval so that external monitors can read them without taking library
+ * locks or adding work to the data path.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#ifndef _GNU_SOURCE
+#	define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#ifndef _WIN32
+#	include <fcntl.h>
+#	include <sched.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	ifdef HAVE_POLL
+#		include <poll.h>
+#	endif
+#else
+#	include <process.h>
+#endif
+#include <impl/i18n.h>
+#include <impl/framework.h>
+#include <impl/socket.h>
+#include <impl/receiver.h>
+#include <impl/shmstats.h>
+
+
+//#define SHMSTATS_DEBUG
+
+#ifdef _WIN32
+#	define getpid		_getpid
+#endif
+
+/* counter names in PGM_PC_SOURCE_* order */
+static const char* pgm_shmstats_source_names[] = {
+	"data_bytes_sent",
+	"data_msgs_sent",
+	"bytes_sent",
+	"cksum_errors",
+	"malformed_naks",
+	"packets_discarded",
+	"parity_bytes_retransmitted",
+	"selective_bytes_retransmitted",
+	"parity_msgs_retransmitted",
+	"selective_msgs_retransmitted",
+	"parity_nak_packets_received",
+	"selective_nak_packets_received",
+	"parity_naks_received",
+	"selective_naks_received",
+	"parity_naks_ignored",
+	"selective_naks_ignored",
+	"ack_errors",
+	"transmission_current_rate",
+	"ack_packets_received",
+	"parity_nnak_packets_received",
+	"selective_nnak_packets_received",
+	"parity_nnaks_received",
+	"selective_nnaks_received",
+	"nnak_errors",
+	"unicast_msgs_retransmitted",
+	"ambient_spms_suppressed",
+	"redundant_send_errors"
+};
+
+/* counter names in PGM_PC_RECEIVER_* order */
+static const char* pgm_shmstats_receiver_names[] = {
+	"data_bytes_received",
+	"data_msgs_received",
+	"nak_failures",
+	"bytes_received",
+	"malformed_spms",
+	"malformed_odata",
+	"malformed_rdata",
+	"malformed_ncfs",
+	"packets_discarded",
+	"losses",
+	"dup_spms",
+	"dup_datas",
+	"parity_nak_packets_sent",
+	"selective_nak_packets_sent",
+	"parity_naks_sent",
+	"selective_naks_sent",
+	"parity_naks_retransmitted",
+	"selective_naks_retransmitted",
+	"parity_naks_failed",
+	"selective_naks_failed",
+	"naks_failed_rxw_advanced",
+	"naks_failed_ncf_retries_exceeded",
+	"naks_failed_data_retries_exceeded",
+	"naks_failed_gen_expired",
+	"nak_failures_delivered",
+	"selective_naks_suppressed",
+	"nak_errors",
+	"nak_svc_time_mean",
+	"nak_fail_time_mean",
+	"transmit_mean",
+	"acks_sent",
+	"dlr_repairs_sent",
+	"dlr_naks_forwarded",
+	"redundant_datas",
+	"redundant_naks_deferred"
+};
+
+PGM_STATIC_ASSERT(PGM_N_ELEMENTS(pgm_shmstats_source_names) == PGM_PC_SOURCE_MAX);
+PGM_STATIC_ASSERT(PGM_N_ELEMENTS(pgm_shmstats_receiver_names) == PGM_PC_RECEIVER_MAX);
+PGM_STATIC_ASSERT(PGM_PC_SOURCE_MAX <= PGM_SHMSTATS_SOURCE_COUNTERS);
+PGM_STATIC_ASSERT(PGM_PC_RECEIVER_MAX <= PGM_SHMSTATS_RECEIVER_COUNTERS);
+
+static pgm_mutex_t		shmstats_mutex;
+static uint32_t			shmstats_ref_count = 0;		/* owners and readers */
+static volatile uint32_t	shmstats_is_terminated = 0;
+static pgm_shmstats_t*		shmstats_segment = NULL;
+static pgm_shmstats_t*		shmstats_staging = NULL;	/* gathered outside the seqlock */
+static char			shmstats_name[256];
+static unsigned			shmstats_interval;		/* milliseconds */
+static pgm_notify_t		shmstats_notify = PGM_NOTIFY_INIT;
+#ifndef _WIN32
+static pthread_t		shmstats_thread;
+static void*			shmstats_routine (void*);
+#else
+static HANDLE			shmstats_mapping = NULL;
+static HANDLE			shmstats_thread;
+static unsigned __stdcall	shmstats_routine (void*);
+#endif
+
+
+PGM_GNUC_INTERNAL
+void
+pgm_shmstats_lock_init (void)
+{
+	pgm_mutex_init (&shmstats_mutex);
+}
+
+PGM_GNUC_INTERNAL
+void
+pgm_shmstats_lock_free (void)
+{
+	pgm_mutex_free (&shmstats_mutex);
+}
+
+/* copy the counters of one socket and its peers into the staging area.
+ *
+ * called with the socket list lock held.
+ */
+
+static
+void
+shmstats_gather_sock (
+	pgm_shmstats_t*	const restrict	stats,
+	pgm_sock_t*	const restrict	sock
+	)
+{
+	if (stats->n_socks == PGM_SHMSTATS_MAX_SOCKS) {
+		stats->dropped_socks++;
+		return;
+	}
+/* skip sockets in transition, they are published on the next pass */
+	if (!pgm_rwlock_reader_trylock (&sock->lock))
+		return;
+	if (!sock->is_bound || sock->is_destroyed) {
+		pgm_rwlock_reader_unlock (&sock->lock);
+		return;
+	}
+
+	const uint32_t sock_index = stats->n_socks++;
+	pgm_shmstats_sock_t* entry = &stats->socks[ sock_index ];
+	memset (entry, 0, sizeof (pgm_shmstats_sock_t));
+	memcpy (&entry->tsi, &sock->tsi, sizeof (pgm_tsi_t));
+	entry->dport = sock->dport;
+	if (sock->can_send_data) {
+		const pgm_txw_t* window = sock->window;
+		entry->flags |= PGM_SHMSTATS_CAN_SEND;
+		entry->txw_trail = pgm_txw_trail_atomic (window);
+		entry->txw_lead  = pgm_txw_lead_atomic (window);
+		entry->txw_bytes = (uint32_t)window->size;
+		entry->rate_per_sec	  = sock->rate_control.rate_per_sec;
+		entry->rate_limit	  = sock->rate_control.rate_limit;
+		entry->odata_rate_per_sec = sock->odata_rate_control.rate_per_sec;
+		entry->rdata_rate_per_sec = sock->rdata_rate_control.rate_per_sec;
+		for (unsigned i = 0; i < PGM_PC_SOURCE_MAX; i++)
+			entry->counters[ i ] = sock->cumulative_stats[ i ];
+	}
+	if (sock->can_recv_data) {
+		entry->flags |= PGM_SHMSTATS_CAN_RECV;
+		pgm_rwlock_reader_lock (&sock->peers_lock);
+		for (pgm_list_t* list = sock->peers_list; list; list = list->next) {
+			pgm_peer_t* peer = list->data;
+			const pgm_rxw_t* window = peer->window;
+			entry->n_peers++;
+			if (stats->n_peers == PGM_SHMSTATS_MAX_PEERS) {
+				stats->dropped_peers++;
+				continue;
+			}
+			pgm_shmstats_peer_t* peer_entry = &stats->peers[ stats->n_peers++ ];
+			memset (peer_entry, 0, sizeof (pgm_shmstats_peer_t));
+			peer_entry->sock_index	      = sock_index;
+			memcpy (&peer_entry->tsi, &peer->tsi, sizeof (pgm_tsi_t));
+/* window fields are read without the peer mutex, each is a single word */
+			peer_entry->rxw_trail	      = window->trail;
+			peer_entry->rxw_lead	      = window->lead;
+			peer_entry->commit_lead	      = window->commit_lead;
+			peer_entry->rxw_bytes	      = (uint32_t)window->size;
+			peer_entry->cumulative_losses = window->cumulative_losses;
+			peer_entry->bytes_delivered   = window->bytes_delivered;
+			peer_entry->msgs_delivered    = window->msgs_delivered;
+/* the histogram is not, it is updated under the peer mutex */
+			pgm_latency_t repair_latency;
+			pgm_mutex_lock (&peer->mutex);
+			memcpy (&repair_latency, &window->repair_latency, sizeof (pgm_latency_t));
+			pgm_mutex_unlock (&peer->mutex);
+			peer_entry->repair_p50	      = (uint32_t)pgm_latency_percentile (&repair_latency, 50.0);
+			peer_entry->repair_p99	      = (uint32_t)pgm_latency_percentile (&repair_latency, 99.0);
+			peer_entry->repair_max	      = (uint32_t)repair_latency.max;
+			peer_entry->repair_count      = repair_latency.count;
+			peer_entry->repair_sum	      = repair_latency.sum;
+			for (unsigned i = 0; i < PGM_PC_RECEIVER_MAX; i++)
+				peer_entry->counters[ i ] = peer->cumulative_stats[ i ];
+		}
+		pgm_rwlock_reader_unlock (&sock->peers_lock);
+	}
+	pgm_rwlock_reader_unlock (&sock->lock);
+}
+
+/* gather every socket into the staging area, then copy the used portion
+ * into the segment inside the seqlock so that readers retry only across
+ * the copy.
+ */
+
+static
+void
+shmstats_publish (void)
+{
+	pgm_shmstats_t* stats = shmstats_staging;
+
+	stats->n_socks = stats->n_peers = 0;
+	stats->dropped_socks = stats->dropped_peers = 0;
+	pgm_rwlock_reader_lock (&pgm_sock_list_lock);
+	for (pgm_slist_t* list = pgm_sock_list; list; list = list->next)
+		shmstats_gather_sock (stats, list->data);
+	pgm_rwlock_reader_unlock (&pgm_sock_list_lock);
+	stats->timestamp = pgm_time_sample();
+
+	pgm_shmstats_t* segment = shmstats_segment;
+	pgm_atomic_inc32 (&segment->seq);
+	segment->n_socks	= stats->n_socks;
+	segment->n_peers	= stats->n_peers;
+	segment->dropped_socks	= stats->dropped_socks;
+	segment->dropped_peers	= stats->dropped_peers;
+	segment->timestamp	= stats->timestamp;
+	memcpy (segment->socks, stats->socks, stats->n_socks * sizeof (pgm_shmstats_sock_t));
+	memcpy (segment->peers, stats->peers, stats->n_peers * sizeof (pgm_shmstats_peer_t));
+	pgm_atomic_inc32 (&segment->seq);
+}
+
+/* sleep for one interval or until shutdown.
+ */
+
+static
+void
+shmstats_wait (void)
+{
+	const SOCKET notify_fd = pgm_notify_get_socket (&shmstats_notify);
+#ifdef HAVE_POLL
+	struct pollfd fds[1];
+	memset (fds, 0, sizeof (fds));
+	fds[0].fd = notify_fd;
+	fds[0].events = POLLIN;
+	poll (fds, 1, (int)shmstats_interval);
+#else
+	fd_set readfds;
+	FD_ZERO(&readfds);
+	FD_SET(notify_fd, &readfds);
+	struct timeval tv_timeout = {
+		.tv_sec		= shmstats_interval / 1000,
+		.tv_usec	= (shmstats_interval % 1000) * 1000
+	};
+	select ((int)notify_fd + 1, &readfds, NULL, NULL, &tv_timeout);
+#endif /* HAVE_POLL */
+}
+
+#ifndef _WIN32
+static
+void*
+#else
+static
+unsigned
+__stdcall
+#endif
+shmstats_routine (
+	PGM_GNUC_UNUSED void*	arg
+	)
+{
+/* publishing must never compete with the protocol threads */
+#ifndef _WIN32
+	const struct sched_param param = { .sched_priority = 0 };
+#	ifdef SCHED_IDLE
+	pthread_setschedparam (pthread_self(), SCHED_IDLE, &param);
+#	else
+	pthread_setschedparam (pthread_self(), SCHED_OTHER, &param);
+#	endif
+#else
+	SetThreadPriority (GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+	while (!pgm_atomic_read32 (&shmstats_is_terminated)) {
+		shmstats_publish ();
+		shmstats_wait ();
+	}
+#ifndef _WIN32
+	return NULL;
+#else
+	_endthread();
+	return 0;
+#endif
+}
+
+/* map a named segment, created read-write for the publisher or opened
+ * read-only for a monitor.
+ *
+ * returns the mapping on success, returns NULL on failure with error set.
+ */
+
+static
+pgm_shmstats_t*
+shmstats_map (
+	const char*	     restrict name,
+	const bool		      is_publisher,
+	pgm_error_t**	     restrict error
+	)
+{
+	pgm_shmstats_t* stats;
+#ifndef _WIN32
+	const int fd = is_publisher ? shm_open (name, O_CREAT | O_RDWR, 0644) : shm_open (name, O_RDONLY, 0);
+	if (-1 == fd) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_errno (save_errno),
+			     _("Opening shared memory segment %s: %s"),
+			     name,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		return NULL;
+	}
+	if (is_publisher && 0 != ftruncate (fd, sizeof (pgm_shmstats_t))) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_errno (save_errno),
+			     _("Sizing shared memory segment %s: %s"),
+			     name,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		close (fd);
+		shm_unlink (name);
+		return NULL;
+	}
+	if (!is_publisher) {
+		struct stat buf;
+		if (0 != fstat (fd, &buf) || buf.st_size < (off_t)sizeof (pgm_shmstats_t)) {
+			pgm_set_error (error,
+				     PGM_ERROR_DOMAIN_ENGINE,
+				     PGM_ERROR_BADE,
+				     _("Shared memory segment %s is not a statistics segment."),
+				     name);
+			close (fd);
+			return NULL;
+		}
+	}
+	stats = mmap (NULL, sizeof (pgm_shmstats_t),
+		      is_publisher ? (PROT_READ | PROT_WRITE) : PROT_READ,
+		      MAP_SHARED, fd, 0);
+	if (MAP_FAILED == stats) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_errno (save_errno),
+			     _("Mapping shared memory segment %s: %s"),
+			     name,
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		close (fd);
+		if (is_publisher)
+			shm_unlink (name);
+		return NULL;
+	}
+	close (fd);
+#else
+	HANDLE mapping = is_publisher ?
+		CreateFileMappingA (INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof (pgm_shmstats_t), name) :
+		OpenFileMappingA (FILE_MAP_READ, FALSE, name);
+	if (NULL == mapping) {
+		const DWORD save_errno = GetLastError();
+		char winstr[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_win_errno (save_errno),
+			     _("Opening shared memory segment %s: %s"),
+			     name,
+			     pgm_win_strerror (winstr, sizeof (winstr), save_errno));
+		return NULL;
+	}
+	stats = MapViewOfFile (mapping, is_publisher ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, sizeof (pgm_shmstats_t));
+	if (NULL == stats) {
+		const DWORD save_errno = GetLastError();
+		char winstr[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_win_errno (save_errno),
+			     _("Mapping shared memory segment %s: %s"),
+			     name,
+			     pgm_win_strerror (winstr, sizeof (winstr), save_errno));
+		CloseHandle (mapping);
+		return NULL;
+	}
+/* a view keeps the mapping alive, only the publisher holds the handle to
+ * keep the name valid whilst no monitor is attached.
+ */
+	if (is_publisher)
+		shmstats_mapping = mapping;
+	else
+		CloseHandle (mapping);
+#endif /* _WIN32 */
+	return stats;
+}
+
+static
+void
+shmstats_unmap (
+	const pgm_shmstats_t*	stats
+	)
+{
+#ifndef _WIN32
+	munmap ((void*)stats, sizeof (pgm_shmstats_t));
+#else
+	UnmapViewOfFile (stats);
+#endif
+}
+
+/* create the named segment and start publishing into it every interval
+ * milliseconds.  name NULL uses PGM_SHMSTATS_DEFAULT_NAME with the process id.
+ * later calls add a reference to the existing segment.
+ *
+ * must be called after pgm_init().
+ *
+ * returns TRUE on success, returns FALSE if an error occurred.
+ */
+
+bool
+pgm_shmstats_init (
+	const char*	     restrict name,
+	const unsigned		      interval,
+	pgm_error_t**	     restrict error
+	)
+{
+	pgm_return_val_if_fail (interval > 0, FALSE);
+
+/* later callers return only once the segment is mapped and published */
+	pgm_mutex_lock (&shmstats_mutex);
+	if (shmstats_ref_count > 0) {
+		shmstats_ref_count++;
+		pgm_mutex_unlock (&shmstats_mutex);
+		return TRUE;
+	}
+
+	if (NULL == name)
+		pgm_snprintf_s (shmstats_name, sizeof (shmstats_name), _TRUNCATE, PGM_SHMSTATS_DEFAULT_NAME, (int)getpid());
+	else
+		pgm_strncpy_s (shmstats_name, sizeof (shmstats_name), name, _TRUNCATE);
+	shmstats_interval = interval;
+
+	shmstats_segment = shmstats_map (shmstats_name, TRUE, error);
+	if (NULL == shmstats_segment)
+		goto err_cleanup;
+
+/* constant header, readers validate before the first seqlock read */
+	pgm_shmstats_t* stats = shmstats_segment;
+	pgm_atomic_write32 (&stats->magic, 0);
+	stats->seq		 = 0;
+	stats->version		 = PGM_SHMSTATS_VERSION;
+	stats->size		 = sizeof (pgm_shmstats_t);
+	stats->pid		 = (uint32_t)getpid();
+	stats->interval		 = interval;
+	stats->source_counters	 = PGM_PC_SOURCE_MAX;
+	stats->receiver_counters = PGM_PC_RECEIVER_MAX;
+	for (unsigned i = 0; i < PGM_PC_SOURCE_MAX; i++)
+		pgm_strncpy_s (stats->source_counter_names[ i ], PGM_SHMSTATS_NAME_LEN, pgm_shmstats_source_names[ i ], _TRUNCATE);
+	for (unsigned i = 0; i < PGM_PC_RECEIVER_MAX; i++)
+		pgm_strncpy_s (stats->receiver_counter_names[ i ], PGM_SHMSTATS_NAME_LEN, pgm_shmstats_receiver_names[ i ], _TRUNCATE);
+	pgm_atomic_write32 (&stats->magic, PGM_SHMSTATS_MAGIC);
+
+	shmstats_staging = pgm_new0 (pgm_shmstats_t, 1);
+
+	if (0 != pgm_notify_init (&shmstats_notify)) {
+		const int save_errno = pgm_get_last_sock_error();
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_sock_errno (save_errno),
+			     _("Creating statistics notification channel: %s"),
+			     pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		goto err_cleanup;
+	}
+
+	pgm_atomic_write32 (&shmstats_is_terminated, 0);
+#ifndef _WIN32
+	const int status = pthread_create (&shmstats_thread, NULL, &shmstats_routine, NULL);
+	if (0 != status) {
+		const int save_errno = status;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_errno (save_errno),
+			     _("Creating statistics thread: %s"),
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		goto err_cleanup;
+	}
+#else
+	shmstats_thread = (HANDLE)_beginthreadex (NULL, 0, &shmstats_routine, NULL, 0, NULL);
+	if (0 == shmstats_thread) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     pgm_error_from_errno (save_errno),
+			     _("Creating statistics thread: %s"),
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		goto err_cleanup;
+	}
+#endif /* _WIN32 */
+	shmstats_ref_count = 1;
+	pgm_mutex_unlock (&shmstats_mutex);
+	pgm_minor (_("Statistics segment: %s"), shmstats_name);
+	return TRUE;
+
+err_cleanup:
+	if (pgm_notify_is_valid (&shmstats_notify))
+		pgm_notify_destroy (&shmstats_notify);
+	if (NULL != shmstats_staging) {
+		pgm_free (shmstats_staging);
+		shmstats_staging = NULL;
+	}
+	if (NULL != shmstats_segment) {
+		shmstats_unmap (shmstats_segment);
+		shmstats_segment = NULL;
+#ifndef _WIN32
+		shm_unlink (shmstats_name);
+#else
+		CloseHandle (shmstats_mapping);
+		shmstats_mapping = NULL;
+#endif
+	}
+	pgm_mutex_unlock (&shmstats_mutex);
+	return FALSE;
+}
+
+/* stop publishing and remove the segment name, attached monitors keep their
+ * mapping until they detach.
+ *
+ * must be called before pgm_shutdown().
+ */
+
+bool
+pgm_shmstats_shutdown (void)
+{
+	pgm_mutex_lock (&shmstats_mutex);
+	if (PGM_UNLIKELY(0 == shmstats_ref_count)) {
+		pgm_mutex_unlock (&shmstats_mutex);
+		pgm_return_val_if_reached (FALSE);
+	}
+	if (--shmstats_ref_count > 0) {
+		pgm_mutex_unlock (&shmstats_mutex);
+		return TRUE;
+	}
+
+	pgm_atomic_write32 (&shmstats_is_terminated, 1);
+	pgm_notify_send (&shmstats_notify);
+#ifndef _WIN32
+	pthread_join (shmstats_thread, NULL);
+#else
+	WaitForSingleObject (shmstats_thread, INFINITE);
+	CloseHandle (shmstats_thread);
+#endif
+	pgm_notify_destroy (&shmstats_notify);
+	pgm_free (shmstats_staging);
+	shmstats_staging = NULL;
+	shmstats_unmap (shmstats_segment);
+	shmstats_segment = NULL;
+#ifndef _WIN32
+	shm_unlink (shmstats_name);
+#else
+	CloseHandle (shmstats_mapping);
+	shmstats_mapping = NULL;
+#endif
+	pgm_mutex_unlock (&shmstats_mutex);
+	return TRUE;
+}
+
+/* copy the latest snapshot of this process, for in-process exporters that
+ * must not contend with the protocol locks.
+ *
+ * returns TRUE on success, returns FALSE if publishing is not enabled or no
+ * consistent snapshot was read within PGM_SHMSTATS_READ_ATTEMPTS.
+ */
+
+bool
+pgm_shmstats_read (
+	pgm_shmstats_t* const	stats
+	)
+{
+	bool is_consistent = FALSE;
+
+	pgm_return_val_if_fail (NULL != stats, FALSE);
+
+/* the reference keeps the segment mapped across a concurrent shutdown */
+	pgm_mutex_lock (&shmstats_mutex);
+	if (0 == shmstats_ref_count) {
+		pgm_mutex_unlock (&shmstats_mutex);
+		return FALSE;
+	}
+	shmstats_ref_count++;
+	const pgm_shmstats_t* segment = shmstats_segment;
+	pgm_mutex_unlock (&shmstats_mutex);
+
+/* the publisher runs at idle priority and may be preempted mid-copy */
+	for (unsigned attempt = 0; attempt < PGM_SHMSTATS_READ_ATTEMPTS; attempt++) {
+		if (attempt > 0)
+			pgm_thread_yield();
+		const uint32_t seq = segment->seq;
+		if (seq & 1)
+			continue;
+		pgm_shmstats_barrier();
+		memcpy (stats, segment, sizeof (pgm_shmstats_t));
+		if (!pgm_shmstats_read_retry (segment, seq)) {
+			is_consistent = TRUE;
+			break;
+		}
+	}
+	pgm_shmstats_shutdown ();
+	return is_consistent;
+}
+
+/* map another process's segment read-only and validate its layout.
+ *
+ * returns the segment on success, returns NULL on failure with error set.
+ */
+
+const pgm_shmstats_t*
+pgm_shmstats_attach (
+	const char*	     restrict name,
+	pgm_error_t**	     restrict error
+	)
+{
+	pgm_return_val_if_fail (NULL != name, NULL);
+
+	const pgm_shmstats_t* stats = shmstats_map (name, FALSE, error);
+	if (NULL == stats)
+		return NULL;
+	if (PGM_SHMSTATS_MAGIC != stats->magic ||
+	    PGM_SHMSTATS_VERSION != stats->version ||
+	    sizeof (pgm_shmstats_t) != stats->size)
+	{
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_ENGINE,
+			     PGM_ERROR_VERNOTSUPPORTED,
+			     _("Shared memory segment %s has unsupported version %u."),
+			     name,
+			     (unsigned)stats->version);
+		shmstats_unmap (stats);
+		return NULL;
+	}
+	return stats;
+}
+
+void
+pgm_shmstats_detach (
+	const pgm_shmstats_t*	stats
+	)
+{
+	pgm_return_if_fail (NULL != stats);
+	shmstats_unmap (stats);
+}
+
+/* eof */
@@ -0,0 +1,311 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * unit tests for the shared memory statistics segment.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <check.h>
+
+#ifdef _WIN32
+#	define PGM_CHECK_NOFORK		1
+#endif
+
+
+/* mock state */
+
+
+#define pgm_time_now		mock_pgm_time_now
+#define pgm_time_update_now	mock_pgm_time_update_now
+#define pgm_tsc_us_mul		mock_pgm_tsc_us_mul
+#define pgm_sock_list_lock	mock_pgm_sock_list_lock
+#define pgm_sock_list		mock_pgm_sock_list
+
+#define SHMSTATS_DEBUG
+#include "shmstats.c"
+
+static pgm_time_t mock_pgm_time_now = 0x1;
+static pgm_time_t _mock_pgm_time_update_now (void);
+pgm_time_update_func mock_pgm_time_update_now = _mock_pgm_time_update_now;
+uint64_t mock_pgm_tsc_us_mul = 0;
+pgm_rwlock_t mock_pgm_sock_list_lock;
+pgm_slist_t* mock_pgm_sock_list = NULL;
+
+
+/* mock functions for external references */
+
+size_t
+pgm_transport_pkt_offset2 (
+        const bool                      can_fragment,
+        const bool                      use_pgmcc
+        )
+{
+        return 0;
+}
+
+PGM_GNUC_INTERNAL
+int
+pgm_get_nprocs (void)
+{
+	return 1;
+}
+
+static
+pgm_time_t
+_mock_pgm_time_update_now (void)
+{
+	return mock_pgm_time_now;
+}
+
+
+/* target:
+ *	bool
+ *	pgm_shmstats_init (
+ *		const char*		name,
+ *		const unsigned		interval,
+ *		pgm_error_t**		error
+ *	)
+ */
+
+START_TEST (test_init_pass_001)
+{
+	pgm_error_t* err = NULL;
+	pgm_rwlock_init (&mock_pgm_sock_list_lock);
+	fail_unless (TRUE == pgm_shmstats_init (NULL, 10, &err), "init failed");
+	fail_unless (NULL == err, "error raised");
+	fail_unless (TRUE == pgm_shmstats_shutdown (), "shutdown failed");
+	pgm_rwlock_free (&mock_pgm_sock_list_lock);
+}
+END_TEST
+
+/* second reference keeps the segment until the last shutdown */
+START_TEST (test_init_pass_002)
+{
+	const char* name = "/pgm-stats-unittest";
+	pgm_error_t* err = NULL;
+	pgm_rwlock_init (&mock_pgm_sock_list_lock);
+	fail_unless (TRUE == pgm_shmstats_init (name, 10, &err), "init failed");
+	fail_unless (TRUE == pgm_shmstats_init (name, 10, &err), "init failed");
+	fail_unless (2 == shmstats_ref_count, "ref_count failed");
+	fail_unless (TRUE == pgm_shmstats_shutdown (), "shutdown failed");
+	fail_unless (NULL != shmstats_segment, "segment released early");
+	const pgm_shmstats_t* stats = pgm_shmstats_attach (name, &err);
+	fail_unless (NULL != stats, "attach failed");
+	pgm_shmstats_detach (stats);
+	fail_unless (TRUE == pgm_shmstats_shutdown (), "shutdown failed");
+	fail_unless (NULL == shmstats_segment, "segment not released");
+	pgm_rwlock_free (&mock_pgm_sock_list_lock);
+}
+END_TEST
+
+#ifndef _WIN32
+static volatile bool mock_is_init_returned;
+
+static
+void*
+mock_init_routine (
+	PGM_GNUC_UNUSED void*	arg
+	)
+{
+	pgm_error_t* err = NULL;
+	const bool status = pgm_shmstats_init (NULL, 10, &err);
+	mock_is_init_returned = TRUE;
+	return status ? shmstats_segment : NULL;
+}
+
+/* a caller waits whilst another holds the segment in setup */
+START_TEST (test_init_pass_003)
+{
+	pthread_t thread;
+	void* retval;
+	pgm_rwlock_init (&mock_pgm_sock_list_lock);
+	mock_is_init_returned = FALSE;
+	pgm_mutex_lock (&shmstats_mutex);
+	fail_unless (0 == pthread_create (&thread, NULL, mock_init_routine, NULL), "pthread_create failed");
+	usleep (50 * 1000);
+	fail_unless (FALSE == mock_is_init_returned, "init returned during setup");
+	pgm_mutex_unlock (&shmstats_mutex);
+	fail_unless (0 == pthread_join (thread, &retval), "pthread_join failed");
+	fail_unless (NULL != retval, "init returned without a segment");
+	fail_unless (TRUE == pgm_shmstats_shutdown (), "shutdown failed");
+	pgm_rwlock_free (&mock_pgm_sock_list_lock);
+}
+END_TEST
+#endif /* !_WIN32 */
+
+START_TEST (test_init_fail_001)
+{
+	pgm_error_t* err = NULL;
+	fail_unless (FALSE == pgm_shmstats_init (NULL, 0, &err), "init failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_shmstats_shutdown (void)
+ */
+
+START_TEST (test_shutdown_fail_001)
+{
+	fail_unless (FALSE == pgm_shmstats_shutdown (), "shutdown failed");
+}
+END_TEST
+
+/* target:
+ *	const pgm_shmstats_t*
+ *	pgm_shmstats_attach (
+ *		const char*		name,
+ *		pgm_error_t**		error
+ *	)
+ */
+
+START_TEST (test_attach_pass_001)
+{
+	const char* name = "/pgm-stats-unittest";
+	pgm_error_t* err = NULL;
+	pgm_rwlock_init (&mock_pgm_sock_list_lock);
+	fail_unless (TRUE == pgm_shmstats_init (name, 10, &err), "init failed");
+	const pgm_shmstats_t* stats = pgm_shmstats_attach (name, &err);
+	fail_unless (NULL != stats, "attach failed");
+	fail_unless (PGM_SHMSTATS_MAGIC == stats->magic, "magic failed");
+	fail_unless (PGM_SHMSTATS_VERSION == stats->version, "version failed");
+	fail_unless (PGM_PC_SOURCE_MAX == stats->source_counters, "source counters failed");
+	fail_unless (0 == strcmp ("data_bytes_sent", stats->source_counter_names[ PGM_PC_SOURCE_DATA_BYTES_SENT ]), "source name failed");
+	fail_unless (0 == strcmp ("losses", stats->receiver_counter_names[ PGM_PC_RECEIVER_LOSSES ]), "receiver name failed");
+/* wait for at least one publish */
+	uint32_t seq;
+	do {
+		seq = pgm_shmstats_read_begin (stats);
+	} while (0 == seq);
+	fail_unless (0 == stats->n_socks, "socks failed");
+/* an odd sequence is never current */
+	fail_unless (TRUE == pgm_shmstats_read_retry (stats, seq - 1), "retry failed");
+	pgm_shmstats_detach (stats);
+	fail_unless (TRUE == pgm_shmstats_shutdown (), "shutdown failed");
+	pgm_rwlock_free (&mock_pgm_sock_list_lock);
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_shmstats_read (pgm_shmstats_t* const stats)
+ */
+
+START_TEST (test_read_pass_001)
+{
+	pgm_error_t* err = NULL;
+	pgm_shmstats_t* stats = g_malloc0 (sizeof (pgm_shmstats_t));
+	pgm_rwlock_init (&mock_pgm_sock_list_lock);
+	fail_unless (FALSE == pgm_shmstats_read (stats), "read without segment");
+/* one publish then idle for the test duration */
+	fail_unless (TRUE == pgm_shmstats_init (NULL, 60 * 1000, &err), "init failed");
+	while (0 == shmstats_segment->seq)
+		pgm_thread_yield ();
+	fail_unless (TRUE == pgm_shmstats_read (stats), "read failed");
+	fail_unless (PGM_SHMSTATS_MAGIC == stats->magic, "magic failed");
+	fail_unless (1 == shmstats_ref_count, "reference not released");
+/* publisher stalled inside the seqlock */
+	const uint32_t seq = shmstats_segment->seq;
+	shmstats_segment->seq = seq + 1;
+	fail_unless (FALSE == pgm_shmstats_read (stats), "read of a torn snapshot");
+	fail_unless (1 == shmstats_ref_count, "reference not released");
+	shmstats_segment->seq = seq + 2;
+	fail_unless (TRUE == pgm_shmstats_read (stats), "read failed");
+	fail_unless (TRUE == pgm_shmstats_shutdown (), "shutdown failed");
+	pgm_rwlock_free (&mock_pgm_sock_list_lock);
+	g_free (stats);
+}
+END_TEST
+
+START_TEST (test_read_fail_001)
+{
+	fail_unless (FALSE == pgm_shmstats_read (NULL), "read failed");
+}
+END_TEST
+
+START_TEST (test_attach_fail_001)
+{
+	pgm_error_t* err = NULL;
+	fail_unless (NULL == pgm_shmstats_attach ("/pgm-stats-unittest-missing", &err), "attach failed");
+	fail_unless (NULL != err, "error not raised");
+	pgm_error_free (err);
+}
+END_TEST
+
+
+static
+Suite*
+make_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create (__FILE__);
+
+	TCase* tc_init = tcase_create ("init");
+	suite_add_tcase (s, tc_init);
+	tcase_add_test (tc_init, test_init_pass_001);
+	tcase_add_test (tc_init, test_init_pass_002);
+#ifndef _WIN32
+	tcase_add_test (tc_init, test_init_pass_003);
+#endif
+	tcase_add_test (tc_init, test_init_fail_001);
+
+	TCase* tc_shutdown = tcase_create ("shutdown");
+	suite_add_tcase (s, tc_shutdown);
+	tcase_add_test (tc_shutdown, test_shutdown_fail_001);
+
+	TCase* tc_read = tcase_create ("read");
+	suite_add_tcase (s, tc_read);
+	tcase_add_test (tc_read, test_read_pass_001);
+	tcase_add_test (tc_read, test_read_fail_001);
+
+	TCase* tc_attach = tcase_create ("attach");
+	suite_add_tcase (s, tc_attach);
+	tcase_add_test (tc_attach, test_attach_pass_001);
+	tcase_add_test (tc_attach, test_attach_fail_001);
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	pgm_messages_init();
+	pgm_shmstats_lock_init();
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_test_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	pgm_shmstats_lock_free();
+	pgm_messages_shutdown();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
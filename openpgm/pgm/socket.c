@@ -30,6 +30,9 @@
 #ifdef HAVE_EPOLL_CTL
 #	include <sys/epoll.h>
 #endif
+#ifdef HAVE_TIMERFD
+#	include <sys/timerfd.h>
+#endif
 #include <stdio.h>
 #include <impl/i18n.h>
 #include <impl/framework.h>
@@ -247,6 +250,10 @@ pgm_close (
 		closesocket (sock->send_sock);
 		sock->send_sock = INVALID_SOCKET;
 	}
+	if (sock->engine_thread) {
+		pgm_debug ("stopping protocol engine thread.");
+		pgm_engine_thread_stop (sock->engine_thread);
+	}
 	pgm_rwlock_reader_unlock (&sock->lock);
 	pgm_debug ("blocking on destroy lock ...");
 	pgm_rwlock_writer_lock (&sock->lock);
@@ -256,6 +263,12 @@ pgm_close (
 	pgm_sock_list = pgm_slist_remove (pgm_sock_list, sock);
 	pgm_rwlock_writer_unlock (&pgm_sock_list_lock);
 
+/* no scheduled SPM may follow the FIN */
+	if (sock->can_send_data && sock->use_spm_scheduler) {
+		pgm_debug ("removing sock from SPM scheduler.");
+		pgm_spm_scheduler_remove (sock);
+	}
+
 /* flush source side by sending heartbeat SPMs */
 	if (sock->can_send_data &&
 	    sock->is_connected && 
@@ -270,6 +283,21 @@ pgm_close (
 		}
 	}
 
+	if (sock->engine_thread) {
+		pgm_debug ("destroying protocol engine queue.");
+		pgm_engine_thread_destroy (sock->engine_thread);
+		sock->engine_thread = NULL;
+	}
+	if (sock->decoder) {
+		pgm_debug ("stopping parity decoder.");
+		pgm_decoder_destroy (sock->decoder);
+		sock->decoder = NULL;
+	}
+	if (sock->hostnak) {
+		pgm_debug ("detaching host NAK suppression.");
+		pgm_hostnak_detach (sock->hostnak);
+		sock->hostnak = NULL;
+	}
 	if (sock->peers_hashtable) {
 		pgm_debug ("destroying peer lookup table.");
 		pgm_hashtable_destroy (sock->peers_hashtable);
@@ -297,6 +325,11 @@ pgm_close (
 		closesocket (sock->send_with_router_alert_sock);
 		sock->send_with_router_alert_sock = INVALID_SOCKET;
 	}
+	if (INVALID_SOCKET != sock->redundant_send_sock) {
+		pgm_trace (PGM_LOG_ROLE_NETWORK,_("Closing redundant send socket."));
+		closesocket (sock->redundant_send_sock);
+		sock->redundant_send_sock = INVALID_SOCKET;
+	}
 	if (sock->spm_heartbeat_interval) {
 		pgm_debug ("freeing SPM heartbeat interval data.");
 		pgm_free (sock->spm_heartbeat_interval);
@@ -315,12 +348,20 @@ pgm_close (
 		pgm_notify_destroy (&sock->rdata_notify);
 	}
 	pgm_notify_destroy (&sock->pending_notify);
+#ifdef HAVE_TIMERFD
+	if (-1 != sock->timer_fd) {
+		pgm_debug ("closing timer descriptor.");
+		close (sock->timer_fd);
+		sock->timer_fd = -1;
+	}
+#endif
 	pgm_debug ("freeing sock locks.");
 	pgm_rwlock_free (&sock->peers_lock);
 	pgm_spinlock_free (&sock->txw_spinlock);
 	pgm_mutex_free (&sock->send_mutex);
 	pgm_mutex_free (&sock->timer_mutex);
 	pgm_mutex_free (&sock->source_mutex);
+	pgm_cond_free (&sock->rx_cond);
 	pgm_mutex_free (&sock->receiver_mutex);
 	pgm_rwlock_writer_unlock (&sock->lock);
 	pgm_rwlock_free (&sock->lock);
@@ -378,6 +419,12 @@ pgm_socket (
 	new_sock->dport		= DEFAULT_DATA_DESTINATION_PORT;
 	new_sock->tsi.sport	= DEFAULT_DATA_SOURCE_PORT;
 	new_sock->adv_mode	= 0;	/* advance with time */
+	new_sock->engine_affinity = -1;	/* unbound */
+	new_sock->cc_ops	= &pgm_cc_reno;
+	new_sock->redundant_send_sock = INVALID_SOCKET;
+#ifdef HAVE_TIMERFD
+	new_sock->timer_fd	= -1;
+#endif
 
 /* PGMCC */
 	new_sock->acker_nla.ss_family = family;
@@ -392,6 +439,7 @@ pgm_socket (
 	pgm_mutex_init (&new_sock->timer_mutex);
 /* receiver-side */
 	pgm_mutex_init (&new_sock->receiver_mutex);
+	pgm_cond_init (&new_sock->rx_cond);
 /* peer hash map & list lock */
 	pgm_rwlock_init (&new_sock->peers_lock);
 /* destroy lock */
@@ -716,10 +764,27 @@ pgm_getsockopt (
 			break;
 		if (PGM_UNLIKELY(*optlen != sizeof (SOCKET)))
 			break;
-		*(SOCKET*restrict)optval = pgm_notify_get_socket (&sock->pending_notify);
+		if (sock->engine_thread && !pgm_engine_thread_is_current (sock->engine_thread))
+			*(SOCKET*restrict)optval = pgm_engine_thread_get_socket (sock->engine_thread);
+		else
+			*(SOCKET*restrict)optval = pgm_notify_get_socket (&sock->pending_notify);
 		status = TRUE;
 		break;
 
+#ifdef HAVE_TIMERFD
+/* timer socket */
+	case PGM_TIMER_SOCK:
+		if (PGM_UNLIKELY(!sock->is_connected))
+			break;
+		if (PGM_UNLIKELY(*optlen != sizeof (SOCKET)))
+			break;
+		if (PGM_UNLIKELY(!sock->use_timerfd))
+			break;
+		*(SOCKET*restrict)optval = sock->timer_fd;
+		status = TRUE;
+		break;
+#endif
+
 /* ACK or congestion socket */
 	case PGM_ACK_SOCK:
 		if (PGM_UNLIKELY(!sock->is_connected))
@@ -741,7 +806,7 @@ pgm_getsockopt (
 			break;
 		{
 			struct timeval* tv = optval;
-			const long usecs = (long)pgm_timer_expiration (sock);
+			const long usecs = (long)pgm_timer_expiration (sock, pgm_time_sample());
 			tv->tv_sec  = usecs / 1000000L;
 			tv->tv_usec = usecs % 1000000L;
 		}
@@ -939,6 +1004,13 @@ pgm_getsockopt (
 		status = TRUE;
 		break;
 
+	case PGM_REPAIR_DEADLINE:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = (int)sock->repair_deadline;
+		status = TRUE;
+		break;
+
 	case PGM_NAK_DATA_RETRIES:
 		if (PGM_UNLIKELY(*optlen != sizeof (int)))
 			break;
@@ -986,6 +1058,61 @@ pgm_getsockopt (
 		status = TRUE;
 		break;
 
+	case PGM_CC_ALGORITHM:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = (&pgm_cc_cubic == sock->cc_ops) ? PGM_CC_CUBIC : PGM_CC_RENO;
+		status = TRUE;
+		break;
+
+	case PGM_HOST_NAK_SUPPRESSION:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->use_host_nak_suppression ? 1 : 0;
+		status = TRUE;
+		break;
+
+	case PGM_REDUNDANT_SEND_GROUP:
+		if (PGM_UNLIKELY(*optlen != sizeof (struct pgm_group_source_req)))
+			break;
+		if (PGM_UNLIKELY(INVALID_SOCKET == sock->redundant_send_sock))
+			break;
+		{
+			struct pgm_group_source_req* gsr = optval;
+			memset (gsr, 0, sizeof (struct pgm_group_source_req));
+			gsr->gsr_interface = sock->redundant_send_interface;
+			memcpy (&gsr->gsr_group, &sock->redundant_send_group, sizeof (struct sockaddr_storage));
+			memcpy (&gsr->gsr_source, &sock->redundant_send_group, sizeof (struct sockaddr_storage));
+			memcpy (&gsr->gsr_addr, &sock->redundant_send_addr, sizeof (struct sockaddr_storage));
+		}
+		status = TRUE;
+		break;
+
+	case PGM_REDUNDANT_TSI:
+		if (PGM_UNLIKELY(*optlen != sizeof (sock->redundant_tsi)))
+			break;
+		if (PGM_UNLIKELY(!sock->use_redundant_tsi))
+			break;
+		memcpy (optval, sock->redundant_tsi, sizeof (sock->redundant_tsi));
+		status = TRUE;
+		break;
+
+	case PGM_REDUNDANT_RECV_GROUP:
+		if (PGM_UNLIKELY(*optlen != sizeof (struct group_req)))
+			break;
+		if (PGM_UNLIKELY(!sock->use_redundant_group))
+			break;
+		memcpy (optval, &sock->redundant_recv_gr, sizeof (struct group_req));
+		status = TRUE;
+		break;
+
+	case PGM_SPM_SCHEDULER:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->use_spm_scheduler ? 1 : 0;
+		status = TRUE;
+		break;
+
 	case PGM_SEND_ONLY:
 		if (PGM_UNLIKELY(*optlen != sizeof (int)))
 			break;
@@ -1021,6 +1148,74 @@ pgm_getsockopt (
 		status = TRUE;
 		break;
 
+	case PGM_UNORDERED:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->is_unordered ? 1 : 0;
+		status = TRUE;
+		break;
+
+	case PGM_DECODE_THREADS:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->decode_threads;
+		status = TRUE;
+		break;
+
+	case PGM_ENGINE_THREAD:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->use_engine_thread ? 1 : 0;
+		status = TRUE;
+		break;
+
+	case PGM_ENGINE_AFFINITY:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->engine_affinity;
+		status = TRUE;
+		break;
+
+	case PGM_USE_TIMERFD:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->use_timerfd ? 1 : 0;
+		status = TRUE;
+		break;
+
+	case PGM_UNICAST_REPAIR:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->use_unicast_repair ? 1 : 0;
+		status = TRUE;
+		break;
+
+	case PGM_DLR:
+		if (PGM_UNLIKELY(*optlen != sizeof (int)))
+			break;
+		*(int*restrict)optval = sock->dlr_sqns;
+		status = TRUE;
+		break;
+
+	case PGM_DLR_REDIRECT:
+		if (PGM_UNLIKELY(*optlen != sizeof (struct sockaddr_storage)))
+			break;
+		memcpy (optval, &sock->dlr_redirect_addr, sizeof (struct sockaddr_storage));
+		status = TRUE;
+		break;
+
+	case PGM_ADAPT_FEC:
+		if (PGM_UNLIKELY(*optlen != sizeof (struct pgm_adaptfecinfo_t)))
+			break;
+		{
+			struct pgm_adaptfecinfo_t*restrict adaptfecinfo = optval;
+			adaptfecinfo->min_proactive_packets = sock->rs_proactive_h_min;
+			adaptfecinfo->max_proactive_packets = sock->rs_proactive_h_max;
+			adaptfecinfo->target_nak_ppm	    = sock->use_adaptive_parity ? sock->parity_target_ppm : 0;
+		}
+		status = TRUE;
+		break;
+
 	case PGM_SEND_GROUP:
 		if (PGM_UNLIKELY(*optlen != sizeof (struct group_req)))
 			break;
@@ -1098,6 +1293,9 @@ pgm_setsockopt (
 		if (SOCKET_ERROR == setsockopt (sock->send_sock, SOL_SOCKET, SO_SNDBUF, (const char*)optval, optlen) ||
 		    SOCKET_ERROR == setsockopt (sock->send_with_router_alert_sock, SOL_SOCKET, SO_SNDBUF, (const char*)optval, optlen))
 			break;
+		if (INVALID_SOCKET != sock->redundant_send_sock &&
+		    SOCKET_ERROR == setsockopt (sock->redundant_send_sock, SOL_SOCKET, SO_SNDBUF, (const char*)optval, optlen))
+			break;
 		status = TRUE;
 		break;
 
@@ -1158,6 +1356,9 @@ pgm_setsockopt (
 			if (SOCKET_ERROR == pgm_sockaddr_multicast_loop (sock->send_sock, sock->family, v) ||
 			    SOCKET_ERROR == pgm_sockaddr_multicast_loop (sock->send_with_router_alert_sock, sock->family, v))
 				break;
+			if (INVALID_SOCKET != sock->redundant_send_sock &&
+			    SOCKET_ERROR == pgm_sockaddr_multicast_loop (sock->redundant_send_sock, sock->family, v))
+				break;
 #else		/* loop on receive */
 			if (SOCKET_ERROR == pgm_sockaddr_multicast_loop (sock->recv_sock, sock->family, v))
 				break;
@@ -1180,6 +1381,9 @@ pgm_setsockopt (
 			if (SOCKET_ERROR == pgm_sockaddr_multicast_hops (sock->send_sock, sock->family, sock->hops) ||
 			    SOCKET_ERROR == pgm_sockaddr_multicast_hops (sock->send_with_router_alert_sock, sock->family, sock->hops))
 				break;
+			if (INVALID_SOCKET != sock->redundant_send_sock &&
+			    SOCKET_ERROR == pgm_sockaddr_multicast_hops (sock->redundant_send_sock, sock->family, sock->hops))
+				break;
 		}
 		status = TRUE;
 		break;
@@ -1190,7 +1394,9 @@ pgm_setsockopt (
 		if (PGM_UNLIKELY(optlen != sizeof (int)))
 			break;
 		if (SOCKET_ERROR == pgm_sockaddr_tos (sock->send_sock, sock->family, *(const int*)optval) ||
-		    SOCKET_ERROR == pgm_sockaddr_tos (sock->send_with_router_alert_sock, sock->family, *(const int*)optval))
+		    SOCKET_ERROR == pgm_sockaddr_tos (sock->send_with_router_alert_sock, sock->family, *(const int*)optval) ||
+		    (INVALID_SOCKET != sock->redundant_send_sock &&
+		     SOCKET_ERROR == pgm_sockaddr_tos (sock->redundant_send_sock, sock->family, *(const int*)optval)))
 		{
 			pgm_warn (_("ToS/DSCP setting requires CAP_NET_ADMIN or ADMIN capability."));
 			break;
@@ -1410,6 +1616,18 @@ pgm_setsockopt (
 		status = TRUE;
 		break;
 
+/* age after which a missing packet is no longer repaired, the receiver marks
+ * the sequence lost and the source ignores NAKs for it.  zero disables.
+ */
+	case PGM_REPAIR_DEADLINE:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval < 0))
+			break;
+		sock->repair_deadline = *(const int*)optval;
+		status = TRUE;
+		break;
+
 /* limit for data.
  * 0 < nak_data_retries < 256
  */
@@ -1480,6 +1698,8 @@ pgm_setsockopt (
 			sock->rs_n			= fecinfo->block_size;
 			sock->rs_k			= fecinfo->group_size;
 			sock->rs_proactive_h		= fecinfo->proactive_packets;
+			sock->tg_sqn_shift		= (uint8_t)pgm_power2_log2 (fecinfo->group_size);
+			sock->use_adaptive_parity	= FALSE;
 		}
 		status = TRUE;
 		break;
@@ -1509,6 +1729,127 @@ pgm_setsockopt (
 		status = TRUE;
 		break;
 
+/* window algorithm of PGMCC, Reno as RFC 3208 or CUBIC for paths with a
+ * large bandwidth-delay product.
+ */
+	case PGM_CC_ALGORITHM:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		{
+			const pgm_cc_ops_t* cc_ops = pgm_cc_lookup (*(const int*)optval);
+			if (PGM_UNLIKELY(NULL == cc_ops))
+				break;
+			sock->cc_ops = cc_ops;
+		}
+		status = TRUE;
+		break;
+
+/* share selective NAKs with other receivers of the same user on the host
+ * through a shared memory segment, each round of NAK for a sequence is sent
+ * by one receiver and the rest wait on its NCF.  all processes subscribing
+ * to a source need the option for the host to send a single NAK.  a round
+ * suppressed here counts against PGM_NAK_NCF_RETRIES like one we sent: when
+ * the NCF for another receiver's NAK is missed the next round is claimed
+ * afresh, so loss is declared after the same number of rounds either way.
+ */
+	case PGM_HOST_NAK_SUPPRESSION:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		sock->use_host_nak_suppression = (0 != *(const int*)optval);
+		status = TRUE;
+		break;
+
+/* hot/hot feed, every multicast packet is sent a second time to this group
+ * through its own socket on the given interface, the B line carries the same
+ * TSI and sequence numbers as the A line of PGM_SEND_GROUP.  IP parameters and
+ * SO_SNDBUF apply to the B line when set after this option.
+ */
+	case PGM_REDUNDANT_SEND_GROUP:
+		if (PGM_UNLIKELY(optlen != sizeof (struct pgm_group_source_req)))
+			break;
+		if (PGM_UNLIKELY(!sock->can_send_data))
+			break;
+		{
+			const struct pgm_group_source_req* gsr = optval;
+			if (PGM_UNLIKELY(sock->family != gsr->gsr_group.ss_family ||
+					 sock->family != gsr->gsr_addr.ss_family))
+				break;
+			if (INVALID_SOCKET == sock->redundant_send_sock)
+			{
+				const SOCKET s = socket (sock->family,
+							 IPPROTO_UDP == sock->protocol ? SOCK_DGRAM : SOCK_RAW,
+							 sock->protocol);
+				if (INVALID_SOCKET == s) {
+					const int save_errno = pgm_get_last_sock_error();
+					char errbuf[1024];
+					pgm_warn (_("Creating redundant send socket: %s"),
+						  pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+					break;
+				}
+				if (sock->hops)
+					pgm_sockaddr_multicast_hops (s, sock->family, sock->hops);
+				pgm_sockaddr_nonblocking (s, sock->is_nonblocking);
+				sock->redundant_send_sock = s;
+			}
+			if (SOCKET_ERROR == pgm_sockaddr_multicast_if (sock->redundant_send_sock,
+								       (const struct sockaddr*)&gsr->gsr_addr,
+								       gsr->gsr_interface))
+				break;
+			sock->redundant_send_interface = gsr->gsr_interface;
+			memcpy (&sock->redundant_send_group, &gsr->gsr_group, sizeof (struct sockaddr_storage));
+			memcpy (&sock->redundant_send_addr, &gsr->gsr_addr, sizeof (struct sockaddr_storage));
+			if (sock->udp_encap_mcast_port)
+				((struct sockaddr_in*)&sock->redundant_send_group)->sin_port = htons (sock->udp_encap_mcast_port);
+		}
+		status = TRUE;
+		break;
+
+/* hot/hot feed from two sources, A line then B line.  data of the B line is
+ * delivered as the A line's and whichever copy of a sequence arrives first is
+ * kept, selective NAKs wait while the other line is live and behind.  SPMs of
+ * the B line are discarded so that NAKs always address the A line source.
+ */
+	case PGM_REDUNDANT_TSI:
+		if (PGM_UNLIKELY(optlen != sizeof (sock->redundant_tsi)))
+			break;
+		if (PGM_UNLIKELY(pgm_tsi_equal (&((const pgm_tsi_t*)optval)[0], &((const pgm_tsi_t*)optval)[1])))
+			break;
+		memcpy (sock->redundant_tsi, optval, sizeof (sock->redundant_tsi));
+		sock->use_redundant_tsi = TRUE;
+		status = TRUE;
+		break;
+
+/* hot/hot feed of one source sent to two groups with PGM_REDUNDANT_SEND_GROUP,
+ * both lines carry the same TSI so data arriving on this group is taken as the
+ * B line.  the group is still joined with PGM_JOIN_GROUP, otherwise the feed
+ * is handled as for PGM_REDUNDANT_TSI.
+ */
+	case PGM_REDUNDANT_RECV_GROUP:
+		if (PGM_UNLIKELY(optlen != sizeof (struct group_req)))
+			break;
+		{
+			const struct group_req* gr = optval;
+			if (PGM_UNLIKELY(sock->family != gr->gr_group.ss_family))
+				break;
+			if (PGM_UNLIKELY(!pgm_sockaddr_is_addr_multicast ((const struct sockaddr*)&gr->gr_group)))
+				break;
+			memcpy (&sock->redundant_recv_gr, gr, sizeof (struct group_req));
+		}
+		sock->use_redundant_group = TRUE;
+		status = TRUE;
+		break;
+
+/* ambient and heartbeat SPMs are sent by one thread shared by every socket
+ * in the process with this option, SPMR replies are queued to it.  ambient
+ * SPMs are jittered and skipped after a recent heartbeat.
+ */
+	case PGM_SPM_SCHEDULER:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		sock->use_spm_scheduler = (0 != *(const int*)optval);
+		status = TRUE;
+		break;
+
 /* declare socket only for sending, discard any incoming SPM, ODATA,
  * RDATA, etc, packets.
  */
@@ -1556,6 +1897,145 @@ pgm_setsockopt (
 		sock->is_nonblocking = (0 != *(const int*)optval);
 		pgm_sockaddr_nonblocking (sock->send_sock, sock->is_nonblocking);
 		pgm_sockaddr_nonblocking (sock->send_with_router_alert_sock, sock->is_nonblocking);
+		if (INVALID_SOCKET != sock->redundant_send_sock)
+			pgm_sockaddr_nonblocking (sock->redundant_send_sock, sock->is_nonblocking);
+		status = TRUE;
+		break;
+
+/* deliver complete APDUs as they arrive ahead of missing sequences, gaps
+ * continue recovery and unrecoverable loss is reported as a session reset.
+ */
+	case PGM_UNORDERED:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		sock->is_unordered = (0 != *(const int*)optval);
+		status = TRUE;
+		break;
+
+/* worker threads for parity recovery, zero decodes inline on the receive path.
+ * 0 <= decode_threads <= 255
+ */
+	case PGM_DECODE_THREADS:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval < 0))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval > UINT8_MAX))
+			break;
+		sock->decode_threads = *(const int*)optval;
+		status = TRUE;
+		break;
+
+/* drive timers, repairs and SPMs from a dedicated thread, completed APDUs
+ * are queued for the application.
+ */
+	case PGM_ENGINE_THREAD:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		sock->use_engine_thread = (0 != *(const int*)optval);
+		status = TRUE;
+		break;
+
+/* processor for the engine thread, -1 leaves scheduling to the system.
+ * -1 <= engine_affinity
+ */
+	case PGM_ENGINE_AFFINITY:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval < -1))
+			break;
+		sock->engine_affinity = *(const int*)optval;
+		status = TRUE;
+		break;
+
+#ifdef HAVE_TIMERFD
+/* export a timer descriptor armed to the next protocol deadline through
+ * pgm_poll_info() and pgm_epoll_ctl(), replacing PGM_TIME_REMAIN.
+ */
+	case PGM_USE_TIMERFD:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		sock->use_timerfd = (0 != *(const int*)optval);
+		status = TRUE;
+		break;
+#endif
+
+/* send a selective repair only to the receiver when a single receiver asked
+ * for it, several requesters revert to multicast RDATA.  keep disabled when
+ * UDP encapsulated sockets share a host and port, with each other or with the
+ * source, as a unicast datagram reaches only one of them.  fixed once bound.
+ */
+	case PGM_UNICAST_REPAIR:
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		sock->use_unicast_repair = (0 != *(const int*)optval);
+		status = TRUE;
+		break;
+
+/* act as designated local repairer for the subnet, caching the given number
+ * of sequences per source to answer redirected NAKs.  receivers of the subnet
+ * learn the repairer from its periodic TTL 1 POLR, as with unicast repairs a
+ * UDP encapsulated repairer needs a host or port of its own.  repairs are
+ * regulated by PGM_RDATA_MAX_RTE.
+ * 0 <= dlr_sqns <= 2^24, 0 disables.
+ */
+	case PGM_DLR:
+		if (PGM_UNLIKELY(optlen != sizeof (int)))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval < 0))
+			break;
+		if (PGM_UNLIKELY(*(const int*)optval > (1 << 24)))
+			break;
+		sock->dlr_sqns = *(const int*)optval;
+		status = TRUE;
+		break;
+
+/* follow the OPT_REDIRECT of POLRs sent by the given repairer, sending our
+ * selective NAKs to it instead of the source.  POLRs from any other address
+ * are ignored, as is every redirect without this option.
+ */
+	case PGM_DLR_REDIRECT:
+		if (PGM_UNLIKELY(sock->is_bound))
+			break;
+		if (PGM_UNLIKELY(optlen < sizeof (struct sockaddr)))
+			break;
+		if (PGM_UNLIKELY(AF_INET != ((const struct sockaddr*)optval)->sa_family &&
+				 AF_INET6 != ((const struct sockaddr*)optval)->sa_family))
+			break;
+		if (PGM_UNLIKELY(optlen != pgm_sockaddr_len ((const struct sockaddr*)optval)))
+			break;
+		memset (&sock->dlr_redirect_addr, 0, sizeof (struct sockaddr_storage));
+		memcpy (&sock->dlr_redirect_addr, optval, optlen);
+		status = TRUE;
+		break;
+
+/* tune the count of proactive parity packets per transmission group between
+ * the given bounds to hold residual NAKs near the target rate.  requires
+ * PGM_USE_FEC beforehand, which in turn cancels adaptation.
+ * 0 <= min <= max <= ( n - k ), 0 < target <= 10^6.
+ */
+	case PGM_ADAPT_FEC:
+		if (PGM_UNLIKELY(optlen != sizeof (struct pgm_adaptfecinfo_t)))
+			break;
+		if (PGM_UNLIKELY(0 == sock->rs_k))
+			break;
+		{
+			const struct pgm_adaptfecinfo_t* adaptfecinfo = optval;
+			if (PGM_UNLIKELY(adaptfecinfo->min_proactive_packets > adaptfecinfo->max_proactive_packets))
+				break;
+			if (PGM_UNLIKELY(adaptfecinfo->max_proactive_packets > sock->rs_n - sock->rs_k))
+				break;
+			if (PGM_UNLIKELY(0 == adaptfecinfo->target_nak_ppm || adaptfecinfo->target_nak_ppm > 1000000))
+				break;
+			sock->use_proactive_parity	= TRUE;
+			sock->use_adaptive_parity	= TRUE;
+			sock->rs_proactive_h_min	= adaptfecinfo->min_proactive_packets;
+			sock->rs_proactive_h_max	= adaptfecinfo->max_proactive_packets;
+			sock->rs_proactive_h		= MIN(MAX(sock->rs_proactive_h, sock->rs_proactive_h_min), sock->rs_proactive_h_max);
+			sock->parity_target_ppm		= adaptfecinfo->target_nak_ppm;
+		}
 		status = TRUE;
 		break;
 
@@ -1885,6 +2365,7 @@ pgm_setsockopt (
 	case PGM_REPAIR_SOCK:
 	case PGM_PENDING_SOCK:
 	case PGM_ACK_SOCK:
+	case PGM_TIMER_SOCK:
 	case PGM_TIME_REMAIN:
 	case PGM_RATE_REMAIN:
 	default:
@@ -2152,7 +2633,7 @@ pgm_bind3 (
 		pgm_trace (PGM_LOG_ROLE_TX_WINDOW,_("Create transmit window."));
 		sock->window = sock->txw_sqns ?
 					pgm_txw_create (&sock->tsi,
-							0,			/* MAX_TPDU */
+							sock->max_tpdu,		/* MAX_TPDU */
 							sock->txw_sqns,		/* TXW_SQNS */
 							0,			/* TXW_SECS */
 							0,			/* TXW_MAX_RTE */
@@ -2174,6 +2655,13 @@ pgm_bind3 (
 	if (sock->can_recv_data) {
 		sock->peers_hashtable = pgm_hashtable_new (pgm_tsi_hash, pgm_tsi_equal);
 		pgm_assert (NULL != sock->peers_hashtable);
+		if (sock->decode_threads > 0) {
+			sock->decoder = pgm_decoder_create (sock, sock->decode_threads, error);
+			if (NULL == sock->decoder) {
+				pgm_rwlock_writer_unlock (&sock->lock);
+				return FALSE;
+			}
+		}
 	}
 
 /* Bind UDP sockets to interfaces, note multicast on a bound interface is
@@ -2387,6 +2875,14 @@ pgm_bind3 (
 			sock->is_controlled_rdata = TRUE;
 		}
 	}
+/* a receive only repairer regulates its subnet repairs alone */
+	else if (sock->dlr_sqns && sock->rdata_max_rte > 0)
+	{
+		pgm_trace (PGM_LOG_ROLE_RATE_CONTROL,_("Setting repairer RDATA rate regulation to %" PRIzd " bytes per second."),
+				sock->rdata_max_rte);
+		pgm_rate_create (&sock->rdata_rate_control, sock->rdata_max_rte, sock->iphdr_len, sock->max_tpdu);
+		sock->is_controlled_rdata = TRUE;
+	}
 
 /* allocate first incoming packet buffer */
 	sock->rx_buffer = pgm_alloc_skb (sock->max_tpdu);
@@ -2451,7 +2947,7 @@ pgm_connect (
 		sock->tokens = sock->cwnd_size = pgm_fp8 (1);
 
 /* slow start threshold */
-		sock->ssthresh = pgm_fp8 (4);
+		sock->cc_ops->on_start (sock);
 
 /* ACK timeout, should be greater than first SPM heartbeat interval in order to be scheduled correctly */
 		sock->ack_expiry_ivl = pgm_secs (3);
@@ -2465,6 +2961,56 @@ pgm_connect (
 		sock->next_poll = pgm_time_update_now() + pgm_secs( 30 );
 	}
 
+	if (sock->can_recv_data && sock->use_host_nak_suppression) {
+#ifndef _WIN32
+		char hostnak_name[sizeof (PGM_HOSTNAK_NAME) + 16];
+		pgm_snprintf_s (hostnak_name, sizeof (hostnak_name), _TRUNCATE, "%s.%lu",
+				PGM_HOSTNAK_NAME, (unsigned long)geteuid());
+		sock->hostnak = pgm_hostnak_attach (hostnak_name, error);
+#else
+		sock->hostnak = pgm_hostnak_attach (PGM_HOSTNAK_NAME, error);
+#endif
+		if (PGM_UNLIKELY(NULL == sock->hostnak)) {
+			pgm_rwlock_writer_unlock (&sock->lock);
+			return FALSE;
+		}
+	}
+
+	if (sock->can_send_data && sock->use_spm_scheduler) {
+		if (PGM_UNLIKELY(!pgm_spm_scheduler_add (sock, error))) {
+			pgm_rwlock_writer_unlock (&sock->lock);
+			return FALSE;
+		}
+	}
+
+	if (sock->use_engine_thread) {
+		sock->engine_thread = pgm_engine_thread_create (sock, sock->engine_affinity, error);
+		if (PGM_UNLIKELY(NULL == sock->engine_thread)) {
+			pgm_rwlock_writer_unlock (&sock->lock);
+			return FALSE;
+		}
+/* engine thread runs the timers itself */
+		sock->use_timerfd = FALSE;
+	}
+
+#ifdef HAVE_TIMERFD
+	if (sock->use_timerfd) {
+		sock->timer_fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (PGM_UNLIKELY(-1 == sock->timer_fd)) {
+			const int save_errno = errno;
+			char errbuf[1024];
+			pgm_set_error (error,
+				       PGM_ERROR_DOMAIN_SOCKET,
+				       pgm_error_from_errno (save_errno),
+				       _("Creating timer descriptor: %s"),
+				       pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+			pgm_rwlock_writer_unlock (&sock->lock);
+			return FALSE;
+		}
+		pgm_timer_arm (sock);
+	}
+#endif
+
 	sock->is_connected = TRUE;
 
 /* cleanup */
@@ -2498,6 +3044,19 @@ pgm_getsockname (
 	return TRUE;
 }
 
+/* returns TRUE if application threads should wait on the engine delivery
+ * queue rather than the network.
+ */
+
+static inline
+bool
+_pgm_has_engine_thread (
+	const pgm_sock_t* const sock
+	)
+{
+	return (NULL != sock->engine_thread && !pgm_engine_thread_is_current (sock->engine_thread));
+}
+
 /* add select parameters for the receive socket(s)
  *
  * returns highest file descriptor used plus one.
@@ -2523,7 +3082,17 @@ pgm_select_info (
 
 	const bool is_congested = (sock->use_pgmcc && sock->tokens < pgm_fp8 (1)) ? TRUE : FALSE;
 
-	if (readfds)
+	if (readfds && _pgm_has_engine_thread (sock))
+	{
+		const SOCKET deliver_fd = pgm_engine_thread_get_socket (sock->engine_thread);
+		FD_SET(deliver_fd, readfds);
+#ifndef _WIN32
+		fds = deliver_fd + 1;
+#else
+		fds = 1;
+#endif
+	}
+	else if (readfds)
 	{
 		FD_SET(sock->recv_sock, readfds);
 #ifndef _WIN32
@@ -2555,6 +3124,12 @@ pgm_select_info (
 		fds = MAX(fds, pending_fd + 1);
 #else
 		fds++;
+#endif
+#ifdef HAVE_TIMERFD
+		if (sock->use_timerfd) {
+			FD_SET(sock->timer_fd, readfds);
+			fds = MAX(fds, sock->timer_fd + 1);
+		}
 #endif
 	}
 
@@ -2625,8 +3200,16 @@ pgm_wsapoll_info (
 		return SOCKET_ERROR;
 	}
 
+/* engine thread owns the network, only the delivery queue is visible */
+	if (events & PGM_POLLIN && _pgm_has_engine_thread (sock))
+	{
+		pgm_assert ( (1 + nfds) <= *n_fds );
+		fds[nfds].fd = pgm_engine_thread_get_socket (sock->engine_thread);
+		fds[nfds].events = PGM_POLLIN;
+		nfds++;
+	}
 /* we currently only support one incoming socket */
-	if (events & PGM_POLLIN)
+	else if (events & PGM_POLLIN)
 	{
 		pgm_assert ( (1 + nfds) <= *n_fds );
 		fds[nfds].fd = sock->recv_sock;
@@ -2642,6 +3225,14 @@ pgm_wsapoll_info (
 		fds[nfds].fd = pgm_notify_get_socket (&sock->pending_notify);
 		fds[nfds].events = PGM_POLLIN;
 		nfds++;
+#ifdef HAVE_TIMERFD
+		if (sock->use_timerfd) {
+			pgm_assert ( (1 + nfds) <= *n_fds );
+			fds[nfds].fd = sock->timer_fd;
+			fds[nfds].events = PGM_POLLIN;
+			nfds++;
+		}
+#endif
 	}
 
 /* ODATA only published on regular socket, no need to poll router-alert sock */
@@ -2693,7 +3284,18 @@ pgm_epoll_ctl (
 		return SOCKET_ERROR;
 	}
 
-	if (events & EPOLLIN)
+	if (events & EPOLLIN && _pgm_has_engine_thread (sock))
+	{
+		event.events = events & (EPOLLIN | EPOLLET | EPOLLONESHOT);
+		event.data.ptr = sock;
+		retval = epoll_ctl (epfd, op, pgm_engine_thread_get_socket (sock->engine_thread), &event);
+		if (retval)
+			goto out;
+
+		if (events & EPOLLET)
+			sock->is_edge_triggered_recv = TRUE;
+	}
+	else if (events & EPOLLIN)
 	{
 		event.events = events & (EPOLLIN | EPOLLET | EPOLLONESHOT);
 		event.data.ptr = sock;
@@ -2708,6 +3310,13 @@ pgm_epoll_ctl (
 		retval = epoll_ctl (epfd, op, pgm_notify_get_socket (&sock->pending_notify), &event);
 		if (retval)
 			goto out;
+#ifdef HAVE_TIMERFD
+		if (sock->use_timerfd) {
+			retval = epoll_ctl (epfd, op, sock->timer_fd, &event);
+			if (retval)
+				goto out;
+		}
+#endif
 
 		if (events & EPOLLET)
 			sock->is_edge_triggered_recv = TRUE;
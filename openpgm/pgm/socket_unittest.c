@@ -62,6 +62,7 @@
 #define pgm_timer_check		mock_pgm_timer_check
 #define pgm_timer_expiration	mock_pgm_timer_expiration
 #define pgm_timer_dispatch	mock_pgm_timer_dispatch
+#define pgm_timer_arm	mock_pgm_timer_arm
 #define pgm_txw_create		mock_pgm_txw_create
 #define pgm_txw_shutdown	mock_pgm_txw_shutdown
 #define pgm_rate_create		mock_pgm_rate_create
@@ -70,6 +71,20 @@
 #define pgm_rs_create		mock_pgm_rs_create
 #define pgm_rs_destroy		mock_pgm_rs_destroy
 #define pgm_time_update_now	mock_pgm_time_update_now
+#define pgm_decoder_create	mock_pgm_decoder_create
+#define pgm_decoder_destroy	mock_pgm_decoder_destroy
+#define pgm_engine_thread_create	mock_pgm_engine_thread_create
+#define pgm_engine_thread_stop		mock_pgm_engine_thread_stop
+#define pgm_engine_thread_destroy	mock_pgm_engine_thread_destroy
+#define pgm_engine_thread_is_current	mock_pgm_engine_thread_is_current
+#define pgm_engine_thread_get_socket	mock_pgm_engine_thread_get_socket
+#define pgm_cc_reno		mock_pgm_cc_reno
+#define pgm_cc_cubic		mock_pgm_cc_cubic
+#define pgm_cc_lookup		mock_pgm_cc_lookup
+#define pgm_hostnak_attach	mock_pgm_hostnak_attach
+#define pgm_hostnak_detach	mock_pgm_hostnak_detach
+#define pgm_spm_scheduler_add	mock_pgm_spm_scheduler_add
+#define pgm_spm_scheduler_remove	mock_pgm_spm_scheduler_remove
 
 #define SOCK_DEBUG
 #include "socket.c"
@@ -180,6 +195,7 @@ generate_sock (void)
 	sock->recv_sock = socket (AF_INET, SOCK_RAW, 113);
 	sock->send_sock = socket (AF_INET, SOCK_RAW, 113);
 	sock->send_with_router_alert_sock = socket (AF_INET, SOCK_RAW, 113);
+	sock->redundant_send_sock = INVALID_SOCKET;
 	((struct sockaddr*)&sock->send_addr)->sa_family = AF_INET;
 	((struct sockaddr_in*)&sock->send_addr)->sin_addr.s_addr = inet_addr ("127.0.0.2");
 	sock->dport = g_htons(TEST_PORT);
@@ -199,6 +215,136 @@ mock_pgm_peer_unref (
 {
 }
 
+/** decoder module */
+PGM_GNUC_INTERNAL
+pgm_decoder_t*
+mock_pgm_decoder_create (
+	pgm_sock_t* const	sock,
+	const unsigned		n_threads,
+	pgm_error_t**		error
+	)
+{
+	return (pgm_decoder_t*)0x1;
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_decoder_destroy (
+	pgm_decoder_t* const	decoder
+	)
+{
+}
+
+/** congestion module */
+static
+void
+mock_cc_on_start (
+	pgm_sock_t* const	sock
+	)
+{
+}
+
+const pgm_cc_ops_t mock_pgm_cc_reno = { .name = "reno", .on_start = mock_cc_on_start };
+const pgm_cc_ops_t mock_pgm_cc_cubic = { .name = "cubic", .on_start = mock_cc_on_start };
+
+PGM_GNUC_INTERNAL
+const pgm_cc_ops_t*
+mock_pgm_cc_lookup (
+	const int		algorithm
+	)
+{
+	switch (algorithm) {
+	case PGM_CC_RENO:	return &mock_pgm_cc_reno;
+	case PGM_CC_CUBIC:	return &mock_pgm_cc_cubic;
+	default:		return NULL;
+	}
+}
+
+/** host NAK suppression module */
+PGM_GNUC_INTERNAL
+pgm_hostnak_t*
+mock_pgm_hostnak_attach (
+	const char*		name,
+	pgm_error_t**		error
+	)
+{
+	return g_malloc0 (sizeof (pgm_hostnak_t));
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_hostnak_detach (
+	pgm_hostnak_t* const	hostnak
+	)
+{
+	g_free (hostnak);
+}
+
+/** SPM scheduler module */
+PGM_GNUC_INTERNAL
+bool
+mock_pgm_spm_scheduler_add (
+	pgm_sock_t* const	sock,
+	pgm_error_t**		error
+	)
+{
+	return TRUE;
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_spm_scheduler_remove (
+	pgm_sock_t* const	sock
+	)
+{
+}
+
+/** engine thread module */
+PGM_GNUC_INTERNAL
+pgm_engine_thread_t*
+mock_pgm_engine_thread_create (
+	pgm_sock_t* const	sock,
+	const int		cpu,
+	pgm_error_t**		error
+	)
+{
+	return (pgm_engine_thread_t*)0x1;
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_engine_thread_stop (
+	pgm_engine_thread_t* const	engine
+	)
+{
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_engine_thread_destroy (
+	pgm_engine_thread_t* const	engine
+	)
+{
+}
+
+PGM_GNUC_INTERNAL
+bool
+mock_pgm_engine_thread_is_current (
+	const pgm_engine_thread_t* const	engine
+	)
+{
+	return FALSE;
+}
+
+PGM_GNUC_INTERNAL
+SOCKET
+mock_pgm_engine_thread_get_socket (
+	pgm_engine_thread_t* const	engine
+	)
+{
+	return INVALID_SOCKET;
+}
+
 /** source module */
 static
 bool
@@ -234,7 +380,8 @@ mock_pgm_timer_prepare (
 PGM_GNUC_INTERNAL
 bool
 mock_pgm_timer_check (
-	pgm_sock_t* const		sock
+	pgm_sock_t* const		sock,
+	const pgm_time_t		now
 	)
 {
 	return FALSE;
@@ -243,7 +390,8 @@ mock_pgm_timer_check (
 PGM_GNUC_INTERNAL
 pgm_time_t
 mock_pgm_timer_expiration (
-	pgm_sock_t* const		sock
+	pgm_sock_t* const		sock,
+	const pgm_time_t		now
 	)
 {
 	return 100L;
@@ -252,12 +400,21 @@ mock_pgm_timer_expiration (
 PGM_GNUC_INTERNAL
 bool
 mock_pgm_timer_dispatch (
-	pgm_sock_t* const		sock
+	pgm_sock_t* const		sock,
+	const pgm_time_t		now
 	)
 {
 	return TRUE;
 }
 
+PGM_GNUC_INTERNAL
+void
+mock_pgm_timer_arm (
+	pgm_sock_t* const		sock
+	)
+{
+}
+
 /** transmit window module */
 pgm_txw_t*
 mock_pgm_txw_create (
@@ -807,6 +964,9 @@ START_TEST (test_set_fec_pass_001)
 	const void* optval	= &fecinfo;
 	const socklen_t optlen	= sizeof(fecinfo);
 	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_fec failed");
+	fail_unless (64 == sock->rs_k, "rs_k failed");
+/* transmission group sequence mask must follow the group size */
+	fail_unless (6 == sock->tg_sqn_shift, "tg_sqn_shift failed");
 }
 END_TEST
 
@@ -873,6 +1033,216 @@ START_TEST (test_set_pgmcc_fail_001)
 }
 END_TEST
 
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_CC_ALGORITHM,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(int)
+ *	)
+ */
+
+START_TEST (test_set_cc_algorithm_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_CC_ALGORITHM;
+	const int algorithm	= PGM_CC_CUBIC;
+	const void* optval	= &algorithm;
+	const socklen_t optlen	= sizeof(algorithm);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_cc_algorithm failed");
+	fail_unless (&mock_pgm_cc_cubic == sock->cc_ops, "cc_ops failed");
+}
+END_TEST
+
+START_TEST (test_set_cc_algorithm_fail_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_CC_ALGORITHM;
+	const int algorithm	= -1;
+	const void* optval	= &algorithm;
+	const socklen_t optlen	= sizeof(algorithm);
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_cc_algorithm failed");
+	fail_unless (FALSE == pgm_setsockopt (NULL, level, optname, optval, optlen), "set_cc_algorithm failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_HOST_NAK_SUPPRESSION,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(int)
+ *	)
+ */
+
+START_TEST (test_set_host_nak_suppression_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_HOST_NAK_SUPPRESSION;
+	const int enabled	= 1;
+	const void* optval	= &enabled;
+	const socklen_t optlen	= sizeof(enabled);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_host_nak_suppression failed");
+	fail_unless (TRUE == sock->use_host_nak_suppression, "use_host_nak_suppression failed");
+}
+END_TEST
+
+START_TEST (test_set_host_nak_suppression_fail_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_HOST_NAK_SUPPRESSION;
+	const int enabled	= 1;
+	const void* optval	= &enabled;
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, sizeof(char)), "set_host_nak_suppression failed");
+	fail_unless (FALSE == pgm_setsockopt (NULL, level, optname, optval, sizeof(enabled)), "set_host_nak_suppression failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_REDUNDANT_SEND_GROUP,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(struct pgm_group_source_req)
+ *	)
+ */
+
+START_TEST (test_set_redundant_send_group_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->can_send_data = TRUE;
+	sock->protocol = IPPROTO_PGM;
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_REDUNDANT_SEND_GROUP;
+	struct pgm_group_source_req gsr;
+	memset (&gsr, 0, sizeof(gsr));
+	((struct sockaddr_in*)&gsr.gsr_group)->sin_family = AF_INET;
+	((struct sockaddr_in*)&gsr.gsr_group)->sin_addr.s_addr = inet_addr ("239.192.0.2");
+	((struct sockaddr_in*)&gsr.gsr_addr)->sin_family = AF_INET;
+	((struct sockaddr_in*)&gsr.gsr_addr)->sin_addr.s_addr = inet_addr ("127.0.0.1");
+	const void* optval	= &gsr;
+	const socklen_t optlen	= sizeof(gsr);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_redundant_send_group failed");
+	fail_unless (INVALID_SOCKET != sock->redundant_send_sock, "redundant_send_sock failed");
+	fail_unless (0 == pgm_sockaddr_cmp ((struct sockaddr*)&gsr.gsr_group, (struct sockaddr*)&sock->redundant_send_group), "redundant_send_group failed");
+}
+END_TEST
+
+START_TEST (test_set_redundant_send_group_fail_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_REDUNDANT_SEND_GROUP;
+	struct pgm_group_source_req gsr;
+	memset (&gsr, 0, sizeof(gsr));
+	((struct sockaddr_in*)&gsr.gsr_group)->sin_family = AF_INET;
+	((struct sockaddr_in*)&gsr.gsr_addr)->sin_family = AF_INET;
+	const void* optval	= &gsr;
+/* receive-only */
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, sizeof(gsr)), "set_redundant_send_group failed");
+	sock->can_send_data = TRUE;
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, sizeof(struct group_req)), "set_redundant_send_group failed");
+	((struct sockaddr_in6*)&gsr.gsr_group)->sin6_family = AF_INET6;
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, sizeof(gsr)), "set_redundant_send_group failed");
+	fail_unless (INVALID_SOCKET == sock->redundant_send_sock, "redundant_send_sock failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_REDUNDANT_TSI,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(pgm_tsi_t) * 2
+ *	)
+ */
+
+START_TEST (test_set_redundant_tsi_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_REDUNDANT_TSI;
+	const pgm_tsi_t tsi[2]	= { { { 1, 2, 3, 4, 5, 6 }, 1000 }, { { 1, 2, 3, 4, 5, 7 }, 1000 } };
+	const void* optval	= tsi;
+	const socklen_t optlen	= sizeof(tsi);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_redundant_tsi failed");
+	fail_unless (TRUE == sock->use_redundant_tsi, "use_redundant_tsi failed");
+	fail_unless (pgm_tsi_equal (&tsi[1], &sock->redundant_tsi[1]), "redundant_tsi failed");
+}
+END_TEST
+
+START_TEST (test_set_redundant_tsi_fail_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_REDUNDANT_TSI;
+	const pgm_tsi_t tsi[2]	= { { { 1, 2, 3, 4, 5, 6 }, 1000 }, { { 1, 2, 3, 4, 5, 6 }, 1000 } };
+	const void* optval	= tsi;
+/* one line cannot back itself up */
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, sizeof(tsi)), "set_redundant_tsi failed");
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, sizeof(pgm_tsi_t)), "set_redundant_tsi failed");
+	fail_unless (FALSE == pgm_setsockopt (NULL, level, optname, optval, sizeof(tsi)), "set_redundant_tsi failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_SPM_SCHEDULER,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(int)
+ *	)
+ */
+
+START_TEST (test_set_spm_scheduler_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_SPM_SCHEDULER;
+	const int enabled	= 1;
+	const void* optval	= &enabled;
+	const socklen_t optlen	= sizeof(enabled);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_spm_scheduler failed");
+	fail_unless (TRUE == sock->use_spm_scheduler, "use_spm_scheduler failed");
+}
+END_TEST
+
+START_TEST (test_set_spm_scheduler_fail_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_SPM_SCHEDULER;
+	const int enabled	= 1;
+	const void* optval	= &enabled;
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, sizeof(char)), "set_spm_scheduler failed");
+	fail_unless (FALSE == pgm_setsockopt (NULL, level, optname, optval, sizeof(enabled)), "set_spm_scheduler failed");
+}
+END_TEST
+
 /* target:
  *	bool
  *	pgm_setsockopt (
@@ -1084,6 +1454,218 @@ START_TEST (test_set_noblock_fail_001)
 }
 END_TEST
 
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_UNORDERED,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(int)
+ *	)
+ */
+
+START_TEST (test_set_unordered_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_UNORDERED;
+	const int unordered	= 1;
+	const void* optval	= &unordered;
+	const socklen_t optlen	= sizeof(unordered);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_unordered failed");
+}
+END_TEST
+
+START_TEST (test_set_unordered_fail_001)
+{
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_UNORDERED;
+	const int unordered	= 1;
+	const void* optval	= &unordered;
+	const socklen_t optlen	= sizeof(unordered);
+	fail_unless (FALSE == pgm_setsockopt (NULL, level, optname, optval, optlen), "set_unordered failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_REPAIR_DEADLINE,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(int)
+ *	)
+ */
+
+START_TEST (test_set_repair_deadline_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_REPAIR_DEADLINE;
+	const int deadline	= pgm_msecs(200);
+	const void* optval	= &deadline;
+	const socklen_t optlen	= sizeof(deadline);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_repair_deadline failed");
+}
+END_TEST
+
+START_TEST (test_set_repair_deadline_fail_001)
+{
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_REPAIR_DEADLINE;
+	const int deadline	= pgm_msecs(200);
+	const void* optval	= &deadline;
+	const socklen_t optlen	= sizeof(deadline);
+	fail_unless (FALSE == pgm_setsockopt (NULL, level, optname, optval, optlen), "set_repair_deadline failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_DECODE_THREADS,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(int)
+ *	)
+ */
+
+START_TEST (test_set_decode_threads_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_DECODE_THREADS;
+	const int threads	= 2;
+	const void* optval	= &threads;
+	const socklen_t optlen	= sizeof(threads);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_decode_threads failed");
+}
+END_TEST
+
+START_TEST (test_set_decode_threads_fail_001)
+{
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_DECODE_THREADS;
+	const int threads	= 2;
+	const void* optval	= &threads;
+	const socklen_t optlen	= sizeof(threads);
+	fail_unless (FALSE == pgm_setsockopt (NULL, level, optname, optval, optlen), "set_decode_threads failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_ENGINE_THREAD,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(int)
+ *	)
+ */
+
+START_TEST (test_set_engine_thread_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_ENGINE_THREAD;
+	const int engine	= 1;
+	const void* optval	= &engine;
+	const socklen_t optlen	= sizeof(engine);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_engine_thread failed");
+}
+END_TEST
+
+START_TEST (test_set_engine_thread_fail_001)
+{
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_ENGINE_THREAD;
+	const int engine	= 1;
+	const void* optval	= &engine;
+	const socklen_t optlen	= sizeof(engine);
+	fail_unless (FALSE == pgm_setsockopt (NULL, level, optname, optval, optlen), "set_engine_thread failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_ENGINE_AFFINITY,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(int)
+ *	)
+ */
+
+START_TEST (test_set_engine_affinity_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_ENGINE_AFFINITY;
+	const int cpu		= 0;
+	const void* optval	= &cpu;
+	const socklen_t optlen	= sizeof(cpu);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_engine_affinity failed");
+}
+END_TEST
+
+START_TEST (test_set_engine_affinity_fail_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_ENGINE_AFFINITY;
+	const int cpu		= -2;
+	const void* optval	= &cpu;
+	const socklen_t optlen	= sizeof(cpu);
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_engine_affinity failed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_USE_TIMERFD,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(int)
+ *	)
+ */
+
+START_TEST (test_set_use_timerfd_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_USE_TIMERFD;
+	const int timerfd	= 1;
+	const void* optval	= &timerfd;
+	const socklen_t optlen	= sizeof(timerfd);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_use_timerfd failed");
+}
+END_TEST
+
+START_TEST (test_set_use_timerfd_fail_001)
+{
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_USE_TIMERFD;
+	const int timerfd	= 1;
+	const void* optval	= &timerfd;
+	const socklen_t optlen	= sizeof(timerfd);
+	fail_unless (FALSE == pgm_setsockopt (NULL, level, optname, optval, optlen), "set_use_timerfd failed");
+}
+END_TEST
+
 /* target:
  *	bool
  *	pgm_setsockopt (
@@ -1154,6 +1736,143 @@ START_TEST (test_set_udp_multicast_fail_001)
 }
 END_TEST
 
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_UNICAST_REPAIR,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(int)
+ *	)
+ */
+
+START_TEST (test_set_unicast_repair_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_UNICAST_REPAIR;
+	const int unicast_repair = 1;
+	const void* optval	= &unicast_repair;
+	const socklen_t optlen	= sizeof(unicast_repair);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_unicast_repair failed");
+	fail_unless (TRUE == sock->use_unicast_repair, "use_unicast_repair failed");
+}
+END_TEST
+
+/* the repair path is fixed once bound */
+START_TEST (test_set_unicast_repair_fail_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->is_bound = TRUE;
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_UNICAST_REPAIR;
+	const int unicast_repair = 1;
+	const void* optval	= &unicast_repair;
+	const socklen_t optlen	= sizeof(unicast_repair);
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_unicast_repair failed");
+	fail_unless (FALSE == sock->use_unicast_repair, "use_unicast_repair changed");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_DLR_REDIRECT,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(struct sockaddr_in)
+ *	)
+ */
+
+START_TEST (test_set_dlr_redirect_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_DLR_REDIRECT;
+	struct sockaddr_in dlr	= {
+		.sin_family		= AF_INET,
+		.sin_addr.s_addr	= inet_addr ("127.0.0.2")
+	};
+	const void* optval	= &dlr;
+	const socklen_t optlen	= sizeof(dlr);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_dlr_redirect failed");
+	fail_unless (AF_INET == sock->dlr_redirect_addr.ss_family, "family failed");
+	fail_unless (dlr.sin_addr.s_addr == ((struct sockaddr_in*)&sock->dlr_redirect_addr)->sin_addr.s_addr, "address failed");
+}
+END_TEST
+
+/* address length must match its family */
+START_TEST (test_set_dlr_redirect_fail_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_DLR_REDIRECT;
+	struct sockaddr_in dlr	= {
+		.sin_family		= AF_INET,
+		.sin_addr.s_addr	= inet_addr ("127.0.0.2")
+	};
+	const void* optval	= &dlr;
+	const socklen_t optlen	= sizeof(dlr) - 1;
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_dlr_redirect failed");
+	fail_unless (AF_UNSPEC == sock->dlr_redirect_addr.ss_family, "repairer set");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_setsockopt (
+ *		pgm_sock_t* const	sock,
+ *		const int		level = IPPROTO_PGM,
+ *		const int		optname = PGM_REDUNDANT_RECV_GROUP,
+ *		const void*		optval,
+ *		const socklen_t		optlen = sizeof(struct group_req)
+ *	)
+ */
+
+START_TEST (test_set_redundant_recv_group_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_REDUNDANT_RECV_GROUP;
+	struct group_req gr;
+	memset (&gr, 0, sizeof(gr));
+	((struct sockaddr_in*)&gr.gr_group)->sin_family = AF_INET;
+	((struct sockaddr_in*)&gr.gr_group)->sin_addr.s_addr = inet_addr ("239.192.0.2");
+	const void* optval	= &gr;
+	const socklen_t optlen	= sizeof(gr);
+	fail_unless (TRUE == pgm_setsockopt (sock, level, optname, optval, optlen), "set_redundant_recv_group failed");
+	fail_unless (TRUE == sock->use_redundant_group, "use_redundant_group failed");
+	fail_unless (0 == pgm_sockaddr_cmp ((struct sockaddr*)&gr.gr_group, (struct sockaddr*)&sock->redundant_recv_gr.gr_group), "group failed");
+}
+END_TEST
+
+START_TEST (test_set_redundant_recv_group_fail_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const int level		= IPPROTO_PGM;
+	const int optname	= PGM_REDUNDANT_RECV_GROUP;
+	struct group_req gr;
+	memset (&gr, 0, sizeof(gr));
+	((struct sockaddr_in*)&gr.gr_group)->sin_family = AF_INET;
+	((struct sockaddr_in*)&gr.gr_group)->sin_addr.s_addr = inet_addr ("127.0.0.2");
+	const void* optval	= &gr;
+/* the B line arrives on a multicast group */
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, sizeof(gr)), "set_redundant_recv_group failed");
+	((struct sockaddr_in*)&gr.gr_group)->sin_addr.s_addr = inet_addr ("239.192.0.2");
+	fail_unless (FALSE == pgm_setsockopt (sock, level, optname, optval, sizeof(gr) - 1), "set_redundant_recv_group failed");
+	fail_unless (FALSE == pgm_setsockopt (NULL, level, optname, optval, sizeof(gr)), "set_redundant_recv_group failed");
+	fail_unless (FALSE == sock->use_redundant_group, "use_redundant_group set");
+}
+END_TEST
+
 static
 Suite*
 make_test_suite (void)
@@ -1231,6 +1950,36 @@ make_test_suite (void)
 	tcase_add_test (tc_set_pgmcc, test_set_pgmcc_pass_001);
 	tcase_add_test (tc_set_pgmcc, test_set_pgmcc_fail_001);
 
+	TCase* tc_set_cc_algorithm = tcase_create ("set-cc-algorithm");
+	suite_add_tcase (s, tc_set_cc_algorithm);
+	tcase_add_checked_fixture (tc_set_cc_algorithm, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_cc_algorithm, test_set_cc_algorithm_pass_001);
+	tcase_add_test (tc_set_cc_algorithm, test_set_cc_algorithm_fail_001);
+
+	TCase* tc_set_host_nak_suppression = tcase_create ("set-host-nak-suppression");
+	suite_add_tcase (s, tc_set_host_nak_suppression);
+	tcase_add_checked_fixture (tc_set_host_nak_suppression, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_host_nak_suppression, test_set_host_nak_suppression_pass_001);
+	tcase_add_test (tc_set_host_nak_suppression, test_set_host_nak_suppression_fail_001);
+
+	TCase* tc_set_redundant_send_group = tcase_create ("set-redundant-send-group");
+	suite_add_tcase (s, tc_set_redundant_send_group);
+	tcase_add_checked_fixture (tc_set_redundant_send_group, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_redundant_send_group, test_set_redundant_send_group_pass_001);
+	tcase_add_test (tc_set_redundant_send_group, test_set_redundant_send_group_fail_001);
+
+	TCase* tc_set_redundant_tsi = tcase_create ("set-redundant-tsi");
+	suite_add_tcase (s, tc_set_redundant_tsi);
+	tcase_add_checked_fixture (tc_set_redundant_tsi, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_redundant_tsi, test_set_redundant_tsi_pass_001);
+	tcase_add_test (tc_set_redundant_tsi, test_set_redundant_tsi_fail_001);
+
+	TCase* tc_set_spm_scheduler = tcase_create ("set-spm-scheduler");
+	suite_add_tcase (s, tc_set_spm_scheduler);
+	tcase_add_checked_fixture (tc_set_spm_scheduler, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_spm_scheduler, test_set_spm_scheduler_pass_001);
+	tcase_add_test (tc_set_spm_scheduler, test_set_spm_scheduler_fail_001);
+
 	TCase* tc_set_cr = tcase_create ("set-cr");
 	suite_add_tcase (s, tc_set_cr);
 	tcase_add_checked_fixture (tc_set_cr, mock_setup, mock_teardown);
@@ -1263,6 +2012,43 @@ make_test_suite (void)
 	tcase_add_test (tc_set_noblock, test_set_noblock_pass_001);
 	tcase_add_test (tc_set_noblock, test_set_noblock_fail_001);
 
+	TCase* tc_set_unordered = tcase_create ("set-unordered");
+	suite_add_tcase (s, tc_set_unordered);
+	tcase_add_checked_fixture (tc_set_unordered, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_unordered, test_set_unordered_pass_001);
+	tcase_add_test (tc_set_unordered, test_set_unordered_fail_001);
+
+	TCase* tc_set_repair_deadline = tcase_create ("set-repair-deadline");
+	suite_add_tcase (s, tc_set_repair_deadline);
+	tcase_add_checked_fixture (tc_set_repair_deadline, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_repair_deadline, test_set_repair_deadline_pass_001);
+	tcase_add_test (tc_set_repair_deadline, test_set_repair_deadline_fail_001);
+
+	TCase* tc_set_decode_threads = tcase_create ("set-decode-threads");
+	suite_add_tcase (s, tc_set_decode_threads);
+	tcase_add_checked_fixture (tc_set_decode_threads, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_decode_threads, test_set_decode_threads_pass_001);
+	tcase_add_test (tc_set_decode_threads, test_set_decode_threads_fail_001);
+
+	TCase* tc_set_engine_thread = tcase_create ("set-engine-thread");
+	suite_add_tcase (s, tc_set_engine_thread);
+	tcase_add_checked_fixture (tc_set_engine_thread, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_engine_thread, test_set_engine_thread_pass_001);
+	tcase_add_test (tc_set_engine_thread, test_set_engine_thread_fail_001);
+
+	TCase* tc_set_engine_affinity = tcase_create ("set-engine-affinity");
+	suite_add_tcase (s, tc_set_engine_affinity);
+	tcase_add_checked_fixture (tc_set_engine_affinity, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_engine_affinity, test_set_engine_affinity_pass_001);
+	tcase_add_test (tc_set_engine_affinity, test_set_engine_affinity_fail_001);
+#ifdef HAVE_TIMERFD
+	TCase* tc_set_use_timerfd = tcase_create ("set-use-timerfd");
+	suite_add_tcase (s, tc_set_use_timerfd);
+	tcase_add_checked_fixture (tc_set_use_timerfd, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_use_timerfd, test_set_use_timerfd_pass_001);
+	tcase_add_test (tc_set_use_timerfd, test_set_use_timerfd_fail_001);
+#endif
+
 	TCase* tc_set_udp_unicast = tcase_create ("set-udp-encap-ucast-port");
 	suite_add_tcase (s, tc_set_udp_unicast);
 	tcase_add_checked_fixture (tc_set_udp_unicast, mock_setup, mock_teardown);
@@ -1275,6 +2061,24 @@ make_test_suite (void)
 	tcase_add_test (tc_set_udp_multicast, test_set_udp_multicast_pass_001);
 	tcase_add_test (tc_set_udp_multicast, test_set_udp_multicast_fail_001);
 
+	TCase* tc_set_unicast_repair = tcase_create ("set-unicast-repair");
+	suite_add_tcase (s, tc_set_unicast_repair);
+	tcase_add_checked_fixture (tc_set_unicast_repair, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_unicast_repair, test_set_unicast_repair_pass_001);
+	tcase_add_test (tc_set_unicast_repair, test_set_unicast_repair_fail_001);
+
+	TCase* tc_set_dlr_redirect = tcase_create ("set-dlr-redirect");
+	suite_add_tcase (s, tc_set_dlr_redirect);
+	tcase_add_checked_fixture (tc_set_dlr_redirect, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_dlr_redirect, test_set_dlr_redirect_pass_001);
+	tcase_add_test (tc_set_dlr_redirect, test_set_dlr_redirect_fail_001);
+
+	TCase* tc_set_redundant_recv_group = tcase_create ("set-redundant-recv-group");
+	suite_add_tcase (s, tc_set_redundant_recv_group);
+	tcase_add_checked_fixture (tc_set_redundant_recv_group, mock_setup, mock_teardown);
+	tcase_add_test (tc_set_redundant_recv_group, test_set_redundant_recv_group_pass_001);
+	tcase_add_test (tc_set_redundant_recv_group, test_set_redundant_recv_group_fail_001);
+
 	return s;
 }
 
@@ -34,6 +34,9 @@
 
 //#define SOURCE_DEBUG
 
+/* repairs sent per deferred NAK pass */
+#define PGM_RDATA_BURST		16
+
 #ifndef SOURCE_DEBUG
 #	define PGM_DISABLE_ASSERT
 #endif
@@ -48,7 +51,7 @@ static bool send_ncf_list (pgm_sock_t*const restrict, const struct sockaddr*cons
 static int send_odata (pgm_sock_t*const restrict, struct pgm_sk_buff_t*const restrict, size_t*restrict);
 static int send_odata_copy (pgm_sock_t*const restrict, const void*restrict, const uint16_t, size_t*restrict);
 static int send_odatav (pgm_sock_t*const restrict, const struct pgm_iovec*const restrict, const unsigned, size_t*restrict);
-static bool send_rdata (pgm_sock_t*restrict, struct pgm_sk_buff_t*restrict);
+static bool send_rdata (pgm_sock_t*restrict, struct pgm_sk_buff_t*restrict, const bool);
 
 
 static inline
@@ -110,6 +113,55 @@ source_max_tsdu (
 	return max_tsdu;
 }
 
+/* re-evaluate the proactive parity count h at the end of an epoch of
+ * transmission groups.  residual NAKs are those the proactive parity did not
+ * cover, an epoch above target raises h immediately, a smoothed rate well
+ * under target lowers it after the hold period.  loss reported by the PGMCC
+ * ACKer sets a floor of the expected losses per group.
+ */
+
+static
+void
+adapt_proactive_parity (
+	pgm_sock_t*		sock
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (sock->use_adaptive_parity);
+
+	if (++sock->parity_epoch_tgs < PGM_PARITY_EPOCH_TGS)
+		return;
+
+	const uint32_t naks = pgm_atomic_read32 (&sock->parity_epoch_naks);
+	pgm_atomic_add32 (&sock->parity_epoch_naks, (uint32_t)-naks);
+	const uint64_t odata = (uint64_t)sock->parity_epoch_tgs * sock->rs_k;
+	const uint32_t nak_ppm = (uint32_t)MIN((naks * UINT64_C(1000000)) / odata, 1000000);
+	sock->parity_epoch_tgs = 0;
+	sock->parity_nak_ppm = (3 * sock->parity_nak_ppm + nak_ppm) / 4;
+
+	unsigned h = sock->rs_proactive_h;
+	if (nak_ppm > sock->parity_target_ppm) {
+		h++;
+		sock->parity_hold = PGM_PARITY_HOLD_EPOCHS;
+	} else if (sock->parity_hold) {
+		sock->parity_hold--;
+	} else if (h && sock->parity_nak_ppm < sock->parity_target_ppm / 2) {
+		h--;
+		sock->parity_hold = PGM_PARITY_HOLD_EPOCHS;
+	}
+	if (sock->use_pgmcc) {
+		const unsigned h_loss = (sock->rs_k * sock->acker_loss_rate + 0xffff) >> 16;
+		h = MAX(h, h_loss);
+	}
+	h = MIN(MAX(h, sock->rs_proactive_h_min), sock->rs_proactive_h_max);
+	if (h != sock->rs_proactive_h) {
+		pgm_trace (PGM_LOG_ROLE_FEC,_("Proactive parity h %u -> %u on residual NAK rate %" PRIu32 " ppm (smoothed %" PRIu32 ")."),
+			   (unsigned)sock->rs_proactive_h, h, nak_ppm, sock->parity_nak_ppm);
+		sock->rs_proactive_h = (uint8_t)h;
+	}
+}
+
 /* prototype of function to send pro-active parity NAKs.
  */
 
@@ -121,10 +173,18 @@ pgm_schedule_proactive_nak (
 	)
 {
 	pgm_return_val_if_fail (NULL != sock, FALSE);
+	if (sock->use_adaptive_parity) {
+		adapt_proactive_parity (sock);
+		if (0 == sock->rs_proactive_h)
+			return FALSE;
+	}
+/* called from the sending thread whilst another may service the retransmit queue */
+	pgm_spinlock_lock (&sock->txw_spinlock);
 	const bool status = pgm_txw_retransmit_push (sock->window,
 						     nak_tg_sqn | sock->rs_proactive_h,
 						     TRUE /* is_parity */,
 						     sock->tg_sqn_shift);
+	pgm_spinlock_unlock (&sock->txw_spinlock);
 	return status;
 }
 
@@ -132,13 +192,17 @@ pgm_schedule_proactive_nak (
  * window to see if the packet exists and forward on, maintaining a lock until the queue is
  * empty.
  *
+ * is_nonblocking overrides a blocking socket where the caller must not sleep
+ * on the rate limit, e.g. whilst holding the receiver lock.
+ *
  * returns TRUE on success, returns FALSE if operation would block.
  */
 
 PGM_GNUC_INTERNAL
 bool
 pgm_on_deferred_nak (
-	pgm_sock_t* const	sock
+	pgm_sock_t* const	sock,
+	const bool		is_nonblocking
 	)
 {
 	struct pgm_sk_buff_t* skb;
@@ -156,26 +220,176 @@ pgm_on_deferred_nak (
  */
 
 /* peek from the retransmit queue so we can eliminate duplicate NAKs up until the repair packet
- * has been retransmitted.
+ * has been retransmitted.  a bounded burst drains the repairs of one NAK batch, each packet
+ * still passes the RDATA rate limit.
  */
-	pgm_spinlock_lock (&sock->txw_spinlock);
-	skb = pgm_txw_retransmit_try_peek (sock->window);
-	if (skb) {
+	for (unsigned burst = 0; burst < PGM_RDATA_BURST; burst++)
+	{
+		pgm_spinlock_lock (&sock->txw_spinlock);
+		skb = pgm_txw_retransmit_try_peek (sock->window);
+		if (NULL == skb) {
+			pgm_spinlock_unlock (&sock->txw_spinlock);
+			break;
+		}
 		skb = pgm_skb_get (skb);
 		pgm_spinlock_unlock (&sock->txw_spinlock);
-		if (!send_rdata (sock, skb)) {
+		if (!send_rdata (sock, skb, is_nonblocking)) {
 			pgm_free_skb (skb);
 			pgm_notify_send (&sock->rdata_notify);
 			return FALSE;
 		}
 		pgm_free_skb (skb);
 /* now remove sequence number from retransmit queue, re-enabling NAK processing for this sequence number */
+		pgm_spinlock_lock (&sock->txw_spinlock);
 		pgm_txw_retransmit_remove_head (sock->window);
-	} else
 		pgm_spinlock_unlock (&sock->txw_spinlock);
+	}
 	return TRUE;
 }
 
+/* network address of a socket address, ports and scope are not compared.
+ */
+
+static inline
+const uint8_t*
+repair_nla_addr (
+	const struct sockaddr* const restrict sa,
+	size_t*		       const restrict addrlen
+	)
+{
+	if (AF_INET6 == sa->sa_family) {
+		*addrlen = sizeof (struct in6_addr);
+		return (const uint8_t*)&((const struct sockaddr_in6*)sa)->sin6_addr;
+	}
+	*addrlen = sizeof (struct in_addr);
+	return (const uint8_t*)&((const struct sockaddr_in*)sa)->sin_addr;
+}
+
+/* remember the address a NAK arrived from as a unicast repair destination.
+ *
+ * returns a non-zero hash of the address naming its slot, returns zero when
+ * the slot holds another address of the same hash and the repair must be
+ * multicast.
+ */
+
+static
+uint32_t
+repair_nla_hash (
+	pgm_sock_t*	       const restrict sock,
+	const struct sockaddr* const restrict from
+	)
+{
+	size_t addrlen;
+	const uint8_t* addr = repair_nla_addr (from, &addrlen);
+	uint32_t hash = 2166136261U;		/* FNV-1a */
+
+	for (size_t i = 0; i < addrlen; i++)
+		hash = (hash ^ addr[i]) * 16777619U;
+	if (PGM_UNLIKELY(0 == hash || PGM_TXW_NLA_NONE == hash))
+		hash = 1;
+
+	const unsigned slot = hash & (PGM_REPAIR_NLA_SLOTS - 1);
+	const struct sockaddr* slot_addr = (const struct sockaddr*)&sock->repair_nla[ slot ].addr;
+	if (sock->repair_nla[ slot ].hash != hash) {
+		sock->repair_nla[ slot ].hash = hash;
+		memcpy (&sock->repair_nla[ slot ].addr, from, pgm_sockaddr_len (from));
+		return hash;
+	}
+/* repairs already queued for the slot keep their destination */
+	size_t slot_addrlen;
+	const uint8_t* slot_nla = repair_nla_addr (slot_addr, &slot_addrlen);
+	if (PGM_UNLIKELY(slot_addr->sa_family != from->sa_family ||
+			 0 != memcmp (slot_nla, addr, addrlen)))
+		return 0;
+	return hash;
+}
+
+/* mark a selective NAK sequence in the pending batch, a sequence outside the
+ * span of the bitmap flushes the batch first.  nla is the requester hash or
+ * zero, sequences requested by more than one receiver collapse to zero.
+ */
+
+static
+void
+nak_batch_add (
+	pgm_sock_t* const	sock,
+	const uint32_t		sqn,
+	const uint32_t		nla
+	)
+{
+	if (sock->nak_batch.len > 0 &&
+	    (uint32_t)(sqn - sock->nak_batch.first_sqn) >= PGM_NAK_BATCH_SQNS)
+		pgm_on_nak_flush (sock);
+	if (0 == sock->nak_batch.len)
+		sock->nak_batch.first_sqn = sqn;
+
+	const uint32_t offset = sqn - sock->nak_batch.first_sqn;
+	const uint32_t bit = 1U << (offset & 31);
+	if (sock->nak_batch.bitmap[ offset >> 5 ] & bit) {
+		if (sock->nak_batch.nla[ offset ] != nla)
+			sock->nak_batch.nla[ offset ] = 0;
+		sock->cumulative_stats[PGM_PC_SOURCE_SELECTIVE_NAKS_IGNORED]++;
+		return;
+	}
+	sock->nak_batch.bitmap[ offset >> 5 ] |= bit;
+	sock->nak_batch.nla[ offset ] = nla;
+	sock->nak_batch.len++;
+}
+
+/* confirm and queue every selective NAK collected since the last flush, one
+ * NCF list per 63 sequences in ascending order.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_on_nak_flush (
+	pgm_sock_t* const	sock
+	)
+{
+	struct pgm_sqn_list_t	sqn_list;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+
+	if (0 == sock->nak_batch.len)
+		return;
+
+	sqn_list.len = 0;
+	for (unsigned i = 0; i < PGM_N_ELEMENTS(sock->nak_batch.bitmap); i++)
+	{
+		uint32_t word = sock->nak_batch.bitmap[ i ];
+		sock->nak_batch.bitmap[ i ] = 0;
+		while (word) {
+			const unsigned offset = (i << 5) + _pgm_popcount ((word & -word) - 1);
+			word &= word - 1;
+			sqn_list.sqn[ sqn_list.len++ ] = sock->nak_batch.first_sqn + offset;
+			if (sqn_list.len < PGM_N_ELEMENTS(sqn_list.sqn) &&
+			    sqn_list.len < sock->nak_batch.len)
+				continue;
+
+/* blocking send for NCF is ignored as RDATA broadcast will be sent later */
+			if (sqn_list.len > 1)
+				send_ncf_list (sock, (struct sockaddr*)&sock->send_addr, (struct sockaddr*)&sock->send_gsr.gsr_group, &sqn_list, FALSE);
+			else
+				send_ncf (sock, (struct sockaddr*)&sock->send_addr, (struct sockaddr*)&sock->send_gsr.gsr_group, sqn_list.sqn[0], FALSE);
+
+			pgm_spinlock_lock (&sock->txw_spinlock);
+			for (uint_fast8_t j = 0; j < sqn_list.len; j++) {
+				if (PGM_UNLIKELY(!pgm_txw_retransmit_push (sock->window, sqn_list.sqn[j], FALSE, sock->tg_sqn_shift))) {
+					pgm_trace (PGM_LOG_ROLE_TX_WINDOW,_("Failed to push retransmit request for #%" PRIu32), sqn_list.sqn[j]);
+				}
+/* a repair still queued from an earlier batch gains this batch's requester */
+				if (sock->use_unicast_repair)
+					pgm_txw_retransmit_add_nla (sock->window, sqn_list.sqn[j], sock->nak_batch.nla[ sqn_list.sqn[j] - sock->nak_batch.first_sqn ]);
+			}
+			pgm_spinlock_unlock (&sock->txw_spinlock);
+			sock->nak_batch.len -= sqn_list.len;
+			sqn_list.len = 0;
+		}
+	}
+	pgm_assert (0 == sock->nak_batch.len);
+}
+
 /* SPMR indicates if multicast to cancel own SPMR, or unicast to send SPM.
  *
  * rate limited to 1/IHB_MIN per TSI (13.4).
@@ -203,7 +417,9 @@ pgm_on_spmr (
 		return FALSE;
 	}
 
-	if (peer_is_source (peer)) {
+	if (peer_is_source (peer) && sock->use_spm_scheduler) {
+		pgm_spm_scheduler_request (sock);
+	} else if (peer_is_source (peer)) {
 		const bool send_status = pgm_send_spm (sock, 0);
 		if (PGM_UNLIKELY(!send_status)) {
 			pgm_trace (PGM_LOG_ROLE_NETWORK,_("Failed to send SPM on SPM-Request."));
@@ -261,6 +477,8 @@ on_opt_pgmcc_feedback (
 	if (0 == pgm_sockaddr_cmp ((const struct sockaddr*)&peer_nla, (const struct sockaddr*)&sock->acker_nla))
 	{
 		sock->acker_loss = peer_loss;
+		sock->acker_loss_rate = opt_loss_rate;
+		sock->acker_rtt = sock->acker_rtt ? (7 * sock->acker_rtt + pgm_msecs (rtt)) / 8 : pgm_msecs (rtt);
 		return TRUE;
 	}
 
@@ -274,7 +492,8 @@ on_opt_pgmcc_feedback (
  *
  * TODO: fix IPv6 AFIs
  *
- * take in a NAK and pass off to an asynchronous queue for another thread to process
+ * take in a NAK and pass off to an asynchronous queue for another thread to process,
+ * from is the receiver address for unicast repairs.
  *
  * if NAK is valid, returns TRUE.  on error, FALSE is returned.
  */
@@ -283,12 +502,14 @@ PGM_GNUC_INTERNAL
 bool
 pgm_on_nak (
 	pgm_sock_t*           const restrict sock,
-	struct pgm_sk_buff_t* const restrict skb
+	struct pgm_sk_buff_t* const restrict skb,
+	const struct sockaddr*const restrict from
 	)
 {
 	const struct pgm_nak	*nak;
 	const struct pgm_nak6	*nak6;
-	struct sockaddr_storage	 nak_src_nla, nak_grp_nla;
+	struct sockaddr_storage	 nak_src_nla, nak_grp_nla, path_nla;
+	const struct sockaddr	*requester = from;
 	const uint32_t		*nak_list = NULL;
 	uint_fast8_t		 nak_list_len = 0;
 	struct pgm_sqn_list_t	 sqn_list;
@@ -296,9 +517,10 @@ pgm_on_nak (
 /* pre-conditions */
 	pgm_assert (NULL != sock);
 	pgm_assert (NULL != skb);
+	pgm_assert (NULL != from);
 
-	pgm_debug ("pgm_on_nak (sock:%p skb:%p)",
-		(const void*)sock, (const void*)skb);
+	pgm_debug ("pgm_on_nak (sock:%p skb:%p from:%p)",
+		(const void*)sock, (const void*)skb, (const void*)from);
 
 	const bool is_parity = skb->pgm_header->pgm_options & PGM_OPT_PARITY;
 	if (is_parity) {
@@ -385,10 +607,37 @@ pgm_on_nak (
 		opt_header = (const struct pgm_opt_header*)opt_len;
 		do {
 			opt_header = (const struct pgm_opt_header*)((const char*)opt_header + opt_header->opt_length);
-			if ((opt_header->opt_type & PGM_OPT_MASK) == PGM_OPT_NAK_LIST) {
+			if (PGM_UNLIKELY((const char*)(opt_header + 1) > (const char*)skb->tail ||
+					 opt_header->opt_length < sizeof(struct pgm_opt_header) ||
+					 (const char*)opt_header + opt_header->opt_length > (const char*)skb->tail))
+			{
+				pgm_trace (PGM_LOG_ROLE_NETWORK,_("Malformed NAK rejected on option overrun."));
+				sock->cumulative_stats[PGM_PC_SOURCE_MALFORMED_NAKS]++;
+				return FALSE;
+			}
+			switch (opt_header->opt_type & PGM_OPT_MASK) {
+			case PGM_OPT_NAK_LIST:
 				nak_list = ((const struct pgm_opt_nak_list*)(opt_header + 1))->opt_sqn;
 				nak_list_len = ( opt_header->opt_length - sizeof(struct pgm_opt_header) - sizeof(uint8_t) ) / sizeof(uint32_t);
 				break;
+
+/* a NAK forwarded by a designated local repairer names the requester */
+			case PGM_OPT_PATH_NLA:
+				memset (&path_nla, 0, sizeof (path_nla));
+				if (opt_header->opt_length == sizeof(struct pgm_opt_header) + sizeof(struct pgm_opt_path_nla)) {
+					const struct pgm_opt_path_nla* opt_path_nla = (const struct pgm_opt_path_nla*)(opt_header + 1);
+					((struct sockaddr_in*)&path_nla)->sin_family = AF_INET;
+					memcpy (&((struct sockaddr_in*)&path_nla)->sin_addr, &opt_path_nla->opt_path_nla, sizeof (struct in_addr));
+					requester = (const struct sockaddr*)&path_nla;
+				} else if (opt_header->opt_length == sizeof(struct pgm_opt_header) + sizeof(struct pgm_opt6_path_nla)) {
+					const struct pgm_opt6_path_nla* opt6_path_nla = (const struct pgm_opt6_path_nla*)(opt_header + 1);
+					((struct sockaddr_in6*)&path_nla)->sin6_family = AF_INET6;
+					memcpy (&((struct sockaddr_in6*)&path_nla)->sin6_addr, &opt6_path_nla->opt6_path_nla, sizeof (struct in6_addr));
+					requester = (const struct sockaddr*)&path_nla;
+				}
+				break;
+
+			default: break;
 			}
 		} while (!(opt_header->opt_type & PGM_OPT_END));
 	}
@@ -404,6 +653,59 @@ pgm_on_nak (
 		sqn_list.sqn[sqn_list.len++] = pgm_ntohl (*nak_list);
 		nak_list++;
 	}
+	PGM_PROBE (nak_recv, PGM_PROBE_NAK_RECV, &sock->tsi, sqn_list.sqn[0], sqn_list.len | (is_parity ? PGM_PROBE_PARITY : 0), skb->tstamp);
+
+/* requests not met by proactive parity feed its adaptation, a parity NAK
+ * counts the packets missing from each group.
+ */
+	if (sock->use_adaptive_parity)
+	{
+		uint32_t residual = sqn_list.len;
+		if (is_parity) {
+			const uint32_t tg_sqn_mask = 0xffffffff << sock->tg_sqn_shift;
+			residual = 0;
+			for (uint_fast8_t i = 0; i < sqn_list.len; i++)
+				residual += MAX(1, sqn_list.sqn[i] & ~tg_sqn_mask);
+		}
+		pgm_atomic_add32 (&sock->parity_epoch_naks, residual);
+	}
+
+/* drop requests for packets transmitted longer ago than the repair deadline,
+ * the receivers will have cancelled the sequence by the time any repair arrives.
+ */
+	if (sock->repair_deadline)
+	{
+		const uint32_t tg_sqn_mask = 0xffffffff << sock->tg_sqn_shift;
+		uint_fast8_t len = 0;
+		for (uint_fast8_t i = 0; i < sqn_list.len; i++) {
+			const uint32_t sqn = is_parity ? (sqn_list.sqn[i] & tg_sqn_mask) : sqn_list.sqn[i];
+/* the sending thread appends to and trims the window */
+			pgm_spinlock_lock (&sock->txw_spinlock);
+			const struct pgm_sk_buff_t* odata_skb = pgm_txw_peek (sock->window, sqn);
+			const bool is_expired = NULL != odata_skb &&
+				pgm_time_after_eq (skb->tstamp, odata_skb->tstamp + sock->repair_deadline);
+			pgm_spinlock_unlock (&sock->txw_spinlock);
+			if (is_expired) {
+				pgm_trace (PGM_LOG_ROLE_TX_WINDOW,_("NAK for #%" PRIu32 " ignored past repair deadline."), sqn_list.sqn[i]);
+				continue;
+			}
+			sqn_list.sqn[len++] = sqn_list.sqn[i];
+		}
+		if (0 == len)
+			return TRUE;
+		sqn_list.len = len;
+		nak_list_len = len - 1;
+	}
+
+/* selective requests are confirmed together with the rest of the receive batch
+ * by pgm_on_nak_flush(), duplicates across receivers collapse in the bitmap.
+ */
+	if (!is_parity) {
+		const uint32_t nla = sock->use_unicast_repair ? repair_nla_hash (sock, requester) : 0;
+		for (uint_fast8_t i = 0; i < sqn_list.len; i++)
+			nak_batch_add (sock, sqn_list.sqn[i], nla);
+		return TRUE;
+	}
 
 /* send NAK confirm packet immediately, then defer to timer thread for a.s.a.p
  * delivery of the actual RDATA packets.  blocking send for NCF is ignored as RDATA
@@ -416,7 +718,9 @@ pgm_on_nak (
 
 /* queue retransmit requests */
 	for (uint_fast8_t i = 0; i < sqn_list.len; i++) {
+		pgm_spinlock_lock (&sock->txw_spinlock);
 		const bool push_status = pgm_txw_retransmit_push (sock->window, sqn_list.sqn[i], is_parity, sock->tg_sqn_shift);
+		pgm_spinlock_unlock (&sock->txw_spinlock);
 		if (PGM_UNLIKELY(!push_status)) {
 			pgm_trace (PGM_LOG_ROLE_TX_WINDOW,_("Failed to push retransmit request for #%" PRIu32), sqn_list.sqn[i]);
 		}
@@ -614,26 +918,9 @@ pgm_on_ack (
 /* no detected data loss at ACKer, increase congestion window size */
 	if (0 == total_lost)
 	{
-		uint_fast32_t n, token_inc;
-
 		new_acks += sock->acks_after_loss;
 		sock->acks_after_loss = 0;
-		n = pgm_fp8 (new_acks);
-		token_inc = 0;
-
-/* slow-start phase, exponential increase to SSTHRESH */
-		if (sock->cwnd_size < sock->ssthresh) {
-			const uint_fast32_t d = MIN( n, sock->ssthresh - sock->cwnd_size );
-			n -= d;
-			token_inc	 = d + d;
-			sock->cwnd_size += d;
-		}
-
-		const uint_fast32_t iw = pgm_fp8div (pgm_fp8 (1), sock->cwnd_size);
-
-/* linear window increase */
-		token_inc	+= pgm_fp8mul (n, pgm_fp8 (1) + iw);
-		sock->cwnd_size += pgm_fp8mul (n, iw);
+		const uint_fast32_t token_inc = sock->cc_ops->on_ack (sock, new_acks, skb->tstamp);
 		sock->tokens	 = MIN( sock->tokens + token_inc, sock->cwnd_size );
 //		pgm_trace (PGM_LOG_ROLE_CONGESTION_CONTROL,_("PGMCC++ (T:%u W:%u)"),
 //			   pgm_fp8tou (sock->tokens), pgm_fp8tou (sock->cwnd_size));
@@ -642,24 +929,27 @@ pgm_on_ack (
 	{
 /* Look for an unacknowledged data packet which is followed by at least three
  * acknowledged data packets, then the packet is assumed to be lost and PGMCC
- * reacts by halving the window.
+ * reacts by reducing the window, halving for Reno.
  *
  * Common value will be 0xfffffff7.
  */
 		sock->acks_after_loss += new_acks;
 		if (sock->acks_after_loss >= 3)
 		{
+			const uint32_t cwnd_size = sock->cwnd_size;
 			sock->acks_after_loss = 0;
 			sock->suspended_sqn = ack_rx_max;
 			sock->is_congested = TRUE;
-			sock->cwnd_size = pgm_fp8div (sock->cwnd_size, pgm_fp8 (2));
-			if (sock->cwnd_size > sock->tokens)
+			sock->cc_ops->on_loss (sock);
+/* withdraw the tokens of the reduction */
+			const uint32_t reduction = cwnd_size - sock->cwnd_size;
+			if (reduction > sock->tokens)
 				sock->tokens = 0;
 			else
-				sock->tokens -= sock->cwnd_size;
+				sock->tokens -= reduction;
 			sock->ack_bitmap = 0xffffffff;
-			pgm_trace (PGM_LOG_ROLE_CONGESTION_CONTROL,_("PGMCC congestion, half window size (T:%u W:%u)"),
-				   pgm_fp8tou (sock->tokens), pgm_fp8tou (sock->cwnd_size));
+			pgm_trace (PGM_LOG_ROLE_CONGESTION_CONTROL,_("PGMCC congestion, %s window reduction (T:%u W:%u)"),
+				   sock->cc_ops->name, pgm_fp8tou (sock->tokens), pgm_fp8tou (sock->cwnd_size));
 		}
 	}
 
@@ -931,6 +1221,7 @@ send_ncf (
 		return FALSE;
 /* fall through silently on other errors */
 			
+	PGM_PROBE (ncf_send, PGM_PROBE_NCF_SEND, &sock->tsi, sequence, 1 | (is_parity ? PGM_PROBE_PARITY : 0), pgm_time_sample());
 	pgm_atomic_add32 (&sock->cumulative_stats[PGM_PC_SOURCE_BYTES_SENT], (uint32_t)tpdu_length);
 	return TRUE;
 }
@@ -1046,6 +1337,7 @@ send_ncf_list (
 		return FALSE;
 /* fall through silently on other errors */
 
+	PGM_PROBE (ncf_send, PGM_PROBE_NCF_SEND, &sock->tsi, sqn_list->sqn[0], sqn_list->len | (is_parity ? PGM_PROBE_PARITY : 0), pgm_time_sample());
 	pgm_atomic_add32 (&sock->cumulative_stats[PGM_PC_SOURCE_BYTES_SENT], (uint32_t)tpdu_length);
 	return TRUE;
 }
@@ -1064,6 +1356,12 @@ reset_heartbeat_spm (
 	const pgm_time_t next_poll = sock->next_poll;
 	const pgm_time_t spm_heartbeat_interval = sock->spm_heartbeat_interval[ sock->spm_heartbeat_state = 1 ];
 	sock->next_heartbeat_spm = now + spm_heartbeat_interval;
+	if (sock->use_spm_scheduler) {
+		const pgm_time_t next_heartbeat_spm = sock->next_heartbeat_spm;
+		pgm_mutex_unlock (&sock->timer_mutex);
+		pgm_spm_scheduler_kick (next_heartbeat_spm);
+		return;
+	}
 	if (pgm_time_after( next_poll, sock->next_heartbeat_spm ))
 	{
 		sock->next_poll = sock->next_heartbeat_spm;
@@ -1117,14 +1415,14 @@ send_odata (
 
 /* continue if send would block */
 	if (sock->is_apdu_eagain) {
-		STATE(skb)->tstamp = pgm_time_update_now();
+		STATE(skb)->tstamp = pgm_time_sample();
 		goto retry_send;
 	}
 
 /* add PGM header to skbuff */
 	STATE(skb) = pgm_skb_get(skb);
 	STATE(skb)->sock = sock;
-	STATE(skb)->tstamp = pgm_time_update_now();
+	STATE(skb)->tstamp = pgm_time_sample();
 
 	STATE(skb)->pgm_header = (struct pgm_header*)STATE(skb)->head;
 	STATE(skb)->pgm_data   = (struct pgm_data*)(STATE(skb)->pgm_header + 1);
@@ -1242,6 +1540,7 @@ retry_send:
 	pgm_txw_set_unfolded_checksum (STATE(skb), STATE(unfolded_odata));
 /* increment socket statistics */
 	if (PGM_LIKELY((size_t)sent == tpdu_length)) {
+		PGM_PROBE (odata_send, PGM_PROBE_ODATA_SEND, &sock->tsi, pgm_ntohl (STATE(skb)->pgm_data->data_sqn), (uint32_t)tsdu_length, STATE(skb)->tstamp);
 		sock->cumulative_stats[PGM_PC_SOURCE_DATA_BYTES_SENT] += tsdu_length;
 		sock->cumulative_stats[PGM_PC_SOURCE_DATA_MSGS_SENT]  ++;
 		pgm_atomic_add32 (&sock->cumulative_stats[PGM_PC_SOURCE_BYTES_SENT], (uint32_t)(tpdu_length + sock->iphdr_len));
@@ -1292,13 +1591,13 @@ send_odata_copy (
 
 /* continue if blocked mid-apdu, updating timestamp */
 	if (sock->is_apdu_eagain) {
-		STATE(skb)->tstamp = pgm_time_update_now();
+		STATE(skb)->tstamp = pgm_time_sample();
 		goto retry_send;
 	}
 
 	STATE(skb) = pgm_alloc_skb (sock->max_tpdu);
 	STATE(skb)->sock = sock;
-	STATE(skb)->tstamp = pgm_time_update_now();
+	STATE(skb)->tstamp = pgm_time_sample();
 	pgm_skb_reserve (STATE(skb), (uint16_t)pgm_pkt_offset (FALSE, pgmcc_family));
 	pgm_skb_put (STATE(skb), (uint16_t)tsdu_length);
 
@@ -1417,6 +1716,7 @@ retry_send:
 	pgm_txw_set_unfolded_checksum (STATE(skb), STATE(unfolded_odata));
 /* increment socket statistics */
 	if (PGM_LIKELY((size_t)sent == tpdu_length)) {
+		PGM_PROBE (odata_send, PGM_PROBE_ODATA_SEND, &sock->tsi, pgm_ntohl (STATE(skb)->pgm_data->data_sqn), (uint32_t)tsdu_length, STATE(skb)->tstamp);
 		sock->cumulative_stats[PGM_PC_SOURCE_DATA_BYTES_SENT] += tsdu_length;
 		sock->cumulative_stats[PGM_PC_SOURCE_DATA_MSGS_SENT]  ++;
 		pgm_atomic_add32 (&sock->cumulative_stats[PGM_PC_SOURCE_BYTES_SENT], (uint32_t)(tpdu_length + sock->iphdr_len));
@@ -1491,7 +1791,7 @@ send_odatav (
 
 	STATE(skb) = pgm_alloc_skb (sock->max_tpdu);
 	STATE(skb)->sock = sock;
-	STATE(skb)->tstamp = pgm_time_update_now();
+	STATE(skb)->tstamp = pgm_time_sample();
 	const sa_family_t pgmcc_family = sock->use_pgmcc ? sock->family : 0;
 	pgm_skb_reserve (STATE(skb), (uint16_t)pgm_pkt_offset (FALSE, pgmcc_family));
 	pgm_skb_put (STATE(skb), (uint16_t)STATE(tsdu_length));
@@ -1582,6 +1882,7 @@ retry_send:
 	pgm_txw_set_unfolded_checksum (STATE(skb), STATE(unfolded_odata));
 /* increment socket statistics */
 	if (PGM_LIKELY((size_t)sent == STATE(skb)->len)) {
+		PGM_PROBE (odata_send, PGM_PROBE_ODATA_SEND, &sock->tsi, pgm_ntohl (STATE(skb)->pgm_data->data_sqn), (uint32_t)STATE(tsdu_length), STATE(skb)->tstamp);
             sock->cumulative_stats[PGM_PC_SOURCE_DATA_BYTES_SENT] +=
               (uint32_t) STATE (tsdu_length);
 		sock->cumulative_stats[PGM_PC_SOURCE_DATA_MSGS_SENT]  ++;
@@ -1627,6 +1928,7 @@ send_apdu (
 	pgm_assert (NULL != apdu);
 
 	const sa_family_t pgmcc_family = sock->use_pgmcc ? sock->family : 0;
+	const pgm_time_t now = pgm_time_sample();		/* one sample for every fragment */
 
 /* continue if blocked mid-apdu */
 	if (sock->is_apdu_eagain)
@@ -1672,7 +1974,7 @@ send_apdu (
 
 		STATE(skb) = pgm_alloc_skb (sock->max_tpdu);
 		STATE(skb)->sock = sock;
-		STATE(skb)->tstamp = pgm_time_update_now();
+		STATE(skb)->tstamp = now;
 		pgm_skb_reserve (STATE(skb), (uint16_t)header_length);
 		pgm_skb_put (STATE(skb), (uint16_t)STATE(tsdu_length));
 
@@ -1745,6 +2047,7 @@ retry_send:
 		pgm_txw_set_unfolded_checksum (STATE(skb), STATE(unfolded_odata));
 
 		if (PGM_LIKELY((size_t)sent == tpdu_length)) {
+			PGM_PROBE (odata_send, PGM_PROBE_ODATA_SEND, &sock->tsi, pgm_ntohl (STATE(skb)->pgm_data->data_sqn), (uint32_t)STATE(tsdu_length), STATE(skb)->tstamp);
 			bytes_sent += tpdu_length + sock->iphdr_len;	/* as counted at IP layer */
 			packets_sent++;					/* IP packets */
 			data_bytes_sent += STATE(tsdu_length);
@@ -1798,8 +2101,9 @@ blocked:
  * packet size exceeds the current rate limit.
  */
 
+static
 int
-pgm_send (
+_pgm_send (
 	pgm_sock_t* 	 const restrict sock,
 	const void*	       restrict	apdu,
 	const size_t			apdu_length,
@@ -1846,6 +2150,23 @@ pgm_send (
 	}
 }
 
+/* completed calls feed the send latency histogram */
+
+int
+pgm_send (
+	pgm_sock_t* 	 const restrict sock,
+	const void*	       restrict	apdu,
+	const size_t			apdu_length,
+	size_t*	       	       restrict	bytes_written
+	)
+{
+	const pgm_time_t start = pgm_time_sample();
+	const int status = _pgm_send (sock, apdu, apdu_length, bytes_written);
+	if (PGM_IO_STATUS_NORMAL == status)
+		pgm_latency_add (PGM_LATENCY_SEND, pgm_time_sample() - start);
+	return status;
+}
+
 /* send PGM original data, callee owned scatter/gather IO vector.  if larger than maximum TPDU
  * size will be fragmented.
  *
@@ -1866,8 +2187,9 @@ pgm_send (
  * packet size exceeds the current rate limit.
  */
 
+static
 int
-pgm_sendv (
+_pgm_sendv (
 	pgm_sock_t*		const restrict sock,
 	const struct pgm_iovec* const restrict vector,
 	const unsigned			       count,		/* number of items in vector */
@@ -1900,6 +2222,7 @@ pgm_sendv (
 	}
 
 	pgm_mutex_lock (&sock->source_mutex);
+	const pgm_time_t now = pgm_time_sample();
 
 /* pass on zero length as cannot count vector lengths */
 	if (PGM_UNLIKELY(0 == count))
@@ -2048,7 +2371,7 @@ retry_send:
 		STATE(tsdu_length) = MIN( source_max_tsdu (sock, TRUE), STATE(apdu_length) - STATE(data_bytes_offset) );
 		STATE(skb) = pgm_alloc_skb (sock->max_tpdu);
 		STATE(skb)->sock = sock;
-		STATE(skb)->tstamp = pgm_time_update_now();
+		STATE(skb)->tstamp = now;
 		pgm_skb_reserve (STATE(skb), (uint16_t)header_length);
 		pgm_skb_put (STATE(skb), (uint16_t)STATE(tsdu_length));
 
@@ -2158,6 +2481,7 @@ retry_one_apdu_send:
 		pgm_txw_set_unfolded_checksum (STATE(skb), STATE(unfolded_odata));
 
 		if (PGM_LIKELY((size_t)sent == tpdu_length)) {
+			PGM_PROBE (odata_send, PGM_PROBE_ODATA_SEND, &sock->tsi, pgm_ntohl (STATE(skb)->pgm_data->data_sqn), (uint32_t)STATE(tsdu_length), STATE(skb)->tstamp);
 			bytes_sent += tpdu_length + sock->iphdr_len;	/* as counted at IP layer */
 			packets_sent++;					/* IP packets */
 			data_bytes_sent += STATE(tsdu_length);
@@ -2208,6 +2532,22 @@ blocked:
 	return PGM_IO_STATUS_WOULD_BLOCK;
 }
 
+int
+pgm_sendv (
+	pgm_sock_t*		const restrict sock,
+	const struct pgm_iovec* const restrict vector,
+	const unsigned			       count,		/* number of items in vector */
+	const bool			       is_one_apdu,	/* true  = vector = apdu, false = vector::iov_base = apdu */
+        size_t*                       restrict bytes_written
+	)
+{
+	const pgm_time_t start = pgm_time_sample();
+	const int status = _pgm_sendv (sock, vector, count, is_one_apdu, bytes_written);
+	if (PGM_IO_STATUS_NORMAL == status)
+		pgm_latency_add (PGM_LATENCY_SEND, pgm_time_sample() - start);
+	return status;
+}
+
 /* send PGM original data, transmit window owned scatter/gather IO vector.
  *
  *    ⎢ TSDU₀ ⎢
@@ -2219,8 +2559,9 @@ blocked:
  * packet size exceeds the current rate limit.
  */
 
+static
 int
-pgm_send_skbv (
+_pgm_send_skbv (
 	pgm_sock_t*            const restrict sock,
 	struct pgm_sk_buff_t** const restrict vector,		/* array of skb pointers vs. array of skbs */
 	const unsigned			      count,
@@ -2253,6 +2594,7 @@ pgm_send_skbv (
 	}
 
 	pgm_mutex_lock (&sock->source_mutex);
+	const pgm_time_t now = pgm_time_sample();
 
 /* pass on zero length as cannot count vector lengths */
 	if (PGM_UNLIKELY(0 == count))
@@ -2326,7 +2668,7 @@ pgm_send_skbv (
 		
 		STATE(skb) = pgm_skb_get(vector[STATE(vector_index)]);
 		STATE(skb)->sock = sock;
-		STATE(skb)->tstamp = pgm_time_update_now();
+		STATE(skb)->tstamp = now;
 
 		STATE(skb)->pgm_header = (struct pgm_header*)STATE(skb)->head;
 		STATE(skb)->pgm_data   = (struct pgm_data*)(STATE(skb)->pgm_header + 1);
@@ -2409,6 +2751,7 @@ retry_send:
 		pgm_txw_set_unfolded_checksum (STATE(skb), STATE(unfolded_odata));
 
 		if (PGM_LIKELY((size_t)sent == tpdu_length)) {
+			PGM_PROBE (odata_send, PGM_PROBE_ODATA_SEND, &sock->tsi, pgm_ntohl (STATE(skb)->pgm_data->data_sqn), (uint32_t)STATE(tsdu_length), STATE(skb)->tstamp);
 			bytes_sent += tpdu_length + sock->iphdr_len;	/* as counted at IP layer */
 			packets_sent++;					/* IP packets */
 			data_bytes_sent += STATE(tsdu_length);
@@ -2464,6 +2807,22 @@ blocked:
 	return PGM_IO_STATUS_WOULD_BLOCK;
 }
 
+int
+pgm_send_skbv (
+	pgm_sock_t*            const restrict sock,
+	struct pgm_sk_buff_t** const restrict vector,		/* array of skb pointers vs. array of skbs */
+	const unsigned			      count,
+	const bool			      is_one_apdu,	/* true: vector = apdu, false: vector::iov_base = apdu */
+	size_t*		 	     restrict bytes_written
+	)
+{
+	const pgm_time_t start = pgm_time_sample();
+	const int status = _pgm_send_skbv (sock, vector, count, is_one_apdu, bytes_written);
+	if (PGM_IO_STATUS_NORMAL == status)
+		pgm_latency_add (PGM_LATENCY_SEND, pgm_time_sample() - start);
+	return status;
+}
+
 /* cleanup resuming send state helper 
  */
 #undef STATE
@@ -2477,13 +2836,16 @@ static
 bool
 send_rdata (
 	pgm_sock_t*	      restrict sock,
-	struct pgm_sk_buff_t* restrict skb
+	struct pgm_sk_buff_t* restrict skb,
+	const bool		       is_nonblocking
 	)
 {
 	size_t			 tpdu_length;
 	struct pgm_header	*header;
 	struct pgm_data		*rdata;
 	ssize_t			 sent;
+	struct sockaddr_storage	 unicast_nla;
+	const struct sockaddr	*to = (const struct sockaddr*)&sock->send_gsr.gsr_group;
 
 /* pre-conditions */
 	pgm_assert (NULL != sock);
@@ -2497,7 +2859,7 @@ send_rdata (
 	    !pgm_rate_check2 (&sock->rate_control,		/* total rate limit */
 			      &sock->rdata_rate_control,	/* repair data limit */
 			      tpdu_length,			/* excludes IP header len */
-			      sock->is_nonblocking))
+			      is_nonblocking))
 	{
 		sock->blocklen = tpdu_length + sock->iphdr_len;
 		return FALSE;
@@ -2507,6 +2869,9 @@ send_rdata (
 	header				= skb->pgm_header;
 	rdata				= skb->pgm_data;
 	header->pgm_type		= PGM_RDATA;
+/* parity packets are built without ports by the transmit window */
+	header->pgm_sport		= sock->tsi.sport;
+	header->pgm_dport		= sock->dport;
 /* RDATA */
         rdata->data_trail		= pgm_htonl (pgm_txw_trail(sock->window));
 
@@ -2525,14 +2890,29 @@ send_rdata (
 		return FALSE;
 	}
 
+/* a selective repair requested by a single receiver is sent only to it, the
+ * slot may since have been taken by another receiver.
+ */
+	const uint32_t nla = (sock->use_unicast_repair && !(header->pgm_options & PGM_OPT_PARITY)) ?
+				pgm_txw_get_repair_nla (skb) : 0;
+	if (0 != nla && PGM_TXW_NLA_NONE != nla &&
+	    sock->repair_nla[ nla & (PGM_REPAIR_NLA_SLOTS - 1) ].hash == nla)
+	{
+		const struct sockaddr* addr = (const struct sockaddr*)&sock->repair_nla[ nla & (PGM_REPAIR_NLA_SLOTS - 1) ].addr;
+		memcpy (&unicast_nla, addr, pgm_sockaddr_len (addr));
+/* UDP encapsulated receivers listen on the group port */
+		((struct sockaddr_in*)&unicast_nla)->sin_port = ((const struct sockaddr_in*)to)->sin_port;
+		to = (const struct sockaddr*)&unicast_nla;
+	}
+
 	sent = pgm_sendto (sock,
 			   FALSE,			/* already rate limited */
 			   &sock->rdata_rate_control,
-			   TRUE,			/* with router alert */
+			   to != (const struct sockaddr*)&unicast_nla,	/* router alert for multicast */
 			   header,
 			   tpdu_length,
-			   (struct sockaddr*)&sock->send_gsr.gsr_group,
-			   pgm_sockaddr_len((struct sockaddr*)&sock->send_gsr.gsr_group));
+			   to,
+			   pgm_sockaddr_len(to));
 	if (sent < 0) {
 		const int save_errno = pgm_get_last_sock_error();
 		if (PGM_LIKELY(PGM_SOCK_EAGAIN == save_errno || PGM_SOCK_ENOBUFS == save_errno))
@@ -2543,7 +2923,7 @@ send_rdata (
 /* fall through silently on other errors */
 	}
 
-	const pgm_time_t now = pgm_time_update_now();
+	const pgm_time_t now = pgm_time_sample();
 
 	if (sock->use_pgmcc) {
 		sock->tokens -= pgm_fp8 (1);
@@ -2555,11 +2935,22 @@ send_rdata (
 	pgm_mutex_lock (&sock->timer_mutex);
 	sock->spm_heartbeat_state = 1;
 	sock->next_heartbeat_spm = now + sock->spm_heartbeat_interval[sock->spm_heartbeat_state++];
+	const pgm_time_t next_heartbeat_spm = sock->next_heartbeat_spm;
 	pgm_mutex_unlock (&sock->timer_mutex);
+	if (sock->use_spm_scheduler)
+		pgm_spm_scheduler_kick (next_heartbeat_spm);
 
 	pgm_txw_inc_retransmit_count (skb);
-	sock->cumulative_stats[PGM_PC_SOURCE_SELECTIVE_BYTES_RETRANSMITTED] += pgm_ntohs(header->pgm_tsdu_length);
-	sock->cumulative_stats[PGM_PC_SOURCE_SELECTIVE_MSGS_RETRANSMITTED]++;	/* impossible to determine APDU count */
+	PGM_PROBE (rdata_send, PGM_PROBE_RDATA_SEND, &sock->tsi, pgm_ntohl (rdata->data_sqn), pgm_ntohs (header->pgm_tsdu_length), now);
+	if (header->pgm_options & PGM_OPT_PARITY) {
+		sock->cumulative_stats[PGM_PC_SOURCE_PARITY_BYTES_RETRANSMITTED] += pgm_ntohs(header->pgm_tsdu_length);
+		sock->cumulative_stats[PGM_PC_SOURCE_PARITY_MSGS_RETRANSMITTED]++;
+	} else {
+		if (to == (const struct sockaddr*)&unicast_nla)
+			sock->cumulative_stats[PGM_PC_SOURCE_UNICAST_MSGS_RETRANSMITTED]++;
+		sock->cumulative_stats[PGM_PC_SOURCE_SELECTIVE_BYTES_RETRANSMITTED] += pgm_ntohs(header->pgm_tsdu_length);
+		sock->cumulative_stats[PGM_PC_SOURCE_SELECTIVE_MSGS_RETRANSMITTED]++;	/* impossible to determine APDU count */
+	}
 	pgm_atomic_add32 (&sock->cumulative_stats[PGM_PC_SOURCE_BYTES_SENT], (uint32_t)(tpdu_length + sock->iphdr_len));
 	return TRUE;
 }
@@ -63,6 +63,15 @@ static gboolean mock_is_valid_spmr = TRUE;
 static gboolean mock_is_valid_ack = TRUE;
 static gboolean mock_is_valid_nak = TRUE;
 static gboolean mock_is_valid_nnak = TRUE;
+static guint mock_retransmit_push_count = 0;
+static gboolean mock_spm_requested = FALSE;
+static uint32_t mock_repair_nla = 0;
+static struct sockaddr_storage mock_nak_src;
+static struct sockaddr_storage mock_sendto_addr;
+static gboolean mock_is_parity_repair = FALSE;
+static struct pgm_header mock_sendto_header;
+static gboolean mock_is_rate_limited = FALSE;
+static gboolean mock_rate_is_nonblocking = FALSE;
 
 
 #define pgm_txw_get_unfolded_checksum	mock_pgm_txw_get_unfolded_checksum
@@ -73,8 +82,11 @@ static gboolean mock_is_valid_nnak = TRUE;
 #define pgm_txw_retransmit_push		mock_pgm_txw_retransmit_push
 #define pgm_txw_retransmit_try_peek	mock_pgm_txw_retransmit_try_peek
 #define pgm_txw_retransmit_remove_head	mock_pgm_txw_retransmit_remove_head
+#define pgm_txw_retransmit_add_nla	mock_pgm_txw_retransmit_add_nla
+#define pgm_txw_get_repair_nla		mock_pgm_txw_get_repair_nla
 #define pgm_rs_encode			mock_pgm_rs_encode
 #define pgm_rate_check			mock_pgm_rate_check
+#define pgm_rate_check2			mock_pgm_rate_check2
 #define pgm_verify_spmr			mock_pgm_verify_spmr
 #define pgm_verify_ack			mock_pgm_verify_ack
 #define pgm_verify_nak			mock_pgm_verify_nak
@@ -86,17 +98,33 @@ static gboolean mock_is_valid_nnak = TRUE;
 #define pgm_sendto_hops			mock_pgm_sendto_hops
 #define pgm_time_update_now		mock_pgm_time_update_now
 #define pgm_setsockopt			mock_pgm_setsockopt
+#define pgm_spm_scheduler_request	mock_pgm_spm_scheduler_request
+#define pgm_spm_scheduler_kick		mock_pgm_spm_scheduler_kick
 
 
 #define SOURCE_DEBUG
 #include "source.c"
 
+static pgm_spinlock_t* mock_txw_spinlock = NULL;
+static gboolean mock_is_push_locked = TRUE;
+
 
 static
 void
 mock_setup (void)
 {
 	if (!g_thread_supported ()) g_thread_init (NULL);
+	mock_retransmit_push_count = 0;
+	mock_spm_requested = FALSE;
+	mock_repair_nla = 0;
+	mock_is_parity_repair = FALSE;
+	mock_is_rate_limited = FALSE;
+	mock_rate_is_nonblocking = FALSE;
+	mock_txw_spinlock = NULL;
+	mock_is_push_locked = TRUE;
+	memset (&mock_nak_src, 0, sizeof(mock_nak_src));
+	((struct sockaddr_in*)&mock_nak_src)->sin_family = AF_INET;
+	((struct sockaddr_in*)&mock_nak_src)->sin_addr.s_addr = inet_addr ("127.0.0.3");
 }
 
 static
@@ -281,6 +309,46 @@ generate_nak_list (void)
 	return skb;
 }
 
+/* single nak forwarded by a local repairer on behalf of 127.0.0.4 */
+static
+struct pgm_sk_buff_t*
+generate_path_nla_nak (void)
+{
+	struct pgm_sk_buff_t* skb = pgm_alloc_skb (TEST_MAX_TPDU);
+	const guint16 header_length = sizeof(struct pgm_header) + sizeof(struct pgm_nak) +
+				      sizeof(struct pgm_opt_length) +
+				      sizeof(struct pgm_opt_header) + sizeof(struct pgm_opt_path_nla);
+	pgm_skb_reserve (skb, sizeof(struct pgm_header));
+	memset (skb->head, 0, header_length);
+	skb->pgm_header = (struct pgm_header*)skb->head;
+	skb->pgm_header->pgm_type = PGM_NAK;
+	skb->pgm_header->pgm_options = PGM_OPT_PRESENT | PGM_OPT_NETWORK;
+	struct pgm_nak *nak = (struct pgm_nak*)(skb->pgm_header + 1);
+	struct sockaddr_in nla = {
+		.sin_family		= AF_INET,
+		.sin_addr.s_addr	= inet_addr("127.0.0.2")
+	};
+	pgm_sockaddr_to_nla ((struct sockaddr*)&nla, (char*)&nak->nak_src_nla_afi);
+	struct sockaddr_in group = {
+		.sin_family		= AF_INET,
+		.sin_addr.s_addr	= inet_addr("239.192.0.1")
+	};
+	pgm_sockaddr_to_nla ((struct sockaddr*)&group, (char*)&nak->nak_grp_nla_afi);
+	struct pgm_opt_length* opt_len = (struct pgm_opt_length*)(nak + 1);
+	opt_len->opt_type = PGM_OPT_LENGTH;
+	opt_len->opt_length = sizeof(struct pgm_opt_length);
+	opt_len->opt_total_length = g_htons (   sizeof(struct pgm_opt_length) +
+						sizeof(struct pgm_opt_header) +
+						sizeof(struct pgm_opt_path_nla) );
+	struct pgm_opt_header* opt_header = (struct pgm_opt_header*)(opt_len + 1);
+	opt_header->opt_type = PGM_OPT_PATH_NLA | PGM_OPT_END;
+	opt_header->opt_length = sizeof(struct pgm_opt_header) + sizeof(struct pgm_opt_path_nla);
+	struct pgm_opt_path_nla* opt_path_nla = (struct pgm_opt_path_nla*)(opt_header + 1);
+	opt_path_nla->opt_path_nla.s_addr = inet_addr ("127.0.0.4");
+	pgm_skb_put (skb, header_length);
+	return skb;
+}
+
 static
 struct pgm_sk_buff_t*
 generate_parity_nak_list (void)
@@ -324,6 +392,12 @@ mock_pgm_txw_retransmit_push (
 		sequence,
 		is_parity ? "YES" : "NO",
 		tg_sqn_shift);
+/* the transmit window is shared with the timer thread */
+	if (NULL != mock_txw_spinlock && pgm_spinlock_trylock (mock_txw_spinlock)) {
+		pgm_spinlock_unlock (mock_txw_spinlock);
+		mock_is_push_locked = FALSE;
+	}
+	mock_retransmit_push_count++;
 	return TRUE;
 }
 
@@ -357,7 +431,10 @@ mock_pgm_txw_retransmit_try_peek (
 {
 	g_debug ("mock_pgm_txw_retransmit_try_peek (window:%p)",
 		(gpointer)window);
-	return generate_odata (); 
+	struct pgm_sk_buff_t* skb = generate_odata ();
+	if (mock_is_parity_repair)
+		skb->pgm_header->pgm_options = PGM_OPT_PARITY;
+	return skb;
 }
 
 void
@@ -369,6 +446,25 @@ mock_pgm_txw_retransmit_remove_head (
 		(gpointer)window);
 }
 
+void
+mock_pgm_txw_retransmit_add_nla (
+	pgm_txw_t* const		window,
+	const uint32_t			sequence,
+	const uint32_t			nla
+	)
+{
+	g_debug ("mock_pgm_txw_retransmit_add_nla (window:%p sequence:%" G_GUINT32_FORMAT " nla:%" G_GUINT32_FORMAT ")",
+		(gpointer)window, sequence, nla);
+}
+
+uint32_t
+mock_pgm_txw_get_repair_nla (
+	const struct pgm_sk_buff_t*const skb
+	)
+{
+	return mock_repair_nla;
+}
+
 void
 mock_pgm_rs_encode (
 	pgm_rs_t*			rs,
@@ -395,6 +491,21 @@ mock_pgm_rate_check (
 	return TRUE;
 }
 
+PGM_GNUC_INTERNAL
+bool
+mock_pgm_rate_check2 (
+	pgm_rate_t*			major_bucket,
+	pgm_rate_t*			minor_bucket,
+	const size_t			data_size,
+	const bool			is_nonblocking
+	)
+{
+	g_debug ("mock_pgm_rate_check2 (major-bucket:%p minor-bucket:%p data-size:%u is-nonblocking:%s)",
+		(gpointer)major_bucket, (gpointer)minor_bucket, (unsigned)data_size, is_nonblocking ? "TRUE" : "FALSE");
+	mock_rate_is_nonblocking = is_nonblocking;
+	return !mock_is_rate_limited;
+}
+
 bool
 mock_pgm_verify_spmr (
 	const struct pgm_sk_buff_t* const	skb
@@ -492,6 +603,8 @@ mock_pgm_sendto_hops (
 		(unsigned)len,
 		saddr,
 		tolen);
+	memcpy (&mock_sendto_addr, to, tolen);
+	memcpy (&mock_sendto_header, buf, sizeof(struct pgm_header));
 	return len;
 }
 
@@ -542,6 +655,25 @@ mock_pgm_setsockopt (
 	return TRUE;
 }
 
+/** SPM scheduler module */
+PGM_GNUC_INTERNAL
+void
+mock_pgm_spm_scheduler_request (
+	pgm_sock_t* const	sock
+	)
+{
+	g_assert (NULL != sock);
+	mock_spm_requested = TRUE;
+}
+
+PGM_GNUC_INTERNAL
+void
+mock_pgm_spm_scheduler_kick (
+	const pgm_time_t	due
+	)
+{
+}
+
 
 /* mock functions for external references */
 
@@ -776,9 +908,10 @@ START_TEST (test_send_spm_fail_001)
 END_TEST
 
 /* target:
- *	void
+ *	bool
  *	pgm_on_deferred_nak (
- *		pgm_sock_t*	sock
+ *		pgm_sock_t*	sock,
+ *		const bool	is_nonblocking
  *		)
  */
 
@@ -786,13 +919,65 @@ START_TEST (test_on_deferred_nak_pass_001)
 {
 	pgm_sock_t* sock = generate_sock ();
 	fail_if (NULL == sock, "generate_sock failed");
-	pgm_on_deferred_nak (sock);
+	pgm_on_deferred_nak (sock, FALSE);
 }
 END_TEST
 	
+/* repair for a single requester is unicast to it */
+START_TEST (test_on_deferred_nak_pass_002)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->use_unicast_repair = TRUE;
+	mock_repair_nla = repair_nla_hash (sock, (struct sockaddr*)&mock_nak_src);
+	fail_unless (TRUE == pgm_on_deferred_nak (sock, FALSE), "on_deferred_nak failed");
+	fail_unless (0 == memcmp (&((struct sockaddr_in*)&mock_sendto_addr)->sin_addr,
+				  &((struct sockaddr_in*)&mock_nak_src)->sin_addr, sizeof(struct in_addr)), "unicast failed");
+	fail_unless (0 < sock->cumulative_stats[PGM_PC_SOURCE_UNICAST_MSGS_RETRANSMITTED], "counter failed");
+/* several requesters */
+	mock_repair_nla = 0;
+	fail_unless (TRUE == pgm_on_deferred_nak (sock, FALSE), "on_deferred_nak failed");
+	fail_unless (0 == pgm_sockaddr_cmp ((struct sockaddr*)&mock_sendto_addr, (struct sockaddr*)&sock->send_gsr.gsr_group), "multicast failed");
+}
+END_TEST
+
+/* parity repairs carry the socket ports and count as parity */
+START_TEST (test_on_deferred_nak_pass_003)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	mock_is_parity_repair = TRUE;
+	fail_unless (TRUE == pgm_on_deferred_nak (sock, FALSE), "on_deferred_nak failed");
+	fail_unless (PGM_RDATA == mock_sendto_header.pgm_type, "type failed");
+	fail_unless (sock->tsi.sport == mock_sendto_header.pgm_sport, "sport failed");
+	fail_unless (sock->dport == mock_sendto_header.pgm_dport, "dport failed");
+	fail_unless (0 < sock->cumulative_stats[PGM_PC_SOURCE_PARITY_MSGS_RETRANSMITTED], "parity msgs failed");
+	fail_unless (0 < sock->cumulative_stats[PGM_PC_SOURCE_PARITY_BYTES_RETRANSMITTED], "parity bytes failed");
+	fail_unless (0 == sock->cumulative_stats[PGM_PC_SOURCE_SELECTIVE_MSGS_RETRANSMITTED], "selective msgs failed");
+}
+END_TEST
+
+/* a blocking socket is not put to sleep on the rate limit when the caller
+ * asks not to block.
+ */
+START_TEST (test_on_deferred_nak_pass_004)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->is_nonblocking = FALSE;
+	sock->is_controlled_rdata = TRUE;
+	mock_is_rate_limited = TRUE;
+	fail_unless (FALSE == pgm_on_deferred_nak (sock, TRUE), "on_deferred_nak failed");
+	fail_unless (TRUE == mock_rate_is_nonblocking, "rate check blocking");
+	mock_is_rate_limited = FALSE;
+	fail_unless (TRUE == pgm_on_deferred_nak (sock, FALSE), "on_deferred_nak failed");
+	fail_unless (FALSE == mock_rate_is_nonblocking, "rate check not blocking");
+}
+END_TEST
+
 START_TEST (test_on_deferred_nak_fail_001)
 {
-	pgm_on_deferred_nak (NULL);
+	pgm_on_deferred_nak (NULL, FALSE);
 	fail ("reached");
 }
 END_TEST
@@ -832,6 +1017,20 @@ START_TEST (test_on_spmr_pass_002)
 }
 END_TEST
 
+/* source spmr answered by the SPM scheduler */
+START_TEST (test_on_spmr_pass_003)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	struct pgm_sk_buff_t* skb = generate_spmr ();
+	fail_if (NULL == skb, "generate_spmr failed");
+	skb->sock = sock;
+	sock->use_spm_scheduler = TRUE;
+	fail_unless (TRUE == pgm_on_spmr (sock, NULL, skb), "on_spmr failed");
+	fail_unless (TRUE == mock_spm_requested, "request failed");
+}
+END_TEST
+
 /* invalid spmr */
 START_TEST (test_on_spmr_fail_001)
 {
@@ -854,6 +1053,29 @@ START_TEST (test_on_spmr_fail_002)
 }
 END_TEST
 
+/* target:
+ *	uint32_t
+ *	repair_nla_hash (
+ *		pgm_sock_t*		sock,
+ *		const struct sockaddr*	from
+ *	)
+ */
+
+START_TEST (test_repair_nla_hash_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	const uint32_t nla = repair_nla_hash (sock, (struct sockaddr*)&mock_nak_src);
+	fail_unless (0 != nla, "hash failed");
+	fail_unless (nla == repair_nla_hash (sock, (struct sockaddr*)&mock_nak_src), "hash unstable");
+/* another address of the same hash takes neither the slot nor its repairs */
+	struct sockaddr_in* slot_addr = (struct sockaddr_in*)&sock->repair_nla[ nla & (PGM_REPAIR_NLA_SLOTS - 1) ].addr;
+	slot_addr->sin_addr.s_addr = inet_addr ("127.0.0.4");
+	fail_unless (0 == repair_nla_hash (sock, (struct sockaddr*)&mock_nak_src), "collision not detected");
+	fail_unless (inet_addr ("127.0.0.4") == slot_addr->sin_addr.s_addr, "slot overwritten");
+}
+END_TEST
+
 /* target:
  *	gboolean
  *	pgm_on_nak (
@@ -870,7 +1092,7 @@ START_TEST (test_on_nak_pass_001)
 	struct pgm_sk_buff_t* skb = generate_single_nak ();
 	fail_if (NULL == skb, "generate_single_nak failed");
 	skb->sock = sock;
-	fail_unless (TRUE == pgm_on_nak (sock, skb), "on_nak failed");
+	fail_unless (TRUE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
 }
 END_TEST
 
@@ -882,7 +1104,7 @@ START_TEST (test_on_nak_pass_002)
 	struct pgm_sk_buff_t* skb = generate_nak_list ();
 	fail_if (NULL == skb, "generate_nak_list failed");
 	skb->sock = sock;
-	fail_unless (TRUE == pgm_on_nak (sock, skb), "on_nak failed");
+	fail_unless (TRUE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
 }
 END_TEST
 
@@ -895,7 +1117,7 @@ START_TEST (test_on_nak_pass_003)
 	struct pgm_sk_buff_t* skb = generate_parity_nak ();
 	fail_if (NULL == skb, "generate_parity_nak failed");
 	skb->sock = sock;
-	fail_unless (TRUE == pgm_on_nak (sock, skb), "on_nak failed");
+	fail_unless (TRUE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
 }
 END_TEST
 
@@ -908,7 +1130,109 @@ START_TEST (test_on_nak_pass_004)
 	struct pgm_sk_buff_t* skb = generate_parity_nak_list ();
 	fail_if (NULL == skb, "generate_parity_nak_list failed");
 	skb->sock = sock;
-	fail_unless (TRUE == pgm_on_nak (sock, skb), "on_nak failed");
+	fail_unless (TRUE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+}
+END_TEST
+
+/* selective naks are held until flushed, duplicates collapse */
+START_TEST (test_on_nak_pass_005)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	struct pgm_sk_buff_t* skb = generate_single_nak ();
+	fail_if (NULL == skb, "generate_single_nak failed");
+	skb->sock = sock;
+	fail_unless (TRUE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	skb = generate_nak_list ();
+	fail_if (NULL == skb, "generate_nak_list failed");
+	skb->sock = sock;
+	fail_unless (TRUE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	fail_unless (0 == mock_retransmit_push_count, "push before flush");
+	fail_unless (62 == sock->nak_batch.len, "batch length failed");
+	pgm_on_nak_flush (sock);
+	fail_unless (62 == mock_retransmit_push_count, "push count failed");
+	fail_unless (0 == sock->nak_batch.len, "batch not empty");
+}
+END_TEST
+
+/* a sequence beyond the bitmap span flushes the pending batch */
+START_TEST (test_on_nak_pass_006)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	struct pgm_sk_buff_t* skb = generate_single_nak ();
+	fail_if (NULL == skb, "generate_single_nak failed");
+	skb->sock = sock;
+	fail_unless (TRUE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	skb = generate_single_nak ();
+	fail_if (NULL == skb, "generate_single_nak failed");
+	skb->sock = sock;
+	((struct pgm_nak*)skb->data)->nak_sqn = g_htonl (PGM_NAK_BATCH_SQNS);
+	fail_unless (TRUE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	fail_unless (1 == mock_retransmit_push_count, "push count failed");
+	fail_unless (PGM_NAK_BATCH_SQNS == sock->nak_batch.first_sqn, "first sqn failed");
+	pgm_on_nak_flush (sock);
+	fail_unless (2 == mock_retransmit_push_count, "push count failed");
+}
+END_TEST
+
+/* parity requests feed adaptive proactive parity with the missing packet count */
+START_TEST (test_on_nak_pass_007)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->use_ondemand_parity = TRUE;
+	sock->use_adaptive_parity = TRUE;
+	sock->tg_sqn_shift = 3;
+	struct pgm_sk_buff_t* skb = generate_parity_nak ();
+	fail_if (NULL == skb, "generate_parity_nak failed");
+	skb->sock = sock;
+	((struct pgm_nak*)skb->data)->nak_sqn = g_htonl (16 | 3);
+	fail_unless (TRUE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	fail_unless (3 == sock->parity_epoch_naks, "residual count failed");
+}
+END_TEST
+
+/* retransmit requests are queued under the transmit window lock */
+START_TEST (test_on_nak_pass_008)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->use_ondemand_parity = TRUE;
+	mock_txw_spinlock = &sock->txw_spinlock;
+	struct pgm_sk_buff_t* skb = generate_parity_nak ();
+	fail_if (NULL == skb, "generate_parity_nak failed");
+	skb->sock = sock;
+	fail_unless (TRUE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	skb = generate_single_nak ();
+	fail_if (NULL == skb, "generate_single_nak failed");
+	skb->sock = sock;
+	fail_unless (TRUE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	pgm_on_nak_flush (sock);
+	fail_unless (2 == mock_retransmit_push_count, "push count failed");
+	fail_unless (TRUE == mock_is_push_locked, "push unlocked");
+/* lock is released afterwards */
+	fail_unless (TRUE == pgm_spinlock_trylock (&sock->txw_spinlock), "lock held");
+	pgm_spinlock_unlock (&sock->txw_spinlock);
+}
+END_TEST
+
+/* a forwarded nak is repaired towards the original requester */
+START_TEST (test_on_nak_pass_009)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->use_unicast_repair = TRUE;
+	struct pgm_sk_buff_t* skb = generate_path_nla_nak ();
+	fail_if (NULL == skb, "generate_path_nla_nak failed");
+	skb->sock = sock;
+	fail_unless (TRUE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
+	fail_unless (1 == sock->nak_batch.len, "batch length failed");
+	const uint32_t nla = sock->nak_batch.nla[ 0 ];
+	fail_if (0 == nla, "no sole requester");
+	const struct sockaddr_in* slot_addr = (const struct sockaddr_in*)&sock->repair_nla[ nla & (PGM_REPAIR_NLA_SLOTS - 1) ].addr;
+	fail_unless (AF_INET == slot_addr->sin_family, "family failed");
+	fail_unless (inet_addr ("127.0.0.4") == slot_addr->sin_addr.s_addr, "requester failed");
 }
 END_TEST
 
@@ -920,17 +1244,93 @@ START_TEST (test_on_nak_fail_001)
 	fail_if (NULL == skb, "generate_single_nak failed");
 	skb->sock = sock;
 	mock_is_valid_nak = FALSE;
-	fail_unless (FALSE == pgm_on_nak (sock, skb), "on_nak failed");
+	fail_unless (FALSE == pgm_on_nak (sock, skb, (struct sockaddr*)&mock_nak_src), "on_nak failed");
 }
 END_TEST
 
 START_TEST (test_on_nak_fail_002)
 {
-	pgm_on_nak (NULL, NULL);
+	pgm_on_nak (NULL, NULL, NULL);
 	fail ("reached");
 }
 END_TEST
 
+/* target:
+ *	void
+ *	adapt_proactive_parity (
+ *		pgm_sock_t*	sock
+ *	)
+ */
+
+static
+pgm_sock_t*
+generate_adaptive_sock (void)
+{
+	pgm_sock_t* sock = generate_sock ();
+	sock->use_proactive_parity = TRUE;
+	sock->use_adaptive_parity = TRUE;
+	sock->rs_n = 255;
+	sock->rs_k = 8;
+	sock->tg_sqn_shift = 3;
+	sock->rs_proactive_h = 1;
+	sock->rs_proactive_h_min = 0;
+	sock->rs_proactive_h_max = 4;
+	sock->parity_target_ppm = 1000;
+	return sock;
+}
+
+/* residual naks above target raise h at the end of the epoch */
+START_TEST (test_adapt_proactive_parity_pass_001)
+{
+	pgm_sock_t* sock = generate_adaptive_sock ();
+	sock->parity_epoch_naks = 4;
+	for (unsigned i = 1; i < PGM_PARITY_EPOCH_TGS; i++)
+		adapt_proactive_parity (sock);
+	fail_unless (1 == sock->rs_proactive_h, "early adaptation");
+	adapt_proactive_parity (sock);
+	fail_unless (2 == sock->rs_proactive_h, "h not raised");
+	fail_unless (0 == sock->parity_epoch_naks, "epoch not reset");
+	fail_unless (PGM_PARITY_HOLD_EPOCHS == sock->parity_hold, "hold not set");
+}
+END_TEST
+
+/* clean epochs lower h after the hold period, bounded by the minimum */
+START_TEST (test_adapt_proactive_parity_pass_002)
+{
+	pgm_sock_t* sock = generate_adaptive_sock ();
+	sock->rs_proactive_h_min = 1;
+	sock->rs_proactive_h = 2;
+	sock->parity_hold = 1;
+	for (unsigned i = 0; i < PGM_PARITY_EPOCH_TGS; i++)
+		adapt_proactive_parity (sock);
+	fail_unless (2 == sock->rs_proactive_h, "h lowered during hold");
+	for (unsigned i = 0; i < PGM_PARITY_EPOCH_TGS; i++)
+		adapt_proactive_parity (sock);
+	fail_unless (1 == sock->rs_proactive_h, "h not lowered");
+	sock->parity_hold = 0;
+	for (unsigned i = 0; i < PGM_PARITY_EPOCH_TGS; i++)
+		adapt_proactive_parity (sock);
+	fail_unless (1 == sock->rs_proactive_h, "h below minimum");
+}
+END_TEST
+
+/* ACKer loss sets a floor, capped by the maximum */
+START_TEST (test_adapt_proactive_parity_pass_003)
+{
+	pgm_sock_t* sock = generate_adaptive_sock ();
+	sock->use_pgmcc = TRUE;
+	sock->parity_hold = PGM_PARITY_HOLD_EPOCHS;
+	sock->acker_loss_rate = pgm_fp16 (1) / 4;
+	for (unsigned i = 0; i < PGM_PARITY_EPOCH_TGS; i++)
+		adapt_proactive_parity (sock);
+	fail_unless (2 == sock->rs_proactive_h, "loss floor failed");
+	sock->acker_loss_rate = pgm_fp16 (1) - 1;
+	for (unsigned i = 0; i < PGM_PARITY_EPOCH_TGS; i++)
+		adapt_proactive_parity (sock);
+	fail_unless (4 == sock->rs_proactive_h, "maximum failed");
+}
+END_TEST
+
 /* target:
  *	gboolean
  *	pgm_on_nnak (
@@ -1188,6 +1588,9 @@ make_test_suite (void)
 	suite_add_tcase (s, tc_on_deferred_nak);
 	tcase_add_checked_fixture (tc_on_deferred_nak, mock_setup, NULL);
 	tcase_add_test (tc_on_deferred_nak, test_on_deferred_nak_pass_001);
+	tcase_add_test (tc_on_deferred_nak, test_on_deferred_nak_pass_002);
+	tcase_add_test (tc_on_deferred_nak, test_on_deferred_nak_pass_003);
+	tcase_add_test (tc_on_deferred_nak, test_on_deferred_nak_pass_004);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_on_deferred_nak, test_on_deferred_nak_fail_001, SIGABRT);
 #endif
@@ -1197,11 +1600,17 @@ make_test_suite (void)
 	tcase_add_checked_fixture (tc_on_spmr, mock_setup, NULL);
 	tcase_add_test (tc_on_spmr, test_on_spmr_pass_001);
 	tcase_add_test (tc_on_spmr, test_on_spmr_pass_002);
+	tcase_add_test (tc_on_spmr, test_on_spmr_pass_003);
 	tcase_add_test (tc_on_spmr, test_on_spmr_fail_001);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_on_spmr, test_on_spmr_fail_002, SIGABRT);
 #endif
 
+	TCase* tc_repair_nla_hash = tcase_create ("repair-nla-hash");
+	suite_add_tcase (s, tc_repair_nla_hash);
+	tcase_add_checked_fixture (tc_repair_nla_hash, mock_setup, NULL);
+	tcase_add_test (tc_repair_nla_hash, test_repair_nla_hash_pass_001);
+
 	TCase* tc_on_nak = tcase_create ("on-nak");
 	suite_add_tcase (s, tc_on_nak);
 	tcase_add_checked_fixture (tc_on_nak, mock_setup, NULL);
@@ -1209,11 +1618,23 @@ make_test_suite (void)
 	tcase_add_test (tc_on_nak, test_on_nak_pass_002);
 	tcase_add_test (tc_on_nak, test_on_nak_pass_003);
 	tcase_add_test (tc_on_nak, test_on_nak_pass_004);
+	tcase_add_test (tc_on_nak, test_on_nak_pass_005);
+	tcase_add_test (tc_on_nak, test_on_nak_pass_006);
+	tcase_add_test (tc_on_nak, test_on_nak_pass_007);
+	tcase_add_test (tc_on_nak, test_on_nak_pass_008);
+	tcase_add_test (tc_on_nak, test_on_nak_pass_009);
 	tcase_add_test (tc_on_nak, test_on_nak_fail_001);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_on_nak, test_on_nak_fail_002, SIGABRT);
 #endif
 
+	TCase* tc_adapt_proactive_parity = tcase_create ("adapt-proactive-parity");
+	suite_add_tcase (s, tc_adapt_proactive_parity);
+	tcase_add_checked_fixture (tc_adapt_proactive_parity, mock_setup, NULL);
+	tcase_add_test (tc_adapt_proactive_parity, test_adapt_proactive_parity_pass_001);
+	tcase_add_test (tc_adapt_proactive_parity, test_adapt_proactive_parity_pass_002);
+	tcase_add_test (tc_adapt_proactive_parity, test_adapt_proactive_parity_pass_003);
+
 	TCase* tc_on_nnak = tcase_create ("on-nnak");
 	suite_add_tcase (s, tc_on_nnak);
 	tcase_add_checked_fixture (tc_on_nnak, mock_setup, NULL);
@@ -0,0 +1,523 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * Process-wide SPM scheduler, one thread sends the ambient and heartbeat SPMs
+ * of every opted-in source socket so that a process with thousands of
+ * sessions wakes once per burst rather than once per socket.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+#include <errno.h>
+#ifndef _WIN32
+#	ifdef HAVE_POLL
+#		include <poll.h>
+#	endif
+#else
+#	include <process.h>
+#endif
+#include <impl/i18n.h>
+#include <impl/framework.h>
+#include <impl/socket.h>
+#include <impl/source.h>
+#include <impl/spm_scheduler.h>
+
+
+//#define SPM_SCHEDULER_DEBUG
+
+typedef struct pgm_spm_scheduler_t pgm_spm_scheduler_t;
+
+struct pgm_spm_scheduler_t {
+#ifndef _WIN32
+	pthread_t			thread;
+#else
+	HANDLE				thread;
+	unsigned			thread_id;
+#endif
+	pgm_notify_t			wake_notify;
+	volatile uint32_t		is_terminated;
+
+/* serialised by spm_scheduler_mutex */
+	pgm_time_t			wake_at;		/* 0 = pass in progress */
+	pgm_sock_t**			socks;
+	unsigned			len;
+	unsigned			alloc;
+	pgm_sock_t**			pass;			/* copy of socks for one pass */
+	unsigned			pass_len;
+	unsigned			pass_alloc;
+	pgm_sock_t*			dispatching;		/* sending outside the lock */
+	pgm_cond_t			dispatch_cond;
+};
+
+/* guards the socket set and the scheduler lifetime, never held while sending */
+static pgm_mutex_t		spm_scheduler_mutex;
+static pgm_spm_scheduler_t*	spm_scheduler = NULL;
+
+#ifndef _WIN32
+static void* pgm_spm_scheduler_routine (void*);
+#else
+static unsigned __stdcall pgm_spm_scheduler_routine (void*);
+#endif
+
+
+PGM_GNUC_INTERNAL
+void
+pgm_spm_scheduler_init (void)
+{
+	pgm_mutex_init (&spm_scheduler_mutex);
+}
+
+static void _pgm_spm_scheduler_destroy (pgm_spm_scheduler_t*const);
+
+PGM_GNUC_INTERNAL
+void
+pgm_spm_scheduler_shutdown (void)
+{
+/* every socket has been closed, normally taking the thread down with it */
+	if (PGM_UNLIKELY(NULL != spm_scheduler)) {
+		_pgm_spm_scheduler_destroy (spm_scheduler);
+		spm_scheduler = NULL;
+	}
+	pgm_mutex_free (&spm_scheduler_mutex);
+}
+
+/* ambient interval shortened by a random fraction, never lengthened so that
+ * receivers still see an SPM at least once per configured interval.
+ */
+
+static inline
+pgm_time_t
+_pgm_spm_scheduler_jitter (
+	const unsigned		interval
+	)
+{
+	const unsigned spread = MIN(interval / PGM_SPM_SCHEDULER_JITTER, (unsigned)INT32_MAX);
+	if (spread < 2)
+		return interval;
+	return interval - (unsigned)pgm_random_int_range (0, (int32_t)spread);
+}
+
+/* send whatever SPM of sock is due at now.
+ *
+ * heartbeats due within a tick and ambient SPMs due within the slack are sent
+ * in this pass.  an ambient SPM is skipped when a heartbeat following ODATA or
+ * an SPMR reply already went out within the ambient interval.
+ *
+ * returns the next time sock needs the scheduler.
+ */
+
+static
+pgm_time_t
+_pgm_spm_scheduler_dispatch (
+	pgm_sock_t* const	sock,
+	const pgm_time_t	now
+	)
+{
+	const pgm_time_t heartbeat_horizon = now + PGM_SPM_SCHEDULER_TICK;
+	const pgm_time_t ambient_horizon   = now + PGM_SPM_SCHEDULER_SLACK;
+	pgm_time_t next_spm;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+
+	pgm_mutex_lock (&sock->timer_mutex);
+	const unsigned spm_heartbeat_state = sock->spm_heartbeat_state;
+	const pgm_time_t next_heartbeat_spm = sock->next_heartbeat_spm;
+	pgm_mutex_unlock (&sock->timer_mutex);
+
+	const bool is_heartbeat_due = spm_heartbeat_state && pgm_time_after_eq (heartbeat_horizon, next_heartbeat_spm);
+	const bool is_requested = pgm_atomic_compare_and_swap32 (&sock->is_pending_spm, 1, 0);
+	bool is_ambient_due = pgm_time_after_eq (ambient_horizon, sock->next_ambient_spm);
+
+	if (is_ambient_due &&
+	    !is_heartbeat_due &&
+	    !is_requested &&
+	    0 != sock->last_spm &&
+	    pgm_time_after (sock->last_spm + sock->spm_ambient_interval, ambient_horizon))
+	{
+		sock->next_ambient_spm = sock->last_spm + sock->spm_ambient_interval;
+/* count each skipped ambient SPM once however often it is pushed back */
+		if (!sock->is_ambient_deferred) {
+			sock->cumulative_stats[PGM_PC_SOURCE_AMBIENT_SPMS_SUPPRESSED]++;
+			sock->is_ambient_deferred = TRUE;
+		}
+		is_ambient_due = FALSE;
+	}
+
+	if (is_heartbeat_due || is_ambient_due || is_requested)
+	{
+		if (!pgm_send_spm (sock, 0)) {
+/* blocked, retry on the next tick */
+			if (is_requested)
+				pgm_atomic_write32 (&sock->is_pending_spm, 1);
+			return heartbeat_horizon;
+		}
+		sock->last_spm = now;
+
+		if (is_ambient_due) {
+			sock->next_ambient_spm = now + _pgm_spm_scheduler_jitter (sock->spm_ambient_interval);
+			sock->is_ambient_deferred = FALSE;
+		}
+
+		if (is_heartbeat_due)
+		{
+			unsigned new_heartbeat_state = spm_heartbeat_state;
+			pgm_time_t new_heartbeat_spm = next_heartbeat_spm;
+			do {
+				new_heartbeat_spm += sock->spm_heartbeat_interval[new_heartbeat_state++];
+				if (new_heartbeat_state == sock->spm_heartbeat_len) {
+					new_heartbeat_state = 0;
+					new_heartbeat_spm   = now + sock->spm_ambient_interval;
+					break;
+				}
+			} while (pgm_time_after_eq (heartbeat_horizon, new_heartbeat_spm));
+/* check for reset heartbeat */
+			pgm_mutex_lock (&sock->timer_mutex);
+			if (next_heartbeat_spm == sock->next_heartbeat_spm) {
+				sock->spm_heartbeat_state = new_heartbeat_state;
+				sock->next_heartbeat_spm  = new_heartbeat_spm;
+			}
+			pgm_mutex_unlock (&sock->timer_mutex);
+		}
+	}
+
+	pgm_mutex_lock (&sock->timer_mutex);
+	next_spm = sock->spm_heartbeat_state ? MIN(sock->next_heartbeat_spm, sock->next_ambient_spm) : sock->next_ambient_spm;
+	pgm_mutex_unlock (&sock->timer_mutex);
+	return next_spm;
+}
+
+/* block until the next SPM is due or a socket asks for an earlier one.
+ */
+
+static
+void
+_pgm_spm_scheduler_wait (
+	pgm_spm_scheduler_t* const sched,
+	const long		   timeout		/* μs, -1 = infinite */
+	)
+{
+	const SOCKET fd = pgm_notify_get_socket (&sched->wake_notify);
+#ifdef HAVE_POLL
+	struct pollfd fds[1];
+	memset (fds, 0, sizeof (fds));
+	fds[0].fd = fd;
+	fds[0].events = POLLIN;
+/* round up so that a sub-millisecond deadline does not spin */
+	poll (fds, 1, timeout < 0 ? -1 : (int)((timeout + 999) / 1000));
+#else
+	fd_set readfds;
+	FD_ZERO(&readfds);
+	FD_SET(fd, &readfds);
+	struct timeval tv_timeout = {
+		.tv_sec		= timeout / 1000000L,
+		.tv_usec	= timeout % 1000000L
+	};
+	select ((int)fd + 1, &readfds, NULL, NULL, timeout < 0 ? NULL : &tv_timeout);
+#endif /* HAVE_POLL */
+	pgm_notify_clear (&sched->wake_notify);
+}
+
+/* scheduler thread: one pass over a copy of the socket set per wake-up, then
+ * sleep until the earliest SPM still outstanding.  each socket is dispatched
+ * with the lock released, a socket removed meanwhile is dropped from the copy.
+ */
+
+#ifndef _WIN32
+static
+void*
+#else
+static
+unsigned
+__stdcall
+#endif
+pgm_spm_scheduler_routine (
+	void*		arg
+	)
+{
+	pgm_spm_scheduler_t* sched = (pgm_spm_scheduler_t*)arg;
+
+	while (!pgm_atomic_read32 (&sched->is_terminated))
+	{
+		const pgm_time_t now = pgm_time_update_now();
+		pgm_time_t next_spm = 0;
+		long timeout = -1;
+
+		pgm_mutex_lock (&spm_scheduler_mutex);
+		sched->wake_at = 0;
+		if (sched->pass_alloc < sched->len) {
+			sched->pass_alloc = sched->alloc;
+			sched->pass = pgm_realloc (sched->pass, sched->pass_alloc * sizeof (pgm_sock_t*));
+		}
+		if (sched->len > 0)
+			memcpy (sched->pass, sched->socks, sched->len * sizeof (pgm_sock_t*));
+		sched->pass_len = sched->len;
+		for (unsigned i = 0; i < sched->pass_len; i++) {
+			pgm_sock_t* sock = sched->pass[i];
+			if (NULL == sock)
+				continue;
+			sched->dispatching = sock;
+			pgm_mutex_unlock (&spm_scheduler_mutex);
+			const pgm_time_t due = _pgm_spm_scheduler_dispatch (sock, now);
+			pgm_mutex_lock (&spm_scheduler_mutex);
+			sched->dispatching = NULL;
+			pgm_cond_broadcast (&sched->dispatch_cond);
+			next_spm = (0 == next_spm) ? due : MIN(next_spm, due);
+		}
+		sched->pass_len = 0;
+		sched->wake_at = next_spm;
+		pgm_mutex_unlock (&spm_scheduler_mutex);
+
+		if (next_spm) {
+			const pgm_time_t after = pgm_time_update_now();
+			timeout = pgm_time_after (next_spm, after) ? (long)pgm_to_usecs (next_spm - after) : 0;
+		}
+		_pgm_spm_scheduler_wait (sched, timeout);
+	}
+
+#ifndef _WIN32
+	return NULL;
+#else
+	_endthread();
+	return 0;
+#endif
+}
+
+/* returns a running scheduler, or NULL on failure with error set.
+ */
+
+static
+pgm_spm_scheduler_t*
+_pgm_spm_scheduler_create (
+	pgm_error_t**	error
+	)
+{
+	pgm_spm_scheduler_t* sched;
+
+	sched = pgm_new0 (pgm_spm_scheduler_t, 1);
+	pgm_cond_init (&sched->dispatch_cond);
+	if (0 != pgm_notify_init (&sched->wake_notify)) {
+		const int save_errno = pgm_get_last_sock_error();
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_sock_errno (save_errno),
+			     _("Creating SPM scheduler notification channel: %s"),
+			     pgm_sock_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		goto err_free;
+	}
+
+#ifndef _WIN32
+	const int status = pthread_create (&sched->thread, NULL, &pgm_spm_scheduler_routine, sched);
+	if (0 != status) {
+		const int save_errno = status;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_errno (save_errno),
+			     _("Creating SPM scheduler thread: %s"),
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		goto err_destroy_notify;
+	}
+#else
+	sched->thread = (HANDLE)_beginthreadex (NULL, 0, &pgm_spm_scheduler_routine, sched, 0, &sched->thread_id);
+	if (0 == sched->thread) {
+		const int save_errno = errno;
+		char errbuf[1024];
+		pgm_set_error (error,
+			     PGM_ERROR_DOMAIN_SOCKET,
+			     pgm_error_from_errno (save_errno),
+			     _("Creating SPM scheduler thread: %s"),
+			     pgm_strerror_s (errbuf, sizeof (errbuf), save_errno));
+		goto err_destroy_notify;
+	}
+#endif /* _WIN32 */
+	return sched;
+
+err_destroy_notify:
+	pgm_notify_destroy (&sched->wake_notify);
+err_free:
+	pgm_cond_free (&sched->dispatch_cond);
+	pgm_free (sched);
+	return NULL;
+}
+
+/* stop and join the thread, the caller must not hold spm_scheduler_mutex.
+ */
+
+static
+void
+_pgm_spm_scheduler_destroy (
+	pgm_spm_scheduler_t* const sched
+	)
+{
+	pgm_atomic_write32 (&sched->is_terminated, 1);
+	pgm_notify_send (&sched->wake_notify);
+#ifndef _WIN32
+	pthread_join (sched->thread, NULL);
+#else
+	WaitForSingleObject (sched->thread, INFINITE);
+	CloseHandle (sched->thread);
+#endif
+	pgm_notify_destroy (&sched->wake_notify);
+	pgm_cond_free (&sched->dispatch_cond);
+	pgm_free (sched->socks);
+	pgm_free (sched->pass);
+	pgm_free (sched);
+}
+
+/* hand the SPMs of a connected source socket to the scheduler, starting the
+ * thread for the first socket.  the first ambient SPM is placed at random
+ * within the ambient interval so that sockets connected together drift apart.
+ *
+ * called from pgm_connect() with the socket write lock held.
+ *
+ * returns TRUE on success, returns FALSE on failure with error set.
+ */
+
+PGM_GNUC_INTERNAL
+bool
+pgm_spm_scheduler_add (
+	pgm_sock_t*   const restrict sock,
+	pgm_error_t**	    restrict error
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (sock->can_send_data);
+
+	pgm_debug ("pgm_spm_scheduler_add (sock:%p error:%p)",
+		(const void*)sock, (const void*)error);
+
+	pgm_mutex_lock (&spm_scheduler_mutex);
+	if (NULL == spm_scheduler) {
+		spm_scheduler = _pgm_spm_scheduler_create (error);
+		if (PGM_UNLIKELY(NULL == spm_scheduler)) {
+			pgm_mutex_unlock (&spm_scheduler_mutex);
+			return FALSE;
+		}
+	}
+	if (spm_scheduler->len == spm_scheduler->alloc) {
+		spm_scheduler->alloc = spm_scheduler->alloc ? spm_scheduler->alloc * 2 : 64;
+		spm_scheduler->socks = pgm_realloc (spm_scheduler->socks, spm_scheduler->alloc * sizeof (pgm_sock_t*));
+	}
+	const unsigned spread = MIN(sock->spm_ambient_interval, (unsigned)INT32_MAX);
+	sock->next_ambient_spm = pgm_time_update_now() + (spread > 1 ? (pgm_time_t)pgm_random_int_range (0, (int32_t)spread) : (pgm_time_t)spread);
+	sock->last_spm = 0;
+	sock->is_ambient_deferred = FALSE;
+	pgm_atomic_write32 (&sock->is_pending_spm, 0);
+	spm_scheduler->socks[ spm_scheduler->len++ ] = sock;
+	pgm_notify_send (&spm_scheduler->wake_notify);
+	pgm_mutex_unlock (&spm_scheduler_mutex);
+	return TRUE;
+}
+
+/* take sock out of the scheduler, stopping the thread with the last socket.
+ * no SPM of sock is in flight once this returns.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_spm_scheduler_remove (
+	pgm_sock_t* const	sock
+	)
+{
+	pgm_spm_scheduler_t* sched = NULL;
+
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+
+	pgm_debug ("pgm_spm_scheduler_remove (sock:%p)", (const void*)sock);
+
+	pgm_mutex_lock (&spm_scheduler_mutex);
+	if (NULL == spm_scheduler) {
+		pgm_mutex_unlock (&spm_scheduler_mutex);
+		return;
+	}
+	for (unsigned i = 0; i < spm_scheduler->len; i++) {
+		if (sock == spm_scheduler->socks[i]) {
+			spm_scheduler->socks[i] = spm_scheduler->socks[ --spm_scheduler->len ];
+			break;
+		}
+	}
+/* drop sock from a pass in progress and wait out a send already under way */
+	for (unsigned i = 0; i < spm_scheduler->pass_len; i++) {
+		if (sock == spm_scheduler->pass[i]) {
+			spm_scheduler->pass[i] = NULL;
+			break;
+		}
+	}
+	while (sock == spm_scheduler->dispatching)
+#ifndef _WIN32
+		pgm_cond_wait (&spm_scheduler->dispatch_cond, &spm_scheduler_mutex.pthread_mutex);
+#else
+		pgm_cond_wait (&spm_scheduler->dispatch_cond, &spm_scheduler_mutex.win32_crit);
+#endif
+	if (0 == spm_scheduler->len) {
+		sched = spm_scheduler;
+		spm_scheduler = NULL;
+	}
+	pgm_mutex_unlock (&spm_scheduler_mutex);
+
+	if (NULL != sched)
+		_pgm_spm_scheduler_destroy (sched);
+}
+
+/* ask for an SPM on the next pass, answering an SPMR without racing the
+ * scheduler on the SPM sequence number.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_spm_scheduler_request (
+	pgm_sock_t* const	sock
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+
+	pgm_atomic_write32 (&sock->is_pending_spm, 1);
+	pgm_mutex_lock (&spm_scheduler_mutex);
+	if (PGM_LIKELY(NULL != spm_scheduler))
+		pgm_notify_send (&spm_scheduler->wake_notify);
+	pgm_mutex_unlock (&spm_scheduler_mutex);
+}
+
+/* a heartbeat was brought forward to due, wake the scheduler only if it is
+ * asleep until later.  callers update the heartbeat under the timer lock
+ * first, which orders against the pass reading it, and must release it before
+ * calling.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_spm_scheduler_kick (
+	const pgm_time_t	due
+	)
+{
+	pgm_mutex_lock (&spm_scheduler_mutex);
+	if (PGM_LIKELY(NULL != spm_scheduler) &&
+	    (0 == spm_scheduler->wake_at || pgm_time_after (spm_scheduler->wake_at, due)))
+	{
+		pgm_notify_send (&spm_scheduler->wake_notify);
+	}
+	pgm_mutex_unlock (&spm_scheduler_mutex);
+}
+
+/* eof */
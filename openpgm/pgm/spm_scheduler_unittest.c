@@ -0,0 +1,385 @@
+/* vim:ts=8:sts=8:sw=4:noai:noexpandtab
+ *
+ * unit tests for the process-wide SPM scheduler.
+ *
+ * Copyright (c) 2006-2011 Miru Limited.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <check.h>
+
+#ifdef _WIN32
+#	define PGM_CHECK_NOFORK		1
+#endif
+
+
+/* mock state */
+
+#define pgm_time_update_now		mock_pgm_time_update_now
+#define pgm_random_int_range		mock_pgm_random_int_range
+#define pgm_send_spm			mock_pgm_send_spm
+
+#define SPM_SCHEDULER_DEBUG
+#include "spm_scheduler.c"
+
+static pgm_time_t _mock_pgm_time_update_now(void);
+pgm_time_update_func mock_pgm_time_update_now = _mock_pgm_time_update_now;
+static pgm_time_t mock_pgm_time_now = 0x1;
+static bool mock_send_status = TRUE;
+static volatile uint32_t mock_spms_sent = 0;
+static volatile uint32_t mock_send_is_blocked = 0;
+static volatile uint32_t mock_send_is_waiting = 0;
+
+static unsigned heartbeat_intervals[] = { 0, pgm_msecs(100), pgm_secs(1), pgm_secs(5) };
+
+static
+pgm_sock_t*
+generate_sock (void)
+{
+	pgm_sock_t* sock = g_new0 (pgm_sock_t, 1);
+	pgm_mutex_init (&sock->timer_mutex);
+	sock->can_send_data = TRUE;
+	sock->use_spm_scheduler = TRUE;
+	sock->spm_ambient_interval = pgm_secs(30);
+	sock->spm_heartbeat_interval = heartbeat_intervals;
+	sock->spm_heartbeat_len = PGM_N_ELEMENTS(heartbeat_intervals) - 1;
+	sock->next_ambient_spm = mock_pgm_time_now + pgm_secs(30);
+	return sock;
+}
+
+static
+void
+mock_setup (void)
+{
+	mock_pgm_time_now = pgm_secs(100);
+	mock_send_status = TRUE;
+	mock_spms_sent = 0;
+	mock_send_is_blocked = 0;
+	mock_send_is_waiting = 0;
+}
+
+
+/* mock functions for external references */
+
+size_t
+pgm_pkt_offset (
+	const bool		can_fragment,
+	const sa_family_t	pgmcc_family	/* 0 = disable */
+	)
+{
+	return 0;
+}
+
+/** time module */
+static
+pgm_time_t
+_mock_pgm_time_update_now (void)
+{
+	return mock_pgm_time_now;
+}
+
+/** rand module */
+PGM_GNUC_INTERNAL
+int32_t
+mock_pgm_random_int_range (
+	int32_t			begin,
+	int32_t			end
+	)
+{
+	return begin;
+}
+
+/** source module */
+PGM_GNUC_INTERNAL
+bool
+mock_pgm_send_spm (
+	pgm_sock_t*		sock,
+	int			flags
+	)
+{
+	g_assert (NULL != sock);
+	if (pgm_atomic_read32 (&mock_send_is_blocked)) {
+		pgm_atomic_write32 (&mock_send_is_waiting, 1);
+		while (pgm_atomic_read32 (&mock_send_is_blocked))
+			g_usleep (1000);
+	}
+	if (!mock_send_status)
+		return FALSE;
+	pgm_atomic_inc32 (&mock_spms_sent);
+	return TRUE;
+}
+
+
+/* target:
+ *	pgm_time_t
+ *	_pgm_spm_scheduler_dispatch (
+ *		pgm_sock_t*		sock,
+ *		const pgm_time_t	now
+ *	)
+ */
+
+/* ambient due */
+START_TEST (test_dispatch_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	const pgm_time_t now = mock_pgm_time_now + pgm_secs(30);
+	const pgm_time_t next_spm = _pgm_spm_scheduler_dispatch (sock, now);
+	fail_unless (1 == mock_spms_sent, "send failed");
+	fail_unless (now == sock->last_spm, "last_spm failed");
+	fail_unless (now + pgm_secs(30) == sock->next_ambient_spm, "next_ambient_spm failed");
+	fail_unless (next_spm == sock->next_ambient_spm, "next_spm failed");
+}
+END_TEST
+
+/* ambient covered by a heartbeat half an interval ago */
+START_TEST (test_dispatch_pass_002)
+{
+	pgm_sock_t* sock = generate_sock ();
+	const pgm_time_t now = mock_pgm_time_now + pgm_secs(30);
+	sock->last_spm = now - pgm_secs(15);
+	const pgm_time_t next_spm = _pgm_spm_scheduler_dispatch (sock, now);
+	fail_unless (0 == mock_spms_sent, "send failed");
+	fail_unless (1 == sock->cumulative_stats[PGM_PC_SOURCE_AMBIENT_SPMS_SUPPRESSED], "counter failed");
+	fail_unless (now + pgm_secs(15) == sock->next_ambient_spm, "next_ambient_spm failed");
+	fail_unless (next_spm == sock->next_ambient_spm, "next_spm failed");
+/* pushed back again by a later heartbeat without counting twice */
+	sock->last_spm = now + pgm_secs(10);
+	_pgm_spm_scheduler_dispatch (sock, now + pgm_secs(15));
+	fail_unless (0 == mock_spms_sent, "send failed");
+	fail_unless (1 == sock->cumulative_stats[PGM_PC_SOURCE_AMBIENT_SPMS_SUPPRESSED], "counter failed");
+	fail_unless (now + pgm_secs(40) == sock->next_ambient_spm, "next_ambient_spm failed");
+/* one interval after the heartbeat the ambient SPM is sent */
+	_pgm_spm_scheduler_dispatch (sock, now + pgm_secs(40));
+	fail_unless (1 == mock_spms_sent, "send failed");
+	fail_unless (FALSE == sock->is_ambient_deferred, "deferred failed");
+}
+END_TEST
+
+/* heartbeat due within a tick */
+START_TEST (test_dispatch_pass_003)
+{
+	pgm_sock_t* sock = generate_sock ();
+	const pgm_time_t now = mock_pgm_time_now;
+	sock->spm_heartbeat_state = 1;
+	sock->next_heartbeat_spm = now + PGM_SPM_SCHEDULER_TICK;
+	const pgm_time_t next_spm = _pgm_spm_scheduler_dispatch (sock, now);
+	fail_unless (1 == mock_spms_sent, "send failed");
+	fail_unless (2 == sock->spm_heartbeat_state, "heartbeat state failed");
+	fail_unless (now + PGM_SPM_SCHEDULER_TICK + pgm_msecs(100) == sock->next_heartbeat_spm, "next_heartbeat_spm failed");
+	fail_unless (next_spm == sock->next_heartbeat_spm, "next_spm failed");
+}
+END_TEST
+
+/* SPMR request with nothing due */
+START_TEST (test_dispatch_pass_004)
+{
+	pgm_sock_t* sock = generate_sock ();
+	const pgm_time_t now = mock_pgm_time_now;
+	sock->is_pending_spm = 1;
+	_pgm_spm_scheduler_dispatch (sock, now);
+	fail_unless (1 == mock_spms_sent, "send failed");
+	fail_unless (0 == sock->is_pending_spm, "request not cleared");
+	fail_unless (mock_pgm_time_now + pgm_secs(30) == sock->next_ambient_spm, "next_ambient_spm changed");
+}
+END_TEST
+
+/* blocked send retries on the next tick */
+START_TEST (test_dispatch_pass_005)
+{
+	pgm_sock_t* sock = generate_sock ();
+	const pgm_time_t now = mock_pgm_time_now;
+	sock->is_pending_spm = 1;
+	mock_send_status = FALSE;
+	const pgm_time_t next_spm = _pgm_spm_scheduler_dispatch (sock, now);
+	fail_unless (now + PGM_SPM_SCHEDULER_TICK == next_spm, "next_spm failed");
+	fail_unless (1 == sock->is_pending_spm, "request lost");
+	fail_unless (0 == sock->last_spm, "last_spm failed");
+}
+END_TEST
+
+START_TEST (test_dispatch_fail_001)
+{
+	_pgm_spm_scheduler_dispatch (NULL, 0);
+	fail ("reached");
+}
+END_TEST
+
+/* target:
+ *	bool
+ *	pgm_spm_scheduler_add (
+ *		pgm_sock_t*		sock,
+ *		pgm_error_t**		error
+ *	)
+ *
+ *	void
+ *	pgm_spm_scheduler_remove (
+ *		pgm_sock_t*		sock
+ *	)
+ */
+
+START_TEST (test_add_pass_001)
+{
+	pgm_error_t* err = NULL;
+	pgm_sock_t* sock[2] = { generate_sock (), generate_sock () };
+	pgm_spm_scheduler_init ();
+	fail_unless (TRUE == pgm_spm_scheduler_add (sock[0], &err), "add failed");
+	fail_unless (TRUE == pgm_spm_scheduler_add (sock[1], &err), "add failed");
+	fail_unless (NULL != spm_scheduler, "scheduler not started");
+	fail_unless (2 == spm_scheduler->len, "len failed");
+/* first ambient SPM placed within the interval, mock places it now */
+	while (pgm_atomic_read32 (&mock_spms_sent) < 2)
+		g_usleep (1000);
+	pgm_spm_scheduler_remove (sock[0]);
+	fail_unless (NULL != spm_scheduler, "scheduler stopped");
+	fail_unless (1 == spm_scheduler->len, "len failed");
+	fail_unless (sock[1] == spm_scheduler->socks[0], "socks failed");
+	pgm_spm_scheduler_remove (sock[1]);
+	fail_unless (NULL == spm_scheduler, "scheduler not stopped");
+	pgm_spm_scheduler_shutdown ();
+}
+END_TEST
+
+/* the socket set stays open while an SPM is being sent */
+START_TEST (test_add_pass_002)
+{
+	pgm_error_t* err = NULL;
+	pgm_sock_t* sock[2] = { generate_sock (), generate_sock () };
+	pgm_spm_scheduler_init ();
+	pgm_atomic_write32 (&mock_send_is_blocked, 1);
+	fail_unless (TRUE == pgm_spm_scheduler_add (sock[0], &err), "add failed");
+	while (!pgm_atomic_read32 (&mock_send_is_waiting))
+		g_usleep (1000);
+	fail_unless (TRUE == pgm_spm_scheduler_add (sock[1], &err), "add failed");
+	pgm_spm_scheduler_request (sock[1]);
+	pgm_spm_scheduler_kick (mock_pgm_time_now);
+	pgm_spm_scheduler_remove (sock[1]);
+	fail_unless (sock[0] == spm_scheduler->dispatching, "dispatching failed");
+	pgm_atomic_write32 (&mock_send_is_blocked, 0);
+	pgm_spm_scheduler_remove (sock[0]);
+	fail_unless (NULL == spm_scheduler, "scheduler not stopped");
+	fail_unless (1 == pgm_atomic_read32 (&mock_spms_sent), "spms sent %u", (unsigned)mock_spms_sent);
+	pgm_spm_scheduler_shutdown ();
+}
+END_TEST
+
+START_TEST (test_add_fail_001)
+{
+	pgm_spm_scheduler_init ();
+	const bool status = pgm_spm_scheduler_add (NULL, NULL);
+	fail ("reached");
+}
+END_TEST
+
+START_TEST (test_remove_fail_001)
+{
+	pgm_spm_scheduler_init ();
+	pgm_spm_scheduler_remove (NULL);
+	fail ("reached");
+}
+END_TEST
+
+/* target:
+ *	void
+ *	pgm_spm_scheduler_request (
+ *		pgm_sock_t*		sock
+ *	)
+ */
+
+START_TEST (test_request_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	pgm_spm_scheduler_init ();
+	pgm_spm_scheduler_request (sock);
+	fail_unless (1 == sock->is_pending_spm, "request failed");
+	pgm_spm_scheduler_shutdown ();
+}
+END_TEST
+
+START_TEST (test_request_fail_001)
+{
+	pgm_spm_scheduler_request (NULL);
+	fail ("reached");
+}
+END_TEST
+
+
+static
+Suite*
+make_test_suite (void)
+{
+	Suite* s;
+
+	s = suite_create (__FILE__);
+
+	TCase* tc_dispatch = tcase_create ("dispatch");
+	suite_add_tcase (s, tc_dispatch);
+	tcase_add_checked_fixture (tc_dispatch, mock_setup, NULL);
+	tcase_add_test (tc_dispatch, test_dispatch_pass_001);
+	tcase_add_test (tc_dispatch, test_dispatch_pass_002);
+	tcase_add_test (tc_dispatch, test_dispatch_pass_003);
+	tcase_add_test (tc_dispatch, test_dispatch_pass_004);
+	tcase_add_test (tc_dispatch, test_dispatch_pass_005);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_dispatch, test_dispatch_fail_001, SIGABRT);
+#endif
+
+	TCase* tc_add = tcase_create ("add");
+	suite_add_tcase (s, tc_add);
+	tcase_add_checked_fixture (tc_add, mock_setup, NULL);
+	tcase_add_test (tc_add, test_add_pass_001);
+	tcase_add_test (tc_add, test_add_pass_002);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_add, test_add_fail_001, SIGABRT);
+	tcase_add_test_raise_signal (tc_add, test_remove_fail_001, SIGABRT);
+#endif
+
+	TCase* tc_request = tcase_create ("request");
+	suite_add_tcase (s, tc_request);
+	tcase_add_checked_fixture (tc_request, mock_setup, NULL);
+	tcase_add_test (tc_request, test_request_pass_001);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_request, test_request_fail_001, SIGABRT);
+#endif
+	return s;
+}
+
+static
+Suite*
+make_master_suite (void)
+{
+	Suite* s = suite_create ("Master");
+	return s;
+}
+
+int
+main (void)
+{
+	pgm_messages_init();
+	SRunner* sr = srunner_create (make_master_suite ());
+	srunner_add_suite (sr, make_test_suite ());
+	srunner_run_all (sr, CK_ENV);
+	int number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	pgm_messages_shutdown();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* eof */
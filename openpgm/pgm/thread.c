@@ -437,6 +437,129 @@ pgm_rwlock_free (
 #endif
 }
 
+/* per-thread slot pools: each thread binds to one slot of a pool and on exit
+ * the slot is marked for reuse by the next thread to acquire.  slots are only
+ * freed with the pool.  Windows XP lacks fiber local storage callbacks so
+ * slots of exited threads are not reused there.
+ */
+
+#if !defined( _WIN32 ) || ( _WIN32_WINNT >= 0x600 )
+static
+void
+#	ifdef _WIN32
+WINAPI
+#	endif
+_pgm_tls_pool_release (
+	void*		data
+	)
+{
+	pgm_tls_slot_t* slot = data;
+	pgm_mutex_lock (&slot->pool->mutex);
+	slot->is_active = FALSE;
+	pgm_mutex_unlock (&slot->pool->mutex);
+}
+#endif
+
+PGM_GNUC_INTERNAL
+void
+pgm_tls_pool_init (
+	pgm_tls_pool_t*	pool
+	)
+{
+	pgm_assert (NULL != pool);
+
+	pgm_mutex_init (&pool->mutex);
+	pool->slots = NULL;
+	pool->count = 0;
+#ifndef _WIN32
+	posix_check_cmd (pthread_key_create (&pool->key, _pgm_tls_pool_release));
+#elif ( _WIN32_WINNT >= 0x600 )
+	pool->key = FlsAlloc (_pgm_tls_pool_release);
+	win32_check_cmd (FLS_OUT_OF_INDEXES != pool->key);
+#endif
+/* the generation survives re-initialisation to invalidate stale references */
+	pgm_atomic_inc32 (&pool->generation);
+}
+
+PGM_GNUC_INTERNAL
+void
+pgm_tls_pool_free (
+	pgm_tls_pool_t*	pool
+	)
+{
+	pgm_assert (NULL != pool);
+
+/* invalidate thread references before the slots go */
+	pgm_atomic_inc32 (&pool->generation);
+#ifndef _WIN32
+	posix_check_cmd (pthread_key_delete (pool->key));
+#elif ( _WIN32_WINNT >= 0x600 )
+/* runs the release callback for every thread still holding a slot */
+	win32_check_cmd (FlsFree (pool->key));
+#endif
+	while (pool->slots) {
+		pgm_tls_slot_t* slot = pool->slots->data;
+		pool->slots = pgm_slist_remove_first (pool->slots);
+		pgm_free (slot);
+	}
+	pool->count = 0;
+	pgm_mutex_free (&pool->mutex);
+}
+
+/* bind the calling thread to a free slot of the given size or a new zeroed
+ * one, any previous slot of the thread is released.  the size includes the
+ * pgm_tls_slot_t header that must lead the caller's structure.
+ */
+
+PGM_GNUC_INTERNAL
+void*
+pgm_tls_pool_acquire (
+	pgm_tls_pool_t*	pool,
+	const size_t	size
+	)
+{
+	pgm_tls_slot_t* slot = NULL;
+
+	pgm_assert (NULL != pool);
+	pgm_assert (size >= sizeof (pgm_tls_slot_t));
+
+#ifndef _WIN32
+	pgm_tls_slot_t* previous = pthread_getspecific (pool->key);
+#elif ( _WIN32_WINNT >= 0x600 )
+	pgm_tls_slot_t* previous = FlsGetValue (pool->key);
+#else
+	pgm_tls_slot_t* previous = NULL;
+#endif
+	pgm_mutex_lock (&pool->mutex);
+	if (NULL != previous)
+		previous->is_active = FALSE;
+	for (pgm_slist_t* list = pool->slots; list; list = list->next) {
+		pgm_tls_slot_t* candidate = list->data;
+		if (!candidate->is_active && candidate->size == size) {
+			slot = candidate;
+			break;
+		}
+	}
+	if (NULL == slot) {
+		slot = pgm_malloc0 (size);
+		slot->pool = pool;
+		slot->size = size;
+		slot->id = pool->count++;
+		slot->link.data = slot;
+		slot->link.next = pool->slots;
+		pool->slots = &slot->link;
+	}
+	slot->is_active = TRUE;
+	pgm_mutex_unlock (&pool->mutex);
+
+#ifndef _WIN32
+	pthread_setspecific (pool->key, slot);
+#elif ( _WIN32_WINNT >= 0x600 )
+	FlsSetValue (pool->key, slot);
+#endif
+	return slot;
+}
+
 #if defined( _WIN32 ) && !( _WIN32_WINNT >= 0x600 ) && !defined( USE_DUMB_RWSPINLOCK )
 /* read-write lock implementation for Windows XP */
 static inline
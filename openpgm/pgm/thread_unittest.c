@@ -427,6 +427,87 @@ START_TEST (test_rwlock_writer_trylock_pass_001)
 }
 END_TEST
 
+/* target:
+ *	void*
+ *	pgm_tls_pool_acquire (pgm_tls_pool_t* pool, const size_t size)
+ */
+
+START_TEST (test_tls_pool_acquire_pass_001)
+{
+	pgm_tls_pool_t pool;
+	memset (&pool, 0, sizeof (pool));
+	pgm_tls_pool_init (&pool);
+	pgm_tls_slot_t* slot = pgm_tls_pool_acquire (&pool, 64);
+	fail_if (NULL == slot, "acquire failed");
+	fail_unless (TRUE == slot->is_active, "not active");
+	fail_unless (64 == slot->size, "size mismatch");
+	fail_unless (0 == slot->id, "id mismatch");
+/* rebinding to another size releases the previous slot */
+	pgm_tls_slot_t* other = pgm_tls_pool_acquire (&pool, 128);
+	fail_if (slot == other, "slot of wrong size reused");
+	fail_unless (FALSE == slot->is_active, "previous slot not released");
+	fail_unless (1 == other->id, "id mismatch");
+	fail_unless (slot == pgm_tls_pool_acquire (&pool, 64), "free slot not reused");
+	fail_unless (2 == pool.count, "count mismatch");
+	pgm_tls_pool_free (&pool);
+}
+END_TEST
+
+#ifndef _WIN32
+static
+void*
+tls_pool_routine (
+	void*		arg
+	)
+{
+	return pgm_tls_pool_acquire ((pgm_tls_pool_t*)arg, 64);
+}
+
+/* slot of an exited thread */
+START_TEST (test_tls_pool_acquire_pass_002)
+{
+	pgm_tls_pool_t pool;
+	pthread_t thread;
+	void* retval;
+	memset (&pool, 0, sizeof (pool));
+	pgm_tls_pool_init (&pool);
+	pgm_tls_slot_t* slot = pgm_tls_pool_acquire (&pool, 64);
+	fail_unless (0 == pthread_create (&thread, NULL, tls_pool_routine, &pool), "pthread_create failed");
+	fail_unless (0 == pthread_join (thread, &retval), "pthread_join failed");
+	pgm_tls_slot_t* exited = retval;
+	fail_if (slot == exited, "active slot shared");
+	fail_unless (FALSE == exited->is_active, "slot not released on thread exit");
+	fail_unless (exited == pgm_tls_pool_acquire (&pool, 64), "released slot not reused");
+	pgm_tls_pool_free (&pool);
+}
+END_TEST
+#endif /* !_WIN32 */
+
+START_TEST (test_tls_pool_acquire_fail_001)
+{
+	pgm_tls_pool_acquire (NULL, 64);
+	fail ("reached");
+}
+END_TEST
+
+/* target:
+ *	void
+ *	pgm_tls_pool_free (pgm_tls_pool_t* pool)
+ */
+
+START_TEST (test_tls_pool_free_pass_001)
+{
+	pgm_tls_pool_t pool;
+	memset (&pool, 0, sizeof (pool));
+	pgm_tls_pool_init (&pool);
+	const uint32_t generation = pgm_tls_pool_generation (&pool);
+	pgm_tls_pool_acquire (&pool, 64);
+	pgm_tls_pool_free (&pool);
+	fail_unless (NULL == pool.slots, "slots remain");
+	fail_if (generation == pgm_tls_pool_generation (&pool), "references not invalidated");
+}
+END_TEST
+
 static
 Suite*
 make_test_suite (void)
@@ -569,6 +650,33 @@ make_rwlock_suite (void)
 	return s;
 }
 
+static
+Suite*
+make_tls_pool_suite (void)
+{
+	Suite* s;
+
+	s = suite_create ("tls pool");
+
+	TCase* tc_acquire = tcase_create ("acquire");
+	tcase_add_checked_fixture (tc_acquire, mock_setup, mock_teardown);
+	suite_add_tcase (s, tc_acquire);
+	tcase_add_test (tc_acquire, test_tls_pool_acquire_pass_001);
+#ifndef _WIN32
+	tcase_add_test (tc_acquire, test_tls_pool_acquire_pass_002);
+#endif
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_acquire, test_tls_pool_acquire_fail_001, SIGABRT);
+#endif
+
+	TCase* tc_free = tcase_create ("free");
+	tcase_add_checked_fixture (tc_free, mock_setup, mock_teardown);
+	suite_add_tcase (s, tc_free);
+	tcase_add_test (tc_free, test_tls_pool_free_pass_001);
+
+	return s;
+}
+
 static
 Suite*
 make_master_suite (void)
@@ -586,6 +694,7 @@ main (void)
 	srunner_add_suite (sr, make_mutex_suite ());
 	srunner_add_suite (sr, make_spinlock_suite ());
 	srunner_add_suite (sr, make_rwlock_suite ());
+	srunner_add_suite (sr, make_tls_pool_suite ());
 	srunner_run_all (sr, CK_ENV);
 	int number_failed = srunner_ntests_failed (sr);
 	srunner_free (sr);
@@ -167,14 +167,14 @@ static pgm_time_t		pgm_rtc_update (void);
 #		include <sys/sysctl.h>
 #	elif defined(__sun)
 #		include <kstat.h>
-#	elif defined(_MSC_VER)
-#		include <intrin.h>
 #	endif
 #	define TSC_NS_SCALE	10 /* 2^10, carefully chosen */
-#	define TSC_US_SCALE	20
+#	define TSC_US_SCALE	32 /* 2^32, split multiply below */
 static uint_fast32_t		tsc_khz PGM_GNUC_READ_MOSTLY = 0;
 static uint_fast32_t		tsc_ns_mul PGM_GNUC_READ_MOSTLY = 0;
-static uint_fast32_t		tsc_us_mul PGM_GNUC_READ_MOSTLY = 0;
+static uint64_t			tsc_us_mul PGM_GNUC_READ_MOSTLY = 0;
+static bool			tsc_is_cached = FALSE;
+uint64_t			pgm_tsc_us_mul PGM_GNUC_READ_MOSTLY = 0;
 
 static inline
 void
@@ -183,7 +183,7 @@ set_tsc_mul (
 	)
 {
 	tsc_ns_mul = (1000000 << TSC_NS_SCALE) / khz;
-	tsc_us_mul = (1000 << TSC_US_SCALE) / khz;
+	tsc_us_mul = ((uint64_t)1000 << TSC_US_SCALE) / khz;
 }
 
 static inline
@@ -210,7 +210,7 @@ tsc_to_us (
 	const uint64_t		tsc
 	)
 {
-	return (tsc * tsc_us_mul) >> TSC_US_SCALE;
+	return (tsc >> TSC_US_SCALE) * tsc_us_mul + (((tsc & UINT32_MAX) * tsc_us_mul) >> TSC_US_SCALE);
 }
 
 static inline
@@ -219,11 +219,25 @@ us_to_tsc (
 	const uint64_t		us
 	)
 {
-	return (us << TSC_US_SCALE) / tsc_us_mul;
+	return (us * tsc_khz) / 1000;
 }
 
 #	ifndef _WIN32
-static bool			pgm_tsc_init (pgm_error_t**);
+static bool			pgm_tsc_init (const pgm_cpu_t*, pgm_error_t**);
+#	endif
+#	if defined(HAVE_CLOCK_GETTIME) && !defined(_WIN32)
+#		include <sys/stat.h>
+#		include <unistd.h>
+/* tmpfs so that a reboot, possibly into different firmware settings, clears it */
+#		ifdef __linux__
+#			define TSC_CACHE_PATH	"/dev/shm/openpgm-tsc"
+#		else
+#			define TSC_CACHE_PATH	"/tmp/openpgm-tsc"
+#		endif
+#		define TSC_CACHE_VERSION	1
+static uint_fast32_t		pgm_tsc_calibrate (void);
+static uint_fast32_t		pgm_tsc_cache_read (const pgm_cpu_t*);
+static void			pgm_tsc_cache_write (const pgm_cpu_t*, uint_fast32_t);
 #	endif
 static pgm_time_t		pgm_tsc_update (void);
 #endif
@@ -371,6 +385,10 @@ pgm_time_init (
 	if (pgm_time_update_now == pgm_tsc_update)
 	{
 		char	*rdtsc_frequency;
+		pgm_cpu_t cpu;
+
+		pgm_cpuid (&cpu);
+		tsc_is_cached = FALSE;
 
 #ifdef HAVE_PROC_CPUINFO
 /* attempt to parse clock ticks from kernel
@@ -473,6 +491,30 @@ pgm_time_init (
 		}
 #endif /* !_WIN32 */
 
+/* an invariant TSC ticks at a fixed rate unrelated to the current core
+ * frequency reported above, take the rate enumerated by the processor or
+ * measure it against the monotonic clock.
+ */
+		if (cpu.has_invariant_tsc)
+		{
+			if (cpu.tsc_frequency > 0) {
+				tsc_khz = (uint_fast32_t)(cpu.tsc_frequency / 1000);
+				pgm_minor (_("CPUID reports TSC frequency %" PRIu64 " Hz"), cpu.tsc_frequency);
+			}
+#if defined(HAVE_CLOCK_GETTIME) && !defined(_WIN32)
+			else {
+				uint_fast32_t khz = pgm_tsc_cache_read (&cpu);
+				if (khz > 0) {
+					tsc_is_cached = TRUE;
+				} else if ((khz = pgm_tsc_calibrate ()) > 0) {
+					pgm_tsc_cache_write (&cpu, khz);
+				}
+				if (khz > 0)
+					tsc_khz = khz;
+			}
+#endif
+		}
+
 /* e.g. export RDTSC_FREQUENCY=3200.000000
  *
  * Value can be used to override kernel tick rate as well as internal calibration
@@ -487,7 +529,7 @@ pgm_time_init (
 /* calibrate */
 		if (0 >= tsc_khz) {
 			pgm_error_t* sub_error = NULL;
-			if (!pgm_tsc_init (&sub_error)) {
+			if (!pgm_tsc_init (&cpu, &sub_error)) {
 				pgm_propagate_error (error, sub_error);
 				goto err_cleanup;
 			}
@@ -495,6 +537,14 @@ pgm_time_init (
 #endif
 		pgm_minor (_("TSC frequency set at %u KHz"), (unsigned)(tsc_khz));
 		set_tsc_mul (tsc_khz);
+
+/* consistent across cores and power states, safe to read without the
+ * monotonic guard of pgm_tsc_update().
+ */
+		if (cpu.has_invariant_tsc && pgm_time_update_now == pgm_tsc_update) {
+			pgm_minor (_("Reading invariant TSC directly."));
+			pgm_tsc_us_mul = tsc_us_mul;
+		}
 	}
 #endif /* HAVE_RDTSC */
 
@@ -584,6 +634,9 @@ pgm_time_shutdown (void)
 	if (pgm_time_update_now == pgm_rtc_update)
 		retval = pgm_rtc_shutdown ();
 #endif
+#ifdef HAVE_RDTSC
+	pgm_tsc_us_mul = 0;
+#endif
 #ifdef HAVE_DEV_HPET
 	if (pgm_time_update_now == pgm_hpet_update)
 		retval = pgm_hpet_shutdown ();
@@ -591,6 +644,78 @@ pgm_time_shutdown (void)
 	return retval;
 }
 
+/* describe the active clock source.
+ *
+ * returns TRUE on success, returns FALSE if the time system is not initialized.
+ */
+
+bool
+pgm_time_get_info (
+	pgm_time_info_t* const	info
+	)
+{
+	pgm_return_val_if_fail (NULL != info, FALSE);
+	pgm_return_val_if_fail (pgm_atomic_read32 (&time_ref_count) > 0, FALSE);
+
+	memset (info, 0, sizeof (pgm_time_info_t));
+#ifdef HAVE_FTIME
+	if (pgm_time_update_now == pgm_ftime_update) {
+		info->source	= "ftime";
+		info->precision	= (uint32_t)msecs_to_nsecs (1);
+	}
+#endif
+#ifdef HAVE_CLOCK_GETTIME
+	if (pgm_time_update_now == pgm_clock_update) {
+		struct timespec res;
+		info->source	= "clock_gettime";
+		info->precision	= (0 == clock_getres (CLOCK_MONOTONIC, &res)) ?
+					(uint32_t)(secs_to_nsecs (res.tv_sec) + res.tv_nsec) :
+					(uint32_t)usecs_to_nsecs (1);
+	}
+#endif
+#ifdef HAVE_DEV_RTC
+	if (pgm_time_update_now == pgm_rtc_update) {
+		info->source	= "RTC";
+		info->frequency	= rtc_frequency;
+		info->precision	= (uint32_t)(secs_to_nsecs (1) / rtc_frequency);
+	}
+#endif
+#ifdef HAVE_RDTSC
+	if (pgm_time_update_now == pgm_tsc_update) {
+		info->source	= "TSC";
+		info->frequency	= (uint64_t)tsc_khz * 1000;
+		info->precision	= MAX(1, (uint32_t)(msecs_to_nsecs (1) / tsc_khz));
+		info->is_invariant = (0 != pgm_tsc_us_mul);
+		info->is_cached	= tsc_is_cached;
+	}
+#endif
+#ifdef HAVE_DEV_HPET
+	if (pgm_time_update_now == pgm_hpet_update) {
+		info->source	= "HPET";
+		info->precision	= MAX(1, (uint32_t)hpet_to_ns (1));
+		info->frequency	= secs_to_nsecs (1) / info->precision;
+	}
+#endif
+#ifdef HAVE_GETTIMEOFDAY
+	if (pgm_time_update_now == pgm_gettimeofday_update) {
+		info->source	= "gettimeofday";
+		info->precision	= (uint32_t)usecs_to_nsecs (1);
+	}
+#endif
+#ifdef _WIN32
+	if (pgm_time_update_now == pgm_mmtime_update) {
+		info->source	= "MMTIME";
+		info->precision	= (uint32_t)msecs_to_nsecs (MAX(1, wTimerRes));
+	}
+	if (pgm_time_update_now == pgm_queryperformancecounter_update) {
+		info->source	= "QueryPerformanceCounter";
+		info->frequency	= (uint64_t)tsc_khz * 1000;
+		info->precision	= MAX(1, (uint32_t)(msecs_to_nsecs (1) / tsc_khz));
+	}
+#endif
+	return TRUE;
+}
+
 #ifdef HAVE_GETTIMEOFDAY
 static
 pgm_time_t
@@ -773,32 +898,13 @@ pgm_queryperformancecounter_update (void)
 #endif /* _WIN32 */
 
 #ifdef HAVE_RDTSC
-/* read time stamp counter (TSC), count of ticks from processor reset.
- *
- * Microsoft notes on TSC drift:
+/* Microsoft notes on TSC drift:
  * http://support.microsoft.com/kb/931279
  * http://support.microsoft.com/kb/938448
+ *
+ * pgm_rdtsc() is inlined from <impl/time.h>.
  */
 
-static inline
-pgm_time_t
-pgm_rdtsc (void)
-{
-#	ifndef _MSC_VER
-
-	uint32_t lo, hi;
-
-/* We cannot use "=A", since this would use %rax on x86_64 */
-	__asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
-	return (pgm_time_t)hi << 32 | lo;
-
-#	else
-
-	return (pgm_time_t)__rdtsc ();
-
-#	endif
-}
-
 #	ifndef _WIN32
 /* determine ratio of ticks to nano-seconds, use /dev/rtc for high accuracy
  * millisecond timer and convert.
@@ -809,7 +915,8 @@ pgm_rdtsc (void)
 static
 bool
 pgm_tsc_init (
-	PGM_GNUC_UNUSED pgm_error_t**	error
+	PGM_GNUC_UNUSED const pgm_cpu_t*	cpu,
+	PGM_GNUC_UNUSED pgm_error_t**		error
 	)
 {
 #		ifdef HAVE_PROC_CPUINFO
@@ -851,6 +958,16 @@ pgm_tsc_init (
 
 #		endif /* HAVE_PROC_CPUINFO */
 
+#		ifdef HAVE_CLOCK_GETTIME
+/* a counter that passed the checks above on this processor model before */
+	const uint_fast32_t cached_khz = pgm_tsc_cache_read (cpu);
+	if (cached_khz > 0) {
+		tsc_khz = cached_khz;
+		tsc_is_cached = TRUE;
+		return TRUE;
+	}
+#		endif
+
 	pgm_time_t		start, stop, elapsed;
 	const pgm_time_t	calibration_usec = secs_to_usecs (4);
 	struct timespec		req = {
@@ -880,6 +997,9 @@ pgm_tsc_init (
 	if (elapsed > calibration_usec) {
 /* cpu > 1 Ghz */
 		tsc_khz = (elapsed * 1000) / calibration_usec;
+#		ifdef HAVE_CLOCK_GETTIME
+		pgm_tsc_cache_write (cpu, tsc_khz);
+#		endif
 	} else {
 /* cpu < 1 Ghz */
 		tsc_khz = -( (calibration_usec * 1000) / elapsed );
@@ -894,6 +1014,166 @@ pgm_tsc_init (
 }
 #	endif
 
+#	if defined(HAVE_CLOCK_GETTIME) && !defined(_WIN32)
+/* measure an invariant TSC against CLOCK_MONOTONIC over 20ms.  each end point
+ * is the tightest of several counter reads bracketing the clock read so that
+ * an interrupt between the two does not skew the result.
+ *
+ * returns frequency in KHz, or 0 on failure.
+ */
+
+static
+uint_fast32_t
+pgm_tsc_calibrate (void)
+{
+	uint64_t		tsc[2], nsecs[2];
+	struct timespec		req = {
+					.tv_sec  = 0,
+					.tv_nsec = 20 * 1000 * 1000
+				};
+
+	for (unsigned i = 0; i < 2; i++)
+	{
+		uint64_t best = UINT64_MAX;
+
+		if (1 == i)
+			while (-1 == nanosleep (&req, &req) && EINTR == errno);
+
+		for (unsigned j = 0; j < 5; j++)
+		{
+			struct timespec clock_now;
+			const uint64_t start = pgm_rdtsc();
+			if (0 != clock_gettime (CLOCK_MONOTONIC, &clock_now))
+				return 0;
+			const uint64_t stop = pgm_rdtsc();
+			if (stop - start < best) {
+				best     = stop - start;
+				tsc[i]   = start + (best / 2);
+				nsecs[i] = (uint64_t)clock_now.tv_sec * 1000000000 + clock_now.tv_nsec;
+			}
+		}
+	}
+
+	if (tsc[1] <= tsc[0] || nsecs[1] <= nsecs[0])
+		return 0;
+
+	const uint_fast32_t khz = (uint_fast32_t)(((tsc[1] - tsc[0]) * 1000000) / (nsecs[1] - nsecs[0]));
+	pgm_minor (_("Calibrated TSC frequency %" PRIuFAST32 " KHz"), khz);
+	return khz;
+}
+#	endif
+
+#	if defined(HAVE_CLOCK_GETTIME) && !defined(_WIN32)
+/* calibration cache, one line shared by every process on the host:
+ *
+ *	<version> <cpuid signature> <invariant> <KHz> <brand string>
+ *
+ * PGM_TSC_CACHE overrides the location.
+ */
+
+static
+void
+pgm_tsc_cache_path (
+	char*		path,
+	size_t		len
+	)
+{
+	char*	env;
+	size_t	envlen;
+
+	if (0 == pgm_dupenv_s (&env, &envlen, "PGM_TSC_CACHE") && envlen > 0) {
+		pgm_strncpy_s (path, len, env, _TRUNCATE);
+		pgm_free (env);
+	} else {
+		pgm_strncpy_s (path, len, TSC_CACHE_PATH, _TRUNCATE);
+	}
+}
+
+/* returns the cached frequency in KHz if the entry was written by this
+ * processor model by ourselves or root, returns 0 otherwise.
+ */
+
+static
+uint_fast32_t
+pgm_tsc_cache_read (
+	const pgm_cpu_t*	cpu
+	)
+{
+	char		path[1024], brand[49];
+	FILE*		fp;
+	struct stat	st;
+	unsigned	version, signature, is_invariant;
+	unsigned long	khz;
+	int		count;
+
+	pgm_tsc_cache_path (path, sizeof (path));
+	if (NULL == (fp = fopen (path, "r")))
+		return 0;
+	if (0 != fstat (fileno (fp), &st) ||
+	    (st.st_uid != geteuid() && 0 != st.st_uid))
+	{
+		pgm_warn (_("Ignoring TSC calibration cache %s not owned by current user or root."), path);
+		fclose (fp);
+		return 0;
+	}
+	brand[0] = '\0';
+	count = fscanf (fp, "%u %x %u %lu %48[^\n]", &version, &signature, &is_invariant, &khz, brand);
+	fclose (fp);
+	if (count < 4 ||
+	    TSC_CACHE_VERSION != version ||
+	    cpu->signature != signature ||
+	    (unsigned)cpu->has_invariant_tsc != is_invariant ||
+	    0 != strcmp (cpu->brand, brand) ||
+	    0 == khz || khz > UINT32_MAX)
+	{
+		pgm_minor (_("TSC calibration cache %s does not match this processor."), path);
+		return 0;
+	}
+	pgm_minor (_("TSC frequency %lu KHz from calibration cache %s"), khz, path);
+	return (uint_fast32_t)khz;
+}
+
+/* replace the cache entry atomically, failure only costs the next process a
+ * calibration.
+ */
+
+static
+void
+pgm_tsc_cache_write (
+	const pgm_cpu_t*	cpu,
+	const uint_fast32_t	khz
+	)
+{
+	char	path[1024], tmp_path[1024 + 8];
+	FILE*	fp;
+	int	fd;
+
+	pgm_tsc_cache_path (path, sizeof (path));
+	pgm_snprintf_s (tmp_path, sizeof (tmp_path), _TRUNCATE, "%s.XXXXXX", path);
+	if (-1 == (fd = mkstemp (tmp_path))) {
+		pgm_debug ("Cannot create TSC calibration cache %s", tmp_path);
+		return;
+	}
+	fchmod (fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (NULL == (fp = fdopen (fd, "w"))) {
+		close (fd);
+		unlink (tmp_path);
+		return;
+	}
+	fprintf (fp, "%u %08x %u %lu %s\n",
+		 TSC_CACHE_VERSION,
+		 (unsigned)cpu->signature,
+		 (unsigned)cpu->has_invariant_tsc,
+		 (unsigned long)khz,
+		 cpu->brand);
+	if (0 != fclose (fp) || 0 != rename (tmp_path, path)) {
+		unlink (tmp_path);
+		return;
+	}
+	pgm_minor (_("Saved TSC calibration to %s"), path);
+}
+#	endif
+
 /* TSC is monotonic on the same core but we do neither force the same core or save the count
  * for each core as if the counter is unstable system wide another timing mechanism should be
  * used, preferably HPET on x86/AMD64 or gettimeofday() on SPARC.
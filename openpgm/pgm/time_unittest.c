@@ -151,6 +151,36 @@ START_TEST (test_since_epoch_pass_001)
 }
 END_TEST
 
+/* target:
+ *	bool
+ *	pgm_time_get_info (
+ *		pgm_time_info_t*	info
+ *		)
+ */
+
+START_TEST (test_get_info_pass_001)
+{
+	pgm_time_info_t info;
+	fail_unless (TRUE == pgm_time_init (NULL), "init failed");
+	fail_unless (TRUE == pgm_time_get_info (&info), "get_info failed");
+	fail_if (NULL == info.source, "no source");
+	fail_unless (info.precision > 0, "zero precision");
+	g_message ("source:%s frequency:%" G_GUINT64_FORMAT "Hz precision:%uns invariant:%s cached:%s",
+		   info.source, info.frequency, info.precision,
+		   info.is_invariant ? "TRUE" : "FALSE",
+		   info.is_cached ? "TRUE" : "FALSE");
+	fail_unless (TRUE == pgm_time_shutdown (), "shutdown failed");
+}
+END_TEST
+
+START_TEST (test_get_info_fail_001)
+{
+	fail_unless (TRUE == pgm_time_init (NULL), "init failed");
+	fail_unless (FALSE == pgm_time_get_info (NULL), "get_info failed");
+	fail_unless (TRUE == pgm_time_shutdown (), "shutdown failed");
+}
+END_TEST
+
 
 static
 Suite*
@@ -176,6 +206,11 @@ make_test_suite (void)
 	TCase* tc_since_epoch = tcase_create ("since-epoch");
 	suite_add_tcase (s, tc_since_epoch);
 	tcase_add_test (tc_since_epoch, test_since_epoch_pass_001);
+
+	TCase* tc_get_info = tcase_create ("get-info");
+	suite_add_tcase (s, tc_get_info);
+	tcase_add_test (tc_get_info, test_get_info_pass_001);
+	tcase_add_test (tc_get_info, test_get_info_fail_001);
 	return s;
 }
 
@@ -22,6 +22,10 @@
 #ifdef HAVE_CONFIG_H
 #	include <config.h>
 #endif
+#ifdef HAVE_TIMERFD
+#	include <sys/timerfd.h>
+#	include <unistd.h>
+#endif
 #include <impl/i18n.h>
 #include <impl/framework.h>
 #include <impl/timer.h>
@@ -51,7 +55,7 @@ pgm_timer_prepare (
 	pgm_assert (NULL != sock);
 	pgm_assert (sock->can_send_data || sock->can_recv_data);
 
-	now = pgm_time_update_now();
+	now = pgm_time_sample();
 
 	if (sock->can_send_data)
 		expiration = sock->next_ambient_spm;
@@ -72,13 +76,16 @@ pgm_timer_prepare (
 	return (msec == 0);
 }
 
+/* now is sampled once by the caller and shared with pgm_timer_dispatch().
+ */
+
 PGM_GNUC_INTERNAL
 bool
 pgm_timer_check (
-	pgm_sock_t* const	sock
+	pgm_sock_t* const	sock,
+	const pgm_time_t	now
 	)
 {
-	const pgm_time_t now = pgm_time_update_now();
 	bool expired;
 
 /* pre-conditions */
@@ -96,10 +103,10 @@ pgm_timer_check (
 PGM_GNUC_INTERNAL
 pgm_time_t
 pgm_timer_expiration (
-	pgm_sock_t* const	sock
+	pgm_sock_t* const	sock,
+	const pgm_time_t	now
 	)
 {
-	const pgm_time_t now = pgm_time_update_now();
 	pgm_time_t expiration;
 
 /* pre-conditions */
@@ -111,8 +118,61 @@ pgm_timer_expiration (
 	return expiration;
 }
 
-/* call all timers, assume that time_now has been updated by either pgm_timer_prepare
- * or pgm_timer_check and no other method calls here.
+/* arm the application timer descriptor to the next expiration, the kernel
+ * counts the interval so the deadline holds however late the event loop
+ * returns.  the timer is only set when next_poll moved, which also clears an
+ * expiration already signalled.  with the deadline unchanged the descriptor
+ * can only be readable when it fired ahead of the library clock, drain it
+ * then and arm again for the remainder.
+ */
+
+/* tolerated drift between the library clock and CLOCK_MONOTONIC */
+#define PGM_TIMER_FD_SKEW	pgm_msecs(1)
+
+PGM_GNUC_INTERNAL
+void
+pgm_timer_arm (
+	pgm_sock_t* const	sock
+	)
+{
+/* pre-conditions */
+	pgm_assert (NULL != sock);
+	pgm_assert (sock->use_timerfd);
+
+#ifdef HAVE_TIMERFD
+	pgm_timer_lock (sock);
+	const pgm_time_t next_poll = sock->next_poll;
+	const pgm_time_t now = pgm_time_sample();
+	if (next_poll == sock->timer_fd_expiry) {
+		uint64_t expirations;
+/* cannot have fired yet, or due and left signalled for the application */
+		if (pgm_time_after (next_poll, now + PGM_TIMER_FD_SKEW) ||
+		    !pgm_time_after (next_poll, now) ||
+		    (ssize_t)sizeof (expirations) != read (sock->timer_fd, &expirations, sizeof (expirations)))
+		{
+			pgm_timer_unlock (sock);
+			return;
+		}
+	}
+	const pgm_time_t usecs = pgm_time_after (next_poll, now) ? pgm_to_usecs (next_poll - now) : 0;
+/* a zero it_value disarms the timer, expire immediately instead */
+	struct itimerspec its = {
+		.it_interval	= { 0, 0 },
+		.it_value	= { .tv_sec = (time_t)(usecs / 1000000UL), .tv_nsec = usecs ? (long)(usecs % 1000000UL) * 1000L : 1L }
+	};
+	if (PGM_UNLIKELY(-1 == timerfd_settime (sock->timer_fd, 0, &its, NULL))) {
+		char errbuf[1024];
+		pgm_warn (_("Arming timer descriptor failed: %s"),
+			  pgm_strerror_s (errbuf, sizeof (errbuf), errno));
+		sock->timer_fd_expiry = 0;
+	} else
+		sock->timer_fd_expiry = next_poll;
+	pgm_timer_unlock (sock);
+#endif /* HAVE_TIMERFD */
+}
+
+/* call all timers, now is the time passed to pgm_timer_check and no other method
+ * samples the clock here.
  * 
  * returns TRUE on success, returns FALSE on blocked send-in-receive operation.
  */
@@ -120,10 +180,10 @@ pgm_timer_expiration (
 PGM_GNUC_INTERNAL
 bool
 pgm_timer_dispatch (
-	pgm_sock_t* const	sock
+	pgm_sock_t* const	sock,
+	const pgm_time_t	now
 	)
 {
-	const pgm_time_t now = pgm_time_update_now();
 	pgm_time_t next_expiration = 0;
 
 /* pre-conditions */
@@ -155,7 +215,8 @@ struct tm* tmp = localtime (&t);
 strftime (nows, sizeof(nows), "%Y-%m-%d %H:%M:%S", tmp);
 printf ("ACK timeout, T:%u W:%u\n", pgm_fp8tou(sock->tokens), pgm_fp8tou(sock->cwnd_size));
 #endif
-				sock->tokens = sock->cwnd_size = pgm_fp8 (1);
+				sock->cc_ops->on_timeout (sock);
+				sock->tokens = sock->cwnd_size;
 				sock->ack_bitmap = 0xffffffff;
 				sock->ack_expiry = 0;
 
@@ -165,6 +226,17 @@ printf ("ACK timeout, T:%u W:%u\n", pgm_fp8tou(sock->tokens), pgm_fp8tou(sock->c
 			next_expiration = next_expiration > 0 ? MIN(next_expiration, sock->ack_expiry) : sock->ack_expiry;
 		}
 
+/* SPMs belong to the process-wide scheduler, poll only for the rest */
+		if (sock->use_spm_scheduler)
+		{
+			if (0 == next_expiration)
+				next_expiration = now + sock->spm_ambient_interval;
+			pgm_mutex_lock (&sock->timer_mutex);
+			sock->next_poll = sock->next_poll > now ? MIN(sock->next_poll, next_expiration) : next_expiration;
+			pgm_mutex_unlock (&sock->timer_mutex);
+			return TRUE;
+		}
+
 /* SPM broadcast */
 		pgm_mutex_lock (&sock->timer_mutex);
 		const unsigned spm_heartbeat_state = sock->spm_heartbeat_state;
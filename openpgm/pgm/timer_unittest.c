@@ -23,6 +23,9 @@
 #include <signal.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#ifdef HAVE_TIMERFD
+#	include <poll.h>
+#endif
 #include <glib.h>
 #include <check.h>
 
@@ -249,7 +252,8 @@ END_TEST
 /* target:
  *	bool
  *	pgm_timer_check (
- *		pgm_sock_t*	sock
+ *		pgm_sock_t*	sock,
+ *		pgm_time_t	now
  *	)
  */
 
@@ -257,13 +261,13 @@ START_TEST (test_check_pass_001)
 {
 	pgm_sock_t* sock = generate_sock ();
 	fail_if (NULL == sock, "generate_sock failed");
-	fail_unless (TRUE == pgm_timer_check (sock), "check failed");
+	fail_unless (TRUE == pgm_timer_check (sock, mock_pgm_time_now), "check failed");
 }
 END_TEST
 
 START_TEST (test_check_fail_001)
 {
-	gboolean expired = pgm_timer_check (NULL);
+	gboolean expired = pgm_timer_check (NULL, mock_pgm_time_now);
 	fail ("reached");
 }
 END_TEST
@@ -271,7 +275,8 @@ END_TEST
 /* target:
  *	pgm_time_t
  *	pgm_timer_expiration (
- *		pgm_sock_t*	sock
+ *		pgm_sock_t*	sock,
+ *		pgm_time_t	now
  *	)
  */
 
@@ -280,13 +285,13 @@ START_TEST (test_expiration_pass_001)
 	pgm_sock_t* sock = generate_sock ();
 	fail_if (NULL == sock, "generate_sock failed");
 	sock->next_poll = mock_pgm_time_now + pgm_secs(300);
-	fail_unless (pgm_secs(300) == pgm_timer_expiration (sock), "expiration failed");
+	fail_unless (pgm_secs(300) == pgm_timer_expiration (sock, mock_pgm_time_now), "expiration failed");
 }
 END_TEST
 
 START_TEST (test_expiration_fail_001)
 {
-	long expiration = pgm_timer_expiration (NULL);
+	long expiration = pgm_timer_expiration (NULL, mock_pgm_time_now);
 	fail ("reached");
 }
 END_TEST
@@ -294,7 +299,8 @@ END_TEST
 /* target:
  *	void
  *	pgm_timer_dispatch (
- *		pgm_sock_t*	sock
+ *		pgm_sock_t*	sock,
+ *		pgm_time_t	now
  *	)
  */
 
@@ -302,13 +308,79 @@ START_TEST (test_dispatch_pass_001)
 {
 	pgm_sock_t* sock = generate_sock ();
 	fail_if (NULL == sock, "generate_sock failed");
-	pgm_timer_dispatch (sock);
+	pgm_timer_dispatch (sock, mock_pgm_time_now);
 }
 END_TEST
 
 START_TEST (test_dispatch_fail_001)
 {
-	pgm_timer_dispatch (NULL);
+	pgm_timer_dispatch (NULL, mock_pgm_time_now);
+	fail ("reached");
+}
+END_TEST
+
+/* target:
+ *	void
+ *	pgm_timer_arm (
+ *		pgm_sock_t*	sock
+ *	)
+ */
+
+#ifdef HAVE_TIMERFD
+/* an early expiration is drained while next_poll is unchanged */
+START_TEST (test_arm_pass_001)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->use_timerfd = TRUE;
+	sock->timer_fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK);
+	fail_if (-1 == sock->timer_fd, "timerfd_create failed");
+	sock->next_poll = mock_pgm_time_now + pgm_msecs(10);
+	pgm_timer_arm (sock);
+	struct pollfd fds = { .fd = sock->timer_fd, .events = POLLIN };
+	fail_unless (0 == poll (&fds, 1, 0), "armed early");
+/* fire ahead of the library clock */
+	const struct itimerspec its = { .it_value = { 0, 1 } };
+	fail_unless (0 == timerfd_settime (sock->timer_fd, 0, &its, NULL), "timerfd_settime failed");
+	fail_unless (1 == poll (&fds, 1, 1000), "not signalled");
+	mock_pgm_time_now = sock->next_poll - pgm_usecs(900);
+	pgm_timer_arm (sock);
+	fail_unless (0 == poll (&fds, 1, 0), "signal not drained");
+	fail_unless (1 == poll (&fds, 1, 1000), "not re-armed");
+	close (sock->timer_fd);
+}
+END_TEST
+
+/* the timer is only set when next_poll moves */
+START_TEST (test_arm_pass_002)
+{
+	pgm_sock_t* sock = generate_sock ();
+	fail_if (NULL == sock, "generate_sock failed");
+	sock->use_timerfd = TRUE;
+	sock->timer_fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK);
+	fail_if (-1 == sock->timer_fd, "timerfd_create failed");
+	sock->next_poll = mock_pgm_time_now + pgm_secs(10);
+	pgm_timer_arm (sock);
+	fail_unless (sock->next_poll == sock->timer_fd_expiry, "expiry not recorded");
+	struct pollfd fds = { .fd = sock->timer_fd, .events = POLLIN };
+	const struct itimerspec its = { .it_value = { 0, 1 } };
+	fail_unless (0 == timerfd_settime (sock->timer_fd, 0, &its, NULL), "timerfd_settime failed");
+	fail_unless (1 == poll (&fds, 1, 1000), "not signalled");
+/* unchanged deadline, descriptor untouched */
+	pgm_timer_arm (sock);
+	fail_unless (1 == poll (&fds, 1, 0), "timer set again");
+	sock->next_poll += pgm_secs(1);
+	pgm_timer_arm (sock);
+	fail_unless (0 == poll (&fds, 1, 0), "timer not set");
+	fail_unless (sock->next_poll == sock->timer_fd_expiry, "expiry not recorded");
+	close (sock->timer_fd);
+}
+END_TEST
+#endif
+
+START_TEST (test_arm_fail_001)
+{
+	pgm_timer_arm (NULL);
 	fail ("reached");
 }
 END_TEST
@@ -349,6 +421,16 @@ make_test_suite (void)
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_dispatch, test_dispatch_fail_001, SIGABRT);
 #endif
+
+	TCase* tc_arm = tcase_create ("arm");
+	suite_add_tcase (s, tc_arm);
+#ifdef HAVE_TIMERFD
+	tcase_add_test (tc_arm, test_arm_pass_001);
+	tcase_add_test (tc_arm, test_arm_pass_002);
+#endif
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_arm, test_arm_fail_001, SIGABRT);
+#endif
 	return s;
 }
 
@@ -128,6 +128,16 @@ pgm_txw_set_unfolded_checksum (
 	state->unfolded_checksum = csum;
 }
 
+PGM_GNUC_INTERNAL
+uint32_t
+pgm_txw_get_repair_nla (
+	const struct pgm_sk_buff_t*const skb
+	)
+{
+	const pgm_txw_state_t*const state = (const pgm_txw_state_t*const)&skb->cb;
+	return state->repair_nla;
+}
+
 PGM_GNUC_INTERNAL
 void
 pgm_txw_inc_retransmit_count (
@@ -179,7 +189,6 @@ pgm_txw_create (
 /* pre-conditions */
 	pgm_assert (NULL != tsi);
 	if (sqns) {
-		pgm_assert_cmpuint (tpdu_size, ==, 0);
 		pgm_assert_cmpuint (sqns, >, 0);
 		pgm_assert_cmpuint (sqns & PGM_UINT32_SIGN_BIT, ==, 0);
 		pgm_assert_cmpuint (secs, ==, 0);
@@ -190,6 +199,8 @@ pgm_txw_create (
 		pgm_assert_cmpuint (max_rte, >, 0);
 	}
 	if (use_fec) {
+/* tpdu size is also the parity buffer size */
+		pgm_assert_cmpuint (tpdu_size, >, 0);
 		pgm_assert_cmpuint (rs_n, >, 0);
 		pgm_assert_cmpuint (rs_k, >, 0);
 	}
@@ -475,8 +486,7 @@ pgm_txw_retransmit_push_parity (
 /* check if request can be eliminated */
 	if (state->waiting_retransmit)
 	{
-		pgm_assert (NULL != ((const pgm_list_t*)skb)->next);
-		pgm_assert (NULL != ((const pgm_list_t*)skb)->prev);
+		pgm_assert (!pgm_queue_is_empty (&window->retransmit_queue));
 		if (state->pkt_cnt_requested < nak_pkt_cnt) {
 /* more parity packets requested than currently scheduled, simply bump up the count */
 			state->pkt_cnt_requested = nak_pkt_cnt;
@@ -490,8 +500,9 @@ pgm_txw_retransmit_push_parity (
 		pgm_assert (((const pgm_list_t*)skb)->prev == NULL);
 	}
 
-/* new request */
-	state->pkt_cnt_requested++;
+/* new request, at least one parity packet beyond those already sent */
+	state->pkt_cnt_requested = MAX(state->pkt_cnt_requested + 1, nak_pkt_cnt);
+	state->repair_nla = 0;
 	pgm_queue_push_head_link (&window->retransmit_queue, (pgm_list_t*)skb);
 	pgm_assert (!pgm_queue_is_empty (&window->retransmit_queue));
 	state->waiting_retransmit = 1;
@@ -532,6 +543,7 @@ pgm_txw_retransmit_push_selective (
 	pgm_assert (((const pgm_list_t*)skb)->prev == NULL);
 
 /* new request */
+	state->repair_nla = PGM_TXW_NLA_NONE;
 	pgm_queue_push_head_link (&window->retransmit_queue, (pgm_list_t*)skb);
 	pgm_assert (!pgm_queue_is_empty (&window->retransmit_queue));
 	state->waiting_retransmit = 1;
@@ -588,7 +600,8 @@ pgm_txw_retransmit_try_peek (
 	}
 
 /* generate parity packet to satisify request */	
-	const uint8_t rs_h = state->pkt_cnt_sent % (window->rs.n - window->rs.k);
+/* parity index is carried in the packet sequence within the transmission group */
+	const uint8_t rs_h = state->pkt_cnt_sent % MIN(window->rs.n - window->rs.k, window->rs.k);
 	const uint32_t tg_sqn_mask = 0xffffffff << window->tg_sqn_shift;
 	const uint32_t tg_sqn = skb->sequence & tg_sqn_mask;
 	for (uint_fast8_t i = 0; i < window->rs.k; i++)
@@ -734,9 +747,11 @@ pgm_txw_retransmit_try_peek (
 			data,
 			parity_length);
 
-/* calculate partial checksum */
+/* calculate partial checksum of the parity payload, the request state keeps
+ * the original packet checksum for selective repairs.
+ */
 	const uint16_t tsdu_length = pgm_ntohs (skb->pgm_header->pgm_tsdu_length);
-	state->unfolded_checksum = pgm_csum_partial ((char*)skb->tail - tsdu_length, tsdu_length, 0);
+	pgm_txw_set_unfolded_checksum (skb, pgm_csum_partial ((char*)skb->tail - tsdu_length, tsdu_length, 0));
 	return skb;
 }
 
@@ -785,4 +800,34 @@ pgm_txw_retransmit_remove_head (
 	}
 }
 
+/* record a requester of a queued selective repair, a second distinct requester
+ * or one unknown (zero) reverts the repair to multicast.
+ */
+
+PGM_GNUC_INTERNAL
+void
+pgm_txw_retransmit_add_nla (
+	pgm_txw_t* const	window,
+	const uint32_t		sequence,
+	const uint32_t		nla
+	)
+{
+	struct pgm_sk_buff_t	*skb;
+	pgm_txw_state_t		*state;
+
+/* pre-conditions */
+	pgm_assert (NULL != window);
+
+	skb = _pgm_txw_peek (window, sequence);
+	if (NULL == skb)
+		return;
+	state = (pgm_txw_state_t*)&skb->cb;
+	if (!state->waiting_retransmit || state->pkt_cnt_requested)
+		return;
+	if (PGM_TXW_NLA_NONE == state->repair_nla)
+		state->repair_nla = nla;
+	else if (state->repair_nla != nla)
+		state->repair_nla = 0;
+}
+
 /* eof */
@@ -52,6 +52,8 @@ mock_pgm_rs_create (
 	uint8_t			k
 	)
 {
+	rs->n = n;
+	rs->k = k;
 }
 
 void
@@ -80,7 +82,7 @@ mock_pgm_compat_csum_partial (
 	uint32_t		csum
 	)
 {
-	return 0x0;
+	return len;
 }
 
 void
@@ -187,6 +189,16 @@ START_TEST (test_create_pass_004)
 }
 END_TEST
 
+/* sequence count window with parity buffer */
+START_TEST (test_create_pass_005)
+{
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	pgm_txw_t* window = pgm_txw_create (&tsi, 1500, 100, 0, 0, TRUE, 255, 4);
+	fail_if (NULL == window, "create failed");
+	fail_unless (2 == window->tg_sqn_shift, "tg_sqn_shift failed");
+}
+END_TEST
+
 /* invalid tpdu size */
 START_TEST (test_create_fail_001)
 {
@@ -223,6 +235,15 @@ START_TEST (test_create_fail_004)
 }
 END_TEST
 
+/* no parity buffer size */
+START_TEST (test_create_fail_005)
+{
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	const pgm_txw_t* window = pgm_txw_create (&tsi, 0, 100, 0, 0, TRUE, 255, 4);
+	fail ("reached");
+}
+END_TEST
+
 /* target:
  *	void
  *	pgm_txw_shutdown (
@@ -586,6 +607,36 @@ START_TEST (test_retransmit_try_peek_pass_001)
 }
 END_TEST
 
+/* parity index stays inside the transmission group, checksum kept per packet */
+START_TEST (test_retransmit_try_peek_pass_002)
+{
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	pgm_txw_t* window = pgm_txw_create (&tsi, 1500, 100, 0, 0, TRUE, 255, 4);
+	fail_if (NULL == window, "create failed");
+	for (unsigned i = 0; i < 4; i++) {
+		struct pgm_sk_buff_t* skb = generate_valid_skb ();
+		fail_if (NULL == skb, "generate_valid_skb failed");
+		pgm_txw_add (window, skb);
+	}
+	struct pgm_sk_buff_t* tg_skb = pgm_txw_peek (window, 0);
+	pgm_txw_set_unfolded_checksum (tg_skb, 0x1234);
+/* three parity packets, then each later request adds one more */
+	fail_unless (TRUE == pgm_txw_retransmit_push (window, 0 | 3, TRUE, window->tg_sqn_shift), "retransmit_push failed");
+	for (unsigned i = 0; i < 5; i++) {
+		if (i >= 3)
+			fail_unless (TRUE == pgm_txw_retransmit_push (window, 0 | 1, TRUE, window->tg_sqn_shift), "retransmit_push failed");
+		struct pgm_sk_buff_t* parity_skb = pgm_txw_retransmit_try_peek (window);
+		fail_if (NULL == parity_skb, "retransmit_try_peek failed");
+/* fifth parity packet reuses index 0 rather than a sequence of the next group */
+		fail_unless ((i % 4) == g_ntohl (parity_skb->pgm_data->data_sqn), "parity sequence failed");
+		fail_unless (g_ntohs (parity_skb->pgm_header->pgm_tsdu_length) == pgm_txw_get_unfolded_checksum (parity_skb), "parity checksum failed");
+		pgm_txw_retransmit_remove_head (window);
+	}
+	fail_unless (0x1234 == pgm_txw_get_unfolded_checksum (tg_skb), "original checksum overwritten");
+	pgm_txw_shutdown (window);
+}
+END_TEST
+
 /* null window */
 START_TEST (test_retransmit_try_peek_fail_001)
 {
@@ -635,6 +686,46 @@ START_TEST (test_retransmit_remove_head_fail_002)
 }
 END_TEST
 
+/* target:
+ *	void
+ *	pgm_txw_retransmit_add_nla (
+ *		pgm_txw_t* const	window,
+ *		const uint32_t		sequence,
+ *		const uint32_t		nla
+ *		)
+ */
+
+START_TEST (test_retransmit_add_nla_pass_001)
+{
+	const pgm_tsi_t tsi = { { 1, 2, 3, 4, 5, 6 }, 1000 };
+	pgm_txw_t* window = pgm_txw_create (&tsi, 0, 100, 0, 0, FALSE, 0, 0);
+	fail_if (NULL == window, "create failed");
+	struct pgm_sk_buff_t* skb = generate_valid_skb ();
+	fail_if (NULL == skb, "generate_valid_skb failed");
+	pgm_txw_add (window, skb);
+/* ignored without a queued request */
+	pgm_txw_retransmit_add_nla (window, window->trail, 1);
+	fail_unless (TRUE == pgm_txw_retransmit_push (window, window->trail, FALSE, 0), "retransmit_push failed");
+	fail_unless (PGM_TXW_NLA_NONE == pgm_txw_get_repair_nla (skb), "unset failed");
+	pgm_txw_retransmit_add_nla (window, window->trail, 1);
+	pgm_txw_retransmit_add_nla (window, window->trail, 1);
+	fail_unless (1 == pgm_txw_get_repair_nla (skb), "sole requester failed");
+/* second requester reverts to multicast */
+	pgm_txw_retransmit_add_nla (window, window->trail, 2);
+	fail_unless (0 == pgm_txw_get_repair_nla (skb), "multicast failed");
+	pgm_txw_retransmit_add_nla (window, window->trail, 1);
+	fail_unless (0 == pgm_txw_get_repair_nla (skb), "multicast failed");
+	pgm_txw_shutdown (window);
+}
+END_TEST
+
+START_TEST (test_retransmit_add_nla_fail_001)
+{
+	pgm_txw_retransmit_add_nla (NULL, 0, 1);
+	fail ("reached");
+}
+END_TEST
+
 static
 Suite*
 make_test_suite (void)
@@ -649,11 +740,13 @@ make_test_suite (void)
 	tcase_add_test (tc_create, test_create_pass_002);
 	tcase_add_test (tc_create, test_create_pass_003);
 	tcase_add_test (tc_create, test_create_pass_004);
+	tcase_add_test (tc_create, test_create_pass_005);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_create, test_create_fail_001, SIGABRT);
 	tcase_add_test_raise_signal (tc_create, test_create_fail_002, SIGABRT);
 	tcase_add_test_raise_signal (tc_create, test_create_fail_003, SIGABRT);
 	tcase_add_test_raise_signal (tc_create, test_create_fail_004, SIGABRT);
+	tcase_add_test_raise_signal (tc_create, test_create_fail_005, SIGABRT);
 #endif
 
 	TCase* tc_shutdown = tcase_create ("shutdown");
@@ -746,6 +839,7 @@ make_test_suite (void)
 	TCase* tc_retransmit_try_peek = tcase_create ("retransmit-try-peek");
 	suite_add_tcase (s, tc_retransmit_try_peek);
 	tcase_add_test (tc_retransmit_try_peek, test_retransmit_try_peek_pass_001);
+	tcase_add_test (tc_retransmit_try_peek, test_retransmit_try_peek_pass_002);
 #ifndef PGM_CHECK_NOFORK
 	tcase_add_test_raise_signal (tc_retransmit_try_peek, test_retransmit_try_peek_fail_001, SIGABRT);
 #endif
@@ -758,6 +852,13 @@ make_test_suite (void)
 	tcase_add_test_raise_signal (tc_retransmit_remove_head, test_retransmit_remove_head_fail_002, SIGABRT);
 #endif
 
+	TCase* tc_retransmit_add_nla = tcase_create ("retransmit-add-nla");
+	suite_add_tcase (s, tc_retransmit_add_nla);
+	tcase_add_test (tc_retransmit_add_nla, test_retransmit_add_nla_pass_001);
+#ifndef PGM_CHECK_NOFORK
+	tcase_add_test_raise_signal (tc_retransmit_add_nla, test_retransmit_add_nla_fail_001, SIGABRT);
+#endif
+
 	return s;
 }
 